@@ -315,12 +315,12 @@ namespace
 
 
     //-------------------------------------------------------------------------------------
-    inline void DecodeBC1(
-        _Out_writes_(NUM_PIXELS_PER_BLOCK) XMVECTOR *pColor,
+    inline void DecodeBC1Palette(
+        _Out_writes_(4) XMVECTOR *pPalette,
         _In_ const D3DX_BC1 *pBC,
         bool isbc1)
     {
-        assert(pColor && pBC);
+        assert(pPalette && pBC);
         static_assert(sizeof(D3DX_BC1) == 8, "D3DX_BC1 should be 8 bytes");
 
         static XMVECTORF32 s_Scale = { { { 1.f / 31.f, 1.f / 63.f, 1.f / 31.f, 1.f } } };
@@ -337,31 +337,36 @@ namespace
         clr0 = XMVectorSelect(g_XMIdentityR3, clr0, g_XMSelect1110);
         clr1 = XMVectorSelect(g_XMIdentityR3, clr1, g_XMSelect1110);
 
-        XMVECTOR clr2, clr3;
+        pPalette[0] = clr0;
+        pPalette[1] = clr1;
+
         if (isbc1 && (pBC->rgb[0] <= pBC->rgb[1]))
         {
-            clr2 = XMVectorLerp(clr0, clr1, 0.5f);
-            clr3 = XMVectorZero();  // Alpha of 0
+            pPalette[2] = XMVectorLerp(clr0, clr1, 0.5f);
+            pPalette[3] = XMVectorZero();  // Alpha of 0
         }
         else
         {
-            clr2 = XMVectorLerp(clr0, clr1, 1.f / 3.f);
-            clr3 = XMVectorLerp(clr0, clr1, 2.f / 3.f);
+            pPalette[2] = XMVectorLerp(clr0, clr1, 1.f / 3.f);
+            pPalette[3] = XMVectorLerp(clr0, clr1, 2.f / 3.f);
         }
+    }
+
+    inline void DecodeBC1(
+        _Out_writes_(NUM_PIXELS_PER_BLOCK) XMVECTOR *pColor,
+        _In_ const D3DX_BC1 *pBC,
+        bool isbc1)
+    {
+        assert(pColor && pBC);
+
+        XMVECTOR palette[4];
+        DecodeBC1Palette(palette, pBC, isbc1);
 
         uint32_t dw = pBC->bitmap;
 
         for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i, dw >>= 2)
         {
-            switch (dw & 3)
-            {
-            case 0: pColor[i] = clr0; break;
-            case 1: pColor[i] = clr1; break;
-            case 2: pColor[i] = clr2; break;
-
-            case 3:
-            default: pColor[i] = clr3; break;
-            }
+            pColor[i] = palette[dw & 3];
         }
     }
 
@@ -717,6 +722,509 @@ namespace
         pBC->bitmap = 0x00000000;
     }
 #endif // COLOR_WEIGHTS
+
+    //-------------------------------------------------------------------------------------
+    void EncodeBC3Alpha(
+        _Out_ D3DX_BC3 *pBC3,
+        _In_reads_(NUM_PIXELS_PER_BLOCK) const HDRColorA *pColor,
+        DWORD flags)
+    {
+        assert(pBC3 && pColor);
+        static_assert(sizeof(D3DX_BC3) == 16, "D3DX_BC3 should be 16 bytes");
+
+        // Quantize block to A8, using Floyd Stienberg error diffusion.  This 
+        // increases the chance that colors will map directly to the quantized 
+        // axis endpoints.
+        float fAlpha[NUM_PIXELS_PER_BLOCK] = {};
+        float fError[NUM_PIXELS_PER_BLOCK] = {};
+
+        float fMinAlpha = pColor[0].a;
+        float fMaxAlpha = pColor[0].a;
+
+        for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+        {
+            float fAlph = pColor[i].a;
+            if (flags & BC_FLAGS_DITHER_A)
+                fAlph += fError[i];
+
+            fAlpha[i] = static_cast<int32_t>(fAlph * 255.0f + 0.5f) * (1.0f / 255.0f);
+
+            if (fAlpha[i] < fMinAlpha)
+                fMinAlpha = fAlpha[i];
+            else if (fAlpha[i] > fMaxAlpha)
+                fMaxAlpha = fAlpha[i];
+
+            if (flags & BC_FLAGS_DITHER_A)
+            {
+                float fDiff = fAlph - fAlpha[i];
+
+                if (3 != (i & 3))
+                {
+                    assert(i < 15);
+                    _Analysis_assume_(i < 15);
+                    fError[i + 1] += fDiff * (7.0f / 16.0f);
+                }
+
+                if (i < 12)
+                {
+                    if (i & 3)
+                        fError[i + 3] += fDiff * (3.0f / 16.0f);
+
+                    fError[i + 4] += fDiff * (5.0f / 16.0f);
+
+                    if (3 != (i & 3))
+                    {
+                        assert(i < 11);
+                        _Analysis_assume_(i < 11);
+                        fError[i + 5] += fDiff * (1.0f / 16.0f);
+                    }
+                }
+            }
+        }
+
+#ifdef COLOR_WEIGHTS
+        if (0.0f == fMaxAlpha)
+        {
+            EncodeSolidBC1(&pBC3->dxt1, pColor);
+            pBC3->alpha[0] = 0x00;
+            pBC3->alpha[1] = 0x00;
+            memset(pBC3->bitmap, 0x00, 6);
+        }
+#endif
+
+        if (1.0f == fMinAlpha)
+        {
+            pBC3->alpha[0] = 0xff;
+            pBC3->alpha[1] = 0xff;
+            memset(pBC3->bitmap, 0x00, 6);
+            return;
+        }
+
+        // Optimize and Quantize Min and Max values
+        uint32_t uSteps = ((0.0f == fMinAlpha) || (1.0f == fMaxAlpha)) ? 6 : 8;
+
+        float fAlphaA, fAlphaB;
+        OptimizeAlpha<false>(&fAlphaA, &fAlphaB, fAlpha, uSteps);
+
+        auto bAlphaA = static_cast<uint8_t>(static_cast<int32_t>(fAlphaA * 255.0f + 0.5f));
+        auto bAlphaB = static_cast<uint8_t>(static_cast<int32_t>(fAlphaB * 255.0f + 0.5f));
+
+        fAlphaA = static_cast<float>(bAlphaA) * (1.0f / 255.0f);
+        fAlphaB = static_cast<float>(bAlphaB) * (1.0f / 255.0f);
+
+        // Setup block
+        if ((8 == uSteps) && (bAlphaA == bAlphaB))
+        {
+            pBC3->alpha[0] = bAlphaA;
+            pBC3->alpha[1] = bAlphaB;
+            memset(pBC3->bitmap, 0x00, 6);
+            return;
+        }
+
+        static const size_t pSteps6[] = { 0, 2, 3, 4, 5, 1 };
+        static const size_t pSteps8[] = { 0, 2, 3, 4, 5, 6, 7, 1 };
+
+        const size_t *pSteps;
+        float fStep[8] = {};
+
+        if (6 == uSteps)
+        {
+            pBC3->alpha[0] = bAlphaA;
+            pBC3->alpha[1] = bAlphaB;
+
+            fStep[0] = fAlphaA;
+            fStep[1] = fAlphaB;
+
+            for (size_t i = 1; i < 5; ++i)
+                fStep[i + 1] = (fStep[0] * (5 - i) + fStep[1] * i) * (1.0f / 5.0f);
+
+            fStep[6] = 0.0f;
+            fStep[7] = 1.0f;
+
+            pSteps = pSteps6;
+        }
+        else
+        {
+            pBC3->alpha[0] = bAlphaB;
+            pBC3->alpha[1] = bAlphaA;
+
+            fStep[0] = fAlphaB;
+            fStep[1] = fAlphaA;
+
+            for (size_t i = 1; i < 7; ++i)
+                fStep[i + 1] = (fStep[0] * (7 - i) + fStep[1] * i) * (1.0f / 7.0f);
+
+            pSteps = pSteps8;
+        }
+
+        // Encode alpha bitmap
+        auto fSteps = static_cast<float>(uSteps - 1);
+        float fScale = (fStep[0] != fStep[1]) ? (fSteps / (fStep[1] - fStep[0])) : 0.0f;
+
+        if (flags & BC_FLAGS_DITHER_A)
+            memset(fError, 0x00, NUM_PIXELS_PER_BLOCK * sizeof(float));
+
+        for (size_t iSet = 0; iSet < 2; iSet++)
+        {
+            uint32_t dw = 0;
+
+            size_t iMin = iSet * 8;
+            size_t iLim = iMin + 8;
+
+            for (size_t i = iMin; i < iLim; ++i)
+            {
+                float fAlph = pColor[i].a;
+                if (flags & BC_FLAGS_DITHER_A)
+                    fAlph += fError[i];
+                float fDot = (fAlph - fStep[0]) * fScale;
+
+                uint32_t iStep;
+                if (fDot <= 0.0f)
+                    iStep = ((6 == uSteps) && (fAlph <= fStep[0] * 0.5f)) ? 6 : 0;
+                else if (fDot >= fSteps)
+                    iStep = ((6 == uSteps) && (fAlph >= (fStep[1] + 1.0f) * 0.5f)) ? 7 : 1;
+                else
+                    iStep = uint32_t(pSteps[uint32_t(fDot + 0.5f)]);
+
+                dw = (iStep << 21) | (dw >> 3);
+
+                if (flags & BC_FLAGS_DITHER_A)
+                {
+                    float fDiff = (fAlph - fStep[iStep]);
+
+                    if (3 != (i & 3))
+                        fError[i + 1] += fDiff * (7.0f / 16.0f);
+
+                    if (i < 12)
+                    {
+                        if (i & 3)
+                            fError[i + 3] += fDiff * (3.0f / 16.0f);
+
+                        fError[i + 4] += fDiff * (5.0f / 16.0f);
+
+                        if (3 != (i & 3))
+                            fError[i + 5] += fDiff * (1.0f / 16.0f);
+                    }
+                }
+            }
+
+            pBC3->bitmap[0 + iSet * 3] = reinterpret_cast<uint8_t *>(&dw)[0];
+            pBC3->bitmap[1 + iSet * 3] = reinterpret_cast<uint8_t *>(&dw)[1];
+            pBC3->bitmap[2 + iSet * 3] = reinterpret_cast<uint8_t *>(&dw)[2];
+        }
+    }
+#if defined(_XM_SSE_INTRINSICS_) && !defined(_XM_NO_INTRINSICS_)
+    //-------------------------------------------------------------------------------------
+    // Multi-block BC1 color encoder, one block per SSE lane. This is EncodeBC1 and
+    // OptimizeRGB without dithering, processing the pixels of 4 blocks in structure-of-
+    // arrays form with masks instead of branches. Blocks in 4 step mode get the same
+    // results as with EncodeBC1.
+    //-------------------------------------------------------------------------------------
+    inline __m128 Select4(__m128 mask, __m128 a, __m128 b)
+    {
+        // mask ? a : b
+        return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+    }
+
+    inline __m128 Dot3x4(__m128 ar, __m128 ag, __m128 ab, __m128 br, __m128 bg, __m128 bb)
+    {
+        return _mm_add_ps(_mm_add_ps(_mm_mul_ps(ar, br), _mm_mul_ps(ag, bg)), _mm_mul_ps(ab, bb));
+    }
+
+    // Rounds fDot to a step the same way as "fDot <= 0 ? 0 : fDot >= fSteps ? cSteps - 1 : uint32_t(fDot + 0.5f)"
+    inline __m128i RoundStep4(__m128 fDot, __m128 fSteps)
+    {
+        __m128 f = _mm_min_ps(_mm_max_ps(fDot, _mm_setzero_ps()), fSteps);
+        return _mm_cvttps_epi32(_mm_add_ps(f, _mm_set1_ps(0.5f)));
+    }
+
+    inline __m128 Quantize4(__m128 v, float fScale)
+    {
+        __m128i i = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(v, _mm_set1_ps(fScale)), _mm_set1_ps(0.5f)));
+        return _mm_mul_ps(_mm_cvtepi32_ps(i), _mm_set1_ps(1.0f / fScale));
+    }
+
+    inline __m128i Encode565x4(__m128 r, __m128 g, __m128 b)
+    {
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 half = _mm_set1_ps(0.5f);
+
+        r = _mm_min_ps(_mm_max_ps(r, zero), one);
+        g = _mm_min_ps(_mm_max_ps(g, zero), one);
+        b = _mm_min_ps(_mm_max_ps(b, zero), one);
+
+        __m128i ir = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(r, _mm_set1_ps(31.0f)), half));
+        __m128i ig = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(g, _mm_set1_ps(63.0f)), half));
+        __m128i ib = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(b, _mm_set1_ps(31.0f)), half));
+
+        return _mm_or_si128(_mm_or_si128(_mm_slli_epi32(ir, 11), _mm_slli_epi32(ig, 5)), ib);
+    }
+
+    inline void Decode565x4(__m128i w565, __m128& r, __m128& g, __m128& b)
+    {
+        r = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(w565, 11), _mm_set1_epi32(31))), _mm_set1_ps(1.0f / 31.0f));
+        g = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(w565, 5), _mm_set1_epi32(63))), _mm_set1_ps(1.0f / 63.0f));
+        b = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(w565, _mm_set1_epi32(31))), _mm_set1_ps(1.0f / 31.0f));
+    }
+
+    // Returns a mask of the blocks which were not encoded because they need the 3 color mode (only with bColorKey)
+    uint32_t EncodeBC1x4(
+        _Out_writes_(4) D3DX_BC1 *const *ppBC,
+        _In_reads_(NUM_PIXELS_PER_BLOCK * 4) const XMVECTOR *pColor,
+        bool bColorKey,
+        float threshold,
+        DWORD flags)
+    {
+        assert(ppBC && pColor);
+
+        const bool bUniform = (flags & BC_FLAGS_UNIFORM) != 0;
+        const __m128 wR = _mm_set1_ps(bUniform ? 1.0f : g_Luminance.r);
+        const __m128 wG = _mm_set1_ps(bUniform ? 1.0f : g_Luminance.g);
+        const __m128 wB = _mm_set1_ps(bUniform ? 1.0f : g_Luminance.b);
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 fSteps = _mm_set1_ps(3.0f);
+
+        // Transpose to one register per pixel and channel, holding that pixel of all 4 blocks.
+        // Quantize to R5G6B5 and apply the perceptual weighting.
+        __m128 R[NUM_PIXELS_PER_BLOCK], G[NUM_PIXELS_PER_BLOCK], B[NUM_PIXELS_PER_BLOCK];
+        __m128 QR[NUM_PIXELS_PER_BLOCK], QG[NUM_PIXELS_PER_BLOCK], QB[NUM_PIXELS_PER_BLOCK];
+        __m128 colorKey = zero;
+
+        for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+        {
+            // Pixel i of the 4 blocks, transposed to the r, g, b and a of the blocks
+            __m128 r = pColor[i];
+            __m128 g = pColor[i + NUM_PIXELS_PER_BLOCK];
+            __m128 b = pColor[i + NUM_PIXELS_PER_BLOCK * 2];
+            __m128 a = pColor[i + NUM_PIXELS_PER_BLOCK * 3];
+            _MM_TRANSPOSE4_PS(r, g, b, a);
+
+            if (bColorKey)
+                colorKey = _mm_or_ps(colorKey, _mm_cmplt_ps(a, _mm_set1_ps(threshold)));
+
+            R[i] = _mm_mul_ps(r, wR);
+            G[i] = _mm_mul_ps(g, wG);
+            B[i] = _mm_mul_ps(b, wB);
+
+            QR[i] = _mm_mul_ps(Quantize4(r, 31.0f), wR);
+            QG[i] = _mm_mul_ps(Quantize4(g, 63.0f), wG);
+            QB[i] = _mm_mul_ps(Quantize4(b, 31.0f), wB);
+        }
+
+        if (_mm_movemask_ps(colorKey) == 0xf)
+            return 0xf;
+
+        // Find Min and Max points, as starting point
+        __m128 XR = wR, XG = wG, XB = wB;
+        __m128 YR = zero, YG = zero, YB = zero;
+
+        for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+        {
+            XR = _mm_min_ps(XR, QR[i]);
+            XG = _mm_min_ps(XG, QG[i]);
+            XB = _mm_min_ps(XB, QB[i]);
+            YR = _mm_max_ps(YR, QR[i]);
+            YG = _mm_max_ps(YG, QG[i]);
+            YB = _mm_max_ps(YB, QB[i]);
+        }
+
+        // Diagonal axis, single color blocks are done
+        __m128 ABR = _mm_sub_ps(YR, XR);
+        __m128 ABG = _mm_sub_ps(YG, XG);
+        __m128 ABB = _mm_sub_ps(YB, XB);
+        __m128 fAB = Dot3x4(ABR, ABG, ABB, ABR, ABG, ABB);
+        __m128 single = _mm_cmplt_ps(fAB, _mm_set1_ps(FLT_MIN));
+
+        // Try all four axis directions, to determine which diagonal best fits data
+        __m128 fABInv = _mm_div_ps(_mm_set1_ps(1.0f), fAB);
+        __m128 DirR = _mm_mul_ps(ABR, fABInv);
+        __m128 DirG = _mm_mul_ps(ABG, fABInv);
+        __m128 DirB = _mm_mul_ps(ABB, fABInv);
+        __m128 MidR = _mm_mul_ps(_mm_add_ps(XR, YR), _mm_set1_ps(0.5f));
+        __m128 MidG = _mm_mul_ps(_mm_add_ps(XG, YG), _mm_set1_ps(0.5f));
+        __m128 MidB = _mm_mul_ps(_mm_add_ps(XB, YB), _mm_set1_ps(0.5f));
+
+        __m128 fDir[4] = { zero, zero, zero, zero };
+        for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+        {
+            __m128 PtR = _mm_mul_ps(_mm_sub_ps(QR[i], MidR), DirR);
+            __m128 PtG = _mm_mul_ps(_mm_sub_ps(QG[i], MidG), DirG);
+            __m128 PtB = _mm_mul_ps(_mm_sub_ps(QB[i], MidB), DirB);
+
+            __m128 f = _mm_add_ps(_mm_add_ps(PtR, PtG), PtB);
+            fDir[0] = _mm_add_ps(fDir[0], _mm_mul_ps(f, f));
+            f = _mm_sub_ps(_mm_add_ps(PtR, PtG), PtB);
+            fDir[1] = _mm_add_ps(fDir[1], _mm_mul_ps(f, f));
+            f = _mm_add_ps(_mm_sub_ps(PtR, PtG), PtB);
+            fDir[2] = _mm_add_ps(fDir[2], _mm_mul_ps(f, f));
+            f = _mm_sub_ps(_mm_sub_ps(PtR, PtG), PtB);
+            fDir[3] = _mm_add_ps(fDir[3], _mm_mul_ps(f, f));
+        }
+
+        // Direction 1 and 3 swap blue, 2 and 3 swap green
+        __m128 fDirMax = fDir[0];
+        __m128 swapB = zero;
+        __m128 swapG = zero;
+        for (size_t iDir = 1; iDir < 4; iDir++)
+        {
+            __m128 better = _mm_cmpgt_ps(fDir[iDir], fDirMax);
+            fDirMax = Select4(better, fDir[iDir], fDirMax);
+            swapB = Select4(better, (iDir & 1) ? better : zero, swapB);
+            swapG = Select4(better, (iDir & 2) ? better : zero, swapG);
+        }
+        swapB = _mm_andnot_ps(single, swapB);
+        swapG = _mm_andnot_ps(single, swapG);
+
+        __m128 f = XG;
+        XG = Select4(swapG, YG, XG);
+        YG = Select4(swapG, f, YG);
+        f = XB;
+        XB = Select4(swapB, YB, XB);
+        YB = Select4(swapB, f, YB);
+
+        // Two color blocks are done too. Use Newton's Method to find local minima of sum-of-squares error for the others.
+        static const float fEpsilon = (0.25f / 64.0f) * (0.25f / 64.0f);
+        const __m128 epsilon = _mm_set1_ps(fEpsilon);
+        const __m128 minLength = _mm_set1_ps(1.0f / 4096.0f);
+        __m128 done = _mm_or_ps(single, _mm_cmplt_ps(fAB, minLength));
+
+        for (size_t iIteration = 0; iIteration < 8 && _mm_movemask_ps(done) != 0xf; iIteration++)
+        {
+            // Calculate color direction
+            DirR = _mm_sub_ps(YR, XR);
+            DirG = _mm_sub_ps(YG, XG);
+            DirB = _mm_sub_ps(YB, XB);
+
+            __m128 fLen = Dot3x4(DirR, DirG, DirB, DirR, DirG, DirB);
+            done = _mm_or_ps(done, _mm_cmplt_ps(fLen, minLength));
+
+            __m128 fScale = _mm_div_ps(fSteps, fLen);
+            DirR = _mm_mul_ps(DirR, fScale);
+            DirG = _mm_mul_ps(DirG, fScale);
+            DirB = _mm_mul_ps(DirB, fScale);
+
+            // Evaluate function, and derivatives
+            __m128 d2X = zero, dXR = zero, dXG = zero, dXB = zero;
+            __m128 d2Y = zero, dYR = zero, dYG = zero, dYB = zero;
+
+            for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+            {
+                __m128 fDot = Dot3x4(_mm_sub_ps(QR[i], XR), _mm_sub_ps(QG[i], XG), _mm_sub_ps(QB[i], XB), DirR, DirG, DirB);
+                __m128i iStep = RoundStep4(fDot, fSteps);
+
+                // Step weights { 1, 2/3, 1/3, 0 } and { 0, 1/3, 2/3, 1 }
+                __m128 step1 = _mm_castsi128_ps(_mm_cmpeq_epi32(iStep, _mm_set1_epi32(1)));
+                __m128 step2 = _mm_castsi128_ps(_mm_cmpeq_epi32(iStep, _mm_set1_epi32(2)));
+                __m128 step3 = _mm_castsi128_ps(_mm_cmpeq_epi32(iStep, _mm_set1_epi32(3)));
+                __m128 fC = Select4(step1, _mm_set1_ps(2.0f / 3.0f), Select4(step2, _mm_set1_ps(1.0f / 3.0f), Select4(step3, zero, _mm_set1_ps(1.0f))));
+                __m128 fD = Select4(step1, _mm_set1_ps(1.0f / 3.0f), Select4(step2, _mm_set1_ps(2.0f / 3.0f), Select4(step3, _mm_set1_ps(1.0f), zero)));
+
+                __m128 DiffR = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(XR, fC), _mm_mul_ps(YR, fD)), QR[i]);
+                __m128 DiffG = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(XG, fC), _mm_mul_ps(YG, fD)), QG[i]);
+                __m128 DiffB = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(XB, fC), _mm_mul_ps(YB, fD)), QB[i]);
+
+                __m128 fC8 = _mm_mul_ps(fC, _mm_set1_ps(1.0f / 8.0f));
+                __m128 fD8 = _mm_mul_ps(fD, _mm_set1_ps(1.0f / 8.0f));
+
+                d2X = _mm_add_ps(d2X, _mm_mul_ps(fC8, fC));
+                dXR = _mm_add_ps(dXR, _mm_mul_ps(fC8, DiffR));
+                dXG = _mm_add_ps(dXG, _mm_mul_ps(fC8, DiffG));
+                dXB = _mm_add_ps(dXB, _mm_mul_ps(fC8, DiffB));
+
+                d2Y = _mm_add_ps(d2Y, _mm_mul_ps(fD8, fD));
+                dYR = _mm_add_ps(dYR, _mm_mul_ps(fD8, DiffR));
+                dYG = _mm_add_ps(dYG, _mm_mul_ps(fD8, DiffG));
+                dYB = _mm_add_ps(dYB, _mm_mul_ps(fD8, DiffB));
+            }
+
+            // Move endpoints of the blocks which are not done
+            __m128 moveX = _mm_andnot_ps(done, _mm_cmpgt_ps(d2X, zero));
+            f = _mm_div_ps(_mm_set1_ps(-1.0f), d2X);
+            XR = Select4(moveX, _mm_add_ps(XR, _mm_mul_ps(dXR, f)), XR);
+            XG = Select4(moveX, _mm_add_ps(XG, _mm_mul_ps(dXG, f)), XG);
+            XB = Select4(moveX, _mm_add_ps(XB, _mm_mul_ps(dXB, f)), XB);
+
+            __m128 moveY = _mm_andnot_ps(done, _mm_cmpgt_ps(d2Y, zero));
+            f = _mm_div_ps(_mm_set1_ps(-1.0f), d2Y);
+            YR = Select4(moveY, _mm_add_ps(YR, _mm_mul_ps(dYR, f)), YR);
+            YG = Select4(moveY, _mm_add_ps(YG, _mm_mul_ps(dYG, f)), YG);
+            YB = Select4(moveY, _mm_add_ps(YB, _mm_mul_ps(dYB, f)), YB);
+
+            __m128 converged = _mm_and_ps(
+                _mm_and_ps(_mm_cmplt_ps(_mm_mul_ps(dXR, dXR), epsilon), _mm_cmplt_ps(_mm_mul_ps(dXG, dXG), epsilon)),
+                _mm_and_ps(_mm_cmplt_ps(_mm_mul_ps(dXB, dXB), epsilon), _mm_cmplt_ps(_mm_mul_ps(dYR, dYR), epsilon)));
+            converged = _mm_and_ps(converged,
+                _mm_and_ps(_mm_cmplt_ps(_mm_mul_ps(dYG, dYG), epsilon), _mm_cmplt_ps(_mm_mul_ps(dYB, dYB), epsilon)));
+            done = _mm_or_ps(done, converged);
+        }
+
+        // Quantize the endpoints and sort them for 4 step mode
+        __m128 invR = _mm_set1_ps(bUniform ? 1.0f : g_LuminanceInv.r);
+        __m128 invG = _mm_set1_ps(bUniform ? 1.0f : g_LuminanceInv.g);
+        __m128 invB = _mm_set1_ps(bUniform ? 1.0f : g_LuminanceInv.b);
+        __m128i wColorA = Encode565x4(_mm_mul_ps(XR, invR), _mm_mul_ps(XG, invG), _mm_mul_ps(XB, invB));
+        __m128i wColorB = Encode565x4(_mm_mul_ps(YR, invR), _mm_mul_ps(YG, invG), _mm_mul_ps(YB, invB));
+
+        __m128i swap = _mm_cmpgt_epi32(wColorB, wColorA);
+        __m128i same = _mm_cmpeq_epi32(wColorA, wColorB);
+        __m128i wColor0 = _mm_or_si128(_mm_and_si128(swap, wColorB), _mm_andnot_si128(swap, wColorA));
+        __m128i wColor1 = _mm_or_si128(_mm_and_si128(swap, wColorA), _mm_andnot_si128(swap, wColorB));
+
+        __m128 Step0R, Step0G, Step0B, Step1R, Step1G, Step1B;
+        Decode565x4(wColor0, Step0R, Step0G, Step0B);
+        Decode565x4(wColor1, Step1R, Step1G, Step1B);
+        Step0R = _mm_mul_ps(Step0R, wR);
+        Step0G = _mm_mul_ps(Step0G, wG);
+        Step0B = _mm_mul_ps(Step0B, wB);
+        Step1R = _mm_mul_ps(Step1R, wR);
+        Step1G = _mm_mul_ps(Step1G, wG);
+        Step1B = _mm_mul_ps(Step1B, wB);
+
+        // Calculate color direction
+        DirR = _mm_sub_ps(Step1R, Step0R);
+        DirG = _mm_sub_ps(Step1G, Step0G);
+        DirB = _mm_sub_ps(Step1B, Step0B);
+        __m128 fScale = _mm_div_ps(fSteps, Dot3x4(DirR, DirG, DirB, DirR, DirG, DirB));
+        DirR = _mm_mul_ps(DirR, fScale);
+        DirG = _mm_mul_ps(DirG, fScale);
+        DirB = _mm_mul_ps(DirB, fScale);
+
+        // Encode colors. Steps 0, 1, 2, 3 along the axis are the indices 0, 2, 3, 1,
+        // which is ((iStep + 1) & 3) with the lowest bit flipped for steps 0 and 3.
+        __m128i dw = _mm_setzero_si128();
+        for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+        {
+            __m128 fDot = Dot3x4(_mm_sub_ps(R[i], Step0R), _mm_sub_ps(G[i], Step0G), _mm_sub_ps(B[i], Step0B), DirR, DirG, DirB);
+            __m128i iStep = RoundStep4(fDot, fSteps);
+
+            __m128i iIndex = _mm_and_si128(_mm_add_epi32(iStep, _mm_set1_epi32(1)), _mm_set1_epi32(3));
+            __m128i outer = _mm_andnot_si128(_mm_xor_si128(iStep, _mm_srli_epi32(iStep, 1)), _mm_set1_epi32(1));
+            iIndex = _mm_xor_si128(iIndex, outer);
+
+            dw = _mm_or_si128(dw, _mm_sll_epi32(iIndex, _mm_cvtsi32_si128(static_cast<int>(i * 2))));
+        }
+        dw = _mm_andnot_si128(same, dw);
+
+        uint32_t rgb0[4], rgb1[4], bitmap[4];
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(rgb0), wColor0);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(rgb1), wColor1);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(bitmap), dw);
+
+        uint32_t skipped = static_cast<uint32_t>(_mm_movemask_ps(colorKey));
+        for (size_t iBlock = 0; iBlock < 4; ++iBlock)
+        {
+            if (skipped & (1u << iBlock))
+                continue;
+
+            ppBC[iBlock]->rgb[0] = static_cast<uint16_t>(rgb0[iBlock]);
+            ppBC[iBlock]->rgb[1] = static_cast<uint16_t>(rgb1[iBlock]);
+            ppBC[iBlock]->bitmap = bitmap[iBlock];
+        }
+
+        return skipped;
+    }
+#endif // _XM_SSE_INTRINSICS_
 }
 
 
@@ -734,6 +1242,13 @@ void DirectX::D3DXDecodeBC1(XMVECTOR *pColor, const uint8_t *pBC)
     DecodeBC1(pColor, pBC1, true);
 }
 
+_Use_decl_annotations_
+void DirectX::D3DXDecodeBC1Palette(XMVECTOR *pPalette, const uint8_t *pBC, bool isbc1)
+{
+    auto pBC1 = reinterpret_cast<const D3DX_BC1 *>(pBC);
+    DecodeBC1Palette(pPalette, pBC1, isbc1);
+}
+
 _Use_decl_annotations_
 void DirectX::D3DXEncodeBC1(uint8_t *pBC, const XMVECTOR *pColor, float threshold, DWORD flags)
 {
@@ -794,6 +1309,29 @@ void DirectX::D3DXEncodeBC1(uint8_t *pBC, const XMVECTOR *pColor, float threshol
     EncodeBC1(pBC1, Color, true, threshold, flags);
 }
 
+_Use_decl_annotations_
+void DirectX::D3DXEncodeBC1x4(uint8_t *pBC, const XMVECTOR *pColor, float threshold, DWORD flags)
+{
+    assert(pBC && pColor);
+
+    uint32_t skipped = 0xf;
+
+#if defined(_XM_SSE_INTRINSICS_) && !defined(_XM_NO_INTRINSICS_)
+    if (!(flags & (BC_FLAGS_DITHER_RGB | BC_FLAGS_DITHER_A)))
+    {
+        auto pBC1 = reinterpret_cast<D3DX_BC1 *>(pBC);
+        D3DX_BC1 *ppBC[4] = { pBC1, pBC1 + 1, pBC1 + 2, pBC1 + 3 };
+        skipped = EncodeBC1x4(ppBC, pColor, true, threshold, flags);
+    }
+#endif
+
+    for (size_t iBlock = 0; iBlock < 4; ++iBlock)
+    {
+        if (skipped & (1u << iBlock))
+            D3DXEncodeBC1(pBC + iBlock * 8, pColor + iBlock * NUM_PIXELS_PER_BLOCK, threshold, flags);
+    }
+}
+
 
 //-------------------------------------------------------------------------------------
 // BC2 Compression
@@ -898,6 +1436,29 @@ void DirectX::D3DXEncodeBC2(uint8_t *pBC, const XMVECTOR *pColor, DWORD flags)
 //-------------------------------------------------------------------------------------
 // BC3 Compression
 //-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+void DirectX::D3DXDecodeBC3AlphaPalette(float *pAlpha, const uint8_t *pBC)
+{
+    assert(pAlpha && pBC);
+
+    pAlpha[0] = static_cast<float>(pBC[0]) * (1.0f / 255.0f);
+    pAlpha[1] = static_cast<float>(pBC[1]) * (1.0f / 255.0f);
+
+    if (pBC[0] > pBC[1])
+    {
+        for (size_t i = 1; i < 7; ++i)
+            pAlpha[i + 1] = (pAlpha[0] * (7 - i) + pAlpha[1] * i) * (1.0f / 7.0f);
+    }
+    else
+    {
+        for (size_t i = 1; i < 5; ++i)
+            pAlpha[i + 1] = (pAlpha[0] * (5 - i) + pAlpha[1] * i) * (1.0f / 5.0f);
+
+        pAlpha[6] = 0.0f;
+        pAlpha[7] = 1.0f;
+    }
+}
+
 _Use_decl_annotations_
 void DirectX::D3DXDecodeBC3(XMVECTOR *pColor, const uint8_t *pBC)
 {
@@ -911,23 +1472,7 @@ void DirectX::D3DXDecodeBC3(XMVECTOR *pColor, const uint8_t *pBC)
 
     // Adaptive 3-bit alpha part
     float fAlpha[8];
-
-    fAlpha[0] = static_cast<float>(pBC3->alpha[0]) * (1.0f / 255.0f);
-    fAlpha[1] = static_cast<float>(pBC3->alpha[1]) * (1.0f / 255.0f);
-
-    if (pBC3->alpha[0] > pBC3->alpha[1])
-    {
-        for (size_t i = 1; i < 7; ++i)
-            fAlpha[i + 1] = (fAlpha[0] * (7 - i) + fAlpha[1] * i) * (1.0f / 7.0f);
-    }
-    else
-    {
-        for (size_t i = 1; i < 5; ++i)
-            fAlpha[i + 1] = (fAlpha[0] * (5 - i) + fAlpha[1] * i) * (1.0f / 5.0f);
-
-        fAlpha[6] = 0.0f;
-        fAlpha[7] = 1.0f;
-    }
+    D3DXDecodeBC3AlphaPalette(fAlpha, pBC);
 
     DWORD dw = pBC3->bitmap[0] | (pBC3->bitmap[1] << 8) | (pBC3->bitmap[2] << 16);
 
@@ -954,188 +1499,44 @@ void DirectX::D3DXEncodeBC3(uint8_t *pBC, const XMVECTOR *pColor, DWORD flags)
 
     auto pBC3 = reinterpret_cast<D3DX_BC3 *>(pBC);
 
-    // Quantize block to A8, using Floyd Stienberg error diffusion.  This 
-    // increases the chance that colors will map directly to the quantized 
-    // axis endpoints.
-    float fAlpha[NUM_PIXELS_PER_BLOCK] = {};
-    float fError[NUM_PIXELS_PER_BLOCK] = {};
-
-    float fMinAlpha = Color[0].a;
-    float fMaxAlpha = Color[0].a;
+    // Alpha part
+    EncodeBC3Alpha(pBC3, Color, flags);
 
-    for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
-    {
-        float fAlph = Color[i].a;
-        if (flags & BC_FLAGS_DITHER_A)
-            fAlph += fError[i];
+    // RGB part
+    EncodeBC1(&pBC3->bc1, Color, false, 0.f, flags);
+}
 
-        fAlpha[i] = static_cast<int32_t>(fAlph * 255.0f + 0.5f) * (1.0f / 255.0f);
+_Use_decl_annotations_
+void DirectX::D3DXEncodeBC3x4(uint8_t *pBC, const XMVECTOR *pColor, DWORD flags)
+{
+    assert(pBC && pColor);
 
-        if (fAlpha[i] < fMinAlpha)
-            fMinAlpha = fAlpha[i];
-        else if (fAlpha[i] > fMaxAlpha)
-            fMaxAlpha = fAlpha[i];
+#if defined(_XM_SSE_INTRINSICS_) && !defined(_XM_NO_INTRINSICS_)
+    if (!(flags & BC_FLAGS_DITHER_RGB))
+    {
+        auto pBC3 = reinterpret_cast<D3DX_BC3 *>(pBC);
 
-        if (flags & BC_FLAGS_DITHER_A)
+        // Alpha part, per block
+        for (size_t iBlock = 0; iBlock < 4; ++iBlock)
         {
-            float fDiff = fAlph - fAlpha[i];
-
-            if (3 != (i & 3))
+            HDRColorA Color[NUM_PIXELS_PER_BLOCK];
+            for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
             {
-                assert(i < 15);
-                _Analysis_assume_(i < 15);
-                fError[i + 1] += fDiff * (7.0f / 16.0f);
+                XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&Color[i]), pColor[iBlock * NUM_PIXELS_PER_BLOCK + i]);
             }
 
-            if (i < 12)
-            {
-                if (i & 3)
-                    fError[i + 3] += fDiff * (3.0f / 16.0f);
-
-                fError[i + 4] += fDiff * (5.0f / 16.0f);
-
-                if (3 != (i & 3))
-                {
-                    assert(i < 11);
-                    _Analysis_assume_(i < 11);
-                    fError[i + 5] += fDiff * (1.0f / 16.0f);
-                }
-            }
+            EncodeBC3Alpha(&pBC3[iBlock], Color, flags);
         }
-    }
-
-#ifdef COLOR_WEIGHTS
-    if (0.0f == fMaxAlpha)
-    {
-        EncodeSolidBC1(&pBC3->dxt1, Color);
-        pBC3->alpha[0] = 0x00;
-        pBC3->alpha[1] = 0x00;
-        memset(pBC3->bitmap, 0x00, 6);
-    }
-#endif
-
-    // RGB part
-    EncodeBC1(&pBC3->bc1, Color, false, 0.f, flags);
-
-    // Alpha part
-    if (1.0f == fMinAlpha)
-    {
-        pBC3->alpha[0] = 0xff;
-        pBC3->alpha[1] = 0xff;
-        memset(pBC3->bitmap, 0x00, 6);
-        return;
-    }
 
-    // Optimize and Quantize Min and Max values
-    uint32_t uSteps = ((0.0f == fMinAlpha) || (1.0f == fMaxAlpha)) ? 6 : 8;
-
-    float fAlphaA, fAlphaB;
-    OptimizeAlpha<false>(&fAlphaA, &fAlphaB, fAlpha, uSteps);
-
-    auto bAlphaA = static_cast<uint8_t>(static_cast<int32_t>(fAlphaA * 255.0f + 0.5f));
-    auto bAlphaB = static_cast<uint8_t>(static_cast<int32_t>(fAlphaB * 255.0f + 0.5f));
-
-    fAlphaA = static_cast<float>(bAlphaA) * (1.0f / 255.0f);
-    fAlphaB = static_cast<float>(bAlphaB) * (1.0f / 255.0f);
-
-    // Setup block
-    if ((8 == uSteps) && (bAlphaA == bAlphaB))
-    {
-        pBC3->alpha[0] = bAlphaA;
-        pBC3->alpha[1] = bAlphaB;
-        memset(pBC3->bitmap, 0x00, 6);
+        // RGB part
+        D3DX_BC1 *ppBC[4] = { &pBC3[0].bc1, &pBC3[1].bc1, &pBC3[2].bc1, &pBC3[3].bc1 };
+        EncodeBC1x4(ppBC, pColor, false, 0.f, flags);
         return;
     }
+#endif
 
-    static const size_t pSteps6[] = { 0, 2, 3, 4, 5, 1 };
-    static const size_t pSteps8[] = { 0, 2, 3, 4, 5, 6, 7, 1 };
-
-    const size_t *pSteps;
-    float fStep[8] = {};
-
-    if (6 == uSteps)
-    {
-        pBC3->alpha[0] = bAlphaA;
-        pBC3->alpha[1] = bAlphaB;
-
-        fStep[0] = fAlphaA;
-        fStep[1] = fAlphaB;
-
-        for (size_t i = 1; i < 5; ++i)
-            fStep[i + 1] = (fStep[0] * (5 - i) + fStep[1] * i) * (1.0f / 5.0f);
-
-        fStep[6] = 0.0f;
-        fStep[7] = 1.0f;
-
-        pSteps = pSteps6;
-    }
-    else
-    {
-        pBC3->alpha[0] = bAlphaB;
-        pBC3->alpha[1] = bAlphaA;
-
-        fStep[0] = fAlphaB;
-        fStep[1] = fAlphaA;
-
-        for (size_t i = 1; i < 7; ++i)
-            fStep[i + 1] = (fStep[0] * (7 - i) + fStep[1] * i) * (1.0f / 7.0f);
-
-        pSteps = pSteps8;
-    }
-
-    // Encode alpha bitmap
-    auto fSteps = static_cast<float>(uSteps - 1);
-    float fScale = (fStep[0] != fStep[1]) ? (fSteps / (fStep[1] - fStep[0])) : 0.0f;
-
-    if (flags & BC_FLAGS_DITHER_A)
-        memset(fError, 0x00, NUM_PIXELS_PER_BLOCK * sizeof(float));
-
-    for (size_t iSet = 0; iSet < 2; iSet++)
+    for (size_t iBlock = 0; iBlock < 4; ++iBlock)
     {
-        uint32_t dw = 0;
-
-        size_t iMin = iSet * 8;
-        size_t iLim = iMin + 8;
-
-        for (size_t i = iMin; i < iLim; ++i)
-        {
-            float fAlph = Color[i].a;
-            if (flags & BC_FLAGS_DITHER_A)
-                fAlph += fError[i];
-            float fDot = (fAlph - fStep[0]) * fScale;
-
-            uint32_t iStep;
-            if (fDot <= 0.0f)
-                iStep = ((6 == uSteps) && (fAlph <= fStep[0] * 0.5f)) ? 6 : 0;
-            else if (fDot >= fSteps)
-                iStep = ((6 == uSteps) && (fAlph >= (fStep[1] + 1.0f) * 0.5f)) ? 7 : 1;
-            else
-                iStep = uint32_t(pSteps[uint32_t(fDot + 0.5f)]);
-
-            dw = (iStep << 21) | (dw >> 3);
-
-            if (flags & BC_FLAGS_DITHER_A)
-            {
-                float fDiff = (fAlph - fStep[iStep]);
-
-                if (3 != (i & 3))
-                    fError[i + 1] += fDiff * (7.0f / 16.0f);
-
-                if (i < 12)
-                {
-                    if (i & 3)
-                        fError[i + 3] += fDiff * (3.0f / 16.0f);
-
-                    fError[i + 4] += fDiff * (5.0f / 16.0f);
-
-                    if (3 != (i & 3))
-                        fError[i + 5] += fDiff * (1.0f / 16.0f);
-                }
-            }
-        }
-
-        pBC3->bitmap[0 + iSet * 3] = reinterpret_cast<uint8_t *>(&dw)[0];
-        pBC3->bitmap[1 + iSet * 3] = reinterpret_cast<uint8_t *>(&dw)[1];
-        pBC3->bitmap[2 + iSet * 3] = reinterpret_cast<uint8_t *>(&dw)[2];
+        D3DXEncodeBC3(pBC + iBlock * 16, pColor + iBlock * NUM_PIXELS_PER_BLOCK, flags);
     }
 }
@@ -36,6 +36,10 @@ enum BC_FLAGS
     BC_FLAGS_UNIFORM            = 0x40000,  // By default, uses perceptual weighting for BC1-3; this flag makes it a uniform weighting
     BC_FLAGS_USE_3SUBSETS       = 0x80000,  // By default, BC7 skips mode 0 & 2; this flag adds those modes back
     BC_FLAGS_FORCE_BC7_MODE6    = 0x100000, // BC7 should only use mode 6; skip other modes
+    BC_FLAGS_SIMD               = 0x200000, // Use the multi-block SIMD encoder for BC1 & BC3
+    BC_FLAGS_BC7_FAST           = 0x400000, // BC7 fast profile levels 1-3, screens partitions with a SIMD estimate and stops early
+    BC_FLAGS_BC7_FASTER         = 0x800000,
+    BC_FLAGS_BC7_FASTEST        = 0xC00000,
 };
 
 //-------------------------------------------------------------------------------------
@@ -309,6 +313,13 @@ void D3DXDecodeBC6HU(_Out_writes_(NUM_PIXELS_PER_BLOCK) XMVECTOR *pColor, _In_re
 void D3DXDecodeBC6HS(_Out_writes_(NUM_PIXELS_PER_BLOCK) XMVECTOR *pColor, _In_reads_(16) const uint8_t *pBC);
 void D3DXDecodeBC7(_Out_writes_(NUM_PIXELS_PER_BLOCK) XMVECTOR *pColor, _In_reads_(16) const uint8_t *pBC);
 
+void D3DXDecodeBC1Palette(_Out_writes_(4) XMVECTOR *pPalette, _In_reads_(8) const uint8_t *pBC, _In_ bool isbc1);
+void D3DXDecodeBC3AlphaPalette(_Out_writes_(8) float *pAlpha, _In_reads_(8) const uint8_t *pBC);
+void D3DXDecodeBC4UPalette(_Out_writes_(8) float *pRed, _In_reads_(8) const uint8_t *pBC);
+void D3DXDecodeBC4SPalette(_Out_writes_(8) float *pRed, _In_reads_(8) const uint8_t *pBC);
+    // The values the indices of a block select from, as the decoders above use them. BC1 indices are 2 bits from
+    // byte 4 (isbc1 is false for the color part of BC2/BC3), BC3 alpha and BC4 indices are 3 bits from byte 2.
+
 void D3DXEncodeBC1(_Out_writes_(8) uint8_t *pBC, _In_reads_(NUM_PIXELS_PER_BLOCK) const XMVECTOR *pColor, _In_ float threshold, _In_ DWORD flags);
     // BC1 requires one additional parameter, so it doesn't match signature of BC_ENCODE above
 
@@ -322,4 +333,10 @@ void D3DXEncodeBC6HU(_Out_writes_(16) uint8_t *pBC, _In_reads_(NUM_PIXELS_PER_BL
 void D3DXEncodeBC6HS(_Out_writes_(16) uint8_t *pBC, _In_reads_(NUM_PIXELS_PER_BLOCK) const XMVECTOR *pColor, _In_ DWORD flags);
 void D3DXEncodeBC7(_Out_writes_(16) uint8_t *pBC, _In_reads_(NUM_PIXELS_PER_BLOCK) const XMVECTOR *pColor, _In_ DWORD flags);
 
+void D3DXEncodeBC1x4(_Out_writes_(32) uint8_t *pBC, _In_reads_(NUM_PIXELS_PER_BLOCK * 4) const XMVECTOR *pColor, _In_ float threshold, _In_ DWORD flags);
+void D3DXEncodeBC3x4(_Out_writes_(64) uint8_t *pBC, _In_reads_(NUM_PIXELS_PER_BLOCK * 4) const XMVECTOR *pColor, _In_ DWORD flags);
+    // Encode 4 blocks at once, one per SIMD lane. pColor holds the pixels of the blocks one after the other and
+    // the encoded blocks are written consecutively to pBC. Blocks which need dithering or BC1's 3 color mode use
+    // the per-block encoder.
+
 } // namespace
@@ -415,6 +415,32 @@ void DirectX::D3DXDecodeBC4S(XMVECTOR *pColor, const uint8_t *pBC)
     }
 }
 
+_Use_decl_annotations_
+void DirectX::D3DXDecodeBC4UPalette(float *pRed, const uint8_t *pBC)
+{
+    assert(pRed && pBC);
+
+    auto pBC4 = reinterpret_cast<const BC4_UNORM*>(pBC);
+
+    for (size_t i = 0; i < 8; ++i)
+    {
+        pRed[i] = pBC4->DecodeFromIndex(i);
+    }
+}
+
+_Use_decl_annotations_
+void DirectX::D3DXDecodeBC4SPalette(float *pRed, const uint8_t *pBC)
+{
+    assert(pRed && pBC);
+
+    auto pBC4 = reinterpret_cast<const BC4_SNORM*>(pBC);
+
+    for (size_t i = 0; i < 8; ++i)
+    {
+        pRed[i] = pBC4->DecodeFromIndex(i);
+    }
+}
+
 _Use_decl_annotations_
 void DirectX::D3DXEncodeBC4U(uint8_t *pBC, const XMVECTOR *pColor, DWORD flags)
 {
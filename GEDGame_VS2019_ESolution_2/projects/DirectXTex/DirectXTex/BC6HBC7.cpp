@@ -327,6 +327,28 @@ namespace
     const int g_aWeights2[] = { 0, 21, 43, 64 };
     const int g_aWeights3[] = { 0, 9, 18, 27, 37, 46, 55, 64 };
     const int g_aWeights4[] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    // BC7 search profiles, level 0 is the default search and 1-3 are the TEX_COMPRESS_BC7_FAST* levels
+    struct BC7Profile
+    {
+        uint8_t aModeOrder[8];      // the fast levels try mode 6 first, so more blocks stop early
+        uint8_t uModesOpaque;       // mask of the modes tried for opaque blocks
+        uint8_t uModesAlpha;        // mask of the modes tried for blocks with alpha
+        size_t uScreenShapes;       // partitions kept after the SIMD estimate for RoughMSE
+        size_t uRefineShapes;       // partitions refined, 0 refines a quarter of them
+        bool bAllRotations;         // try all channel rotations of modes 4 & 5
+        bool bAllIndexModes;        // try both index modes of mode 4
+        int iExhaustiveDelta;       // range of the final exhaustive endpoint search, 0 skips it
+        float fGoodEnoughErr;       // stop searching once the block error (sum of squared 8 bit differences) is at most this
+    };
+
+    const BC7Profile g_aBC7Profiles[] =
+    {
+        { { 0, 1, 2, 3, 4, 5, 6, 7 }, 0xFF, 0xFF, BC7_MAX_SHAPES, 0, true, true, 5, 0.0f },
+        { { 6, 1, 3, 5, 4, 7, 0, 2 }, 0xFF, 0xFF, 16, 4, true, true, 3, 8.0f },
+        { { 6, 1, 3, 5, 4, 7, 0, 2 }, 0x7B, 0xF0, 8, 2, true, false, 1, 32.0f },
+        { { 6, 1, 3, 5, 4, 7, 0, 2 }, 0x42, 0xE0, 4, 1, false, false, 0, 256.0f },
+    };
 }
 
 namespace DirectX
@@ -785,8 +807,9 @@ namespace
             LDREndPntPair aEndPts[BC7_MAX_SHAPES][BC7_MAX_REGIONS];
             LDRColorA aLDRPixels[NUM_PIXELS_PER_BLOCK];
             const HDRColorA* const aHDRPixels;
+            size_t uLevel;
 
-            EncodeParams(const HDRColorA* const aOriginal) : uMode(0), aEndPts{}, aLDRPixels{}, aHDRPixels(aOriginal) {}
+            EncodeParams(const HDRColorA* const aOriginal) : uMode(0), aEndPts{}, aLDRPixels{}, aHDRPixels(aOriginal), uLevel(0) {}
         };
 #pragma warning(pop)
 
@@ -854,6 +877,7 @@ namespace
         float MapColors(_In_ const EncodeParams* pEP, _In_reads_(np) const LDRColorA aColors[], _In_ size_t np, _In_ size_t uIndexMode,
             _In_ const LDREndPntPair& endPts, _In_ float fMinErr) const;
         static float RoughMSE(_Inout_ EncodeParams* pEP, _In_ size_t uShape, _In_ size_t uIndexMode);
+        static void EstimateShapes(_In_ const EncodeParams* pEP, _Out_writes_(BC7_MAX_SHAPES) float afErr[]);
 
     private:
         static const ModeInfo ms_aInfo[];
@@ -1623,6 +1647,179 @@ namespace
         return fTotalErr;
     }
 
+#if defined(_XM_SSE_INTRINSICS_) && !defined(_XM_NO_INTRINSICS_)
+    // ComputeError for 4 pixels at a time, which are compared with all palette entries instead of stopping at the
+    // first one which gets worse. Returns FLT_MAX as soon as the total error is above fMinErr.
+    float ComputeErrorx4(
+        _In_reads_(np) const LDRColorA aColors[],
+        _In_ size_t np,
+        _In_reads_(1 << uIndexPrec) const LDRColorA aPalette[],
+        uint8_t uIndexPrec,
+        uint8_t uIndexPrec2,
+        float fMinErr)
+    {
+        const size_t uNumIndices = size_t(1) << uIndexPrec;
+        const size_t uNumIndices2 = size_t(1) << uIndexPrec2;
+        const __m128i mask = _mm_set1_epi32(0xFF);
+        float fTotalErr = 0;
+
+        for (size_t i = 0; i < np; i += 4)
+        {
+            // The missing pixels of the last group repeat the first one and are not added
+            uint32_t aPixels[4];
+            const size_t uCount = std::min<size_t>(4, np - i);
+            memcpy(aPixels, &aColors[i], uCount * sizeof(uint32_t));
+            for (size_t j = uCount; j < 4; ++j)
+                aPixels[j] = aPixels[0];
+
+            const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aPixels));
+            const __m128 r = _mm_cvtepi32_ps(_mm_and_si128(pixels, mask));
+            const __m128 g = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(pixels, 8), mask));
+            const __m128 b = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(pixels, 16), mask));
+            const __m128 a = _mm_cvtepi32_ps(_mm_srli_epi32(pixels, 24));
+
+            __m128 best = _mm_set1_ps(FLT_MAX);
+            for (size_t k = 0; k < uNumIndices; ++k)
+            {
+                const __m128 dr = _mm_sub_ps(r, _mm_set1_ps(aPalette[k].r));
+                const __m128 dg = _mm_sub_ps(g, _mm_set1_ps(aPalette[k].g));
+                const __m128 db = _mm_sub_ps(b, _mm_set1_ps(aPalette[k].b));
+                __m128 err = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg)), _mm_mul_ps(db, db));
+                if (uIndexPrec2 == 0)
+                {
+                    const __m128 da = _mm_sub_ps(a, _mm_set1_ps(aPalette[k].a));
+                    err = _mm_add_ps(err, _mm_mul_ps(da, da));
+                }
+                best = _mm_min_ps(best, err);
+            }
+
+            if (uIndexPrec2 != 0)
+            {
+                __m128 bestA = _mm_set1_ps(FLT_MAX);
+                for (size_t k = 0; k < uNumIndices2; ++k)
+                {
+                    const __m128 da = _mm_sub_ps(a, _mm_set1_ps(aPalette[k].a));
+                    bestA = _mm_min_ps(bestA, _mm_mul_ps(da, da));
+                }
+                best = _mm_add_ps(best, bestA);
+            }
+
+            float afErr[4];
+            _mm_storeu_ps(afErr, best);
+            for (size_t j = 0; j < uCount; ++j)
+                fTotalErr += afErr[j];
+
+            if (fTotalErr > fMinErr)
+                return FLT_MAX;
+        }
+
+        return fTotalErr;
+    }
+#endif
+
+    // Weights of the pixels in the subsets of 4 partitions at a time, for the SIMD partition estimate
+    struct BC7ShapeWeights
+    {
+        XMVECTOR aWeights[BC7_MAX_REGIONS - 1][BC7_MAX_REGIONS - 1][BC7_MAX_SHAPES / 4][NUM_PIXELS_PER_BLOCK];
+
+        BC7ShapeWeights()
+        {
+            for (size_t uPartitions = 1; uPartitions < BC7_MAX_REGIONS; ++uPartitions)
+                for (size_t p = 0; p < uPartitions; ++p)
+                    for (size_t s = 0; s < BC7_MAX_SHAPES; s += 4)
+                        for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+                        {
+                            aWeights[uPartitions - 1][p][s / 4][i] = XMVectorSet(
+                                (g_aPartitionTable[uPartitions][s][i] == p) ? 1.0f : 0.0f,
+                                (g_aPartitionTable[uPartitions][s + 1][i] == p) ? 1.0f : 0.0f,
+                                (g_aPartitionTable[uPartitions][s + 2][i] == p) ? 1.0f : 0.0f,
+                                (g_aPartitionTable[uPartitions][s + 3][i] == p) ? 1.0f : 0.0f);
+                        }
+        }
+    };
+
+    // Bubble up the uItems shapes with the lowest errors
+    void SortShapes(
+        _Inout_updates_all_(uShapes) float afErr[],
+        _Inout_updates_all_(uShapes) size_t auShape[],
+        size_t uShapes,
+        size_t uItems)
+    {
+        for (size_t i = 0; i < uItems; i++)
+        {
+            for (size_t j = i + 1; j < uShapes; j++)
+            {
+                if (afErr[i] > afErr[j])
+                {
+                    std::swap(afErr[i], afErr[j]);
+                    std::swap(auShape[i], auShape[j]);
+                }
+            }
+        }
+    }
+
+    // The error of the best line through a subset's pixels, for 4 partitions at a time. The sums are
+    // the pixel count, the 4 channels and the 10 products of 2 channels: rr gg bb aa rg rb ra gb ga ba
+    XMVECTOR EstimateLineError(_In_reads_(15) const XMVECTOR* pSums)
+    {
+        const XMVECTOR n = pSums[0];
+        const XMVECTOR r = pSums[1], g = pSums[2], b = pSums[3], a = pSums[4];
+
+        // Covariances times n
+        const XMVECTOR invN = XMVectorReciprocal(XMVectorMax(n, g_XMOne));
+        XMVECTOR crr = XMVectorNegativeMultiplySubtract(XMVectorMultiply(r, r), invN, pSums[5]);
+        XMVECTOR cgg = XMVectorNegativeMultiplySubtract(XMVectorMultiply(g, g), invN, pSums[6]);
+        XMVECTOR cbb = XMVectorNegativeMultiplySubtract(XMVectorMultiply(b, b), invN, pSums[7]);
+        XMVECTOR caa = XMVectorNegativeMultiplySubtract(XMVectorMultiply(a, a), invN, pSums[8]);
+        XMVECTOR crg = XMVectorNegativeMultiplySubtract(XMVectorMultiply(r, g), invN, pSums[9]);
+        XMVECTOR crb = XMVectorNegativeMultiplySubtract(XMVectorMultiply(r, b), invN, pSums[10]);
+        XMVECTOR cra = XMVectorNegativeMultiplySubtract(XMVectorMultiply(r, a), invN, pSums[11]);
+        XMVECTOR cgb = XMVectorNegativeMultiplySubtract(XMVectorMultiply(g, b), invN, pSums[12]);
+        XMVECTOR cga = XMVectorNegativeMultiplySubtract(XMVectorMultiply(g, a), invN, pSums[13]);
+        XMVECTOR cba = XMVectorNegativeMultiplySubtract(XMVectorMultiply(b, a), invN, pSums[14]);
+
+        // The error is the total variance minus the variance along the principal axis, normalized so
+        // the power iterations do not overflow
+        const XMVECTOR trace = XMVectorMax(XMVectorAdd(XMVectorAdd(crr, cgg), XMVectorAdd(cbb, caa)), g_XMZero);
+        const XMVECTOR invTrace = XMVectorReciprocal(XMVectorMax(trace, g_XMEpsilon));
+        crr = XMVectorMultiply(crr, invTrace); cgg = XMVectorMultiply(cgg, invTrace);
+        cbb = XMVectorMultiply(cbb, invTrace); caa = XMVectorMultiply(caa, invTrace);
+        crg = XMVectorMultiply(crg, invTrace); crb = XMVectorMultiply(crb, invTrace);
+        cra = XMVectorMultiply(cra, invTrace); cgb = XMVectorMultiply(cgb, invTrace);
+        cga = XMVectorMultiply(cga, invTrace); cba = XMVectorMultiply(cba, invTrace);
+
+        // Start with the column of the channel with the largest variance
+        XMVECTOR vr = crr, vg = crg, vb = crb, va = cra;
+        XMVECTOR vMax = crr;
+        XMVECTOR select = XMVectorGreater(cgg, vMax);
+        vr = XMVectorSelect(vr, crg, select); vg = XMVectorSelect(vg, cgg, select);
+        vb = XMVectorSelect(vb, cgb, select); va = XMVectorSelect(va, cga, select);
+        vMax = XMVectorMax(vMax, cgg);
+        select = XMVectorGreater(cbb, vMax);
+        vr = XMVectorSelect(vr, crb, select); vg = XMVectorSelect(vg, cgb, select);
+        vb = XMVectorSelect(vb, cbb, select); va = XMVectorSelect(va, cba, select);
+        vMax = XMVectorMax(vMax, cbb);
+        select = XMVectorGreater(caa, vMax);
+        vr = XMVectorSelect(vr, cra, select); vg = XMVectorSelect(vg, cga, select);
+        vb = XMVectorSelect(vb, cba, select); va = XMVectorSelect(va, caa, select);
+
+        XMVECTOR wr = vr, wg = vg, wb = vb, wa = va;
+        for (size_t k = 0; k < 4; ++k)
+        {
+            vr = wr; vg = wg; vb = wb; va = wa;
+            wr = XMVectorMultiplyAdd(crr, vr, XMVectorMultiplyAdd(crg, vg, XMVectorMultiplyAdd(crb, vb, XMVectorMultiply(cra, va))));
+            wg = XMVectorMultiplyAdd(crg, vr, XMVectorMultiplyAdd(cgg, vg, XMVectorMultiplyAdd(cgb, vb, XMVectorMultiply(cga, va))));
+            wb = XMVectorMultiplyAdd(crb, vr, XMVectorMultiplyAdd(cgb, vg, XMVectorMultiplyAdd(cbb, vb, XMVectorMultiply(cba, va))));
+            wa = XMVectorMultiplyAdd(cra, vr, XMVectorMultiplyAdd(cga, vg, XMVectorMultiplyAdd(cba, vb, XMVectorMultiply(caa, va))));
+        }
+
+        // Rayleigh quotient of the last iteration
+        const XMVECTOR vv = XMVectorMultiplyAdd(vr, vr, XMVectorMultiplyAdd(vg, vg, XMVectorMultiplyAdd(vb, vb, XMVectorMultiply(va, va))));
+        const XMVECTOR vw = XMVectorMultiplyAdd(vr, wr, XMVectorMultiplyAdd(vg, wg, XMVectorMultiplyAdd(vb, wb, XMVectorMultiply(va, wa))));
+        const XMVECTOR lambda = XMVectorDivide(vw, XMVectorMax(vv, XMVectorReplicate(FLT_MIN)));
+        return XMVectorMultiply(trace, XMVectorMax(XMVectorSubtract(g_XMOne, lambda), g_XMZero));
+    }
+
 
     void FillWithErrorColors(_Out_writes_(NUM_PIXELS_PER_BLOCK) HDRColorA* pOut)
     {
@@ -2746,8 +2943,20 @@ void D3DX_BC7::Encode(DWORD flags, const HDRColorA* const pIn)
 
     const bool bHasAlpha = (alphaMask != 0xFF);
 
-    for (EP.uMode = 0; EP.uMode < 8 && fMSEBest > 0; ++EP.uMode)
+    EP.uLevel = (flags & BC_FLAGS_BC7_FASTEST) / BC_FLAGS_BC7_FAST;
+    const BC7Profile& profile = g_aBC7Profiles[EP.uLevel];
+    const uint8_t uModes = bHasAlpha ? profile.uModesAlpha : profile.uModesOpaque;
+
+    for (size_t m = 0; m < 8 && fMSEBest > profile.fGoodEnoughErr; ++m)
     {
+        EP.uMode = profile.aModeOrder[m];
+
+        if (!(uModes & (1u << EP.uMode)))
+        {
+            // Mode not used by the fast profile level
+            continue;
+        }
+
         if (!(flags & BC_FLAGS_USE_3SUBSETS) && (EP.uMode == 0 || EP.uMode == 2))
         {
             // 3 subset modes tend to be used rarely and add significant compression time
@@ -2770,15 +2979,16 @@ void D3DX_BC7::Encode(DWORD flags, const HDRColorA* const pIn)
         assert(uShapes <= BC7_MAX_SHAPES);
         _Analysis_assume_(uShapes <= BC7_MAX_SHAPES);
 
-        const size_t uNumRots = size_t(1) << ms_aInfo[EP.uMode].uRotationBits;
-        const size_t uNumIdxMode = size_t(1) << ms_aInfo[EP.uMode].uIndexModeBits;
+        const size_t uNumRots = profile.bAllRotations ? size_t(1) << ms_aInfo[EP.uMode].uRotationBits : 1;
+        const size_t uNumIdxMode = profile.bAllIndexModes ? size_t(1) << ms_aInfo[EP.uMode].uIndexModeBits : 1;
         // Number of rough cases to look at. reasonable values of this are 1, uShapes/4, and uShapes
         // uShapes/4 gets nearly all the cases; you can increase that a bit (say by 3 or 4) if you really want to squeeze the last bit out
-        const size_t uItems = std::max<size_t>(1, uShapes >> 2);
+        const size_t uCandidates = std::min(uShapes, profile.uScreenShapes);
+        const size_t uItems = profile.uRefineShapes ? std::min(uCandidates, profile.uRefineShapes) : std::max<size_t>(1, uShapes >> 2);
         float afRoughMSE[BC7_MAX_SHAPES];
         size_t auShape[BC7_MAX_SHAPES];
 
-        for (size_t r = 0; r < uNumRots && fMSEBest > 0; ++r)
+        for (size_t r = 0; r < uNumRots && fMSEBest > profile.fGoodEnoughErr; ++r)
         {
             switch (r)
             {
@@ -2787,29 +2997,28 @@ void D3DX_BC7::Encode(DWORD flags, const HDRColorA* const pIn)
             case 3: for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; i++) std::swap(EP.aLDRPixels[i].b, EP.aLDRPixels[i].a); break;
             }
 
-            for (size_t im = 0; im < uNumIdxMode && fMSEBest > 0; ++im)
+            for (size_t im = 0; im < uNumIdxMode && fMSEBest > profile.fGoodEnoughErr; ++im)
             {
-                // pick the best uItems shapes and refine these.
                 for (size_t s = 0; s < uShapes; s++)
-                {
-                    afRoughMSE[s] = RoughMSE(&EP, s, im);
                     auShape[s] = s;
-                }
 
-                // Bubble up the first uItems items
-                for (size_t i = 0; i < uItems; i++)
+                if (uCandidates < uShapes)
                 {
-                    for (size_t j = i + 1; j < uShapes; j++)
-                    {
-                        if (afRoughMSE[i] > afRoughMSE[j])
-                        {
-                            std::swap(afRoughMSE[i], afRoughMSE[j]);
-                            std::swap(auShape[i], auShape[j]);
-                        }
-                    }
+                    // Rank the shapes by their SIMD estimate and compute the RoughMSE of the best ones only.
+                    // The estimate ignores quantization, so the mode can not beat a block which is already better.
+                    EstimateShapes(&EP, afRoughMSE);
+                    SortShapes(afRoughMSE, auShape, uShapes, uCandidates);
+                    if (afRoughMSE[0] >= fMSEBest)
+                        continue;
                 }
 
-                for (size_t i = 0; i < uItems && fMSEBest > 0; i++)
+                // pick the best uItems shapes and refine these.
+                for (size_t i = 0; i < uCandidates; i++)
+                    afRoughMSE[i] = RoughMSE(&EP, auShape[i], im);
+
+                SortShapes(afRoughMSE, auShape, uCandidates, uItems);
+
+                for (size_t i = 0; i < uItems && fMSEBest > profile.fGoodEnoughErr; i++)
                 {
                     float fMSE = Refine(&EP, auShape[i], r, im);
                     if (fMSE < fMSEBest)
@@ -2915,7 +3124,9 @@ void D3DX_BC7::Exhaustive(const EncodeParams* pEP, const LDRColorA aColors[], si
     if (fOrgErr == 0)
         return;
 
-    int delta = 5;
+    const int delta = g_aBC7Profiles[pEP->uLevel].iExhaustiveDelta;
+    if (delta == 0)
+        return;
 
     // ok figure out the range of A and B
     tmpEndPt = optEndPt;
@@ -3382,6 +3593,10 @@ float D3DX_BC7::MapColors(const EncodeParams* pEP, const LDRColorA aColors[], si
     float fTotalErr = 0;
 
     GeneratePaletteQuantized(pEP, uIndexMode, endPts, aPalette);
+#if defined(_XM_SSE_INTRINSICS_) && !defined(_XM_NO_INTRINSICS_)
+    if (pEP->uLevel > 0)
+        return ComputeErrorx4(aColors, np, aPalette, uIndexPrec, uIndexPrec2, fMinErr);
+#endif
     for (size_t i = 0; i < np; ++i)
     {
         fTotalErr += ComputeError(aColors[i], aPalette, uIndexPrec, uIndexPrec2);
@@ -3500,6 +3715,76 @@ float D3DX_BC7::RoughMSE(EncodeParams* pEP, size_t uShape, size_t uIndexMode)
     return fTotalErr;
 }
 
+_Use_decl_annotations_
+void D3DX_BC7::EstimateShapes(const EncodeParams* pEP, float afErr[])
+{
+    assert(pEP);
+    const uint8_t uPartitions = ms_aInfo[pEP->uMode].uPartitions;
+    assert(uPartitions > 0 && uPartitions < BC7_MAX_REGIONS);
+    _Analysis_assume_(uPartitions > 0 && uPartitions < BC7_MAX_REGIONS);
+
+    const size_t uShapes = size_t(1) << ms_aInfo[pEP->uMode].uPartitionBits;
+    const bool bAlpha = ms_aInfo[pEP->uMode].RGBAPrec.a > 0;
+
+    static const BC7ShapeWeights s_weights;
+
+    // The pixels relative to the block's mean, which keeps the float sums accurate
+    float afMean[4] = {};
+    for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+        for (size_t ch = 0; ch < BC7_NUM_CHANNELS; ++ch)
+            afMean[ch] += pEP->aLDRPixels[i][ch];
+
+    XMVECTOR aMoments[NUM_PIXELS_PER_BLOCK][15];
+    XMVECTOR aTotal[15];
+    for (size_t k = 0; k < 15; ++k)
+        aTotal[k] = g_XMZero;
+
+    for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+    {
+        const LDRColorA& c = pEP->aLDRPixels[i];
+        const float r = c.r - afMean[0] / NUM_PIXELS_PER_BLOCK;
+        const float g = c.g - afMean[1] / NUM_PIXELS_PER_BLOCK;
+        const float b = c.b - afMean[2] / NUM_PIXELS_PER_BLOCK;
+        const float a = bAlpha ? c.a - afMean[3] / NUM_PIXELS_PER_BLOCK : 0.0f;
+        const float afMoments[15] = { 1.0f, r, g, b, a, r * r, g * g, b * b, a * a, r * g, r * b, r * a, g * b, g * a, b * a };
+        for (size_t k = 0; k < 15; ++k)
+        {
+            aMoments[i][k] = XMVectorReplicate(afMoments[k]);
+            aTotal[k] = XMVectorAdd(aTotal[k], aMoments[i][k]);
+        }
+    }
+
+    for (size_t s = 0; s < uShapes; s += 4)
+    {
+        // The sums of the last subset are what the others leave of the total
+        XMVECTOR aSums[BC7_MAX_REGIONS][15];
+        for (size_t k = 0; k < 15; ++k)
+            aSums[uPartitions][k] = aTotal[k];
+
+        for (size_t p = 0; p < uPartitions; ++p)
+        {
+            for (size_t k = 0; k < 15; ++k)
+                aSums[p][k] = g_XMZero;
+
+            const XMVECTOR* pWeights = s_weights.aWeights[uPartitions - 1][p][s / 4];
+            for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+            {
+                for (size_t k = 0; k < 15; ++k)
+                    aSums[p][k] = XMVectorMultiplyAdd(pWeights[i], aMoments[i][k], aSums[p][k]);
+            }
+
+            for (size_t k = 0; k < 15; ++k)
+                aSums[uPartitions][k] = XMVectorSubtract(aSums[uPartitions][k], aSums[p][k]);
+        }
+
+        XMVECTOR err = g_XMZero;
+        for (size_t p = 0; p <= uPartitions; ++p)
+            err = XMVectorAdd(err, EstimateLineError(aSums[p]));
+
+        XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&afErr[s]), err);
+    }
+}
+
 
 //=====================================================================================
 // Entry points
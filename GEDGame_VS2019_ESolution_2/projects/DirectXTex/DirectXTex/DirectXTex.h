@@ -14,6 +14,7 @@
 #include <stdint.h>
 
 #include <algorithm>
+#include <atomic>
 #include <functional>
 #include <vector>
 
@@ -336,6 +337,46 @@ namespace DirectX
         size_t  m_size;
     };
 
+    //---------------------------------------------------------------------------------
+    // Read-only memory mapped DDS file
+    //  Images point straight into the mapping and are only resolved when requested, so only
+    //  the pages of the subresources which are actually used get read from disk. Their pixels
+    //  must not be written to. Files which need a conversion while loading (legacy formats
+    //  which are expanded or swizzled, DDS_FLAGS_LEGACY_DWORD, DDS_FLAGS_BAD_DXTN_TAILS) fail
+    //  with HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED) and need LoadFromDDSFile instead.
+    class MappedDDS
+    {
+    public:
+        MappedDDS() noexcept
+            : m_view(nullptr), m_size(0), m_offset(0), m_itemSize(0), m_metadata{} {}
+        MappedDDS(MappedDDS&& moveFrom) noexcept
+            : m_view(nullptr), m_size(0), m_offset(0), m_itemSize(0), m_metadata{} { *this = std::move(moveFrom); }
+        ~MappedDDS() { Release(); }
+
+        MappedDDS& __cdecl operator= (MappedDDS&& moveFrom) noexcept;
+
+        MappedDDS(const MappedDDS&) = delete;
+        MappedDDS& operator=(const MappedDDS&) = delete;
+
+        HRESULT __cdecl Open(_In_z_ const wchar_t* szFile, _In_ DWORD flags);
+
+        void __cdecl Release();
+
+        const TexMetadata& __cdecl GetMetadata() const { return m_metadata; }
+        HRESULT __cdecl GetImage(_In_ size_t mip, _In_ size_t item, _In_ size_t slice, _Out_ Image& image) const;
+
+        // All subresources in DDS file order, starting with mip 0 of item 0
+        const uint8_t* __cdecl GetPixels() const { return m_view ? m_view + m_offset : nullptr; }
+        size_t __cdecl GetPixelsSize() const { return m_size - m_offset; }
+
+    private:
+        const uint8_t*  m_view;
+        size_t          m_size;
+        size_t          m_offset;
+        size_t          m_itemSize;
+        TexMetadata     m_metadata;
+    };
+
     //---------------------------------------------------------------------------------
     // Image I/O
 
@@ -419,6 +460,20 @@ namespace DirectX
     //---------------------------------------------------------------------------------
     // Texture conversion, resizing, mipmap generation, and block compression
 
+    struct ParallelOptions
+    {
+        size_t threadCount;
+            // Number of worker threads including the calling thread; 0 uses all hardware threads
+
+        std::function<void __cdecl(size_t done, size_t total)> progress;
+            // Optional; called from the worker threads (one call at a time) as units of work complete
+
+        const std::atomic<bool>* cancel;
+            // Optional; once set, the remaining work is skipped and the operation returns E_ABORT
+
+        ParallelOptions() noexcept : threadCount(0), cancel(nullptr) {}
+    };
+
     enum TEX_FR_FLAGS
     {
         TEX_FR_ROTATE0          = 0x0,
@@ -486,6 +541,9 @@ namespace DirectX
 
         TEX_FILTER_FORCE_WIC        = 0x20000000,
             // Forces use of the WIC path even when logic would have picked a non-WIC path when both are an option
+
+        TEX_FILTER_FORCE_FLOAT      = 0x40000000,
+            // Forces use of the general float conversion path even when a direct format-pair conversion exists
     };
 
     HRESULT __cdecl Resize(
@@ -495,8 +553,15 @@ namespace DirectX
     HRESULT __cdecl Resize(
         _In_reads_(nimages) const Image* srcImages, _In_ size_t nimages, _In_ const TexMetadata& metadata,
         _In_ size_t width, _In_ size_t height, _In_ DWORD filter, _Out_ ScratchImage& result);
+    HRESULT __cdecl Resize(
+        _In_reads_(nimages) const Image* srcImages, _In_ size_t nimages, _In_ const TexMetadata& metadata,
+        _In_ size_t width, _In_ size_t height, _In_ DWORD filter, _In_ const ParallelOptions& options,
+        _Out_ ScratchImage& result);
         // Resize the image to width x height. Defaults to Fant filtering.
         // Note for a complex resize, the result will always have mipLevels == 1
+        // The ParallelOptions version precomputes the weights of each axis and filters tiles of rows and columns
+        // horizontally, then vertically, on a thread pool. It always uses the non-WIC filters (the default picks
+        // box for exact halving and linear otherwise), and its box filter averages the covered area for any ratio
 
     const float TEX_THRESHOLD_DEFAULT = 0.5f;
         // Default value for alpha threshold used when converting to 1-bit alpha
@@ -521,8 +586,15 @@ namespace DirectX
     HRESULT __cdecl GenerateMipMaps(
         _In_reads_(nimages) const Image* srcImages, _In_ size_t nimages, _In_ const TexMetadata& metadata,
         _In_ DWORD filter, _In_ size_t levels, _Inout_ ScratchImage& mipChain);
+    HRESULT __cdecl GenerateMipMaps(
+        _In_reads_(nimages) const Image* srcImages, _In_ size_t nimages, _In_ const TexMetadata& metadata,
+        _In_ DWORD filter, _In_ size_t levels, _In_ const ParallelOptions& options, _Inout_ ScratchImage& mipChain);
         // levels of '0' indicates a full mipchain, otherwise is generates that number of total levels (including the source base image)
         // Defaults to Fant filtering which is equivalent to a box filter
+        // The ParallelOptions version spreads the rows of each level of all array items over a thread pool and
+        // always uses the non-WIC filters. Its box filter for 8-bit RGBA/BGRA and float RGBA formats reduces tiles
+        // by several levels per pass in linear float, so levels after the first can differ in the last bit from
+        // the other versions, which start each level from the stored previous one.
 
     HRESULT __cdecl GenerateMipMaps3D(
         _In_reads_(depth) const Image* baseImages, _In_ size_t depth, _In_ DWORD filter, _In_ size_t levels,
@@ -583,6 +655,15 @@ namespace DirectX
         TEX_COMPRESS_BC7_QUICK          = 0x100000,
             // Minimal modes (usually mode 6) for BC7 compression
 
+        TEX_COMPRESS_SIMD               = 0x200000,
+            // Compresses 4 blocks at once with SIMD for BC1 and BC3; by default encodes one block at a time
+
+        TEX_COMPRESS_BC7_FAST           = 0x400000,
+        TEX_COMPRESS_BC7_FASTER         = 0x800000,
+        TEX_COMPRESS_BC7_FASTEST        = 0xC00000,
+            // Fast profile levels for BC7 compression between the default search and BC7_QUICK; each level
+            // refines fewer partitions and modes and accepts blocks earlier
+
         TEX_COMPRESS_SRGB_IN            = 0x1000000,
         TEX_COMPRESS_SRGB_OUT           = 0x2000000,
         TEX_COMPRESS_SRGB               = (TEX_COMPRESS_SRGB_IN | TEX_COMPRESS_SRGB_OUT),
@@ -599,7 +680,13 @@ namespace DirectX
     HRESULT __cdecl Compress(
         _In_reads_(nimages) const Image* srcImages, _In_ size_t nimages, _In_ const TexMetadata& metadata,
         _In_ DXGI_FORMAT format, _In_ DWORD compress, _In_ float threshold, _Out_ ScratchImage& cImages);
+    HRESULT __cdecl Compress(
+        _In_reads_(nimages) const Image* srcImages, _In_ size_t nimages, _In_ const TexMetadata& metadata,
+        _In_ DXGI_FORMAT format, _In_ DWORD compress, _In_ float threshold, _In_ const ParallelOptions& options,
+        _Out_ ScratchImage& cImages);
         // Note that threshold is only used by BC1. TEX_THRESHOLD_DEFAULT is a typical value to use
+        // The ParallelOptions version schedules the block rows of all mips and array items on a thread pool
+        // and does not need OpenMP; TEX_COMPRESS_PARALLEL is ignored
 
 #if defined(__d3d11_h__) || defined(__d3d11_x_h__)
     HRESULT __cdecl Compress(
@@ -615,6 +702,11 @@ namespace DirectX
     HRESULT __cdecl Decompress(
         _In_reads_(nimages) const Image* cImages, _In_ size_t nimages, _In_ const TexMetadata& metadata,
         _In_ DXGI_FORMAT format, _Out_ ScratchImage& images);
+    HRESULT __cdecl Decompress(
+        _In_reads_(nimages) const Image* cImages, _In_ size_t nimages, _In_ const TexMetadata& metadata,
+        _In_ DXGI_FORMAT format, _In_ const ParallelOptions& options, _Out_ ScratchImage& images);
+        // BC1 - BC5 convert the 4 or 8 entry palette of each block to the output format and then copy
+        // pixels by index, for single channel formats and the common RGBA/RG layouts of the other ones
 
     //---------------------------------------------------------------------------------
     // Normal map operations
@@ -649,6 +741,13 @@ namespace DirectX
     HRESULT __cdecl ComputeNormalMap(
         _In_reads_(nimages) const Image* srcImages, _In_ size_t nimages, _In_ const TexMetadata& metadata,
         _In_ DWORD flags, _In_ float amplitude, _In_ DXGI_FORMAT format, _Out_ ScratchImage& normalMaps);
+    HRESULT __cdecl ComputeNormalMap(
+        _In_reads_(nimages) const Image* srcImages, _In_ size_t nimages, _In_ const TexMetadata& metadata,
+        _In_ DWORD flags, _In_ float amplitude, _In_ DXGI_FORMAT format, _In_ const ParallelOptions& options,
+        _Out_ ScratchImage& normalMaps);
+        // Heights are evaluated once per pixel into rows padded with their wrapped or mirrored neighbors, then
+        // normals are computed four pixels at a time, in bands of rows on the thread pool. Two channel formats
+        // (R8G8_UNORM, R16G16_UNORM) keep X and Y only, the layout BC5 compresses and shaders reconstruct Z from.
 
     //---------------------------------------------------------------------------------
     // Misc image operations
@@ -689,6 +788,30 @@ namespace DirectX
 
     HRESULT __cdecl ComputeMSE(_In_ const Image& image1, _In_ const Image& image2, _Out_ float& mse, _Out_writes_opt_(4) float* mseV, _In_ DWORD flags = 0);
 
+    struct ImageMetrics
+    {
+        float mse;          // Sum of the per channel MSE, as with ComputeMSE
+        float mseV[4];
+        float psnr;         // dB over the RGB channels that are not ignored (alpha if all are); INF for identical images
+        float ssim;         // Mean of ssimV over the same channels as psnr
+        float ssimV[4];
+        float maxError;     // Largest absolute channel difference and the first pixel where it occurs
+        size_t maxErrorX;
+        size_t maxErrorY;
+    };
+
+    HRESULT __cdecl ComputeImageMetrics(
+        _In_ const Image& image1, _In_ const Image& image2, _In_ DWORD flags, _In_ const ParallelOptions& options,
+        _Out_ ImageMetrics& metrics, _Out_opt_ ScratchImage* heatmap = nullptr);
+    HRESULT __cdecl ComputeImageMetrics(
+        _In_reads_(nimages) const Image* images1, _In_reads_(nimages) const Image* images2, _In_ size_t nimages,
+        _In_ const TexMetadata& metadata, _In_ DWORD flags, _In_ const ParallelOptions& options,
+        _Out_writes_(nimages) ImageMetrics* metrics, _Out_opt_ ScratchImage* heatmaps = nullptr);
+        // Takes the same CMSE_FLAGS as ComputeMSE and schedules the rows of all image pairs together on a thread pool.
+        // SSIM is the mean over 8x8 windows at a stride of 4 pixels. Sums are reduced in a fixed order, so results
+        // do not depend on the thread count but can differ from ComputeMSE in the last bits.
+        // The optional heatmaps are R32_FLOAT images of the largest absolute channel error, laid out as metadata.
+
     HRESULT __cdecl EvaluateImage(
         _In_ const Image& image,
         _In_ std::function<void __cdecl(_In_reads_(width) const XMVECTOR* pixels, size_t width, size_t y)> pixelFunc);
@@ -30,7 +30,10 @@ namespace
         static_assert(static_cast<int>(TEX_COMPRESS_UNIFORM) == static_cast<int>(BC_FLAGS_UNIFORM), "TEX_COMPRESS_* flags should match BC_FLAGS_*");
         static_assert(static_cast<int>(TEX_COMPRESS_BC7_USE_3SUBSETS) == static_cast<int>(BC_FLAGS_USE_3SUBSETS), "TEX_COMPRESS_* flags should match BC_FLAGS_*");
         static_assert(static_cast<int>(TEX_COMPRESS_BC7_QUICK) == static_cast<int>(BC_FLAGS_FORCE_BC7_MODE6), "TEX_COMPRESS_* flags should match BC_FLAGS_*");
-        return (compress & (BC_FLAGS_DITHER_RGB | BC_FLAGS_DITHER_A | BC_FLAGS_UNIFORM | BC_FLAGS_USE_3SUBSETS | BC_FLAGS_FORCE_BC7_MODE6));
+        static_assert(static_cast<int>(TEX_COMPRESS_SIMD) == static_cast<int>(BC_FLAGS_SIMD), "TEX_COMPRESS_* flags should match BC_FLAGS_*");
+        static_assert(static_cast<int>(TEX_COMPRESS_BC7_FAST) == static_cast<int>(BC_FLAGS_BC7_FAST), "TEX_COMPRESS_* flags should match BC_FLAGS_*");
+        static_assert(static_cast<int>(TEX_COMPRESS_BC7_FASTEST) == static_cast<int>(BC_FLAGS_BC7_FASTEST), "TEX_COMPRESS_* flags should match BC_FLAGS_*");
+        return (compress & (BC_FLAGS_DITHER_RGB | BC_FLAGS_DITHER_A | BC_FLAGS_UNIFORM | BC_FLAGS_USE_3SUBSETS | BC_FLAGS_FORCE_BC7_MODE6 | BC_FLAGS_SIMD | BC_FLAGS_BC7_FASTEST));
     }
 
     inline DWORD GetSRGBFlags(_In_ DWORD compress)
@@ -65,14 +68,67 @@ namespace
         return true;
     }
 
+    // Number of horizontally adjacent blocks which are encoded together
+    inline size_t GetBlockBatch(_In_ DXGI_FORMAT format, _In_ DWORD bcflags)
+    {
+        if (!(bcflags & BC_FLAGS_SIMD))
+            return 1;
+
+        switch (format)
+        {
+        case DXGI_FORMAT_BC1_UNORM:
+        case DXGI_FORMAT_BC1_UNORM_SRGB:
+        case DXGI_FORMAT_BC3_UNORM:
+        case DXGI_FORMAT_BC3_UNORM_SRGB:
+            return 4;
+
+        default:
+            return 1;
+        }
+    }
+
+    inline void EncodeBlocks(
+        _Out_ uint8_t *pDest,
+        _In_reads_(count * NUM_PIXELS_PER_BLOCK) const XMVECTOR *pColor,
+        size_t count,
+        BC_ENCODE pfEncode,
+        size_t blocksize,
+        DWORD bcflags,
+        float threshold)
+    {
+        if (count == 4)
+        {
+            // Only BC1 and BC3 are batched
+            if (pfEncode)
+            {
+                assert(pfEncode == D3DXEncodeBC3);
+                D3DXEncodeBC3x4(pDest, pColor, bcflags);
+            }
+            else
+                D3DXEncodeBC1x4(pDest, pColor, threshold, bcflags);
+            return;
+        }
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (pfEncode)
+                pfEncode(pDest + i * blocksize, pColor + i * NUM_PIXELS_PER_BLOCK, bcflags);
+            else
+                D3DXEncodeBC1(pDest + i * blocksize, pColor + i * NUM_PIXELS_PER_BLOCK, threshold, bcflags);
+        }
+    }
+
 
     //-------------------------------------------------------------------------------------
+    // Compresses the block rows [blockRowBegin, blockRowEnd) of the image
     HRESULT CompressBC(
         const Image& image,
         const Image& result,
         DWORD bcflags,
         DWORD srgb,
-        float threshold)
+        float threshold,
+        size_t blockRowBegin = 0,
+        size_t blockRowEnd = SIZE_MAX)
     {
         if (!image.pixels || !result.pixels)
             return E_POINTER;
@@ -94,7 +150,7 @@ namespace
         // Round to bytes
         sbpp = (sbpp + 7) / 8;
 
-        uint8_t *pDest = result.pixels;
+        uint8_t *pDest = result.pixels + result.rowPitch * blockRowBegin;
 
         // Determine BC format encoder
         BC_ENCODE pfEncode;
@@ -103,43 +159,49 @@ namespace
         if (!DetermineEncoderSettings(result.format, pfEncode, blocksize, cflags))
             return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
 
-        __declspec(align(16)) XMVECTOR temp[16];
-        const uint8_t *pSrc = image.pixels;
-        const uint8_t *pEnd = image.pixels + image.slicePitch;
+        // With the SIMD encoder, batches of 4 blocks in a row are encoded at once
+        const size_t nBatch = GetBlockBatch(result.format, bcflags);
+
+        __declspec(align(16)) XMVECTOR temp[NUM_PIXELS_PER_BLOCK * 4];
         const size_t rowPitch = image.rowPitch;
-        for (size_t h = 0; h < image.height; h += 4)
+        const uint8_t *pSrc = image.pixels + rowPitch * 4 * blockRowBegin;
+        const uint8_t *pEnd = image.pixels + image.slicePitch;
+        for (size_t h = blockRowBegin * 4, row = blockRowBegin; (h < image.height) && (row < blockRowEnd); h += 4, ++row)
         {
             const uint8_t *sptr = pSrc;
             uint8_t* dptr = pDest;
             size_t ph = std::min<size_t>(4, image.height - h);
             size_t w = 0;
+            size_t batch = 0;
             for (size_t count = 0; (count < result.rowPitch) && (w < image.width); count += blocksize, w += 4)
             {
                 size_t pw = std::min<size_t>(4, image.width - w);
                 assert(pw > 0 && ph > 0);
 
+                XMVECTOR *block = &temp[batch * NUM_PIXELS_PER_BLOCK];
+
                 ptrdiff_t bytesLeft = pEnd - sptr;
                 assert(bytesLeft > 0);
                 size_t bytesToRead = std::min<size_t>(rowPitch, bytesLeft);
-                if (!_LoadScanline(&temp[0], pw, sptr, bytesToRead, format))
+                if (!_LoadScanline(&block[0], pw, sptr, bytesToRead, format))
                     return E_FAIL;
 
                 if (ph > 1)
                 {
                     bytesToRead = std::min<size_t>(rowPitch, bytesLeft - rowPitch);
-                    if (!_LoadScanline(&temp[4], pw, sptr + rowPitch, bytesToRead, format))
+                    if (!_LoadScanline(&block[4], pw, sptr + rowPitch, bytesToRead, format))
                         return E_FAIL;
 
                     if (ph > 2)
                     {
                         bytesToRead = std::min<size_t>(rowPitch, bytesLeft - rowPitch * 2);
-                        if (!_LoadScanline(&temp[8], pw, sptr + rowPitch * 2, bytesToRead, format))
+                        if (!_LoadScanline(&block[8], pw, sptr + rowPitch * 2, bytesToRead, format))
                             return E_FAIL;
 
                         if (ph > 3)
                         {
                             bytesToRead = std::min<size_t>(rowPitch, bytesLeft - rowPitch * 3);
-                            if (!_LoadScanline(&temp[12], pw, sptr + rowPitch * 3, bytesToRead, format))
+                            if (!_LoadScanline(&block[12], pw, sptr + rowPitch * 3, bytesToRead, format))
                                 return E_FAIL;
                         }
                     }
@@ -157,7 +219,7 @@ namespace
                             for (size_t s = pw; s < 4; ++s)
                             {
 #pragma prefast(suppress: 26000, "PREFAST false positive")
-                                temp[(t << 2) | s] = temp[(t << 2) | uSrc[s]];
+                                block[(t << 2) | s] = block[(t << 2) | uSrc[s]];
                             }
                         }
                     }
@@ -169,23 +231,28 @@ namespace
                             for (size_t s = 0; s < 4; ++s)
                             {
 #pragma prefast(suppress: 26000, "PREFAST false positive")
-                                temp[(t << 2) | s] = temp[(uSrc[t] << 2) | s];
+                                block[(t << 2) | s] = block[(uSrc[t] << 2) | s];
                             }
                         }
                     }
                 }
 
-                _ConvertScanline(temp, 16, result.format, format, cflags | srgb);
-
-                if (pfEncode)
-                    pfEncode(dptr, temp, bcflags);
-                else
-                    D3DXEncodeBC1(dptr, temp, threshold, bcflags);
+                _ConvertScanline(block, 16, result.format, format, cflags | srgb);
 
                 sptr += sbpp * 4;
                 dptr += blocksize;
+
+                if (++batch == nBatch)
+                {
+                    EncodeBlocks(dptr - batch * blocksize, temp, batch, pfEncode, blocksize, bcflags, threshold);
+                    batch = 0;
+                }
             }
 
+            // Rest of the row
+            if (batch > 0)
+                EncodeBlocks(dptr - batch * blocksize, temp, batch, pfEncode, blocksize, bcflags, threshold);
+
             pSrc += rowPitch * 4;
             pDest += result.rowPitch;
         }
@@ -232,95 +299,101 @@ namespace
         if (!DetermineEncoderSettings(result.format, pfEncode, blocksize, cflags))
             return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
 
-        // Refactored version of loop to support parallel independance
-        const size_t nBlocks = std::max<size_t>(1, (image.width + 3) / 4) * std::max<size_t>(1, (image.height + 3) / 4);
+        // Refactored version of loop to support parallel independance. With the SIMD encoder,
+        // each iteration handles a batch of 4 blocks in a row.
+        const size_t nbWidth = std::max<size_t>(1, (image.width + 3) / 4);
+        const size_t nBatch = GetBlockBatch(result.format, bcflags);
+        const size_t nBatchesPerRow = (nbWidth + nBatch - 1) / nBatch;
+        const size_t nBatches = nBatchesPerRow * std::max<size_t>(1, (image.height + 3) / 4);
 
         bool fail = false;
 
 #pragma omp parallel for
-        for (int nb = 0; nb < static_cast<int>(nBlocks); ++nb)
+        for (int nbatch = 0; nbatch < static_cast<int>(nBatches); ++nbatch)
         {
-            int nbWidth = std::max<int>(1, int((image.width + 3) / 4));
+            int by = nbatch / int(nBatchesPerRow);
+            int bx = (nbatch - (by*int(nBatchesPerRow))) * int(nBatch);
+            size_t count = std::min<size_t>(nBatch, nbWidth - bx);
 
-            int y = nb / nbWidth;
-            int x = (nb - (y*nbWidth)) * 4;
-            y *= 4;
+            uint8_t *pDest = result.pixels + ((by*nbWidth + bx)*blocksize);
 
-            assert((x >= 0) && (x < int(image.width)));
-            assert((y >= 0) && (y < int(image.height)));
-
-            size_t rowPitch = image.rowPitch;
-            const uint8_t *pSrc = image.pixels + (y*rowPitch) + (x*sbpp);
+            __declspec(align(16)) XMVECTOR temp[NUM_PIXELS_PER_BLOCK * 4];
+            for (size_t j = 0; j < count; ++j)
+            {
+                int x = (bx + int(j)) * 4;
+                int y = by * 4;
 
-            uint8_t *pDest = result.pixels + (nb*blocksize);
+                assert((x >= 0) && (x < int(image.width)));
+                assert((y >= 0) && (y < int(image.height)));
 
-            size_t ph = std::min<size_t>(4, image.height - y);
-            size_t pw = std::min<size_t>(4, image.width - x);
-            assert(pw > 0 && ph > 0);
+                size_t rowPitch = image.rowPitch;
+                const uint8_t *pSrc = image.pixels + (y*rowPitch) + (x*sbpp);
 
-            ptrdiff_t bytesLeft = pEnd - pSrc;
-            assert(bytesLeft > 0);
-            size_t bytesToRead = std::min<size_t>(rowPitch, bytesLeft);
+                size_t ph = std::min<size_t>(4, image.height - y);
+                size_t pw = std::min<size_t>(4, image.width - x);
+                assert(pw > 0 && ph > 0);
 
-            __declspec(align(16)) XMVECTOR temp[16];
-            if (!_LoadScanline(&temp[0], pw, pSrc, bytesToRead, format))
-                fail = true;
+                ptrdiff_t bytesLeft = pEnd - pSrc;
+                assert(bytesLeft > 0);
+                size_t bytesToRead = std::min<size_t>(rowPitch, bytesLeft);
 
-            if (ph > 1)
-            {
-                bytesToRead = std::min<size_t>(rowPitch, bytesLeft - rowPitch);
-                if (!_LoadScanline(&temp[4], pw, pSrc + rowPitch, bytesToRead, format))
+                XMVECTOR *block = &temp[j * NUM_PIXELS_PER_BLOCK];
+                if (!_LoadScanline(&block[0], pw, pSrc, bytesToRead, format))
                     fail = true;
 
-                if (ph > 2)
+                if (ph > 1)
                 {
-                    bytesToRead = std::min<size_t>(rowPitch, bytesLeft - rowPitch * 2);
-                    if (!_LoadScanline(&temp[8], pw, pSrc + rowPitch * 2, bytesToRead, format))
+                    bytesToRead = std::min<size_t>(rowPitch, bytesLeft - rowPitch);
+                    if (!_LoadScanline(&block[4], pw, pSrc + rowPitch, bytesToRead, format))
                         fail = true;
 
-                    if (ph > 3)
+                    if (ph > 2)
                     {
-                        bytesToRead = std::min<size_t>(rowPitch, bytesLeft - rowPitch * 3);
-                        if (!_LoadScanline(&temp[12], pw, pSrc + rowPitch * 3, bytesToRead, format))
+                        bytesToRead = std::min<size_t>(rowPitch, bytesLeft - rowPitch * 2);
+                        if (!_LoadScanline(&block[8], pw, pSrc + rowPitch * 2, bytesToRead, format))
                             fail = true;
+
+                        if (ph > 3)
+                        {
+                            bytesToRead = std::min<size_t>(rowPitch, bytesLeft - rowPitch * 3);
+                            if (!_LoadScanline(&block[12], pw, pSrc + rowPitch * 3, bytesToRead, format))
+                                fail = true;
+                        }
                     }
                 }
-            }
 
-            if (pw != 4 || ph != 4)
-            {
-                // Replicate pixels for partial block
-                static const size_t uSrc[] = { 0, 0, 0, 1 };
-
-                if (pw < 4)
+                if (pw != 4 || ph != 4)
                 {
-                    for (size_t t = 0; t < ph && t < 4; ++t)
+                    // Replicate pixels for partial block
+                    static const size_t uSrc[] = { 0, 0, 0, 1 };
+
+                    if (pw < 4)
                     {
-                        for (size_t s = pw; s < 4; ++s)
+                        for (size_t t = 0; t < ph && t < 4; ++t)
                         {
-                            temp[(t << 2) | s] = temp[(t << 2) | uSrc[s]];
+                            for (size_t s = pw; s < 4; ++s)
+                            {
+                                block[(t << 2) | s] = block[(t << 2) | uSrc[s]];
+                            }
                         }
                     }
-                }
 
-                if (ph < 4)
-                {
-                    for (size_t t = ph; t < 4; ++t)
+                    if (ph < 4)
                     {
-                        for (size_t s = 0; s < 4; ++s)
+                        for (size_t t = ph; t < 4; ++t)
                         {
-                            temp[(t << 2) | s] = temp[(uSrc[t] << 2) | s];
+                            for (size_t s = 0; s < 4; ++s)
+                            {
+                                block[(t << 2) | s] = block[(uSrc[t] << 2) | s];
+                            }
                         }
                     }
                 }
-            }
 
-            _ConvertScanline(temp, 16, result.format, format, cflags | srgb);
+                _ConvertScanline(block, 16, result.format, format, cflags | srgb);
+            }
 
-            if (pfEncode)
-                pfEncode(pDest, temp, bcflags);
-            else
-                D3DXEncodeBC1(pDest, temp, threshold, bcflags);
+            EncodeBlocks(pDest, temp, count, pfEncode, blocksize, bcflags, threshold);
         }
 
         return (fail) ? E_FAIL : S_OK;
@@ -377,7 +450,275 @@ namespace
 
 
     //-------------------------------------------------------------------------------------
-    HRESULT DecompressBC(_In_ const Image& cImage, _In_ const Image& result)
+    // Returns how many leading bytes of an output pixel come from the first palette of a
+    // BC1 - BC5 block: all of them for BC1 and BC4, the bytes before alpha for BC2/BC3 and
+    // before green for BC5. Returns 0 where the output format can't be assembled that way.
+    size_t GetPaletteSplit(_In_ DXGI_FORMAT cformat, _In_ DXGI_FORMAT format, _In_ size_t dbpp)
+    {
+        if (dbpp > 16 || IsPacked(format) || IsVideo(format))
+            return 0;
+
+        switch (cformat)
+        {
+        case DXGI_FORMAT_BC1_UNORM:
+        case DXGI_FORMAT_BC1_UNORM_SRGB:
+        case DXGI_FORMAT_BC4_UNORM:
+        case DXGI_FORMAT_BC4_SNORM:
+            return dbpp;
+
+        case DXGI_FORMAT_BC2_UNORM:
+        case DXGI_FORMAT_BC2_UNORM_SRGB:
+        case DXGI_FORMAT_BC3_UNORM:
+        case DXGI_FORMAT_BC3_UNORM_SRGB:
+            switch (format)
+            {
+            case DXGI_FORMAT_R8G8B8A8_UNORM:
+            case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+            case DXGI_FORMAT_B8G8R8A8_UNORM:
+            case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+            case DXGI_FORMAT_R16G16B16A16_UNORM:
+            case DXGI_FORMAT_R16G16B16A16_FLOAT:
+            case DXGI_FORMAT_R32G32B32A32_FLOAT:
+                return dbpp * 3 / 4;
+
+            default:
+                return 0;
+            }
+
+        case DXGI_FORMAT_BC5_UNORM:
+        case DXGI_FORMAT_BC5_SNORM:
+            switch (format)
+            {
+            case DXGI_FORMAT_R8G8_UNORM:
+            case DXGI_FORMAT_R8G8_SNORM:
+            case DXGI_FORMAT_R16G16_UNORM:
+            case DXGI_FORMAT_R16G16_SNORM:
+            case DXGI_FORMAT_R16G16_FLOAT:
+            case DXGI_FORMAT_R32G32_FLOAT:
+                return dbpp / 2;
+
+            default:
+                return 0;
+            }
+
+        default:
+            return 0;
+        }
+    }
+
+    // 3-bit indices of BC3 alpha and BC4 blocks, 48 bits starting at byte 2
+    inline uint64_t LoadIndices3(_In_reads_(8) const uint8_t* pBC)
+    {
+        uint64_t bits = 0;
+        for (size_t i = 7; i > 1; --i)
+            bits = (bits << 8) | pBC[i];
+        return bits;
+    }
+
+    template<typename T>
+    void StorePaletteBlock(
+        _Out_ uint8_t* pDest, size_t rowPitch, size_t pw, size_t ph, size_t dbpp, size_t split,
+        _In_ const uint8_t* palette1, _In_ const uint8_t* palette2,
+        _In_reads_(16) const uint8_t* index1, _In_reads_(16) const uint8_t* index2)
+    {
+        // Bytes from split on come from the second palette
+        const size_t words = dbpp / sizeof(T);
+        T mask[16 / sizeof(T)];
+        for (size_t k = 0; k < words; ++k)
+        {
+            const size_t first = k * sizeof(T);
+            mask[k] = (split <= first) ? T(~T(0))
+                : (split >= first + sizeof(T)) ? T(0)
+                : T(T(~T(0)) << (8 * (split - first)));
+        }
+
+        for (size_t y = 0; y < ph; ++y)
+        {
+            uint8_t* dptr = pDest + rowPitch * y;
+            for (size_t x = 0; x < pw; ++x, dptr += dbpp)
+            {
+                auto s1 = reinterpret_cast<const T*>(palette1 + index1[y * 4 + x] * dbpp);
+                auto s2 = reinterpret_cast<const T*>(palette2 + index2[y * 4 + x] * dbpp);
+                auto d = reinterpret_cast<T*>(dptr);
+                for (size_t k = 0; k < words; ++k)
+                    d[k] = T((s1[k] & ~mask[k]) | (s2[k] & mask[k]));
+            }
+        }
+    }
+
+    //-------------------------------------------------------------------------------------
+    // Decodes the block rows [blockRowBegin, blockRowEnd) of a BC1 - BC5 image. Only the palette
+    // of each block is converted to the output format, the pixels are copies of its entries.
+    // The palettes are the values the per-block decoders produce, so the result is the same.
+    HRESULT DecompressBCPalette(
+        _In_ const Image& cImage,
+        _In_ const Image& result,
+        _In_ DXGI_FORMAT cformat,
+        _In_ size_t split,
+        _In_ size_t blockRowBegin,
+        _In_ size_t blockRowEnd)
+    {
+        const DXGI_FORMAT format = result.format;
+        const size_t dbpp = BitsPerPixel(format) / 8;
+        const size_t rowPitch = result.rowPitch;
+
+        size_t sbpp;
+        switch (cformat)
+        {
+        case DXGI_FORMAT_BC1_UNORM:
+        case DXGI_FORMAT_BC1_UNORM_SRGB:
+        case DXGI_FORMAT_BC4_UNORM:
+        case DXGI_FORMAT_BC4_SNORM:
+            sbpp = 8;
+            break;
+
+        default:
+            sbpp = 16;
+            break;
+        }
+
+        __declspec(align(16)) XMVECTOR temp[16];
+        __declspec(align(16)) uint8_t palette1[8 * 16];
+        __declspec(align(16)) uint8_t palette2[16 * 16] = {};
+        uint8_t index1[16];
+        uint8_t index2[16] = {};
+        float values[8];
+
+        // BC2 alpha is explicit, so its palette is the same for every block
+        const bool bc2 = (cformat == DXGI_FORMAT_BC2_UNORM || cformat == DXGI_FORMAT_BC2_UNORM_SRGB);
+        if (bc2)
+        {
+            for (size_t i = 0; i < 16; ++i)
+                temp[i] = XMVectorSet(0.f, 0.f, 0.f, static_cast<float>(i) * (1.0f / 15.0f));
+
+            _ConvertScanline(temp, 16, format, cformat, 0);
+            if (!_StoreScanline(palette2, sizeof(palette2), format, temp, 16))
+                return E_FAIL;
+        }
+
+        const uint8_t *pSrc = cImage.pixels + cImage.rowPitch * blockRowBegin;
+        uint8_t *pDest = result.pixels + rowPitch * 4 * blockRowBegin;
+        for (size_t h = blockRowBegin * 4, row = blockRowBegin; (h < cImage.height) && (row < blockRowEnd); h += 4, ++row)
+        {
+            const uint8_t *sptr = pSrc;
+            uint8_t* dptr = pDest;
+            const size_t ph = std::min<size_t>(4, cImage.height - h);
+            for (size_t w = 0; w < cImage.width; w += 4)
+            {
+                size_t count1 = 0;
+                size_t count2 = 0;
+                switch (cformat)
+                {
+                case DXGI_FORMAT_BC1_UNORM:
+                case DXGI_FORMAT_BC1_UNORM_SRGB:
+                case DXGI_FORMAT_BC2_UNORM:
+                case DXGI_FORMAT_BC2_UNORM_SRGB:
+                case DXGI_FORMAT_BC3_UNORM:
+                case DXGI_FORMAT_BC3_UNORM_SRGB:
+                    {
+                        const uint8_t* pColor = sptr + sbpp - 8;
+                        D3DXDecodeBC1Palette(temp, pColor, sbpp == 8);
+                        count1 = 4;
+
+                        uint32_t dw = *reinterpret_cast<const uint32_t*>(pColor + 4);
+                        for (size_t i = 0; i < 16; ++i, dw >>= 2)
+                            index1[i] = static_cast<uint8_t>(dw & 3);
+
+                        if (bc2)
+                        {
+                            uint64_t bits = *reinterpret_cast<const uint64_t*>(sptr);
+                            for (size_t i = 0; i < 16; ++i, bits >>= 4)
+                                index2[i] = static_cast<uint8_t>(bits & 0xf);
+                        }
+                        else if (sbpp == 16)
+                        {
+                            D3DXDecodeBC3AlphaPalette(values, sptr);
+                            for (size_t i = 0; i < 8; ++i)
+                                temp[4 + i] = XMVectorSet(0.f, 0.f, 0.f, values[i]);
+                            count2 = 8;
+
+                            uint64_t bits = LoadIndices3(sptr);
+                            for (size_t i = 0; i < 16; ++i, bits >>= 3)
+                                index2[i] = static_cast<uint8_t>(bits & 7);
+                        }
+                    }
+                    break;
+
+                default:
+                    {
+                        // BC4 red, then BC5 green from the second half of the block
+                        const bool snorm = (cformat == DXGI_FORMAT_BC4_SNORM || cformat == DXGI_FORMAT_BC5_SNORM);
+                        for (size_t half = 0; half < sbpp / 8; ++half)
+                        {
+                            const uint8_t* pBC = sptr + half * 8;
+                            if (snorm)
+                                D3DXDecodeBC4SPalette(values, pBC);
+                            else
+                                D3DXDecodeBC4UPalette(values, pBC);
+
+                            for (size_t i = 0; i < 8; ++i)
+                                temp[half * 8 + i] = half ? XMVectorSet(0.f, values[i], 0.f, 1.f) : XMVectorSet(values[i], 0.f, 0.f, 1.f);
+
+                            uint8_t* index = half ? index2 : index1;
+                            uint64_t bits = LoadIndices3(pBC);
+                            for (size_t i = 0; i < 16; ++i, bits >>= 3)
+                                index[i] = static_cast<uint8_t>(bits & 7);
+                        }
+                        count1 = 8;
+                        count2 = (sbpp == 16) ? 8 : 0;
+                    }
+                    break;
+                }
+
+                // Convert the palettes (entries count1 .. count1 + count2 are the second one)
+                _ConvertScanline(temp, count1 + count2, format, cformat, 0);
+                if (!_StoreScanline(palette1, sizeof(palette1), format, temp, count1))
+                    return E_FAIL;
+                if (count2 && !_StoreScanline(palette2, sizeof(palette2), format, temp + count1, count2))
+                    return E_FAIL;
+
+                const size_t pw = std::min<size_t>(4, cImage.width - w);
+                switch (dbpp)
+                {
+                case 1:
+                    StorePaletteBlock<uint8_t>(dptr, rowPitch, pw, ph, dbpp, split, palette1, palette2, index1, index2);
+                    break;
+                case 2:
+                case 6:
+                    StorePaletteBlock<uint16_t>(dptr, rowPitch, pw, ph, dbpp, split, palette1, palette2, index1, index2);
+                    break;
+                case 4:
+                case 12:
+                    StorePaletteBlock<uint32_t>(dptr, rowPitch, pw, ph, dbpp, split, palette1, palette2, index1, index2);
+                    break;
+                case 8:
+                case 16:
+                    StorePaletteBlock<uint64_t>(dptr, rowPitch, pw, ph, dbpp, split, palette1, palette2, index1, index2);
+                    break;
+                default:
+                    StorePaletteBlock<uint8_t>(dptr, rowPitch, pw, ph, dbpp, split, palette1, palette2, index1, index2);
+                    break;
+                }
+
+                sptr += sbpp;
+                dptr += dbpp * 4;
+            }
+
+            pSrc += cImage.rowPitch;
+            pDest += rowPitch * 4;
+        }
+
+        return S_OK;
+    }
+
+
+    //-------------------------------------------------------------------------------------
+    // Decompresses the block rows [blockRowBegin, blockRowEnd) of the image
+    HRESULT DecompressBC(
+        _In_ const Image& cImage,
+        _In_ const Image& result,
+        _In_ size_t blockRowBegin = 0,
+        _In_ size_t blockRowEnd = SIZE_MAX)
     {
         if (!cImage.pixels || !result.pixels)
             return E_POINTER;
@@ -399,9 +740,7 @@ namespace
         // Round to bytes
         dbpp = (dbpp + 7) / 8;
 
-        uint8_t *pDest = result.pixels;
-        if (!pDest)
-            return E_POINTER;
+        uint8_t *pDest = result.pixels + result.rowPitch * 4 * blockRowBegin;
 
         // Promote "typeless" BC formats
         DXGI_FORMAT cformat;
@@ -417,6 +756,11 @@ namespace
         default:                        cformat = cImage.format;         break;
         }
 
+        // BC1 - BC5 go through the block palettes where the output format allows it
+        const size_t split = GetPaletteSplit(cformat, format, dbpp);
+        if (split)
+            return DecompressBCPalette(cImage, result, cformat, split, blockRowBegin, blockRowEnd);
+
         // Determine BC format decoder
         BC_DECODE pfDecode;
         size_t sbpp;
@@ -441,9 +785,9 @@ namespace
         }
 
         __declspec(align(16)) XMVECTOR temp[16];
-        const uint8_t *pSrc = cImage.pixels;
+        const uint8_t *pSrc = cImage.pixels + cImage.rowPitch * blockRowBegin;
         const size_t rowPitch = result.rowPitch;
-        for (size_t h = 0; h < cImage.height; h += 4)
+        for (size_t h = blockRowBegin * 4, row = blockRowBegin; (h < cImage.height) && (row < blockRowEnd); h += 4, ++row)
         {
             const uint8_t *sptr = pSrc;
             uint8_t* dptr = pDest;
@@ -488,6 +832,27 @@ namespace
 
         return S_OK;
     }
+
+
+    //-------------------------------------------------------------------------------------
+    // Numbers the block rows of all images consecutively, so a single _ParallelFor covers
+    // every mip and array item. Returns the first row of each image followed by the total.
+    std::unique_ptr<size_t[]> GetBlockRowStarts(_In_reads_(nimages) const Image* images, size_t nimages)
+    {
+        std::unique_ptr<size_t[]> starts(new (std::nothrow) size_t[nimages + 1]);
+        if (starts)
+        {
+            starts[0] = 0;
+            for (size_t index = 0; index < nimages; ++index)
+                starts[index + 1] = starts[index] + (images[index].height + 3) / 4;
+        }
+        return starts;
+    }
+
+    inline size_t FindImage(_In_reads_(nimages + 1) const size_t* starts, size_t nimages, size_t blockRow)
+    {
+        return size_t(std::upper_bound(starts, starts + nimages + 1, blockRow) - starts) - 1;
+    }
 }
 
 //-------------------------------------------------------------------------------------
@@ -509,6 +874,11 @@ namespace DirectX
         default:                        cformat = cImage.format;         break;
         }
 
+        // BC1 - BC5 go through the block palettes where the output format allows it
+        const size_t split = GetPaletteSplit(cformat, format, dbpp);
+        if (split)
+            return DecompressBCPalette(cImage, result, cformat, split, blockRowBegin, blockRowEnd);
+
         // Determine BC format decoder
         BC_DECODE pfDecode;
         size_t sbpp;
@@ -617,7 +987,13 @@ HRESULT DirectX::Compress(
     if (compress & TEX_COMPRESS_PARALLEL)
     {
 #ifndef _OPENMP
-        return E_NOTIMPL;
+        const DWORD bcflags = GetBCFlags(compress);
+        const DWORD srgb = GetSRGBFlags(compress);
+        hr = _ParallelFor((srcImage.height + 3) / 4, ParallelOptions(), 0, 0,
+            [&](size_t row) -> HRESULT
+        {
+            return CompressBC(srcImage, *img, bcflags, srgb, threshold, row, row + 1);
+        });
 #else
         hr = CompressBC_Parallel(srcImage, *img, GetBCFlags(compress), GetSRGBFlags(compress), threshold);
 #endif // _OPENMP
@@ -653,6 +1029,11 @@ HRESULT DirectX::Compress(
         || IsTypeless(metadata.format) || IsPlanar(metadata.format) || IsPalettized(metadata.format))
         return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
 
+#ifndef _OPENMP
+    if (compress & TEX_COMPRESS_PARALLEL)
+        return Compress(srcImages, nimages, metadata, format, compress, threshold, ParallelOptions(), cImages);
+#endif
+
     cImages.Release();
 
     TexMetadata mdata2 = metadata;
@@ -716,6 +1097,84 @@ HRESULT DirectX::Compress(
     return S_OK;
 }
 
+_Use_decl_annotations_
+HRESULT DirectX::Compress(
+    const Image* srcImages,
+    size_t nimages,
+    const TexMetadata& metadata,
+    DXGI_FORMAT format,
+    DWORD compress,
+    float threshold,
+    const ParallelOptions& options,
+    ScratchImage& cImages)
+{
+    if (!srcImages || !nimages)
+        return E_INVALIDARG;
+
+    if (IsCompressed(metadata.format) || !IsCompressed(format))
+        return E_INVALIDARG;
+
+    if (IsTypeless(format)
+        || IsTypeless(metadata.format) || IsPlanar(metadata.format) || IsPalettized(metadata.format))
+        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+
+    cImages.Release();
+
+    TexMetadata mdata2 = metadata;
+    mdata2.format = format;
+    HRESULT hr = cImages.Initialize(mdata2);
+    if (FAILED(hr))
+        return hr;
+
+    if (nimages != cImages.GetImageCount())
+    {
+        cImages.Release();
+        return E_FAIL;
+    }
+
+    const Image* dest = cImages.GetImages();
+    if (!dest)
+    {
+        cImages.Release();
+        return E_POINTER;
+    }
+
+    for (size_t index = 0; index < nimages; ++index)
+    {
+        assert(dest[index].format == format);
+
+        if (srcImages[index].width != dest[index].width || srcImages[index].height != dest[index].height)
+        {
+            cImages.Release();
+            return E_FAIL;
+        }
+    }
+
+    std::unique_ptr<size_t[]> starts = GetBlockRowStarts(srcImages, nimages);
+    if (!starts)
+    {
+        cImages.Release();
+        return E_OUTOFMEMORY;
+    }
+
+    // One task per block row; small mips finish quickly and leave room for stealing rows of the large ones
+    const DWORD bcflags = GetBCFlags(compress);
+    const DWORD srgb = GetSRGBFlags(compress);
+    const size_t total = starts[nimages];
+    hr = _ParallelFor(total, options, 0, total,
+        [&](size_t blockRow) -> HRESULT
+    {
+        size_t index = FindImage(starts.get(), nimages, blockRow);
+        size_t row = blockRow - starts[index];
+        return CompressBC(srcImages[index], dest[index], bcflags, srgb, threshold, row, row + 1);
+    });
+
+    if (FAILED(hr))
+        cImages.Release();
+
+    return hr;
+}
+
 
 //-------------------------------------------------------------------------------------
 // Decompression
@@ -849,3 +1308,98 @@ HRESULT DirectX::Decompress(
 
     return S_OK;
 }
+
+_Use_decl_annotations_
+HRESULT DirectX::Decompress(
+    const Image* cImages,
+    size_t nimages,
+    const TexMetadata& metadata,
+    DXGI_FORMAT format,
+    const ParallelOptions& options,
+    ScratchImage& images)
+{
+    if (!cImages || !nimages)
+        return E_INVALIDARG;
+
+    if (!IsCompressed(metadata.format) || IsCompressed(format))
+        return E_INVALIDARG;
+
+    if (format == DXGI_FORMAT_UNKNOWN)
+    {
+        // Pick a default decompressed format based on BC input format
+        format = DefaultDecompress(cImages[0].format);
+        if (format == DXGI_FORMAT_UNKNOWN)
+        {
+            // Input is not a compressed format
+            return E_FAIL;
+        }
+    }
+    else
+    {
+        if (!IsValid(format))
+            return E_INVALIDARG;
+
+        if (IsTypeless(format) || IsPlanar(format) || IsPalettized(format))
+            return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+    }
+
+    images.Release();
+
+    TexMetadata mdata2 = metadata;
+    mdata2.format = format;
+    HRESULT hr = images.Initialize(mdata2);
+    if (FAILED(hr))
+        return hr;
+
+    if (nimages != images.GetImageCount())
+    {
+        images.Release();
+        return E_FAIL;
+    }
+
+    const Image* dest = images.GetImages();
+    if (!dest)
+    {
+        images.Release();
+        return E_POINTER;
+    }
+
+    for (size_t index = 0; index < nimages; ++index)
+    {
+        assert(dest[index].format == format);
+
+        const Image& src = cImages[index];
+        if (!IsCompressed(src.format))
+        {
+            images.Release();
+            return E_FAIL;
+        }
+
+        if (src.width != dest[index].width || src.height != dest[index].height)
+        {
+            images.Release();
+            return E_FAIL;
+        }
+    }
+
+    std::unique_ptr<size_t[]> starts = GetBlockRowStarts(cImages, nimages);
+    if (!starts)
+    {
+        images.Release();
+        return E_OUTOFMEMORY;
+    }
+
+    const size_t total = starts[nimages];
+    hr = _ParallelFor(total, options, 0, total,
+        [&](size_t blockRow) -> HRESULT
+    {
+        size_t index = FindImage(starts.get(), nimages, blockRow);
+        size_t row = blockRow - starts[index];
+        return DecompressBC(cImages[index], dest[index], row, row + 1);
+    });
+
+    if (FAILED(hr))
+        images.Release();
+
+    return hr;
+}
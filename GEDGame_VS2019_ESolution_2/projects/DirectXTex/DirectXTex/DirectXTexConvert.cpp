@@ -4559,6 +4559,269 @@ namespace
     }
 
 
+    //-------------------------------------------------------------------------------------
+    // Direct format-pair conversions
+    //
+    // These give exactly the same results as _LoadScanline/_ConvertScanline/_StoreScanline
+    // for the pairs below, but work on the packed pixels without a float scanline. They are
+    // only used when nothing but the format changes (no dithering, X2 bias or sRGB curve).
+    //-------------------------------------------------------------------------------------
+    inline uint32_t ConvertPixel8(uint32_t v, bool swapRB, bool fillAlpha)
+    {
+        if (swapRB)
+            v = (v & 0xFF00FF00) | ((v >> 16) & 0xFF) | ((v & 0xFF) << 16);
+        if (fillAlpha)
+            v |= 0xFF000000;
+        return v;
+    }
+
+#if defined(_XM_SSE_INTRINSICS_) && !defined(_XM_NO_INTRINSICS_)
+    inline __m128i ConvertPixel8x4(__m128i v, bool swapRB, bool fillAlpha)
+    {
+        if (swapRB)
+        {
+            const __m128i ga = _mm_set1_epi32(static_cast<int>(0xFF00FF00));
+            __m128i rb = _mm_andnot_si128(ga, v);
+            v = _mm_or_si128(_mm_and_si128(v, ga), _mm_or_si128(_mm_slli_epi32(rb, 16), _mm_srli_epi32(rb, 16)));
+        }
+        if (fillAlpha)
+            v = _mm_or_si128(v, _mm_set1_epi32(static_cast<int>(0xFF000000)));
+        return v;
+    }
+
+    inline __m128i Narrow16To8x4(__m128i x)
+    {
+        // n = x * 255 + 32767, n / 65535 = (n + 1 + (n >> 16)) >> 16
+        __m128i n = _mm_add_epi32(_mm_sub_epi32(_mm_slli_epi32(x, 8), x), _mm_set1_epi32(32767));
+        n = _mm_add_epi32(_mm_add_epi32(n, _mm_set1_epi32(1)), _mm_srli_epi32(n, 16));
+        return _mm_srli_epi32(n, 16);
+    }
+#endif
+
+    // RGBA8/BGRA8/BGRX8 -> RGBA8/BGRA8/BGRX8
+    template<bool swapRB, bool fillAlpha>
+    void Convert8To8(void* pDestination, const void* pSource, size_t count)
+    {
+        auto sPtr = static_cast<const uint32_t*>(pSource);
+        auto dPtr = static_cast<uint32_t*>(pDestination);
+        size_t i = 0;
+#if defined(_XM_SSE_INTRINSICS_) && !defined(_XM_NO_INTRINSICS_)
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sPtr + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dPtr + i), ConvertPixel8x4(v, swapRB, fillAlpha));
+        }
+#endif
+        for (; i < count; ++i)
+        {
+            dPtr[i] = ConvertPixel8(sPtr[i], swapRB, fillAlpha);
+        }
+    }
+
+    // RGBA8/BGRA8/BGRX8 -> R16G16B16A16_UNORM: x / 255 * 65535 is exactly x * 257
+    template<bool swapRB, bool fillAlpha>
+    void Convert8To16(void* pDestination, const void* pSource, size_t count)
+    {
+        auto sPtr = static_cast<const uint32_t*>(pSource);
+        auto dPtr = static_cast<uint16_t*>(pDestination);
+        size_t i = 0;
+#if defined(_XM_SSE_INTRINSICS_) && !defined(_XM_NO_INTRINSICS_)
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sPtr + i));
+            v = ConvertPixel8x4(v, swapRB, fillAlpha);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dPtr + i * 4), _mm_unpacklo_epi8(v, v));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dPtr + i * 4 + 8), _mm_unpackhi_epi8(v, v));
+        }
+#endif
+        for (; i < count; ++i)
+        {
+            uint32_t v = ConvertPixel8(sPtr[i], swapRB, fillAlpha);
+            for (size_t j = 0; j < 4; ++j)
+            {
+                dPtr[i * 4 + j] = static_cast<uint16_t>(((v >> (j * 8)) & 0xFF) * 257);
+            }
+        }
+    }
+
+    // R16G16B16A16_UNORM -> RGBA8/BGRA8/BGRX8: x / 65535 * 255 with the store rounding is
+    // exactly (x * 255 + 32767) / 65535
+    template<bool swapRB, bool fillAlpha>
+    void Convert16To8(void* pDestination, const void* pSource, size_t count)
+    {
+        auto sPtr = static_cast<const uint16_t*>(pSource);
+        auto dPtr = static_cast<uint32_t*>(pDestination);
+        size_t i = 0;
+#if defined(_XM_SSE_INTRINSICS_) && !defined(_XM_NO_INTRINSICS_)
+        const __m128i zero = _mm_setzero_si128();
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sPtr + i * 4));
+            __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sPtr + i * 4 + 8));
+            a = _mm_packs_epi32(Narrow16To8x4(_mm_unpacklo_epi16(a, zero)), Narrow16To8x4(_mm_unpackhi_epi16(a, zero)));
+            b = _mm_packs_epi32(Narrow16To8x4(_mm_unpacklo_epi16(b, zero)), Narrow16To8x4(_mm_unpackhi_epi16(b, zero)));
+            __m128i v = _mm_packus_epi16(a, b);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dPtr + i), ConvertPixel8x4(v, swapRB, fillAlpha));
+        }
+#endif
+        for (; i < count; ++i)
+        {
+            uint32_t v = 0;
+            for (size_t j = 0; j < 4; ++j)
+            {
+                uint32_t x = sPtr[i * 4 + j];
+                v |= ((x * 255 + 32767) / 65535) << (j * 8);
+            }
+            dPtr[i] = ConvertPixel8(v, swapRB, fillAlpha);
+        }
+    }
+
+    // R16_FLOAT -> R32_FLOAT and R16G16B16A16_FLOAT -> R32G32B32A32_FLOAT
+    template<size_t channels>
+    void ConvertHalfToFloat(void* pDestination, const void* pSource, size_t count)
+    {
+        XMConvertHalfToFloatStream(static_cast<float*>(pDestination), sizeof(float),
+            static_cast<const HALF*>(pSource), sizeof(HALF), count * channels);
+    }
+
+    // R32_FLOAT -> R16_FLOAT, clamped the same way as _StoreScanline
+    void ConvertFloatToHalf1(void* pDestination, const void* pSource, size_t count)
+    {
+        auto sPtr = static_cast<const float*>(pSource);
+        auto dPtr = static_cast<HALF*>(pDestination);
+        for (size_t i = 0; i < count; ++i)
+        {
+            float v = std::max<float>(std::min<float>(sPtr[i], 65504.f), -65504.f);
+            dPtr[i] = XMConvertFloatToHalf(v);
+        }
+    }
+
+    // R32G32B32A32_FLOAT -> R16G16B16A16_FLOAT, clamped the same way as _StoreScanline
+    void ConvertFloatToHalf4(void* pDestination, const void* pSource, size_t count)
+    {
+        auto sPtr = static_cast<const XMFLOAT4*>(pSource);
+        auto dPtr = static_cast<XMHALF4*>(pDestination);
+        for (size_t i = 0; i < count; ++i)
+        {
+            XMVECTOR v = XMLoadFloat4(sPtr + i);
+            v = XMVectorClamp(v, g_HalfMin, g_HalfMax);
+            XMStoreHalf4(dPtr + i, v);
+        }
+    }
+
+    // Both formats are the same layout, only the sRGB tag differs
+    void ConvertCopy8(void* pDestination, const void* pSource, size_t count)
+    {
+        memcpy(pDestination, pSource, count * sizeof(uint32_t));
+    }
+
+    // Formats are listed without _SRGB, _GetDirectConversion maps those to the UNORM layout
+    const DirectConvert g_DirectConvertTable[] =
+    {
+        { DXGI_FORMAT_R8G8B8A8_UNORM,       DXGI_FORMAT_R8G8B8A8_UNORM,         ConvertCopy8 },
+        { DXGI_FORMAT_R8G8B8A8_UNORM,       DXGI_FORMAT_B8G8R8A8_UNORM,         Convert8To8<true, false> },
+        { DXGI_FORMAT_R8G8B8A8_UNORM,       DXGI_FORMAT_B8G8R8X8_UNORM,         Convert8To8<true, true> },
+        { DXGI_FORMAT_R8G8B8A8_UNORM,       DXGI_FORMAT_R16G16B16A16_UNORM,     Convert8To16<false, false> },
+        { DXGI_FORMAT_B8G8R8A8_UNORM,       DXGI_FORMAT_R8G8B8A8_UNORM,         Convert8To8<true, false> },
+        { DXGI_FORMAT_B8G8R8A8_UNORM,       DXGI_FORMAT_B8G8R8A8_UNORM,         ConvertCopy8 },
+        { DXGI_FORMAT_B8G8R8A8_UNORM,       DXGI_FORMAT_B8G8R8X8_UNORM,         Convert8To8<false, true> },
+        { DXGI_FORMAT_B8G8R8A8_UNORM,       DXGI_FORMAT_R16G16B16A16_UNORM,     Convert8To16<true, false> },
+        { DXGI_FORMAT_B8G8R8X8_UNORM,       DXGI_FORMAT_R8G8B8A8_UNORM,         Convert8To8<true, true> },
+        { DXGI_FORMAT_B8G8R8X8_UNORM,       DXGI_FORMAT_B8G8R8A8_UNORM,         Convert8To8<false, true> },
+        { DXGI_FORMAT_B8G8R8X8_UNORM,       DXGI_FORMAT_B8G8R8X8_UNORM,         Convert8To8<false, true> },
+        { DXGI_FORMAT_B8G8R8X8_UNORM,       DXGI_FORMAT_R16G16B16A16_UNORM,     Convert8To16<true, true> },
+        { DXGI_FORMAT_R16G16B16A16_UNORM,   DXGI_FORMAT_R8G8B8A8_UNORM,         Convert16To8<false, false> },
+        { DXGI_FORMAT_R16G16B16A16_UNORM,   DXGI_FORMAT_B8G8R8A8_UNORM,         Convert16To8<true, false> },
+        { DXGI_FORMAT_R16G16B16A16_UNORM,   DXGI_FORMAT_B8G8R8X8_UNORM,         Convert16To8<true, true> },
+        { DXGI_FORMAT_R16G16B16A16_FLOAT,   DXGI_FORMAT_R32G32B32A32_FLOAT,     ConvertHalfToFloat<4> },
+        { DXGI_FORMAT_R32G32B32A32_FLOAT,   DXGI_FORMAT_R16G16B16A16_FLOAT,     ConvertFloatToHalf4 },
+        { DXGI_FORMAT_R16_FLOAT,            DXGI_FORMAT_R32_FLOAT,              ConvertHalfToFloat<1> },
+        { DXGI_FORMAT_R32_FLOAT,            DXGI_FORMAT_R16_FLOAT,              ConvertFloatToHalf1 },
+    };
+
+    inline DXGI_FORMAT StripSRGB(DXGI_FORMAT fmt)
+    {
+        switch (fmt)
+        {
+        case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:   return DXGI_FORMAT_R8G8B8A8_UNORM;
+        case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:   return DXGI_FORMAT_B8G8R8A8_UNORM;
+        case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:   return DXGI_FORMAT_B8G8R8X8_UNORM;
+        default:                                return fmt;
+        }
+    }
+}
+
+//-------------------------------------------------------------------------------------
+// Selection logic for the direct conversions, returns nullptr for the float path
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+DirectConvertFunc DirectX::_GetDirectConversion(
+    DWORD filter,
+    DXGI_FORMAT sformat,
+    DXGI_FORMAT tformat)
+{
+    if (filter & (TEX_FILTER_DITHER | TEX_FILTER_DITHER_DIFFUSION | TEX_FILTER_FLOAT_X2BIAS
+        | TEX_FILTER_FORCE_WIC | TEX_FILTER_FORCE_FLOAT))
+        return nullptr;
+
+    // An sRGB curve on one side only needs the float path, on both sides they cancel out
+    bool srgbIn = (filter & TEX_FILTER_SRGB_IN) || IsSRGB(sformat);
+    bool srgbOut = (filter & TEX_FILTER_SRGB_OUT) || IsSRGB(tformat);
+    if (srgbIn != srgbOut)
+        return nullptr;
+
+    sformat = StripSRGB(sformat);
+    tformat = StripSRGB(tformat);
+    for (size_t i = 0; i < _countof(g_DirectConvertTable); ++i)
+    {
+        if (g_DirectConvertTable[i].source == sformat && g_DirectConvertTable[i].dest == tformat)
+            return g_DirectConvertTable[i].func;
+    }
+
+    return nullptr;
+}
+
+//-------------------------------------------------------------------------------------
+// All direct conversions, for checking them against the float path
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+const DirectConvert* DirectX::_GetDirectConversions(size_t& count)
+{
+    count = _countof(g_DirectConvertTable);
+    return g_DirectConvertTable;
+}
+
+namespace
+{
+    //-------------------------------------------------------------------------------------
+    // Convert the source image using a direct conversion
+    //-------------------------------------------------------------------------------------
+    HRESULT ConvertDirect(
+        _In_ const Image& srcImage,
+        _In_ DirectConvertFunc func,
+        _In_ const Image& destImage)
+    {
+        assert(srcImage.width == destImage.width);
+        assert(srcImage.height == destImage.height);
+        assert(func != nullptr);
+
+        const uint8_t *pSrc = srcImage.pixels;
+        uint8_t *pDest = destImage.pixels;
+        if (!pSrc || !pDest)
+            return E_POINTER;
+
+        for (size_t h = 0; h < srcImage.height; ++h)
+        {
+            func(pDest, pSrc, srcImage.width);
+
+            pSrc += srcImage.rowPitch;
+            pDest += destImage.rowPitch;
+        }
+
+        return S_OK;
+    }
+
+
     //-------------------------------------------------------------------------------------
     // Convert the source image (not using WIC)
     //-------------------------------------------------------------------------------------
@@ -4842,7 +5105,12 @@ HRESULT DirectX::Convert(
     }
 
     WICPixelFormatGUID pfGUID, targetGUID;
-    if (UseWICConversion(filter, srcImage.format, format, pfGUID, targetGUID))
+    DirectConvertFunc direct = _GetDirectConversion(filter, srcImage.format, format);
+    if (direct)
+    {
+        hr = ConvertDirect(srcImage, direct, *rimage);
+    }
+    else if (UseWICConversion(filter, srcImage.format, format, pfGUID, targetGUID))
     {
         hr = ConvertUsingWIC(srcImage, pfGUID, targetGUID, filter, threshold, *rimage);
     }
@@ -4906,7 +5174,8 @@ HRESULT DirectX::Convert(
     }
 
     WICPixelFormatGUID pfGUID, targetGUID;
-    bool usewic = !metadata.IsPMAlpha() && UseWICConversion(filter, metadata.format, format, pfGUID, targetGUID);
+    DirectConvertFunc direct = _GetDirectConversion(filter, metadata.format, format);
+    bool usewic = !direct && !metadata.IsPMAlpha() && UseWICConversion(filter, metadata.format, format, pfGUID, targetGUID);
 
     switch (metadata.dimension)
     {
@@ -4936,7 +5205,11 @@ HRESULT DirectX::Convert(
                 return E_FAIL;
             }
 
-            if (usewic)
+            if (direct)
+            {
+                hr = ConvertDirect(src, direct, dst);
+            }
+            else if (usewic)
             {
                 hr = ConvertUsingWIC(src, pfGUID, targetGUID, filter, threshold, dst);
             }
@@ -4989,7 +5262,11 @@ HRESULT DirectX::Convert(
                     return E_FAIL;
                 }
 
-                if (usewic)
+                if (direct)
+                {
+                    hr = ConvertDirect(src, direct, dst);
+                }
+                else if (usewic)
                 {
                     hr = ConvertUsingWIC(src, pfGUID, targetGUID, filter, threshold, dst);
                 }
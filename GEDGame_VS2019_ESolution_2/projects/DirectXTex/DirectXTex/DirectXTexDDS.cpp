@@ -1777,6 +1777,216 @@ HRESULT DirectX::LoadFromDDSFile(
 }
 
 
+//=====================================================================================
+// Memory mapped DDS file
+//=====================================================================================
+
+namespace
+{
+    // Size of one subresource of the given mip level as stored in a DDS file
+    HRESULT ComputeDDSSubresource(
+        _In_ const TexMetadata& metadata,
+        size_t mip,
+        _Out_ Image& image,
+        _Out_ size_t& depth)
+    {
+        image.width = std::max<size_t>(1, metadata.width >> mip);
+        image.height = std::max<size_t>(1, metadata.height >> mip);
+        image.format = metadata.format;
+        image.pixels = nullptr;
+        depth = (metadata.dimension == TEX_DIMENSION_TEXTURE3D) ? std::max<size_t>(1, metadata.depth >> mip) : 1;
+
+        return ComputePitch(metadata.format, image.width, image.height, image.rowPitch, image.slicePitch, CP_FLAGS_NONE);
+    }
+}
+
+MappedDDS& MappedDDS::operator= (MappedDDS&& moveFrom) noexcept
+{
+    if (this != &moveFrom)
+    {
+        Release();
+
+        m_view = moveFrom.m_view;
+        m_size = moveFrom.m_size;
+        m_offset = moveFrom.m_offset;
+        m_itemSize = moveFrom.m_itemSize;
+        m_metadata = moveFrom.m_metadata;
+
+        moveFrom.m_view = nullptr;
+        moveFrom.m_size = 0;
+        moveFrom.m_offset = 0;
+        moveFrom.m_itemSize = 0;
+    }
+    return *this;
+}
+
+void MappedDDS::Release()
+{
+    if (m_view)
+    {
+        UnmapViewOfFile(m_view);
+        m_view = nullptr;
+    }
+
+    m_size = 0;
+    m_offset = 0;
+    m_itemSize = 0;
+    memset(&m_metadata, 0, sizeof(m_metadata));
+}
+
+_Use_decl_annotations_
+HRESULT MappedDDS::Open(const wchar_t* szFile, DWORD flags)
+{
+    if (!szFile)
+        return E_INVALIDARG;
+
+    Release();
+
+    if (flags & (DDS_FLAGS_LEGACY_DWORD | DDS_FLAGS_BAD_DXTN_TAILS))
+        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+
+#if (_WIN32_WINNT >= _WIN32_WINNT_WIN8)
+    ScopedHandle hFile(safe_handle(CreateFile2(szFile, GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING, nullptr)));
+#else
+    ScopedHandle hFile(safe_handle(CreateFileW(szFile, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL, nullptr)));
+#endif
+    if (!hFile)
+    {
+        return HRESULT_FROM_WIN32(GetLastError());
+    }
+
+    // Get the file size
+    FILE_STANDARD_INFO fileInfo;
+    if (!GetFileInformationByHandleEx(hFile.get(), FileStandardInfo, &fileInfo, sizeof(fileInfo)))
+    {
+        return HRESULT_FROM_WIN32(GetLastError());
+    }
+
+#ifndef _WIN64
+    // File is too big to map into a 32-bit address space
+    if (fileInfo.EndOfFile.HighPart > 0)
+    {
+        return HRESULT_FROM_WIN32(ERROR_FILE_TOO_LARGE);
+    }
+#endif
+
+    const size_t fileSize = static_cast<size_t>(fileInfo.EndOfFile.QuadPart);
+
+    // Need at least enough data to fill the standard header and magic number to be a valid DDS
+    if (fileSize < (sizeof(DDS_HEADER) + sizeof(uint32_t)))
+    {
+        return E_FAIL;
+    }
+
+    // The view keeps the mapping object alive, so neither handle is needed afterwards
+#if defined(WINAPI_FAMILY) && (WINAPI_FAMILY == WINAPI_FAMILY_APP)
+    ScopedHandle hMapping(CreateFileMappingFromApp(hFile.get(), nullptr, PAGE_READONLY, 0, nullptr));
+    if (!hMapping)
+    {
+        return HRESULT_FROM_WIN32(GetLastError());
+    }
+
+    auto view = static_cast<const uint8_t*>(MapViewOfFileFromApp(hMapping.get(), FILE_MAP_READ, 0, 0));
+#else
+    ScopedHandle hMapping(CreateFileMappingW(hFile.get(), nullptr, PAGE_READONLY, 0, 0, nullptr));
+    if (!hMapping)
+    {
+        return HRESULT_FROM_WIN32(GetLastError());
+    }
+
+    auto view = static_cast<const uint8_t*>(MapViewOfFile(hMapping.get(), FILE_MAP_READ, 0, 0, 0));
+#endif
+    if (!view)
+    {
+        return HRESULT_FROM_WIN32(GetLastError());
+    }
+
+    m_view = view;
+    m_size = fileSize;
+
+    DWORD convFlags = 0;
+    HRESULT hr = DecodeDDSHeader(m_view, m_size, flags, m_metadata, convFlags);
+    if (FAILED(hr))
+    {
+        Release();
+        return hr;
+    }
+
+    if (convFlags & (CONV_FLAGS_EXPAND | CONV_FLAGS_SWIZZLE | CONV_FLAGS_NOALPHA | CONV_FLAGS_PAL8))
+    {
+        Release();
+        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+    }
+
+    m_offset = sizeof(uint32_t) + sizeof(DDS_HEADER);
+    if (convFlags & CONV_FLAGS_DX10)
+        m_offset += sizeof(DDS_HEADER_DXT10);
+
+    // One array item is all its mips, volume textures have a single item
+    uint64_t itemSize = 0;
+    for (size_t mip = 0; mip < m_metadata.mipLevels; ++mip)
+    {
+        Image img;
+        size_t depth;
+        hr = ComputeDDSSubresource(m_metadata, mip, img, depth);
+        if (FAILED(hr))
+        {
+            Release();
+            return hr;
+        }
+
+        itemSize += uint64_t(img.slicePitch) * uint64_t(depth);
+    }
+
+    if (itemSize * uint64_t(m_metadata.arraySize) > uint64_t(m_size - m_offset))
+    {
+        Release();
+        return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+    }
+
+    m_itemSize = static_cast<size_t>(itemSize);
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT MappedDDS::GetImage(size_t mip, size_t item, size_t slice, Image& image) const
+{
+    memset(&image, 0, sizeof(Image));
+
+    if (!m_view)
+        return E_POINTER;
+
+    if (mip >= m_metadata.mipLevels || item >= m_metadata.arraySize)
+        return E_INVALIDARG;
+
+    size_t offset = m_offset + item * m_itemSize;
+    for (size_t level = 0; level < mip; ++level)
+    {
+        Image img;
+        size_t depth;
+        HRESULT hr = ComputeDDSSubresource(m_metadata, level, img, depth);
+        if (FAILED(hr))
+            return hr;
+
+        offset += img.slicePitch * depth;
+    }
+
+    size_t depth;
+    HRESULT hr = ComputeDDSSubresource(m_metadata, mip, image, depth);
+    if (FAILED(hr))
+        return hr;
+
+    if (slice >= depth)
+        return E_INVALIDARG;
+
+    image.pixels = const_cast<uint8_t*>(m_view + offset + slice * image.slicePitch);
+
+    return S_OK;
+}
+
+
 //-------------------------------------------------------------------------------------
 // Save a DDS file to memory
 //-------------------------------------------------------------------------------------
@@ -14,6 +14,7 @@
 #include "filters.h"
 
 using namespace DirectX;
+using namespace DirectX::PackedVector;
 using Microsoft::WRL::ComPtr;
 
 namespace
@@ -1054,6 +1055,244 @@ namespace
     }
 
 
+    //--- 2D Point/Box Filter for a band of rows, used by the thread pool version ---
+    // Computes dest rows [yBegin, yEnd) from the previous level exactly like the whole-chain versions
+    HRESULT Generate2DMipRowsPointFilter(const Image& src, const Image& dest, size_t yBegin, size_t yEnd)
+    {
+        const size_t width = src.width;
+
+        ScopedAlignedArrayXMVECTOR scanline(static_cast<XMVECTOR*>(_aligned_malloc((sizeof(XMVECTOR)*(width + dest.width)), 16)));
+        if (!scanline)
+            return E_OUTOFMEMORY;
+
+        XMVECTOR* row = scanline.get();
+        XMVECTOR* target = row + width;
+
+        const size_t xinc = (width << 16) / dest.width;
+        const size_t yinc = (src.height << 16) / dest.height;
+
+        uint8_t* pDest = dest.pixels + dest.rowPitch * yBegin;
+
+        size_t lasty = size_t(-1);
+        for (size_t y = yBegin; y < yEnd; ++y)
+        {
+            size_t sy = y * yinc;
+            if ((lasty ^ sy) >> 16)
+            {
+                if (!_LoadScanline(row, width, src.pixels + (src.rowPitch * (sy >> 16)), src.rowPitch, src.format))
+                    return E_FAIL;
+                lasty = sy;
+            }
+
+            size_t sx = 0;
+            for (size_t x = 0; x < dest.width; ++x)
+            {
+                target[x] = row[sx >> 16];
+                sx += xinc;
+            }
+
+            if (!_StoreScanline(pDest, dest.rowPitch, dest.format, target, dest.width))
+                return E_FAIL;
+            pDest += dest.rowPitch;
+        }
+
+        return S_OK;
+    }
+
+    HRESULT Generate2DMipRowsBoxFilter(DWORD filter, const Image& src, const Image& dest, size_t yBegin, size_t yEnd)
+    {
+        const size_t width = src.width;
+
+        // Allocate temporary space (3 scanlines)
+        ScopedAlignedArrayXMVECTOR scanline(static_cast<XMVECTOR*>(_aligned_malloc((sizeof(XMVECTOR)*width * 3), 16)));
+        if (!scanline)
+            return E_OUTOFMEMORY;
+
+        XMVECTOR* target = scanline.get();
+
+        XMVECTOR* urow0 = target + width;
+        XMVECTOR* urow1 = (src.height > 1) ? target + width * 2 : urow0;
+
+        const XMVECTOR* urow2 = (width > 1) ? urow0 + 1 : urow0;
+        const XMVECTOR* urow3 = (width > 1) ? urow1 + 1 : urow1;
+
+        const size_t srcRows = (urow0 != urow1) ? 2 : 1;
+        const uint8_t* pSrc = src.pixels + src.rowPitch * srcRows * yBegin;
+        uint8_t* pDest = dest.pixels + dest.rowPitch * yBegin;
+
+        for (size_t y = yBegin; y < yEnd; ++y)
+        {
+            if (!_LoadScanlineLinear(urow0, width, pSrc, src.rowPitch, src.format, filter))
+                return E_FAIL;
+            pSrc += src.rowPitch;
+
+            if (urow0 != urow1)
+            {
+                if (!_LoadScanlineLinear(urow1, width, pSrc, src.rowPitch, src.format, filter))
+                    return E_FAIL;
+                pSrc += src.rowPitch;
+            }
+
+            for (size_t x = 0; x < dest.width; ++x)
+            {
+                size_t x2 = x << 1;
+
+                AVERAGE4(target[x], urow0[x2], urow1[x2], urow2[x2], urow3[x2]);
+            }
+
+            if (!_StoreScanlineLinear(pDest, dest.rowPitch, dest.format, target, dest.width, filter))
+                return E_FAIL;
+            pDest += dest.rowPitch;
+        }
+
+        return S_OK;
+    }
+
+
+    //--- Fused 2D Box Filter ---
+    // Reduces tiles of one level by several levels at once, keeping the intermediate levels as linear
+    // floats in a cache sized buffer. Only each result level is converted and stored.
+    const size_t FUSED_TILE_SIZE = 64;      // 64 x 64 XMVECTORs = 64 KB
+    const size_t FUSED_TILE_LEVELS = 6;     // log2(FUSED_TILE_SIZE)
+
+    bool UseFusedBoxFilter(_In_ DXGI_FORMAT format)
+    {
+        switch (format)
+        {
+        case DXGI_FORMAT_R8G8B8A8_UNORM:
+        case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+        case DXGI_FORMAT_B8G8R8A8_UNORM:
+        case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+        case DXGI_FORMAT_R16G16B16A16_FLOAT:
+        case DXGI_FORMAT_R32G32B32A32_FLOAT:
+            return true;
+
+        default:
+            return false;
+        }
+    }
+
+    // Linear (x) and UNORM (y) values of every 8-bit sRGB code, so loading an sRGB texel is a table
+    // lookup instead of XMColorSRGBToRGB. Built with the same functions as _LoadScanlineLinear.
+    struct SRGBTable
+    {
+        XMFLOAT2 values[256];
+
+        SRGBTable() noexcept
+        {
+            for (uint32_t i = 0; i < 256; ++i)
+            {
+                XMUBYTEN4 code(uint8_t(i), uint8_t(i), uint8_t(i), uint8_t(i));
+                XMVECTOR v = XMColorSRGBToRGB(XMLoadUByteN4(&code));
+                values[i] = XMFLOAT2(XMVectorGetX(v), XMVectorGetW(v));
+            }
+        }
+    };
+
+    bool LoadFusedTileRow(
+        _Out_writes_(count) XMVECTOR* pDestination, size_t count,
+        _In_reads_bytes_(size) const uint8_t* pSource, size_t size, DXGI_FORMAT format, DWORD filter)
+    {
+        bool bgr;
+        switch (format)
+        {
+        case DXGI_FORMAT_R8G8B8A8_UNORM:
+        case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:   bgr = false; break;
+        case DXGI_FORMAT_B8G8R8A8_UNORM:
+        case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:   bgr = true; break;
+        default:
+            return _LoadScanlineLinear(pDestination, count, pSource, size, format, filter);
+        }
+
+        if (!(filter & TEX_FILTER_SRGB_IN) && !IsSRGB(format))
+            return _LoadScanlineLinear(pDestination, count, pSource, size, format, filter);
+
+        if (size < count * 4)
+            return false;
+
+        static const SRGBTable s_srgb;
+        const XMFLOAT2* table = s_srgb.values;
+        for (size_t x = 0; x < count; ++x, pSource += 4)
+        {
+            const uint8_t r = pSource[bgr ? 2 : 0];
+            const uint8_t b = pSource[bgr ? 0 : 2];
+            pDestination[x] = XMVectorSet(table[r].x, table[pSource[1]].x, table[b].x, table[pSource[3]].y);
+        }
+
+        return true;
+    }
+
+    // Generates levels srcLevel + 1 ... srcLevel + count of one tile of srcLevel. The source dimensions
+    // are powers of two, so a tile is either FUSED_TILE_SIZE or the whole image along each axis.
+    HRESULT GenerateFusedBoxTile(
+        DWORD filter, const ScratchImage& mipChain, size_t item, size_t srcLevel, size_t count, size_t tileX, size_t tileY)
+    {
+        const Image* src = mipChain.GetImage(srcLevel, item, 0);
+        if (!src)
+            return E_POINTER;
+
+        const size_t bpp = BitsPerPixel(src->format) / 8;
+        const size_t x0 = tileX * FUSED_TILE_SIZE;
+        const size_t y0 = tileY * FUSED_TILE_SIZE;
+        size_t width = std::min(FUSED_TILE_SIZE, src->width - x0);
+        size_t height = std::min(FUSED_TILE_SIZE, src->height - y0);
+
+        // Tile plus one scanline, since _StoreScanlineLinear converts its source in place
+        ScopedAlignedArrayXMVECTOR scanline(static_cast<XMVECTOR*>(_aligned_malloc((sizeof(XMVECTOR) * FUSED_TILE_SIZE * (FUSED_TILE_SIZE + 1)), 16)));
+        if (!scanline)
+            return E_OUTOFMEMORY;
+
+        XMVECTOR* tile = scanline.get();
+        XMVECTOR* target = tile + FUSED_TILE_SIZE * FUSED_TILE_SIZE;
+
+        const uint8_t* pSrc = src->pixels + y0 * src->rowPitch + x0 * bpp;
+        for (size_t y = 0; y < height; ++y, pSrc += src->rowPitch)
+        {
+            if (!LoadFusedTileRow(tile + y * FUSED_TILE_SIZE, width, pSrc, src->rowPitch - x0 * bpp, src->format, filter))
+                return E_FAIL;
+        }
+
+        for (size_t level = 1; level <= count; ++level)
+        {
+            const Image* dest = mipChain.GetImage(srcLevel + level, item, 0);
+            if (!dest)
+                return E_POINTER;
+
+            const size_t nwidth = (width > 1) ? (width >> 1) : 1;
+            const size_t nheight = (height > 1) ? (height >> 1) : 1;
+            const size_t dx = x0 >> level;
+            const size_t dy = y0 >> level;
+
+            // 2x2 reduction in place; texel (x, y) only reads texels at or after (2x, 2y)
+            for (size_t y = 0; y < nheight; ++y)
+            {
+                const XMVECTOR* urow0 = tile + ((height > 1) ? (y << 1) : 0) * FUSED_TILE_SIZE;
+                const XMVECTOR* urow1 = (height > 1) ? urow0 + FUSED_TILE_SIZE : urow0;
+                const size_t step = (width > 1) ? 1 : 0;
+
+                XMVECTOR* row = tile + y * FUSED_TILE_SIZE;
+                for (size_t x = 0; x < nwidth; ++x)
+                {
+                    size_t x2 = (width > 1) ? (x << 1) : 0;
+
+                    AVERAGE4(row[x], urow0[x2], urow1[x2], urow0[x2 + step], urow1[x2 + step]);
+                }
+
+                memcpy(target, row, sizeof(XMVECTOR) * nwidth);
+
+                uint8_t* pDest = dest->pixels + (dy + y) * dest->rowPitch + dx * bpp;
+                if (!_StoreScanlineLinear(pDest, dest->rowPitch - dx * bpp, dest->format, target, nwidth, filter))
+                    return E_FAIL;
+            }
+
+            width = nwidth;
+            height = nheight;
+        }
+
+        return S_OK;
+    }
+
+
     //--- 2D Linear Filter ---
     HRESULT Generate2DMipsLinearFilter(size_t levels, DWORD filter, const ScratchImage& mipChain, size_t item)
     {
@@ -3180,6 +3419,199 @@ HRESULT DirectX::GenerateMipMaps(
     }
 }
 
+_Use_decl_annotations_
+HRESULT DirectX::GenerateMipMaps(
+    const Image* srcImages,
+    size_t nimages,
+    const TexMetadata& metadata,
+    DWORD filter,
+    size_t levels,
+    const ParallelOptions& options,
+    ScratchImage& mipChain)
+{
+    if (!srcImages || !nimages || !IsValid(metadata.format))
+        return E_INVALIDARG;
+
+    if (metadata.IsVolumemap()
+        || IsCompressed(metadata.format) || IsTypeless(metadata.format) || IsPlanar(metadata.format) || IsPalettized(metadata.format))
+        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+
+    // WIC objects are not shared across the worker threads, so only the custom filters are used
+    if (filter & TEX_FILTER_FORCE_WIC)
+        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+
+    if (!_CalculateMipLevels(metadata.width, metadata.height, levels))
+        return E_INVALIDARG;
+
+    if (levels <= 1)
+        return E_INVALIDARG;
+
+    std::vector<Image> baseImages;
+    baseImages.reserve(metadata.arraySize);
+    for (size_t item = 0; item < metadata.arraySize; ++item)
+    {
+        size_t index = metadata.ComputeIndex(0, item, 0);
+        if (index >= nimages)
+            return E_FAIL;
+
+        const Image& src = srcImages[index];
+        if (!src.pixels)
+            return E_POINTER;
+
+        if (src.format != metadata.format || src.width != metadata.width || src.height != metadata.height)
+        {
+            // All base images must be the same format, width, and height
+            return E_FAIL;
+        }
+
+        baseImages.push_back(src);
+    }
+
+    assert(baseImages.size() == metadata.arraySize);
+
+    if (baseImages.empty())
+        return E_UNEXPECTED;
+
+    TexMetadata mdata2 = metadata;
+    mdata2.mipLevels = levels;
+
+    DWORD filter_select = (filter & TEX_FILTER_MASK);
+    if (!filter_select)
+    {
+        // Default filter choice
+        filter_select = (ispow2(metadata.width) && ispow2(metadata.height)) ? TEX_FILTER_BOX : TEX_FILTER_LINEAR;
+    }
+
+    switch (filter_select)
+    {
+    case TEX_FILTER_BOX:
+        if (!ispow2(metadata.width) || !ispow2(metadata.height))
+            return E_FAIL;
+        break;
+
+    case TEX_FILTER_POINT:
+    case TEX_FILTER_LINEAR:
+    case TEX_FILTER_CUBIC:
+    case TEX_FILTER_TRIANGLE:
+        break;
+
+    default:
+        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+    }
+
+    HRESULT hr = Setup2DMips(&baseImages[0], metadata.arraySize, mdata2, mipChain);
+    if (FAILED(hr))
+        return hr;
+
+    if (filter_select != TEX_FILTER_BOX && filter_select != TEX_FILTER_POINT)
+    {
+        // The other filters carry state from level to level, so each array item is one task
+        hr = _ParallelFor(metadata.arraySize, options, 0, metadata.arraySize,
+            [&](size_t item) -> HRESULT
+        {
+            switch (filter_select)
+            {
+            case TEX_FILTER_LINEAR:     return Generate2DMipsLinearFilter(levels, filter, mipChain, item);
+            case TEX_FILTER_CUBIC:      return Generate2DMipsCubicFilter(levels, filter, mipChain, item);
+            default:                    return Generate2DMipsTriangleFilter(levels, filter, mipChain, item);
+            }
+        });
+
+        if (FAILED(hr))
+            mipChain.Release();
+
+        return hr;
+    }
+
+    if (filter_select == TEX_FILTER_BOX && UseFusedBoxFilter(metadata.format))
+    {
+        // Each pass reduces all tiles of one level by up to FUSED_TILE_LEVELS levels; once a level fits into
+        // a single tile, the pass finishes the chain
+        size_t total = 0;
+        for (size_t level = 0; level + 1 < levels; level += FUSED_TILE_LEVELS)
+        {
+            const size_t tiles = ((std::max<size_t>(1, metadata.width >> level) + FUSED_TILE_SIZE - 1) / FUSED_TILE_SIZE)
+                * ((std::max<size_t>(1, metadata.height >> level) + FUSED_TILE_SIZE - 1) / FUSED_TILE_SIZE);
+            total += metadata.arraySize * tiles;
+            if (tiles == 1)
+                break;
+        }
+
+        size_t done = 0;
+        for (size_t level = 0; level + 1 < levels; )
+        {
+            const size_t tilesX = (std::max<size_t>(1, metadata.width >> level) + FUSED_TILE_SIZE - 1) / FUSED_TILE_SIZE;
+            const size_t tilesY = (std::max<size_t>(1, metadata.height >> level) + FUSED_TILE_SIZE - 1) / FUSED_TILE_SIZE;
+            const size_t tiles = tilesX * tilesY;
+            const size_t count = (tiles == 1) ? (levels - 1 - level) : std::min(FUSED_TILE_LEVELS, levels - 1 - level);
+
+            hr = _ParallelFor(metadata.arraySize * tiles, options, done, total,
+                [&](size_t task) -> HRESULT
+            {
+                const size_t tile = task % tiles;
+                return GenerateFusedBoxTile(filter, mipChain, task / tiles, level, count, tile % tilesX, tile / tilesX);
+            });
+
+            if (FAILED(hr))
+            {
+                mipChain.Release();
+                return hr;
+            }
+
+            done += metadata.arraySize * tiles;
+            level += count;
+        }
+
+        return S_OK;
+    }
+
+    // Every level depends on the one before it, so the levels run one after the other and the
+    // rows of a level are split into bands across all array items
+    const size_t rowsPerTask = 16;
+
+    size_t total = 0;
+    for (size_t level = 1; level < levels; ++level)
+    {
+        size_t nheight = std::max<size_t>(1, metadata.height >> level);
+        total += metadata.arraySize * ((nheight + rowsPerTask - 1) / rowsPerTask);
+    }
+
+    size_t done = 0;
+    for (size_t level = 1; level < levels; ++level)
+    {
+        const size_t nheight = std::max<size_t>(1, metadata.height >> level);
+        const size_t bands = (nheight + rowsPerTask - 1) / rowsPerTask;
+
+        hr = _ParallelFor(metadata.arraySize * bands, options, done, total,
+            [&](size_t task) -> HRESULT
+        {
+            const size_t item = task / bands;
+            const size_t yBegin = (task % bands) * rowsPerTask;
+            const size_t yEnd = std::min(yBegin + rowsPerTask, nheight);
+
+            const Image* src = mipChain.GetImage(level - 1, item, 0);
+            const Image* dest = mipChain.GetImage(level, item, 0);
+            if (!src || !dest)
+                return E_POINTER;
+
+            if (filter_select == TEX_FILTER_BOX)
+                return Generate2DMipRowsBoxFilter(filter, *src, *dest, yBegin, yEnd);
+            else
+                return Generate2DMipRowsPointFilter(*src, *dest, yBegin, yEnd);
+        });
+
+        if (FAILED(hr))
+        {
+            mipChain.Release();
+            return hr;
+        }
+
+        done += metadata.arraySize * bands;
+    }
+
+    return S_OK;
+}
+
 
 //-------------------------------------------------------------------------------------
 // Generate mipmap chain for volume texture
@@ -17,6 +17,30 @@ namespace
 {
     const XMVECTORF32 g_Gamma22 = { { { 2.2f, 2.2f, 2.2f, 1.f } } };
 
+    //-------------------------------------------------------------------------------------
+    DWORD GetImpliedFlags(DXGI_FORMAT format, DWORD srgbFlag)
+    {
+        switch (format)
+        {
+        case DXGI_FORMAT_B8G8R8X8_UNORM:
+            return CMSE_IGNORE_ALPHA;
+
+        case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+            return srgbFlag | CMSE_IGNORE_ALPHA;
+
+        case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+        case DXGI_FORMAT_BC1_UNORM_SRGB:
+        case DXGI_FORMAT_BC2_UNORM_SRGB:
+        case DXGI_FORMAT_BC3_UNORM_SRGB:
+        case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+        case DXGI_FORMAT_BC7_UNORM_SRGB:
+            return srgbFlag;
+
+        default:
+            return 0;
+        }
+    }
+
     //-------------------------------------------------------------------------------------
     HRESULT ComputeMSE_(
         const Image& image1,
@@ -38,51 +62,7 @@ namespace
             return E_OUTOFMEMORY;
 
         // Flags implied from image formats
-        switch (image1.format)
-        {
-        case DXGI_FORMAT_B8G8R8X8_UNORM:
-            flags |= CMSE_IGNORE_ALPHA;
-            break;
-
-        case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
-            flags |= CMSE_IMAGE1_SRGB | CMSE_IGNORE_ALPHA;
-            break;
-
-        case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
-        case DXGI_FORMAT_BC1_UNORM_SRGB:
-        case DXGI_FORMAT_BC2_UNORM_SRGB:
-        case DXGI_FORMAT_BC3_UNORM_SRGB:
-        case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
-        case DXGI_FORMAT_BC7_UNORM_SRGB:
-            flags |= CMSE_IMAGE1_SRGB;
-            break;
-
-        default:
-            break;
-        }
-
-        switch (image2.format)
-        {
-        case DXGI_FORMAT_B8G8R8X8_UNORM:
-            flags |= CMSE_IGNORE_ALPHA;
-            break;
-
-        case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
-            flags |= CMSE_IMAGE2_SRGB | CMSE_IGNORE_ALPHA;
-            break;
-
-        case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
-        case DXGI_FORMAT_BC1_UNORM_SRGB:
-        case DXGI_FORMAT_BC2_UNORM_SRGB:
-        case DXGI_FORMAT_BC3_UNORM_SRGB:
-        case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
-        case DXGI_FORMAT_BC7_UNORM_SRGB:
-            flags |= CMSE_IMAGE2_SRGB;
-            break;
-
-        default:
-            break;
-        }
+        flags |= GetImpliedFlags(image1.format, CMSE_IMAGE1_SRGB) | GetImpliedFlags(image2.format, CMSE_IMAGE2_SRGB);
 
         const uint8_t *pSrc1 = image1.pixels;
         const size_t rowPitch1 = image1.rowPitch;
@@ -255,6 +235,263 @@ namespace
 
         return S_OK;
     }
+
+    //-------------------------------------------------------------------------------------
+    // Image metrics
+    //-------------------------------------------------------------------------------------
+
+    // Rows are processed in bands of 4 and reduced into 4x4 blocks; an SSIM window is 2x2 blocks
+    const size_t METRICS_BAND = 4;
+
+    const double SSIM_C1 = 0.01 * 0.01;
+    const double SSIM_C2 = 0.03 * 0.03;
+
+    struct MetricsBlock
+    {
+        XMFLOAT4 sum1;
+        XMFLOAT4 sum2;
+        XMFLOAT4 sumSq;     // x1^2 + x2^2
+        XMFLOAT4 sum12;
+        float count;
+    };
+
+    struct MetricsBand
+    {
+        double sumSq[4];
+        float maxError;
+        size_t maxErrorX;
+        size_t maxErrorY;
+    };
+
+    struct MetricsPair
+    {
+        const Image* image1;
+        const Image* image2;
+        const Image* heatmap;
+        DWORD flags;
+        size_t blocksX;
+        size_t blocksY;
+        size_t windowsX;
+        size_t windowRows;
+        std::unique_ptr<MetricsBlock[]> blocks;
+
+        bool IsSingleWindow() const { return (blocksX < 2) || (blocksY < 2); }
+    };
+
+    struct WindowSums
+    {
+        double sum1[4];
+        double sum2[4];
+        double sumSq[4];
+        double sum12[4];
+        double count;
+
+        void Add(const MetricsBlock& block)
+        {
+            const float* s1 = &block.sum1.x;
+            const float* s2 = &block.sum2.x;
+            const float* ss = &block.sumSq.x;
+            const float* s12 = &block.sum12.x;
+            for (size_t j = 0; j < 4; ++j)
+            {
+                sum1[j] += s1[j];
+                sum2[j] += s2[j];
+                sumSq[j] += ss[j];
+                sum12[j] += s12[j];
+            }
+            count += block.count;
+        }
+
+        void AccumulateSSIM(_Inout_updates_all_(4) double* ssim) const
+        {
+            for (size_t j = 0; j < 4; ++j)
+            {
+                // SSIM = (2 m1 m2 + C1)(2 cov + C2) / ((m1^2 + m2^2 + C1)(var1 + var2 + C2))
+                double m1 = sum1[j] / count;
+                double m2 = sum2[j] / count;
+                double var = sumSq[j] / count - m1 * m1 - m2 * m2;
+                double cov = sum12[j] / count - m1 * m2;
+                ssim[j] += ((2 * m1 * m2 + SSIM_C1) * (2 * cov + SSIM_C2))
+                    / ((m1 * m1 + m2 * m2 + SSIM_C1) * (var + SSIM_C2));
+            }
+        }
+    };
+
+    inline XMVECTOR XM_CALLCONV PrepareMetricsPixel(FXMVECTOR pixel, bool srgb, bool x2bias, FXMVECTOR ignore)
+    {
+        static const XMVECTORF32 two = { { { 2.0f, 2.0f, 2.0f, 2.0f } } };
+
+        XMVECTOR v = pixel;
+        if (srgb)
+        {
+            v = XMVectorPow(v, g_Gamma22);
+        }
+        if (x2bias)
+        {
+            v = XMVectorMultiplyAdd(v, two, g_XMNegativeOne);
+        }
+
+        // Ignored channels are zero in both images, so they have no error and a perfect SSIM
+        return XMVectorSelect(v, g_XMZero, ignore);
+    }
+
+    //-------------------------------------------------------------------------------------
+    HRESULT ComputeMetricsBand(const MetricsPair& pair, size_t band, MetricsBand& result)
+    {
+        const Image& image1 = *pair.image1;
+        const Image& image2 = *pair.image2;
+        const size_t width = image1.width;
+        const DWORD flags = pair.flags;
+
+        ScopedAlignedArrayXMVECTOR scanline(static_cast<XMVECTOR*>(_aligned_malloc(sizeof(XMVECTOR) * (width * 2 + pair.blocksX * 4), 16)));
+        if (!scanline)
+            return E_OUTOFMEMORY;
+
+        XMVECTOR* row1 = scanline.get();
+        XMVECTOR* row2 = row1 + width;
+        XMVECTOR* blockAcc = row2 + width;
+        for (size_t i = 0; i < pair.blocksX * 4; ++i)
+            blockAcc[i] = g_XMZero;
+
+        const XMVECTOR ignore = XMVectorSelectControl(
+            (flags & CMSE_IGNORE_RED) ? 1u : 0u,
+            (flags & CMSE_IGNORE_GREEN) ? 1u : 0u,
+            (flags & CMSE_IGNORE_BLUE) ? 1u : 0u,
+            (flags & CMSE_IGNORE_ALPHA) ? 1u : 0u);
+
+        const size_t y0 = band * METRICS_BAND;
+        const size_t y1 = std::min(y0 + METRICS_BAND, image1.height);
+
+        for (size_t j = 0; j < 4; ++j)
+            result.sumSq[j] = 0;
+        result.maxError = 0;
+        result.maxErrorX = 0;
+        result.maxErrorY = y0;
+
+        for (size_t y = y0; y < y1; ++y)
+        {
+            if (!_LoadScanline(row1, width, image1.pixels + y * image1.rowPitch, image1.rowPitch, image1.format))
+                return E_FAIL;
+
+            if (!_LoadScanline(row2, width, image2.pixels + y * image2.rowPitch, image2.rowPitch, image2.format))
+                return E_FAIL;
+
+            float* heat = pair.heatmap ? reinterpret_cast<float*>(pair.heatmap->pixels + y * pair.heatmap->rowPitch) : nullptr;
+
+            XMVECTOR acc = g_XMZero;
+            for (size_t x = 0; x < width; ++x)
+            {
+                XMVECTOR v1 = PrepareMetricsPixel(row1[x], (flags & CMSE_IMAGE1_SRGB) != 0, (flags & CMSE_IMAGE1_X2_BIAS) != 0, ignore);
+                XMVECTOR v2 = PrepareMetricsPixel(row2[x], (flags & CMSE_IMAGE2_SRGB) != 0, (flags & CMSE_IMAGE2_X2_BIAS) != 0, ignore);
+
+                // sum[ (I1 - I2)^2 ]
+                XMVECTOR d = XMVectorSubtract(v1, v2);
+                acc = XMVectorMultiplyAdd(d, d, acc);
+
+                // Largest channel error
+                XMVECTOR e = XMVectorAbs(d);
+                e = XMVectorMax(e, XMVectorSwizzle<1, 0, 3, 2>(e));
+                e = XMVectorMax(e, XMVectorSwizzle<2, 3, 0, 1>(e));
+                float error = XMVectorGetX(e);
+                if (heat)
+                {
+                    heat[x] = error;
+                }
+                if (error > result.maxError)
+                {
+                    result.maxError = error;
+                    result.maxErrorX = x;
+                    result.maxErrorY = y;
+                }
+
+                // 4x4 block sums for SSIM
+                XMVECTOR* block = blockAcc + (x / METRICS_BAND) * 4;
+                block[0] = XMVectorAdd(block[0], v1);
+                block[1] = XMVectorAdd(block[1], v2);
+                block[2] = XMVectorMultiplyAdd(v1, v1, XMVectorMultiplyAdd(v2, v2, block[2]));
+                block[3] = XMVectorMultiplyAdd(v1, v2, block[3]);
+            }
+
+            XMFLOAT4 rowSq;
+            XMStoreFloat4(&rowSq, acc);
+            result.sumSq[0] += rowSq.x;
+            result.sumSq[1] += rowSq.y;
+            result.sumSq[2] += rowSq.z;
+            result.sumSq[3] += rowSq.w;
+        }
+
+        MetricsBlock* blocks = pair.blocks.get() + band * pair.blocksX;
+        for (size_t bx = 0; bx < pair.blocksX; ++bx)
+        {
+            const size_t x0 = bx * METRICS_BAND;
+            XMStoreFloat4(&blocks[bx].sum1, blockAcc[bx * 4]);
+            XMStoreFloat4(&blocks[bx].sum2, blockAcc[bx * 4 + 1]);
+            XMStoreFloat4(&blocks[bx].sumSq, blockAcc[bx * 4 + 2]);
+            XMStoreFloat4(&blocks[bx].sum12, blockAcc[bx * 4 + 3]);
+            blocks[bx].count = float((std::min(x0 + METRICS_BAND, width) - x0) * (y1 - y0));
+        }
+
+        return S_OK;
+    }
+
+    //-------------------------------------------------------------------------------------
+    void ComputeMetricsWindowRow(const MetricsPair& pair, size_t row, _Out_writes_all_(4) double* ssim)
+    {
+        for (size_t j = 0; j < 4; ++j)
+            ssim[j] = 0;
+
+        const MetricsBlock* blocks = pair.blocks.get();
+
+        if (pair.IsSingleWindow())
+        {
+            // Too small for 8x8 windows, so the whole image is one window
+            WindowSums sums = {};
+            for (size_t i = 0; i < pair.blocksX * pair.blocksY; ++i)
+                sums.Add(blocks[i]);
+            sums.AccumulateSSIM(ssim);
+            return;
+        }
+
+        const MetricsBlock* top = blocks + row * pair.blocksX;
+        const MetricsBlock* bottom = top + pair.blocksX;
+        for (size_t x = 0; x < pair.windowsX; ++x)
+        {
+            WindowSums sums = {};
+            sums.Add(top[x]);
+            sums.Add(top[x + 1]);
+            sums.Add(bottom[x]);
+            sums.Add(bottom[x + 1]);
+            sums.AccumulateSSIM(ssim);
+        }
+    }
+
+    //-------------------------------------------------------------------------------------
+    HRESULT DecompressForMetrics(const Image& image, const ParallelOptions& options, ScratchImage& temp, const Image*& result)
+    {
+        result = &image;
+        if (!IsCompressed(image.format))
+            return S_OK;
+
+        TexMetadata mdata = {};
+        mdata.width = image.width;
+        mdata.height = image.height;
+        mdata.depth = mdata.arraySize = mdata.mipLevels = 1;
+        mdata.format = image.format;
+        mdata.dimension = TEX_DIMENSION_TEXTURE2D;
+
+        HRESULT hr = Decompress(&image, 1, mdata, DXGI_FORMAT_R32G32B32A32_FLOAT, options, temp);
+        if (FAILED(hr))
+            return hr;
+
+        result = temp.GetImage(0, 0, 0);
+        return result ? S_OK : E_POINTER;
+    }
+
+    inline size_t FindPair(_In_reads_(nimages + 1) const size_t* starts, size_t nimages, size_t index)
+    {
+        return size_t(std::upper_bound(starts, starts + nimages + 1, index) - starts) - 1;
+    }
+
 };
 
 
@@ -462,6 +699,241 @@ HRESULT DirectX::ComputeMSE(
 }
 
 
+//-------------------------------------------------------------------------------------
+// Computes MSE, PSNR, SSIM and the largest error between pairs of images
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DirectX::ComputeImageMetrics(
+    const Image& image1,
+    const Image& image2,
+    DWORD flags,
+    const ParallelOptions& options,
+    ImageMetrics& metrics,
+    ScratchImage* heatmap)
+{
+    TexMetadata mdata = {};
+    mdata.width = image1.width;
+    mdata.height = image1.height;
+    mdata.depth = mdata.arraySize = mdata.mipLevels = 1;
+    mdata.format = image1.format;
+    mdata.dimension = TEX_DIMENSION_TEXTURE2D;
+
+    return ComputeImageMetrics(&image1, &image2, 1, mdata, flags, options, &metrics, heatmap);
+}
+
+_Use_decl_annotations_
+HRESULT DirectX::ComputeImageMetrics(
+    const Image* images1,
+    const Image* images2,
+    size_t nimages,
+    const TexMetadata& metadata,
+    DWORD flags,
+    const ParallelOptions& options,
+    ImageMetrics* metrics,
+    ScratchImage* heatmaps)
+{
+    if (!images1 || !images2 || !nimages || !metrics)
+        return E_INVALIDARG;
+
+    for (size_t index = 0; index < nimages; ++index)
+    {
+        const Image& image1 = images1[index];
+        const Image& image2 = images2[index];
+
+        if (!image1.pixels || !image2.pixels)
+            return E_POINTER;
+
+        if (image1.width != image2.width || image1.height != image2.height)
+            return E_INVALIDARG;
+
+        if (!IsValid(image1.format) || !IsValid(image2.format))
+            return E_INVALIDARG;
+
+        if (IsPlanar(image1.format) || IsPlanar(image2.format)
+            || IsPalettized(image1.format) || IsPalettized(image2.format)
+            || IsTypeless(image1.format) || IsTypeless(image2.format))
+            return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+    }
+
+    if (heatmaps)
+        heatmaps->Release();
+
+    std::unique_ptr<MetricsPair[]> pairs(new (std::nothrow) MetricsPair[nimages]);
+    std::unique_ptr<ScratchImage[]> temps(new (std::nothrow) ScratchImage[nimages * 2]);
+    std::unique_ptr<size_t[]> bandStarts(new (std::nothrow) size_t[nimages + 1]);
+    std::unique_ptr<size_t[]> rowStarts(new (std::nothrow) size_t[nimages + 1]);
+    if (!pairs || !temps || !bandStarts || !rowStarts)
+        return E_OUTOFMEMORY;
+
+    // Compressed images are expanded to RGBA32F one at a time, reporting progress only for the metrics
+    ParallelOptions decompressOptions = options;
+    decompressOptions.progress = nullptr;
+
+    bandStarts[0] = rowStarts[0] = 0;
+    for (size_t index = 0; index < nimages; ++index)
+    {
+        MetricsPair& pair = pairs[index];
+
+        HRESULT hr = DecompressForMetrics(images1[index], decompressOptions, temps[index * 2], pair.image1);
+        if (FAILED(hr))
+            return hr;
+
+        hr = DecompressForMetrics(images2[index], decompressOptions, temps[index * 2 + 1], pair.image2);
+        if (FAILED(hr))
+            return hr;
+
+        pair.heatmap = nullptr;
+        pair.flags = flags
+            | GetImpliedFlags(pair.image1->format, CMSE_IMAGE1_SRGB)
+            | GetImpliedFlags(pair.image2->format, CMSE_IMAGE2_SRGB);
+        pair.blocksX = (pair.image1->width + METRICS_BAND - 1) / METRICS_BAND;
+        pair.blocksY = (pair.image1->height + METRICS_BAND - 1) / METRICS_BAND;
+        pair.windowsX = pair.IsSingleWindow() ? 1 : pair.blocksX - 1;
+        pair.windowRows = pair.IsSingleWindow() ? 1 : pair.blocksY - 1;
+        pair.blocks.reset(new (std::nothrow) MetricsBlock[pair.blocksX * pair.blocksY]);
+        if (!pair.blocks)
+            return E_OUTOFMEMORY;
+
+        bandStarts[index + 1] = bandStarts[index] + pair.blocksY;
+        rowStarts[index + 1] = rowStarts[index] + pair.windowRows;
+    }
+
+    if (heatmaps)
+    {
+        TexMetadata mdata2 = metadata;
+        mdata2.format = DXGI_FORMAT_R32_FLOAT;
+        mdata2.miscFlags2 = 0;
+        HRESULT hr = heatmaps->Initialize(mdata2);
+        if (FAILED(hr))
+            return hr;
+
+        if (nimages != heatmaps->GetImageCount())
+        {
+            heatmaps->Release();
+            return E_FAIL;
+        }
+
+        const Image* dest = heatmaps->GetImages();
+        for (size_t index = 0; index < nimages; ++index)
+        {
+            if (dest[index].width != images1[index].width || dest[index].height != images1[index].height)
+            {
+                heatmaps->Release();
+                return E_FAIL;
+            }
+
+            pairs[index].heatmap = &dest[index];
+        }
+    }
+
+    const size_t totalBands = bandStarts[nimages];
+    const size_t totalRows = rowStarts[nimages];
+
+    std::unique_ptr<MetricsBand[]> bands(new (std::nothrow) MetricsBand[totalBands]);
+    std::unique_ptr<double[]> rowSSIM(new (std::nothrow) double[totalRows * 4]);
+    if (!bands || !rowSSIM)
+    {
+        if (heatmaps)
+            heatmaps->Release();
+        return E_OUTOFMEMORY;
+    }
+
+    // Bands of all pairs are scheduled together, then the SSIM window rows once all blocks are known
+    HRESULT hr = _ParallelFor(totalBands, options, 0, totalBands + totalRows,
+        [&](size_t band) -> HRESULT
+    {
+        size_t index = FindPair(bandStarts.get(), nimages, band);
+        return ComputeMetricsBand(pairs[index], band - bandStarts[index], bands[band]);
+    });
+
+    if (SUCCEEDED(hr))
+    {
+        hr = _ParallelFor(totalRows, options, totalBands, totalBands + totalRows,
+            [&](size_t row) -> HRESULT
+        {
+            size_t index = FindPair(rowStarts.get(), nimages, row);
+            ComputeMetricsWindowRow(pairs[index], row - rowStarts[index], &rowSSIM[row * 4]);
+            return S_OK;
+        });
+    }
+
+    if (FAILED(hr))
+    {
+        if (heatmaps)
+            heatmaps->Release();
+        return hr;
+    }
+
+    // Reduce in order, so the results do not depend on the thread count
+    for (size_t index = 0; index < nimages; ++index)
+    {
+        const MetricsPair& pair = pairs[index];
+        ImageMetrics& result = metrics[index];
+
+        double sumSq[4] = {};
+        double ssim[4] = {};
+        result.maxError = 0;
+        result.maxErrorX = result.maxErrorY = 0;
+
+        for (size_t band = bandStarts[index]; band < bandStarts[index + 1]; ++band)
+        {
+            for (size_t j = 0; j < 4; ++j)
+                sumSq[j] += bands[band].sumSq[j];
+
+            if (bands[band].maxError > result.maxError)
+            {
+                result.maxError = bands[band].maxError;
+                result.maxErrorX = bands[band].maxErrorX;
+                result.maxErrorY = bands[band].maxErrorY;
+            }
+        }
+
+        for (size_t row = rowStarts[index]; row < rowStarts[index + 1]; ++row)
+        {
+            for (size_t j = 0; j < 4; ++j)
+                ssim[j] += rowSSIM[row * 4 + j];
+        }
+
+        // MSE = sum[ (I1 - I2)^2 ] / w*h
+        const double pixels = double(pair.image1->width * pair.image1->height);
+        const double windows = double(pair.windowsX * pair.windowRows);
+        for (size_t j = 0; j < 4; ++j)
+        {
+            result.mseV[j] = float(sumSq[j] / pixels);
+            result.ssimV[j] = float(ssim[j] / windows);
+        }
+        result.mse = result.mseV[0] + result.mseV[1] + result.mseV[2] + result.mseV[3];
+
+        // PSNR and SSIM cover the color channels which are not ignored, or alpha if all of them are
+        double mseSum = 0;
+        double ssimSum = 0;
+        size_t channels = 0;
+        for (size_t j = 0; j < 4; ++j)
+        {
+            if ((j == 3 && channels > 0) || (pair.flags & (CMSE_IGNORE_RED << j)))
+                continue;
+
+            mseSum += result.mseV[j];
+            ssimSum += result.ssimV[j];
+            ++channels;
+        }
+
+        if (!channels)
+        {
+            result.psnr = INFINITY;
+            result.ssim = 1.f;
+        }
+        else
+        {
+            result.psnr = (mseSum > 0) ? float(10.0 * log10(double(channels) / mseSum)) : INFINITY;
+            result.ssim = float(ssimSum / double(channels));
+        }
+    }
+
+    return S_OK;
+}
+
+
 //-------------------------------------------------------------------------------------
 // Evaluates a user-supplied function for all the pixels in the image
 //-------------------------------------------------------------------------------------
@@ -73,174 +73,248 @@ namespace
         }
     }
 
-    HRESULT ComputeNMap(_In_ const Image& srcImage, _In_ DWORD flags, _In_ float amplitude,
-        _In_ DXGI_FORMAT format, _In_ const Image& normalMap)
+    // Rows per task for both passes
+    const size_t NMAP_BAND = 16;
+
+    // The heights of one image are evaluated once into height + 2 rows of 'pitch' floats. Every row
+    // holds its wrapped or mirrored neighbors at both ends, and the first and last rows are the
+    // neighbors above and below the image, so the normal kernel never checks for a border. The
+    // pitch leaves room for the last vector to read past the width.
+    struct NMapImage
     {
-        if (!srcImage.pixels || !normalMap.pixels)
-            return E_INVALIDARG;
-
-        const DWORD convFlags = _GetConvertFlags(format);
-        if (!convFlags)
-            return E_FAIL;
-
-        if (!(convFlags & (CONVF_UNORM | CONVF_SNORM | CONVF_FLOAT)))
-            return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
-
+        const Image*            src;
+        const Image*            dest;
+        size_t                  pitch;
+        ScopedAlignedArrayFloat heights;
+    };
+
+    // Padded rows first..last-1, as rows of the source image
+    HRESULT EvaluateRows(const NMapImage& nmap, DWORD flags, size_t first, size_t last)
+    {
+        const Image& srcImage = *nmap.src;
         const size_t width = srcImage.width;
         const size_t height = srcImage.height;
-        if (width != normalMap.width || height != normalMap.height)
-            return E_FAIL;
 
-        // Allocate temporary space (4 scanlines and 3 evaluated rows)
-        ScopedAlignedArrayXMVECTOR scanline(static_cast<XMVECTOR*>(_aligned_malloc((sizeof(XMVECTOR)*width * 4), 16)));
+        ScopedAlignedArrayXMVECTOR scanline(static_cast<XMVECTOR*>(_aligned_malloc(sizeof(XMVECTOR) * width, 16)));
         if (!scanline)
             return E_OUTOFMEMORY;
 
-        ScopedAlignedArrayFloat buffer(static_cast<float*>(_aligned_malloc(((sizeof(float) * (width + 2)) * 3), 16)));
-        if (!buffer)
-            return E_OUTOFMEMORY;
-
-        uint8_t* pDest = normalMap.pixels;
-        if (!pDest)
-            return E_POINTER;
-
-        XMVECTOR* row0 = scanline.get();
-        XMVECTOR* row1 = row0 + width;
-        XMVECTOR* row2 = row1 + width;
-        XMVECTOR* target = row2 + width;
+        for (size_t row = first; row < last; ++row)
+        {
+            size_t y;
+            if (row == 0)
+                y = (flags & CNMAP_MIRROR_V) ? 0 : height - 1;
+            else if (row > height)
+                y = (flags & CNMAP_MIRROR_V) ? height - 1 : 0;
+            else
+                y = row - 1;
 
-        float* val0 = buffer.get();
-        float* val1 = val0 + width + 2;
-        float* val2 = val1 + width + 2;
+            if (!_LoadScanline(scanline.get(), width, srcImage.pixels + srcImage.rowPitch * y, srcImage.rowPitch, srcImage.format))
+                return E_FAIL;
 
-        const size_t rowPitch = srcImage.rowPitch;
-        const uint8_t* pSrc = srcImage.pixels;
+            EvaluateRow(scanline.get(), nmap.heights.get() + nmap.pitch * row, width, flags);
+        }
 
-        // Read first scanline row into 'row1'
-        if (!_LoadScanline(row1, width, pSrc, rowPitch, srcImage.format))
-            return E_FAIL;
+        return S_OK;
+    }
 
-        // Setup 'row0'
-        if (flags & CNMAP_MIRROR_V)
-        {
-            // Mirror first row
-            memcpy_s(row0, rowPitch, row1, rowPitch);
-        }
-        else
-        {
-            // Read last row (Wrap V)
-            if (!_LoadScanline(row0, width, pSrc + (rowPitch * (height - 1)), rowPitch, srcImage.format))
-                return E_FAIL;
-        }
+    // Output rows first..last-1, four pixels per vector with one channel of them in each vector
+    HRESULT ComputeNMapRows(const NMapImage& nmap, DWORD flags, float amplitude, DXGI_FORMAT format, size_t first, size_t last)
+    {
+        const Image& normalMap = *nmap.dest;
+        const size_t width = normalMap.width;
+        const size_t vectors = (width + 3) & ~size_t(3);
 
-        // Evaluate the initial rows
-        EvaluateRow(row0, val0, width, flags);
-        EvaluateRow(row1, val1, width, flags);
+        ScopedAlignedArrayXMVECTOR scanline(static_cast<XMVECTOR*>(_aligned_malloc(sizeof(XMVECTOR) * vectors, 16)));
+        if (!scanline)
+            return E_OUTOFMEMORY;
 
-        pSrc += rowPitch;
+        const bool unorm = (_GetConvertFlags(format) & CONVF_UNORM) != 0;
+        const XMVECTOR amp = XMVectorReplicate(amplitude);
+        const XMVECTOR occlusionScale = XMVectorReplicate(0.125f * amplitude);
+        const XMVECTOR six = XMVectorReplicate(6.f);
+        const XMVECTOR sign = (flags & CNMAP_INVERT_SIGN) ? g_XMNegativeOne : g_XMOne;
+        const XMVECTOR encodeScale = (flags & CNMAP_INVERT_SIGN) ? g_XMNegativeOneHalf : g_XMOneHalf;
 
-        for (size_t y = 0; y < height; ++y)
+        for (size_t y = first; y < last; ++y)
         {
-            // Load next scanline of source image
-            if (y < (height - 1))
-            {
-                if (!_LoadScanline(row2, width, pSrc, rowPitch, srcImage.format))
-                    return E_FAIL;
-            }
-            else
-            {
-                if (flags & CNMAP_MIRROR_V)
-                {
-                    // Use last row of source image
-                    if (!_LoadScanline(row2, width, srcImage.pixels + (rowPitch * (height - 1)), rowPitch, srcImage.format))
-                        return E_FAIL;
-                }
-                else
-                {
-                    // Use first row of source image (Wrap V)
-                    if (!_LoadScanline(row2, width, srcImage.pixels, rowPitch, srcImage.format))
-                        return E_FAIL;
-                }
-            }
+            const float* val0 = nmap.heights.get() + nmap.pitch * y;
+            const float* val1 = val0 + nmap.pitch;
+            const float* val2 = val1 + nmap.pitch;
 
-            // Evaluate row
-            EvaluateRow(row2, val2, width, flags);
-
-            // Generate target scanline
-            XMVECTOR *dptr = target;
-            for (size_t x = 0; x < width; ++x)
+            XMVECTOR* dptr = scanline.get();
+            for (size_t x = 0; x < width; x += 4)
             {
-                // Compute normal via central differencing
-                float totDelta = (val0[x] - val0[x + 2]) + (val1[x] - val1[x + 2]) + (val2[x] - val2[x + 2]);
-                float deltaZX = totDelta * amplitude / 6.f;
-
-                totDelta = (val0[x] - val2[x]) + (val0[x + 1] - val2[x + 1]) + (val0[x + 2] - val2[x + 2]);
-                float deltaZY = totDelta * amplitude / 6.f;
-
-                XMVECTOR vx = XMVectorSetZ(g_XMNegIdentityR0, deltaZX);   // (-1.0f, 0.0f, deltaZX)
-                XMVECTOR vy = XMVectorSetZ(g_XMNegIdentityR1, deltaZY);   // (0.0f, -1.0f, deltaZY)
-
-                XMVECTOR normal = XMVector3Normalize(XMVector3Cross(vx, vy));
+                // a, b, c are the left, center and right neighbors of the four pixels
+                const XMVECTOR a0 = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(val0 + x));
+                const XMVECTOR b0 = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(val0 + x + 1));
+                const XMVECTOR c0 = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(val0 + x + 2));
+                const XMVECTOR a1 = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(val1 + x));
+                const XMVECTOR b1 = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(val1 + x + 1));
+                const XMVECTOR c1 = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(val1 + x + 2));
+                const XMVECTOR a2 = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(val2 + x));
+                const XMVECTOR b2 = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(val2 + x + 1));
+                const XMVECTOR c2 = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(val2 + x + 2));
+
+                // Compute normal via central differencing, which is normalize(deltaZX, deltaZY, 1)
+                XMVECTOR totDelta = XMVectorAdd(XMVectorAdd(XMVectorSubtract(a0, c0), XMVectorSubtract(a1, c1)), XMVectorSubtract(a2, c2));
+                const XMVECTOR deltaZX = XMVectorDivide(XMVectorMultiply(totDelta, amp), six);
+
+                totDelta = XMVectorAdd(XMVectorAdd(XMVectorSubtract(a0, a2), XMVectorSubtract(b0, b2)), XMVectorSubtract(c0, c2));
+                const XMVECTOR deltaZY = XMVectorDivide(XMVectorMultiply(totDelta, amp), six);
+
+                const XMVECTOR length = XMVectorSqrt(XMVectorMultiplyAdd(deltaZY, deltaZY,
+                    XMVectorMultiplyAdd(deltaZX, deltaZX, g_XMOne)));
+
+                XMMATRIX pixels;
+                pixels.r[0] = XMVectorDivide(deltaZX, length);
+                pixels.r[1] = XMVectorDivide(deltaZY, length);
+                pixels.r[2] = XMVectorReciprocal(length);
 
                 // Compute alpha (1.0 or an occlusion term)
-                float alpha = 1.f;
+                pixels.r[3] = g_XMOne;
 
                 if (flags & CNMAP_COMPUTE_OCCLUSION)
                 {
-                    float delta = 0.f;
-                    float c = val1[x + 1];
+                    const XMVECTOR c = b1;
 
-                    float t = val0[x] - c;  if (t > 0.f) delta += t;
-                    t = val0[x + 1] - c;    if (t > 0.f) delta += t;
-                    t = val0[x + 2] - c;    if (t > 0.f) delta += t;
-                    t = val1[x] - c;    if (t > 0.f) delta += t;
+                    XMVECTOR delta = XMVectorMax(XMVectorSubtract(a0, c), g_XMZero);
+                    delta = XMVectorAdd(delta, XMVectorMax(XMVectorSubtract(b0, c), g_XMZero));
+                    delta = XMVectorAdd(delta, XMVectorMax(XMVectorSubtract(c0, c), g_XMZero));
+                    delta = XMVectorAdd(delta, XMVectorMax(XMVectorSubtract(a1, c), g_XMZero));
                     // Skip current pixel
-                    t = val1[x + 2] - c;    if (t > 0.f) delta += t;
-                    t = val2[x] - c;    if (t > 0.f) delta += t;
-                    t = val2[x + 1] - c;    if (t > 0.f) delta += t;
-                    t = val2[x + 2] - c;    if (t > 0.f) delta += t;
-
-                    // Average delta (divide by 8, scale by amplitude factor)
-                    delta *= 0.125f * amplitude;
-                    if (delta > 0.f)
-                    {
-                        // If < 0, then no occlusion
-                        float r = sqrtf(1.f + delta*delta);
-                        alpha = (r - delta) / r;
-                    }
+                    delta = XMVectorAdd(delta, XMVectorMax(XMVectorSubtract(c1, c), g_XMZero));
+                    delta = XMVectorAdd(delta, XMVectorMax(XMVectorSubtract(a2, c), g_XMZero));
+                    delta = XMVectorAdd(delta, XMVectorMax(XMVectorSubtract(b2, c), g_XMZero));
+                    delta = XMVectorAdd(delta, XMVectorMax(XMVectorSubtract(c2, c), g_XMZero));
+
+                    // Average delta (divide by 8, scale by amplitude factor), if <= 0 there is no occlusion
+                    delta = XMVectorMultiply(delta, occlusionScale);
+                    const XMVECTOR r = XMVectorSqrt(XMVectorMultiplyAdd(delta, delta, g_XMOne));
+                    pixels.r[3] = XMVectorSelect(g_XMOne, XMVectorDivide(XMVectorSubtract(r, delta), r),
+                        XMVectorGreater(delta, g_XMZero));
                 }
 
                 // Encode based on target format
-                if (convFlags & CONVF_UNORM)
+                for (size_t j = 0; j < 3; ++j)
                 {
                     // 0.5f*normal + 0.5f -or- invert sign case: -0.5f*normal + 0.5f
-                    XMVECTOR n1 = XMVectorMultiplyAdd((flags & CNMAP_INVERT_SIGN) ? g_XMNegativeOneHalf : g_XMOneHalf, normal, g_XMOneHalf);
-                    *dptr++ = XMVectorSetW(n1, alpha);
-                }
-                else if (flags & CNMAP_INVERT_SIGN)
-                {
-                    *dptr++ = XMVectorSetW(XMVectorNegate(normal), alpha);
-                }
-                else
-                {
-                    *dptr++ = XMVectorSetW(normal, alpha);
+                    pixels.r[j] = unorm ? XMVectorMultiplyAdd(encodeScale, pixels.r[j], g_XMOneHalf)
+                        : XMVectorMultiply(sign, pixels.r[j]);
                 }
+
+                pixels = XMMatrixTranspose(pixels);
+                *dptr++ = pixels.r[0];
+                *dptr++ = pixels.r[1];
+                *dptr++ = pixels.r[2];
+                *dptr++ = pixels.r[3];
             }
 
-            if (!_StoreScanline(pDest, normalMap.rowPitch, format, target, width))
+            if (!_StoreScanline(normalMap.pixels + normalMap.rowPitch * y, normalMap.rowPitch, format, scanline.get(), width))
                 return E_FAIL;
+        }
 
-            // Cycle buffers
-            float* temp = val0;
-            val0 = val1;
-            val1 = val2;
-            val2 = temp;
+        return S_OK;
+    }
+
+    // Evaluates the heights of all images, then computes the normals, each in bands of rows on the thread pool
+    HRESULT ComputeNMaps(
+        _In_reads_(nimages) const Image* srcImages,
+        _In_reads_(nimages) const Image* normalMaps,
+        size_t nimages,
+        DWORD flags,
+        float amplitude,
+        DXGI_FORMAT format,
+        const ParallelOptions& options)
+    {
+        const DWORD convFlags = _GetConvertFlags(format);
+        if (!convFlags)
+            return E_FAIL;
 
-            pSrc += rowPitch;
-            pDest += normalMap.rowPitch;
+        if (!(convFlags & (CONVF_UNORM | CONVF_SNORM | CONVF_FLOAT)))
+            return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+
+        std::unique_ptr<NMapImage[]> nmaps(new (std::nothrow) NMapImage[nimages]);
+        std::unique_ptr<size_t[]> evalStarts(new (std::nothrow) size_t[nimages + 1]);
+        std::unique_ptr<size_t[]> bandStarts(new (std::nothrow) size_t[nimages + 1]);
+        if (!nmaps || !evalStarts || !bandStarts)
+            return E_OUTOFMEMORY;
+
+        evalStarts[0] = bandStarts[0] = 0;
+        for (size_t index = 0; index < nimages; ++index)
+        {
+            const Image& src = srcImages[index];
+            if (!src.pixels || !normalMaps[index].pixels)
+                return E_INVALIDARG;
+
+            if (src.width != normalMaps[index].width || src.height != normalMaps[index].height)
+                return E_FAIL;
+
+            NMapImage& nmap = nmaps[index];
+            nmap.src = &src;
+            nmap.dest = &normalMaps[index];
+            nmap.pitch = ((src.width + 3) & ~size_t(3)) + 4;
+            nmap.heights.reset(static_cast<float*>(_aligned_malloc(sizeof(float) * nmap.pitch * (src.height + 2), 16)));
+            if (!nmap.heights)
+                return E_OUTOFMEMORY;
+
+            // The floats past the padded row are only read for pixels beyond the width
+            memset(nmap.heights.get(), 0, sizeof(float) * nmap.pitch * (src.height + 2));
+
+            evalStarts[index + 1] = evalStarts[index] + (src.height + 2 + NMAP_BAND - 1) / NMAP_BAND;
+            bandStarts[index + 1] = bandStarts[index] + (src.height + NMAP_BAND - 1) / NMAP_BAND;
         }
 
-        return S_OK;
+        auto findImage = [&](const size_t* starts, size_t band) -> size_t
+        {
+            return size_t(std::upper_bound(starts, starts + nimages + 1, band) - starts) - 1;
+        };
+
+        const size_t totalEval = evalStarts[nimages];
+        const size_t totalBands = bandStarts[nimages];
+
+        HRESULT hr = _ParallelFor(totalEval, options, 0, totalEval + totalBands,
+            [&](size_t band) -> HRESULT
+        {
+            const size_t index = findImage(evalStarts.get(), band);
+            const size_t first = (band - evalStarts[index]) * NMAP_BAND;
+            return EvaluateRows(nmaps[index], flags, first, std::min(first + NMAP_BAND, nmaps[index].src->height + 2));
+        });
+        if (FAILED(hr))
+            return hr;
+
+        return _ParallelFor(totalBands, options, totalEval, totalEval + totalBands,
+            [&](size_t band) -> HRESULT
+        {
+            const size_t index = findImage(bandStarts.get(), band);
+            const size_t first = (band - bandStarts[index]) * NMAP_BAND;
+            return ComputeNMapRows(nmaps[index], flags, amplitude, format, first, std::min(first + NMAP_BAND, nmaps[index].src->height));
+        });
+    }
+
+    bool IsValidChannel(DWORD flags)
+    {
+        static_assert(CNMAP_CHANNEL_RED == 0x1, "CNMAP_CHANNEL_ flag values don't match mask");
+        switch (flags & 0xf)
+        {
+        case 0:
+        case CNMAP_CHANNEL_RED:
+        case CNMAP_CHANNEL_GREEN:
+        case CNMAP_CHANNEL_BLUE:
+        case CNMAP_CHANNEL_ALPHA:
+        case CNMAP_CHANNEL_LUMINANCE:
+            return true;
+
+        default:
+            return false;
+        }
+    }
+
+    ParallelOptions SingleThread()
+    {
+        ParallelOptions options;
+        options.threadCount = 1;
+        return options;
     }
 }
 
@@ -260,24 +334,9 @@ HRESULT DirectX::ComputeNormalMap(
     DXGI_FORMAT format,
     ScratchImage& normalMap)
 {
-    if (!srcImage.pixels || !IsValid(format))
+    if (!srcImage.pixels || !IsValid(format) || !IsValidChannel(flags))
         return E_INVALIDARG;
 
-    static_assert(CNMAP_CHANNEL_RED == 0x1, "CNMAP_CHANNEL_ flag values don't match mask");
-    switch (flags & 0xf)
-    {
-    case 0:
-    case CNMAP_CHANNEL_RED:
-    case CNMAP_CHANNEL_GREEN:
-    case CNMAP_CHANNEL_BLUE:
-    case CNMAP_CHANNEL_ALPHA:
-    case CNMAP_CHANNEL_LUMINANCE:
-        break;
-
-    default:
-        return E_INVALIDARG;
-    }
-
     if (IsCompressed(format) || IsCompressed(srcImage.format)
         || IsTypeless(format) || IsTypeless(srcImage.format)
         || IsPlanar(format) || IsPlanar(srcImage.format)
@@ -298,7 +357,7 @@ HRESULT DirectX::ComputeNormalMap(
         return E_POINTER;
     }
 
-    hr = ComputeNMap(srcImage, flags, amplitude, format, *img);
+    hr = ComputeNMaps(&srcImage, img, 1, flags, amplitude, format, SingleThread());
     if (FAILED(hr))
     {
         normalMap.Release();
@@ -318,7 +377,21 @@ HRESULT DirectX::ComputeNormalMap(
     DXGI_FORMAT format,
     ScratchImage& normalMaps)
 {
-    if (!srcImages || !nimages || !IsValid(format))
+    return ComputeNormalMap(srcImages, nimages, metadata, flags, amplitude, format, SingleThread(), normalMaps);
+}
+
+_Use_decl_annotations_
+HRESULT DirectX::ComputeNormalMap(
+    const Image* srcImages,
+    size_t nimages,
+    const TexMetadata& metadata,
+    DWORD flags,
+    float amplitude,
+    DXGI_FORMAT format,
+    const ParallelOptions& options,
+    ScratchImage& normalMaps)
+{
+    if (!srcImages || !nimages || !IsValid(format) || !IsValidChannel(flags))
         return E_INVALIDARG;
 
     if (IsCompressed(format) || IsCompressed(metadata.format)
@@ -327,19 +400,10 @@ HRESULT DirectX::ComputeNormalMap(
         || IsPalettized(format) || IsPalettized(metadata.format))
         return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
 
-    static_assert(CNMAP_CHANNEL_RED == 0x1, "CNMAP_CHANNEL_ flag values don't match mask");
-    switch (flags & 0xf)
+    for (size_t index = 0; index < nimages; ++index)
     {
-    case 0:
-    case CNMAP_CHANNEL_RED:
-    case CNMAP_CHANNEL_GREEN:
-    case CNMAP_CHANNEL_BLUE:
-    case CNMAP_CHANNEL_ALPHA:
-    case CNMAP_CHANNEL_LUMINANCE:
-        break;
-
-    default:
-        return E_INVALIDARG;
+        if (IsCompressed(srcImages[index].format) || IsTypeless(srcImages[index].format))
+            return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
     }
 
     normalMaps.Release();
@@ -363,29 +427,11 @@ HRESULT DirectX::ComputeNormalMap(
         return E_POINTER;
     }
 
-    for (size_t index = 0; index < nimages; ++index)
+    hr = ComputeNMaps(srcImages, dest, nimages, flags, amplitude, format, options);
+    if (FAILED(hr))
     {
-        assert(dest[index].format == format);
-
-        const Image& src = srcImages[index];
-        if (IsCompressed(src.format) || IsTypeless(src.format))
-        {
-            normalMaps.Release();
-            return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
-        }
-
-        if (src.width != dest[index].width || src.height != dest[index].height)
-        {
-            normalMaps.Release();
-            return E_FAIL;
-        }
-
-        hr = ComputeNMap(src, flags, amplitude, format, dest[index]);
-        if (FAILED(hr))
-        {
-            normalMaps.Release();
-            return hr;
-        }
+        normalMaps.Release();
+        return hr;
     }
 
     return S_OK;
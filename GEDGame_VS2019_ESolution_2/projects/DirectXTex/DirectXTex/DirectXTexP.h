@@ -280,6 +280,30 @@ namespace DirectX
         _Inout_updates_all_(count) XMVECTOR* pBuffer, _In_ size_t count,
         _In_ DXGI_FORMAT outFormat, _In_ DXGI_FORMAT inFormat, _In_ DWORD flags);
 
+    // Format pairs Convert handles on the packed pixels, with exactly the results of the float path
+    typedef void (*DirectConvertFunc)(void* pDestination, const void* pSource, size_t count);
+
+    struct DirectConvert
+    {
+        DXGI_FORMAT         source;
+        DXGI_FORMAT         dest;
+        DirectConvertFunc   func;
+    };
+
+    DirectConvertFunc __cdecl _GetDirectConversion(_In_ DWORD filter, _In_ DXGI_FORMAT sformat, _In_ DXGI_FORMAT tformat);
+        // nullptr when the filter or an sRGB curve on one side only needs the float path
+
+    const DirectConvert* __cdecl _GetDirectConversions(_Out_ size_t& count);
+
+    //---------------------------------------------------------------------------------
+    // Thread pool helper
+
+    HRESULT __cdecl _ParallelFor(
+        _In_ size_t count, _In_ const ParallelOptions& options, _In_ size_t progressBase, _In_ size_t progressTotal,
+        _In_ std::function<HRESULT __cdecl(size_t index)> task);
+        // Runs task(0..count-1) on options.threadCount threads with work stealing and returns the first failure.
+        // Progress is reported as progressBase + completed tasks out of progressTotal.
+
     //---------------------------------------------------------------------------------
     // DDS helper functions
     HRESULT __cdecl _EncodeDDSHeader(
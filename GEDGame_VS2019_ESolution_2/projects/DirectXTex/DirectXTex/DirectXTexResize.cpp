@@ -826,6 +826,613 @@ namespace
             return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
         }
     }
+
+
+    //-------------------------------------------------------------------------------------
+    // Separable resampler
+    //-------------------------------------------------------------------------------------
+
+    // Weight table of one axis: every destination pixel reads 'taps' source pixels, padded with
+    // zero weights. Unless the taps wrap around, the same weights are also kept as windows of
+    // 'windowTaps' (a multiple of 4) consecutive source pixels, which the single channel kernel
+    // reads with vector loads.
+    struct ResampleAxis
+    {
+        size_t                      dest;
+        size_t                      taps;
+        std::unique_ptr<uint32_t[]> index;
+        ScopedAlignedArrayFloat     weight;
+
+        size_t                      windowTaps;
+        std::unique_ptr<uint32_t[]> windowStart;
+        ScopedAlignedArrayFloat     window;
+
+        size_t Entry(size_t u, size_t tap) const { return u * taps + tap; }
+    };
+
+    HRESULT AllocateAxis(size_t dest, size_t taps, ResampleAxis& axis)
+    {
+        // Padded to a multiple of 4 destination pixels for the single channel kernel
+        const size_t count = ((dest + 3) & ~size_t(3)) * taps;
+
+        axis.dest = dest;
+        axis.taps = taps;
+        axis.index.reset(new (std::nothrow) uint32_t[count]);
+        axis.weight.reset(static_cast<float*>(_aligned_malloc(sizeof(float) * count, 16)));
+        if (!axis.index || !axis.weight)
+            return E_OUTOFMEMORY;
+
+        memset(axis.index.get(), 0, sizeof(uint32_t) * count);
+        memset(axis.weight.get(), 0, sizeof(float) * count);
+
+        return S_OK;
+    }
+
+    // Unused taps (and the pixels past the end) repeat the first source pixel with zero weight,
+    // so they never widen the source span of a tile
+    void PadAxis(ResampleAxis& axis, _In_reads_opt_(axis.dest) const size_t* counts)
+    {
+        const size_t padded = (axis.dest + 3) & ~size_t(3);
+        for (size_t u = 0; u < padded; ++u)
+        {
+            const uint32_t first = axis.index[axis.Entry(std::min(u, axis.dest - 1), 0)];
+            const size_t used = (u >= axis.dest) ? 0 : (counts ? counts[u] : axis.taps);
+            for (size_t t = used; t < axis.taps; ++t)
+            {
+                axis.index[axis.Entry(u, t)] = first;
+                axis.weight[axis.Entry(u, t)] = 0.f;
+            }
+        }
+    }
+
+    //--- Point: the same source pixel as ResizePointFilter ---
+    HRESULT CreatePointAxis(size_t source, size_t dest, ResampleAxis& axis)
+    {
+        HRESULT hr = AllocateAxis(dest, 1, axis);
+        if (FAILED(hr))
+            return hr;
+
+        const size_t inc = (source << 16) / dest;
+
+        size_t s = 0;
+        for (size_t u = 0; u < dest; ++u, s += inc)
+        {
+            axis.index[axis.Entry(u, 0)] = uint32_t(s >> 16);
+            axis.weight[axis.Entry(u, 0)] = 1.f;
+        }
+
+        PadAxis(axis, nullptr);
+        return S_OK;
+    }
+
+    //--- Box: average of the source area covered by the destination pixel, for any ratio ---
+    HRESULT CreateBoxAxis(size_t source, size_t dest, ResampleAxis& axis)
+    {
+        const double scale = double(source) / double(dest);
+
+        // Whole ratios line up with the source pixels, others can touch one more
+        HRESULT hr = AllocateAxis(dest, (source % dest) ? size_t(ceil(scale)) + 1 : source / dest, axis);
+        if (FAILED(hr))
+            return hr;
+
+        std::unique_ptr<size_t[]> counts(new (std::nothrow) size_t[dest]);
+        if (!counts)
+            return E_OUTOFMEMORY;
+
+        for (size_t u = 0; u < dest; ++u)
+        {
+            const double a = double(u) * scale;
+            const double b = std::min(double(u + 1) * scale, double(source));
+
+            size_t count = 0;
+            for (size_t s = size_t(a); s < source && double(s) < b && count < axis.taps; ++s)
+            {
+                const double overlap = std::min(b, double(s + 1)) - std::max(a, double(s));
+                if (overlap <= 0)
+                    continue;
+
+                axis.index[axis.Entry(u, count)] = uint32_t(s);
+                axis.weight[axis.Entry(u, count)] = float(overlap / scale);
+                ++count;
+            }
+
+            counts[u] = count;
+        }
+
+        PadAxis(axis, counts.get());
+        return S_OK;
+    }
+
+    //--- Linear: the two taps of _CreateLinearFilter ---
+    HRESULT CreateLinearAxis(size_t source, size_t dest, bool wrap, ResampleAxis& axis)
+    {
+        std::unique_ptr<LinearFilter[]> lf(new (std::nothrow) LinearFilter[dest]);
+        if (!lf)
+            return E_OUTOFMEMORY;
+
+        _CreateLinearFilter(source, dest, wrap, lf.get());
+
+        HRESULT hr = AllocateAxis(dest, 2, axis);
+        if (FAILED(hr))
+            return hr;
+
+        for (size_t u = 0; u < dest; ++u)
+        {
+            axis.index[axis.Entry(u, 0)] = uint32_t(lf[u].u0);
+            axis.weight[axis.Entry(u, 0)] = lf[u].weight0;
+            axis.index[axis.Entry(u, 1)] = uint32_t(lf[u].u1);
+            axis.weight[axis.Entry(u, 1)] = lf[u].weight1;
+        }
+
+        PadAxis(axis, nullptr);
+        return S_OK;
+    }
+
+    //--- Cubic: the four taps of _CreateCubicFilter, with CUBIC_INTERPOLATE written as weights ---
+    HRESULT CreateCubicAxis(size_t source, size_t dest, bool wrap, bool mirror, ResampleAxis& axis)
+    {
+        std::unique_ptr<CubicFilter[]> cf(new (std::nothrow) CubicFilter[dest]);
+        if (!cf)
+            return E_OUTOFMEMORY;
+
+        _CreateCubicFilter(source, dest, wrap, mirror, cf.get());
+
+        HRESULT hr = AllocateAxis(dest, 4, axis);
+        if (FAILED(hr))
+            return hr;
+
+        for (size_t u = 0; u < dest; ++u)
+        {
+            const float x = cf[u].x;
+            const float x2 = x * x;
+            const float x3 = x2 * x;
+
+            const float w0 = -x / 3.f + x2 / 2.f - x3 / 6.f;
+            const float w2 = x + x2 / 2.f - x3 / 2.f;
+            const float w3 = -x / 6.f + x3 / 6.f;
+
+            const size_t index[4] = { cf[u].u0, cf[u].u1, cf[u].u2, cf[u].u3 };
+            const float weight[4] = { w0, 1.f - w0 - w2 - w3, w2, w3 };
+            for (size_t t = 0; t < 4; ++t)
+            {
+                axis.index[axis.Entry(u, t)] = uint32_t(index[t]);
+                axis.weight[axis.Entry(u, t)] = weight[t];
+            }
+        }
+
+        PadAxis(axis, nullptr);
+        return S_OK;
+    }
+
+    //--- Triangle: TriangleFilter::_Create turned around from source to destination order ---
+    HRESULT CreateTriangleAxis(size_t source, size_t dest, bool wrap, ResampleAxis& axis)
+    {
+        using namespace TriangleFilter;
+
+        std::unique_ptr<Filter> tf;
+        HRESULT hr = _Create(source, dest, wrap, tf);
+        if (FAILED(hr))
+            return hr;
+
+        std::unique_ptr<size_t[]> counts(new (std::nothrow) size_t[dest]);
+        if (!counts)
+            return E_OUTOFMEMORY;
+
+        memset(counts.get(), 0, sizeof(size_t) * dest);
+
+        auto fromEnd = reinterpret_cast<const FilterFrom*>(reinterpret_cast<const uint8_t*>(tf.get()) + tf->sizeInBytes);
+
+        for (const FilterFrom* from = tf->from; from < fromEnd; )
+        {
+            for (size_t j = 0; j < from->count; ++j)
+            {
+                if (from->to[j].u >= dest)
+                    return E_FAIL;
+                ++counts[from->to[j].u];
+            }
+
+            from = reinterpret_cast<const FilterFrom*>(reinterpret_cast<const uint8_t*>(from) + from->sizeInBytes);
+        }
+
+        hr = AllocateAxis(dest, *std::max_element(counts.get(), counts.get() + dest), axis);
+        if (FAILED(hr))
+            return hr;
+
+        memset(counts.get(), 0, sizeof(size_t) * dest);
+
+        size_t s = 0;
+        for (const FilterFrom* from = tf->from; from < fromEnd; ++s)
+        {
+            for (size_t j = 0; j < from->count; ++j)
+            {
+                const size_t u = from->to[j].u;
+                axis.index[axis.Entry(u, counts[u])] = uint32_t(s);
+                axis.weight[axis.Entry(u, counts[u])] = from->to[j].weight;
+                ++counts[u];
+            }
+
+            from = reinterpret_cast<const FilterFrom*>(reinterpret_cast<const uint8_t*>(from) + from->sizeInBytes);
+        }
+
+        PadAxis(axis, counts.get());
+        return S_OK;
+    }
+
+    // Leaves windowTaps at 0 when the taps of a pixel are too far apart (wrapping) or the source is too short
+    HRESULT CreateAxisWindows(size_t source, ResampleAxis& axis)
+    {
+        axis.windowTaps = 0;
+
+        size_t width = 0;
+        for (size_t u = 0; u < axis.dest; ++u)
+        {
+            const uint32_t* index = &axis.index[axis.Entry(u, 0)];
+            const auto range = std::minmax_element(index, index + axis.taps);
+            width = std::max<size_t>(width, *range.second - *range.first + 1);
+        }
+
+        const size_t windowTaps = (width + 3) & ~size_t(3);
+        if (windowTaps > ((axis.taps + 3) & ~size_t(3)) || windowTaps > source)
+            return S_OK;
+
+        const size_t padded = (axis.dest + 3) & ~size_t(3);
+        axis.windowStart.reset(new (std::nothrow) uint32_t[padded]);
+        axis.window.reset(static_cast<float*>(_aligned_malloc(sizeof(float) * padded * windowTaps, 16)));
+        if (!axis.windowStart || !axis.window)
+            return E_OUTOFMEMORY;
+
+        memset(axis.window.get(), 0, sizeof(float) * padded * windowTaps);
+
+        for (size_t u = 0; u < padded; ++u)
+        {
+            const size_t e = axis.Entry(std::min(u, axis.dest - 1), 0);
+            const uint32_t first = *std::min_element(&axis.index[e], &axis.index[e] + axis.taps);
+            const uint32_t start = uint32_t(std::min<size_t>(first, source - windowTaps));
+            axis.windowStart[u] = start;
+
+            // Clamped taps can read the same source pixel more than once
+            if (u < axis.dest)
+            {
+                for (size_t t = 0; t < axis.taps; ++t)
+                    axis.window[u * windowTaps + axis.index[e + t] - start] += axis.weight[e + t];
+            }
+        }
+
+        axis.windowTaps = windowTaps;
+        return S_OK;
+    }
+
+    HRESULT CreateResampleAxis(DWORD filterSelect, size_t source, size_t dest, bool wrap, bool mirror, ResampleAxis& axis)
+    {
+        HRESULT hr;
+        switch (filterSelect)
+        {
+        case TEX_FILTER_POINT:      hr = CreatePointAxis(source, dest, axis); break;
+        case TEX_FILTER_BOX:        hr = CreateBoxAxis(source, dest, axis); break;
+        case TEX_FILTER_LINEAR:     hr = CreateLinearAxis(source, dest, wrap, axis); break;
+        case TEX_FILTER_CUBIC:      hr = CreateCubicAxis(source, dest, wrap, mirror, axis); break;
+        case TEX_FILTER_TRIANGLE:   hr = CreateTriangleAxis(source, dest, wrap, axis); break;
+        default:                    return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+        }
+
+        if (FAILED(hr))
+            return hr;
+
+        return CreateAxisWindows(source, axis);
+    }
+
+    //--- Kernels ---
+    // Four channels: one vector per destination pixel. The common tap counts are unrolled.
+    template<size_t TAPS>
+    void ResampleRow4Taps(const ResampleAxis& axis, size_t xBegin, size_t xEnd, size_t offset,
+        _In_ const XMVECTOR* pSource, _Out_ XMVECTOR* pDest)
+    {
+        const size_t taps = TAPS ? TAPS : axis.taps;
+        const uint32_t* index = &axis.index[axis.Entry(xBegin, 0)];
+        const float* weight = &axis.weight[axis.Entry(xBegin, 0)];
+
+        for (size_t x = xBegin; x < xEnd; ++x, index += taps, weight += taps)
+        {
+            XMVECTOR v = XMVectorMultiply(pSource[index[0] - offset], XMVectorReplicate(weight[0]));
+            for (size_t t = 1; t < taps; ++t)
+                v = XMVectorMultiplyAdd(pSource[index[t] - offset], XMVectorReplicate(weight[t]), v);
+
+            *pDest++ = v;
+        }
+    }
+
+    void ResampleRow4(const ResampleAxis& axis, size_t xBegin, size_t xEnd, size_t offset,
+        _In_ const XMVECTOR* pSource, _Out_ XMVECTOR* pDest)
+    {
+        switch (axis.taps)
+        {
+        case 1:     ResampleRow4Taps<1>(axis, xBegin, xEnd, offset, pSource, pDest); break;
+        case 2:     ResampleRow4Taps<2>(axis, xBegin, xEnd, offset, pSource, pDest); break;
+        case 3:     ResampleRow4Taps<3>(axis, xBegin, xEnd, offset, pSource, pDest); break;
+        case 4:     ResampleRow4Taps<4>(axis, xBegin, xEnd, offset, pSource, pDest); break;
+        default:    ResampleRow4Taps<0>(axis, xBegin, xEnd, offset, pSource, pDest); break;
+        }
+    }
+
+    // One channel: four destination pixels per vector (xBegin is a multiple of 4). Each pixel
+    // multiplies its window 4 source pixels at a time, and the four sums are transposed into one vector.
+    void ResampleRow1(const ResampleAxis& axis, size_t xBegin, size_t xEnd, size_t offset,
+        _In_ const float* pSource, _Out_ XMVECTOR* pDest)
+    {
+        assert((xBegin & 3) == 0);
+
+        if (!axis.windowTaps)
+        {
+            float* dest = reinterpret_cast<float*>(pDest);
+            for (size_t x = xBegin; x < xEnd; ++x)
+            {
+                const size_t e = axis.Entry(x, 0);
+
+                float v = 0.f;
+                for (size_t t = 0; t < axis.taps; ++t)
+                    v += pSource[axis.index[e + t] - offset] * axis.weight[e + t];
+
+                *dest++ = v;
+            }
+            return;
+        }
+
+        const size_t windowTaps = axis.windowTaps;
+        for (size_t x = xBegin; x < xEnd; x += 4)
+        {
+            XMVECTOR sum[4];
+            for (size_t j = 0; j < 4; ++j)
+            {
+                const float* src = pSource + axis.windowStart[x + j] - offset;
+                const float* weight = &axis.window[(x + j) * windowTaps];
+
+                XMVECTOR v = XMVectorMultiply(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(src)),
+                    XMLoadFloat4A(reinterpret_cast<const XMFLOAT4A*>(weight)));
+                for (size_t t = 4; t < windowTaps; t += 4)
+                {
+                    v = XMVectorMultiplyAdd(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(src + t)),
+                        XMLoadFloat4A(reinterpret_cast<const XMFLOAT4A*>(weight + t)), v);
+                }
+                sum[j] = v;
+            }
+
+            XMVECTOR s01 = XMVectorAdd(XMVectorMergeXY(sum[0], sum[1]), XMVectorMergeZW(sum[0], sum[1]));
+            XMVECTOR s23 = XMVectorAdd(XMVectorMergeXY(sum[2], sum[3]), XMVectorMergeZW(sum[2], sum[3]));
+            *pDest++ = XMVectorAdd(XMVectorPermute<0, 1, 4, 5>(s01, s23), XMVectorPermute<2, 3, 6, 7>(s01, s23));
+        }
+    }
+
+    // Weighted sum of the horizontally filtered rows, which works the same for every format
+    void ResampleColumns(size_t count, size_t taps, _In_reads_(taps) const XMVECTOR* const* rows,
+        _In_reads_(taps) const float* weights, _Out_writes_(count) XMVECTOR* pDest)
+    {
+        XMVECTOR w = XMVectorReplicate(weights[0]);
+        for (size_t i = 0; i < count; ++i)
+            pDest[i] = XMVectorMultiply(rows[0][i], w);
+
+        for (size_t t = 1; t < taps; ++t)
+        {
+            w = XMVectorReplicate(weights[t]);
+            const XMVECTOR* row = rows[t];
+            for (size_t i = 0; i < count; ++i)
+                pDest[i] = XMVectorMultiplyAdd(row[i], w, pDest[i]);
+        }
+    }
+
+    //--- Tiles ---
+    enum RESAMPLE_PATH
+    {
+        RESAMPLE_GENERIC,   // _LoadScanline / _StoreScanline through XMVECTOR rows
+        RESAMPLE_R32F,
+        RESAMPLE_RGBA8,     // R8G8B8A8_UNORM or B8G8R8A8_UNORM; the channel order does not matter
+        RESAMPLE_RGBA32F,
+    };
+
+    const size_t RESAMPLE_TILE_WIDTH = 128;
+    const size_t RESAMPLE_TILE_HEIGHT = 16;
+
+    const XMVECTORF32 g_resample8BitBias = { { { 0.5f / 255.f, 0.5f / 255.f, 0.5f / 255.f, 0.5f / 255.f } } };
+
+    struct ResampleJob
+    {
+        const ResampleAxis* axisX;
+        const ResampleAxis* axisY;
+        RESAMPLE_PATH       path;
+        DWORD               filter;
+        bool                linear;         // Point sampling loads and stores without sRGB conversions
+        bool                bias;           // Triangle filter bias for 10:10:10:2 formats
+        size_t              bytesPerPixel;  // 0 when the rows can not be split into column tiles
+        size_t              tileWidth;
+    };
+
+    RESAMPLE_PATH ChooseResamplePath(DXGI_FORMAT format, DWORD filter)
+    {
+        // Explicit sRGB processing goes through the scanline conversions
+        if (filter & TEX_FILTER_SRGB)
+            return RESAMPLE_GENERIC;
+
+        switch (format)
+        {
+        case DXGI_FORMAT_R32_FLOAT:
+            return RESAMPLE_R32F;
+
+        case DXGI_FORMAT_R8G8B8A8_UNORM:
+        case DXGI_FORMAT_B8G8R8A8_UNORM:
+            return RESAMPLE_RGBA8;
+
+        case DXGI_FORMAT_R32G32B32A32_FLOAT:
+            return RESAMPLE_RGBA32F;
+
+        default:
+            return RESAMPLE_GENERIC;
+        }
+    }
+
+    // Filters the source rows used by one tile horizontally, then combines them vertically
+    HRESULT ResampleTile(const ResampleJob& job, const Image& srcImage, const Image& destImage, size_t xBegin, size_t yBegin)
+    {
+        const ResampleAxis& axisX = *job.axisX;
+        const ResampleAxis& axisY = *job.axisY;
+
+        const size_t xEnd = std::min(xBegin + job.tileWidth, destImage.width);
+        const size_t yEnd = std::min(yBegin + RESAMPLE_TILE_HEIGHT, destImage.height);
+        const size_t width = xEnd - xBegin;
+        const size_t vectors = (job.path == RESAMPLE_R32F) ? (width + 3) / 4 : width;
+
+        // Source columns of the tile; without column tiles the whole row is loaded
+        size_t sx0 = 0;
+        size_t sx1 = srcImage.width;
+        if (job.bytesPerPixel)
+        {
+            sx0 = SIZE_MAX;
+            sx1 = 0;
+            if (job.path == RESAMPLE_R32F && axisX.windowTaps)
+            {
+                for (size_t x = xBegin; x < ((xEnd + 3) & ~size_t(3)); ++x)
+                {
+                    sx0 = std::min<size_t>(sx0, axisX.windowStart[x]);
+                    sx1 = std::max<size_t>(sx1, axisX.windowStart[x] + axisX.windowTaps);
+                }
+            }
+            else
+            {
+                for (size_t x = xBegin; x < xEnd; ++x)
+                {
+                    for (size_t t = 0; t < axisX.taps; ++t)
+                    {
+                        const size_t s = axisX.index[axisX.Entry(x, t)];
+                        sx0 = std::min(sx0, s);
+                        sx1 = std::max(sx1, s + 1);
+                    }
+                }
+            }
+        }
+        const size_t span = sx1 - sx0;
+
+        // Source rows of the tile
+        std::vector<uint32_t> rows;
+        rows.reserve((yEnd - yBegin) * axisY.taps);
+        for (size_t y = yBegin; y < yEnd; ++y)
+        {
+            for (size_t t = 0; t < axisY.taps; ++t)
+                rows.push_back(axisY.index[axisY.Entry(y, t)]);
+        }
+        std::sort(rows.begin(), rows.end());
+        rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+
+        // Temporary space (source span, filtered rows, output row)
+        ScopedAlignedArrayXMVECTOR scanline(static_cast<XMVECTOR*>(_aligned_malloc(
+            sizeof(XMVECTOR) * (span + vectors * rows.size() + vectors), 16)));
+        if (!scanline)
+            return E_OUTOFMEMORY;
+
+        XMVECTOR* sourceRow = scanline.get();
+        XMVECTOR* filtered = sourceRow + span;
+        XMVECTOR* target = filtered + vectors * rows.size();
+
+        const size_t srcSize = job.bytesPerPixel ? span * job.bytesPerPixel : srcImage.rowPitch;
+
+        for (size_t j = 0; j < rows.size(); ++j)
+        {
+            const uint8_t* pSrc = srcImage.pixels + srcImage.rowPitch * rows[j] + sx0 * job.bytesPerPixel;
+            XMVECTOR* pFiltered = filtered + vectors * j;
+
+            switch (job.path)
+            {
+            case RESAMPLE_R32F:
+                ResampleRow1(axisX, xBegin, xEnd, sx0, reinterpret_cast<const float*>(pSrc), pFiltered);
+                continue;
+
+            case RESAMPLE_RGBA8:
+                for (size_t i = 0; i < span; ++i)
+                    sourceRow[i] = XMLoadUByteN4(reinterpret_cast<const XMUBYTEN4*>(pSrc) + i);
+                break;
+
+            case RESAMPLE_RGBA32F:
+                if (!(reinterpret_cast<uintptr_t>(pSrc) & 0xF))
+                {
+                    // Aligned rows are filtered in place
+                    ResampleRow4(axisX, xBegin, xEnd, sx0, reinterpret_cast<const XMVECTOR*>(pSrc), pFiltered);
+                    continue;
+                }
+                memcpy(sourceRow, pSrc, sizeof(XMVECTOR) * span);
+                break;
+
+            default:
+                if (job.linear)
+                {
+                    if (!_LoadScanlineLinear(sourceRow, span, pSrc, srcSize, srcImage.format, job.filter))
+                        return E_FAIL;
+                }
+                else if (!_LoadScanline(sourceRow, span, pSrc, srcSize, srcImage.format))
+                {
+                    return E_FAIL;
+                }
+                break;
+            }
+
+            ResampleRow4(axisX, xBegin, xEnd, sx0, sourceRow, pFiltered);
+        }
+
+        std::vector<const XMVECTOR*> rowPtrs(axisY.taps);
+        std::vector<float> weights(axisY.taps);
+
+        const size_t destSize = job.bytesPerPixel ? width * job.bytesPerPixel : destImage.rowPitch;
+
+        for (size_t y = yBegin; y < yEnd; ++y)
+        {
+            const size_t e = axisY.Entry(y, 0);
+            for (size_t t = 0; t < axisY.taps; ++t)
+            {
+                const size_t slot = size_t(std::lower_bound(rows.begin(), rows.end(), axisY.index[e + t]) - rows.begin());
+                rowPtrs[t] = filtered + vectors * slot;
+                weights[t] = axisY.weight[e + t];
+            }
+
+            ResampleColumns(vectors, axisY.taps, rowPtrs.data(), weights.data(), target);
+
+            uint8_t* pDest = destImage.pixels + destImage.rowPitch * y + xBegin * job.bytesPerPixel;
+
+            switch (job.path)
+            {
+            case RESAMPLE_R32F:
+                memcpy(pDest, target, sizeof(float) * width);
+                break;
+
+            case RESAMPLE_RGBA8:
+                for (size_t i = 0; i < width; ++i)
+                    XMStoreUByteN4(reinterpret_cast<XMUBYTEN4*>(pDest) + i, XMVectorAdd(target[i], g_resample8BitBias));
+                break;
+
+            case RESAMPLE_RGBA32F:
+                memcpy(pDest, target, sizeof(XMVECTOR) * width);
+                break;
+
+            default:
+                if (job.bias)
+                {
+                    // Same bias as ResizeTriangleFilter for floating-point error accumulation
+                    static const XMVECTORF32 Bias = { { { 0.f, 0.f, 0.f, 0.1f } } };
+
+                    for (size_t i = 0; i < width; ++i)
+                        target[i] = XMVectorAdd(target[i], Bias);
+                }
+
+                if (job.linear)
+                {
+                    if (!_StoreScanlineLinear(pDest, destSize, destImage.format, target, width, job.filter))
+                        return E_FAIL;
+                }
+                else if (!_StoreScanline(pDest, destSize, destImage.format, target, width))
+                {
+                    return E_FAIL;
+                }
+                break;
+            }
+        }
+
+        return S_OK;
+    }
 }
 
 
@@ -1092,3 +1699,117 @@ HRESULT DirectX::Resize(
 
     return S_OK;
 }
+
+
+//-------------------------------------------------------------------------------------
+// Resize image (complex) on a thread pool
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DirectX::Resize(
+    const Image* srcImages,
+    size_t nimages,
+    const TexMetadata& metadata,
+    size_t width,
+    size_t height,
+    DWORD filter,
+    const ParallelOptions& options,
+    ScratchImage& result)
+{
+    if (!srcImages || !nimages || width == 0 || height == 0)
+        return E_INVALIDARG;
+
+    if ((width > UINT32_MAX) || (height > UINT32_MAX) || (metadata.width > UINT32_MAX) || (metadata.height > UINT32_MAX))
+        return E_INVALIDARG;
+
+    if (IsCompressed(metadata.format) || IsTypeless(metadata.format) || IsPlanar(metadata.format) || IsPalettized(metadata.format))
+        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+
+    // WIC objects are not shared across the worker threads, so only the custom filters are used
+    if (filter & TEX_FILTER_FORCE_WIC)
+        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+
+    DWORD filter_select = (filter & TEX_FILTER_MASK);
+    if (!filter_select)
+    {
+        // Default filter choice
+        filter_select = (((width << 1) == metadata.width) && ((height << 1) == metadata.height))
+            ? TEX_FILTER_BOX : TEX_FILTER_LINEAR;
+    }
+
+    ResampleAxis axisX, axisY;
+    HRESULT hr = CreateResampleAxis(filter_select, metadata.width, width,
+        (filter & TEX_FILTER_WRAP_U) != 0, (filter & TEX_FILTER_MIRROR_U) != 0, axisX);
+    if (SUCCEEDED(hr))
+    {
+        hr = CreateResampleAxis(filter_select, metadata.height, height,
+            (filter & TEX_FILTER_WRAP_V) != 0, (filter & TEX_FILTER_MIRROR_V) != 0, axisY);
+    }
+    if (FAILED(hr))
+        return hr;
+
+    // The top level of every array item, or every slice of a volume
+    const size_t count = metadata.IsVolumemap() ? metadata.depth : metadata.arraySize;
+
+    std::vector<Image> srcList;
+    srcList.reserve(count);
+    for (size_t j = 0; j < count; ++j)
+    {
+        size_t index = metadata.IsVolumemap() ? metadata.ComputeIndex(0, 0, j) : metadata.ComputeIndex(0, j, 0);
+        if (index >= nimages)
+            return E_FAIL;
+
+        const Image& src = srcImages[index];
+        if (!src.pixels)
+            return E_POINTER;
+
+        if (src.format != metadata.format || src.width != metadata.width || src.height != metadata.height)
+            return E_FAIL;
+
+        srcList.push_back(src);
+    }
+
+    TexMetadata mdata2 = metadata;
+    mdata2.width = width;
+    mdata2.height = height;
+    mdata2.mipLevels = 1;
+    hr = result.Initialize(mdata2);
+    if (FAILED(hr))
+        return hr;
+
+    ResampleJob job = {};
+    job.axisX = &axisX;
+    job.axisY = &axisY;
+    job.path = ChooseResamplePath(metadata.format, filter);
+    job.filter = filter;
+    job.linear = (filter_select != TEX_FILTER_POINT);
+    job.bias = (filter_select == TEX_FILTER_TRIANGLE)
+        && (metadata.format == DXGI_FORMAT_R10G10B10A2_UNORM || metadata.format == DXGI_FORMAT_R10G10B10A2_UINT);
+
+    // Rows of whole-byte pixels are also split into column tiles
+    const size_t bpp = BitsPerPixel(metadata.format);
+    job.bytesPerPixel = ((bpp & 7) == 0 && !IsPacked(metadata.format)) ? bpp / 8 : 0;
+    job.tileWidth = job.bytesPerPixel ? RESAMPLE_TILE_WIDTH : width;
+
+    const size_t tilesX = (width + job.tileWidth - 1) / job.tileWidth;
+    const size_t tilesY = (height + RESAMPLE_TILE_HEIGHT - 1) / RESAMPLE_TILE_HEIGHT;
+    const size_t tiles = tilesX * tilesY;
+    const size_t total = count * tiles;
+
+    hr = _ParallelFor(total, options, 0, total,
+        [&](size_t task) -> HRESULT
+    {
+        const size_t j = task / tiles;
+        const size_t tile = task % tiles;
+
+        const Image* dest = metadata.IsVolumemap() ? result.GetImage(0, 0, j) : result.GetImage(0, j, 0);
+        if (!dest)
+            return E_POINTER;
+
+        return ResampleTile(job, srcList[j], *dest, (tile % tilesX) * job.tileWidth, (tile / tilesX) * RESAMPLE_TILE_HEIGHT);
+    });
+
+    if (FAILED(hr))
+        result.Release();
+
+    return hr;
+}
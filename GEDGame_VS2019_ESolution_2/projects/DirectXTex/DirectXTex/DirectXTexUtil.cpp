@@ -11,6 +11,9 @@
 
 #include "DirectXTexP.h"
 
+#include <mutex>
+#include <thread>
+
 #if defined(_XBOX_ONE) && defined(_TITLE)
 static_assert(XBOX_DXGI_FORMAT_R10G10B10_7E3_A2_FLOAT == DXGI_FORMAT_R10G10B10_7E3_A2_FLOAT, "Xbox One XDK mismatch detected");
 static_assert(XBOX_DXGI_FORMAT_R10G10B10_6E4_A2_FLOAT == DXGI_FORMAT_R10G10B10_6E4_A2_FLOAT, "Xbox One XDK mismatch detected");
@@ -113,6 +116,76 @@ namespace
             ifactory)) ? TRUE : FALSE;
     #endif
     }
+
+    //-------------------------------------------------------------------------------------
+    // Task indices owned by one _ParallelFor worker. The owner takes tasks from the
+    // front, idle workers steal the back half.
+    //-------------------------------------------------------------------------------------
+    struct WorkRange
+    {
+        std::mutex  mutex;
+        size_t      begin;
+        size_t      end;
+    };
+
+    bool PopTask(_Inout_ WorkRange& range, _Out_ size_t& index)
+    {
+        std::lock_guard<std::mutex> lock(range.mutex);
+        if (range.begin >= range.end)
+            return false;
+
+        index = range.begin++;
+        return true;
+    }
+
+    bool StealTask(
+        _Inout_updates_(count) WorkRange* ranges, size_t count, size_t self, _Out_ size_t& index)
+    {
+        for (;;)
+        {
+            // Pick the worker with the most work left
+            size_t victim = self;
+            size_t most = 0;
+            for (size_t i = 0; i < count; ++i)
+            {
+                if (i == self)
+                    continue;
+
+                std::lock_guard<std::mutex> lock(ranges[i].mutex);
+                size_t left = ranges[i].end - ranges[i].begin;
+                if (left > most)
+                {
+                    most = left;
+                    victim = i;
+                }
+            }
+
+            if (victim == self)
+                return false;
+
+            size_t begin, end;
+            {
+                std::lock_guard<std::mutex> lock(ranges[victim].mutex);
+                if (ranges[victim].begin >= ranges[victim].end)
+                {
+                    // Emptied in the meantime, look again
+                    continue;
+                }
+
+                begin = ranges[victim].begin + (ranges[victim].end - ranges[victim].begin) / 2;
+                end = ranges[victim].end;
+                ranges[victim].end = begin;
+            }
+
+            // Only one lock is held at a time, so the stolen tasks are briefly owned by nobody.
+            // That costs other thieves a chance to share them but never loses any.
+            std::lock_guard<std::mutex> lock(ranges[self].mutex);
+            index = begin;
+            ranges[self].begin = begin + 1;
+            ranges[self].end = end;
+            return true;
+        }
+    }
 }
 
 
@@ -1378,6 +1451,111 @@ DXGI_FORMAT DirectX::MakeTypelessFLOAT(DXGI_FORMAT fmt)
 }
 
 
+//=====================================================================================
+// Thread pool
+//=====================================================================================
+
+_Use_decl_annotations_
+HRESULT DirectX::_ParallelFor(
+    size_t count,
+    const ParallelOptions& options,
+    size_t progressBase,
+    size_t progressTotal,
+    std::function<HRESULT __cdecl(size_t index)> task)
+{
+    if (!count)
+        return S_OK;
+
+    size_t threadCount = options.threadCount ? options.threadCount : std::thread::hardware_concurrency();
+    threadCount = std::max<size_t>(1, std::min(threadCount, count));
+
+    std::unique_ptr<WorkRange[]> ranges(new (std::nothrow) WorkRange[threadCount]);
+    if (!ranges)
+        return E_OUTOFMEMORY;
+
+    // Contiguous shares keep neighbouring rows on one thread until it runs dry
+    for (size_t i = 0; i < threadCount; ++i)
+    {
+        ranges[i].begin = count * i / threadCount;
+        ranges[i].end = count * (i + 1) / threadCount;
+    }
+
+    std::atomic<HRESULT> result(S_OK);
+    std::mutex progressMutex;
+    size_t done = 0;
+
+    auto fail = [&](HRESULT hr) noexcept
+    {
+        HRESULT expected = S_OK;
+        result.compare_exchange_strong(expected, hr);
+    };
+
+    auto worker = [&](size_t self) noexcept
+    {
+        for (;;)
+        {
+            if (FAILED(result.load(std::memory_order_relaxed)))
+                return;
+
+            if (options.cancel && options.cancel->load(std::memory_order_relaxed))
+            {
+                fail(E_ABORT);
+                return;
+            }
+
+            size_t index;
+            if (!PopTask(ranges[self], index) && !StealTask(ranges.get(), threadCount, self, index))
+                return;
+
+            HRESULT hr;
+            try
+            {
+                hr = task(index);
+            }
+            catch (const std::bad_alloc&)
+            {
+                hr = E_OUTOFMEMORY;
+            }
+            catch (...)
+            {
+                hr = E_FAIL;
+            }
+
+            if (FAILED(hr))
+            {
+                fail(hr);
+                return;
+            }
+
+            if (options.progress)
+            {
+                std::lock_guard<std::mutex> lock(progressMutex);
+                options.progress(progressBase + ++done, progressTotal);
+            }
+        }
+    };
+
+    // The calling thread is worker 0. If a thread can't be started, its share is stolen by the others.
+    std::vector<std::thread> threads;
+    try
+    {
+        threads.reserve(threadCount - 1);
+        for (size_t i = 1; i < threadCount; ++i)
+            threads.emplace_back(worker, i);
+    }
+    catch (...)
+    {
+    }
+
+    worker(0);
+
+    for (auto& thread : threads)
+        thread.join();
+
+    return result;
+}
+
+
 //=====================================================================================
 // TexMetadata
 //=====================================================================================
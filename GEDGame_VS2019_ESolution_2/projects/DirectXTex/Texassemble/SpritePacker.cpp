@@ -0,0 +1,82 @@
+//--------------------------------------------------------------------------------------
+// File: SpritePacker.cpp
+//
+// Placement of sprite frames in the slices of a texture array and the frame table
+// written by "texassemble sprites"
+//--------------------------------------------------------------------------------------
+
+#include "SpritePacker.h"
+
+#include <algorithm>
+
+bool SpritePacker::IsValidFrameSize(size_t size)
+{
+    return size > 0 && (size & (size - 1)) == 0;
+}
+
+bool SpritePacker::PackFrames(const std::vector<size_t>& frameSizes, size_t maxSlices, Layout& layout)
+{
+    layout.sliceSize = 0;
+    layout.slices = 0;
+    layout.mipLevels = 1;
+    layout.frames.assign(frameSizes.size(), FramePlacement{});
+
+    for (size_t size : frameSizes)
+    {
+        if (!IsValidFrameSize(size))
+            return false;
+
+        layout.sliceSize = std::max(layout.sliceSize, size);
+    }
+
+    // Largest cells first, each size starts on a new slice
+    size_t cellSize = layout.sliceSize;
+    for (size_t size = layout.sliceSize; size > 0; size >>= 1)
+    {
+        const size_t perRow = layout.sliceSize / size;
+        const size_t perSlice = perRow * perRow;
+
+        size_t cell = 0;
+        for (size_t j = 0; j < frameSizes.size(); ++j)
+        {
+            if (frameSizes[j] != size)
+                continue;
+
+            FramePlacement& frame = layout.frames[j];
+            frame.slice = layout.slices + cell / perSlice;
+            frame.x = (cell % perRow) * size;
+            frame.y = ((cell % perSlice) / perRow) * size;
+            frame.size = size;
+            ++cell;
+        }
+
+        if (cell)
+        {
+            layout.slices += (cell + perSlice - 1) / perSlice;
+            cellSize = size;
+        }
+    }
+
+    while ((cellSize >> layout.mipLevels) >= 4)
+        ++layout.mipLevels;
+
+    return layout.slices <= maxSlices;
+}
+
+void SpritePacker::WriteTable(std::wostream& out, const std::vector<Sequence>& sequences, const Layout& layout, float frameRate)
+{
+    out << L"# slices <count> <size>" << std::endl;
+    out << L"# sprite <name> <first frame> <frame count> <frames per second>" << std::endl;
+    out << L"# frame <slice> <x> <y> <size>" << std::endl;
+    out << L"slices " << layout.slices << L" " << layout.sliceSize << std::endl;
+
+    for (const auto& sequence : sequences)
+    {
+        out << L"sprite " << sequence.name << L" " << sequence.firstFrame << L" " << sequence.frameCount << L" " << frameRate << std::endl;
+    }
+
+    for (const auto& frame : layout.frames)
+    {
+        out << L"frame " << frame.slice << L" " << frame.x << L" " << frame.y << L" " << frame.size << std::endl;
+    }
+}
@@ -0,0 +1,56 @@
+//--------------------------------------------------------------------------------------
+// File: SpritePacker.h
+//
+// Placement of sprite frames in the slices of a texture array and the frame table
+// written by "texassemble sprites". Independent of Windows, so it is also tested on
+// its own.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace SpritePacker
+{
+    struct FramePlacement
+    {
+        size_t slice;
+        size_t x;
+        size_t y;
+        size_t size;
+    };
+
+    struct Layout
+    {
+        size_t sliceSize;       // Width and height of every slice, the size of the largest frame
+        size_t slices;
+        size_t mipLevels;       // Down to 4x4 for the smallest cell, the smallest block compressed frame
+        std::vector<FramePlacement> frames;     // In the order of the frame sizes
+    };
+
+    struct Sequence
+    {
+        std::wstring name;
+        size_t firstFrame;
+        size_t frameCount;
+    };
+
+    bool IsValidFrameSize(size_t size);
+        // Frames must be square powers of 2
+
+    bool PackFrames(const std::vector<size_t>& frameSizes, size_t maxSlices, Layout& layout);
+        // Smaller frames are cells of a grid and every slice holds a single cell size. The cells are
+        // aligned to their size, so box filtered mips never mix neighbours. Frames of one size keep
+        // their order. Returns false for an invalid frame size or when more than maxSlices are needed,
+        // layout.slices is the number needed in that case.
+
+    void WriteTable(std::wostream& out, const std::vector<Sequence>& sequences, const Layout& layout, float frameRate);
+        // The frame table as read by the game's SpriteRenderer:
+        //   slices <count> <size>
+        //   sprite <name> <first frame> <frame count> <frames per second>
+        //   frame <slice> <x> <y> <size>
+        // after a comment with these lines
+}
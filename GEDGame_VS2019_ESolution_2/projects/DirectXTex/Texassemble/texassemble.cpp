@@ -25,7 +25,9 @@
 #include <stdlib.h>
 #include <assert.h>
 
+#include <algorithm>
 #include <fstream>
+#include <iterator>
 #include <memory>
 #include <list>
 #include <vector>
@@ -38,6 +40,7 @@
 #include <wincodec.h>
 
 #include "DirectXTex.h"
+#include "SpritePacker.h"
 
 //Uncomment to add support for OpenEXR (.exr)
 //#define USE_OPENEXR
@@ -63,6 +66,7 @@ enum COMMANDS
     CMD_MERGE,
     CMD_GIF,
     CMD_ARRAY_STRIP,
+    CMD_SPRITES,
     CMD_MAX
 };
 
@@ -88,6 +92,7 @@ enum OPTIONS
     OPT_TONEMAP,
     OPT_FILELIST,
     OPT_GIF_BGCOLOR,
+    OPT_FRAMERATE,
     OPT_MAX
 };
 
@@ -98,6 +103,15 @@ struct SConversion
     wchar_t szSrc[MAX_PATH];
 };
 
+struct SSprite
+{
+    wchar_t szName[_MAX_FNAME];
+    size_t firstInput;
+    size_t inputCount;
+    size_t firstFrame;
+    size_t frameCount;
+};
+
 struct SValue
 {
     LPCWSTR pName;
@@ -121,6 +135,7 @@ const SValue g_pCommands[] =
     { L"merge",         CMD_MERGE },
     { L"gif",           CMD_GIF },
     { L"array-strip",   CMD_ARRAY_STRIP },
+    { L"sprites",       CMD_SPRITES },
     { nullptr,          0 }
 };
 
@@ -146,6 +161,7 @@ const SValue g_pOptions [] =
     { L"tonemap",   OPT_TONEMAP },
     { L"flist",     OPT_FILELIST },
     { L"bgcolor",   OPT_GIF_BGCOLOR },
+    { L"fps",       OPT_FRAMERATE },
     { nullptr,      0 }
 };
 
@@ -500,7 +516,8 @@ namespace
         wprintf(L"   h-strip or v-strip  create a strip image from a cubemap\n");
         wprintf(L"   array-strip         creates a strip image from a 1D/2D array\n");
         wprintf(L"   merge               create texture from rgb image and alpha image\n");
-        wprintf(L"   gif                 create array from animated gif\n\n");
+        wprintf(L"   gif                 create array from animated gif\n");
+        wprintf(L"   sprites             pack sprite frames into a mipmapped array and frame table\n\n");
         wprintf(L"   -r                  wildcard filename search is recursive\n");
         wprintf(L"   -w <n>              width\n");
         wprintf(L"   -h <n>              height\n");
@@ -519,6 +536,10 @@ namespace
         wprintf(L"   -flist <filename>   use text file with a list of input files (one per line)\n");
         wprintf(L"\n                       (gif only)\n");
         wprintf(L"   -bgcolor            Use background color instead of transparency\n");
+        wprintf(L"\n                       (sprites only)\n");
+        wprintf(L"   Each file is a sprite, each wildcard the frames of a sprite named after\n");
+        wprintf(L"   their directory. The frame table is written next to the output as .txt\n");
+        wprintf(L"   -fps <n>            flipbook frame rate stored in the frame table (30)\n");
 
         wprintf(L"\n   <format>: ");
         PrintList(13, g_pFormats);
@@ -552,6 +573,48 @@ namespace
         }
     }
 
+    void GetSpriteName(const wchar_t* path, wchar_t* szName)
+    {
+        wchar_t dir[_MAX_DIR] = {};
+        _wsplitpath_s(path, nullptr, 0, dir, _MAX_DIR, nullptr, 0, nullptr, 0);
+
+        size_t len = wcslen(dir);
+        while (len > 0 && (dir[len - 1] == L'\\' || dir[len - 1] == L'/'))
+            dir[--len] = 0;
+
+        const wchar_t* name = dir;
+        for (const wchar_t* pChar = dir; *pChar; ++pChar)
+        {
+            if (*pChar == L'\\' || *pChar == L'/' || *pChar == L':')
+                name = pChar + 1;
+        }
+
+        wcscpy_s(szName, _MAX_FNAME, *name ? name : L"sprite");
+    }
+
+    HRESULT SaveSpriteTable(
+        const wchar_t* szFile,
+        const std::vector<SSprite>& sprites,
+        const SpritePacker::Layout& layout,
+        float frameRate)
+    {
+        std::wofstream outFile(szFile);
+        if (!outFile)
+            return HRESULT_FROM_WIN32(ERROR_CANNOT_MAKE);
+
+        std::vector<SpritePacker::Sequence> sequences;
+        sequences.reserve(sprites.size());
+        for (const auto& sprite : sprites)
+        {
+            sequences.push_back({ sprite.szName, sprite.firstFrame, sprite.frameCount });
+        }
+
+        SpritePacker::WriteTable(outFile, sequences, layout, frameRate);
+
+        outFile.close();
+        return outFile.fail() ? HRESULT_FROM_WIN32(ERROR_WRITE_FAULT) : S_OK;
+    }
+
     enum
     {
         DM_UNDEFINED = 0,
@@ -910,6 +973,7 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
     // Parameters and defaults
     size_t width = 0;
     size_t height = 0;
+    float frameRate = 30.f;
 
     DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
     DWORD dwFilter = TEX_FILTER_DEFAULT;
@@ -948,15 +1012,17 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
     case CMD_MERGE:
     case CMD_GIF:
     case CMD_ARRAY_STRIP:
+    case CMD_SPRITES:
         break;
 
     default:
-        wprintf(L"Must use one of: cube, volume, array, cubearray,\n   h-cross, v-cross, h-strip, v-strip, array-strip\n   merge, gif\n\n");
+        wprintf(L"Must use one of: cube, volume, array, cubearray,\n   h-cross, v-cross, h-strip, v-strip, array-strip\n   merge, gif, sprites\n\n");
         return 1;
     }
 
     DWORD dwOptions = 0;
     std::list<SConversion> conversion;
+    std::vector<SSprite> sprites;
 
     for (int iArg = 2; iArg < argc; iArg++)
     {
@@ -991,6 +1057,7 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             case OPT_FILTER:
             case OPT_OUTPUTFILE:
             case OPT_FILELIST:
+            case OPT_FRAMERATE:
                 if (!*pValue)
                 {
                     if ((iArg + 1 >= argc))
@@ -1162,6 +1229,19 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
                     return 1;
                 }
                 break;
+
+            case OPT_FRAMERATE:
+                if (dwCommand != CMD_SPRITES)
+                {
+                    wprintf(L"-fps only applies to sprites command\n");
+                    return 1;
+                }
+                if (swscanf_s(pValue, L"%f", &frameRate) != 1 || frameRate <= 0.f)
+                {
+                    wprintf(L"Invalid value specified with -fps (%ls)\n", pValue);
+                    return 1;
+                }
+                break;
             }
         }
         else if (wcspbrk(pArg, L"?*") != nullptr)
@@ -1173,6 +1253,24 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
                 wprintf(L"No matching files found for %ls\n", pArg);
                 return 1;
             }
+
+            if (dwCommand == CMD_SPRITES)
+            {
+                // The matches are the frames of one sprite, in file name order
+                auto first = conversion.begin();
+                std::advance(first, count);
+
+                std::list<SConversion> frames;
+                frames.splice(frames.end(), conversion, first, conversion.end());
+                frames.sort([](const SConversion& a, const SConversion& b) { return _wcsicmp(a.szSrc, b.szSrc) < 0; });
+                conversion.splice(conversion.end(), frames);
+
+                SSprite sprite = {};
+                GetSpriteName(pArg, sprite.szName);
+                sprite.firstInput = count;
+                sprite.inputCount = conversion.size() - count;
+                sprites.push_back(sprite);
+            }
         }
         else
         {
@@ -1192,6 +1290,36 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
     if (~dwOptions & (1 << OPT_NOLOGO))
         PrintLogo();
 
+    if (dwCommand == CMD_SPRITES)
+    {
+        // Every input which is not part of a wildcard is a single sprite
+        std::vector<SSprite> groups;
+        groups.swap(sprites);
+
+        auto group = groups.cbegin();
+        auto pConv = conversion.cbegin();
+        for (size_t index = 0; index < conversion.size(); )
+        {
+            if (group != groups.cend() && group->firstInput == index)
+            {
+                sprites.push_back(*group);
+                std::advance(pConv, group->inputCount);
+                index += group->inputCount;
+                ++group;
+                continue;
+            }
+
+            SSprite sprite = {};
+            _wsplitpath_s(pConv->szSrc, nullptr, 0, nullptr, 0, sprite.szName, _MAX_FNAME, nullptr, 0);
+            sprite.firstInput = index;
+            sprite.inputCount = 1;
+            sprites.push_back(sprite);
+
+            ++pConv;
+            ++index;
+        }
+    }
+
     switch (dwCommand)
     {
     case CMD_H_CROSS:
@@ -1536,6 +1664,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             }
 
             // --- Resize ------------------------------------------------------------------
+            // Sprite frames keep their own size unless -w or -h is given
+            bool keepSize = (dwCommand == CMD_SPRITES) && !(dwOptions & ((1 << OPT_WIDTH) | (1 << OPT_HEIGHT)));
             if (!width)
             {
                 width = info.width;
@@ -1544,7 +1674,7 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             {
                 height = info.height;
             }
-            if (info.width != width || info.height != height)
+            if (!keepSize && (info.width != width || info.height != height))
             {
                 std::unique_ptr<ScratchImage> timage(new (std::nothrow) ScratchImage);
                 if (!timage)
@@ -1720,6 +1850,7 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
     case CMD_H_STRIP:
     case CMD_V_STRIP:
     case CMD_GIF:
+    case CMD_SPRITES:
         break;
 
     default:
@@ -1954,6 +2085,168 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
         break;
     }
 
+    case CMD_SPRITES:
+    {
+        if (loadedImages.size() != conversion.size())
+        {
+            wprintf(L"\nERROR: Every sprite frame must load to build the frame table\n");
+            return 1;
+        }
+
+        // Frames must be square powers of 2
+        std::vector<const Image*> frames;
+        std::vector<size_t> frameSizes;
+        frames.reserve(images);
+        frameSizes.reserve(images);
+
+        for (auto& sprite : sprites)
+        {
+            sprite.firstFrame = frames.size();
+
+            for (size_t index = 0; index < sprite.inputCount; ++index)
+            {
+                const ScratchImage* simage = loadedImages[sprite.firstInput + index].get();
+                assert(simage != 0);
+                for (size_t j = 0; j < simage->GetMetadata().arraySize; ++j)
+                {
+                    const Image* img = simage->GetImage(0, j, 0);
+                    assert(img != 0);
+                    if (img->width != img->height || !SpritePacker::IsValidFrameSize(img->width))
+                    {
+                        wprintf(L"\nERROR: Sprite %ls has a %zu x %zu frame, frames must be square powers of 2\n",
+                            sprite.szName, img->width, img->height);
+                        return 1;
+                    }
+
+                    frames.push_back(img);
+                    frameSizes.push_back(img->width);
+                }
+            }
+
+            sprite.frameCount = frames.size() - sprite.firstFrame;
+        }
+
+        SpritePacker::Layout layout;
+        if (!SpritePacker::PackFrames(frameSizes, D3D11_REQ_TEXTURE2D_ARRAY_AXIS_DIMENSION, layout))
+        {
+            wprintf(L"\nERROR: Sprites need %zu slices, the limit is %d\n", layout.slices, D3D11_REQ_TEXTURE2D_ARRAY_AXIS_DIMENSION);
+            return 1;
+        }
+
+        DXGI_FORMAT packFormat = IsCompressed(format) ? frames.front()->format : format;
+
+        ScratchImage packed;
+        hr = packed.Initialize2D(packFormat, layout.sliceSize, layout.sliceSize, layout.slices, 1);
+        if (FAILED(hr))
+        {
+            wprintf(L"FAILED setting up result image (%x)\n", hr);
+            return 1;
+        }
+
+        memset(packed.GetPixels(), 0, packed.GetPixelsSize());
+
+        for (size_t j = 0; j < frames.size(); ++j)
+        {
+            const SpritePacker::FramePlacement& frame = layout.frames[j];
+            Rect rect(0, 0, frame.size, frame.size);
+
+            hr = CopyRectangle(*frames[j], rect, *packed.GetImage(0, frame.slice, 0), dwFilter | dwFilterOpts, frame.x, frame.y);
+            if (FAILED(hr))
+            {
+                wprintf(L"FAILED building result image (%x)\n", hr);
+                return 1;
+            }
+        }
+
+        std::unique_ptr<ScratchImage> result(new (std::nothrow) ScratchImage);
+        if (!result)
+        {
+            wprintf(L"\nERROR: Memory allocation failed\n");
+            return 1;
+        }
+
+        if (layout.mipLevels > 1)
+        {
+            // sRGB input is filtered in linear space and stored encoded again
+            DWORD mipFilter = TEX_FILTER_BOX | TEX_FILTER_FORCE_NON_WIC;
+            if (dwSRGB & TEX_FILTER_SRGB_IN)
+                mipFilter |= TEX_FILTER_SRGB;
+
+            hr = GenerateMipMaps(packed.GetImages(), packed.GetImageCount(), packed.GetMetadata(), mipFilter, layout.mipLevels, *result);
+            if (FAILED(hr))
+            {
+                wprintf(L"FAILED [mipmaps] (%x)\n", hr);
+                return 1;
+            }
+        }
+        else
+        {
+            std::swap(packed, *result);
+        }
+
+        if (IsCompressed(format))
+        {
+            std::unique_ptr<ScratchImage> timage(new (std::nothrow) ScratchImage);
+            if (!timage)
+            {
+                wprintf(L"\nERROR: Memory allocation failed\n");
+                return 1;
+            }
+
+            hr = Compress(result->GetImages(), result->GetImageCount(), result->GetMetadata(), format,
+                TEX_COMPRESS_PARALLEL | dwSRGB, TEX_THRESHOLD_DEFAULT, *timage);
+            if (FAILED(hr))
+            {
+                wprintf(L"FAILED [compress] (%x)\n", hr);
+                return 1;
+            }
+
+            result.swap(timage);
+        }
+
+        wchar_t szTableFile[MAX_PATH] = {};
+        {
+            wchar_t drive[_MAX_DRIVE] = {};
+            wchar_t dir[_MAX_DIR] = {};
+            wchar_t fname[_MAX_FNAME] = {};
+            _wsplitpath_s(szOutputFile, drive, _MAX_DRIVE, dir, _MAX_DIR, fname, _MAX_FNAME, nullptr, 0);
+            _wmakepath_s(szTableFile, drive, dir, fname, L".txt");
+        }
+
+        // Write sprites and their frame table
+        wprintf(L"\nWriting %ls ", szOutputFile);
+        PrintInfo(result->GetMetadata());
+        wprintf(L"\nWriting %ls (%zu sprites, %zu frames)\n", szTableFile, sprites.size(), frames.size());
+        fflush(stdout);
+
+        if (~dwOptions & (1 << OPT_OVERWRITE))
+        {
+            if (GetFileAttributesW(szOutputFile) != INVALID_FILE_ATTRIBUTES
+                || GetFileAttributesW(szTableFile) != INVALID_FILE_ATTRIBUTES)
+            {
+                wprintf(L"\nERROR: Output file already exists, use -y to overwrite\n");
+                return 1;
+            }
+        }
+
+        hr = SaveToDDSFile(result->GetImages(), result->GetImageCount(), result->GetMetadata(),
+            (dwOptions & (1 << OPT_USE_DX10)) ? (DDS_FLAGS_FORCE_DX10_EXT | DDS_FLAGS_FORCE_DX10_EXT_MISC2) : DDS_FLAGS_NONE,
+            szOutputFile);
+        if (FAILED(hr))
+        {
+            wprintf(L"\nFAILED (%x)\n", hr);
+            return 1;
+        }
+
+        hr = SaveSpriteTable(szTableFile, sprites, layout, frameRate);
+        if (FAILED(hr))
+        {
+            wprintf(L"\nFAILED [frame table] (%x)\n", hr);
+            return 1;
+        }
+        break;
+    }
+
     case CMD_ARRAY_STRIP:
     {
         size_t twidth = width;
@@ -23,9 +23,17 @@
 #include <stdlib.h>
 #include <assert.h>
 
+#include <stdarg.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
 #include <fstream>
 #include <memory>
+#include <mutex>
 #include <list>
+#include <thread>
+#include <vector>
 
 #include <wrl\client.h>
 
@@ -35,6 +43,8 @@
 
 #include <wincodec.h>
 
+#include <bcrypt.h>
+
 #include "DirectXTex.h"
 
 #include "DirectXPackedVector.h"
@@ -47,6 +57,8 @@
 #include "DirectXTexEXR.h"
 #endif
 
+#pragma comment(lib, "bcrypt.lib")
+
 using namespace DirectX;
 using namespace DirectX::PackedVector;
 using Microsoft::WRL::ComPtr;
@@ -95,6 +107,8 @@ enum OPTIONS
     OPT_COMPRESS_MAX,
     OPT_COMPRESS_QUICK,
     OPT_COMPRESS_DITHER,
+    OPT_COMPRESS_SIMD,
+    OPT_COMPRESS_BC7_FAST,
     OPT_WIC_QUALITY,
     OPT_WIC_LOSSLESS,
     OPT_WIC_MULTIFRAME,
@@ -106,6 +120,11 @@ enum OPTIONS
     OPT_FILELIST,
     OPT_ROTATE_COLOR,
     OPT_PAPER_WHITE_NITS,
+    OPT_JOBS,
+    OPT_JOB_MEMORY,
+    OPT_CACHE,
+    OPT_CACHE_SIZE,
+    OPT_CACHE_LINK,
     OPT_MAX
 };
 
@@ -182,6 +201,8 @@ const SValue g_pOptions[] =
     { L"bcmax",         OPT_COMPRESS_MAX },
     { L"bcquick",       OPT_COMPRESS_QUICK },
     { L"bcdither",      OPT_COMPRESS_DITHER },
+    { L"bcsimd",        OPT_COMPRESS_SIMD },
+    { L"bc7fast",       OPT_COMPRESS_BC7_FAST },
     { L"wicq",          OPT_WIC_QUALITY },
     { L"wiclossless",   OPT_WIC_LOSSLESS },
     { L"wicmulti",      OPT_WIC_MULTIFRAME },
@@ -193,6 +214,11 @@ const SValue g_pOptions[] =
     { L"flist",         OPT_FILELIST },
     { L"rotatecolor",   OPT_ROTATE_COLOR },
     { L"nits",          OPT_PAPER_WHITE_NITS },
+    { L"j",             OPT_JOBS },
+    { L"jmem",          OPT_JOB_MEMORY },
+    { L"cache",         OPT_CACHE },
+    { L"cachemax",      OPT_CACHE_SIZE },
+    { L"cachelink",     OPT_CACHE_LINK },
     { nullptr,          0 }
 };
 
@@ -554,13 +580,68 @@ namespace
     }
 
 
-    void PrintFormat(DXGI_FORMAT Format)
+    // Console output for converting one file. With -j it is buffered so that the messages
+    // of files converted at the same time are not interleaved.
+    class ConsoleLog
+    {
+    public:
+        explicit ConsoleLog(bool buffered = false) : m_buffered(buffered) {}
+
+        void Print(_In_z_ _Printf_format_string_ const wchar_t* format, ...)
+        {
+            va_list args;
+            va_start(args, format);
+
+            if (!m_buffered)
+            {
+                vwprintf(format, args);
+            }
+            else
+            {
+                va_list argsCount;
+                va_copy(argsCount, args);
+                int length = _vscwprintf(format, argsCount);
+                va_end(argsCount);
+
+                if (length > 0)
+                {
+                    size_t offset = m_text.size();
+                    m_text.resize(offset + size_t(length) + 1);
+                    vswprintf_s(&m_text[offset], size_t(length) + 1, format, args);
+                    m_text.resize(offset + size_t(length));
+                }
+            }
+
+            va_end(args);
+        }
+
+        void Flush()
+        {
+            if (!m_buffered)
+                fflush(stdout);
+        }
+
+        bool IsEmpty() const { return m_text.empty(); }
+
+        void Write()
+        {
+            wprintf(L"%ls", m_text.c_str());
+            m_text.clear();
+        }
+
+    private:
+        bool            m_buffered;
+        std::wstring    m_text;
+    };
+
+
+    void PrintFormat(DXGI_FORMAT Format, ConsoleLog& log)
     {
         for (const SValue *pFormat = g_pFormats; pFormat->pName; pFormat++)
         {
             if ((DXGI_FORMAT)pFormat->dwValue == Format)
             {
-                wprintf(pFormat->pName);
+                log.Print(L"%ls", pFormat->pName);
                 return;
             }
         }
@@ -569,67 +650,67 @@ namespace
         {
             if ((DXGI_FORMAT)pFormat->dwValue == Format)
             {
-                wprintf(pFormat->pName);
+                log.Print(L"%ls", pFormat->pName);
                 return;
             }
         }
 
-        wprintf(L"*UNKNOWN*");
+        log.Print(L"*UNKNOWN*");
     }
 
 
-    void PrintInfo(const TexMetadata& info)
+    void PrintInfo(const TexMetadata& info, ConsoleLog& log)
     {
-        wprintf(L" (%zux%zu", info.width, info.height);
+        log.Print(L" (%zux%zu", info.width, info.height);
 
         if (TEX_DIMENSION_TEXTURE3D == info.dimension)
-            wprintf(L"x%zu", info.depth);
+            log.Print(L"x%zu", info.depth);
 
         if (info.mipLevels > 1)
-            wprintf(L",%zu", info.mipLevels);
+            log.Print(L",%zu", info.mipLevels);
 
         if (info.arraySize > 1)
-            wprintf(L",%zu", info.arraySize);
+            log.Print(L",%zu", info.arraySize);
 
-        wprintf(L" ");
-        PrintFormat(info.format);
+        log.Print(L" ");
+        PrintFormat(info.format, log);
 
         switch (info.dimension)
         {
         case TEX_DIMENSION_TEXTURE1D:
-            wprintf((info.arraySize > 1) ? L" 1DArray" : L" 1D");
+            log.Print((info.arraySize > 1) ? L" 1DArray" : L" 1D");
             break;
 
         case TEX_DIMENSION_TEXTURE2D:
             if (info.IsCubemap())
             {
-                wprintf((info.arraySize > 6) ? L" CubeArray" : L" Cube");
+                log.Print((info.arraySize > 6) ? L" CubeArray" : L" Cube");
             }
             else
             {
-                wprintf((info.arraySize > 1) ? L" 2DArray" : L" 2D");
+                log.Print((info.arraySize > 1) ? L" 2DArray" : L" 2D");
             }
             break;
 
         case TEX_DIMENSION_TEXTURE3D:
-            wprintf(L" 3D");
+            log.Print(L" 3D");
             break;
         }
 
         switch (info.GetAlphaMode())
         {
         case TEX_ALPHA_MODE_OPAQUE:
-            wprintf(L" \x0e0:Opaque");
+            log.Print(L" \x0e0:Opaque");
             break;
         case TEX_ALPHA_MODE_PREMULTIPLIED:
-            wprintf(L" \x0e0:PM");
+            log.Print(L" \x0e0:PM");
             break;
         case TEX_ALPHA_MODE_STRAIGHT:
-            wprintf(L" \x0e0:NonPM");
+            log.Print(L" \x0e0:NonPM");
             break;
         }
 
-        wprintf(L")");
+        log.Print(L")");
     }
 
 
@@ -736,12 +817,20 @@ namespace
 #ifdef _OPENMP
         wprintf(L"   -singleproc         Do not use multi-threaded compression\n");
 #endif
+        wprintf(L"   -j <n>              Convert <n> files at a time (0 is one per hardware thread)\n");
+        wprintf(L"   -jmem <MB>          Cap on the estimated memory of the files in flight with -j\n");
+        wprintf(L"                       (defaults to half of the physical memory)\n");
+        wprintf(L"   -cache <directory>  Reuse converted files from a content addressed cache\n");
+        wprintf(L"   -cachemax <MB>      Cache size, least recently used files are removed (def: 1024)\n");
+        wprintf(L"   -cachelink          Hard link cached files to the output instead of copying\n");
         wprintf(L"   -gpu <adapter>      Select GPU for DirectCompute-based codecs (0 is default)\n");
         wprintf(L"   -nogpu              Do not use DirectCompute-based codecs\n");
         wprintf(L"   -bcuniform          Use uniform rather than perceptual weighting for BC1-3\n");
         wprintf(L"   -bcdither           Use dithering for BC1-3\n");
+        wprintf(L"   -bcsimd             Use the SIMD encoder for BC1 & BC3 (4 blocks at once)\n");
         wprintf(L"   -bcmax              Use exhaustive compression (BC7 only)\n");
         wprintf(L"   -bcquick            Use quick compression (BC7 only)\n");
+        wprintf(L"   -bc7fast <level>    Use the fast BC7 CPU profile, level 1 (best) to 3 (fastest)\n");
         wprintf(L"   -wicq <quality>     When writing images with WIC use quality (0.0 to 1.0)\n");
         wprintf(L"   -wiclossless        When writing images with WIC use lossless mode\n");
         wprintf(L"   -wicmulti           When writing images with WIC encode multiframe images\n");
@@ -793,7 +882,7 @@ namespace
 
 
     _Success_(return != false)
-        bool CreateDevice(int adapter, _Outptr_ ID3D11Device** pDevice)
+        bool CreateDevice(int adapter, _Outptr_ ID3D11Device** pDevice, ConsoleLog& log)
     {
         if (!pDevice)
             return false;
@@ -833,7 +922,7 @@ namespace
             {
                 if (FAILED(dxgiFactory->EnumAdapters(adapter, pAdapter.GetAddressOf())))
                 {
-                    wprintf(L"\nERROR: Invalid GPU adapter index (%d)!\n", adapter);
+                    log.Print(L"\nERROR: Invalid GPU adapter index (%d)!\n", adapter);
                     return false;
                 }
             }
@@ -878,7 +967,7 @@ namespace
                     hr = pAdapter->GetDesc(&desc);
                     if (SUCCEEDED(hr))
                     {
-                        wprintf(L"\n[Using DirectCompute on \"%ls\"]\n", desc.Description);
+                        log.Print(L"\n[Using DirectCompute on \"%ls\"]\n", desc.Description);
                     }
                 }
             }
@@ -1089,6 +1178,458 @@ namespace
 
         return S_OK;
     }
+
+
+    enum CONVERT_RESULT
+    {
+        CONVERT_OK = 0,
+        CONVERT_SKIPPED,    // Error reported, continue with the next file
+        CONVERT_FATAL,      // Error reported, stop converting files
+    };
+
+    enum STAGES
+    {
+        STAGE_LOAD = 0,
+        STAGE_PROCESS,
+        STAGE_COMPRESS,
+        STAGE_SAVE,
+        STAGE_MAX
+    };
+
+    // Adds the time since the previous stage ended to the stage that is ending
+    class StageTimer
+    {
+    public:
+        explicit StageTimer(_Inout_updates_(STAGE_MAX) LONGLONG* times) : m_times(times)
+        {
+            if (!QueryPerformanceCounter(&m_last))
+            {
+                m_last.QuadPart = 0;
+            }
+        }
+
+        void End(size_t stage)
+        {
+            LARGE_INTEGER now;
+            if (!QueryPerformanceCounter(&now))
+            {
+                now = m_last;
+            }
+
+            m_times[stage] += now.QuadPart - m_last.QuadPart;
+            m_last = now;
+        }
+
+    private:
+        LONGLONG*       m_times;
+        LARGE_INTEGER   m_last;
+    };
+
+
+    // Bytes of memory handed out to the files being converted with -j. One file is always let
+    // through, so a file larger than the cap is converted on its own.
+    class MemoryBudget
+    {
+    public:
+        explicit MemoryBudget(uint64_t limit) : m_limit(limit), m_used(0) {}
+
+        void Acquire(uint64_t bytes)
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_released.wait(lock, [&]() { return !m_used || (m_used + bytes <= m_limit); });
+            m_used += bytes;
+        }
+
+        void Release(uint64_t bytes)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_used -= bytes;
+            }
+            m_released.notify_all();
+        }
+
+    private:
+        uint64_t                m_limit;
+        uint64_t                m_used;
+        std::mutex              m_mutex;
+        std::condition_variable m_released;
+    };
+
+
+    // Rough peak memory needed to convert a file, read from its header: the larger of the source and
+    // target size in a 128-bit format with a full mip chain, once for the source and once for the result
+    // of a processing step. Returns 0 for files the header can't be read from; loading reports the error.
+    uint64_t EstimateWorkingSet(_In_z_ const wchar_t* szFile, size_t width, size_t height)
+    {
+        wchar_t ext[_MAX_EXT];
+        _wsplitpath_s(szFile, nullptr, 0, nullptr, 0, nullptr, 0, ext, _MAX_EXT);
+
+        TexMetadata info;
+        HRESULT hr;
+        if (_wcsicmp(ext, L".dds") == 0)
+        {
+            hr = GetMetadataFromDDSFile(szFile, DDS_FLAGS_NONE, info);
+        }
+        else if (_wcsicmp(ext, L".tga") == 0)
+        {
+            hr = GetMetadataFromTGAFile(szFile, info);
+        }
+        else if (_wcsicmp(ext, L".hdr") == 0)
+        {
+            hr = GetMetadataFromHDRFile(szFile, info);
+        }
+#ifdef USE_OPENEXR
+        else if (_wcsicmp(ext, L".exr") == 0)
+        {
+            hr = GetMetadataFromEXRFile(szFile, info);
+        }
+#endif
+        else
+        {
+            hr = GetMetadataFromWICFile(szFile, WIC_FLAGS_ALL_FRAMES, info);
+        }
+        if (FAILED(hr))
+            return 0;
+
+        uint64_t texels = uint64_t(std::max(info.width, width)) * uint64_t(std::max(info.height, height)) * info.depth * info.arraySize;
+        return texels * sizeof(XMFLOAT4) * 2 * 4 / 3;
+    }
+
+
+    bool HasDuplicateDestinations(const std::list<SConversion>& conversion)
+    {
+        std::vector<const wchar_t*> dest;
+        dest.reserve(conversion.size());
+        for (auto& conv : conversion)
+            dest.push_back(conv.szDest);
+
+        std::sort(dest.begin(), dest.end(), [](const wchar_t* a, const wchar_t* b) { return _wcsicmp(a, b) < 0; });
+
+        return std::adjacent_find(dest.begin(), dest.end(), [](const wchar_t* a, const wchar_t* b) { return _wcsicmp(a, b) == 0; }) != dest.end();
+    }
+
+
+    // SHA-256 using the CNG (bcrypt) provider
+    class SHA256Hash
+    {
+    public:
+        static const size_t DigestSize = 32;
+
+        SHA256Hash() : m_alg(nullptr), m_hash(nullptr) {}
+
+        ~SHA256Hash()
+        {
+            if (m_hash)
+                BCryptDestroyHash(m_hash);
+            if (m_alg)
+                BCryptCloseAlgorithmProvider(m_alg, 0);
+        }
+
+        SHA256Hash(const SHA256Hash&) = delete;
+        SHA256Hash& operator=(const SHA256Hash&) = delete;
+
+        HRESULT Initialize()
+        {
+            NTSTATUS status = BCryptOpenAlgorithmProvider(&m_alg, BCRYPT_SHA256_ALGORITHM, nullptr, 0);
+            if (!BCRYPT_SUCCESS(status))
+                return HRESULT_FROM_NT(status);
+
+            status = BCryptCreateHash(m_alg, &m_hash, nullptr, 0, nullptr, 0, 0);
+            if (!BCRYPT_SUCCESS(status))
+                return HRESULT_FROM_NT(status);
+
+            return S_OK;
+        }
+
+        HRESULT Update(_In_reads_bytes_(size) const void* data, size_t size)
+        {
+            auto ptr = static_cast<const uint8_t*>(data);
+            while (size > 0)
+            {
+                ULONG chunk = static_cast<ULONG>(std::min<size_t>(size, 0x40000000));
+                NTSTATUS status = BCryptHashData(m_hash, const_cast<PUCHAR>(ptr), chunk, 0);
+                if (!BCRYPT_SUCCESS(status))
+                    return HRESULT_FROM_NT(status);
+
+                ptr += chunk;
+                size -= chunk;
+            }
+
+            return S_OK;
+        }
+
+        HRESULT UpdateFromFile(_In_z_ const wchar_t* szFile)
+        {
+            ScopedHandle hFile(safe_handle(CreateFileW(szFile, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                FILE_FLAG_SEQUENTIAL_SCAN, nullptr)));
+            if (!hFile)
+            {
+                return HRESULT_FROM_WIN32(GetLastError());
+            }
+
+            const DWORD bufferSize = 1024 * 1024;
+            std::unique_ptr<uint8_t[]> buffer(new (std::nothrow) uint8_t[bufferSize]);
+            if (!buffer)
+            {
+                return E_OUTOFMEMORY;
+            }
+
+            for (;;)
+            {
+                DWORD bytesRead = 0;
+                if (!ReadFile(hFile.get(), buffer.get(), bufferSize, &bytesRead, nullptr))
+                {
+                    return HRESULT_FROM_WIN32(GetLastError());
+                }
+
+                if (!bytesRead)
+                    return S_OK;
+
+                HRESULT hr = Update(buffer.get(), bytesRead);
+                if (FAILED(hr))
+                    return hr;
+            }
+        }
+
+        HRESULT Finish(_Out_writes_bytes_(DigestSize) uint8_t* digest)
+        {
+            NTSTATUS status = BCryptFinishHash(m_hash, digest, static_cast<ULONG>(DigestSize), 0);
+            if (!BCRYPT_SUCCESS(status))
+                return HRESULT_FROM_NT(status);
+
+            return S_OK;
+        }
+
+    private:
+        BCRYPT_ALG_HANDLE   m_alg;
+        BCRYPT_HASH_HANDLE  m_hash;
+    };
+
+
+    // Content addressed cache of converted files (-cache). An entry is named by the SHA-256 of
+    // the texconv executable, the options that affect the output and the bytes of the source
+    // file, so a change to any of them is a miss. On a hit the entry is copied or hard linked to
+    // the output. Entries are touched when used, and Trim deletes the least recently used ones.
+    class TextureCache
+    {
+    public:
+        TextureCache() : m_hits(0), m_misses(0), m_stored(0), m_prefix{} { m_directory[0] = m_suffix[0] = 0; }
+
+        TextureCache(const TextureCache&) = delete;
+        TextureCache& operator=(const TextureCache&) = delete;
+
+        HRESULT Initialize(_In_z_ const wchar_t* directory, _In_z_ const wchar_t* suffix,
+            _In_reads_bytes_(optionsSize) const void* options, size_t optionsSize)
+        {
+            wcscpy_s(m_directory, MAX_PATH, directory);
+            if (m_directory[0] && (L'\\' != m_directory[wcslen(m_directory) - 1]))
+                wcscat_s(m_directory, MAX_PATH, L"\\");
+
+            wcscpy_s(m_suffix, MAX_PATH, suffix);
+
+            if (!CreateDirectoryW(m_directory, nullptr) && GetLastError() != ERROR_ALREADY_EXISTS)
+            {
+                return HRESULT_FROM_WIN32(GetLastError());
+            }
+
+            wchar_t exePath[MAX_PATH] = {};
+            if (!GetModuleFileNameW(nullptr, exePath, MAX_PATH))
+            {
+                return HRESULT_FROM_WIN32(GetLastError());
+            }
+
+            SHA256Hash hash;
+            HRESULT hr = hash.Initialize();
+            if (SUCCEEDED(hr))
+                hr = hash.UpdateFromFile(exePath);
+            if (SUCCEEDED(hr))
+                hr = hash.Update(options, optionsSize);
+            if (SUCCEEDED(hr))
+                hr = hash.Finish(m_prefix);
+
+            return hr;
+        }
+
+        // Hashes the source file and returns the name of its entry
+        HRESULT GetEntry(_In_z_ const wchar_t* szSrc, _Out_writes_(MAX_PATH) wchar_t* szEntry) const
+        {
+            *szEntry = 0;
+
+            // The extension picks the loader
+            wchar_t ext[_MAX_EXT] = {};
+            _wsplitpath_s(szSrc, nullptr, 0, nullptr, 0, nullptr, 0, ext, _MAX_EXT);
+            _wcslwr_s(ext);
+
+            uint8_t digest[SHA256Hash::DigestSize];
+
+            SHA256Hash hash;
+            HRESULT hr = hash.Initialize();
+            if (SUCCEEDED(hr))
+                hr = hash.Update(m_prefix, sizeof(m_prefix));
+            if (SUCCEEDED(hr))
+                hr = hash.Update(ext, wcslen(ext) * sizeof(wchar_t));
+            if (SUCCEEDED(hr))
+                hr = hash.UpdateFromFile(szSrc);
+            if (SUCCEEDED(hr))
+                hr = hash.Finish(digest);
+            if (FAILED(hr))
+                return hr;
+
+            wchar_t name[SHA256Hash::DigestSize * 2 + 1];
+            for (size_t i = 0; i < SHA256Hash::DigestSize; ++i)
+            {
+                swprintf_s(&name[i * 2], 3, L"%02x", digest[i]);
+            }
+
+            wcscpy_s(szEntry, MAX_PATH, m_directory);
+            wcscat_s(szEntry, MAX_PATH, name);
+            wcscat_s(szEntry, MAX_PATH, m_suffix);
+
+            return S_OK;
+        }
+
+        // Writes the output from the cache, returns false on a miss
+        bool Fetch(_In_z_ const wchar_t* szEntry, _In_z_ const wchar_t* szDest, bool link)
+        {
+            if (GetFileAttributesW(szEntry) == INVALID_FILE_ATTRIBUTES)
+            {
+                ++m_misses;
+                return false;
+            }
+
+            // The output may also be the source, which has been hashed already. It may also be a hard
+            // link to another entry, which copying over it would change.
+            (void)DeleteFileW(szDest);
+
+            bool done = false;
+            if (link)
+            {
+                done = CreateHardLinkW(szDest, szEntry, nullptr) != FALSE;
+            }
+
+            if (!done && !CopyFileW(szEntry, szDest, FALSE))
+            {
+                ++m_misses;
+                return false;
+            }
+
+            Touch(szEntry);
+
+            ++m_hits;
+            return true;
+        }
+
+        // Adds a converted output to the cache
+        void Store(_In_z_ const wchar_t* szDest, _In_z_ const wchar_t* szEntry)
+        {
+            // Copy to a temporary name first so that other processes never see a partial entry
+            wchar_t temp[MAX_PATH];
+            swprintf_s(temp, L"%ls.%lu.%lu.tmp", szEntry, GetCurrentProcessId(), GetCurrentThreadId());
+
+            if (CopyFileW(szDest, temp, FALSE))
+            {
+                if (MoveFileExW(temp, szEntry, MOVEFILE_REPLACE_EXISTING))
+                {
+                    Touch(szEntry);
+                    ++m_stored;
+                    return;
+                }
+
+                (void)DeleteFileW(temp);
+            }
+        }
+
+        // Deletes the least recently used entries until the cache fits in maxBytes
+        void Trim(uint64_t maxBytes, _Out_ size_t& evicted, _Out_ uint64_t& totalBytes) const
+        {
+            evicted = 0;
+            totalBytes = 0;
+
+            struct Entry
+            {
+                FILETIME    lastUsed;
+                uint64_t    size;
+                std::wstring name;
+            };
+
+            std::vector<Entry> entries;
+
+            wchar_t searchPath[MAX_PATH];
+            wcscpy_s(searchPath, MAX_PATH, m_directory);
+            wcscat_s(searchPath, MAX_PATH, L"*");
+
+            WIN32_FIND_DATAW findData = {};
+            ScopedFindHandle hFind(safe_handle(FindFirstFileExW(searchPath,
+                FindExInfoBasic, &findData,
+                FindExSearchNameMatch, nullptr,
+                FIND_FIRST_EX_LARGE_FETCH)));
+            if (!hFind)
+                return;
+
+            for (;;)
+            {
+                if (!(findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+                {
+                    Entry entry;
+                    entry.lastUsed = findData.ftLastWriteTime;
+                    entry.size = (uint64_t(findData.nFileSizeHigh) << 32) | findData.nFileSizeLow;
+                    entry.name = findData.cFileName;
+                    totalBytes += entry.size;
+                    entries.push_back(std::move(entry));
+                }
+
+                if (!FindNextFileW(hFind.get(), &findData))
+                    break;
+            }
+
+            if (totalBytes <= maxBytes)
+                return;
+
+            std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b)
+            {
+                return CompareFileTime(&a.lastUsed, &b.lastUsed) < 0;
+            });
+
+            for (auto& entry : entries)
+            {
+                if (totalBytes <= maxBytes)
+                    break;
+
+                std::wstring path = m_directory + entry.name;
+                if (DeleteFileW(path.c_str()))
+                {
+                    totalBytes -= entry.size;
+                    ++evicted;
+                }
+            }
+        }
+
+        size_t GetHits() const { return m_hits; }
+        size_t GetMisses() const { return m_misses; }
+        size_t GetStored() const { return m_stored; }
+
+    private:
+        // The last write time orders the entries by use
+        static void Touch(_In_z_ const wchar_t* szEntry)
+        {
+            ScopedHandle hFile(safe_handle(CreateFileW(szEntry, FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                nullptr, OPEN_EXISTING, 0, nullptr)));
+            if (hFile)
+            {
+                FILETIME now;
+                GetSystemTimeAsFileTime(&now);
+                (void)SetFileTime(hFile.get(), nullptr, nullptr, &now);
+            }
+        }
+
+        std::atomic<size_t> m_hits;
+        std::atomic<size_t> m_misses;
+        std::atomic<size_t> m_stored;
+        uint8_t             m_prefix[SHA256Hash::DigestSize];
+        wchar_t             m_directory[MAX_PATH];
+        wchar_t             m_suffix[MAX_PATH];
+    };
 }
 
 
@@ -1120,21 +1661,28 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
     DWORD dwRotateColor = 0;
     float paperWhiteNits = 200.f;
     float preserveAlphaCoverageRef = 0.0f;
+    size_t jobs = 1;
+    uint64_t memoryLimit = 0;
+    uint64_t cacheLimit = uint64_t(1024) * 1024 * 1024;
 
     wchar_t szPrefix[MAX_PATH];
     wchar_t szSuffix[MAX_PATH];
     wchar_t szOutputDir[MAX_PATH];
+    wchar_t szCacheDir[MAX_PATH];
 
     szPrefix[0] = 0;
     szSuffix[0] = 0;
     szOutputDir[0] = 0;
+    szCacheDir[0] = 0;
 
     // Initialize COM (needed for WIC)
-    HRESULT hr = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
-    if (FAILED(hr))
     {
-        wprintf(L"Failed to initialize COM (%08X)\n", hr);
-        return 1;
+        HRESULT hr = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+        if (FAILED(hr))
+        {
+            wprintf(L"Failed to initialize COM (%08X)\n", hr);
+            return 1;
+        }
     }
 
     // Process command line
@@ -1188,6 +1736,11 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             case OPT_ROTATE_COLOR:
             case OPT_PAPER_WHITE_NITS:
             case OPT_PRESERVE_ALPHA_COVERAGE:
+            case OPT_COMPRESS_BC7_FAST:
+            case OPT_JOBS:
+            case OPT_JOB_MEMORY:
+            case OPT_CACHE:
+            case OPT_CACHE_SIZE:
                 if (!*pValue)
                 {
                     if ((iArg + 1 >= argc))
@@ -1502,6 +2055,23 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
                 dwCompress |= TEX_COMPRESS_DITHER;
                 break;
 
+            case OPT_COMPRESS_SIMD:
+                dwCompress |= TEX_COMPRESS_SIMD;
+                break;
+
+            case OPT_COMPRESS_BC7_FAST:
+                {
+                    int level = 0;
+                    if (swscanf_s(pValue, L"%d", &level) != 1 || level < 1 || level > 3)
+                    {
+                        wprintf(L"Invalid value specified with -bc7fast (%ls), must be 1, 2 or 3\n\n", pValue);
+                        PrintUsage();
+                        return 1;
+                    }
+                    dwCompress |= DWORD(TEX_COMPRESS_BC7_FAST) * DWORD(level);
+                }
+                break;
+
             case OPT_WIC_QUALITY:
                 if (swscanf_s(pValue, L"%f", &wicQuality) != 1
                     || (wicQuality < 0.f)
@@ -1598,6 +2168,49 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
                     return 1;
                 }
                 break;
+
+            case OPT_JOBS:
+                if (swscanf_s(pValue, L"%zu", &jobs) != 1)
+                {
+                    wprintf(L"Invalid value specified with -j (%ls)\n\n", pValue);
+                    PrintUsage();
+                    return 1;
+                }
+                else if (!jobs)
+                {
+                    jobs = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+                }
+                break;
+
+            case OPT_JOB_MEMORY:
+                {
+                    size_t megabytes = 0;
+                    if (swscanf_s(pValue, L"%zu", &megabytes) != 1 || !megabytes)
+                    {
+                        wprintf(L"Invalid value specified with -jmem (%ls)\n\n", pValue);
+                        PrintUsage();
+                        return 1;
+                    }
+                    memoryLimit = uint64_t(megabytes) * 1024 * 1024;
+                }
+                break;
+
+            case OPT_CACHE:
+                wcscpy_s(szCacheDir, MAX_PATH, pValue);
+                break;
+
+            case OPT_CACHE_SIZE:
+                {
+                    size_t megabytes = 0;
+                    if (swscanf_s(pValue, L"%zu", &megabytes) != 1)
+                    {
+                        wprintf(L"Invalid value specified with -cachemax (%ls)\n\n", pValue);
+                        PrintUsage();
+                        return 1;
+                    }
+                    cacheLimit = uint64_t(megabytes) * 1024 * 1024;
+                }
+                break;
             }
         }
         else if (wcspbrk(pArg, L"?*") != nullptr)
@@ -1669,32 +2282,208 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
         qpcStart.QuadPart = 0;
     }
 
-    // Convert images
-    bool nonpow2warn = false;
-    bool non4bc = false;
-    bool preserveAlphaCoverage = false;
+    // Figure out dest filenames
+    for (auto& conv : conversion)
+    {
+        wchar_t *pchSlash, *pchDot;
+
+        wcscpy_s(conv.szDest, MAX_PATH, szPrefix);
+
+        pchSlash = wcsrchr(conv.szSrc, L'\\');
+        if (pchSlash != 0)
+            wcscat_s(conv.szDest, MAX_PATH, pchSlash + 1);
+        else
+            wcscat_s(conv.szDest, MAX_PATH, conv.szSrc);
+
+        pchSlash = wcsrchr(conv.szDest, '\\');
+        pchDot = wcsrchr(conv.szDest, '.');
+
+        if (pchDot > pchSlash)
+            *pchDot = 0;
+
+        wcscat_s(conv.szDest, MAX_PATH, szSuffix);
+    }
+
+    if (jobs > 1 && HasDuplicateDestinations(conversion))
+    {
+        // Which file wins would depend on the order they finish in
+        wprintf(L"WARNING: Several files are written to the same output file, ignoring -j\n\n");
+        jobs = 1;
+    }
+
+    // DirectCompute device for the BC6H / BC7 codecs, created on first use
     ComPtr<ID3D11Device> pDevice;
+    std::mutex gpuMutex;
+    bool gpuTried = false;
+    auto initDevice = [&](ConsoleLog& log)
+    {
+        if (gpuTried)
+            return;
+        gpuTried = true;
+
+        if (!(dwOptions & (DWORD64(1) << OPT_NOGPU)))
+        {
+            if (!CreateDevice(adapter, pDevice.GetAddressOf(), log))
+                log.Print(L"\nWARNING: DirectCompute is not available, using BC6H / BC7 CPU codec\n");
+        }
+        else
+        {
+            log.Print(L"\nWARNING: using BC6H / BC7 CPU codec\n");
+        }
+    };
+
+    std::unique_ptr<TextureCache> cache;
+    if (dwOptions & (DWORD64(1) << OPT_CACHE))
+    {
+        // Only the options which change the output are part of the key. They are added as parsed
+        // values, so the spelling and order of the command line don't matter.
+        const DWORD64 outputOptions = dwOptions & ~((DWORD64(1) << OPT_RECURSIVE) | (DWORD64(1) << OPT_PREFIX)
+            | (DWORD64(1) << OPT_SUFFIX) | (DWORD64(1) << OPT_OUTPUTDIR) | (DWORD64(1) << OPT_OVERWRITE)
+            | (DWORD64(1) << OPT_NOLOGO) | (DWORD64(1) << OPT_TIMING) | (DWORD64(1) << OPT_FORCE_SINGLEPROC)
+            | (DWORD64(1) << OPT_FILELIST) | (DWORD64(1) << OPT_JOBS) | (DWORD64(1) << OPT_JOB_MEMORY)
+            | (DWORD64(1) << OPT_CACHE) | (DWORD64(1) << OPT_CACHE_SIZE) | (DWORD64(1) << OPT_CACHE_LINK));
+
+        std::vector<uint8_t> key;
+        auto addKey = [&](const void* data, size_t size)
+        {
+            auto ptr = static_cast<const uint8_t*>(data);
+            key.insert(key.end(), ptr, ptr + size);
+        };
+
+        addKey(&outputOptions, sizeof(outputOptions));
+        addKey(&width, sizeof(width));
+        addKey(&height, sizeof(height));
+        addKey(&mipLevels, sizeof(mipLevels));
+        addKey(&format, sizeof(format));
+        addKey(&dwFilter, sizeof(dwFilter));
+        addKey(&dwSRGB, sizeof(dwSRGB));
+        addKey(&dwConvert, sizeof(dwConvert));
+        addKey(&dwCompress, sizeof(dwCompress));
+        addKey(&dwFilterOpts, sizeof(dwFilterOpts));
+        addKey(&FileType, sizeof(FileType));
+        addKey(&maxSize, sizeof(maxSize));
+        addKey(&alphaWeight, sizeof(alphaWeight));
+        addKey(&dwNormalMap, sizeof(dwNormalMap));
+        addKey(&nmapAmplitude, sizeof(nmapAmplitude));
+        addKey(&wicQuality, sizeof(wicQuality));
+        addKey(&colorKey, sizeof(colorKey));
+        addKey(&dwRotateColor, sizeof(dwRotateColor));
+        addKey(&paperWhiteNits, sizeof(paperWhiteNits));
+        addKey(&preserveAlphaCoverageRef, sizeof(preserveAlphaCoverageRef));
+
+        // The GPU and CPU codecs give different BC6H / BC7 blocks, so the device is created up front
+        // whenever the output could be BC6H / BC7, and the adapter used (none for the CPU codec) is
+        // part of the key rather than the -gpu index
+        UINT codecAdapter[2] = {};
+        switch (format)
+        {
+        case DXGI_FORMAT_UNKNOWN:
+        case DXGI_FORMAT_BC6H_TYPELESS:
+        case DXGI_FORMAT_BC6H_UF16:
+        case DXGI_FORMAT_BC6H_SF16:
+        case DXGI_FORMAT_BC7_TYPELESS:
+        case DXGI_FORMAT_BC7_UNORM:
+        case DXGI_FORMAT_BC7_UNORM_SRGB:
+        {
+            ConsoleLog log;
+            initDevice(log);
+
+            ComPtr<IDXGIDevice> dxgiDevice;
+            ComPtr<IDXGIAdapter> dxgiAdapter;
+            DXGI_ADAPTER_DESC desc;
+            if (pDevice
+                && SUCCEEDED(pDevice.As(&dxgiDevice))
+                && SUCCEEDED(dxgiDevice->GetAdapter(dxgiAdapter.GetAddressOf()))
+                && SUCCEEDED(dxgiAdapter->GetDesc(&desc)))
+            {
+                codecAdapter[0] = desc.VendorId;
+                codecAdapter[1] = desc.DeviceId;
+            }
+            break;
+        }
+
+        default:
+            break;
+        }
+        addKey(codecAdapter, sizeof(codecAdapter));
+
+        cache.reset(new (std::nothrow) TextureCache);
+        if (!cache)
+        {
+            wprintf(L"\nERROR: Memory allocation failed\n");
+            return 1;
+        }
+
+        HRESULT hr = cache->Initialize(szCacheDir, szSuffix, key.data(), key.size());
+        if (FAILED(hr))
+        {
+            wprintf(L"ERROR: Failed to open -cache directory %ls (%08X)\n", szCacheDir, hr);
+            return 1;
+        }
+    }
 
-    for (auto pConv = conversion.begin(); pConv != conversion.end(); ++pConv)
+    // Each concurrent file gets an even share of the hardware threads for the CPU codecs
+    ParallelOptions compressOptions;
+    if (jobs > 1)
     {
-        if (pConv != conversion.begin())
-            wprintf(L"\n");
+        size_t threads = std::thread::hardware_concurrency();
+        compressOptions.threadCount = (dwOptions & (DWORD64(1) << OPT_FORCE_SINGLEPROC)) ? 1 : std::max<size_t>(threads / jobs, 1);
+    }
+
+    // Convert images
+    std::atomic<bool> nonpow2warn(false);
+    std::atomic<bool> non4bc(false);
+    LONGLONG stageTime[STAGE_MAX] = {};
+
+    auto convertFile = [&](SConversion& conv, ConsoleLog& log, StageTimer& timer) -> CONVERT_RESULT
+    {
+        HRESULT hr;
 
         // Load source image
-        wprintf(L"reading %ls", pConv->szSrc);
-        fflush(stdout);
+        log.Print(L"reading %ls", conv.szSrc);
+        log.Flush();
+
+        // --- Build cache -------------------------------------------------------------
+        wchar_t cacheEntry[MAX_PATH] = {};
+        if (cache)
+        {
+            hr = cache->GetEntry(conv.szSrc, cacheEntry);
+            if (FAILED(hr))
+            {
+                log.Print(L" FAILED (%x)\n", hr);
+                return CONVERT_SKIPPED;
+            }
+
+            timer.End(STAGE_LOAD);
+
+            if (~dwOptions & (DWORD64(1) << OPT_OVERWRITE))
+            {
+                if (GetFileAttributesW(conv.szDest) != INVALID_FILE_ATTRIBUTES)
+                {
+                    log.Print(L"\nERROR: Output file already exists, use -y to overwrite:\n");
+                    return CONVERT_SKIPPED;
+                }
+            }
+
+            if (cache->Fetch(cacheEntry, conv.szDest, (dwOptions & (DWORD64(1) << OPT_CACHE_LINK)) != 0))
+            {
+                log.Print(L" (cached)\nwriting %ls\n", conv.szDest);
+                timer.End(STAGE_SAVE);
+                return CONVERT_OK;
+            }
+        }
 
         wchar_t ext[_MAX_EXT];
         wchar_t fname[_MAX_FNAME];
-        _wsplitpath_s(pConv->szSrc, nullptr, 0, nullptr, 0, fname, _MAX_FNAME, ext, _MAX_EXT);
+        _wsplitpath_s(conv.szSrc, nullptr, 0, nullptr, 0, fname, _MAX_FNAME, ext, _MAX_EXT);
 
         TexMetadata info;
         std::unique_ptr<ScratchImage> image(new (std::nothrow) ScratchImage);
 
         if (!image)
         {
-            wprintf(L"\nERROR: Memory allocation failed\n");
-            return 1;
+            log.Print(L"\nERROR: Memory allocation failed\n");
+            return CONVERT_FATAL;
         }
 
         if (_wcsicmp(ext, L".dds") == 0)
@@ -1707,11 +2496,11 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             if (dwOptions & (DWORD64(1) << OPT_DDS_BAD_DXTN_TAILS))
                 ddsFlags |= DDS_FLAGS_BAD_DXTN_TAILS;
 
-            hr = LoadFromDDSFile(pConv->szSrc, ddsFlags, &info, *image);
+            hr = LoadFromDDSFile(conv.szSrc, ddsFlags, &info, *image);
             if (FAILED(hr))
             {
-                wprintf(L" FAILED (%x)\n", hr);
-                continue;
+                log.Print(L" FAILED (%x)\n", hr);
+                return CONVERT_SKIPPED;
             }
 
             if (IsTypeless(info.format))
@@ -1727,8 +2516,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
 
                 if (IsTypeless(info.format))
                 {
-                    wprintf(L" FAILED due to Typeless format %d\n", info.format);
-                    continue;
+                    log.Print(L" FAILED due to Typeless format %d\n", info.format);
+                    return CONVERT_SKIPPED;
                 }
 
                 image->OverrideFormat(info.format);
@@ -1738,7 +2527,7 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
         {
             std::unique_ptr<uint8_t []> bmpData;
             size_t bmpSize;
-            hr = ReadData(pConv->szSrc, bmpData, bmpSize);
+            hr = ReadData(conv.szSrc, bmpData, bmpSize);
             if (SUCCEEDED(hr))
             {
                 hr = LoadFromWICMemory(bmpData.get(), bmpSize, dwFilter, &info, *image);
@@ -1752,36 +2541,36 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             }
             if (FAILED(hr))
             {
-                wprintf(L" FAILED (%x)\n", hr);
-                continue;
+                log.Print(L" FAILED (%x)\n", hr);
+                return CONVERT_SKIPPED;
             }
         }
         else if (_wcsicmp(ext, L".tga") == 0)
         {
-            hr = LoadFromTGAFile(pConv->szSrc, &info, *image);
+            hr = LoadFromTGAFile(conv.szSrc, &info, *image);
             if (FAILED(hr))
             {
-                wprintf(L" FAILED (%x)\n", hr);
-                continue;
+                log.Print(L" FAILED (%x)\n", hr);
+                return CONVERT_SKIPPED;
             }
         }
         else if (_wcsicmp(ext, L".hdr") == 0)
         {
-            hr = LoadFromHDRFile(pConv->szSrc, &info, *image);
+            hr = LoadFromHDRFile(conv.szSrc, &info, *image);
             if (FAILED(hr))
             {
-                wprintf(L" FAILED (%x)\n", hr);
-                continue;
+                log.Print(L" FAILED (%x)\n", hr);
+                return CONVERT_SKIPPED;
             }
         }
 #ifdef USE_OPENEXR
         else if (_wcsicmp(ext, L".exr") == 0)
         {
-            hr = LoadFromEXRFile(pConv->szSrc, &info, *image);
+            hr = LoadFromEXRFile(conv.szSrc, &info, *image);
             if (FAILED(hr))
             {
-                wprintf(L" FAILED (%x)\n", hr);
-                continue;
+                log.Print(L" FAILED (%x)\n", hr);
+                return CONVERT_SKIPPED;
             }
         }
 #endif
@@ -1799,15 +2588,17 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             if (FileType == CODEC_DDS)
                 wicFlags |= WIC_FLAGS_ALL_FRAMES;
 
-            hr = LoadFromWICFile(pConv->szSrc, wicFlags, &info, *image);
+            hr = LoadFromWICFile(conv.szSrc, wicFlags, &info, *image);
             if (FAILED(hr))
             {
-                wprintf(L" FAILED (%x)\n", hr);
-                continue;
+                log.Print(L" FAILED (%x)\n", hr);
+                return CONVERT_SKIPPED;
             }
         }
 
-        PrintInfo(info);
+        timer.End(STAGE_LOAD);
+
+        PrintInfo(info, log);
 
         size_t tMips = (!mipLevels && info.mipLevels > 1) ? info.mipLevels : mipLevels;
 
@@ -1833,7 +2624,7 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
 
         if (sizewarn)
         {
-            wprintf(L"\nWARNING: Target size exceeds maximum size for feature level (%u)\n", maxSize);
+            log.Print(L"\nWARNING: Target size exceeds maximum size for feature level (%u)\n", maxSize);
         }
 
         if (dwOptions & (DWORD64(1) << OPT_FIT_POWEROF2))
@@ -1842,8 +2633,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
         }
 
         // Convert texture
-        wprintf(L" as");
-        fflush(stdout);
+        log.Print(L" as");
+        log.Flush();
 
         // --- Planar ------------------------------------------------------------------
         if (IsPlanar(info.format))
@@ -1855,15 +2646,15 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             std::unique_ptr<ScratchImage> timage(new (std::nothrow) ScratchImage);
             if (!timage)
             {
-                wprintf(L"\nERROR: Memory allocation failed\n");
-                return 1;
+                log.Print(L"\nERROR: Memory allocation failed\n");
+                return CONVERT_FATAL;
             }
 
             hr = ConvertToSinglePlane(img, nimg, info, *timage);
             if (FAILED(hr))
             {
-                wprintf(L" FAILED [converttosingleplane] (%x)\n", hr);
-                continue;
+                log.Print(L" FAILED [converttosingleplane] (%x)\n", hr);
+                return CONVERT_SKIPPED;
             }
 
             auto& tinfo = timage->GetMetadata();
@@ -1894,15 +2685,15 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             std::unique_ptr<ScratchImage> timage(new (std::nothrow) ScratchImage);
             if (!timage)
             {
-                wprintf(L"\nERROR: Memory allocation failed\n");
-                return 1;
+                log.Print(L"\nERROR: Memory allocation failed\n");
+                return CONVERT_FATAL;
             }
 
             hr = Decompress(img, nimg, info, DXGI_FORMAT_UNKNOWN /* picks good default */, *timage);
             if (FAILED(hr))
             {
-                wprintf(L" FAILED [decompress] (%x)\n", hr);
-                continue;
+                log.Print(L" FAILED [decompress] (%x)\n", hr);
+                return CONVERT_SKIPPED;
             }
 
             auto& tinfo = timage->GetMetadata();
@@ -1936,11 +2727,11 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
         {
             if (info.GetAlphaMode() == TEX_ALPHA_MODE_STRAIGHT)
             {
-                printf("\nWARNING: Image is already using straight alpha\n");
+                log.Print(L"\nWARNING: Image is already using straight alpha\n");
             }
             else if (!info.IsPMAlpha())
             {
-                printf("\nWARNING: Image is not using premultipled alpha\n");
+                log.Print(L"\nWARNING: Image is not using premultipled alpha\n");
             }
             else
             {
@@ -1951,15 +2742,15 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
                 std::unique_ptr<ScratchImage> timage(new (std::nothrow) ScratchImage);
                 if (!timage)
                 {
-                    wprintf(L"\nERROR: Memory allocation failed\n");
-                    return 1;
+                    log.Print(L"\nERROR: Memory allocation failed\n");
+                    return CONVERT_FATAL;
                 }
 
                 hr = PremultiplyAlpha(img, nimg, info, TEX_PMALPHA_REVERSE | dwSRGB, *timage);
                 if (FAILED(hr))
                 {
-                    wprintf(L" FAILED [demultiply alpha] (%x)\n", hr);
-                    continue;
+                    log.Print(L" FAILED [demultiply alpha] (%x)\n", hr);
+                    return CONVERT_SKIPPED;
                 }
 
                 auto& tinfo = timage->GetMetadata();
@@ -1984,8 +2775,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             std::unique_ptr<ScratchImage> timage(new (std::nothrow) ScratchImage);
             if (!timage)
             {
-                wprintf(L"\nERROR: Memory allocation failed\n");
-                return 1;
+                log.Print(L"\nERROR: Memory allocation failed\n");
+                return CONVERT_FATAL;
             }
 
             DWORD dwFlags = 0;
@@ -2001,8 +2792,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             hr = FlipRotate(image->GetImages(), image->GetImageCount(), image->GetMetadata(), dwFlags, *timage);
             if (FAILED(hr))
             {
-                wprintf(L" FAILED [fliprotate] (%x)\n", hr);
-                return 1;
+                log.Print(L" FAILED [fliprotate] (%x)\n", hr);
+                return CONVERT_FATAL;
             }
 
             auto& tinfo = timage->GetMetadata();
@@ -2029,15 +2820,15 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             std::unique_ptr<ScratchImage> timage(new (std::nothrow) ScratchImage);
             if (!timage)
             {
-                wprintf(L"\nERROR: Memory allocation failed\n");
-                return 1;
+                log.Print(L"\nERROR: Memory allocation failed\n");
+                return CONVERT_FATAL;
             }
 
             hr = Resize(image->GetImages(), image->GetImageCount(), image->GetMetadata(), twidth, theight, dwFilter | dwFilterOpts, *timage);
             if (FAILED(hr))
             {
-                wprintf(L" FAILED [resize] (%x)\n", hr);
-                return 1;
+                log.Print(L" FAILED [resize] (%x)\n", hr);
+                return CONVERT_FATAL;
             }
 
             auto& tinfo = timage->GetMetadata();
@@ -2065,16 +2856,16 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
                 std::unique_ptr<ScratchImage> timage(new (std::nothrow) ScratchImage);
                 if (!timage)
                 {
-                    wprintf(L"\nERROR: Memory allocation failed\n");
-                    return 1;
+                    log.Print(L"\nERROR: Memory allocation failed\n");
+                    return CONVERT_FATAL;
                 }
 
                 hr = Convert(image->GetImages(), image->GetImageCount(), image->GetMetadata(), DXGI_FORMAT_R16G16B16A16_FLOAT,
                              dwFilter | dwFilterOpts | dwSRGB | dwConvert, TEX_THRESHOLD_DEFAULT, *timage);
                 if (FAILED(hr))
                 {
-                    wprintf(L" FAILED [convert] (%x)\n", hr);
-                    return 1;
+                    log.Print(L" FAILED [convert] (%x)\n", hr);
+                    return CONVERT_FATAL;
                 }
 
                 auto& tinfo = timage->GetMetadata();
@@ -2098,8 +2889,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             std::unique_ptr<ScratchImage> timage(new (std::nothrow) ScratchImage);
             if (!timage)
             {
-                wprintf(L"\nERROR: Memory allocation failed\n");
-                return 1;
+                log.Print(L"\nERROR: Memory allocation failed\n");
+                return CONVERT_FATAL;
             }
 
             switch (dwRotateColor)
@@ -2266,8 +3057,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             }
             if (FAILED(hr))
             {
-                wprintf(L" FAILED [rotate color apply] (%x)\n", hr);
-                return 1;
+                log.Print(L" FAILED [rotate color apply] (%x)\n", hr);
+                return CONVERT_FATAL;
             }
 
             auto& tinfo = timage->GetMetadata();
@@ -2292,8 +3083,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             std::unique_ptr<ScratchImage> timage(new (std::nothrow) ScratchImage);
             if (!timage)
             {
-                wprintf(L"\nERROR: Memory allocation failed\n");
-                return 1;
+                log.Print(L"\nERROR: Memory allocation failed\n");
+                return CONVERT_FATAL;
             }
 
             // Compute max luminosity across all images
@@ -2316,8 +3107,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             });
             if (FAILED(hr))
             {
-                wprintf(L" FAILED [tonemap maxlum] (%x)\n", hr);
-                return 1;
+                log.Print(L" FAILED [tonemap maxlum] (%x)\n", hr);
+                return CONVERT_FATAL;
             }
 
             // Reinhard et al, "Photographic Tone Reproduction for Digital Images" 
@@ -2345,8 +3136,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             }, *timage);
             if (FAILED(hr))
             {
-                wprintf(L" FAILED [tonemap apply] (%x)\n", hr);
-                return 1;
+                log.Print(L" FAILED [tonemap apply] (%x)\n", hr);
+                return CONVERT_FATAL;
             }
 
             auto& tinfo = timage->GetMetadata();
@@ -2371,8 +3162,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             std::unique_ptr<ScratchImage> timage(new (std::nothrow) ScratchImage);
             if (!timage)
             {
-                wprintf(L"\nERROR: Memory allocation failed\n");
-                return 1;
+                log.Print(L"\nERROR: Memory allocation failed\n");
+                return CONVERT_FATAL;
             }
 
             DXGI_FORMAT nmfmt = tformat;
@@ -2384,8 +3175,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             hr = ComputeNormalMap(image->GetImages(), image->GetImageCount(), image->GetMetadata(), dwNormalMap, nmapAmplitude, nmfmt, *timage);
             if (FAILED(hr))
             {
-                wprintf(L" FAILED [normalmap] (%x)\n", hr);
-                return 1;
+                log.Print(L" FAILED [normalmap] (%x)\n", hr);
+                return CONVERT_FATAL;
             }
 
             auto& tinfo = timage->GetMetadata();
@@ -2409,16 +3200,16 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             std::unique_ptr<ScratchImage> timage(new (std::nothrow) ScratchImage);
             if (!timage)
             {
-                wprintf(L"\nERROR: Memory allocation failed\n");
-                return 1;
+                log.Print(L"\nERROR: Memory allocation failed\n");
+                return CONVERT_FATAL;
             }
 
             hr = Convert(image->GetImages(), image->GetImageCount(), image->GetMetadata(), tformat,
                 dwFilter | dwFilterOpts | dwSRGB | dwConvert, TEX_THRESHOLD_DEFAULT, *timage);
             if (FAILED(hr))
             {
-                wprintf(L" FAILED [convert] (%x)\n", hr);
-                return 1;
+                log.Print(L" FAILED [convert] (%x)\n", hr);
+                return CONVERT_FATAL;
             }
 
             auto& tinfo = timage->GetMetadata();
@@ -2445,8 +3236,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             std::unique_ptr<ScratchImage> timage(new (std::nothrow) ScratchImage);
             if (!timage)
             {
-                wprintf(L"\nERROR: Memory allocation failed\n");
-                return 1;
+                log.Print(L"\nERROR: Memory allocation failed\n");
+                return CONVERT_FATAL;
             }
 
             XMVECTOR colorKeyValue = XMLoadColor(reinterpret_cast<const XMCOLOR*>(&colorKey));
@@ -2476,8 +3267,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             }, *timage);
             if (FAILED(hr))
             {
-                wprintf(L" FAILED [colorkey] (%x)\n", hr);
-                return 1;
+                log.Print(L" FAILED [colorkey] (%x)\n", hr);
+                return CONVERT_FATAL;
             }
 
             auto& tinfo = timage->GetMetadata();
@@ -2502,8 +3293,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             std::unique_ptr<ScratchImage> timage(new (std::nothrow) ScratchImage);
             if (!timage)
             {
-                wprintf(L"\nERROR: Memory allocation failed\n");
-                return 1;
+                log.Print(L"\nERROR: Memory allocation failed\n");
+                return CONVERT_FATAL;
             }
 
             hr = TransformImage(image->GetImages(), image->GetImageCount(), image->GetMetadata(),
@@ -2524,8 +3315,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             }, *timage);
             if (FAILED(hr))
             {
-                wprintf(L" FAILED [inverty] (%x)\n", hr);
-                return 1;
+                log.Print(L" FAILED [inverty] (%x)\n", hr);
+                return CONVERT_FATAL;
             }
 
             auto& tinfo = timage->GetMetadata();
@@ -2545,6 +3336,7 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
         }
 
         // --- Determine whether preserve alpha coverage is required (if requested) ----
+        bool preserveAlphaCoverage = false;
         if (preserveAlphaCoverageRef > 0.0f && HasAlpha(info.format) && !image->IsAlphaAllOpaque())
         {
             preserveAlphaCoverage = true;
@@ -2574,8 +3366,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             std::unique_ptr<ScratchImage> timage(new (std::nothrow) ScratchImage);
             if (!timage)
             {
-                wprintf(L"\nERROR: Memory allocation failed\n");
-                return 1;
+                log.Print(L"\nERROR: Memory allocation failed\n");
+                return CONVERT_FATAL;
             }
 
             TexMetadata mdata = info;
@@ -2583,8 +3375,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             hr = timage->Initialize(mdata);
             if (FAILED(hr))
             {
-                wprintf(L" FAILED [copy to single level] (%x)\n", hr);
-                return 1;
+                log.Print(L" FAILED [copy to single level] (%x)\n", hr);
+                return CONVERT_FATAL;
             }
 
             if (info.dimension == TEX_DIMENSION_TEXTURE3D)
@@ -2595,8 +3387,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
                         *timage->GetImage(0, 0, d), TEX_FILTER_DEFAULT, 0, 0);
                     if (FAILED(hr))
                     {
-                        wprintf(L" FAILED [copy to single level] (%x)\n", hr);
-                        return 1;
+                        log.Print(L" FAILED [copy to single level] (%x)\n", hr);
+                        return CONVERT_FATAL;
                     }
                 }
             }
@@ -2608,8 +3400,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
                         *timage->GetImage(0, i, 0), TEX_FILTER_DEFAULT, 0, 0);
                     if (FAILED(hr))
                     {
-                        wprintf(L" FAILED [copy to single level] (%x)\n", hr);
-                        return 1;
+                        log.Print(L" FAILED [copy to single level] (%x)\n", hr);
+                        return CONVERT_FATAL;
                     }
                 }
             }
@@ -2625,8 +3417,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
                 hr = timage->Initialize(mdata);
                 if (FAILED(hr))
                 {
-                    wprintf(L" FAILED [copy compressed to single level] (%x)\n", hr);
-                    return 1;
+                    log.Print(L" FAILED [copy compressed to single level] (%x)\n", hr);
+                    return CONVERT_FATAL;
                 }
 
                 if (mdata.dimension == TEX_DIMENSION_TEXTURE3D)
@@ -2663,8 +3455,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             std::unique_ptr<ScratchImage> timage(new (std::nothrow) ScratchImage);
             if (!timage)
             {
-                wprintf(L"\nERROR: Memory allocation failed\n");
-                return 1;
+                log.Print(L"\nERROR: Memory allocation failed\n");
+                return CONVERT_FATAL;
             }
 
             if (info.dimension == TEX_DIMENSION_TEXTURE3D)
@@ -2677,8 +3469,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             }
             if (FAILED(hr))
             {
-                wprintf(L" FAILED [mipmaps] (%x)\n", hr);
-                return 1;
+                log.Print(L" FAILED [mipmaps] (%x)\n", hr);
+                return CONVERT_FATAL;
             }
 
             auto& tinfo = timage->GetMetadata();
@@ -2702,15 +3494,15 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             std::unique_ptr<ScratchImage> timage(new (std::nothrow) ScratchImage);
             if (!timage)
             {
-                wprintf(L"\nERROR: Memory allocation failed\n");
-                return 1;
+                log.Print(L"\nERROR: Memory allocation failed\n");
+                return CONVERT_FATAL;
             }
 
             hr = timage->Initialize(image->GetMetadata());
             if (FAILED(hr))
             {
-                wprintf(L" FAILED [keepcoverage] (%x)\n", hr);
-                return 1;
+                log.Print(L" FAILED [keepcoverage] (%x)\n", hr);
+                return CONVERT_FATAL;
             }
             
             const size_t items = image->GetMetadata().arraySize;
@@ -2722,8 +3514,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
                 hr = ScaleMipMapsAlphaForCoverage(img, info.mipLevels, info, item, preserveAlphaCoverageRef, *timage);
                 if (FAILED(hr))
                 {
-                    wprintf(L" FAILED [keepcoverage] (%x)\n", hr);
-                    return 1;
+                    log.Print(L" FAILED [keepcoverage] (%x)\n", hr);
+                    return CONVERT_FATAL;
                 }
             }
 
@@ -2749,7 +3541,7 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
         {
             if (info.IsPMAlpha())
             {
-                printf("\nWARNING: Image is already using premultiplied alpha\n");
+                log.Print(L"\nWARNING: Image is already using premultiplied alpha\n");
             }
             else
             {
@@ -2760,15 +3552,15 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
                 std::unique_ptr<ScratchImage> timage(new (std::nothrow) ScratchImage);
                 if (!timage)
                 {
-                    wprintf(L"\nERROR: Memory allocation failed\n");
-                    return 1;
+                    log.Print(L"\nERROR: Memory allocation failed\n");
+                    return CONVERT_FATAL;
                 }
 
                 hr = PremultiplyAlpha(img, nimg, info, dwSRGB, *timage);
                 if (FAILED(hr))
                 {
-                    wprintf(L" FAILED [premultiply alpha] (%x)\n", hr);
-                    continue;
+                    log.Print(L" FAILED [premultiply alpha] (%x)\n", hr);
+                    return CONVERT_SKIPPED;
                 }
 
                 auto& tinfo = timage->GetMetadata();
@@ -2787,6 +3579,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             }
         }
 
+        timer.End(STAGE_PROCESS);
+
         // --- Compress ----------------------------------------------------------------
         if (IsCompressed(tformat) && (FileType == CODEC_DDS))
         {
@@ -2822,8 +3616,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
                 std::unique_ptr<ScratchImage> timage(new (std::nothrow) ScratchImage);
                 if (!timage)
                 {
-                    wprintf(L"\nERROR: Memory allocation failed\n");
-                    return 1;
+                    log.Print(L"\nERROR: Memory allocation failed\n");
+                    return CONVERT_FATAL;
                 }
 
                 bool bc6hbc7 = false;
@@ -2838,22 +3632,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
                     bc6hbc7 = true;
 
                     {
-                        static bool s_tryonce = false;
-
-                        if (!s_tryonce)
-                        {
-                            s_tryonce = true;
-
-                            if (!(dwOptions & (DWORD64(1) << OPT_NOGPU)))
-                            {
-                                if (!CreateDevice(adapter, pDevice.GetAddressOf()))
-                                    wprintf(L"\nWARNING: DirectCompute is not available, using BC6H / BC7 CPU codec\n");
-                            }
-                            else
-                            {
-                                wprintf(L"\nWARNING: using BC6H / BC7 CPU codec\n");
-                            }
-                        }
+                        std::lock_guard<std::mutex> lock(gpuMutex);
+                        initDevice(log);
                     }
                     break;
                 }
@@ -2873,16 +3653,23 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
 
                 if (bc6hbc7 && pDevice)
                 {
+                    // The immediate context of the device is not free threaded
+                    std::lock_guard<std::mutex> lock(gpuMutex);
                     hr = Compress(pDevice.Get(), img, nimg, info, tformat, dwCompress | dwSRGB, alphaWeight, *timage);
                 }
+                else if (jobs > 1)
+                {
+                    // Concurrent files share the hardware threads rather than each starting an OpenMP team
+                    hr = Compress(img, nimg, info, tformat, dwCompress | dwSRGB, TEX_THRESHOLD_DEFAULT, compressOptions, *timage);
+                }
                 else
                 {
                     hr = Compress(img, nimg, info, tformat, cflags | dwSRGB, TEX_THRESHOLD_DEFAULT, *timage);
                 }
                 if (FAILED(hr))
                 {
-                    wprintf(L" FAILED [compress] (%x)\n", hr);
-                    continue;
+                    log.Print(L" FAILED [compress] (%x)\n", hr);
+                    return CONVERT_SKIPPED;
                 }
 
                 auto& tinfo = timage->GetMetadata();
@@ -2904,6 +3691,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             cimage.reset();
         }
 
+        timer.End(STAGE_COMPRESS);
+
         // --- Set alpha mode ----------------------------------------------------------
         if (HasAlpha(info.format)
             && info.format != DXGI_FORMAT_A8_UNORM)
@@ -2936,60 +3725,45 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             assert(img);
             size_t nimg = image->GetImageCount();
 
-            PrintInfo(info);
-            wprintf(L"\n");
-
-            // Figure out dest filename
-            wchar_t *pchSlash, *pchDot;
-
-            wcscpy_s(pConv->szDest, MAX_PATH, szPrefix);
-
-            pchSlash = wcsrchr(pConv->szSrc, L'\\');
-            if (pchSlash != 0)
-                wcscat_s(pConv->szDest, MAX_PATH, pchSlash + 1);
-            else
-                wcscat_s(pConv->szDest, MAX_PATH, pConv->szSrc);
-
-            pchSlash = wcsrchr(pConv->szDest, '\\');
-            pchDot = wcsrchr(pConv->szDest, '.');
-
-            if (pchDot > pchSlash)
-                *pchDot = 0;
-
-            wcscat_s(pConv->szDest, MAX_PATH, szSuffix);
+            PrintInfo(info, log);
+            log.Print(L"\n");
 
             // Write texture
-            wprintf(L"writing %ls", pConv->szDest);
-            fflush(stdout);
+            log.Print(L"writing %ls", conv.szDest);
+            log.Flush();
 
             if (~dwOptions & (DWORD64(1) << OPT_OVERWRITE))
             {
-                if (GetFileAttributesW(pConv->szDest) != INVALID_FILE_ATTRIBUTES)
+                if (GetFileAttributesW(conv.szDest) != INVALID_FILE_ATTRIBUTES)
                 {
-                    wprintf(L"\nERROR: Output file already exists, use -y to overwrite:\n");
-                    continue;
+                    log.Print(L"\nERROR: Output file already exists, use -y to overwrite:\n");
+                    return CONVERT_SKIPPED;
                 }
             }
 
+            // An earlier -cachelink run may have made the output a hard link to a cache entry, which
+            // writing over it would change for every other output linked to it
+            (void)DeleteFileW(conv.szDest);
+
             switch (FileType)
             {
             case CODEC_DDS:
                 hr = SaveToDDSFile(img, nimg, info,
                     (dwOptions & (DWORD64(1) << OPT_USE_DX10)) ? (DDS_FLAGS_FORCE_DX10_EXT | DDS_FLAGS_FORCE_DX10_EXT_MISC2) : DDS_FLAGS_NONE,
-                    pConv->szDest);
+                    conv.szDest);
                 break;
 
             case CODEC_TGA:
-                hr = SaveToTGAFile(img[0], pConv->szDest);
+                hr = SaveToTGAFile(img[0], conv.szDest);
                 break;
 
             case CODEC_HDR:
-                hr = SaveToHDRFile(img[0], pConv->szDest);
+                hr = SaveToHDRFile(img[0], conv.szDest);
                 break;
 
 #ifdef USE_OPENEXR
             case CODEC_EXR:
-                hr = SaveToEXRFile(img[0], pConv->szDest);
+                hr = SaveToEXRFile(img[0], conv.szDest);
                 break;
 #endif
 
@@ -2997,7 +3771,7 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             {
                 WICCodecs codec = (FileType == CODEC_HDP || FileType == CODEC_JXR) ? WIC_CODEC_WMP : static_cast<WICCodecs>(FileType);
                 size_t nimages = (dwOptions & (DWORD64(1) << OPT_WIC_MULTIFRAME)) ? nimg : 1;
-                hr = SaveToWICFile(img, nimages, WIC_FLAGS_NONE, GetWICCodec(codec), pConv->szDest, nullptr,
+                hr = SaveToWICFile(img, nimages, WIC_FLAGS_NONE, GetWICCodec(codec), conv.szDest, nullptr,
                     [&](IPropertyBag2* props)
                 {
                     bool wicLossless = (dwOptions & (DWORD64(1) << OPT_WIC_LOSSLESS)) != 0;
@@ -3065,10 +3839,138 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
 
             if (FAILED(hr))
             {
-                wprintf(L" FAILED (%x)\n", hr);
-                continue;
+                log.Print(L" FAILED (%x)\n", hr);
+                return CONVERT_SKIPPED;
+            }
+            log.Print(L"\n");
+
+            if (cache)
+            {
+                cache->Store(conv.szDest, cacheEntry);
             }
-            wprintf(L"\n");
+        }
+
+        timer.End(STAGE_SAVE);
+
+        return CONVERT_OK;
+    };
+
+    if (jobs > 1)
+    {
+        // Each worker takes the next file through load, process, compress and save, so the file I/O of
+        // some files overlaps the codecs of others. A worker does not start a file until its estimated
+        // working set fits the memory cap. The output of each file is printed in command line order.
+        struct FileJob
+        {
+            ConsoleLog log;
+            LONGLONG stageTime[STAGE_MAX];
+            bool done;
+
+            FileJob() : log(true), stageTime{}, done(false) {}
+        };
+
+        std::vector<SConversion*> files;
+        for (auto& conv : conversion)
+            files.push_back(&conv);
+
+        std::unique_ptr<FileJob[]> fileJobs(new (std::nothrow) FileJob[files.size()]);
+        if (!fileJobs)
+        {
+            wprintf(L"\nERROR: Memory allocation failed\n");
+            return 1;
+        }
+
+        if (!memoryLimit)
+        {
+            MEMORYSTATUSEX status = {};
+            status.dwLength = sizeof(status);
+            memoryLimit = GlobalMemoryStatusEx(&status) ? (status.ullTotalPhys / 2) : UINT64_MAX;
+        }
+
+        MemoryBudget budget(memoryLimit);
+        std::atomic<size_t> nextFile(0);
+        std::atomic<bool> cancel(false);
+        std::mutex doneMutex;
+        std::condition_variable doneCondition;
+
+        auto worker = [&]()
+        {
+            HRESULT hrCOM = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+
+            for (;;)
+            {
+                size_t index = nextFile++;
+                if (index >= files.size())
+                    break;
+
+                FileJob& job = fileJobs[index];
+                if (!cancel)
+                {
+                    uint64_t bytes = EstimateWorkingSet(files[index]->szSrc, width, height);
+                    budget.Acquire(bytes);
+
+                    StageTimer timer(job.stageTime);
+                    if (convertFile(*files[index], job.log, timer) == CONVERT_FATAL)
+                        cancel = true;
+
+                    budget.Release(bytes);
+                }
+
+                {
+                    std::lock_guard<std::mutex> lock(doneMutex);
+                    job.done = true;
+                }
+                doneCondition.notify_one();
+            }
+
+            if (SUCCEEDED(hrCOM))
+                CoUninitialize();
+        };
+
+        std::vector<std::thread> threads;
+        for (size_t j = 0; j < std::min(jobs, files.size()); ++j)
+            threads.emplace_back(worker);
+
+        bool first = true;
+        for (size_t index = 0; index < files.size(); ++index)
+        {
+            FileJob& job = fileJobs[index];
+            {
+                std::unique_lock<std::mutex> lock(doneMutex);
+                doneCondition.wait(lock, [&]() { return job.done; });
+            }
+
+            // Files skipped after a fatal error have no output
+            if (!job.log.IsEmpty())
+            {
+                if (!first)
+                    wprintf(L"\n");
+                first = false;
+
+                job.log.Write();
+            }
+
+            for (size_t stage = 0; stage < STAGE_MAX; ++stage)
+                stageTime[stage] += job.stageTime[stage];
+        }
+
+        for (auto& thread : threads)
+            thread.join();
+
+        if (cancel)
+            return 1;
+    }
+    else
+    {
+        for (auto pConv = conversion.begin(); pConv != conversion.end(); ++pConv)
+        {
+            if (pConv != conversion.begin())
+                wprintf(L"\n");
+
+            ConsoleLog log;
+            StageTimer timer(stageTime);
+            if (convertFile(*pConv, log, timer) == CONVERT_FATAL)
+                return 1;
         }
     }
 
@@ -3081,6 +3983,16 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
     if (non4bc)
         wprintf(L"\nWARNING: Direct3D requires BC image to be multiple of 4 in width & height\n");
 
+    if (cache)
+    {
+        size_t evicted;
+        uint64_t cacheBytes;
+        cache->Trim(cacheLimit, evicted, cacheBytes);
+
+        wprintf(L"\nCache: %zu hits, %zu misses, %zu stored, %zu evicted (%.1f MB in %ls)\n",
+            cache->GetHits(), cache->GetMisses(), cache->GetStored(), evicted, double(cacheBytes) / (1024.0 * 1024.0), szCacheDir);
+    }
+
     if (dwOptions & (DWORD64(1) << OPT_TIMING))
     {
         LARGE_INTEGER qpcEnd;
@@ -3088,6 +4000,15 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
         {
             LONGLONG delta = qpcEnd.QuadPart - qpcStart.QuadPart;
             wprintf(L"\n Processing time: %f seconds\n", double(delta) / double(qpcFreq.QuadPart));
+            if (jobs > 1)
+                wprintf(L" Concurrent files: %zu\n", jobs);
+
+            // With -j the stages of concurrent files overlap, so these add up to more than the processing time
+            wprintf(L" Stage times summed over files: load %f, process %f, compress %f, save %f seconds\n",
+                double(stageTime[STAGE_LOAD]) / double(qpcFreq.QuadPart),
+                double(stageTime[STAGE_PROCESS]) / double(qpcFreq.QuadPart),
+                double(stageTime[STAGE_COMPRESS]) / double(qpcFreq.QuadPart),
+                double(stageTime[STAGE_SAVE]) / double(qpcFreq.QuadPart));
         }
     }
 
@@ -28,12 +28,15 @@
 #include <fstream>
 #include <memory>
 #include <list>
+#include <thread>
 #include <vector>
 
 #include <dxgiformat.h>
 
 #include "DirectXTex.h"
 
+#include <DirectXPackedVector.h>
+
 //Uncomment to add support for OpenEXR (.exr)
 //#define USE_OPENEXR
 
@@ -52,6 +55,13 @@ enum COMMANDS
     CMD_DIFF,
     CMD_DUMPBC,
     CMD_DUMPDDS,
+    CMD_BCBENCH,
+    CMD_PARBENCH,
+    CMD_MIPBENCH,
+    CMD_CONVBENCH,
+    CMD_MAPBENCH,
+    CMD_DECBENCH,
+    CMD_RESIZEBENCH,
     CMD_MAX
 };
 
@@ -72,6 +82,8 @@ enum OPTIONS
     OPT_TARGET_PIXELX,
     OPT_TARGET_PIXELY,
     OPT_FILELIST,
+    OPT_MIN_PSNR,
+    OPT_MIN_SSIM,
     OPT_MAX
 };
 
@@ -100,6 +112,13 @@ const SValue g_pCommands[] =
     { L"diff",      CMD_DIFF },
     { L"dumpbc",    CMD_DUMPBC },
     { L"dumpdds",   CMD_DUMPDDS },
+    { L"bcbench",   CMD_BCBENCH },
+    { L"parbench",  CMD_PARBENCH },
+    { L"mipbench",  CMD_MIPBENCH },
+    { L"convbench", CMD_CONVBENCH },
+    { L"mapbench",  CMD_MAPBENCH },
+    { L"decbench",  CMD_DECBENCH },
+    { L"resizebench", CMD_RESIZEBENCH },
     { nullptr,      0 }
 };
 
@@ -120,6 +139,8 @@ const SValue g_pOptions[] =
     { L"targetx",   OPT_TARGET_PIXELX },
     { L"targety",   OPT_TARGET_PIXELY },
     { L"flist",     OPT_FILELIST },
+    { L"minpsnr",   OPT_MIN_PSNR },
+    { L"minssim",   OPT_MIN_SSIM },
     { nullptr,      0 }
 };
 
@@ -529,10 +550,17 @@ namespace
         wprintf(L"Usage: texdiag <command> <options> <files>\n\n");
         wprintf(L"   info                Output image metadata\n");
         wprintf(L"   analyze             Analyze and summarize image information\n");
-        wprintf(L"   compare             Compare two images with MSE error metric\n");
+        wprintf(L"   compare             Compare two images with MSE, PSNR & SSIM error metrics\n");
         wprintf(L"   diff                Generate difference image from two images\n");
         wprintf(L"   dumpbc              Dump out compressed blocks (DDS BC only)\n");
-        wprintf(L"   dumpdds             Dump out all the images in a complex DDS\n\n");
+        wprintf(L"   dumpdds             Dump out all the images in a complex DDS\n");
+        wprintf(L"   bcbench             Compare speed and MSE of the BC1, BC3 & BC7 encoders\n");
+        wprintf(L"   parbench            Measure thread scaling of mip generation, compression & decompression\n");
+        wprintf(L"   mipbench            Compare per-level and fused box filter mip generation\n");
+        wprintf(L"   convbench           Check and time the direct format conversions against the float path\n");
+        wprintf(L"   mapbench            Time reading one mip of a DDS texture array loaded and memory mapped\n");
+        wprintf(L"   decbench            Measure BC1 - BC5 decompression throughput\n");
+        wprintf(L"   resizebench         Compare speed and PSNR of the resize filters and the separable resampler\n\n");
         wprintf(L"   -r                  wildcard filename search is recursive\n");
         wprintf(L"   -if <filter>        image filtering\n");
         wprintf(L"\n                       (DDS input only)\n");
@@ -540,10 +568,14 @@ namespace
         wprintf(L"   -dword              Use DWORD instead of BYTE alignment\n");
         wprintf(L"   -badtails           Fix for older DXTn with bad mipchain tails\n");
         wprintf(L"   -xlum               expand legacy L8, L16, and A8P8 formats\n");
+        wprintf(L"\n                       (compare & diff)\n");
+        wprintf(L"   -o <filename>       output filename (compare writes a heatmap of the largest error)\n");
+        wprintf(L"   -y                  overwrite existing output file (if any)\n");
+        wprintf(L"\n                       (compare only)\n");
+        wprintf(L"   -minpsnr <dB>       fail if the PSNR of any image is lower\n");
+        wprintf(L"   -minssim <value>    fail if the SSIM of any image is lower\n");
         wprintf(L"\n                       (diff only)\n");
         wprintf(L"   -f <format>         format\n");
-        wprintf(L"   -o <filename>       output filename\n");
-        wprintf(L"   -y                  overwrite existing output file (if any)\n");
         wprintf(L"\n                       (dumpbc only)\n");
         wprintf(L"   -targetx <num>      dump pixels at location x (defaults to all)\n");
         wprintf(L"   -targety <num>      dump pixels at location y (defaults to all)\n");
@@ -660,6 +692,38 @@ namespace
         }
     }
 
+    //--------------------------------------------------------------------------------------
+    HRESULT ColorizeHeatmap(const Image& heatmap, float maxError, ScratchImage& result)
+    {
+        HRESULT hr = result.Initialize2D(DXGI_FORMAT_R8G8B8A8_UNORM, heatmap.width, heatmap.height, 1, 1);
+        if (FAILED(hr))
+            return hr;
+
+        auto level = [](float v) -> uint8_t
+        {
+            return (v > 0.f) ? static_cast<uint8_t>(std::min(v, 1.f) * 255.f + 0.5f) : 0;
+        };
+
+        // Black through red and yellow to white at the largest error
+        const float scale = (maxError > 0.f) ? 3.f / maxError : 0.f;
+        const Image* dest = result.GetImage(0, 0, 0);
+        for (size_t y = 0; y < heatmap.height; ++y)
+        {
+            auto src = reinterpret_cast<const float*>(heatmap.pixels + y * heatmap.rowPitch);
+            uint8_t* pixel = dest->pixels + y * dest->rowPitch;
+            for (size_t x = 0; x < heatmap.width; ++x, pixel += 4)
+            {
+                float t = src[x] * scale;
+                pixel[0] = level(t);
+                pixel[1] = level(t - 1.f);
+                pixel[2] = level(t - 2.f);
+                pixel[3] = 255;
+            }
+        }
+
+        return S_OK;
+    }
+
     //--------------------------------------------------------------------------------------
     struct AnalyzeData
     {
@@ -3002,6 +3066,558 @@ namespace
 
         return S_OK;
     }
+
+
+    //--------------------------------------------------------------------------------------
+    struct BenchmarkData
+    {
+        size_t pixels;
+        double seconds;
+        double mse;         // MSE weighted by the pixel count, so results of several images add up
+        double mseV[4];
+
+        void Add(const BenchmarkData& other)
+        {
+            pixels += other.pixels;
+            seconds += other.seconds;
+            mse += other.mse;
+            for (size_t j = 0; j < 4; ++j)
+                mseV[j] += other.mseV[j];
+        }
+
+        void Print(const wchar_t* name) const
+        {
+            double scale = (pixels > 0) ? 1.0 / double(pixels) : 0.0;
+            wprintf(L"\t%-14ls %8.2f MPixel/s %10.0f blocks/s  MSE %f (%f %f %f %f) PSNR %f dB\n", name,
+                (seconds > 0) ? double(pixels) / (seconds * 1000000.0) : 0.0,
+                (seconds > 0) ? double(pixels) / (seconds * 16.0) : 0.0,
+                mse * scale, mseV[0] * scale, mseV[1] * scale, mseV[2] * scale, mseV[3] * scale,
+                10.0 * log10(3.0 / ((mseV[0] + mseV[1] + mseV[2]) * scale)));
+        }
+    };
+
+    const struct
+    {
+        const wchar_t* name;
+        DXGI_FORMAT format;
+        DWORD compress;
+    } g_BenchmarkEncoders[] =
+    {
+        { L"BC1",          DXGI_FORMAT_BC1_UNORM,   TEX_COMPRESS_DEFAULT },
+        { L"BC1 SIMD",     DXGI_FORMAT_BC1_UNORM,   TEX_COMPRESS_SIMD },
+        { L"BC3",          DXGI_FORMAT_BC3_UNORM,   TEX_COMPRESS_DEFAULT },
+        { L"BC3 SIMD",     DXGI_FORMAT_BC3_UNORM,   TEX_COMPRESS_SIMD },
+        { L"BC7",          DXGI_FORMAT_BC7_UNORM,   TEX_COMPRESS_DEFAULT },
+        { L"BC7 fast",     DXGI_FORMAT_BC7_UNORM,   TEX_COMPRESS_BC7_FAST },
+        { L"BC7 faster",   DXGI_FORMAT_BC7_UNORM,   TEX_COMPRESS_BC7_FASTER },
+        { L"BC7 fastest",  DXGI_FORMAT_BC7_UNORM,   TEX_COMPRESS_BC7_FASTEST },
+        { L"BC7 quick",    DXGI_FORMAT_BC7_UNORM,   TEX_COMPRESS_BC7_QUICK },
+    };
+
+    const size_t g_BenchmarkEncoderCount = sizeof(g_BenchmarkEncoders) / sizeof(g_BenchmarkEncoders[0]);
+
+    // Compresses on a single thread, so only the encoders are compared
+    HRESULT BenchmarkBC(const Image& image, DXGI_FORMAT format, DWORD compress, _Out_ BenchmarkData& result)
+    {
+        memset(&result, 0, sizeof(BenchmarkData));
+
+        if (IsSRGB(image.format))
+            format = MakeSRGB(format);
+
+        LARGE_INTEGER frequency, start, end;
+        QueryPerformanceFrequency(&frequency);
+        QueryPerformanceCounter(&start);
+
+        ScratchImage bcImage;
+        HRESULT hr = Compress(image, format, compress, TEX_THRESHOLD_DEFAULT, bcImage);
+        if (FAILED(hr))
+            return hr;
+
+        QueryPerformanceCounter(&end);
+
+        float mse, mseV[4];
+        hr = ComputeMSE(image, *bcImage.GetImage(0, 0, 0), mse, mseV);
+        if (FAILED(hr))
+            return hr;
+
+        result.pixels = image.width * image.height;
+        result.seconds = double(end.QuadPart - start.QuadPart) / double(frequency.QuadPart);
+        result.mse = double(mse) * double(result.pixels);
+        for (size_t j = 0; j < 4; ++j)
+            result.mseV[j] = double(mseV[j]) * double(result.pixels);
+
+        return S_OK;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    // Copies the top level of every array item into a new texture of the given format
+    HRESULT GetBaseImages(const ScratchImage& image, DXGI_FORMAT format, ScratchImage& result)
+    {
+        const TexMetadata& info = image.GetMetadata();
+        HRESULT hr = result.Initialize2D(format, info.width, info.height, info.arraySize, 1);
+        for (size_t item = 0; SUCCEEDED(hr) && item < info.arraySize; ++item)
+        {
+            const Image* img = image.GetImage(0, item, 0);
+            assert(img);
+
+            ScratchImage temp;
+            if (IsCompressed(img->format))
+                hr = Decompress(*img, format, temp);
+            else if (img->format != format)
+                hr = Convert(*img, format, TEX_FILTER_DEFAULT, TEX_THRESHOLD_DEFAULT, temp);
+
+            if (SUCCEEDED(hr))
+                hr = CopyRectangle(temp.GetImages() ? *temp.GetImage(0, 0, 0) : *img, Rect(0, 0, info.width, info.height),
+                    *result.GetImage(0, item, 0), TEX_FILTER_DEFAULT, 0, 0);
+        }
+
+        return hr;
+    }
+
+    // Times the per-level box filter against the fused one and returns the lowest PSNR of any
+    // level of the fused chain against the per-level chain
+    HRESULT BenchmarkMips(const ScratchImage& image, size_t threadCount, _Out_ double& seconds, _Out_ double& minPSNR,
+        _In_opt_ const ScratchImage* reference, _Out_opt_ ScratchImage* result)
+    {
+        seconds = 0;
+        minPSNR = 0;
+
+        LARGE_INTEGER frequency, start, end;
+        QueryPerformanceFrequency(&frequency);
+
+        ScratchImage mipChain;
+        HRESULT hr;
+        QueryPerformanceCounter(&start);
+        if (!threadCount)
+        {
+            hr = GenerateMipMaps(image.GetImages(), image.GetImageCount(), image.GetMetadata(),
+                TEX_FILTER_BOX | TEX_FILTER_FORCE_NON_WIC, 0, mipChain);
+        }
+        else
+        {
+            ParallelOptions options;
+            options.threadCount = threadCount;
+            hr = GenerateMipMaps(image.GetImages(), image.GetImageCount(), image.GetMetadata(),
+                TEX_FILTER_BOX, 0, options, mipChain);
+        }
+        if (FAILED(hr))
+            return hr;
+        QueryPerformanceCounter(&end);
+        seconds = double(end.QuadPart - start.QuadPart) / double(frequency.QuadPart);
+
+        if (reference)
+        {
+            minPSNR = 1000.0;
+            for (size_t index = 0; index < mipChain.GetImageCount(); ++index)
+            {
+                float mse, mseV[4];
+                hr = ComputeMSE(mipChain.GetImages()[index], reference->GetImages()[index], mse, mseV);
+                if (FAILED(hr))
+                    return hr;
+
+                if (mse > 0)
+                    minPSNR = std::min(minPSNR, 10.0 * log10(3.0 / (double(mseV[0]) + double(mseV[1]) + double(mseV[2]))));
+            }
+        }
+
+        if (result)
+            *result = std::move(mipChain);
+
+        return S_OK;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    struct ParallelBenchmarkData
+    {
+        double seconds[4];  // GenerateMipMaps, Compress BC1, Compress BC7 fast, Decompress BC7
+    };
+
+    // Runs the whole image (all array items and mips) through the thread pool versions
+    HRESULT BenchmarkParallel(const ScratchImage& image, size_t threadCount, _Out_ ParallelBenchmarkData& result)
+    {
+        memset(&result, 0, sizeof(ParallelBenchmarkData));
+
+        ParallelOptions options;
+        options.threadCount = threadCount;
+
+        LARGE_INTEGER frequency, start, end;
+        QueryPerformanceFrequency(&frequency);
+
+        const TexMetadata& info = image.GetMetadata();
+        const DXGI_FORMAT formats[] = { DXGI_FORMAT_BC1_UNORM, DXGI_FORMAT_BC7_UNORM };
+        const DWORD compress[] = { TEX_COMPRESS_DEFAULT, TEX_COMPRESS_BC7_FAST };
+
+        ScratchImage mipChain;
+        QueryPerformanceCounter(&start);
+        HRESULT hr = GenerateMipMaps(image.GetImages(), image.GetImageCount(), info, TEX_FILTER_DEFAULT, 0, options, mipChain);
+        if (FAILED(hr))
+            return hr;
+        QueryPerformanceCounter(&end);
+        result.seconds[0] = double(end.QuadPart - start.QuadPart) / double(frequency.QuadPart);
+
+        ScratchImage bcImage;
+        for (size_t j = 0; j < 2; ++j)
+        {
+            DXGI_FORMAT format = IsSRGB(info.format) ? MakeSRGB(formats[j]) : formats[j];
+
+            QueryPerformanceCounter(&start);
+            hr = Compress(mipChain.GetImages(), mipChain.GetImageCount(), mipChain.GetMetadata(), format,
+                compress[j], TEX_THRESHOLD_DEFAULT, options, bcImage);
+            if (FAILED(hr))
+                return hr;
+            QueryPerformanceCounter(&end);
+            result.seconds[1 + j] = double(end.QuadPart - start.QuadPart) / double(frequency.QuadPart);
+        }
+
+        ScratchImage decompressed;
+        QueryPerformanceCounter(&start);
+        hr = Decompress(bcImage.GetImages(), bcImage.GetImageCount(), bcImage.GetMetadata(), info.format, options, decompressed);
+        if (FAILED(hr))
+            return hr;
+        QueryPerformanceCounter(&end);
+        result.seconds[3] = double(end.QuadPart - start.QuadPart) / double(frequency.QuadPart);
+
+        return S_OK;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    const struct
+    {
+        const wchar_t* name;
+        DXGI_FORMAT source;
+        DXGI_FORMAT dest;
+        DWORD filter;
+    } g_BenchmarkConversions[] =
+    {
+        { L"RGBA8 > RGBA8s",        DXGI_FORMAT_R8G8B8A8_UNORM,         DXGI_FORMAT_R8G8B8A8_UNORM_SRGB,    TEX_FILTER_SRGB_IN },
+        { L"RGBA8 > BGRA8",         DXGI_FORMAT_R8G8B8A8_UNORM,         DXGI_FORMAT_B8G8R8A8_UNORM,         TEX_FILTER_DEFAULT },
+        { L"RGBA8 > BGRX8",         DXGI_FORMAT_R8G8B8A8_UNORM,         DXGI_FORMAT_B8G8R8X8_UNORM,         TEX_FILTER_DEFAULT },
+        { L"RGBA8 > RGBA16",        DXGI_FORMAT_R8G8B8A8_UNORM,         DXGI_FORMAT_R16G16B16A16_UNORM,     TEX_FILTER_DEFAULT },
+        { L"BGRA8 > RGBA8",         DXGI_FORMAT_B8G8R8A8_UNORM,         DXGI_FORMAT_R8G8B8A8_UNORM,         TEX_FILTER_DEFAULT },
+        { L"BGRA8 > BGRA8s",        DXGI_FORMAT_B8G8R8A8_UNORM,         DXGI_FORMAT_B8G8R8A8_UNORM_SRGB,    TEX_FILTER_SRGB_IN },
+        { L"BGRA8 > BGRX8",         DXGI_FORMAT_B8G8R8A8_UNORM,         DXGI_FORMAT_B8G8R8X8_UNORM,         TEX_FILTER_DEFAULT },
+        { L"BGRA8 > RGBA16",        DXGI_FORMAT_B8G8R8A8_UNORM,         DXGI_FORMAT_R16G16B16A16_UNORM,     TEX_FILTER_DEFAULT },
+        { L"BGRX8 > RGBA8",         DXGI_FORMAT_B8G8R8X8_UNORM,         DXGI_FORMAT_R8G8B8A8_UNORM,         TEX_FILTER_DEFAULT },
+        { L"BGRX8 > BGRA8",         DXGI_FORMAT_B8G8R8X8_UNORM,         DXGI_FORMAT_B8G8R8A8_UNORM,         TEX_FILTER_DEFAULT },
+        { L"BGRX8 > BGRX8s",        DXGI_FORMAT_B8G8R8X8_UNORM,         DXGI_FORMAT_B8G8R8X8_UNORM_SRGB,    TEX_FILTER_SRGB_IN },
+        { L"BGRX8 > RGBA16",        DXGI_FORMAT_B8G8R8X8_UNORM,         DXGI_FORMAT_R16G16B16A16_UNORM,     TEX_FILTER_DEFAULT },
+        { L"RGBA16 > RGBA8",        DXGI_FORMAT_R16G16B16A16_UNORM,     DXGI_FORMAT_R8G8B8A8_UNORM,         TEX_FILTER_DEFAULT },
+        { L"RGBA16 > BGRA8",        DXGI_FORMAT_R16G16B16A16_UNORM,     DXGI_FORMAT_B8G8R8A8_UNORM,         TEX_FILTER_DEFAULT },
+        { L"RGBA16 > BGRX8",        DXGI_FORMAT_R16G16B16A16_UNORM,     DXGI_FORMAT_B8G8R8X8_UNORM,         TEX_FILTER_DEFAULT },
+        { L"RGBA8s > RGBA8",        DXGI_FORMAT_R8G8B8A8_UNORM_SRGB,    DXGI_FORMAT_R8G8B8A8_UNORM,         TEX_FILTER_SRGB_OUT },
+        { L"RGBA8s > BGRA8s",       DXGI_FORMAT_R8G8B8A8_UNORM_SRGB,    DXGI_FORMAT_B8G8R8A8_UNORM_SRGB,    TEX_FILTER_DEFAULT },
+        { L"RGBA8s > BGRX8s",       DXGI_FORMAT_R8G8B8A8_UNORM_SRGB,    DXGI_FORMAT_B8G8R8X8_UNORM_SRGB,    TEX_FILTER_DEFAULT },
+        { L"RGBA8s > RGBA16",       DXGI_FORMAT_R8G8B8A8_UNORM_SRGB,    DXGI_FORMAT_R16G16B16A16_UNORM,     TEX_FILTER_SRGB_OUT },
+        { L"BGRA8s > RGBA8s",       DXGI_FORMAT_B8G8R8A8_UNORM_SRGB,    DXGI_FORMAT_R8G8B8A8_UNORM_SRGB,    TEX_FILTER_DEFAULT },
+        { L"BGRA8s > BGRX8s",       DXGI_FORMAT_B8G8R8A8_UNORM_SRGB,    DXGI_FORMAT_B8G8R8X8_UNORM_SRGB,    TEX_FILTER_DEFAULT },
+        { L"BGRA8s > RGBA16",       DXGI_FORMAT_B8G8R8A8_UNORM_SRGB,    DXGI_FORMAT_R16G16B16A16_UNORM,     TEX_FILTER_SRGB_OUT },
+        { L"BGRX8s > RGBA8s",       DXGI_FORMAT_B8G8R8X8_UNORM_SRGB,    DXGI_FORMAT_R8G8B8A8_UNORM_SRGB,    TEX_FILTER_DEFAULT },
+        { L"BGRX8s > BGRA8s",       DXGI_FORMAT_B8G8R8X8_UNORM_SRGB,    DXGI_FORMAT_B8G8R8A8_UNORM_SRGB,    TEX_FILTER_DEFAULT },
+        { L"BGRX8s > RGBA16",       DXGI_FORMAT_B8G8R8X8_UNORM_SRGB,    DXGI_FORMAT_R16G16B16A16_UNORM,     TEX_FILTER_SRGB_OUT },
+        { L"RGBA16 > RGBA8s",       DXGI_FORMAT_R16G16B16A16_UNORM,     DXGI_FORMAT_R8G8B8A8_UNORM_SRGB,    TEX_FILTER_SRGB_IN },
+        { L"RGBA16 > BGRA8s",       DXGI_FORMAT_R16G16B16A16_UNORM,     DXGI_FORMAT_B8G8R8A8_UNORM_SRGB,    TEX_FILTER_SRGB_IN },
+        { L"RGBA16 > BGRX8s",       DXGI_FORMAT_R16G16B16A16_UNORM,     DXGI_FORMAT_B8G8R8X8_UNORM_SRGB,    TEX_FILTER_SRGB_IN },
+        { L"RGBA16F > RGBA32F",     DXGI_FORMAT_R16G16B16A16_FLOAT,     DXGI_FORMAT_R32G32B32A32_FLOAT,     TEX_FILTER_DEFAULT },
+        { L"RGBA32F > RGBA16F",     DXGI_FORMAT_R32G32B32A32_FLOAT,     DXGI_FORMAT_R16G16B16A16_FLOAT,     TEX_FILTER_DEFAULT },
+        { L"R16F > R32F",           DXGI_FORMAT_R16_FLOAT,              DXGI_FORMAT_R32_FLOAT,              TEX_FILTER_DEFAULT },
+        { L"R32F > R16F",           DXGI_FORMAT_R32_FLOAT,              DXGI_FORMAT_R16_FLOAT,              TEX_FILTER_DEFAULT },
+    };
+
+    // Every value of every channel: 8-bit formats get all (x, y) pairs in R and G, 16-bit
+    // formats every code, and 32-bit floats every half value plus its neighbours and the
+    // rounding midpoint to the next half
+    HRESULT CreateConversionPattern(DXGI_FORMAT format, ScratchImage& result)
+    {
+        size_t bpp = BitsPerPixel(format) / 8;
+        bool fp32 = (format == DXGI_FORMAT_R32_FLOAT || format == DXGI_FORMAT_R32G32B32A32_FLOAT);
+        size_t size = fp32 ? 512 : 256;
+
+        HRESULT hr = result.Initialize2D(format, size, size, 1, 1);
+        if (FAILED(hr))
+            return hr;
+
+        const Image* img = result.GetImage(0, 0, 0);
+        const size_t count = size * size;
+        for (size_t y = 0; y < size; ++y)
+        {
+            uint8_t* row = img->pixels + y * img->rowPitch;
+            for (size_t x = 0; x < size; ++x)
+            {
+                const size_t i = y * size + x;
+                if (bpp == 4 && !fp32)
+                {
+                    const uint8_t rgba[4] = { uint8_t(x), uint8_t(y), uint8_t(x ^ y), uint8_t(x + y) };
+                    memcpy(row + x * 4, rgba, 4);
+                }
+                else if (!fp32)
+                {
+                    auto ptr = reinterpret_cast<uint16_t*>(row + x * bpp);
+                    for (size_t j = 0; j < bpp / 2; ++j)
+                        ptr[j] = uint16_t(i + j * 0x4000);
+                }
+                else
+                {
+                    auto ptr = reinterpret_cast<uint32_t*>(row + x * bpp);
+                    for (size_t j = 0; j < bpp / 4; ++j)
+                    {
+                        const size_t k = (i + j * 0x10000) % count;
+                        const int32_t offsets[4] = { 0, 1, -1, 0x1000 };
+
+                        float f = PackedVector::XMConvertHalfToFloat(PackedVector::HALF(k & 0xFFFF));
+                        uint32_t bits;
+                        memcpy(&bits, &f, sizeof(bits));
+                        ptr[j] = bits + uint32_t(offsets[k >> 16]);
+                    }
+                }
+            }
+        }
+
+        return S_OK;
+    }
+
+    // Times Convert with the default path and the float path and counts the pixels which differ
+    HRESULT BenchmarkConvert(const Image& image, DXGI_FORMAT format, DWORD filter, _Out_ double seconds[2], _Out_ size_t& mismatches)
+    {
+        seconds[0] = seconds[1] = 0;
+        mismatches = 0;
+
+        LARGE_INTEGER frequency, start, end;
+        QueryPerformanceFrequency(&frequency);
+
+        const DWORD filters[2] = { filter, filter | TEX_FILTER_FORCE_FLOAT | TEX_FILTER_FORCE_NON_WIC };
+        ScratchImage converted[2];
+        for (size_t j = 0; j < 2; ++j)
+        {
+            QueryPerformanceCounter(&start);
+            HRESULT hr = Convert(image, format, filters[j], TEX_THRESHOLD_DEFAULT, converted[j]);
+            if (FAILED(hr))
+                return hr;
+            QueryPerformanceCounter(&end);
+            seconds[j] = double(end.QuadPart - start.QuadPart) / double(frequency.QuadPart);
+        }
+
+        const Image* img[2] = { converted[0].GetImage(0, 0, 0), converted[1].GetImage(0, 0, 0) };
+        const size_t bpp = BitsPerPixel(format) / 8;
+        for (size_t y = 0; y < image.height; ++y)
+        {
+            const uint8_t* row[2] = { img[0]->pixels + y * img[0]->rowPitch, img[1]->pixels + y * img[1]->rowPitch };
+            for (size_t x = 0; x < image.width; ++x)
+            {
+                if (memcmp(row[0] + x * bpp, row[1] + x * bpp, bpp) != 0)
+                    ++mismatches;
+            }
+        }
+
+        return S_OK;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    const struct
+    {
+        const wchar_t* name;
+        DXGI_FORMAT format;
+    } g_BenchmarkDecoders[] =
+    {
+        { L"BC1",   DXGI_FORMAT_BC1_UNORM },
+        { L"BC2",   DXGI_FORMAT_BC2_UNORM },
+        { L"BC3",   DXGI_FORMAT_BC3_UNORM },
+        { L"BC4",   DXGI_FORMAT_BC4_UNORM },
+        { L"BC5",   DXGI_FORMAT_BC5_UNORM },
+    };
+
+    // Times Decompress of the whole texture to the default format on one and on all threads and
+    // to float on all threads, in GB/s of decoded pixels. The default format result is checked
+    // against the float one converted to the same format.
+    HRESULT BenchmarkDecompress(const ScratchImage& bcImage, size_t threadCount, _Out_ double gbps[3], _Out_ size_t& mismatches)
+    {
+        gbps[0] = gbps[1] = gbps[2] = 0;
+        mismatches = 0;
+
+        LARGE_INTEGER frequency, start, end;
+        QueryPerformanceFrequency(&frequency);
+
+        const DXGI_FORMAT formats[3] = { DXGI_FORMAT_UNKNOWN, DXGI_FORMAT_UNKNOWN, DXGI_FORMAT_R32G32B32A32_FLOAT };
+        const size_t threads[3] = { 1, threadCount, threadCount };
+        ScratchImage decoded[3];
+        for (size_t j = 0; j < 3; ++j)
+        {
+            ParallelOptions options;
+            options.threadCount = threads[j];
+
+            QueryPerformanceCounter(&start);
+            HRESULT hr = Decompress(bcImage.GetImages(), bcImage.GetImageCount(), bcImage.GetMetadata(), formats[j], options, decoded[j]);
+            if (FAILED(hr))
+                return hr;
+            QueryPerformanceCounter(&end);
+
+            const double seconds = double(end.QuadPart - start.QuadPart) / double(frequency.QuadPart);
+            gbps[j] = (seconds > 0) ? double(decoded[j].GetPixelsSize()) / seconds / 1e9 : 0.0;
+        }
+
+        ScratchImage reference;
+        HRESULT hr = Convert(decoded[2].GetImages(), decoded[2].GetImageCount(), decoded[2].GetMetadata(), decoded[0].GetMetadata().format,
+            TEX_FILTER_RGB_COPY_RED | TEX_FILTER_FORCE_NON_WIC, TEX_THRESHOLD_DEFAULT, reference);
+        if (FAILED(hr))
+            return hr;
+
+        const size_t bpp = BitsPerPixel(decoded[0].GetMetadata().format) / 8;
+        for (size_t index = 0; index < decoded[0].GetImageCount(); ++index)
+        {
+            const Image& img = decoded[0].GetImages()[index];
+            const Image& ref = reference.GetImages()[index];
+            for (size_t y = 0; y < img.height; ++y)
+            {
+                const uint8_t* row[2] = { img.pixels + y * img.rowPitch, ref.pixels + y * ref.rowPitch };
+                for (size_t x = 0; x < img.width; ++x)
+                {
+                    if (memcmp(row[0] + x * bpp, row[1] + x * bpp, bpp) != 0)
+                        ++mismatches;
+                }
+            }
+        }
+
+        return S_OK;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    const struct
+    {
+        const wchar_t* name;
+        DWORD filter;
+    } g_BenchmarkResizeFilters[] =
+    {
+        { L"point",     TEX_FILTER_POINT },
+        { L"box",       TEX_FILTER_BOX },
+        { L"linear",    TEX_FILTER_LINEAR },
+        { L"cubic",     TEX_FILTER_CUBIC },
+        { L"triangle",  TEX_FILTER_TRIANGLE },
+    };
+
+    // Times Resize with the per image filters and with the separable resampler on one and on all
+    // threads, in megapixels written per second. The lowest PSNR of the resampler against the per
+    // image filters is 0 when those do not support the ratio (box only halves).
+    HRESULT BenchmarkResize(const ScratchImage& image, size_t width, size_t height, DWORD filter, size_t threadCount,
+        _Out_ double mpps[3], _Out_ double& psnr)
+    {
+        mpps[0] = mpps[1] = mpps[2] = 0;
+        psnr = 0;
+
+        LARGE_INTEGER frequency, start, end;
+        QueryPerformanceFrequency(&frequency);
+
+        const double pixels = double(width) * double(height) * double(image.GetImageCount());
+        auto rate = [&]() -> double
+        {
+            const double seconds = double(end.QuadPart - start.QuadPart) / double(frequency.QuadPart);
+            return (seconds > 0) ? pixels / seconds / 1e6 : 0.0;
+        };
+
+        ScratchImage reference;
+        QueryPerformanceCounter(&start);
+        HRESULT hr = Resize(image.GetImages(), image.GetImageCount(), image.GetMetadata(), width, height,
+            filter | TEX_FILTER_FORCE_NON_WIC, reference);
+        QueryPerformanceCounter(&end);
+        const bool hasReference = SUCCEEDED(hr);
+        if (hasReference)
+            mpps[0] = rate();
+
+        const size_t threads[2] = { 1, threadCount };
+        ScratchImage resized;
+        for (size_t j = 0; j < 2; ++j)
+        {
+            ParallelOptions options;
+            options.threadCount = threads[j];
+
+            resized.Release();
+            QueryPerformanceCounter(&start);
+            hr = Resize(image.GetImages(), image.GetImageCount(), image.GetMetadata(), width, height, filter, options, resized);
+            if (FAILED(hr))
+                return hr;
+            QueryPerformanceCounter(&end);
+            mpps[j + 1] = rate();
+        }
+
+        if (hasReference)
+        {
+            std::vector<ImageMetrics> metrics(resized.GetImageCount());
+            hr = ComputeImageMetrics(resized.GetImages(), reference.GetImages(), resized.GetImageCount(), resized.GetMetadata(),
+                0, ParallelOptions(), metrics.data());
+            if (FAILED(hr))
+                return hr;
+
+            psnr = 1000.0;
+            for (const auto& m : metrics)
+                psnr = std::min(psnr, double(m.psnr));
+        }
+
+        return S_OK;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    // Times reading the top mip of one array item with LoadFromDDSFile against MappedDDS.
+    // Every byte of the mip is summed, so the mapped pages really get read.
+    HRESULT BenchmarkMappedDDS(const wchar_t* fileName, DWORD ddsFlags, _Out_ double seconds[2], _Out_ size_t& bytes, _Out_ bool& match)
+    {
+        seconds[0] = seconds[1] = 0;
+        bytes = 0;
+        match = false;
+
+        LARGE_INTEGER frequency, start, end;
+        QueryPerformanceFrequency(&frequency);
+
+        auto sum = [](const Image& img) -> uint64_t
+        {
+            uint64_t total = 0;
+            for (size_t j = 0; j < img.slicePitch; ++j)
+                total += img.pixels[j];
+            return total;
+        };
+
+        // Warms up the file cache, so both times are without disk reads
+        {
+            ScratchImage warmup;
+            HRESULT hr = LoadFromDDSFile(fileName, ddsFlags, nullptr, warmup);
+            if (FAILED(hr))
+                return hr;
+        }
+
+        TexMetadata info;
+        ScratchImage image;
+        QueryPerformanceCounter(&start);
+        HRESULT hr = LoadFromDDSFile(fileName, ddsFlags, &info, image);
+        if (FAILED(hr))
+            return hr;
+        const Image* loaded = image.GetImage(0, info.arraySize / 2, 0);
+        if (!loaded)
+            return E_FAIL;
+        uint64_t loadedSum = sum(*loaded);
+        QueryPerformanceCounter(&end);
+        seconds[0] = double(end.QuadPart - start.QuadPart) / double(frequency.QuadPart);
+
+        MappedDDS mapped;
+        Image mappedImage;
+        QueryPerformanceCounter(&start);
+        hr = mapped.Open(fileName, ddsFlags);
+        if (SUCCEEDED(hr))
+            hr = mapped.GetImage(0, info.arraySize / 2, 0, mappedImage);
+        if (FAILED(hr))
+            return hr;
+        uint64_t mappedSum = sum(mappedImage);
+        QueryPerformanceCounter(&end);
+        seconds[1] = double(end.QuadPart - start.QuadPart) / double(frequency.QuadPart);
+
+        bytes = mappedImage.slicePitch;
+        match = (loadedSum == mappedSum) && (loaded->slicePitch == mappedImage.slicePitch)
+            && memcmp(loaded->pixels, mappedImage.pixels, mappedImage.slicePitch) == 0;
+
+        return S_OK;
+    }
 }
 
 
@@ -3019,6 +3635,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
     DXGI_FORMAT diffFormat = DXGI_FORMAT_B8G8R8A8_UNORM;
     DWORD fileType = WIC_CODEC_BMP;
     wchar_t szOutputFile[MAX_PATH] = {};
+    float minPSNR = 0.f;
+    float minSSIM = -1.f;
 
     // Initialize COM (needed for WIC)
     HRESULT hr = hr = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
@@ -3044,15 +3662,23 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
     case CMD_DIFF:
     case CMD_DUMPBC:
     case CMD_DUMPDDS:
+    case CMD_BCBENCH:
+    case CMD_PARBENCH:
+    case CMD_MIPBENCH:
+    case CMD_CONVBENCH:
+    case CMD_MAPBENCH:
+    case CMD_DECBENCH:
+    case CMD_RESIZEBENCH:
         break;
 
     default:
-        wprintf(L"Must use one of: info, analyze, compare, diff, dumpbc, or dumpdds\n\n");
+        wprintf(L"Must use one of: info, analyze, compare, diff, dumpbc, dumpdds, bcbench, parbench, mipbench, convbench, mapbench, decbench, or resizebench\n\n");
         return 1;
     }
 
     DWORD dwOptions = 0;
     std::list<SConversion> conversion;
+    BenchmarkData benchmarkTotals[g_BenchmarkEncoderCount] = {};
 
     for (int iArg = 2; iArg < argc; iArg++)
     {
@@ -3088,6 +3714,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             case OPT_TARGET_PIXELX:
             case OPT_TARGET_PIXELY:
             case OPT_FILELIST:
+            case OPT_MIN_PSNR:
+            case OPT_MIN_SSIM:
                 if (!*pValue)
                 {
                     if ((iArg + 1 >= argc))
@@ -3135,9 +3763,9 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
                 break;
 
             case OPT_OUTPUTFILE:
-                if (dwCommand != CMD_DIFF)
+                if (dwCommand != CMD_DIFF && dwCommand != CMD_COMPARE)
                 {
-                    wprintf(L"-o only valid for use with diff command\n");
+                    wprintf(L"-o only valid for use with compare or diff command\n");
                     return 1;
                 }
                 else
@@ -3170,6 +3798,32 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
                 }
                 break;
 
+            case OPT_MIN_PSNR:
+                if (dwCommand != CMD_COMPARE)
+                {
+                    wprintf(L"-minpsnr only valid with compare command\n");
+                    return 1;
+                }
+                else if (swscanf_s(pValue, L"%f", &minPSNR) != 1)
+                {
+                    wprintf(L"Invalid value for minimum PSNR (%ls)\n", pValue);
+                    return 1;
+                }
+                break;
+
+            case OPT_MIN_SSIM:
+                if (dwCommand != CMD_COMPARE)
+                {
+                    wprintf(L"-minssim only valid with compare command\n");
+                    return 1;
+                }
+                else if (swscanf_s(pValue, L"%f", &minSSIM) != 1)
+                {
+                    wprintf(L"Invalid value for minimum SSIM (%ls)\n", pValue);
+                    return 1;
+                }
+                break;
+
             case OPT_TARGET_PIXELX:
                 if (dwCommand != CMD_DUMPBC)
                 {
@@ -3363,165 +4017,230 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
 
                 wprintf(L"Difference %ls\n", szOutputFile);
             }
-            else if ((info1.depth == 1
-                && info1.arraySize == 1
-                && info1.mipLevels == 1)
-                || info1.depth != info2.depth
-                || info1.arraySize != info2.arraySize
-                || info1.mipLevels != info2.mipLevels
-                || image1->GetImageCount() != image2->GetImageCount())
+            else
             {
-                // Compare single image
-                if (image1->GetImageCount() > 1 || image2->GetImageCount() > 1)
-                    wprintf(L"WARNING: ignoring all images but first one in each file\n");
+                // Compare all images if both files have the same layout, otherwise only the first ones
+                TexMetadata mdata = info1;
+                const Image* images1 = image1->GetImages();
+                const Image* images2 = image2->GetImages();
+                size_t nimages = image1->GetImageCount();
+
+                if ((info1.depth == 1
+                    && info1.arraySize == 1
+                    && info1.mipLevels == 1)
+                    || info1.depth != info2.depth
+                    || info1.arraySize != info2.arraySize
+                    || info1.mipLevels != info2.mipLevels
+                    || image1->GetImageCount() != image2->GetImageCount())
+                {
+                    if (image1->GetImageCount() > 1 || image2->GetImageCount() > 1)
+                        wprintf(L"WARNING: ignoring all images but first one in each file\n");
+
+                    images1 = image1->GetImage(0, 0, 0);
+                    images2 = image2->GetImage(0, 0, 0);
+                    nimages = 1;
+                    mdata.depth = mdata.arraySize = mdata.mipLevels = 1;
+                    mdata.miscFlags &= ~static_cast<uint32_t>(TEX_MISC_TEXTURECUBE);
+                    mdata.dimension = TEX_DIMENSION_TEXTURE2D;
+                }
 
-                float mse, mseV[4];
-                hr = ComputeMSE(*image1->GetImage(0, 0, 0), *image2->GetImage(0, 0, 0), mse, mseV);
+                std::vector<ImageMetrics> metrics(nimages);
+                ScratchImage heatmaps;
+                hr = ComputeImageMetrics(images1, images2, nimages, mdata, CMSE_DEFAULT, ParallelOptions(),
+                    metrics.data(), *szOutputFile ? &heatmaps : nullptr);
                 if (FAILED(hr))
                 {
                     wprintf(L"Failed comparing images (%08X)\n", hr);
                     return 1;
                 }
 
-                wprintf(L"Result: %f (%f %f %f %f) PSNR %f dB\n", mse, mseV[0], mseV[1], mseV[2], mseV[3],
-                    10.0 * log10(3.0 / (double(mseV[0]) + double(mseV[1]) + double(mseV[2]))));
-            }
-            else
-            {
-                // Compare all images
-                float min_mse = FLT_MAX;
-                float min_mseV[4] = { FLT_MAX, FLT_MAX, FLT_MAX, FLT_MAX };
-
-                float max_mse = -FLT_MAX;
-                float max_mseV[4] = { -FLT_MAX, -FLT_MAX, -FLT_MAX, -FLT_MAX };
-
-                double sum_mse = 0;
-                double sum_mseV[4] = { 0, 0, 0, 0 };
-
-                size_t total_images = 0;
-
-                if (info1.depth > 1)
+                if (nimages == 1)
+                {
+                    const ImageMetrics& m = metrics[0];
+                    wprintf(L"Result: %f (%f %f %f %f) PSNR %f dB SSIM %f (%f %f %f %f)\n", m.mse, m.mseV[0], m.mseV[1], m.mseV[2], m.mseV[3],
+                        m.psnr, m.ssim, m.ssimV[0], m.ssimV[1], m.ssimV[2], m.ssimV[3]);
+                    wprintf(L"Maximum error: %f at (%Iu, %Iu)\n", m.maxError, m.maxErrorX, m.maxErrorY);
+                }
+                else
                 {
-                    wprintf(L"Results by mip (%3Iu) and slice (%3Iu)\n\n", info1.mipLevels, info1.depth);
+                    float min_mse = FLT_MAX;
+                    float min_mseV[4] = { FLT_MAX, FLT_MAX, FLT_MAX, FLT_MAX };
 
-                    size_t depth = info1.depth;
-                    for (size_t mip = 0; mip < info1.mipLevels; ++mip)
-                    {
-                        for (size_t slice = 0; slice < depth; ++slice)
-                        {
-                            const Image* img1 = image1->GetImage(mip, 0, slice);
-                            const Image* img2 = image2->GetImage(mip, 0, slice);
+                    float max_mse = -FLT_MAX;
+                    float max_mseV[4] = { -FLT_MAX, -FLT_MAX, -FLT_MAX, -FLT_MAX };
 
-                            if (!img1
-                                || !img2
-                                || img1->height != img2->height
-                                || img1->width != img2->width)
-                            {
-                                wprintf(L"ERROR: Unexpected mismatch at slice %3Iu, mip %3Iu\n", slice, mip);
-                                return 1;
-                            }
-                            else
-                            {
-                                float mse, mseV[4];
-                                hr = ComputeMSE(*img1, *img2, mse, mseV);
-                                if (FAILED(hr))
-                                {
-                                    wprintf(L"Failed comparing images at slice %3Iu, mip %3Iu (%08X)\n", slice, mip, hr);
-                                    return 1;
-                                }
+                    double sum_mse = 0;
+                    double sum_mseV[4] = { 0, 0, 0, 0 };
 
-                                min_mse = std::min(min_mse, mse);
-                                max_mse = std::max(max_mse, mse);
-                                sum_mse += mse;
+                    float min_ssim = FLT_MAX;
+                    double sum_ssim = 0;
+                    float max_error = 0;
 
-                                for (size_t j = 0; j < 4; ++j)
-                                {
-                                    min_mseV[j] = std::min(min_mseV[j], mseV[j]);
-                                    max_mseV[j] = std::max(max_mseV[j], mseV[j]);
-                                    sum_mseV[j] += mseV[j];
-                                }
+                    // The images are stored in the same order as they are listed
+                    size_t index = 0;
+                    auto addResult = [&](size_t a, size_t b)
+                    {
+                        const ImageMetrics& m = metrics[index++];
 
-                                ++total_images;
+                        min_mse = std::min(min_mse, m.mse);
+                        max_mse = std::max(max_mse, m.mse);
+                        sum_mse += m.mse;
 
-                                wprintf(L"[%3Iu,%3Iu]: %f (%f %f %f %f) PSNR %f dB\n", mip, slice, mse, mseV[0], mseV[1], mseV[2], mseV[3],
-                                    10.0 * log10(3.0 / (double(mseV[0]) + double(mseV[1]) + double(mseV[2]))));
-                            }
+                        for (size_t j = 0; j < 4; ++j)
+                        {
+                            min_mseV[j] = std::min(min_mseV[j], m.mseV[j]);
+                            max_mseV[j] = std::max(max_mseV[j], m.mseV[j]);
+                            sum_mseV[j] += m.mseV[j];
                         }
 
-                        if (depth > 1)
-                            depth >>= 1;
-                    }
-                }
-                else
-                {
-                    wprintf(L"Results by item (%3Iu) and mip (%3Iu)\n\n", info1.arraySize, info1.mipLevels);
+                        min_ssim = std::min(min_ssim, m.ssim);
+                        sum_ssim += m.ssim;
+                        max_error = std::max(max_error, m.maxError);
 
-                    for (size_t item = 0; item < info1.arraySize; ++item)
+                        wprintf(L"[%3Iu,%3Iu]: %f (%f %f %f %f) PSNR %f dB SSIM %f max %f\n", a, b, m.mse, m.mseV[0], m.mseV[1], m.mseV[2], m.mseV[3],
+                            m.psnr, m.ssim, m.maxError);
+                    };
+
+                    if (info1.depth > 1)
                     {
+                        wprintf(L"Results by mip (%3Iu) and slice (%3Iu)\n\n", info1.mipLevels, info1.depth);
+
+                        size_t depth = info1.depth;
                         for (size_t mip = 0; mip < info1.mipLevels; ++mip)
                         {
-                            const Image* img1 = image1->GetImage(mip, item, 0);
-                            const Image* img2 = image2->GetImage(mip, item, 0);
-
-                            if (!img1
-                                || !img2
-                                || img1->height != img2->height
-                                || img1->width != img2->width)
+                            for (size_t slice = 0; slice < depth; ++slice)
                             {
-                                wprintf(L"ERROR: Unexpected mismatch at item %3Iu, mip %3Iu\n", item, mip);
-                                return 1;
+                                addResult(mip, slice);
                             }
-                            else
-                            {
-                                float mse, mseV[4];
-                                hr = ComputeMSE(*img1, *img2, mse, mseV);
-                                if (FAILED(hr))
-                                {
-                                    wprintf(L"Failed comparing images at item %3Iu, mip %3Iu (%08X)\n", item, mip, hr);
-                                    return 1;
-                                }
 
-                                min_mse = std::min(min_mse, mse);
-                                max_mse = std::max(max_mse, mse);
-                                sum_mse += mse;
-
-                                for (size_t j = 0; j < 4; ++j)
-                                {
-                                    min_mseV[j] = std::min(min_mseV[j], mseV[j]);
-                                    max_mseV[j] = std::max(max_mseV[j], mseV[j]);
-                                    sum_mseV[j] += mseV[j];
-                                }
-
-                                ++total_images;
+                            if (depth > 1)
+                                depth >>= 1;
+                        }
+                    }
+                    else
+                    {
+                        wprintf(L"Results by item (%3Iu) and mip (%3Iu)\n\n", info1.arraySize, info1.mipLevels);
 
-                                wprintf(L"[%3Iu,%3Iu]: %f (%f %f %f %f) PSNR %f dB\n", item, mip, mse, mseV[0], mseV[1], mseV[2], mseV[3],
-                                    10.0 * log10(3.0 / (double(mseV[0]) + double(mseV[1]) + double(mseV[2]))));
+                        for (size_t item = 0; item < info1.arraySize; ++item)
+                        {
+                            for (size_t mip = 0; mip < info1.mipLevels; ++mip)
+                            {
+                                addResult(item, mip);
                             }
                         }
                     }
-                }
 
-                // Output multi-image stats
-                if (total_images > 1)
-                {
+                    // Output multi-image stats
                     wprintf(L"\n    Minimum MSE: %f (%f %f %f %f) PSNR %f dB\n", min_mse, min_mseV[0], min_mseV[1], min_mseV[2], min_mseV[3],
                         10.0 * log10(3.0 / (double(min_mseV[0]) + double(min_mseV[1]) + double(min_mseV[2]))));
-                    double total_mseV0 = sum_mseV[0] / double(total_images);
-                    double total_mseV1 = sum_mseV[1] / double(total_images);
-                    double total_mseV2 = max_mseV[2] / double(total_images);
-                    wprintf(L"    Average MSE: %f (%f %f %f %f) PSNR %f dB\n", sum_mse / double(total_images),
+                    double total_mseV0 = sum_mseV[0] / double(nimages);
+                    double total_mseV1 = sum_mseV[1] / double(nimages);
+                    double total_mseV2 = sum_mseV[2] / double(nimages);
+                    wprintf(L"    Average MSE: %f (%f %f %f %f) PSNR %f dB\n", sum_mse / double(nimages),
                         total_mseV0,
                         total_mseV1,
                         total_mseV2,
-                        sum_mseV[3] / double(total_images),
+                        sum_mseV[3] / double(nimages),
                         10.0 * log10(3.0 / (total_mseV0 + total_mseV1 + total_mseV2)));
                     wprintf(L"    Maximum MSE: %f (%f %f %f %f) PSNR %f dB\n", max_mse, max_mseV[0], max_mseV[1], max_mseV[2], max_mseV[3],
                         10.0 * log10(3.0 / (double(max_mseV[0]) + double(max_mseV[1]) + double(max_mseV[2]))));
+                    wprintf(L"   Minimum SSIM: %f\n", min_ssim);
+                    wprintf(L"   Average SSIM: %f\n", sum_ssim / double(nimages));
+                    wprintf(L"  Maximum error: %f\n", max_error);
+                }
+
+                if (*szOutputFile)
+                {
+                    if (~dwOptions & (1 << OPT_OVERWRITE))
+                    {
+                        if (GetFileAttributesW(szOutputFile) != INVALID_FILE_ATTRIBUTES)
+                        {
+                            wprintf(L"\nERROR: Output file already exists, use -y to overwrite\n");
+                            return 1;
+                        }
+                    }
+
+                    if (fileType == CODEC_DDS)
+                    {
+                        // Raw errors of all images
+                        hr = SaveToDDSFile(heatmaps.GetImages(), heatmaps.GetImageCount(), heatmaps.GetMetadata(), DDS_FLAGS_NONE, szOutputFile);
+                    }
+                    else
+                    {
+                        if (nimages > 1)
+                            wprintf(L"WARNING: heatmap of the first image only, use a .dds file for all of them\n");
+
+                        ScratchImage colors;
+                        hr = ColorizeHeatmap(*heatmaps.GetImage(0, 0, 0), metrics[0].maxError, colors);
+                        if (SUCCEEDED(hr))
+                        {
+                            hr = SaveImage(colors.GetImage(0, 0, 0), szOutputFile, fileType);
+                        }
+                    }
+
+                    if (FAILED(hr))
+                    {
+                        wprintf(L" FAILED (%x)\n", hr);
+                        return 1;
+                    }
+
+                    wprintf(L"Heatmap %ls\n", szOutputFile);
+                }
+
+                // Quality gates
+                size_t failed = 0;
+                for (size_t i = 0; i < nimages; ++i)
+                {
+                    if (((dwOptions & (1 << OPT_MIN_PSNR)) && metrics[i].psnr < minPSNR)
+                        || ((dwOptions & (1 << OPT_MIN_SSIM)) && metrics[i].ssim < minSSIM))
+                        ++failed;
+                }
+
+                if (failed)
+                {
+                    wprintf(L"FAILED: %Iu of %Iu images below the quality threshold\n", failed, nimages);
+                    return 1;
                 }
             }
         }
         break;
     
+    case CMD_MAPBENCH:
+        // --- Mapped DDS benchmark ----------------------------------------------------
+        // Does not load the files up front, the point is to read only a part of them
+        {
+            DWORD ddsFlags = DDS_FLAGS_NONE;
+            if (dwOptions & (1 << OPT_DDS_DWORD_ALIGN))
+                ddsFlags |= DDS_FLAGS_LEGACY_DWORD;
+            if (dwOptions & (1 << OPT_EXPAND_LUMINANCE))
+                ddsFlags |= DDS_FLAGS_EXPAND_LUMINANCE;
+            if (dwOptions & (1 << OPT_DDS_BAD_DXTN_TAILS))
+                ddsFlags |= DDS_FLAGS_BAD_DXTN_TAILS;
+
+            wprintf(L"\t%10ls %10ls %10ls %8ls %6ls\n", L"KB", L"loaded", L"mapped", L"speedup", L"match");
+
+            for (auto pConv = conversion.cbegin(); pConv != conversion.cend(); ++pConv)
+            {
+                wprintf(L"%ls\n", pConv->szSrc);
+                fflush(stdout);
+
+                double seconds[2];
+                size_t bytes;
+                bool match;
+                hr = BenchmarkMappedDDS(pConv->szSrc, ddsFlags, seconds, bytes, match);
+                if (FAILED(hr))
+                {
+                    wprintf(L"ERROR: Failed reading DDS file (%08X)\n", hr);
+                    return 1;
+                }
+
+                wprintf(L"\t%10zu %7.2f ms %7.2f ms %7.1fx %6ls\n", bytes / 1024,
+                    seconds[0] * 1000.0, seconds[1] * 1000.0, (seconds[1] > 0) ? seconds[0] / seconds[1] : 0.0,
+                    match ? L"yes" : L"NO");
+            }
+        }
+        break;
+
     default:
         for (auto pConv = conversion.cbegin(); pConv != conversion.cend(); ++pConv)
         {
@@ -3801,6 +4520,291 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
                     }
                 }
             }
+            else if (dwCommand == CMD_BCBENCH)
+            {
+                // --- BC benchmark --------------------------------------------------------
+                // Uses the top level of the first image
+                const Image* img = image->GetImage(0, 0, 0);
+                assert(img);
+
+                ScratchImage decompressed;
+                if (IsCompressed(img->format))
+                {
+                    hr = Decompress(*img, DXGI_FORMAT_R8G8B8A8_UNORM, decompressed);
+                    if (FAILED(hr))
+                    {
+                        wprintf(L"ERROR: Failed decompressing image (%08X)\n", hr);
+                        return 1;
+                    }
+
+                    img = decompressed.GetImage(0, 0, 0);
+                }
+
+                for (size_t j = 0; j < g_BenchmarkEncoderCount; ++j)
+                {
+                    BenchmarkData data;
+                    hr = BenchmarkBC(*img, g_BenchmarkEncoders[j].format, g_BenchmarkEncoders[j].compress, data);
+                    if (FAILED(hr))
+                    {
+                        wprintf(L"ERROR: Failed compressing image with %ls (%08X)\n", g_BenchmarkEncoders[j].name, hr);
+                        return 1;
+                    }
+
+                    data.Print(g_BenchmarkEncoders[j].name);
+                    benchmarkTotals[j].Add(data);
+                }
+            }
+            else if (dwCommand == CMD_PARBENCH)
+            {
+                // --- Thread scaling benchmark --------------------------------------------
+                // Uses the top level of every array item as 8-bit RGBA
+                if (info.IsVolumemap())
+                {
+                    wprintf(L"ERROR: parbench does not support volume textures\n");
+                    return 1;
+                }
+
+                ScratchImage baseImage;
+                hr = GetBaseImages(*image, IsSRGB(info.format) ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM, baseImage);
+                if (FAILED(hr))
+                {
+                    wprintf(L"ERROR: Failed converting image to RGBA (%08X)\n", hr);
+                    return 1;
+                }
+
+                wprintf(L"\t%7ls %12ls %12ls %12ls %12ls  (ms, speedup)\n", L"threads", L"mips", L"BC1", L"BC7 fast", L"decode");
+
+                // Powers of two up to the number of hardware threads, which is always measured
+                const size_t maxThreads = std::max<size_t>(1, std::thread::hardware_concurrency());
+                ParallelBenchmarkData baseline = {};
+                for (size_t threads = 1; threads <= maxThreads; threads = (threads * 2 > maxThreads && threads < maxThreads) ? maxThreads : threads * 2)
+                {
+                    ParallelBenchmarkData data;
+                    hr = BenchmarkParallel(baseImage, threads, data);
+                    if (FAILED(hr))
+                    {
+                        wprintf(L"ERROR: Failed benchmarking with %zu threads (%08X)\n", threads, hr);
+                        return 1;
+                    }
+
+                    if (threads == 1)
+                        baseline = data;
+
+                    wprintf(L"\t%7zu", threads);
+                    for (size_t j = 0; j < 4; ++j)
+                    {
+                        wprintf(L" %6.0f %4.1fx", data.seconds[j] * 1000.0,
+                            (data.seconds[j] > 0) ? baseline.seconds[j] / data.seconds[j] : 0.0);
+                    }
+                    wprintf(L"\n");
+                }
+            }
+            else if (dwCommand == CMD_MIPBENCH)
+            {
+                // --- Mip generation benchmark --------------------------------------------
+                // Uses the top level of every array item as 8-bit and float RGBA
+                if (info.IsVolumemap() || (info.width & (info.width - 1)) || (info.height & (info.height - 1)))
+                {
+                    wprintf(L"ERROR: mipbench needs a 2D texture with power of 2 dimensions\n");
+                    return 1;
+                }
+
+                const DXGI_FORMAT formats[] =
+                {
+                    IsSRGB(info.format) ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM,
+                    DXGI_FORMAT_R32G32B32A32_FLOAT,
+                };
+                const wchar_t* names[] = { L"RGBA8", L"RGBA32F" };
+
+                const size_t maxThreads = std::max<size_t>(1, std::thread::hardware_concurrency());
+                wprintf(L"\t%-8ls %10ls %20ls %20ls %12ls\n", L"", L"per level", L"fused 1 thread", L"fused", L"min PSNR");
+
+                for (size_t j = 0; j < sizeof(formats) / sizeof(formats[0]); ++j)
+                {
+                    ScratchImage baseImage;
+                    hr = GetBaseImages(*image, formats[j], baseImage);
+                    if (FAILED(hr))
+                    {
+                        wprintf(L"ERROR: Failed converting image to %ls (%08X)\n", names[j], hr);
+                        return 1;
+                    }
+
+                    ScratchImage reference;
+                    double seconds[3], psnr[3];
+                    hr = BenchmarkMips(baseImage, 0, seconds[0], psnr[0], nullptr, &reference);
+                    if (SUCCEEDED(hr))
+                        hr = BenchmarkMips(baseImage, 1, seconds[1], psnr[1], &reference, nullptr);
+                    if (SUCCEEDED(hr))
+                        hr = BenchmarkMips(baseImage, maxThreads, seconds[2], psnr[2], &reference, nullptr);
+                    if (FAILED(hr))
+                    {
+                        wprintf(L"ERROR: Failed generating %ls mips (%08X)\n", names[j], hr);
+                        return 1;
+                    }
+
+                    wprintf(L"\t%-8ls %7.0f ms %7.0f ms (%5.1fx) %7.0f ms (%5.1fx) %9.2f dB  (%zu threads)\n", names[j],
+                        seconds[0] * 1000.0,
+                        seconds[1] * 1000.0, (seconds[1] > 0) ? seconds[0] / seconds[1] : 0.0,
+                        seconds[2] * 1000.0, (seconds[2] > 0) ? seconds[0] / seconds[2] : 0.0,
+                        std::min(psnr[1], psnr[2]), maxThreads);
+                }
+            }
+            else if (dwCommand == CMD_CONVBENCH)
+            {
+                // --- Conversion benchmark ------------------------------------------------
+                // Times the top level of the first image and checks the generated patterns
+                // with every value of the source format
+                wprintf(L"\t%-18ls %10ls %10ls %8ls %12ls %12ls\n", L"", L"default", L"float", L"speedup", L"mismatches", L"pattern");
+
+                size_t totalMismatches = 0;
+                for (size_t j = 0; j < sizeof(g_BenchmarkConversions) / sizeof(g_BenchmarkConversions[0]); ++j)
+                {
+                    const auto& conv = g_BenchmarkConversions[j];
+
+                    ScratchImage baseImage, pattern;
+                    hr = GetBaseImages(*image, conv.source, baseImage);
+                    if (SUCCEEDED(hr))
+                        hr = CreateConversionPattern(conv.source, pattern);
+                    if (FAILED(hr))
+                    {
+                        wprintf(L"ERROR: Failed creating %ls source image (%08X)\n", conv.name, hr);
+                        return 1;
+                    }
+
+                    double seconds[2], patternSeconds[2];
+                    size_t mismatches, patternMismatches;
+                    hr = BenchmarkConvert(*baseImage.GetImage(0, 0, 0), conv.dest, conv.filter, seconds, mismatches);
+                    if (SUCCEEDED(hr))
+                        hr = BenchmarkConvert(*pattern.GetImage(0, 0, 0), conv.dest, conv.filter, patternSeconds, patternMismatches);
+                    if (FAILED(hr))
+                    {
+                        wprintf(L"ERROR: Failed converting %ls (%08X)\n", conv.name, hr);
+                        return 1;
+                    }
+
+                    wprintf(L"\t%-18ls %7.2f ms %7.2f ms %7.1fx %12zu %12zu\n", conv.name,
+                        seconds[0] * 1000.0, seconds[1] * 1000.0, (seconds[0] > 0) ? seconds[1] / seconds[0] : 0.0,
+                        mismatches, patternMismatches);
+                    totalMismatches += mismatches + patternMismatches;
+                }
+
+                if (totalMismatches > 0)
+                {
+                    wprintf(L"ERROR: %zu pixels differ from the float path\n", totalMismatches);
+                    return 1;
+                }
+            }
+            else if (dwCommand == CMD_DECBENCH)
+            {
+                // --- Decompression benchmark ---------------------------------------------
+                // Compresses the top level of every array item with its mips to each format
+                if (info.IsVolumemap())
+                {
+                    wprintf(L"ERROR: decbench does not support volume textures\n");
+                    return 1;
+                }
+
+                const size_t maxThreads = std::max<size_t>(1, std::thread::hardware_concurrency());
+                ParallelOptions options;
+
+                ScratchImage baseImage, mipChain;
+                hr = GetBaseImages(*image, DXGI_FORMAT_R8G8B8A8_UNORM, baseImage);
+                if (SUCCEEDED(hr))
+                    hr = GenerateMipMaps(baseImage.GetImages(), baseImage.GetImageCount(), baseImage.GetMetadata(), TEX_FILTER_DEFAULT, 0, options, mipChain);
+                if (FAILED(hr))
+                {
+                    wprintf(L"ERROR: Failed creating RGBA mip chain (%08X)\n", hr);
+                    return 1;
+                }
+
+                wprintf(L"\t%-5ls %10ls %10ls %10ls %12ls  (GB/s, %zu threads)\n", L"", L"1 thread", L"threads", L"float", L"mismatches", maxThreads);
+
+                for (size_t j = 0; j < sizeof(g_BenchmarkDecoders) / sizeof(g_BenchmarkDecoders[0]); ++j)
+                {
+                    ScratchImage bcImage;
+                    hr = Compress(mipChain.GetImages(), mipChain.GetImageCount(), mipChain.GetMetadata(), g_BenchmarkDecoders[j].format,
+                        TEX_COMPRESS_DEFAULT, TEX_THRESHOLD_DEFAULT, options, bcImage);
+                    if (FAILED(hr))
+                    {
+                        wprintf(L"ERROR: Failed compressing image with %ls (%08X)\n", g_BenchmarkDecoders[j].name, hr);
+                        return 1;
+                    }
+
+                    double gbps[3];
+                    size_t mismatches;
+                    hr = BenchmarkDecompress(bcImage, maxThreads, gbps, mismatches);
+                    if (FAILED(hr))
+                    {
+                        wprintf(L"ERROR: Failed decompressing %ls (%08X)\n", g_BenchmarkDecoders[j].name, hr);
+                        return 1;
+                    }
+
+                    wprintf(L"\t%-5ls %10.2f %10.2f %10.2f %12zu\n", g_BenchmarkDecoders[j].name, gbps[0], gbps[1], gbps[2], mismatches);
+                }
+            }
+            else if (dwCommand == CMD_RESIZEBENCH)
+            {
+                // --- Resize benchmark ----------------------------------------------------
+                // Halves and enlarges by 3/2 the top level of every array item in each format
+                if (info.IsVolumemap())
+                {
+                    wprintf(L"ERROR: resizebench does not support volume textures\n");
+                    return 1;
+                }
+
+                const size_t maxThreads = std::max<size_t>(1, std::thread::hardware_concurrency());
+
+                const struct
+                {
+                    const wchar_t* name;
+                    DXGI_FORMAT format;
+                } formats[] =
+                {
+                    { L"R32F",      DXGI_FORMAT_R32_FLOAT },
+                    { L"RGBA8",     DXGI_FORMAT_R8G8B8A8_UNORM },
+                    { L"RGBA32F",   DXGI_FORMAT_R32G32B32A32_FLOAT },
+                };
+
+                wprintf(L"\t%-8ls %-10ls %-9ls %10ls %10ls %10ls %10ls  (MP/s, %zu threads)\n",
+                    L"", L"size", L"filter", L"filters", L"1 thread", L"threads", L"PSNR", maxThreads);
+
+                for (size_t j = 0; j < sizeof(formats) / sizeof(formats[0]); ++j)
+                {
+                    ScratchImage baseImage;
+                    hr = GetBaseImages(*image, formats[j].format, baseImage);
+                    if (FAILED(hr))
+                    {
+                        wprintf(L"ERROR: Failed creating %ls source image (%08X)\n", formats[j].name, hr);
+                        return 1;
+                    }
+
+                    const size_t sizes[2][2] =
+                    {
+                        { std::max<size_t>(1, info.width / 2), std::max<size_t>(1, info.height / 2) },
+                        { info.width * 3 / 2, info.height * 3 / 2 },
+                    };
+
+                    for (size_t k = 0; k < 2; ++k)
+                    {
+                        wchar_t size[32] = {};
+                        swprintf_s(size, L"%zux%zu", sizes[k][0], sizes[k][1]);
+
+                        for (size_t f = 0; f < sizeof(g_BenchmarkResizeFilters) / sizeof(g_BenchmarkResizeFilters[0]); ++f)
+                        {
+                            double mpps[3], psnr;
+                            hr = BenchmarkResize(baseImage, sizes[k][0], sizes[k][1], g_BenchmarkResizeFilters[f].filter, maxThreads, mpps, psnr);
+                            if (FAILED(hr))
+                            {
+                                wprintf(L"ERROR: Failed resizing %ls with %ls (%08X)\n", formats[j].name, g_BenchmarkResizeFilters[f].name, hr);
+                                return 1;
+                            }
+
+                            wprintf(L"\t%-8ls %-10ls %-9ls %10.1f %10.1f %10.1f %7.2f dB\n", formats[j].name, size,
+                                g_BenchmarkResizeFilters[f].name, mpps[0], mpps[1], mpps[2], psnr);
+                        }
+                    }
+                }
+            }
             else
             {
                 // --- Analyze -------------------------------------------------------------
@@ -3938,6 +4942,13 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
                 }
             }
         }
+
+        if (dwCommand == CMD_BCBENCH && conversion.size() > 1)
+        {
+            wprintf(L"\nTotal:\n");
+            for (size_t j = 0; j < g_BenchmarkEncoderCount; ++j)
+                benchmarkTotals[j].Print(g_BenchmarkEncoders[j].name);
+        }
         break;
     }
 
@@ -13,6 +13,8 @@
 
 #pragma once
 
+#include <cstdint>
+
 namespace D3DX11Effects
 {
 
@@ -25,7 +27,7 @@ namespace D3DX11Effects
 struct EVersionTag
 {
     const char* m_pName;
-    DWORD       m_Version;
+    uint32_t    m_Version;
     uint32_t    m_Tag;
 };
 
@@ -265,7 +267,7 @@ inline bool IsShader5Helper(EVarType InVarType,
 
 inline bool IsInterfaceHelper(EVarType InVarType, EObjectType InObjType)
 {
-    UNREFERENCED_PARAMETER(InObjType);
+    (void)InObjType;
     return (InVarType == EVT_Interface);
 }
 
@@ -641,8 +643,8 @@ struct SBinaryConstant
     EScalarType Type;
     union
     {
-        BOOL    bValue;
-        INT     iValue;
+        int32_t bValue;         // BOOL
+        int32_t iValue;
         float   fValue;
     };
 };
@@ -12,6 +12,8 @@
 #pragma once
 
 #include "EffectBinaryFormat.h"
+#include "EffectStateCache.h"
+#include "EffectUpload.h"
 #include "IUnknownImp.h"
 
 #ifdef _DEBUG
@@ -594,9 +596,9 @@ struct SD3DShaderVTable
     void ( __stdcall ID3D11DeviceContext::*pSetSamplers)(uint32_t Offset, uint32_t NumSamplers, ID3D11SamplerState*const* pSamplers);
     void ( __stdcall ID3D11DeviceContext::*pSetShaderResources)(uint32_t Offset, uint32_t NumResources, ID3D11ShaderResourceView *const *pResources);
     HRESULT ( __stdcall ID3D11Device::*pCreateShader)(const void *pShaderBlob, size_t ShaderBlobSize, ID3D11ClassLinkage* pClassLinkage, ID3D11DeviceChild **ppShader);
+    uint32_t Stage;
 };
 
-
 struct SShaderBlock
 {
     enum ESigType
@@ -810,7 +812,9 @@ struct SConstantBuffer : public TUncastableVariable<ID3DX11EffectConstantBuffer>
     SGlobalVariable         *pVariables;        // array of size [VariableCount], points into effect's contiguous variable list
     uint32_t                ExplicitBindPoint;  // Used when a CB has been explicitly bound (register(bXX)). -1 if not
 
-    bool                    IsDirty:1;          // Set when any member is updated; cleared on CB apply    
+    SDirtyRange             Dirty;              // Byte range of pBackingStore updated since the last upload,
+                                                // cleared on CB apply
+
     bool                    IsTBuffer:1;        // true iff TBuffer.pShaderResource != nullptr
     bool                    IsUserManaged:1;    // Set if you don't want effects to update this buffer
     bool                    IsEffectOptimized:1;// Set if the effect has been optimized
@@ -818,6 +822,7 @@ struct SConstantBuffer : public TUncastableVariable<ID3DX11EffectConstantBuffer>
     bool                    IsUserPacked:1;     // Set if the elements have user-specified offsets
     bool                    IsSingle:1;         // Set to true if you want to share this CB with cloned Effects
     bool                    IsNonUpdatable:1;   // Set to true if you want to share this CB with cloned Effects
+    bool                    IsDynamic:1;        // Set if the buffer is D3D11_USAGE_DYNAMIC and uploaded with Map/WRITE_DISCARD
 
     union
     {
@@ -839,7 +844,7 @@ struct SConstantBuffer : public TUncastableVariable<ID3DX11EffectConstantBuffer>
         VariableCount(0),
         pVariables(nullptr),
         ExplicitBindPoint(uint32_t(-1)),
-        IsDirty(false),
+        Dirty(),
         IsTBuffer(false),
         IsUserManaged(false),
         IsEffectOptimized(false),
@@ -847,6 +852,7 @@ struct SConstantBuffer : public TUncastableVariable<ID3DX11EffectConstantBuffer>
         IsUserPacked(false),
         IsSingle(false),
         IsNonUpdatable(false),
+        IsDynamic(false),
         pMemberData(nullptr),
         pEffect(nullptr)
     {
@@ -854,6 +860,11 @@ struct SConstantBuffer : public TUncastableVariable<ID3DX11EffectConstantBuffer>
 
     bool ClonedSingle() const;
 
+    // Grows the dirty range to include [Offset, Offset + Count)
+    void MarkDirty(_In_ uint32_t Offset, _In_ uint32_t Count) { Dirty.Mark(Offset, Count); }
+
+    void MarkDirty() { MarkDirty(0, Size); }
+
     // ID3DX11EffectConstantBuffer interface
     STDMETHOD_(bool, IsValid)() override;
     STDMETHOD_(ID3DX11EffectType*, GetType)() override;
@@ -1142,6 +1153,12 @@ protected:
     ID3D11DeviceContext     *m_pContext;
     ID3D11ClassLinkage      *m_pClassLinkage;
 
+    // Set if the driver accepts a box when updating constant buffers (D3D11.1)
+    bool                    m_PartialCBUpdates;
+
+    D3DX11_EFFECT_STATS     m_Stats;
+    SStateCache             m_StateCache;
+
     // Master lists of reflection interfaces
     CEffectVectorOwner<SSingleElementType> m_pTypeInterfaces;
     CEffectVectorOwner<SMember>            m_pMemberInterfaces;
@@ -1175,6 +1192,8 @@ protected:
     //////////////////////////////////////////////////////////////////////////    
     // Runtime (performance critical)
     
+    bool IsFilteringState() const { return (m_Flags & D3DX11_EFFECT_FILTER_REDUNDANT_STATE) != 0; }
+    void CheckAndUpdateCB(_Inout_ SConstantBuffer *pCB);
     void ApplyShaderBlock(_In_ SShaderBlock *pBlock);
     bool ApplyRenderStateBlock(_In_ SBaseBlock *pBlock);
     bool ApplySamplerBlock(_In_ SSamplerBlock *pBlock);
@@ -1257,6 +1276,10 @@ public:
     STDMETHOD(Optimize)() override;
     STDMETHOD_(bool, IsOptimized)() override;
 
+    STDMETHOD(GetStats)(_Out_ D3DX11_EFFECT_STATS *pStats) override;
+    STDMETHOD_(void, ResetStats)() override;
+    STDMETHOD_(void, InvalidateStateCache)() override;
+
     //////////////////////////////////////////////////////////////////////////    
     // New reflection helpers
 
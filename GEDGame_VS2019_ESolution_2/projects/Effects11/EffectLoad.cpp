@@ -12,6 +12,7 @@
 #include "pchfx.h"
 
 #include "EffectStates11.h"
+#include "EffectLoadPlan.h"
 
 #define PRIVATENEW new(m_BulkHeap)
 
@@ -35,12 +36,14 @@ SDepthStencilView g_NullDepthStencilView;
 // 3) SetSamplers
 // 4) SetShaderResources
 // 5) CreateShader
+// 6) Stage (index into the state cache)
 SD3DShaderVTable g_vtPS = {
     (void (__stdcall ID3D11DeviceContext::*)(ID3D11DeviceChild*, ID3D11ClassInstance*const*, uint32_t)) &ID3D11DeviceContext::PSSetShader,
     &ID3D11DeviceContext::PSSetConstantBuffers,
     &ID3D11DeviceContext::PSSetSamplers,
     &ID3D11DeviceContext::PSSetShaderResources,
-    (HRESULT (__stdcall ID3D11Device::*)(const void *, size_t, ID3D11ClassLinkage*, ID3D11DeviceChild **)) &ID3D11Device::CreatePixelShader
+    (HRESULT (__stdcall ID3D11Device::*)(const void *, size_t, ID3D11ClassLinkage*, ID3D11DeviceChild **)) &ID3D11Device::CreatePixelShader,
+    SStateCache::StagePS
 };
 
 SD3DShaderVTable g_vtVS = {
@@ -48,7 +51,8 @@ SD3DShaderVTable g_vtVS = {
     &ID3D11DeviceContext::VSSetConstantBuffers,
     &ID3D11DeviceContext::VSSetSamplers,
     &ID3D11DeviceContext::VSSetShaderResources,
-    (HRESULT (__stdcall ID3D11Device::*)(const void *, size_t, ID3D11ClassLinkage*, ID3D11DeviceChild **)) &ID3D11Device::CreateVertexShader
+    (HRESULT (__stdcall ID3D11Device::*)(const void *, size_t, ID3D11ClassLinkage*, ID3D11DeviceChild **)) &ID3D11Device::CreateVertexShader,
+    SStateCache::StageVS
 };
 
 SD3DShaderVTable g_vtGS = {
@@ -56,7 +60,8 @@ SD3DShaderVTable g_vtGS = {
     &ID3D11DeviceContext::GSSetConstantBuffers,
     &ID3D11DeviceContext::GSSetSamplers,
     &ID3D11DeviceContext::GSSetShaderResources,
-    (HRESULT (__stdcall ID3D11Device::*)(const void *, size_t, ID3D11ClassLinkage*, ID3D11DeviceChild **)) &ID3D11Device::CreateGeometryShader
+    (HRESULT (__stdcall ID3D11Device::*)(const void *, size_t, ID3D11ClassLinkage*, ID3D11DeviceChild **)) &ID3D11Device::CreateGeometryShader,
+    SStateCache::StageGS
 };
 
 SD3DShaderVTable g_vtHS = {
@@ -64,7 +69,8 @@ SD3DShaderVTable g_vtHS = {
     &ID3D11DeviceContext::HSSetConstantBuffers,
     &ID3D11DeviceContext::HSSetSamplers,
     &ID3D11DeviceContext::HSSetShaderResources,
-    (HRESULT (__stdcall ID3D11Device::*)(const void *, size_t, ID3D11ClassLinkage*, ID3D11DeviceChild **)) &ID3D11Device::CreateHullShader
+    (HRESULT (__stdcall ID3D11Device::*)(const void *, size_t, ID3D11ClassLinkage*, ID3D11DeviceChild **)) &ID3D11Device::CreateHullShader,
+    SStateCache::StageHS
 };
 
 SD3DShaderVTable g_vtDS = {
@@ -72,7 +78,8 @@ SD3DShaderVTable g_vtDS = {
     &ID3D11DeviceContext::DSSetConstantBuffers,
     &ID3D11DeviceContext::DSSetSamplers,
     &ID3D11DeviceContext::DSSetShaderResources,
-    (HRESULT (__stdcall ID3D11Device::*)(const void *, size_t, ID3D11ClassLinkage*, ID3D11DeviceChild **)) &ID3D11Device::CreateDomainShader
+    (HRESULT (__stdcall ID3D11Device::*)(const void *, size_t, ID3D11ClassLinkage*, ID3D11DeviceChild **)) &ID3D11Device::CreateDomainShader,
+    SStateCache::StageDS
 };
 
 SD3DShaderVTable g_vtCS = {
@@ -80,7 +87,8 @@ SD3DShaderVTable g_vtCS = {
     &ID3D11DeviceContext::CSSetConstantBuffers,
     &ID3D11DeviceContext::CSSetSamplers,
     &ID3D11DeviceContext::CSSetShaderResources,
-    (HRESULT (__stdcall ID3D11Device::*)(const void *, size_t, ID3D11ClassLinkage*, ID3D11DeviceChild **)) &ID3D11Device::CreateComputeShader
+    (HRESULT (__stdcall ID3D11Device::*)(const void *, size_t, ID3D11ClassLinkage*, ID3D11DeviceChild **)) &ID3D11Device::CreateComputeShader,
+    SStateCache::StageCS
 };
 
 SShaderBlock g_NullVS(&g_vtVS);
@@ -763,24 +771,6 @@ lExit:
     return hr;
 }
 
-static HRESULT GetEffectVersion( _In_ uint32_t effectFileTag, _Out_ DWORD* pVersion )
-{
-    assert( pVersion != nullptr );
-    if( !pVersion )
-        return E_FAIL;
-
-    for( size_t i = 0; i < _countof(g_EffectVersions); i++ )
-    {
-        if( g_EffectVersions[i].m_Tag == effectFileTag )
-        {
-            *pVersion = g_EffectVersions[i].m_Version;
-            return S_OK;
-        }
-    }
-
-    return E_FAIL;
-}
-
 _Use_decl_annotations_
 HRESULT CEffectLoader::LoadEffect(CEffect *pEffect, const void *pEffectBuffer, uint32_t cbEffectBuffer)
 {
@@ -788,6 +778,8 @@ HRESULT CEffectLoader::LoadEffect(CEffect *pEffect, const void *pEffectBuffer, u
     HRESULT hr = S_OK;
     uint32_t  i, varSize, cMemberDataBlocks;
     CCheckedDword chkVariables = 0;
+    SEffectLoadPlan plan;
+    const char *pPlanError = nullptr;
 
     // Used for cloning
     m_pvOldMemberInterfaces = nullptr;
@@ -801,41 +793,37 @@ HRESULT CEffectLoader::LoadEffect(CEffect *pEffect, const void *pEffectBuffer, u
     VN( m_pEffect->m_pReflection = new CEffectReflection() );
     m_pReflection = m_pEffect->m_pReflection;
 
-    // Begin effect load
-    VN( m_pEffect->m_pTypePool = new CEffect::CTypeHashTable );
-    VN( m_pEffect->m_pStringPool = new CEffect::CStringHashTable );
-    VN( m_pEffect->m_pPooledHeap = new CDataBlockStore );
-    m_pEffect->m_pPooledHeap->EnableAlignment();
-    m_pEffect->m_pTypePool->SetPrivateHeap(m_pEffect->m_pPooledHeap);
-    m_pEffect->m_pStringPool->SetPrivateHeap(m_pEffect->m_pPooledHeap);
-
-    VH( m_pEffect->m_pTypePool->AutoGrow() );
-    VH( m_pEffect->m_pStringPool->AutoGrow() );
-
     // Load from blob
     m_pData = (uint8_t*)pEffectBuffer;
     m_dwBufferSize = cbEffectBuffer;
 
+    // Verify the header: version, no pools and sections within the blob
+    pPlanError = PlanEffectLoad(pEffectBuffer, cbEffectBuffer, &plan);
+    if( pPlanError )
+    {
+        DPF(0, "%s", pPlanError);
+        VH( E_FAIL );
+    }
+    m_Version = plan.Version;
+
     VH( m_msStructured.SetData(m_pData, m_dwBufferSize) );
 
     // At this point, we assume that the blob is valid
     VHD( m_msStructured.Read((void**) &m_pHeader, sizeof(*m_pHeader)), "pEffectBuffer is too small." );
 
-    // Verify the version
-    if( FAILED( hr = GetEffectVersion( m_pHeader->Tag, &m_Version ) ) )
-    {
-        DPF(0, "Effect version is unrecognized.  This runtime supports fx_5_0 to %s.", g_EffectVersions[_countof(g_EffectVersions)-1].m_pName );
-        VH( hr );
-    }
+    VH( m_BulkHeap.Reserve(plan.cbBulkHeap) );
 
-    if( m_pHeader->RequiresPool() || m_pHeader->Pool.cObjectVariables > 0 || m_pHeader->Pool.cNumericVariables > 0 )
-    {
-        DPF(0, "Effect11 does not support EffectPools." );
-        VH( E_FAIL );
-    }
+    // Begin effect load
+    VN( m_pEffect->m_pTypePool = new CEffect::CTypeHashTable );
+    VN( m_pEffect->m_pStringPool = new CEffect::CStringHashTable );
+    VN( m_pEffect->m_pPooledHeap = new CDataBlockStore );
+    m_pEffect->m_pPooledHeap->EnableAlignment();
+    VH( m_pEffect->m_pPooledHeap->Reserve(plan.cbPooledHeap) );
+    m_pEffect->m_pTypePool->SetPrivateHeap(m_pEffect->m_pPooledHeap);
+    m_pEffect->m_pStringPool->SetPrivateHeap(m_pEffect->m_pPooledHeap);
 
-    // Get shader block count
-    VBD( m_pHeader->cInlineShaders <= m_pHeader->cTotalShaders, "Invalid Effect header: cInlineShaders > cTotalShaders." );
+    VH( m_pEffect->m_pTypePool->AutoGrow() );
+    VH( m_pEffect->m_pStringPool->AutoGrow() );
 
     // Make sure the counts for the Effect don't overflow
     chkVariables = m_pHeader->Effect.cObjectVariables;
@@ -875,9 +863,8 @@ HRESULT CEffectLoader::LoadEffect(CEffect *pEffect, const void *pEffectBuffer, u
     VN( m_pEffect->m_pRenderTargetViews = PRIVATENEW SRenderTargetView[m_pHeader->cRenderTargetViews] );
     VN( m_pEffect->m_pDepthStencilViews = PRIVATENEW SDepthStencilView[m_pHeader->cDepthStencilViews] );
 
-    uint32_t oStructured = m_pHeader->cbUnstructured + sizeof(SBinaryHeader5);
-    VHD( m_msStructured.Seek(oStructured), "Invalid pEffectBuffer: Missing structured data block." );
-    VH( m_msUnstructured.SetData(m_pData + sizeof(SBinaryHeader5), oStructured - sizeof(SBinaryHeader5)) );
+    VHD( m_msStructured.Seek(plan.oStructured), "Invalid pEffectBuffer: Missing structured data block." );
+    VH( m_msUnstructured.SetData(m_pData + plan.oUnstructured, plan.cbUnstructured) );
 
     VH( LoadCBs() );
     VH( LoadObjectVariables() );
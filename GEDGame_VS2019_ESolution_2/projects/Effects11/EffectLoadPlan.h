@@ -0,0 +1,84 @@
+//--------------------------------------------------------------------------------------
+// File: EffectLoadPlan.h
+//
+// Direct3D 11 Effects header checks of a compiled effect, its sections and the sizes of
+// the heaps reserved to load it. Independent of Direct3D, so it is also tested on its own.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/p/?LinkId=271568
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#include "EffectBinaryFormat.h"
+
+namespace D3DX11Effects
+{
+
+struct SEffectLoadPlan
+{
+    SBinaryHeader5  Header;
+    uint32_t        Version;            // D3DX11_FXL_VERSION
+
+    uint32_t        oUnstructured;      // Strings, types and default values, right after the header
+    uint32_t        cbUnstructured;
+    uint32_t        oStructured;        // Variables, groups and shaders, up to the end of the blob
+    uint32_t        cbStructured;
+
+    // The load-time heaps are sized up front, so each is usually a single allocation instead of a
+    // chain of 8K blocks. The runtime structures are built from the blob, which is mostly shader
+    // bytecode, so its size covers them. Pooled types and strings come from the unstructured block
+    // and unpack to about twice their binary size.
+    uint32_t        cbBulkHeap;
+    uint32_t        cbPooledHeap;
+};
+
+// Checks the header and the section sizes of a compiled effect before the loader reads it. Returns
+// nullptr if it can be loaded, the reason otherwise.
+inline const char *PlanEffectLoad(const void *pEffectBuffer, uint32_t cbEffectBuffer, SEffectLoadPlan *pPlan)
+{
+    if (!pEffectBuffer || cbEffectBuffer < sizeof(SBinaryHeader5))
+        return "pEffectBuffer is too small.";
+
+    SBinaryHeader5 &header = pPlan->Header;
+    memcpy(&header, pEffectBuffer, sizeof(header));
+
+    const EVersionTag *pVersion = nullptr;
+    for (const EVersionTag &version : g_EffectVersions)
+    {
+        if (version.m_Tag == header.Tag)
+            pVersion = &version;
+    }
+    if (!pVersion)
+        return "Effect version is unrecognized.  This runtime supports fx_4_0 to fx_5_0.";
+    pPlan->Version = pVersion->m_Version;
+
+    if (header.RequiresPool())
+        return "Effect11 does not support EffectPools.";
+
+    if (header.cInlineShaders > header.cTotalShaders)
+        return "Invalid Effect header: cInlineShaders > cTotalShaders.";
+
+    // Compared with what follows the header, the sum could overflow
+    if (header.cbUnstructured > cbEffectBuffer - sizeof(SBinaryHeader5))
+        return "Invalid pEffectBuffer: Missing structured data block.";
+
+    pPlan->oUnstructured = sizeof(SBinaryHeader5);
+    pPlan->cbUnstructured = header.cbUnstructured;
+    pPlan->oStructured = pPlan->oUnstructured + pPlan->cbUnstructured;
+    pPlan->cbStructured = cbEffectBuffer - pPlan->oStructured;
+
+    if (header.cbUnstructured > UINT32_MAX / 2)
+        return "Overflow: unstructured data block too large.";
+
+    pPlan->cbBulkHeap = cbEffectBuffer;
+    pPlan->cbPooledHeap = header.cbUnstructured * 2;
+    return nullptr;
+}
+
+}
@@ -719,11 +719,14 @@ CEffect::CEffect( uint32_t Flags ) noexcept :
     m_pDevice(nullptr),
     m_pContext(nullptr),
     m_pClassLinkage(nullptr),
+    m_PartialCBUpdates(false),
+    m_Stats{},
     m_pTypePool(nullptr),
     m_pStringPool(nullptr),
     m_pPooledHeap(nullptr),
     m_pOptimizedTypeHeap(nullptr)
 {
+    m_StateCache.Invalidate();
 }
 
 void CEffect::ReleaseShaderRefection()
@@ -1115,6 +1118,7 @@ HRESULT CEffect::BindToDevice(ID3D11Device *pDevice, LPCSTR srcName)
     }
 
     bool featureLevelGE11 = ( pDevice->GetFeatureLevel() >= D3D_FEATURE_LEVEL_11_0 );
+    bool dynamicCBs = ( (m_Flags & D3DX11_EFFECT_DYNAMIC_CONSTANT_BUFFERS) != 0 );
 
     pDevice->AddRef();
     SAFE_RELEASE(m_pDevice);
@@ -1122,6 +1126,12 @@ HRESULT CEffect::BindToDevice(ID3D11Device *pDevice, LPCSTR srcName)
     VH( m_pDevice->CreateClassLinkage( &m_pClassLinkage ) );
     SetDebugObjectName(m_pClassLinkage,srcName);
 
+    {
+        D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+        m_PartialCBUpdates = SUCCEEDED(pDevice->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options)))
+            && options.ConstantBufferPartialUpdate;
+    }
+
     // Create all constant buffers
     SConstantBuffer *pCB = m_pCBs;
     SConstantBuffer *pCBLast = m_pCBs + m_CBCount;
@@ -1138,9 +1148,9 @@ HRESULT CEffect::BindToDevice(ID3D11Device *pDevice, LPCSTR srcName)
                 D3D11_BUFFER_DESC bufDesc;
                 // size is always register aligned
                 bufDesc.ByteWidth = pCB->Size;
-                bufDesc.Usage = D3D11_USAGE_DEFAULT;
+                bufDesc.Usage = dynamicCBs ? D3D11_USAGE_DYNAMIC : D3D11_USAGE_DEFAULT;
                 bufDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
-                bufDesc.CPUAccessFlags = 0;
+                bufDesc.CPUAccessFlags = dynamicCBs ? D3D11_CPU_ACCESS_WRITE : 0;
                 bufDesc.MiscFlags = 0;
 
                 VH( pDevice->CreateBuffer( &bufDesc, nullptr, &pCB->pD3DObject) );
@@ -1160,9 +1170,9 @@ HRESULT CEffect::BindToDevice(ID3D11Device *pDevice, LPCSTR srcName)
                 D3D11_BUFFER_DESC bufDesc;
                 // size is always register aligned
                 bufDesc.ByteWidth = pCB->Size;
-                bufDesc.Usage = D3D11_USAGE_DEFAULT;
+                bufDesc.Usage = dynamicCBs ? D3D11_USAGE_DYNAMIC : D3D11_USAGE_DEFAULT;
                 bufDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-                bufDesc.CPUAccessFlags = 0;
+                bufDesc.CPUAccessFlags = dynamicCBs ? D3D11_CPU_ACCESS_WRITE : 0;
                 bufDesc.MiscFlags = 0;
 
                 VH( pDevice->CreateBuffer( &bufDesc, nullptr, &pCB->pD3DObject) );
@@ -1170,11 +1180,13 @@ HRESULT CEffect::BindToDevice(ID3D11Device *pDevice, LPCSTR srcName)
                 pCB->TBuffer.pShaderResource = nullptr;
             }
 
-            pCB->IsDirty = true;
+            pCB->IsDynamic = dynamicCBs;
+            pCB->Dirty.IsDirty = false;
+            pCB->MarkDirty();
         }
         else
         {
-            pCB->IsDirty = false;
+            pCB->Dirty.IsDirty = false;
         }
     }
 
@@ -1422,6 +1434,12 @@ HRESULT CEffect::BindToDevice(ID3D11Device *pDevice, LPCSTR srcName)
         }
     }
 
+    // The shaders and states exist now, so the reflection data is only needed for lookups by name
+    if (m_Flags & D3DX11_EFFECT_STRIP_REFLECTION)
+    {
+        VH( Optimize() );
+    }
+
 lExit:
     return hr;
 }
@@ -2004,7 +2022,8 @@ HRESULT CEffect::RecreateCBs()
                 ReplaceCBReference( pCB, (*ppOriginalBuffer) );
             }
 
-            pCB->IsDirty = true;
+            pCB->Dirty.IsDirty = false;
+            pCB->MarkDirty();
         }
     }
 
@@ -2107,6 +2126,7 @@ HRESULT CEffect::CloneEffect(_In_ uint32_t Flags, _Outptr_ ID3DX11Effect** ppClo
     pNewEffect->m_FXLIndex = m_FXLIndex;
     pNewEffect->m_pDevice = m_pDevice;
     pNewEffect->m_pClassLinkage = m_pClassLinkage;
+    pNewEffect->m_PartialCBUpdates = m_PartialCBUpdates;
 
     pNewEffect->AddRefAllForCloning( this );
 
@@ -1148,7 +1148,7 @@ HRESULT SConstantBuffer::SetRawValue(const void *pData, uint32_t Offset, uint32_
     }
     else
     {
-        IsDirty = true;
+        MarkDirty(Offset, Count);
     }
 
     memcpy(pBackingStore + Offset, pData, Count);
@@ -1624,6 +1624,11 @@ HRESULT SPassBlock::Apply(_In_ uint32_t Flags, _In_ ID3D11DeviceContext* pContex
 
     assert( pEffect->m_pContext == nullptr );
     pEffect->m_pContext = pContext;
+    if( pEffect->m_StateCache.pContext != pContext )
+    {
+        pEffect->m_StateCache.Invalidate();
+        pEffect->m_StateCache.pContext = pContext;
+    }
     pEffect->ApplyPassBlock(this);
     pEffect->m_pContext = nullptr;
 
@@ -1950,6 +1955,30 @@ lExit:
     return hr;    
 }
 
+HRESULT CEffect::GetStats(_Out_ D3DX11_EFFECT_STATS *pStats)
+{
+    HRESULT hr = S_OK;
+
+    static LPCSTR pFuncName = "ID3DX11Effect::GetStats";
+
+    VERIFYPARAMETER(pStats);
+
+    *pStats = m_Stats;
+
+lExit:
+    return hr;
+}
+
+void CEffect::ResetStats()
+{
+    m_Stats = {};
+}
+
+void CEffect::InvalidateStateCache()
+{
+    m_StateCache.Invalidate();
+}
+
 ID3DX11EffectConstantBuffer * CEffect::GetConstantBufferByIndex(_In_ uint32_t Index)
 {
     static LPCSTR pFuncName = "ID3DX11Effect::GetConstantBufferByIndex";
@@ -132,15 +132,63 @@ bool SPassBlock::CheckDependencies()
 }
 #pragma warning(pop)
 
-// Update constant buffer contents if necessary
-inline void CheckAndUpdateCB_FX(ID3D11DeviceContext *pContext, SConstantBuffer *pCB)
+static_assert(SType::c_RegisterSize == c_UploadRegisterSize, "Partial uploads must cover whole registers");
+static_assert(SStateCache::c_ResourceSlotCount == D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT, "The state cache must cover every resource slot");
+
+// The uploads of one constant buffer or tbuffer through the effect's context
+class CContextConstantBufferTarget : public IConstantBufferTarget
 {
-    if (pCB->IsDirty && !pCB->IsNonUpdatable)
+public:
+    CContextConstantBufferTarget(_In_ ID3D11DeviceContext *pContext, _In_ ID3D11Buffer *pBuffer) :
+        m_pContext(pContext),
+        m_pBuffer(pBuffer)
+    {
+    }
+
+    void *MapDiscard() override
+    {
+        D3D11_MAPPED_SUBRESOURCE mapped;
+        if (FAILED(m_pContext->Map(m_pBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+            return nullptr;
+        return mapped.pData;
+    }
+
+    void Unmap() override
+    {
+        m_pContext->Unmap(m_pBuffer, 0);
+    }
+
+    void Update(const void *pData, uint32_t Start, uint32_t End, bool Boxed) override
     {
-        // CB out of date; rebuild it
-        pContext->UpdateSubresource(pCB->pD3DObject, 0, nullptr, pCB->pBackingStore, pCB->Size, pCB->Size);
-        pCB->IsDirty = false;
+        D3D11_BOX box = { Start, 0, 0, End, 1, 1 };
+        m_pContext->UpdateSubresource(m_pBuffer, 0, Boxed ? &box : nullptr, pData, End - Start, End - Start);
     }
+
+private:
+    ID3D11DeviceContext *m_pContext;
+    ID3D11Buffer        *m_pBuffer;
+};
+
+// Update constant buffer contents if necessary
+inline void CEffect::CheckAndUpdateCB(SConstantBuffer *pCB)
+{
+    if (!pCB->Dirty.IsDirty || pCB->IsNonUpdatable)
+        return;
+
+    // Only the modified registers are copied when the buffer allows a box. tbuffers always do,
+    // cbuffers need D3D11.1 driver support. Deferred contexts are excluded because of the
+    // runtime's source pointer bug when emulating command lists for boxed updates.
+    bool allowBox = !pCB->IsDynamic && (pCB->IsTBuffer || m_PartialCBUpdates)
+        && m_pContext->GetType() == D3D11_DEVICE_CONTEXT_IMMEDIATE;
+
+    CContextConstantBufferTarget target(m_pContext, pCB->pD3DObject);
+    SConstantBufferUpload upload = UploadConstantBuffer(target, pCB->pBackingStore, pCB->Size, pCB->Dirty, pCB->IsDynamic, allowBox);
+    if (!upload.Uploaded)
+        return;
+
+    m_Stats.ConstantBufferUpdates++;
+    m_Stats.ConstantBufferPartialUpdates += upload.Boxed ? 1 : 0;
+    m_Stats.ConstantBufferBytes += upload.Bytes;
 }
 
 
@@ -162,7 +210,7 @@ void CEffect::ApplyShaderBlock(_In_ SShaderBlock *pBlock)
 
         for (size_t i = 0; i < pCBDep->Count; ++ i)
         {
-            CheckAndUpdateCB_FX(m_pContext, (SConstantBuffer*)pCBDep->ppFXPointers[i]);
+            CheckAndUpdateCB((SConstantBuffer*)pCBDep->ppFXPointers[i]);
         }
 
         (m_pContext->*(pVT->pSetConstantBuffers))(pCBDep->StartIndex, pCBDep->Count, pCBDep->ppD3DObjects);
@@ -210,6 +258,7 @@ void CEffect::ApplyShaderBlock(_In_ SShaderBlock *pBlock)
             // This call could be combined with the call to set render targets if both exist in the pass
             m_pContext->OMSetRenderTargetsAndUnorderedAccessViews( D3D11_KEEP_RENDER_TARGETS_AND_DEPTH_STENCIL, nullptr, nullptr, pUAVDep->StartIndex, pUAVDep->Count, pUAVDep->ppD3DObjects, g_pNegativeOnes );
         }
+        m_StateCache.InvalidateShaderResources();
     }
 
     // TBuffers are funny:
@@ -221,7 +270,7 @@ void CEffect::ApplyShaderBlock(_In_ SShaderBlock *pBlock)
 
     for (; ppTB<ppLastTB; ppTB++)
     {
-        CheckAndUpdateCB_FX(m_pContext, (SConstantBuffer*)*ppTB);
+        CheckAndUpdateCB((SConstantBuffer*)*ppTB);
     }
 
     // Set the textures
@@ -238,7 +287,15 @@ void CEffect::ApplyShaderBlock(_In_ SShaderBlock *pBlock)
             pResourceDep->ppD3DObjects[i] = pResourceDep->ppFXPointers[i]->pShaderResource;
         }
 
+        if (!m_StateCache.SetShaderResources(pVT->Stage, pResourceDep->StartIndex, pResourceDep->Count,
+                reinterpret_cast<const void *const *>(pResourceDep->ppD3DObjects)) && IsFilteringState())
+        {
+            m_Stats.StateCallsFiltered++;
+            continue;
+        }
+
         (m_pContext->*(pVT->pSetShaderResources))(pResourceDep->StartIndex, pResourceDep->Count, pResourceDep->ppD3DObjects);
+        m_Stats.StateCallsIssued++;
     }
 
     // Update Interface dependencies
@@ -271,7 +328,14 @@ void CEffect::ApplyShaderBlock(_In_ SShaderBlock *pBlock)
     }
 
     // Now set the shader
+    if (!m_StateCache.SetShader(pVT->Stage, pBlock->pD3DObject, Interfaces > 0) && IsFilteringState())
+    {
+        m_Stats.StateCallsFiltered++;
+        return;
+    }
+
     (m_pContext->*(pVT->pSetShader))(pBlock->pD3DObject, ppClassInstances, Interfaces);
+    m_Stats.StateCallsIssued++;
 }
 
 // Returns true if the block D3D data was recreated
@@ -536,9 +600,18 @@ void CEffect::ApplyPassBlock(_Inout_ SPassBlock *pBlock)
             DPF( 0, "Pass::Apply - warning: applying invalid BlendState." );
 #endif
         pBlock->BackingStore.pBlendState = pBlock->BackingStore.pBlendBlock->pBlendObject;
-        m_pContext->OMSetBlendState(pBlock->BackingStore.pBlendState,
-            pBlock->BackingStore.BlendFactor,
-            pBlock->BackingStore.SampleMask);
+        if (!m_StateCache.SetBlendState(pBlock->BackingStore.pBlendState, pBlock->BackingStore.BlendFactor,
+                pBlock->BackingStore.SampleMask) && IsFilteringState())
+        {
+            m_Stats.StateCallsFiltered++;
+        }
+        else
+        {
+            m_pContext->OMSetBlendState(pBlock->BackingStore.pBlendState,
+                pBlock->BackingStore.BlendFactor,
+                pBlock->BackingStore.SampleMask);
+            m_Stats.StateCallsIssued++;
+        }
     }
 
     if (nullptr != pBlock->BackingStore.pDepthStencilBlock)
@@ -549,8 +622,17 @@ void CEffect::ApplyPassBlock(_Inout_ SPassBlock *pBlock)
             DPF( 0, "Pass::Apply - warning: applying invalid DepthStencilState." );
 #endif
         pBlock->BackingStore.pDepthStencilState = pBlock->BackingStore.pDepthStencilBlock->pDSObject;
-        m_pContext->OMSetDepthStencilState(pBlock->BackingStore.pDepthStencilState,
-            pBlock->BackingStore.StencilRef);
+        if (!m_StateCache.SetDepthStencilState(pBlock->BackingStore.pDepthStencilState,
+                pBlock->BackingStore.StencilRef) && IsFilteringState())
+        {
+            m_Stats.StateCallsFiltered++;
+        }
+        else
+        {
+            m_pContext->OMSetDepthStencilState(pBlock->BackingStore.pDepthStencilState,
+                pBlock->BackingStore.StencilRef);
+            m_Stats.StateCallsIssued++;
+        }
     }
 
     if (nullptr != pBlock->BackingStore.pRasterizerBlock)
@@ -560,7 +642,16 @@ void CEffect::ApplyPassBlock(_Inout_ SPassBlock *pBlock)
         if( !pBlock->BackingStore.pRasterizerBlock->IsValid )
             DPF( 0, "Pass::Apply - warning: applying invalid RasterizerState." );
 #endif
-        m_pContext->RSSetState(pBlock->BackingStore.pRasterizerBlock->pRasterizerObject);
+        ID3D11RasterizerState *pRasterizerState = pBlock->BackingStore.pRasterizerBlock->pRasterizerObject;
+        if (!m_StateCache.SetRasterizerState(pRasterizerState) && IsFilteringState())
+        {
+            m_Stats.StateCallsFiltered++;
+        }
+        else
+        {
+            m_pContext->RSSetState(pRasterizerState);
+            m_Stats.StateCallsIssued++;
+        }
     }
 
     if (nullptr != pBlock->BackingStore.pRenderTargetViews[0])
@@ -578,6 +669,7 @@ void CEffect::ApplyPassBlock(_Inout_ SPassBlock *pBlock)
 
         // This call could be combined with the call to set PS UAVs if both exist in the pass
         m_pContext->OMSetRenderTargetsAndUnorderedAccessViews( pBlock->BackingStore.RenderTargetViewCount, pRTV, pBlock->BackingStore.pDepthStencilView->pDepthStencilView, 7, D3D11_KEEP_UNORDERED_ACCESS_VIEWS, nullptr, nullptr );
+        m_StateCache.InvalidateShaderResources();
     }
 
     if (nullptr != pBlock->BackingStore.pVertexShaderBlock)
@@ -0,0 +1,118 @@
+//--------------------------------------------------------------------------------------
+// File: EffectStateCache.h
+//
+// Direct3D 11 Effects state cache: the state last set on the context by ApplyPassBlock.
+// Objects are only compared by identity, so it does not depend on Direct3D and is also
+// tested on its own.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/p/?LinkId=271568
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+namespace D3DX11Effects
+{
+
+//////////////////////////////////////////////////////////////////////////
+// SStateCache - the state last set on the context by ApplyPassBlock, used
+// to skip redundant calls when D3DX11_EFFECT_FILTER_REDUNDANT_STATE is set
+//////////////////////////////////////////////////////////////////////////
+
+struct SStateCache
+{
+    enum EStage
+    {
+        StageVS,
+        StageGS,
+        StagePS,
+        StageHS,
+        StageDS,
+        StageCS,
+        StageCount,
+    };
+
+    // D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT
+    static const uint32_t c_ResourceSlotCount = 128;
+
+    const void                  *pContext;          // nullptr when nothing below is known
+
+    const void                  *pBlendState;
+    float                       BlendFactor[4];
+    uint32_t                    SampleMask;
+    const void                  *pDepthStencilState;
+    uint32_t                    StencilRef;
+    const void                  *pRasterizerState;
+
+    const void                  *pShaders[StageCount];
+    const void                  *pShaderResources[StageCount][c_ResourceSlotCount];
+
+    // All bits set never matches a live object (or, for the blend factor, any float),
+    // so everything is set again on the next apply
+    void Invalidate()
+    {
+        memset(this, 0xff, sizeof(*this));
+        pContext = nullptr;
+    }
+
+    // Binding outputs makes the runtime unbind any aliasing shader resources
+    void InvalidateShaderResources()
+    {
+        memset(pShaderResources, 0xff, sizeof(pShaderResources));
+    }
+
+    // The Set functions record a call as made on the context. They return false if it sets
+    // what the context already has, so the call can be skipped.
+
+    bool SetBlendState(const void *pState, const float Factor[4], uint32_t Mask)
+    {
+        if (pBlendState == pState && memcmp(BlendFactor, Factor, sizeof(BlendFactor)) == 0 && SampleMask == Mask)
+            return false;
+        pBlendState = pState;
+        memcpy(BlendFactor, Factor, sizeof(BlendFactor));
+        SampleMask = Mask;
+        return true;
+    }
+
+    bool SetDepthStencilState(const void *pState, uint32_t Ref)
+    {
+        if (pDepthStencilState == pState && StencilRef == Ref)
+            return false;
+        pDepthStencilState = pState;
+        StencilRef = Ref;
+        return true;
+    }
+
+    bool SetRasterizerState(const void *pState)
+    {
+        if (pRasterizerState == pState)
+            return false;
+        pRasterizerState = pState;
+        return true;
+    }
+
+    // Class instances are not cached, so shaders using them are always set
+    bool SetShader(uint32_t Stage, const void *pShader, bool HasClassInstances)
+    {
+        if (!HasClassInstances && pShaders[Stage] == pShader)
+            return false;
+        pShaders[Stage] = HasClassInstances ? reinterpret_cast<const void*>(uintptr_t(-1)) : pShader;
+        return true;
+    }
+
+    bool SetShaderResources(uint32_t Stage, uint32_t StartSlot, uint32_t Count, const void *const *ppViews)
+    {
+        const void **ppCached = pShaderResources[Stage] + StartSlot;
+        if (memcmp(ppCached, ppViews, Count * sizeof(void*)) == 0)
+            return false;
+        memcpy(ppCached, ppViews, Count * sizeof(void*));
+        return true;
+    }
+};
+
+}
@@ -0,0 +1,112 @@
+//--------------------------------------------------------------------------------------
+// File: EffectUpload.h
+//
+// Direct3D 11 Effects constant buffer uploads: the dirty range of a backing store and
+// what is sent to the context for it. Independent of Direct3D, the context is reached
+// through IConstantBufferTarget, so the decisions are also tested on their own.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/p/?LinkId=271568
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+namespace D3DX11Effects
+{
+
+// Partial uploads cover whole registers, SType::c_RegisterSize
+static const uint32_t c_UploadRegisterSize = 16;
+
+// Byte range of a backing store updated since the last upload
+struct SDirtyRange
+{
+    uint32_t    Start;
+    uint32_t    End;        // Start and End are only valid while IsDirty is set
+    bool        IsDirty;
+
+    SDirtyRange() noexcept : Start(0), End(0), IsDirty(false) {}
+
+    // Grows the range to include [Offset, Offset + Count)
+    void Mark(uint32_t Offset, uint32_t Count)
+    {
+        if (IsDirty)
+        {
+            Start = std::min(Start, Offset);
+            End = std::max(End, Offset + Count);
+        }
+        else
+        {
+            Start = Offset;
+            End = Offset + Count;
+            IsDirty = true;
+        }
+    }
+};
+
+// Receives the uploads of one buffer, the effect's device context for the buffer's ID3D11Buffer
+struct IConstantBufferTarget
+{
+    // Map/WRITE_DISCARD, nullptr if the buffer could not be mapped
+    virtual void *MapDiscard() = 0;
+    virtual void Unmap() = 0;
+
+    // UpdateSubresource of [Start, End) from pData, the source of byte Start. With a box unless
+    // that is the whole buffer.
+    virtual void Update(const void *pData, uint32_t Start, uint32_t End, bool Boxed) = 0;
+};
+
+struct SConstantBufferUpload
+{
+    bool        Uploaded;   // false if nothing was sent, the buffer is still dirty if the map failed
+    bool        Boxed;
+    uint32_t    Bytes;
+};
+
+// Sends the dirty part of a backing store of Size bytes and clears its range. Dynamic buffers are
+// mapped with DISCARD, which hands back fresh memory, so they are always rewritten whole. Others
+// get the modified registers with a box if AllowBox is set, the whole buffer otherwise.
+inline SConstantBufferUpload UploadConstantBuffer(IConstantBufferTarget &Target, const uint8_t *pBackingStore,
+                                                  uint32_t Size, SDirtyRange &Dirty, bool IsDynamic, bool AllowBox)
+{
+    SConstantBufferUpload upload = { false, false, 0 };
+    if (!Dirty.IsDirty)
+        return upload;
+
+    if (IsDynamic)
+    {
+        void *pMapped = Target.MapDiscard();
+        if (!pMapped)
+            return upload;
+        memcpy(pMapped, pBackingStore, Size);
+        Target.Unmap();
+        upload.Bytes = Size;
+    }
+    else
+    {
+        uint32_t start = Dirty.Start & ~(c_UploadRegisterSize - 1);
+        uint32_t end = std::min((Dirty.End + c_UploadRegisterSize - 1) & ~(c_UploadRegisterSize - 1), Size);
+        if ((start > 0 || end < Size) && AllowBox)
+        {
+            Target.Update(pBackingStore + start, start, end, true);
+            upload.Boxed = true;
+            upload.Bytes = end - start;
+        }
+        else
+        {
+            Target.Update(pBackingStore, 0, Size, false);
+            upload.Bytes = Size;
+        }
+    }
+
+    upload.Uploaded = true;
+    Dirty.IsDirty = false;
+    return upload;
+}
+
+}
@@ -1472,7 +1472,7 @@ lExit:
     {
         assert(pCB != 0);
         _Analysis_assume_(pCB != 0);
-        pCB->IsDirty = true;
+        pCB->MarkDirty((uint32_t)(Data.pNumeric - pCB->pBackingStore), pType->TotalSize);
         LastModifiedTime = pEffect->GetCurrentTime();
     }
 
@@ -198,6 +198,22 @@ lExit:
     return hr;
 }
 
+_Use_decl_annotations_
+HRESULT CDataBlock::Reserve(uint32_t bufferSize)
+{
+    HRESULT hr = S_OK;
+
+    if (m_maxSize == 0)
+    {
+        m_maxSize = std::max<uint32_t>(8192, AlignToPowerOf2(bufferSize, c_DataAlignment));
+
+        VN( m_pData = new uint8_t[m_maxSize] );
+    }
+
+lExit:
+    return hr;
+}
+
 _Use_decl_annotations_
 void* CDataBlock::Allocate(uint32_t bufferSize, CDataBlock **ppBlock)
 {
@@ -364,6 +380,27 @@ uint32_t CDataBlockStore::GetSize()
     return m_Size;
 }
 
+_Use_decl_annotations_
+HRESULT CDataBlockStore::Reserve(uint32_t bufferSize)
+{
+    HRESULT hr = S_OK;
+
+    if (!m_pFirst)
+    {
+        VN( m_pFirst = new CDataBlock() );
+        if (m_IsAligned)
+        {
+            m_pFirst->EnableAlignment();
+        }
+        m_pLast = m_pFirst;
+    }
+
+    VH( m_pFirst->Reserve(bufferSize) );
+
+lExit:
+    return hr;
+}
+
 
 //////////////////////////////////////////////////////////////////////////
 
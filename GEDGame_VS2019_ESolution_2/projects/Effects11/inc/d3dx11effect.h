@@ -106,7 +106,24 @@ struct D3DX11_STATE_BLOCK_MASK
 // These flags are passed in when creating an effect, and affect
 // the runtime effect behavior:
 //
-// (Currently none)
+// D3DX11_EFFECT_DYNAMIC_CONSTANT_BUFFERS
+//   Create constant buffers and tbuffers with D3D11_USAGE_DYNAMIC and
+//   upload them with Map/D3D11_MAP_WRITE_DISCARD instead of
+//   UpdateSubresource. Useful when the same buffers are rewritten between
+//   many draws each frame.
+//
+// D3DX11_EFFECT_FILTER_REDUNDANT_STATE
+//   Remember the shaders, shader resources and blend, depth stencil and
+//   rasterizer states set by Apply() and skip setting them again while they
+//   are unchanged. The effect assumes it is the only one changing that state
+//   on the context; call ID3DX11Effect::InvalidateStateCache() after any
+//   other code (including binding render targets) did.
+//
+// D3DX11_EFFECT_STRIP_REFLECTION
+//   Call Optimize() as soon as the effect is created, freeing its names,
+//   annotations and type information. Variables, techniques and passes can
+//   then only be retrieved by index. Use Optimize() directly instead when
+//   they are looked up by name once after creation.
 //
 //
 // These flags are set by the effect runtime:
@@ -126,9 +143,13 @@ struct D3DX11_STATE_BLOCK_MASK
 
 #define D3DX11_EFFECT_OPTIMIZED                         (1 << 21)
 #define D3DX11_EFFECT_CLONE                             (1 << 22)
+#define D3DX11_EFFECT_DYNAMIC_CONSTANT_BUFFERS          (1 << 23)
+#define D3DX11_EFFECT_FILTER_REDUNDANT_STATE            (1 << 24)
+#define D3DX11_EFFECT_STRIP_REFLECTION                  (1 << 25)
 
 // Mask of valid D3DCOMPILE_EFFECT flags for D3DX11CreateEffect*
-#define D3DX11_EFFECT_RUNTIME_VALID_FLAGS (0)
+#define D3DX11_EFFECT_RUNTIME_VALID_FLAGS (D3DX11_EFFECT_DYNAMIC_CONSTANT_BUFFERS | D3DX11_EFFECT_FILTER_REDUNDANT_STATE | \
+                                           D3DX11_EFFECT_STRIP_REFLECTION)
 
 //----------------------------------------------------------------------------
 // D3DX11_EFFECT_VARIABLE flags:
@@ -997,6 +1018,22 @@ struct D3DX11_EFFECT_DESC
     uint32_t    Groups;                 // Number of groups in this effect
 };
 
+//----------------------------------------------------------------------------
+// D3DX11_EFFECT_STATS:
+//
+// Retrieved by ID3DX11Effect::GetStats(), counts the work done by
+// Apply() since the last call to ID3DX11Effect::ResetStats()
+//----------------------------------------------------------------------------
+
+struct D3DX11_EFFECT_STATS
+{
+    uint32_t    ConstantBufferUpdates;          // Number of constant buffer and tbuffer uploads
+    uint32_t    ConstantBufferPartialUpdates;   // Number of uploads which only copied the modified range
+    uint64_t    ConstantBufferBytes;            // Bytes copied by those uploads
+    uint32_t    StateCallsIssued;               // Shader, shader resource and render state calls made
+    uint32_t    StateCallsFiltered;             // Calls skipped because the state was already set
+};
+
 typedef interface ID3DX11Effect ID3DX11Effect;
 typedef interface ID3DX11Effect *LPD3D11EFFECT;
 
@@ -1036,6 +1073,10 @@ DECLARE_INTERFACE_(ID3DX11Effect, IUnknown)
     STDMETHOD(CloneEffect)(THIS_ _In_ uint32_t Flags, _Outptr_ ID3DX11Effect** ppClonedEffect ) PURE;
     STDMETHOD(Optimize)(THIS) PURE;
     STDMETHOD_(bool, IsOptimized)(THIS) PURE;
+
+    STDMETHOD(GetStats)(THIS_ _Out_ D3DX11_EFFECT_STATS *pStats) PURE;
+    STDMETHOD_(void, ResetStats)(THIS) PURE;
+    STDMETHOD_(void, InvalidateStateCache)(THIS) PURE;
 };
 
 //////////////////////////////////////////////////////////////////////////////
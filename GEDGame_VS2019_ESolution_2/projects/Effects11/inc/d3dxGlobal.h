@@ -580,6 +580,9 @@ public:
     _Success_(return != nullptr)
     void*   Allocate(_In_ uint32_t bufferSize, _Outptr_ CDataBlock **ppBlock);
 
+    // Reserve sizes the block's buffer before the first AddData or Allocate
+    HRESULT Reserve(_In_ uint32_t bufferSize);
+
     void    EnableAlignment();
 
     CDataBlock() noexcept;
@@ -615,6 +618,9 @@ public:
     uint32_t GetSize();
     void    EnableAlignment();
 
+    HRESULT Reserve(_In_ uint32_t bufferSize);
+        // Sizes the first block so that bufferSize bytes fit into a single allocation
+
     CDataBlockStore() noexcept;
     ~CDataBlockStore();
 };
@@ -1,10 +1,21 @@
-Texture2DArray g_Sprites[4];
+// Frames of all sprites, packed by "texassemble sprites"
+Texture2DArray g_Sprites;
+
+// Placement of every frame in g_Sprites: u, v and size as fractions of a slice, and the slice
+Buffer<float4> g_SpriteFrames;
 
 cbuffer cbChangesEveryFrame
 {
     matrix g_ViewProjection;
     float3 g_CameraRight;
     float3 g_CameraUp;
+    float g_Time;
+}
+
+cbuffer cbSprites
+{
+    // First frame, frame count and frames per second per sprite (SpriteRenderer::kMaxSprites)
+    float4 g_Flipbooks[64];
 }
 
 // IO structs
@@ -13,17 +24,15 @@ struct SpriteVertex
 {
     float3 pos : POSITION;
     float radius : RADIUS;
-    int tex_index : TEX_INDEX;
-    float time : TIME;
+    float start : START;
+    uint flipbook : FLIPBOOK;
     float alpha : ALPHA;
 };
 
 struct SpriteFragment
 {
     float4 pos : SV_Position;
-    float2 uv : TEXCOORD0;
-    int tex_index : TEX_INDEX;
-    float time : TIME;
+    float3 uv : TEXCOORD0;
     float alpha : ALPHA;
 };
 
@@ -32,8 +41,8 @@ struct SpriteFragment
 SamplerState samAnisotropic
 {
     Filter = ANISOTROPIC;
-    AddressU = Wrap;
-    AddressV = Wrap;
+    AddressU = Clamp;
+    AddressV = Clamp;
 };
 
 RasterizerState rsCullNone
@@ -67,50 +76,38 @@ SpriteVertex SpriteVS(in SpriteVertex vertex)
 [maxvertexcount(4)]
 void SpriteGS(point SpriteVertex vertex[1], inout TriangleStream<SpriteFragment> stream)
 {
+    // Pick the frame once per sprite, flipbooks stop at their last frame
+    float4 flipbook = g_Flipbooks[vertex[0].flipbook];
+    float frame = clamp(floor((g_Time - vertex[0].start) * flipbook.z), 0, flipbook.y - 1);
+    float4 cell = g_SpriteFrames.Load(int(flipbook.x + frame));
+
     SpriteFragment sf;
-    sf.tex_index = vertex[0].tex_index;
-    sf.time = vertex[0].time;
     sf.alpha = vertex[0].alpha;
     
     // Upper left
     sf.pos = mul(float4(vertex[0].pos + (-g_CameraRight + g_CameraUp) * vertex[0].radius, 1), g_ViewProjection);
-    sf.uv = float2(0, 0);
+    sf.uv = float3(cell.xy, cell.w);
     stream.Append(sf);
     
     // Upper right
     sf.pos = mul(float4(vertex[0].pos + (g_CameraRight + g_CameraUp) * vertex[0].radius, 1), g_ViewProjection);
-    sf.uv = float2(1,0);
+    sf.uv = float3(cell.xy + float2(cell.z, 0), cell.w);
     stream.Append(sf);
     
     // Lower left
     sf.pos = mul(float4(vertex[0].pos + (-g_CameraRight - g_CameraUp) * vertex[0].radius, 1), g_ViewProjection);
-    sf.uv = float2(0, 1);
+    sf.uv = float3(cell.xy + float2(0, cell.z), cell.w);
     stream.Append(sf);
     
     // Lower right
     sf.pos = mul(float4(vertex[0].pos + (g_CameraRight - g_CameraUp) * vertex[0].radius, 1), g_ViewProjection);
-    sf.uv = float2(1, 1);
+    sf.uv = float3(cell.xy + cell.zz, cell.w);
     stream.Append(sf);
 }
 
-#define TEXTURE_LOOKUP(n) \
-    case n: \
-        g_Sprites[n].GetDimensions(dims.x, dims.y, dims.z);\
-        output = g_Sprites[n].Sample(samAnisotropic, float3(sf.uv, int(dims.z * sf.time))); \
-        break;
-
 float4 SpritePS(SpriteFragment sf) : SV_Target0
 {   
-    float4 output = float4(1,1,0,1);
-    int3 dims = int3(0, 0, 0);
-    
-    switch (sf.tex_index)
-    {
-        TEXTURE_LOOKUP(0);
-        TEXTURE_LOOKUP(1);
-        TEXTURE_LOOKUP(2);
-        TEXTURE_LOOKUP(3);
-    }
+    float4 output = g_Sprites.Sample(samAnisotropic, sf.uv);
     
     output.a *= sf.alpha;
     return output;
@@ -36,6 +36,8 @@ cbuffer cbChangesEveryFrame
     matrix g_LightWorldViewProjection;
     matrix g_WorldNormals;
     float4 g_cameraPosWorld;
+    float4 g_PositionMin; // Dequantization of version 2 t3d positions
+    float4 g_PositionScale;
     float g_Time;
 };
 
@@ -68,6 +70,13 @@ struct T3dVertexVSIn
     float3 Tan : TANGENT; //Tangent in object space (not used in Ass. 5) 
 };
 	
+struct T3dQuantizedVertexVSIn
+{
+    float4 Pos : POSITION; //Position relative to the mesh bounds (unorm)
+    float2 Tex : TEXCOORD; //Texture coordinate (half)
+    float4 NorTan : NORMAL; //Octahedral normal (xy) and tangent (zw) in object space (snorm)
+};
+
 struct T3dVertexPSIn
 {
     float4 Pos : SV_POSITION; //Position in clip space     
@@ -165,6 +174,24 @@ inline float shadowing(float3 lightPos)
     return g_ShadowMap.SampleCmpLevelZero(ShadowSampler, shadow_coord.xy, shadow_coord.z - shadow_bias).r;
 }
 
+inline float3 octDecode(float2 e)
+{
+    float3 v = float3(e, 1.0f - abs(e.x) - abs(e.y));
+    if (v.z < 0)
+        v.xy = (1.0f - abs(v.yx)) * (v.xy >= 0 ? 1.0f : -1.0f);
+    return normalize(v);
+}
+
+inline T3dVertexVSIn decodeQuantized(T3dQuantizedVertexVSIn input)
+{
+    T3dVertexVSIn output;
+    output.Pos = g_PositionMin.xyz + input.Pos.xyz * g_PositionScale.xyz;
+    output.Tex = input.Tex;
+    output.Nor = octDecode(input.NorTan.xy);
+    output.Tan = octDecode(input.NorTan.zw);
+    return output;
+}
+
 //--------------------------------------------------------------------------------------
 // Shaders
 //--------------------------------------------------------------------------------------
@@ -246,6 +273,16 @@ T3dVertexPSIn MeshVS(T3dVertexVSIn input)
     return output;
 }
 
+float4 MeshQuantizedVSPrimitive(T3dQuantizedVertexVSIn input) : SV_Position
+{
+    return MeshVSPrimitive(decodeQuantized(input));
+}
+
+T3dVertexPSIn MeshQuantizedVS(T3dQuantizedVertexVSIn input)
+{
+    return MeshVS(decodeQuantized(input));
+}
+
 float4 MeshPS(T3dVertexPSIn input) : SV_Target0
 {
     float3 n = normalize(input.NorWorld);
@@ -348,6 +385,28 @@ technique11 Render
         SetBlendState(NoBlending, float4(0.0f, 0.0f, 0.0f, 0.0f), 0xFFFFFFFF);
     }
 
+    pass P1_Mesh_Quantized
+    {
+        SetVertexShader(CompileShader(vs_4_0, MeshQuantizedVS()));
+        SetGeometryShader(NULL);
+        SetPixelShader(CompileShader(ps_4_0, MeshPS()));
+        
+        SetRasterizerState(rsCullBack);
+        SetDepthStencilState(EnableDepth, 0);
+        SetBlendState(NoBlending, float4(0.0f, 0.0f, 0.0f, 0.0f), 0xFFFFFFFF);
+    }
+
+    pass P1_Mesh_Quantized_Shadow
+    {
+        SetVertexShader(CompileShader(vs_4_0, MeshQuantizedVSPrimitive()));
+        SetGeometryShader(NULL);
+        SetPixelShader(NULL);
+        
+        SetRasterizerState(rsCullBack);
+        SetDepthStencilState(EnableDepth, 0);
+        SetBlendState(NoBlending, float4(0.0f, 0.0f, 0.0f, 0.0f), 0xFFFFFFFF);
+    }
+
     pass P2_Debug
     {
         SetVertexShader(CompileShader(vs_4_0, FullscreenVS()));
@@ -0,0 +1,87 @@
+#include "CommandRecorder.h"
+
+#include <cassert>
+
+
+CommandRecorder::CommandRecorder()
+	: tasks(nullptr), immediateContext(nullptr)
+{
+}
+
+CommandRecorder::~CommandRecorder()
+{
+	destroy();
+}
+
+HRESULT CommandRecorder::create(ID3D11Device* device, size_t contextCount)
+{
+	HRESULT hr;
+
+	destroy();
+
+	for (size_t i = 0; i < contextCount; i++)
+	{
+		ID3D11DeviceContext* context = nullptr;
+		hr = device->CreateDeferredContext(0, &context);
+		if (FAILED(hr))
+		{
+			destroy();
+			return hr;
+		}
+		contexts.push_back(context);
+	}
+	commandLists.resize(contextCount, nullptr);
+	results.resize(contextCount, S_OK);
+
+	scheduler.start(this, contextCount);
+
+	return S_OK;
+}
+
+void CommandRecorder::destroy()
+{
+	scheduler.stop();
+
+	for (auto& commandList : commandLists)
+		SAFE_RELEASE(commandList);
+	commandLists.clear();
+	for (auto& context : contexts)
+		SAFE_RELEASE(context);
+	contexts.clear();
+	results.clear();
+}
+
+HRESULT CommandRecorder::execute(ID3D11DeviceContext* immediateContext, const std::vector<Task>& tasks)
+{
+	assert(!tasks.empty() && tasks.size() <= contexts.size());
+
+	this->tasks = &tasks;
+	this->immediateContext = immediateContext;
+	bool succeeded = scheduler.run(tasks.size());
+	this->tasks = nullptr;
+	this->immediateContext = nullptr;
+
+	if (succeeded)
+		return S_OK;
+	for (size_t i = 0; i < tasks.size(); i++)
+		if (FAILED(results[i]))
+			return results[i];
+	return E_FAIL;
+}
+
+bool CommandRecorder::record(size_t index)
+{
+	ID3D11DeviceContext* context = contexts[index];
+	(*tasks)[index](context);
+
+	// Do not carry the state over, the next frame starts from the default state again
+	results[index] = context->FinishCommandList(FALSE, &commandLists[index]);
+	return SUCCEEDED(results[index]);
+}
+
+void CommandRecorder::submit(size_t index, bool execute)
+{
+	if (execute)
+		immediateContext->ExecuteCommandList(commandLists[index], FALSE);
+	SAFE_RELEASE(commandLists[index]);
+}
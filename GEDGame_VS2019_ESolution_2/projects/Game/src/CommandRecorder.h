@@ -0,0 +1,58 @@
+#pragma once
+
+#include <DXUT.h>
+
+#include <functional>
+#include <vector>
+
+#include "CommandScheduler.h"
+
+
+// Records the parts of a frame in parallel, each on its own deferred context, and executes the
+// resulting command lists in their original order on the immediate context. The calling thread
+// records the last task itself, the others are recorded by worker threads which live as long as
+// the recorder. Tasks run concurrently, so they must not share effects or any other state that
+// is modified while recording.
+class CommandRecorder : private CommandScheduler::Context
+{
+public:
+	typedef std::function<void(ID3D11DeviceContext* context)> Task;
+
+	CommandRecorder();
+	~CommandRecorder();
+	CommandRecorder(const CommandRecorder&) = delete;
+	void operator=(const CommandRecorder&) = delete;
+
+	// Creates one deferred context per task of a frame. Fails if the device does not
+	// support deferred contexts (e.g. a single threaded device), the recorder stays empty then.
+	HRESULT create(ID3D11Device* device, size_t contextCount);
+
+	// Waits for the worker threads and releases the deferred contexts
+	void destroy();
+
+	// The maximum number of tasks per frame, 0 if the recorder was not created
+	size_t getContextCount() const { return contexts.size(); }
+
+	// Records the tasks and executes them in order. Deferred contexts start from the default
+	// state, so every task has to bind its render targets and viewports itself. The immediate
+	// context is left in the default state as well. If any task fails to record, nothing is executed.
+	HRESULT execute(ID3D11DeviceContext* immediateContext, const std::vector<Task>& tasks);
+
+private:
+	// Runs task index on its deferred context and closes the command list
+	bool record(size_t index) override;
+
+	// Executes the command list of task index on immediateContext and releases it
+	void submit(size_t index, bool execute) override;
+
+	CommandScheduler scheduler;
+	std::vector<ID3D11DeviceContext*> contexts;
+	std::vector<ID3D11CommandList*> commandLists;
+	std::vector<HRESULT> results;
+
+	// Only set during execute()
+	const std::vector<Task>* tasks;
+	ID3D11DeviceContext* immediateContext;
+};
+
+extern CommandRecorder g_commandRecorder;
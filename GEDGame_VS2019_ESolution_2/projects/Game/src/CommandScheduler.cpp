@@ -0,0 +1,110 @@
+#include "CommandScheduler.h"
+
+#include <cassert>
+#include <string>
+
+#include "Profiler.h"
+
+
+CommandScheduler::CommandScheduler()
+	: context(nullptr), maxTaskCount(0), frame(0), taskCount(0), remaining(0), stopping(false)
+{
+}
+
+CommandScheduler::~CommandScheduler()
+{
+	stop();
+}
+
+void CommandScheduler::start(Context* context, size_t taskCount)
+{
+	stop();
+
+	this->context = context;
+	maxTaskCount = taskCount;
+	results.assign(taskCount, true);
+	this->taskCount = 0;
+
+	// The last task is recorded by the calling thread
+	stopping = false;
+	for (size_t i = 0; i + 1 < taskCount; i++)
+		threads.emplace_back(&CommandScheduler::workerThread, this, i);
+}
+
+void CommandScheduler::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	frameStarted.notify_all();
+	for (auto& thread : threads)
+		thread.join();
+	threads.clear();
+
+	context = nullptr;
+	maxTaskCount = 0;
+	results.clear();
+}
+
+bool CommandScheduler::run(size_t taskCount)
+{
+	assert(taskCount > 0 && taskCount <= maxTaskCount);
+
+	// Start the workers on all tasks but the last one. A worker without a task in this frame
+	// may only wake up after run() returned, so it must read the count of the frame it sees
+	// under the mutex instead of anything that is only valid during run().
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		this->taskCount = taskCount;
+		remaining = taskCount - 1;
+		frame++;
+	}
+	frameStarted.notify_all();
+
+	results[taskCount - 1] = context->record(taskCount - 1);
+
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		frameRecorded.wait(lock, [this] { return remaining == 0; });
+	}
+
+	bool succeeded = true;
+	for (size_t i = 0; i < taskCount; i++)
+		succeeded = succeeded && results[i];
+
+	// Submitting in task order keeps the dependencies between them, e.g. shadow map before its use
+	for (size_t i = 0; i < taskCount; i++)
+		context->submit(i, succeeded);
+
+	return succeeded;
+}
+
+void CommandScheduler::workerThread(size_t index)
+{
+	g_profiler.setThreadName("Command recorder " + std::to_string(index));
+
+	uint64_t recordedFrame = 0;
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			frameStarted.wait(lock, [&] { return stopping || frame != recordedFrame; });
+			if (stopping)
+				return;
+			recordedFrame = frame;
+
+			// Fewer tasks than threads in this frame
+			if (index + 1 >= taskCount)
+				continue;
+		}
+
+		results[index] = context->record(index);
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			remaining--;
+		}
+		frameRecorded.notify_one();
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+// The threading of CommandRecorder without D3D11: runs the tasks of a frame on persistent worker
+// threads, the last one on the calling thread, and submits the results in task order once all of
+// them are recorded. What recording and submitting means is up to the Context, so the scheduling
+// can be tested with a fake one.
+class CommandScheduler
+{
+public:
+	class Context
+	{
+	public:
+		virtual ~Context() {}
+
+		// Records task index, false if it failed. Called concurrently with different indices.
+		virtual bool record(size_t index) = 0;
+
+		// Called for every task in order on the calling thread after all tasks are recorded.
+		// execute is false if any task of the frame failed, the result is only released then.
+		virtual void submit(size_t index, bool execute) = 0;
+	};
+
+	CommandScheduler();
+	~CommandScheduler();
+	CommandScheduler(const CommandScheduler&) = delete;
+	void operator=(const CommandScheduler&) = delete;
+
+	// Starts the worker threads for up to taskCount tasks per frame
+	void start(Context* context, size_t taskCount);
+
+	// Waits for the worker threads, does nothing if they are not running
+	void stop();
+
+	// The maximum number of tasks per frame, 0 if not started
+	size_t getMaxTaskCount() const { return maxTaskCount; }
+
+	// Records taskCount (1 to getMaxTaskCount()) tasks and submits them in order.
+	// Returns false if any of them failed.
+	bool run(size_t taskCount);
+
+private:
+	void workerThread(size_t index);
+
+	Context* context;
+	size_t maxTaskCount;
+	std::vector<char> results;  // not vector<bool>, the workers write them concurrently
+
+	std::vector<std::thread> threads;
+	std::mutex mutex;
+	std::condition_variable frameStarted;
+	std::condition_variable frameRecorded;
+	uint64_t frame;
+	size_t taskCount;   // of the current frame, only read under the mutex
+	size_t remaining;
+	bool stopping;
+};
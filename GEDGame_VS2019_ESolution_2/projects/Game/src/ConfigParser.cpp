@@ -3,6 +3,7 @@
 
 #include <fstream>
 #include <iostream>
+#include <limits>
 
 #ifndef _DEBUG // works in VS
 #define DEBUGLOAD(number, items) 
@@ -58,8 +59,17 @@ bool ConfigParser::load(std::string filename)
 		// Explosion
 		else if (key == "Explosion") explosion = ExplosionOnDisk::from_file(configfile);
 
+		// Sprites
+		else if (key == "Sprites") sprites = SpritesOnDisk::from_file(configfile);
+
 		// Shadows
 		else if (key == "Shadow") shadows = Shadows::from_file(configfile);
+
+		// Texture streaming
+		else if (key == "TextureStreaming") textureStreaming = TextureStreaming::from_file(configfile);
+
+		// Rendering
+		else if (key == "Rendering") rendering = Rendering::from_file(configfile);
 	}
 
 	DEBUGLOAD(meshes.size(), "Meshes");
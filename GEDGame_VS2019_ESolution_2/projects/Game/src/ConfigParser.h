@@ -74,11 +74,11 @@ public:
 			ObjectOnDisk object;
 			
 		    file >> object.identifier;
-		    file >> object.parentIdentifier;
 		    file >> object.meshIdentifier;
 		    file >> object.pos_x >> object.pos_y >> object.pos_z;
 		    file >> object.rot_x >> object.rot_y >> object.rot_z;
 		    file >> object.scale;
+		    file >> object.parentIdentifier;
 
             return object;
 		}
@@ -99,9 +99,9 @@ public:
 			EnemyOnDisk enemy;
 			
 		    file >> enemy.identifier;
-		    file >> enemy.meshIdentifier;
 		    file >> enemy.hp;
 		    file >> enemy.speed >> enemy.size;
+		    file >> enemy.meshIdentifier;
             file >> enemy.pos_x >> enemy.pos_y >> enemy.pos_z;
             file >> enemy.rot_x >> enemy.rot_y >> enemy.rot_z;
             file >> enemy.scale;
@@ -146,11 +146,11 @@ public:
 		{
 			WeaponOnDisk weapon;
 			
-		    file >> weapon.parentIdentifier;
 		    file >> weapon.meshIdentifer;
-		    file >> weapon.projectile_identifier;
-		    file >> weapon.spawnpoint_x >> weapon.spawnpoint_y >> weapon.spawnpoint_z;
 		    file >> weapon.firerate;
+		    file >> weapon.spawnpoint_x >> weapon.spawnpoint_y >> weapon.spawnpoint_z;
+		    file >> weapon.parentIdentifier;
+		    file >> weapon.projectile_identifier;
 
             return weapon;
 		}
@@ -163,7 +163,7 @@ public:
 		float projectileSpeed = 1;
 		float spriteSize = 1;
 		bool gravity = true;
-		std::string spritePath;
+		std::string spriteName;
 
         static ProjectileOnDisk from_file(std::ifstream& file)
 		{
@@ -172,11 +172,9 @@ public:
             file >> projectile.identifier;
             file >> projectile.damage;
             file >> projectile.projectileSpeed;
-            file >> projectile.spriteSize;
             file >> projectile.gravity;
-            file >> projectile.spritePath;
-
-			projectile.spritePath = res_path(projectile.spritePath);
+            file >> projectile.spriteName;
+            file >> projectile.spriteSize;
 
             return projectile;
         }
@@ -186,7 +184,7 @@ public:
 	{
 		float scale = 1;
 		float duration = 1;
-		std::string spritePath;
+		std::string spriteName;
 
 		int particle_count = 0;
 		float particle_min_velocity = 0;
@@ -198,21 +196,35 @@ public:
 		{
 			ExplosionOnDisk explosion;
         	
-            file >> explosion.scale;
+            file >> explosion.spriteName;
             file >> explosion.duration;
-            file >> explosion.spritePath;
+            file >> explosion.scale;
             file >> explosion.particle_count;
             file >> explosion.particle_min_velocity;
             file >> explosion.particle_max_velocity;
             file >> explosion.particle_min_lifetime;
             file >> explosion.particle_max_lifetime;
 
-			explosion.spritePath = res_path(explosion.spritePath);
-
             return explosion;
         }
 	};
 
+	struct SpritesOnDisk
+	{
+		std::string atlasPath = res_path("sprites.dds");
+
+		static SpritesOnDisk from_file(std::ifstream& file)
+		{
+			SpritesOnDisk sprites;
+
+			file >> sprites.atlasPath;
+
+			sprites.atlasPath = res_path(sprites.atlasPath);
+
+			return sprites;
+		}
+	};
+
 	struct Shadows
 	{
 		bool use = false;
@@ -230,6 +242,36 @@ public:
 		}
 	};
 
+	struct TextureStreaming
+	{
+		int budget = 256;        // MB
+		int resident_size = 128; // texels of the largest always resident mip
+		int threads = 2;
+
+		static TextureStreaming from_file(std::ifstream& file)
+		{
+			TextureStreaming streaming;
+
+			file >> streaming.budget >> streaming.resident_size >> streaming.threads;
+
+			return streaming;
+		}
+	};
+
+	struct Rendering
+	{
+		bool multithreaded = true; // record the shadow and the main pass on deferred contexts
+
+		static Rendering from_file(std::ifstream& file)
+		{
+			Rendering rendering;
+
+			file >> rendering.multithreaded;
+
+			return rendering;
+		}
+	};
+
 	// returns true on success, false on failure
 	bool load(std::string filename);
 
@@ -242,7 +284,10 @@ public:
 	const TerrainOnDisk& get_terrain() const { return terrain; }
 	const SpawnBehaviour& get_SpawnBehaviour() const { return spawnBehaviour; }
 	const ExplosionOnDisk& get_Explosion() const { return explosion; }
+	const SpritesOnDisk& get_Sprites() const { return sprites; }
 	const Shadows& get_Shadows() const { return shadows; }
+	const TextureStreaming& get_TextureStreaming() const { return textureStreaming; }
+	const Rendering& get_Rendering() const { return rendering; }
 
 private:
     static constexpr auto data_path = "resources/";
@@ -256,7 +301,10 @@ private:
 	TerrainOnDisk terrain;
 	SpawnBehaviour spawnBehaviour;
 	ExplosionOnDisk explosion;
+	SpritesOnDisk sprites;
 	Shadows shadows;
+	TextureStreaming textureStreaming;
+	Rendering rendering;
 
 	static std::string res_path(std::string path)
 	{
@@ -0,0 +1,55 @@
+#include "EffectPool.h"
+
+EffectPool::~EffectPool()
+{
+	clear();
+}
+
+HRESULT EffectPool::create(ID3D11Device* device, const std::wstring& filename, UINT flags, ID3DX11Effect** effect)
+{
+	HRESULT hr;
+	*effect = nullptr;
+
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+	if (!GetFileAttributesExW(filename.c_str(), GetFileExInfoStandard, &attributes))
+		return HRESULT_FROM_WIN32(GetLastError());
+
+	UINT pooledFlags = flags & ~D3DX11_EFFECT_STRIP_REFLECTION;
+	auto entry = entries.find(filename);
+	if (entry == entries.end() || entry->second.flags != pooledFlags ||
+		CompareFileTime(&entry->second.lastWrite, &attributes.ftLastWriteTime) != 0)
+	{
+		// Read with a single allocation and parsed once, every later request is a clone
+		ID3DX11Effect* loaded = nullptr;
+		V_RETURN(D3DX11CreateEffectFromFile(filename.c_str(), pooledFlags, device, &loaded));
+		loadCount++;
+
+		if (entry != entries.end())
+			SAFE_RELEASE(entry->second.effect);
+		entries[filename] = { attributes.ftLastWriteTime, pooledFlags, loaded };
+		entry = entries.find(filename);
+	}
+
+	// Force non-single so that no constant buffers are shared with the pooled copy
+	V_RETURN(entry->second.effect->CloneEffect(D3DX11_EFFECT_CLONE_FORCE_NONSINGLE, effect));
+	cloneCount++;
+
+	if (flags & D3DX11_EFFECT_STRIP_REFLECTION)
+	{
+		hr = (*effect)->Optimize();
+		if (FAILED(hr))
+		{
+			SAFE_RELEASE(*effect);
+			return hr;
+		}
+	}
+
+	return S_OK;
+}
+
+void EffectPool::clear()
+{
+	for (auto& entry : entries)
+		SAFE_RELEASE(entry.second.effect);
+	entries.clear();
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <DXUT.h>
+#include "d3dx11effect.h"
+
+#include <map>
+#include <string>
+
+
+// Keeps one loaded copy of every compiled effect file. Requests for a file which did not change
+// on disk are served by cloning that copy, which duplicates the effect's heaps in one go and
+// shares its shaders and state objects, instead of parsing the file and creating them again.
+// Recompiled files are loaded again.
+class EffectPool
+{
+public:
+	EffectPool() = default;
+	~EffectPool();
+	EffectPool(const EffectPool&) = delete;
+	void operator=(const EffectPool&) = delete;
+
+	// Creates an effect from a compiled .fxo file. flags are the D3DX11_EFFECT_* creation flags,
+	// the pooled copy always keeps its reflection so that D3DX11_EFFECT_STRIP_REFLECTION only
+	// applies to the returned effect.
+	HRESULT create(ID3D11Device* device, const std::wstring& filename, UINT flags, ID3DX11Effect** effect);
+
+	// Releases the pooled effects, call before the device is destroyed
+	void clear();
+
+	size_t getLoadCount() const { return loadCount; }
+	size_t getCloneCount() const { return cloneCount; }
+
+private:
+	struct Entry
+	{
+		FILETIME lastWrite;
+		UINT flags;
+		ID3DX11Effect* effect;
+	};
+
+	std::map<std::wstring, Entry> entries;
+	size_t loadCount = 0;
+	size_t cloneCount = 0;
+};
+
+extern EffectPool g_effectPool;
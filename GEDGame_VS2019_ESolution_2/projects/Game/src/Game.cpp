@@ -13,6 +13,7 @@
 #include <string>
 #include <cstdint>
 #include <cmath>
+#include <iomanip>
 
 
 #include "dxut.h"
@@ -31,6 +32,12 @@
 #include "ConfigParser.h"
 #include "GameObject.h"
 #include "Particle.h"
+#include "Simulation.h"
+#include "TextureStreamer.h"
+#include "EffectPool.h"
+#include "CommandRecorder.h"
+#include "Profiler.h"
+#include "GpuProfiler.h"
 
 #include "debug.h"
 
@@ -70,6 +77,12 @@ XMVECTOR                                g_gravity = {0, -9.81, 0};
 
 // Rendering
 GameEffect								g_gameEffect; // CPU part of Shader
+GameEffect                              g_shadowEffect; // Clone of the shader for the shadow pass
+TextureStreamer                         g_textureStreamer; // Streams the mip levels of the mesh and terrain textures
+EffectPool                              g_effectPool; // Loaded effects, shared by cloning
+CommandRecorder                         g_commandRecorder; // Records the shadow and the main pass in parallel
+Profiler                                g_profiler; // CPU scopes of all threads and the GPU passes
+GpuProfiler                             g_gpuProfiler; // Timestamp queries of the GPU passes
 std::unique_ptr<SpriteRenderer>         g_spriteRenderer = nullptr;
 ID3D11RenderTargetView*                 g_DefaultRenderTarget = nullptr;
 ID3D11DepthStencilView*                 g_DefaultDepthStencil = nullptr;
@@ -89,22 +102,16 @@ bool                                    g_debugShadows = false;
 
 std::map<std::string, std::shared_ptr<Mesh>>    g_meshes;
 
-std::vector<std::shared_ptr<EnemyObject>>       g_enemyPrototypes;
-std::map<std::string, std::shared_ptr<Projectile>>        g_projectilePrototypes;
-std::unique_ptr<Explosion>                      g_ExplosionPrototype = nullptr;
 
 Terrain     									g_terrain;
 std::shared_ptr<ParentObject>                   g_cameraObject = nullptr;
 std::shared_ptr<ParentObject>                   g_terrainObject = nullptr;
 std::vector<std::shared_ptr<MeshObject>>        g_gameObjects;
-std::vector<std::shared_ptr<WeaponObject>>      g_weaponObjects;
-std::list<EnemyObject>                          g_enemyObjects;
-std::list<Projectile>                           g_Projectiles;
-std::list<Explosion>                            g_Explosions;
+Simulation                                      g_simulation; // Enemies, weapons, projectiles and explosions
 
 std::vector<SpriteVertex>                       g_sprites;
-
-float                                   g_timeSinceLastEnemy = 5.0f;
+std::vector<SpriteVertex>                       g_unsortedSprites;
+std::vector<std::pair<float, uint32_t>>         g_spriteDepths;
 
 //--------------------------------------------------------------------------------------
 // UI control IDs
@@ -116,6 +123,7 @@ float                                   g_timeSinceLastEnemy = 5.0f;
 #define IDC_TOGGLEMOVE          5
 #define IDC_TOGGLESHADOWDEBUG   6
 #define IDC_RELOAD_SHADERS		101
+#define IDC_SAVE_PROFILE        102
 
 //--------------------------------------------------------------------------------------
 // Forward declarations 
@@ -141,10 +149,11 @@ void CALLBACK OnD3D11FrameRender( ID3D11Device* pd3dDevice, ID3D11DeviceContext*
 void clearFrameBuffers(ID3D11DeviceContext* pd3dImmediateContext, XMVECTOR clearColor);
 
 void renderShadowMap(ID3D11DeviceContext* pd3dImmediateContext, ID3D11DepthStencilView* shadowStencil, D3D11_VIEWPORT* shadowViewPort, const XMMATRIX& viewProj);
+void bindDefaultTargets(ID3D11DeviceContext* pd3dImmediateContext);
 
 void renderObjects(ID3D11DeviceContext* pd3dImmediateContext, const XMMATRIX& viewProj, const XMMATRIX& lightViewProj);
 
-void renderSprites(ID3D11DeviceContext* pd3dImmediateContext);
+void renderSprites(ID3D11DeviceContext* pd3dImmediateContext, float time);
 
 void InitApp();
 void DeinitApp();
@@ -152,14 +161,10 @@ void RenderText();
 
 void ReleaseShader();
 HRESULT ReloadShader(ID3D11Device* pd3dDevice);
+void SaveProfile();
 
 void CreateGameObjects();
-void CreateEnemyPrototypes();
-void CreateWeaponObjects();
-void CreateProjectilePrototypes(std::vector<std::wstring>& sprite_filenames);
-void CreateExplosionPrototype(std::vector<std::wstring>& sprite_filenames);
 
-void SpawnEnemy();
 void drawShadowMap(ID3D11DeviceContext* pd3dImmediateContext);
 
 //--------------------------------------------------------------------------------------
@@ -232,6 +237,8 @@ void InitApp()
     HRESULT hr;
     WCHAR path[MAX_PATH];
 
+    g_profiler.setThreadName("Main thread");
+
     // Parse the config file
     V(DXUTFindDXSDKMediaFileCch(path, MAX_PATH, L"game.cfg"));
 	char pathA[MAX_PATH];
@@ -252,6 +259,7 @@ void InitApp()
     g_hud.AddButton( IDC_TOGGLEREF, L"Toggle REF (F3)", 0, iY += iYo, 170, 22, VK_F3 );
     g_hud.AddButton( IDC_CHANGEDEVICE, L"Change device (F2)", 0, iY += iYo, 170, 22, VK_F2 );
 	g_hud.AddButton (IDC_RELOAD_SHADERS, L"Reload shaders (F5)", 0, iY += 24, 170, 22, VK_F5);
+    g_hud.AddButton(IDC_SAVE_PROFILE, L"Save profile (F8)", 0, iY += 24, 170, 22, VK_F8);
     g_sampleUI.SetCallback( OnGUIEvent ); 
     iY = 10;
     iY += 16;
@@ -262,16 +270,15 @@ void InitApp()
     for (auto &m : g_ConfigParser.get_Meshes())
         g_meshes.emplace(m.identifier, std::make_shared<Mesh>(m.pathMesh, m.pathDiffuse, m.pathSpecular, m.pathGlow));
 
-    std::vector<std::wstring> sprite_filenames;
+    std::vector<std::wstring> sprite_names;
 
     CreateGameObjects();
-    CreateEnemyPrototypes();
-    CreateProjectilePrototypes(sprite_filenames);
-    CreateWeaponObjects();
-    CreateExplosionPrototype(sprite_filenames);
+    g_simulation.createPrototypes(&g_meshes, sprite_names);
+    g_simulation.createWeapons(&g_meshes, g_gameObjects);
 
     // Create the sprite renderer object
-    g_spriteRenderer = std::make_unique<SpriteRenderer>(sprite_filenames);
+    const std::string& atlas_path = g_ConfigParser.get_Sprites().atlasPath;
+    g_spriteRenderer = std::make_unique<SpriteRenderer>(std::wstring(atlas_path.begin(), atlas_path.end()), sprite_names);
 }
 
 void CreateGameObjects()
@@ -312,100 +319,13 @@ void CreateGameObjects()
     }
 }
 
-void CreateEnemyPrototypes()
-{
-    // https://en.wikipedia.org/wiki/Prototype_pattern
-    for (auto& e : g_ConfigParser.get_Enemies())
-    {
-        auto new_enemy = std::make_shared<EnemyObject>();
-
-        new_enemy->position = { e.pos_x, e.pos_y, e.pos_z };
-        new_enemy->rotation = { DEG2RAD(e.rot_x), DEG2RAD(e.rot_y), DEG2RAD(e.rot_z) };
-        new_enemy->scale = { e.scale, e.scale, e.scale };
-
-        new_enemy->health = e.hp;
-        new_enemy->velocity = { e.speed, e.speed, e.speed };
-        new_enemy->size = e.size * e.scale;
-
-        auto mesh_it = g_meshes.find(e.meshIdentifier);
-        if (mesh_it != g_meshes.end())
-            new_enemy->mesh = mesh_it->second;
-        else
-            std::cerr << "ERROR: Mesh with identifier " << e.meshIdentifier << " could not be found\n";
-
-        g_enemyPrototypes.push_back(new_enemy);
-    }
-}
-
-void CreateWeaponObjects()
-{
-    for (auto& w : g_ConfigParser.get_Weapons())
-    {
-        auto new_weaponObject = make_shared<WeaponObject>();
-
-        auto mesh_it = g_meshes.find(w.meshIdentifer);
-        if (mesh_it != g_meshes.end())
-            new_weaponObject->mesh = mesh_it->second;
-        else
-            std::cerr << "ERROR: Mesh with identifier " << w.meshIdentifer << " could not be found\n";
-
-        for (auto& o : g_gameObjects)
-            if (o->name == w.parentIdentifier)
-                new_weaponObject->parent = o;
-
-        auto proj_it = g_projectilePrototypes.find(w.projectile_identifier);
-        if (proj_it != g_projectilePrototypes.end())
-            new_weaponObject->projectile = proj_it->second;
-        else
-            std::cerr << "ERROR: Projectile with identifier " << w.projectile_identifier << " could not be found\n";
-
-        new_weaponObject->cooldown = 1.0f / w.firerate;
-        new_weaponObject->spawnpoint = { w.spawnpoint_x, w.spawnpoint_y, w.spawnpoint_z };
-
-        g_weaponObjects.push_back(new_weaponObject);
-    }
-}
-
-void CreateProjectilePrototypes(std::vector<std::wstring>& sprite_filenames)
-{
-    for (auto& p : g_ConfigParser.get_Projectiles())
-    {
-        auto new_proj = std::make_shared<Projectile>();
-
-        new_proj->velocity = { p.projectileSpeed, p.projectileSpeed, p.projectileSpeed };
-
-        new_proj->damage = p.damage;
-        new_proj->useGravity = p.gravity;
-
-        new_proj->size = p.spriteSize;
-        new_proj->spriteIndex = static_cast<int>(sprite_filenames.size());
-
-        sprite_filenames.push_back(std::wstring(p.spritePath.begin(), p.spritePath.end()));
-        g_projectilePrototypes.emplace(p.identifier, new_proj);
-    }
-}
-
-void CreateExplosionPrototype(std::vector<std::wstring>& sprite_filenames)
-{
-    g_ExplosionPrototype = std::make_unique<Explosion>(sprite_filenames.size(), g_ConfigParser.get_Explosion().particle_count);
-    
-    g_ExplosionPrototype->size = g_ConfigParser.get_Explosion().scale;
-    g_ExplosionPrototype->duration = g_ConfigParser.get_Explosion().duration;
-    
-    sprite_filenames.push_back(
-        wstring(
-            g_ConfigParser.get_Explosion().spritePath.begin(),
-            g_ConfigParser.get_Explosion().spritePath.end()));
-}
-
 //--------------------------------------------------------------------------------------
 // Deinitialize the app 
 //--------------------------------------------------------------------------------------
 void DeinitApp()
 {
     g_gameObjects.clear();
-    g_enemyObjects.clear();
-    g_enemyPrototypes.clear();
+    g_simulation.clear();
     g_meshes.clear();
     g_spriteRenderer = nullptr;
     g_cameraObject = nullptr;
@@ -423,6 +343,37 @@ void RenderText()
     g_txtHelper->SetForegroundColor(XMVectorSet(1.0f, 1.0f, 0.0f, 1.0f));
     g_txtHelper->DrawTextLine( DXUTGetFrameStats(true)); //DXUTIsVsyncEnabled() ) );
     g_txtHelper->DrawTextLine( DXUTGetDeviceStats() );
+
+    std::wstringstream streaming;
+    streaming << L"Textures: " << (g_textureStreamer.getResidentBytes() >> 20) << L" / " << (g_textureStreamer.getBudget() >> 20)
+        << L" MB, " << g_textureStreamer.getPendingCount() << L" loading";
+    g_txtHelper->DrawTextLine( streaming.str().c_str() );
+
+    // Constant buffer traffic of this frame, of the main and the shadow pass
+    D3DX11_EFFECT_STATS effectStats, shadowStats;
+    if (SUCCEEDED(g_gameEffect.effect->GetStats(&effectStats)) && SUCCEEDED(g_shadowEffect.effect->GetStats(&shadowStats)))
+    {
+        effectStats.ConstantBufferUpdates += shadowStats.ConstantBufferUpdates;
+        effectStats.ConstantBufferBytes += shadowStats.ConstantBufferBytes;
+        effectStats.StateCallsIssued += shadowStats.StateCallsIssued;
+        effectStats.StateCallsFiltered += shadowStats.StateCallsFiltered;
+
+        std::wstringstream uploads;
+        uploads << L"Effect: " << effectStats.ConstantBufferUpdates << L" CB uploads, "
+            << (effectStats.ConstantBufferBytes >> 10) << L" KB, " << effectStats.StateCallsIssued << L" state calls, "
+            << effectStats.StateCallsFiltered << L" filtered";
+        g_txtHelper->DrawTextLine( uploads.str().c_str() );
+        g_gameEffect.effect->ResetStats();
+        g_shadowEffect.effect->ResetStats();
+    }
+
+    // The GPU times are a few frames old
+    std::wstringstream timings;
+    timings << std::fixed << std::setprecision(2)
+        << L"CPU: move " << g_profiler.getLastMilliseconds("Frame move") << L" ms, render " << g_profiler.getLastMilliseconds("Frame render")
+        << L" ms  GPU: shadow " << g_profiler.getLastMilliseconds("Shadow", true) << L" ms, meshes " << g_profiler.getLastMilliseconds("Meshes", true)
+        << L" ms, terrain " << g_profiler.getLastMilliseconds("Terrain", true) << L" ms, sprites " << g_profiler.getLastMilliseconds("Sprites", true) << L" ms";
+    g_txtHelper->DrawTextLine( timings.str().c_str() );
     g_txtHelper->End();
 }
 
@@ -520,6 +471,16 @@ HRESULT CALLBACK OnD3D11CreateDevice( ID3D11Device* pd3dDevice,
     g_ShadowViewport[0].MinDepth = 0;
     g_ShadowViewport[0].MaxDepth = 1;
 
+    // Start the texture streaming, before any textures are loaded
+    const auto& streaming = g_ConfigParser.get_TextureStreaming();
+    V_RETURN(g_textureStreamer.create(pd3dDevice, uint64_t(streaming.budget) << 20, streaming.resident_size, streaming.threads));
+
+    // One deferred context for the shadow and one for the main pass. Without deferred
+    // context support the passes are rendered on the immediate context.
+    if (g_ConfigParser.get_Rendering().multithreaded && FAILED(g_commandRecorder.create(pd3dDevice, 2)))
+        OutputDebugString(L"Deferred contexts are not available, recording on the immediate context\n");
+    V_RETURN(g_gpuProfiler.create(pd3dDevice));
+
     // Create the terrain
 	V_RETURN(g_terrain.create(pd3dDevice));
     
@@ -531,7 +492,7 @@ HRESULT CALLBACK OnD3D11CreateDevice( ID3D11Device* pd3dDevice,
     // Create all meshes
     for (auto& m : g_meshes)
         V_RETURN(m.second->create(pd3dDevice));
-    V_RETURN(Mesh::createInputLayout(pd3dDevice, g_gameEffect.meshPass));
+    V_RETURN(Mesh::createInputLayout(pd3dDevice, g_gameEffect.meshPass, g_gameEffect.meshQuantizedPass));
 
     // Create the sprite renderer
     V_RETURN(g_spriteRenderer->create(pd3dDevice));
@@ -573,8 +534,15 @@ void CALLBACK OnD3D11DestroyDevice( void* pUserContext )
     // Destroy the sprite renderer
     g_spriteRenderer->destroy();
 
+    // Release the textures of the terrain and the meshes
+    g_textureStreamer.destroy();
+
+    g_commandRecorder.destroy();
+    g_gpuProfiler.destroy();
+
     SAFE_DELETE( g_txtHelper );
     ReleaseShader();
+    g_effectPool.clear();
 }
 
 //--------------------------------------------------------------------------------------
@@ -606,6 +574,14 @@ HRESULT CALLBACK OnD3D11ResizedSwapChain( ID3D11Device* pd3dDevice, IDXGISwapCha
     g_cameraParams.farPlane = 5000.f;
 
     g_camera.SetProjParams(g_cameraParams.fovy, g_cameraParams.aspect, g_cameraParams.nearPlane, g_cameraParams.farPlane);
+
+    // The viewport DXUT sets for the back buffer, deferred contexts have to set it themselves
+    g_DefaultViewports[0].TopLeftX = 0;
+    g_DefaultViewports[0].TopLeftY = 0;
+    g_DefaultViewports[0].Width = static_cast<float>(pBackBufferSurfaceDesc->Width);
+    g_DefaultViewports[0].Height = static_cast<float>(pBackBufferSurfaceDesc->Height);
+    g_DefaultViewports[0].MinDepth = 0;
+    g_DefaultViewports[0].MaxDepth = 1;
 	g_camera.SetRotateButtons(true, false, false);
     g_camera.SetEnablePositionMovement(g_cameraMovement);
 	g_camera.SetScalers( g_cameraRotateScaler, g_cameraMoveScaler );
@@ -635,6 +611,7 @@ HRESULT ReloadShader(ID3D11Device* pd3dDevice)
 
     ReleaseShader();
 	V_RETURN(g_gameEffect.create(pd3dDevice));
+	V_RETURN(g_shadowEffect.create(pd3dDevice));
 
     g_spriteRenderer->reloadShader(pd3dDevice);
 
@@ -648,6 +625,19 @@ void ReleaseShader()
 {
     g_spriteRenderer->releaseShader();
 	g_gameEffect.destroy();
+	g_shadowEffect.destroy();
+}
+
+//--------------------------------------------------------------------------------------
+// Writes the recorded CPU scopes and GPU passes as a Chrome trace
+//--------------------------------------------------------------------------------------
+void SaveProfile()
+{
+    g_profiler.collect();
+
+    std::ofstream file("profile.json");
+    g_profiler.writeChromeTrace(file);
+    OutputDebugString(file ? L"Saved profile.json\n" : L"Could not write profile.json\n");
 }
 
 //--------------------------------------------------------------------------------------
@@ -705,9 +695,9 @@ void CALLBACK OnKeyboard( UINT nChar, bool bKeyDown, bool bAltDown, void* pUserC
 
     // Weapon input
     if (nChar == 'D')
-        g_weaponObjects[0]->active = bKeyDown;
+        g_simulation.weapons[0]->active = bKeyDown;
     if (nChar == 'A')
-        g_weaponObjects[1]->active = bKeyDown;
+        g_simulation.weapons[1]->active = bKeyDown;
 }
 
 //--------------------------------------------------------------------------------------
@@ -737,6 +727,9 @@ void CALLBACK OnGUIEvent( UINT nEvent, int nControlID, CDXUTControl* pControl, v
 		case IDC_RELOAD_SHADERS:
 			ReloadShader(DXUTGetD3D11Device ());
 			break;
+        case IDC_SAVE_PROFILE:
+            SaveProfile();
+            break;
     }
 }
 
@@ -747,113 +740,13 @@ void CALLBACK OnGUIEvent( UINT nEvent, int nControlID, CDXUTControl* pControl, v
 void CALLBACK OnFrameMove( double fTime, float fElapsedTime, void* pUserContext )
 {
 	UNREFERENCED_PARAMETER(pUserContext);
+    PROFILE_SCOPE("Frame move");
+
     // Update the camera's position based on user input 
     g_camera.FrameMove( fElapsedTime );
     g_cameraObject->worldMatrix = g_camera.GetWorldMatrix();
 
-    // Remove enemies
-    g_enemyObjects.remove_if( 
-        [] (const EnemyObject& e)
-        {
-            if (e.health <= 0)
-            {
-                g_Explosions.push_back(*g_ExplosionPrototype.get());
-                g_Explosions.back().position = e.position;
-                g_Explosions.back().size *= e.size;
-                g_Explosions.back().Init(
-                    g_ConfigParser.get_Explosion().particle_min_velocity,
-                    g_ConfigParser.get_Explosion().particle_max_velocity,
-                    g_ConfigParser.get_Explosion().particle_min_lifetime,
-                    g_ConfigParser.get_Explosion().particle_max_lifetime);
-                return true;
-            }
-            return XMVectorGetX(XMVector3LengthEst(e.position)) > g_ConfigParser.get_SpawnBehaviour().despawn_radius;
-        });
-    // Update enemies
-    for (auto& e : g_enemyObjects)
-        e.update(fElapsedTime);
-    // Spawn enemies
-    g_timeSinceLastEnemy += fElapsedTime;
-    if (g_timeSinceLastEnemy > g_ConfigParser.get_SpawnBehaviour().interval)
-    {
-        SpawnEnemy();
-        g_timeSinceLastEnemy -= g_ConfigParser.get_SpawnBehaviour().interval;
-    }
-
-    // Remove Projectiles
-    g_Projectiles.remove_if( 
-        [] (const Projectile& p)
-        {
-            return XMVectorGetX(XMVector3LengthEst(p.position)) > g_ConfigParser.get_SpawnBehaviour().despawn_radius;
-        });
-    // Update Projectiles
-    for (auto& p : g_Projectiles)
-        p.update(fElapsedTime, g_gravity);
-    // Shoot
-    for (auto& w : g_weaponObjects)
-        if (w->update(fElapsedTime))
-        {
-            g_Projectiles.push_back(*w->projectile); // Copy constructor
-            auto& proj = g_Projectiles.back();
-
-            proj.position = XMVector3Transform(w->spawnpoint, w->getWorldMatrix());
-            proj.velocity *= g_camera.GetWorldAhead();
-        }
-    // Projectile collision and damage
-    g_Projectiles.remove_if( 
-        [] (const Projectile& p)
-        {
-            for (auto& e : g_enemyObjects)
-                if (XMVectorGetX(XMVector3LengthSq(e.position - p.position)) < (p.size + e.size) * (p.size + e.size))
-                {
-                    e.health -= p.damage;
-                    return true;
-                }
-            return false;
-        });
-
-    // Remove explosions
-    g_Explosions.remove_if(
-        [] (const Explosion& e) 
-        {
-            return e.time >= e.duration;
-        });
-    // Update explosions
-    for (auto& e : g_Explosions)
-        e.update(fElapsedTime, g_gravity);
-}
-
-void SpawnEnemy()
-{
-    int rand_num = rand() % g_enemyPrototypes.size();
-    
-    // Uses the copy constructor to copy the prototype in its current state
-    g_enemyObjects.push_back(*g_enemyPrototypes[rand_num]);
-    EnemyObject& enemy = g_enemyObjects.back();
-
-    enemy.type = g_enemyPrototypes[rand_num];
-
-    float spawn_circle = XM_2PI * static_cast<float>(rand()) / RAND_MAX;
-    float spawn_height = (static_cast<float>(rand()) / RAND_MAX)
-        * (g_ConfigParser.get_SpawnBehaviour().max_height - g_ConfigParser.get_SpawnBehaviour().min_height)
-        + g_ConfigParser.get_SpawnBehaviour().min_height;
-    float target_cicle = XM_2PI * static_cast<float>(rand()) / RAND_MAX;
-    XMVECTOR target_pos = {
-        g_ConfigParser.get_SpawnBehaviour().target_radius * sin(target_cicle),
-        spawn_height* g_ConfigParser.get_terrain().height,
-        g_ConfigParser.get_SpawnBehaviour().target_radius * cos(target_cicle) };
-    
-    enemy.position = {
-        g_ConfigParser.get_SpawnBehaviour().spawn_radius * sin(spawn_circle),
-        spawn_height * g_ConfigParser.get_terrain().height,
-        g_ConfigParser.get_SpawnBehaviour().spawn_radius * cos(spawn_circle) };
-    
-    enemy.velocity *= XMVector3Normalize(target_pos - enemy.position);
-    
-    enemy.rotation = { 
-        0.0f, 
-        atan2(XMVectorGetX(enemy.velocity), XMVectorGetZ(enemy.velocity)), 
-        0.0f };
+    g_simulation.update(static_cast<float>(fTime), fElapsedTime, g_camera.GetWorldAhead(), g_gravity);
 }
 
 //--------------------------------------------------------------------------------------
@@ -863,7 +756,6 @@ void CALLBACK OnD3D11FrameRender( ID3D11Device* pd3dDevice, ID3D11DeviceContext*
         float fElapsedTime, void* pUserContext )
 {
 	UNREFERENCED_PARAMETER(pd3dDevice);
-	UNREFERENCED_PARAMETER(fTime);
 	UNREFERENCED_PARAMETER(pUserContext);
 
     HRESULT hr;
@@ -876,7 +768,7 @@ void CALLBACK OnD3D11FrameRender( ID3D11Device* pd3dDevice, ID3D11DeviceContext*
     }     
 
     // Show an error if the shader file could not be loaded
-	if(g_gameEffect.effect == NULL) {
+	if(g_gameEffect.effect == NULL || g_shadowEffect.effect == NULL) {
         g_txtHelper->Begin();
         g_txtHelper->SetInsertionPos( 5, 5 );
         g_txtHelper->SetForegroundColor( XMVectorSet( 1.0f, 1.0f, 0.0f, 1.0f ) );
@@ -885,6 +777,9 @@ void CALLBACK OnD3D11FrameRender( ID3D11Device* pd3dDevice, ID3D11DeviceContext*
         return;
     }
 
+    PROFILE_SCOPE("Frame render");
+    g_gpuProfiler.beginFrame(pd3dImmediateContext, g_profiler);
+
     g_DefaultRenderTarget = DXUTGetD3D11RenderTargetView();
     g_DefaultDepthStencil = DXUTGetD3D11DepthStencilView();
     
@@ -902,14 +797,36 @@ void CALLBACK OnD3D11FrameRender( ID3D11Device* pd3dDevice, ID3D11DeviceContext*
     XMMATRIX const viewProj = view * proj;
     XMMATRIX const lightViewProj = lightView * lightProj;
 
-    renderShadowMap(pd3dImmediateContext, g_ShadowStencil, g_ShadowViewport, lightViewProj);
-    
 	V(g_gameEffect.lightDirEV->SetFloatVector( ( float* )&g_lightDir ));
     V(g_gameEffect.cameraPosWorldEV->SetFloatVector((float*)&g_camera.GetEyePt()));
     V(g_gameEffect.shadowEV->SetResource(g_ShadowMapSRV));
-    
-    renderObjects(pd3dImmediateContext, viewProj, lightViewProj);
-    renderSprites(pd3dImmediateContext);
+
+    if (g_commandRecorder.getContextCount() >= 2)
+    {
+        // The passes use different effects, so they can be recorded at the same time. Only the
+        // main pass requests textures from the streamer. The shadow map is rendered first.
+        V(g_commandRecorder.execute(pd3dImmediateContext, {
+            [&](ID3D11DeviceContext* context)
+            {
+                renderShadowMap(context, g_ShadowStencil, g_ShadowViewport, lightViewProj);
+            },
+            [&](ID3D11DeviceContext* context)
+            {
+                bindDefaultTargets(context);
+                renderObjects(context, viewProj, lightViewProj);
+                renderSprites(context, static_cast<float>(fTime));
+            } }));
+
+        // Executing the command lists reset the immediate context
+        bindDefaultTargets(pd3dImmediateContext);
+    }
+    else
+    {
+        renderShadowMap(pd3dImmediateContext, g_ShadowStencil, g_ShadowViewport, lightViewProj);
+        bindDefaultTargets(pd3dImmediateContext);
+        renderObjects(pd3dImmediateContext, viewProj, lightViewProj);
+        renderSprites(pd3dImmediateContext, static_cast<float>(fTime));
+    }
     if (g_debugShadows)
         drawShadowMap(pd3dImmediateContext);
 
@@ -920,6 +837,12 @@ void CALLBACK OnD3D11FrameRender( ID3D11Device* pd3dDevice, ID3D11DeviceContext*
     RenderText();
     DXUT_EndPerfEvent();
 
+    // Load the textures requested in this frame
+    g_textureStreamer.update();
+
+    g_gpuProfiler.endFrame(pd3dImmediateContext, g_profiler);
+    g_profiler.collect();
+
     static DWORD dwTimefirst = GetTickCount();
     if ( GetTickCount() - dwTimefirst > 2000 )
     {    
@@ -948,26 +871,30 @@ void renderShadowMap(
     D3D11_VIEWPORT* shadowViewPort,
     const XMMATRIX& viewProj)
 {
-    // Save the current viewport
-    UINT viewport_count = 1;
-    pd3dImmediateContext->RSGetViewports(&viewport_count, g_DefaultViewports);
-    
+    PROFILE_SCOPE("Shadow pass");
+    GpuProfileScope gpuScope(pd3dImmediateContext, "Shadow", g_gpuProfiler);
+
     // Set render targets to shadow mapping
-    pd3dImmediateContext->OMSetRenderTargets(0, nullptr, g_ShadowStencil);
-    pd3dImmediateContext->RSSetViewports(1, g_ShadowViewport);
+    pd3dImmediateContext->OMSetRenderTargets(0, nullptr, shadowStencil);
+    pd3dImmediateContext->RSSetViewports(1, shadowViewPort);
+    g_shadowEffect.effect->InvalidateStateCache();
 
     // Render objects to shadow map
-    for (const auto& w : g_weaponObjects)
-        w->renderDepthOnly(pd3dImmediateContext, viewProj);
+    for (const auto& w : g_simulation.weapons)
+        w->renderDepthOnly(pd3dImmediateContext, g_shadowEffect, viewProj);
     for (const auto& o : g_gameObjects)
-        o->renderDepthOnly(pd3dImmediateContext, viewProj);
-    for (const auto& e : g_enemyObjects)
-        e.renderDepthOnly(pd3dImmediateContext, viewProj);
-    g_terrain.renderDepthOnly(pd3dImmediateContext, viewProj);
+        o->renderDepthOnly(pd3dImmediateContext, g_shadowEffect, viewProj);
+    for (const auto& e : g_simulation.enemies)
+        e.renderDepthOnly(pd3dImmediateContext, g_shadowEffect, viewProj);
+    g_terrain.renderDepthOnly(pd3dImmediateContext, g_shadowEffect, viewProj);
+}
 
-    // Restore render targets
+void bindDefaultTargets(ID3D11DeviceContext* pd3dImmediateContext)
+{
     pd3dImmediateContext->OMSetRenderTargets(1, &g_DefaultRenderTarget, g_DefaultDepthStencil);
     pd3dImmediateContext->RSSetViewports(1, g_DefaultViewports);
+    // Another effect or a command list changed the states in between
+    g_gameEffect.effect->InvalidateStateCache();
 }
 
 void renderObjects(
@@ -975,58 +902,64 @@ void renderObjects(
     const XMMATRIX& viewProj,
     const XMMATRIX& lightViewProj)
 {
-    for (const auto& w : g_weaponObjects)
-        w->render(pd3dImmediateContext, viewProj, lightViewProj);
-    for (const auto& o : g_gameObjects)
-        o->render(pd3dImmediateContext, viewProj, lightViewProj);
-    for (const auto& e : g_enemyObjects)
-        e.render(pd3dImmediateContext, viewProj, lightViewProj);
-    g_terrain.render(pd3dImmediateContext, viewProj, lightViewProj);
+    {
+        PROFILE_SCOPE("Meshes");
+        GpuProfileScope gpuScope(pd3dImmediateContext, "Meshes", g_gpuProfiler);
+        for (const auto& w : g_simulation.weapons)
+            w->render(pd3dImmediateContext, g_gameEffect, viewProj, lightViewProj);
+        for (const auto& o : g_gameObjects)
+            o->render(pd3dImmediateContext, g_gameEffect, viewProj, lightViewProj);
+        for (const auto& e : g_simulation.enemies)
+            e.render(pd3dImmediateContext, g_gameEffect, viewProj, lightViewProj);
+    }
+
+    PROFILE_SCOPE("Terrain");
+    GpuProfileScope gpuScope(pd3dImmediateContext, "Terrain", g_gpuProfiler);
+    g_terrain.render(pd3dImmediateContext, g_gameEffect, viewProj, lightViewProj);
 }
 
-void renderSprites(ID3D11DeviceContext* pd3dImmediateContext)
+void renderSprites(ID3D11DeviceContext* pd3dImmediateContext, float time)
 {
-    size_t sprite_count =
-        g_Projectiles.size()
-        + g_Explosions.size()
-        + g_Explosions.size() * g_ConfigParser.get_Explosion().particle_count;
+    PROFILE_SCOPE("Sprites");
 
-    if (sprite_count <= 0)
-        return;
-
-    if (sprite_count > g_sprites.capacity())
-        g_sprites.resize(sprite_count * 2);
+    g_unsortedSprites.clear();
+    g_spriteDepths.clear();
 
+    // Only the depth keys are sorted, every vertex is copied once into back-to-front order
     XMVECTOR camera_ahead = g_camera.GetWorldAhead();
-    size_t i = 0;
-
-    for (auto& p : g_Projectiles)
+    auto add_sprite = [&](const Sprite& s, const XMVECTOR& offset)
     {
-        g_sprites[i] = p.GetSpriteVertex(camera_ahead);
-        i++;
-    }
+        g_spriteDepths.emplace_back(s.GetCameraDistance(camera_ahead, offset), static_cast<uint32_t>(g_unsortedSprites.size()));
+        g_unsortedSprites.push_back(s.GetSpriteVertex(offset));
+    };
+
+    for (auto& p : g_simulation.projectiles)
+        add_sprite(p, XMVectorZero());
 
-    for (auto& e : g_Explosions)
+    for (auto& e : g_simulation.explosions)
     {
-        g_sprites[i] = e.GetSpriteVertex(camera_ahead);
-        g_sprites[i].time = e.time / e.duration;
-        i++;
+        add_sprite(e, XMVectorZero());
 
         for (auto& p : e.explosionParticles)
-        {
-            g_sprites[i] = p.GetSpriteVertex(camera_ahead, e.position);
-            g_sprites[i].time = p.time / p.duration;
-            i++;
-        }
+            if (p.time < p.duration)
+                add_sprite(p, e.position);
     }
 
-    std::sort(g_sprites.begin(), g_sprites.end(),
-        [](const SpriteVertex& a, const SpriteVertex& b)
+    if (g_spriteDepths.empty())
+        return;
+
+    std::sort(g_spriteDepths.begin(), g_spriteDepths.end(),
+        [](const std::pair<float, uint32_t>& a, const std::pair<float, uint32_t>& b)
         {
-            return a.camera_distance > b.camera_distance;
+            return a.first > b.first;
         });
 
-    g_spriteRenderer->renderSprites(pd3dImmediateContext, g_sprites, g_camera, static_cast<int>(i), 0);
+    g_sprites.resize(g_spriteDepths.size());
+    for (size_t i = 0; i < g_spriteDepths.size(); i++)
+        g_sprites[i] = g_unsortedSprites[g_spriteDepths[i].second];
+
+    GpuProfileScope gpuScope(pd3dImmediateContext, "Sprites", g_gpuProfiler);
+    g_spriteRenderer->renderSprites(pd3dImmediateContext, g_sprites, g_camera, time, static_cast<int>(g_sprites.size()), 0);
 }
 
 void drawShadowMap(ID3D11DeviceContext* pd3dImmediateContext)
@@ -1035,6 +968,8 @@ void drawShadowMap(ID3D11DeviceContext* pd3dImmediateContext)
     unsigned int strides[] = { 0, }, offsets[] = { 0, };
     pd3dImmediateContext->IASetVertexBuffers(0, 1, vbs, strides, offsets);
     pd3dImmediateContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+    // The sprite effect changed the shaders and states in between
+    g_gameEffect.effect->InvalidateStateCache();
     g_gameEffect.debugShadowPass->Apply(0, pd3dImmediateContext);
     pd3dImmediateContext->Draw(4, 0);
 }
\ No newline at end of file
@@ -4,6 +4,8 @@
 #include "d3dx11effect.h"
 #include "SDKmisc.h"
 
+#include "EffectPool.h"
+
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -29,6 +31,8 @@ struct GameEffect
 	ID3DX11EffectPass*						meshPass;
 	ID3DX11EffectPass*						terrainShadowPass;
 	ID3DX11EffectPass*						meshShadowPass;
+	ID3DX11EffectPass*						meshQuantizedPass; // Passes for version 2 (quantized) t3d meshes
+	ID3DX11EffectPass*						meshQuantizedShadowPass;
 	ID3DX11EffectPass*                      debugShadowPass;
 	ID3DX11EffectMatrixVariable*            worldEV; // World matrix effect variable
 	ID3DX11EffectMatrixVariable*            worldViewProjectionEV; // WorldViewProjection matrix effect variable
@@ -43,6 +47,8 @@ struct GameEffect
 	ID3DX11EffectScalarVariable*			resolutionEV;
 	ID3DX11EffectVectorVariable*            lightDirEV; // Light direction in object space
 	ID3DX11EffectVectorVariable*			cameraPosWorldEV; 
+	ID3DX11EffectVectorVariable*			positionMinEV; // Dequantization of mesh positions
+	ID3DX11EffectVectorVariable*			positionScaleEV;
 
 	GameEffect() { ZeroMemory(this, sizeof(*this)); }		// WARNING: This will set ALL members to 0!
 
@@ -54,14 +60,10 @@ struct GameEffect
 
 		// Find and load the rendering effect
 		V_RETURN(DXUTFindDXSDKMediaFileCch(path, MAX_PATH, L"shader\\game.fxo"));
-		std::ifstream is(path, std::ios_base::binary);
-		is.seekg(0, std::ios_base::end);
-		std::streampos pos = is.tellg();
-		is.seekg(0, std::ios_base::beg);
-		std::vector<char> effectBuffer((unsigned int)pos);
-		is.read(&effectBuffer[0], pos);
-		is.close();
-		V_RETURN(D3DX11CreateEffectFromMemory((const void*)&effectBuffer[0], effectBuffer.size(), 0, device, &effect));    
+		// The per object constants are rewritten between most draws, which suits Map/WRITE_DISCARD.
+		// Consecutive meshes mostly share shaders and states, so repeated sets are filtered; the
+		// state cache is invalidated wherever the game binds render targets itself.
+		V_RETURN(g_effectPool.create(device, path, D3DX11_EFFECT_DYNAMIC_CONSTANT_BUFFERS | D3DX11_EFFECT_FILTER_REDUNDANT_STATE, &effect));
 		assert(effect->IsValid());
 
 		// Obtain the effect technique
@@ -72,6 +74,8 @@ struct GameEffect
 		SAFE_GET_PASS(technique, "P0_Terrain_Shadow", terrainShadowPass);
 		SAFE_GET_PASS(technique, "P1_Mesh", meshPass);
 		SAFE_GET_PASS(technique, "P1_Mesh_Shadow", meshShadowPass);
+		SAFE_GET_PASS(technique, "P1_Mesh_Quantized", meshQuantizedPass);
+		SAFE_GET_PASS(technique, "P1_Mesh_Quantized_Shadow", meshQuantizedShadowPass);
 		SAFE_GET_PASS(technique, "P2_Debug", debugShadowPass);
 
 		// Obtain the effect variables
@@ -87,8 +91,13 @@ struct GameEffect
 		SAFE_GET_MATRIX(effect, "g_LightWorldViewProjection", lightWorldViewProjEV);
 		SAFE_GET_VECTOR(effect, "g_LightDir", lightDirEV); 
 		SAFE_GET_VECTOR(effect, "g_cameraPosWorld", cameraPosWorldEV);
+		SAFE_GET_VECTOR(effect, "g_PositionMin", positionMinEV);
+		SAFE_GET_VECTOR(effect, "g_PositionScale", positionScaleEV);
 		SAFE_GET_SCALAR(effect, "g_TerrainRes", resolutionEV);
 
+		// Everything is looked up, the names and type information are not needed anymore
+		V_RETURN(effect->Optimize());
+
 		return S_OK;
 	}
 
@@ -99,4 +108,6 @@ struct GameEffect
 	}
 };
 
-extern GameEffect g_gameEffect;
\ No newline at end of file
+extern GameEffect g_gameEffect;
+// A separate copy for the shadow pass, which can be recorded at the same time as the main pass
+extern GameEffect g_shadowEffect;
\ No newline at end of file
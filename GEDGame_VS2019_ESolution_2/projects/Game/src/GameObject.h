@@ -2,8 +2,16 @@
 
 #include <DirectXMath.h>
 
+#include <memory>
+#include <string>
+
+// GameBench builds the objects with GAME_HEADLESS, without anything to render them with
+#ifndef GAME_HEADLESS
 #include "GameEffect.h"
 #include "Mesh.h"
+#else
+class Mesh;
+#endif
 
 class Projectile;
 
@@ -42,8 +50,9 @@ public:
 
 	std::shared_ptr<Mesh> mesh = nullptr;
 
+#ifndef GAME_HEADLESS
 	// Renders the GameObject
-	HRESULT render(ID3D11DeviceContext* context, const DirectX::XMMATRIX& camera, const DirectX::XMMATRIX& light) const
+	HRESULT render(ID3D11DeviceContext* context, const GameEffect& effect, const DirectX::XMMATRIX& camera, const DirectX::XMMATRIX& light) const
 	{
 		if (!mesh)
 			return S_FALSE;
@@ -53,17 +62,21 @@ public:
 		DirectX::XMMATRIX world = getWorldMatrix();
 		DirectX::XMMATRIX worldViewProj = world * camera;
 		DirectX::XMMATRIX lightWorldViewProj = world * light;
-		V(g_gameEffect.worldEV->SetMatrix((float*)&world));
-		V(g_gameEffect.worldNormalsEV->SetMatrix((float*)&XMMatrixTranspose(XMMatrixInverse(nullptr, world))));
-		V(g_gameEffect.worldViewProjectionEV->SetMatrix((float*)&worldViewProj));
-		V(g_gameEffect.lightWorldViewProjEV->SetMatrix((float*)&lightWorldViewProj));
+		V(effect.worldEV->SetMatrix((float*)&world));
+		V(effect.worldNormalsEV->SetMatrix((float*)&XMMatrixTranspose(XMMatrixInverse(nullptr, world))));
+		V(effect.worldViewProjectionEV->SetMatrix((float*)&worldViewProj));
+		V(effect.lightWorldViewProjEV->SetMatrix((float*)&lightWorldViewProj));
+		V(setQuantization(effect));
 		
-		mesh->render(context, g_gameEffect.meshPass, g_gameEffect.diffuseEV, g_gameEffect.specularEV, g_gameEffect.glowEV);
+		float viewportHeight = getViewportHeight(context);
+		mesh->requestTextures(worldViewProj, viewportHeight);
+		mesh->renderCulled(context, mesh->isQuantized() ? effect.meshQuantizedPass : effect.meshPass,
+			worldViewProj, mesh->selectLod(worldViewProj, viewportHeight), effect.diffuseEV, effect.specularEV, effect.glowEV);
 
 		return hr;
 	}
 
-	HRESULT renderDepthOnly(ID3D11DeviceContext* context, const DirectX::XMMATRIX& viewProj) const
+	HRESULT renderDepthOnly(ID3D11DeviceContext* context, const GameEffect& effect, const DirectX::XMMATRIX& viewProj) const
 	{
 		if (!mesh)
 			return S_FALSE;
@@ -71,13 +84,37 @@ public:
 		HRESULT hr;
 
 		DirectX::XMMATRIX worldViewProj = getWorldMatrix() * viewProj;
-		V(g_gameEffect.worldViewProjectionEV->SetMatrix((float*)&worldViewProj));
+		V(effect.worldViewProjectionEV->SetMatrix((float*)&worldViewProj));
+		V(setQuantization(effect));
 
-		mesh->render(context, g_gameEffect.meshShadowPass, g_gameEffect.diffuseEV, g_gameEffect.specularEV, g_gameEffect.glowEV);
+		mesh->renderCulled(context, mesh->isQuantized() ? effect.meshQuantizedShadowPass : effect.meshShadowPass,
+			worldViewProj, mesh->selectLod(worldViewProj, getViewportHeight(context)), effect.diffuseEV, effect.specularEV, effect.glowEV);
 
 		return hr;
 	}
 
+	// Sets the position dequantization of version 2 meshes
+	HRESULT setQuantization(const GameEffect& effect) const
+	{
+		if (!mesh->isQuantized())
+			return S_OK;
+
+		HRESULT hr;
+		V_RETURN(effect.positionMinEV->SetFloatVector((float*)&mesh->getPositionMin()));
+		V_RETURN(effect.positionScaleEV->SetFloatVector((float*)&mesh->getPositionScale()));
+		return S_OK;
+	}
+
+	// Height in pixels of the bound viewport, used to select the level of detail
+	static float getViewportHeight(ID3D11DeviceContext* context)
+	{
+		UINT count = 1;
+		D3D11_VIEWPORT viewport = {};
+		context->RSGetViewports(&count, &viewport);
+		return viewport.Height;
+	}
+#endif
+
 	// Computes the GameObject's transformation matrix
 	DirectX::XMMATRIX getParentMatrix() const
 	{
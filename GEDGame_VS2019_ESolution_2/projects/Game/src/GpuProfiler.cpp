@@ -0,0 +1,152 @@
+#include "GpuProfiler.h"
+
+#include <algorithm>
+
+
+GpuProfiler::GpuProfiler()
+	: current(0), measuring(false)
+{
+	for (auto& frame : frames)
+	{
+		frame.disjoint = nullptr;
+		for (auto& pass : frame.passes)
+			pass = { nullptr, nullptr, nullptr };
+		frame.passCount = 0;
+		frame.cpuBegin = 0;
+		frame.pending = false;
+	}
+}
+
+GpuProfiler::~GpuProfiler()
+{
+	destroy();
+}
+
+HRESULT GpuProfiler::create(ID3D11Device* device)
+{
+	HRESULT hr;
+
+	destroy();
+
+	D3D11_QUERY_DESC disjointDesc = { D3D11_QUERY_TIMESTAMP_DISJOINT, 0 };
+	D3D11_QUERY_DESC timestampDesc = { D3D11_QUERY_TIMESTAMP, 0 };
+	for (auto& frame : frames)
+	{
+		V_RETURN(device->CreateQuery(&disjointDesc, &frame.disjoint));
+		for (auto& pass : frame.passes)
+		{
+			V_RETURN(device->CreateQuery(&timestampDesc, &pass.begin));
+			V_RETURN(device->CreateQuery(&timestampDesc, &pass.end));
+		}
+	}
+
+	return S_OK;
+}
+
+void GpuProfiler::destroy()
+{
+	for (auto& frame : frames)
+	{
+		SAFE_RELEASE(frame.disjoint);
+		for (auto& pass : frame.passes)
+		{
+			SAFE_RELEASE(pass.begin);
+			SAFE_RELEASE(pass.end);
+		}
+		frame.passCount = 0;
+		frame.pending = false;
+	}
+	current = 0;
+	measuring = false;
+}
+
+void GpuProfiler::beginFrame(ID3D11DeviceContext* immediateContext, Profiler& profiler)
+{
+	Frame& frame = frames[current];
+	measuring = frame.disjoint != nullptr && !frame.pending;
+	if (!measuring)
+		return;
+
+	frame.passCount = 0;
+	frame.cpuBegin = profiler.now();
+	immediateContext->Begin(frame.disjoint);
+}
+
+void GpuProfiler::endFrame(ID3D11DeviceContext* immediateContext, Profiler& profiler)
+{
+	if (measuring)
+	{
+		Frame& frame = frames[current];
+		immediateContext->End(frame.disjoint);
+		frame.pending = true;
+		current = (current + 1) % kFrames;
+		measuring = false;
+	}
+
+	// Oldest first, a frame can only be finished if the ones before it are
+	for (uint32_t i = 0; i < kFrames; i++)
+	{
+		Frame& frame = frames[(current + i) % kFrames];
+		if (frame.pending && !readBack(immediateContext, frame, profiler))
+			break;
+	}
+}
+
+uint32_t GpuProfiler::beginPass(ID3D11DeviceContext* context, const char* name)
+{
+	if (!measuring)
+		return kNoPass;
+
+	Frame& frame = frames[current];
+	uint32_t pass = frame.passCount++;
+	if (pass >= kMaxPasses)
+		return kNoPass;
+
+	frame.passes[pass].name = name;
+	context->End(frame.passes[pass].begin);
+	return pass;
+}
+
+void GpuProfiler::endPass(ID3D11DeviceContext* context, uint32_t pass)
+{
+	if (pass != kNoPass)
+		context->End(frames[current].passes[pass].end);
+}
+
+bool GpuProfiler::readBack(ID3D11DeviceContext* immediateContext, Frame& frame, Profiler& profiler)
+{
+	D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint;
+	if (immediateContext->GetData(frame.disjoint, &disjoint, sizeof(disjoint), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+		return false;
+	frame.pending = false;
+
+	// The frequency changed during the frame (e.g. power management), the timestamps are useless
+	if (disjoint.Disjoint)
+		return true;
+
+	uint32_t passCount = std::min(frame.passCount.load(), kMaxPasses);
+	uint64_t begins[kMaxPasses], ends[kMaxPasses];
+	uint64_t first = UINT64_MAX;
+	for (uint32_t i = 0; i < passCount; i++)
+	{
+		// The disjoint query is done, so are the timestamps inside it
+		if (immediateContext->GetData(frame.passes[i].begin, &begins[i], sizeof(uint64_t), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK ||
+			immediateContext->GetData(frame.passes[i].end, &ends[i], sizeof(uint64_t), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+			return true;
+		first = std::min(first, begins[i]);
+	}
+
+	double nsPerTick = 1e9 / static_cast<double>(disjoint.Frequency);
+	for (uint32_t i = 0; i < passCount; i++)
+	{
+		Profiler::Event event;
+		event.name = frame.passes[i].name;
+		event.begin = frame.cpuBegin + static_cast<int64_t>((begins[i] - first) * nsPerTick);
+		event.duration = static_cast<int64_t>((ends[i] - begins[i]) * nsPerTick);
+		event.thread = Profiler::kGpuThread;
+		event.depth = 0;
+		profiler.addEvent(event);
+	}
+
+	return true;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <DXUT.h>
+
+#include <atomic>
+#include <cstdint>
+
+#include "Profiler.h"
+
+
+// Measures GPU passes with D3D11 timestamp queries and adds them to the "GPU" track of a
+// Profiler. The results are read back kFrames frames later without stalling, so the GPU track
+// lags behind the CPU scopes. A pass is placed at the CPU time its frame began plus its GPU
+// offset from the first timestamp of that frame, which only approximates the real GPU start.
+class GpuProfiler
+{
+public:
+	static const uint32_t kFrames = 4;
+	static const uint32_t kMaxPasses = 16; // per frame, further passes are not measured
+	static const uint32_t kNoPass = UINT32_MAX;
+
+	GpuProfiler();
+	~GpuProfiler();
+	GpuProfiler(const GpuProfiler&) = delete;
+	void operator=(const GpuProfiler&) = delete;
+
+	HRESULT create(ID3D11Device* device);
+	void destroy();
+
+	// Brackets a frame on the immediate context. endFrame also reads back the finished frames.
+	void beginFrame(ID3D11DeviceContext* immediateContext, Profiler& profiler);
+	void endFrame(ID3D11DeviceContext* immediateContext, Profiler& profiler);
+
+	// Timestamps around a pass, name has to be a string literal. Passes can be recorded on deferred
+	// contexts by several threads at once, if the command lists are executed within the frame.
+	uint32_t beginPass(ID3D11DeviceContext* context, const char* name);
+	void endPass(ID3D11DeviceContext* context, uint32_t pass);
+
+private:
+	struct Pass
+	{
+		const char* name;
+		ID3D11Query* begin;
+		ID3D11Query* end;
+	};
+
+	struct Frame
+	{
+		ID3D11Query* disjoint;
+		Pass passes[kMaxPasses];
+		std::atomic<uint32_t> passCount;
+		int64_t cpuBegin;
+		bool pending; // issued, but not read back yet
+	};
+
+	// Returns false if the frame is not finished on the GPU yet
+	bool readBack(ID3D11DeviceContext* immediateContext, Frame& frame, Profiler& profiler);
+
+	Frame frames[kFrames];
+	uint32_t current;
+	bool measuring; // false if the GPU is more than kFrames behind, the frame is skipped then
+};
+
+// Times the GPU work recorded on context for the rest of the enclosing block
+class GpuProfileScope
+{
+public:
+	GpuProfileScope(ID3D11DeviceContext* context, const char* name, GpuProfiler& profiler)
+		: context(context), profiler(profiler), pass(profiler.beginPass(context, name))
+	{
+	}
+	~GpuProfileScope() { profiler.endPass(context, pass); }
+	GpuProfileScope(const GpuProfileScope&) = delete;
+	void operator=(const GpuProfileScope&) = delete;
+
+private:
+	ID3D11DeviceContext* context;
+	GpuProfiler& profiler;
+	uint32_t pass;
+};
+
+extern GpuProfiler g_gpuProfiler;
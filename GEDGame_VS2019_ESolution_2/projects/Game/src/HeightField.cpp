@@ -0,0 +1,26 @@
+#include "HeightField.h"
+
+#include <algorithm>
+#include <cassert>
+
+void HeightField::resize(uint64_t width, uint64_t height)
+{
+	this->width = width;
+	this->height = height;
+	samples.resize(width * height);
+}
+
+float HeightField::getHeightAt(float x, float z, const ConfigParser::TerrainOnDisk& terrain) const
+{
+	assert(samples.size() > 0);
+
+	uint64_t u = std::min(
+		static_cast<uint64_t>(std::max((x / terrain.width + 0.5) * width, 0.0)),
+		width - 1);
+	uint64_t v = std::min(
+		static_cast<uint64_t>(std::max((z / terrain.depth + 0.5) * height, 0.0)),
+		height - 1);
+
+	// Without interpolation
+	return samples[u + v * width] * terrain.height;
+}
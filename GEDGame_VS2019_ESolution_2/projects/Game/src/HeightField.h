@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "ConfigParser.h"
+
+
+// The terrain's height samples (0..1) on a width x height grid and the height lookup in world
+// space. It does not use D3D11, Terrain uploads the samples and GameBench queries them headless.
+class HeightField
+{
+public:
+	void resize(uint64_t width, uint64_t height);
+
+	float& at(uint64_t x, uint64_t y) { return samples[x + y * width]; }
+	const std::vector<float>& getSamples() const { return samples; }
+	uint64_t getWidth() const { return width; }
+	uint64_t getHeight() const { return height; }
+
+	// World space height of the sample below x, z, for a terrain centered on the origin
+	float getHeightAt(float x, float z, const ConfigParser::TerrainOnDisk& terrain) const;
+
+private:
+	std::vector<float> samples;
+	uint64_t width = 0;
+	uint64_t height = 0;
+};
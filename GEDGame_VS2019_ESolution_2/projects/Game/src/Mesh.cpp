@@ -1,9 +1,10 @@
 #include "Mesh.h"
 
 #include "T3d.h"
-#include <DDSTextureLoader.h>
+#include "TextureStreamer.h"
 
 ID3D11InputLayout*	Mesh::inputLayout;
+ID3D11InputLayout*	Mesh::quantizedInputLayout;
 
 Mesh::Mesh(const std::string& filename_t3d,
            const std::string& filename_dds_diffuse,
@@ -11,11 +12,13 @@ Mesh::Mesh(const std::string& filename_t3d,
            const std::string& filename_dds_glow)
   : 
 	//Default values for all other member variables
-    vertexBuffer(NULL), indexBuffer(NULL),
-	indexCount(0),
-	diffuseTex(NULL), diffuseSRV(NULL),
-	specularTex(NULL), specularSRV(NULL),
-	glowTex(NULL), glowSRV(NULL)
+    vertexBuffer(NULL), indexBuffer(NULL), culledIndexBuffer(NULL),
+	indexCount(0), vertexStride(sizeof(T3dVertex)), indexFormat(DXGI_FORMAT_R32_UINT),
+	quantized(false), positionMin(0, 0, 0, 0), positionScale(1, 1, 1, 0),
+	boundsCenter(0, 0, 0), boundsRadius(0),
+	diffuseTexture(TextureStreamer::kNoTexture),
+	specularTexture(TextureStreamer::kNoTexture),
+	glowTexture(TextureStreamer::kNoTexture)
 {
 	filenameT3d = std::wstring(filename_t3d.begin(), filename_t3d.end());
 	filenameDDSDiffuse = std::wstring(filename_dds_diffuse.begin(), filename_dds_diffuse.end());
@@ -33,11 +36,13 @@ Mesh::Mesh(const std::wstring& filename_t3d,
 	filenameDDSSpecular(filename_dds_specular),
 	filenameDDSGlow    (filename_dds_glow),
 	//Default values for all other member variables
-    vertexBuffer(NULL), indexBuffer(NULL),
-	indexCount(0),
-	diffuseTex(NULL), diffuseSRV(NULL),
-	specularTex(NULL), specularSRV(NULL),
-	glowTex(NULL), glowSRV(NULL)
+    vertexBuffer(NULL), indexBuffer(NULL), culledIndexBuffer(NULL),
+	indexCount(0), vertexStride(sizeof(T3dVertex)), indexFormat(DXGI_FORMAT_R32_UINT),
+	quantized(false), positionMin(0, 0, 0, 0), positionScale(1, 1, 1, 0),
+	boundsCenter(0, 0, 0), boundsRadius(0),
+	diffuseTexture(TextureStreamer::kNoTexture),
+	specularTexture(TextureStreamer::kNoTexture),
+	glowTexture(TextureStreamer::kNoTexture)
 {
 }
 
@@ -55,17 +60,22 @@ HRESULT Mesh::create(ID3D11Device* device)
 	D3D11_BUFFER_DESC bd = {0};
 
 	//Read mesh
-	std::vector<T3dVertex> vertexBufferData;
-	std::vector<uint32_t> indexBufferData;
+	T3dGeometry geometry;
 
-	V(T3d::readFromFile(filenameT3d.c_str(), vertexBufferData, indexBufferData));
+	V(T3d::readGeometryFromFile(filenameT3d.c_str(), geometry));
 
-	id.pSysMem = &vertexBufferData[0];
-	id.SysMemPitch = sizeof(T3dVertex); // Stride
+	vertexStride = geometry.vertexStride;
+	indexFormat = geometry.indexFormat;
+	quantized = geometry.version == 2;
+	positionMin = geometry.positionMin;
+	positionScale = geometry.positionScale;
+
+	id.pSysMem = &geometry.vertexBufferData[0];
+	id.SysMemPitch = vertexStride; // Stride
     id.SysMemSlicePitch = 0;
 
     bd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-	bd.ByteWidth = vertexBufferData.size() * static_cast<int>(sizeof(T3dVertex));
+	bd.ByteWidth = static_cast<UINT>(geometry.vertexBufferData.size());
     bd.CPUAccessFlags = 0;
     bd.MiscFlags = 0;
     bd.Usage = D3D11_USAGE_DEFAULT;
@@ -73,27 +83,45 @@ HRESULT Mesh::create(ID3D11Device* device)
 	V(device->CreateBuffer(&bd, &id, &vertexBuffer));
 
 
-	indexCount = indexBufferData.size();
+	indexCount = geometry.indexCount;
+
+	// The simplified levels follow level 0 in the index buffer
+	lods = geometry.lods;
+	if (!lods.empty())
+		indexCount = lods[0].indexCount;
+
+	DirectX::XMVECTOR extent = DirectX::XMVectorScale(DirectX::XMLoadFloat4(&positionScale), 0.5f);
+	DirectX::XMStoreFloat3(&boundsCenter, DirectX::XMVectorAdd(DirectX::XMLoadFloat4(&positionMin), extent));
+	boundsRadius = DirectX::XMVectorGetX(DirectX::XMVector3Length(extent));
 
 	ZeroMemory(&bd, sizeof(bd));
 	bd.Usage = D3D11_USAGE_DEFAULT;
-	bd.ByteWidth = sizeof(unsigned int) * indexCount;
+	bd.ByteWidth = static_cast<UINT>(geometry.indexBufferData.size());
 	bd.BindFlags = D3D11_BIND_INDEX_BUFFER;
 	bd.CPUAccessFlags = 0;
 	bd.MiscFlags = 0;
 	// Define initial data
 
 	ZeroMemory(&id, sizeof(id));
-	id.pSysMem = &indexBufferData[0];
+	id.pSysMem = &geometry.indexBufferData[0];
 	// Create Buffer
 	V(device->CreateBuffer( &bd, &id, &indexBuffer ));
 
+	// Dynamic index buffer for the visible clusters, rewritten for every culled draw
+	clusters = geometry.clusters;
+	if (clusters.size() > 1) {
+		indexData = geometry.indexBufferData;
+
+		bd.Usage = D3D11_USAGE_DYNAMIC;
+		bd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		V(device->CreateBuffer( &bd, nullptr, &culledIndexBuffer ));
+	}
 
 
 	// Create textures
-	V(createTexture(device, filenameDDSDiffuse, &diffuseTex, &diffuseSRV)	);
-	V(createTexture(device, filenameDDSSpecular, &specularTex, &specularSRV));
-	V(createTexture(device, filenameDDSGlow, &glowTex, &glowSRV)			);
+	V(g_textureStreamer.load(filenameDDSDiffuse, &diffuseTexture)	);
+	V(g_textureStreamer.load(filenameDDSSpecular, &specularTexture));
+	V(g_textureStreamer.load(filenameDDSGlow, &glowTexture)		);
 
 
 	return S_OK;
@@ -103,30 +131,132 @@ void Mesh::destroy()
 {
 	SAFE_RELEASE(vertexBuffer);
 	SAFE_RELEASE(indexBuffer );
-	SAFE_RELEASE(diffuseTex	 );
-	SAFE_RELEASE(diffuseSRV	 );
-	SAFE_RELEASE(specularTex );
-	SAFE_RELEASE(specularSRV );
-	SAFE_RELEASE(glowTex	 );
-	SAFE_RELEASE(glowSRV	 );
+	SAFE_RELEASE(culledIndexBuffer);
+	diffuseTexture = TextureStreamer::kNoTexture;
+	specularTexture = TextureStreamer::kNoTexture;
+	glowTexture = TextureStreamer::kNoTexture;
 }
 
-HRESULT Mesh::createInputLayout(ID3D11Device* device, ID3DX11EffectPass* pass)
+HRESULT Mesh::createInputLayout(ID3D11Device* device, ID3DX11EffectPass* pass, ID3DX11EffectPass* quantizedPass)
 {
 	HRESULT hr;
 	V(T3d::createT3dInputLayout(device, pass, &inputLayout));
+	V(T3d::createT3dInputLayout(device, quantizedPass, &quantizedInputLayout, true));
 	return S_OK;
 }
 
 void Mesh::destroyInputLayout()
 {
 	SAFE_RELEASE(inputLayout);
+	SAFE_RELEASE(quantizedInputLayout);
 }
 
 HRESULT Mesh::render(ID3D11DeviceContext* context, ID3DX11EffectPass* pass, 
         ID3DX11EffectShaderResourceVariable* diffuseEffectVariable,
         ID3DX11EffectShaderResourceVariable* specularEffectVariable,
         ID3DX11EffectShaderResourceVariable* glowEffectVariable)
+{
+	return draw(context, pass, indexBuffer, 0, indexCount, diffuseEffectVariable, specularEffectVariable, glowEffectVariable);
+}
+
+float Mesh::getPixelsPerUnit(const DirectX::XMMATRIX& worldViewProj, float viewportHeight) const
+{
+	DirectX::XMFLOAT4X4 m;
+	DirectX::XMStoreFloat4x4(&m, worldViewProj);
+
+	// Clip w of the nearest point of the bounding sphere. Column 3 maps object space to view depth,
+	// its length is the object to view scale (zero for orthographic projections).
+	DirectX::XMVECTOR center = DirectX::XMVector3Transform(DirectX::XMLoadFloat3(&boundsCenter), worldViewProj);
+	float depthScale = sqrtf(m._14 * m._14 + m._24 * m._24 + m._34 * m._34);
+	float w = DirectX::XMVectorGetW(center) - boundsRadius * depthScale;
+	if (w <= 1e-6f)
+		return 0;
+
+	// Pixels per object space unit in y direction
+	float yScale = sqrtf(m._12 * m._12 + m._22 * m._22 + m._32 * m._32);
+	return yScale / w * viewportHeight * 0.5f;
+}
+
+size_t Mesh::selectLod(const DirectX::XMMATRIX& worldViewProj, float viewportHeight, float maxPixelError) const
+{
+	if (lods.size() < 2 || viewportHeight <= 0)
+		return 0;
+
+	float pixelsPerUnit = getPixelsPerUnit(worldViewProj, viewportHeight);
+	if (pixelsPerUnit == 0)
+		return 0;
+
+	for (size_t lod = lods.size() - 1; lod > 0; lod--)
+		if (lods[lod].error * pixelsPerUnit <= maxPixelError)
+			return lod;
+	return 0;
+}
+
+void Mesh::requestTextures(const DirectX::XMMATRIX& worldViewProj, float viewportHeight) const
+{
+	// The texture is assumed to be spread over the diameter of the mesh
+	float pixelsPerUnit = getPixelsPerUnit(worldViewProj, viewportHeight);
+	for (size_t texture : { diffuseTexture, specularTexture, glowTexture }) {
+		if (pixelsPerUnit == 0)
+			g_textureStreamer.requestMip(texture, 0);
+		else
+			g_textureStreamer.requestScreenSize(texture, 2 * boundsRadius * pixelsPerUnit);
+	}
+}
+
+HRESULT Mesh::renderCulled(ID3D11DeviceContext* context, ID3DX11EffectPass* pass, 
+        const DirectX::XMMATRIX& worldViewProj, size_t lod,
+        ID3DX11EffectShaderResourceVariable* diffuseEffectVariable,
+        ID3DX11EffectShaderResourceVariable* specularEffectVariable,
+        ID3DX11EffectShaderResourceVariable* glowEffectVariable)
+{
+	HRESULT hr;
+
+	// Clusters only cover level 0
+	if (lod > 0 && lod < lods.size())
+		return draw(context, pass, indexBuffer, lods[lod].indexOffset, lods[lod].indexCount,
+			diffuseEffectVariable, specularEffectVariable, glowEffectVariable);
+
+	if (culledIndexBuffer == nullptr)
+		return render(context, pass, diffuseEffectVariable, specularEffectVariable, glowEffectVariable);
+
+	// The planes of the world view projection matrix are in object space
+	DirectX::XMFLOAT4X4 m;
+	DirectX::XMStoreFloat4x4(&m, worldViewProj);
+	MeshTools::Frustum frustum = MeshTools::extractFrustum(&m._11);
+
+	// The camera is the point which is projected to (0, 0, z, 0). For orthographic
+	// projections (shadow map) it is at infinity and only the frustum is tested.
+	DirectX::XMVECTOR eye = DirectX::XMVector4Transform(DirectX::XMVectorSet(0, 0, 1, 0),
+		DirectX::XMMatrixInverse(nullptr, worldViewProj));
+	float w = DirectX::XMVectorGetW(eye);
+	bool perspective = fabsf(w) > 1e-6f;
+	DirectX::XMFLOAT3 cameraPos(0, 0, 0);
+	if (perspective)
+		DirectX::XMStoreFloat3(&cameraPos, DirectX::XMVectorScale(eye, 1.0f / w));
+
+	// The shadow and the main pass may be recorded at the same time on different threads
+	static thread_local std::vector<uint32_t> visibleClusters;
+	size_t visible = MeshTools::cullClusters(clusters, frustum, perspective ? &cameraPos.x : nullptr, visibleClusters);
+	if (visible == 0)
+		return S_OK;
+	if (visible == clusters.size())
+		return render(context, pass, diffuseEffectVariable, specularEffectVariable, glowEffectVariable);
+
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	V_RETURN(context->Map(culledIndexBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped));
+	size_t count = MeshTools::compactIndices(clusters, visibleClusters, indexData.data(),
+		indexFormat == DXGI_FORMAT_R16_UINT ? sizeof(uint16_t) : sizeof(uint32_t), mapped.pData);
+	context->Unmap(culledIndexBuffer, 0);
+
+	return draw(context, pass, culledIndexBuffer, 0, count, diffuseEffectVariable, specularEffectVariable, glowEffectVariable);
+}
+
+HRESULT Mesh::draw(ID3D11DeviceContext* context, ID3DX11EffectPass* pass, 
+        ID3D11Buffer* indices, size_t startIndex, size_t count,
+        ID3DX11EffectShaderResourceVariable* diffuseEffectVariable,
+        ID3DX11EffectShaderResourceVariable* specularEffectVariable,
+        ID3DX11EffectShaderResourceVariable* glowEffectVariable)
 {
 	HRESULT hr;
 
@@ -143,23 +273,23 @@ HRESULT Mesh::render(ID3D11DeviceContext* context, ID3DX11EffectPass* pass,
         throw std::exception("Diffuse EV is null or invalid");
     }
 
-	V(diffuseEffectVariable->SetResource(diffuseSRV));
-	V(specularEffectVariable->SetResource(specularSRV));
-	V(glowEffectVariable->SetResource(glowSRV));
+	V(diffuseEffectVariable->SetResource(g_textureStreamer.getSRV(diffuseTexture)));
+	V(specularEffectVariable->SetResource(g_textureStreamer.getSRV(specularTexture)));
+	V(glowEffectVariable->SetResource(g_textureStreamer.getSRV(glowTexture)));
 
 	// Bind the terrain vertex buffer to the input assembler stage 
 	ID3D11Buffer* vbs[] = { vertexBuffer, };
-    unsigned int strides[] = {sizeof(T3dVertex), }, offsets[] = { 0, };
+    unsigned int strides[] = {vertexStride, }, offsets[] = { 0, };
     context->IASetVertexBuffers(0, 1, vbs, strides, offsets);
-	context->IASetIndexBuffer(indexBuffer, DXGI_FORMAT_R32_UINT, 0 );
+	context->IASetIndexBuffer(indices, indexFormat, 0 );
 
     // Tell the input assembler stage which primitive topology to use
     context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-	context->IASetInputLayout(inputLayout);
+	context->IASetInputLayout(quantized ? quantizedInputLayout : inputLayout);
 
 	V(pass->Apply(0, context));
 
-	context->DrawIndexed(indexCount, 0, 0);
+	context->DrawIndexed(count, startIndex, 0);
 
 	return S_OK;
 	
@@ -178,16 +308,3 @@ HRESULT Mesh::loadFile(const char * filename, std::vector<uint8_t>& data)
 	fclose(filePointer);
 	return S_OK;
 }
-
-HRESULT Mesh::createTexture(ID3D11Device* device, const std::wstring& filename, ID3D11Texture2D** tex, 
-					  ID3D11ShaderResourceView** srv)
-{
-	if (filename == L"" || filename == L"-")
-		return S_OK;
-
-	HRESULT hr;
-    V_RETURN(DirectX::CreateDDSTextureFromFile(device, filename.c_str(), (ID3D11Resource**)tex, srv));
-
-	return S_OK;
-
-}
\ No newline at end of file
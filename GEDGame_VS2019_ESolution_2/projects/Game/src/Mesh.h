@@ -7,6 +7,8 @@
 #include <cstdint>
 #include <string>
 
+#include "Clusters.h"
+
 
 //This class ecapsulates the D3D11 resources needed for a mesh
 class Mesh
@@ -36,9 +38,9 @@ public:
 	//This destructor should be called from within OnD3D11DestroyDevice().
 	void destroy();
 
-	// Creates an input layout which is used for meshes
+	// Creates the input layouts which are used for meshes and quantized (version 2) meshes
 	static HRESULT createInputLayout(ID3D11Device* device, 
-		ID3DX11EffectPass* pass);
+		ID3DX11EffectPass* pass, ID3DX11EffectPass* quantizedPass);
 
 	// Releases the input layout
 	static void destroyInputLayout();
@@ -49,13 +51,40 @@ public:
         ID3DX11EffectShaderResourceVariable* specularEffectVariable,
         ID3DX11EffectShaderResourceVariable* glowEffectVariable);
 
+	// Render only the clusters inside the frustum of worldViewProj which, for perspective projections,
+	// are not facing away from the camera. Meshes without clusters are rendered completely.
+	// Levels of detail above 0 have no clusters and are always rendered completely.
+	HRESULT renderCulled(ID3D11DeviceContext* context, ID3DX11EffectPass* pass,
+        const DirectX::XMMATRIX& worldViewProj, size_t lod,
+        ID3DX11EffectShaderResourceVariable* diffuseEffectVariable,
+        ID3DX11EffectShaderResourceVariable* specularEffectVariable,
+        ID3DX11EffectShaderResourceVariable* glowEffectVariable);
+
+	// Selects the coarsest level of detail whose simplification error, projected with worldViewProj
+	// into a viewport of the given height, stays below maxPixelError pixels
+	size_t selectLod(const DirectX::XMMATRIX& worldViewProj, float viewportHeight, float maxPixelError = 1.0f) const;
+
+	// Requests the texture detail for the projected size of the mesh from the texture streamer
+	void requestTextures(const DirectX::XMMATRIX& worldViewProj, float viewportHeight) const;
+
+	// Quantized meshes must be rendered with a quantized pass and the position dequantization set
+	bool isQuantized() const { return quantized; }
+	const DirectX::XMFLOAT4& getPositionMin() const { return positionMin; }
+	const DirectX::XMFLOAT4& getPositionScale() const { return positionScale; }
+
 private:
+	// Binds the textures and buffers and draws count indices of the given index buffer from startIndex on
+	HRESULT draw(ID3D11DeviceContext* context, ID3DX11EffectPass* pass,
+        ID3D11Buffer* indices, size_t startIndex, size_t count,
+        ID3DX11EffectShaderResourceVariable* diffuseEffectVariable,
+        ID3DX11EffectShaderResourceVariable* specularEffectVariable,
+        ID3DX11EffectShaderResourceVariable* glowEffectVariable);
+
+	// Projected pixels per object space unit at the nearest point of the bounds, 0 if the camera is inside them
+	float getPixelsPerUnit(const DirectX::XMMATRIX& worldViewProj, float viewportHeight) const;
+
 	//Reads the complete file given by "path" byte-wise into "data".
 	static HRESULT loadFile(const char * filename, std::vector<uint8_t>& data);
-
-	// Creates DX Texture Resources from File
-	static HRESULT createTexture(ID3D11Device* device, const std::wstring& filename, 
-		ID3D11Texture2D** tex, ID3D11ShaderResourceView** srv);
 	
 private:
 	//Filenames
@@ -67,16 +96,30 @@ private:
 	//Mesh geometry information
 	ID3D11Buffer*               vertexBuffer;
 	ID3D11Buffer*               indexBuffer;
-	size_t                      indexCount; //number of single indices in indexBuffer (needed for DrawIndexed())
+	size_t                      indexCount; //number of single indices of level of detail 0 in indexBuffer (needed for DrawIndexed())
+	UINT                        vertexStride;
+	DXGI_FORMAT                 indexFormat; //R32_UINT, or R16_UINT for small quantized meshes
+	bool                        quantized;
+	DirectX::XMFLOAT4           positionMin;
+	DirectX::XMFLOAT4           positionScale;
+
+	//Culling clusters with a CPU copy of the indices, the visible ones are compacted into culledIndexBuffer.
+	//The buffer is dynamic, so each (deferred) context mapping it gets its own copy.
+	std::vector<MeshTools::Cluster> clusters;
+	std::vector<uint8_t>        indexData;
+	ID3D11Buffer*               culledIndexBuffer;
+
+	//Levels of detail, their index ranges follow each other in indexBuffer
+	std::vector<MeshTools::LodLevel> lods;
+	DirectX::XMFLOAT3           boundsCenter;
+	float                       boundsRadius;
 
-	//Mesh textures and corresponding shader resource views
-	ID3D11Texture2D*            diffuseTex;
-	ID3D11ShaderResourceView*   diffuseSRV;
-	ID3D11Texture2D*            specularTex;
-	ID3D11ShaderResourceView*   specularSRV;
-	ID3D11Texture2D*	        glowTex;
-	ID3D11ShaderResourceView*   glowSRV;
+	//Mesh textures, owned by the texture streamer (kNoTexture if not used)
+	size_t                      diffuseTexture;
+	size_t                      specularTexture;
+	size_t                      glowTexture;
 
-	//Mesh Input layout
+	//Mesh Input layouts
 	static ID3D11InputLayout*	inputLayout;
+	static ID3D11InputLayout*	quantizedInputLayout;
 };
\ No newline at end of file
@@ -2,8 +2,10 @@
 
 #include <DirectXMath.h>
 
-#include "GameEffect.h"
-#include "SpriteRenderer.h"
+#include <cstdlib>
+#include <vector>
+
+#include "SpriteVertex.h"
 
 class Sprite
 {
@@ -11,11 +13,11 @@ public:
 	DirectX::XMVECTOR position = { 0, 0, 0 };
 	int spriteIndex = -1;
 	float size = 1;
-	float camera_distance = 0;
+	float startTime = 0; // the flipbook frames are computed from this on the GPU
 
 	virtual void update(const float fElapsedTime, const DirectX::XMVECTOR& gravity_vector) = 0;
 
-	SpriteVertex GetSpriteVertex(const DirectX::XMVECTOR& camera_ahead, const DirectX::XMVECTOR& offset = { 0, 0, 0 })
+	SpriteVertex GetSpriteVertex(const DirectX::XMVECTOR& offset = { 0, 0, 0 }) const
 	{
 		using namespace DirectX;
 
@@ -23,11 +25,18 @@ public:
 
 		XMStoreFloat3(&vert.position, position + offset);
 		vert.radius = size;
-		vert.textureIndex = spriteIndex;
-		vert.camera_distance = DirectX::XMVectorGetX(DirectX::XMVector3Dot(position, camera_ahead));
+		vert.startTime = startTime;
+		vert.flipbook = static_cast<uint16_t>(spriteIndex);
 
 		return vert;
 	}
+
+	float GetCameraDistance(const DirectX::XMVECTOR& camera_ahead, const DirectX::XMVECTOR& offset = { 0, 0, 0 }) const
+	{
+		using namespace DirectX;
+
+		return XMVectorGetX(XMVector3Dot(position + offset, camera_ahead));
+	}
 };
 
 class Projectile : public Sprite
@@ -56,6 +65,7 @@ public:
 	public:
 		DirectX::XMVECTOR velocity = { 0, 0, 0 };
 
+		// Particles are only drawn during their lifetime
 		float time = 0;
 		float duration = 1;
 
@@ -88,6 +98,7 @@ public:
 		{
 			// rand() is good enough for explosion particles
 			p.spriteIndex = spriteIndex;
+			p.startTime = startTime;
 			p.duration = (maxLifetime - minLifetime) * static_cast<float>(rand()) / RAND_MAX + minLifetime;
 			p.velocity = DirectX::XMVector3Normalize({
 				static_cast<float>(rand()) / RAND_MAX - 0.5f,
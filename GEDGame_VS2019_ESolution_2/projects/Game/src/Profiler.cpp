@@ -0,0 +1,159 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <utility>
+
+namespace
+{
+	std::atomic<uint32_t> nextProfilerId(1);
+
+	void writeJsonString(std::ostream& stream, const char* text)
+	{
+		stream << '"';
+		for (const char* c = text; *c; c++)
+		{
+			if (*c == '"' || *c == '\\')
+				stream << '\\' << *c;
+			else if (static_cast<unsigned char>(*c) < 0x20)
+				stream << ' ';
+			else
+				stream << *c;
+		}
+		stream << '"';
+	}
+
+	void writeThreadName(std::ostream& stream, uint32_t thread, const char* name)
+	{
+		stream << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << thread << ",\"args\":{\"name\":";
+		writeJsonString(stream, name);
+		stream << "}}";
+	}
+}
+
+Profiler::Profiler()
+	: start(std::chrono::steady_clock::now()), id(nextProfilerId++), droppedCount(0)
+{
+}
+
+Profiler::~Profiler()
+{
+}
+
+int64_t Profiler::now() const
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+void Profiler::setThreadName(const std::string& name)
+{
+	ThreadBuffer& buffer = getThreadBuffer();
+	std::lock_guard<std::mutex> lock(mutex);
+	buffer.name = name;
+}
+
+void Profiler::addEvent(const Event& event)
+{
+	push(getThreadBuffer(), event);
+}
+
+void Profiler::collect()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	for (auto& buffer : threads)
+	{
+		uint64_t read = buffer->read.load(std::memory_order_relaxed);
+		uint64_t written = buffer->written.load(std::memory_order_acquire);
+		for (; read < written; read++)
+			history.push_back(buffer->events[read % kThreadEvents]);
+		// Hands the slots back to the writer
+		buffer->read.store(read, std::memory_order_release);
+	}
+
+	while (history.size() > kHistoryEvents)
+		history.pop_front();
+}
+
+double Profiler::getLastMilliseconds(const std::string& name, bool gpu) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	for (auto event = history.rbegin(); event != history.rend(); ++event)
+		if ((event->thread == kGpuThread) == gpu && name == event->name)
+			return event->duration * 1e-6;
+	return 0;
+}
+
+void Profiler::writeChromeTrace(std::ostream& stream) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	// Timestamps and durations are in microseconds
+	stream << std::fixed << std::setprecision(3);
+	stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+	writeThreadName(stream, kGpuThread, "GPU");
+	for (const auto& buffer : threads)
+	{
+		stream << ",\n";
+		writeThreadName(stream, buffer->thread,
+			buffer->name.empty() ? ("Thread " + std::to_string(buffer->thread)).c_str() : buffer->name.c_str());
+	}
+
+	for (const Event& event : history)
+	{
+		stream << ",\n{\"name\":";
+		writeJsonString(stream, event.name);
+		stream << ",\"ph\":\"X\",\"pid\":0,\"tid\":" << event.thread
+			<< ",\"ts\":" << event.begin * 1e-3 << ",\"dur\":" << event.duration * 1e-3
+			<< ",\"args\":{\"depth\":" << event.depth << "}}";
+	}
+
+	stream << "\n]}\n";
+}
+
+Profiler::ThreadBuffer& Profiler::getThreadBuffer()
+{
+	// Profiler ids are never reused, so entries of destroyed profilers are never found again
+	thread_local std::vector<std::pair<uint32_t, ThreadBuffer*>> buffers;
+	for (const auto& entry : buffers)
+		if (entry.first == id)
+			return *entry.second;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	threads.push_back(std::make_unique<ThreadBuffer>());
+	ThreadBuffer* buffer = threads.back().get();
+	buffer->thread = static_cast<uint32_t>(threads.size() - 1);
+	buffers.emplace_back(id, buffer);
+	return *buffer;
+}
+
+void Profiler::push(ThreadBuffer& buffer, const Event& event)
+{
+	uint64_t written = buffer.written.load(std::memory_order_relaxed);
+	if (written - buffer.read.load(std::memory_order_acquire) >= kThreadEvents)
+	{
+		droppedCount++;
+		return;
+	}
+
+	buffer.events[written % kThreadEvents] = event;
+	// Publishes the event to collect
+	buffer.written.store(written + 1, std::memory_order_release);
+}
+
+
+ProfileScope::ProfileScope(const char* name, Profiler& profiler)
+	: profiler(profiler), buffer(profiler.getThreadBuffer()), name(name)
+{
+	depth = buffer.depth++;
+	begin = profiler.now();
+}
+
+ProfileScope::~ProfileScope()
+{
+	int64_t end = profiler.now();
+	buffer.depth--;
+	profiler.push(buffer, { name, begin, end - begin, buffer.thread, depth });
+}
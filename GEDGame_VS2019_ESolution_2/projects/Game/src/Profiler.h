@@ -0,0 +1,113 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+
+// Records named and nested CPU time spans (scopes) of any thread, plus the GPU pass times which
+// GpuProfiler adds, and writes them as Chrome trace JSON (chrome://tracing, ui.perfetto.dev).
+// Only uses the standard library, so it can be used (and tested) without a D3D11 device.
+//
+// Every thread writes its finished scopes into a ring buffer of its own, without locking.
+// collect() moves them into the history, which keeps the most recent kHistoryEvents.
+// If a thread records more than kThreadEvents scopes between two collects, the rest is dropped.
+class Profiler
+{
+public:
+	static const size_t kThreadEvents = 4096;
+	static const size_t kHistoryEvents = 1 << 16;
+	// Track of the GPU passes in the trace
+	static const uint32_t kGpuThread = UINT32_MAX;
+
+	struct Event
+	{
+		const char* name;  // not copied, has to outlive the profiler (string literals)
+		int64_t begin;     // ns since the profiler was created
+		int64_t duration;  // ns
+		uint32_t thread;   // registration order of the thread, or kGpuThread
+		uint32_t depth;    // number of enclosing scopes on the same thread
+	};
+
+	Profiler();
+	~Profiler();
+	Profiler(const Profiler&) = delete;
+	void operator=(const Profiler&) = delete;
+
+	// ns since the profiler was created, steady_clock is QueryPerformanceCounter on Windows
+	int64_t now() const;
+
+	// Names the calling thread's track in the trace
+	void setThreadName(const std::string& name);
+
+	// Adds a finished event, e.g. a GPU pass, to the calling thread's buffer
+	void addEvent(const Event& event);
+
+	// Moves the recorded events of all threads into the history. Call once per frame.
+	void collect();
+
+	// Duration in ms of the latest collected event with this name on a CPU thread, or on the GPU. 0 if there is none.
+	double getLastMilliseconds(const std::string& name, bool gpu = false) const;
+
+	size_t getDroppedCount() const { return droppedCount; }
+
+	// Writes the history as a Chrome trace JSON object
+	void writeChromeTrace(std::ostream& stream) const;
+
+private:
+	friend class ProfileScope;
+
+	// Single producer (the owning thread), single consumer (collect) ring buffer
+	struct ThreadBuffer
+	{
+		uint32_t thread;
+		uint32_t depth = 0;
+		std::string name;
+		Event events[kThreadEvents];
+		std::atomic<uint64_t> written{ 0 };
+		std::atomic<uint64_t> read{ 0 };
+	};
+
+	// The calling thread's buffer, registered on first use
+	ThreadBuffer& getThreadBuffer();
+	void push(ThreadBuffer& buffer, const Event& event);
+
+	const std::chrono::steady_clock::time_point start;
+	const uint32_t id; // tells the profilers apart in the thread local buffer lookup
+
+	mutable std::mutex mutex;
+	std::vector<std::unique_ptr<ThreadBuffer>> threads;
+	std::deque<Event> history;
+	std::atomic<size_t> droppedCount;
+};
+
+// Times the enclosing block on the calling thread
+class ProfileScope
+{
+public:
+	explicit ProfileScope(const char* name, Profiler& profiler);
+	~ProfileScope();
+	ProfileScope(const ProfileScope&) = delete;
+	void operator=(const ProfileScope&) = delete;
+
+private:
+	Profiler& profiler;
+	Profiler::ThreadBuffer& buffer;
+	const char* name;
+	int64_t begin;
+	uint32_t depth;
+};
+
+#define PROFILE_SCOPE_CONCAT2(a, b) a##b
+#define PROFILE_SCOPE_CONCAT(a, b) PROFILE_SCOPE_CONCAT2(a, b)
+// Times the rest of the enclosing block with g_profiler, name has to be a string literal
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_SCOPE_CONCAT(profileScope, __LINE__)(name, g_profiler)
+
+extern Profiler g_profiler;
@@ -0,0 +1,257 @@
+#include "Simulation.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+#include "ConfigParser.h"
+
+using namespace DirectX;
+
+namespace
+{
+	std::shared_ptr<Mesh> findMesh(const Simulation::MeshMap* meshes, const std::string& identifier)
+	{
+		if (meshes == nullptr)
+			return nullptr;
+
+		auto mesh_it = meshes->find(identifier);
+		if (mesh_it != meshes->end())
+			return mesh_it->second;
+
+		std::cerr << "ERROR: Mesh with identifier " << identifier << " could not be found\n";
+		return nullptr;
+	}
+}
+
+void Simulation::createPrototypes(const MeshMap* meshes, std::vector<std::wstring>& spriteNames)
+{
+	// https://en.wikipedia.org/wiki/Prototype_pattern
+	for (auto& e : g_ConfigParser.get_Enemies())
+	{
+		auto new_enemy = std::make_shared<EnemyObject>();
+
+		new_enemy->position = { e.pos_x, e.pos_y, e.pos_z };
+		new_enemy->rotation = { XMConvertToRadians(e.rot_x), XMConvertToRadians(e.rot_y), XMConvertToRadians(e.rot_z) };
+		new_enemy->scale = { e.scale, e.scale, e.scale };
+
+		new_enemy->health = e.hp;
+		new_enemy->velocity = { e.speed, e.speed, e.speed };
+		new_enemy->size = e.size * e.scale;
+
+		new_enemy->mesh = findMesh(meshes, e.meshIdentifier);
+
+		enemyPrototypes.push_back(new_enemy);
+	}
+
+	for (auto& p : g_ConfigParser.get_Projectiles())
+	{
+		auto new_proj = std::make_shared<Projectile>();
+
+		new_proj->velocity = { p.projectileSpeed, p.projectileSpeed, p.projectileSpeed };
+
+		new_proj->damage = p.damage;
+		new_proj->useGravity = p.gravity;
+
+		new_proj->size = p.spriteSize;
+		new_proj->spriteIndex = static_cast<int>(spriteNames.size());
+
+		spriteNames.push_back(std::wstring(p.spriteName.begin(), p.spriteName.end()));
+		projectilePrototypes.emplace(p.identifier, new_proj);
+	}
+
+	const auto& explosion = g_ConfigParser.get_Explosion();
+	explosionPrototype = std::make_unique<Explosion>(static_cast<int>(spriteNames.size()), explosion.particle_count);
+	explosionPrototype->size = explosion.scale;
+	explosionPrototype->duration = explosion.duration;
+
+	spriteNames.push_back(std::wstring(explosion.spriteName.begin(), explosion.spriteName.end()));
+}
+
+void Simulation::createWeapons(const MeshMap* meshes, const std::vector<std::shared_ptr<MeshObject>>& parents)
+{
+	for (auto& w : g_ConfigParser.get_Weapons())
+	{
+		auto new_weaponObject = std::make_shared<WeaponObject>();
+
+		new_weaponObject->mesh = findMesh(meshes, w.meshIdentifer);
+
+		for (auto& o : parents)
+			if (o->name == w.parentIdentifier)
+				new_weaponObject->parent = o;
+
+		auto proj_it = projectilePrototypes.find(w.projectile_identifier);
+		if (proj_it != projectilePrototypes.end())
+			new_weaponObject->projectile = proj_it->second;
+		else
+			std::cerr << "ERROR: Projectile with identifier " << w.projectile_identifier << " could not be found\n";
+
+		new_weaponObject->cooldown = 1.0f / w.firerate;
+		new_weaponObject->spawnpoint = { w.spawnpoint_x, w.spawnpoint_y, w.spawnpoint_z };
+
+		weapons.push_back(new_weaponObject);
+	}
+}
+
+void Simulation::clear()
+{
+	enemies.clear();
+	projectiles.clear();
+	explosions.clear();
+	weapons.clear();
+	enemyPrototypes.clear();
+	projectilePrototypes.clear();
+	explosionPrototype = nullptr;
+}
+
+const char* Simulation::getPhaseName(Phase phase)
+{
+	static const char* names[PHASE_COUNT] = { "enemies", "projectiles", "weapons", "collisions", "explosions" };
+	return phase < PHASE_COUNT ? names[phase] : "";
+}
+
+void Simulation::update(float time, float elapsedTime, const XMVECTOR& aimDirection, const XMVECTOR& gravity,
+	const PhaseHook& hook)
+{
+	// A generic lambda, a std::function could allocate every frame
+	auto run = [&hook](Phase phase, auto&& update)
+	{
+		if (hook)
+			hook(phase, true);
+		update();
+		if (hook)
+			hook(phase, false);
+	};
+
+	run(PHASE_ENEMIES, [&] { updateEnemies(time, elapsedTime); });
+	run(PHASE_PROJECTILES, [&] { updateProjectiles(elapsedTime, gravity); });
+	run(PHASE_WEAPONS, [&] { fireWeapons(elapsedTime, aimDirection); });
+	run(PHASE_COLLISIONS, [&] { collideProjectiles(); });
+	run(PHASE_EXPLOSIONS, [&] { updateExplosions(elapsedTime, gravity); });
+}
+
+void Simulation::updateEnemies(float time, float elapsedTime)
+{
+	// Remove enemies
+	enemies.remove_if(
+		[this, time] (const EnemyObject& e)
+		{
+			if (e.health <= 0)
+			{
+				const auto& explosion = g_ConfigParser.get_Explosion();
+				explosions.push_back(*explosionPrototype);
+				explosions.back().position = e.position;
+				explosions.back().size *= e.size;
+				explosions.back().startTime = time;
+				explosions.back().Init(
+					explosion.particle_min_velocity,
+					explosion.particle_max_velocity,
+					explosion.particle_min_lifetime,
+					explosion.particle_max_lifetime);
+				return true;
+			}
+			return XMVectorGetX(XMVector3LengthEst(e.position)) > g_ConfigParser.get_SpawnBehaviour().despawn_radius;
+		});
+	// Update enemies
+	for (auto& e : enemies)
+		e.update(elapsedTime);
+	// Spawn enemies
+	timeSinceLastEnemy += elapsedTime;
+	if (timeSinceLastEnemy > g_ConfigParser.get_SpawnBehaviour().interval)
+	{
+		spawnEnemy();
+		timeSinceLastEnemy -= g_ConfigParser.get_SpawnBehaviour().interval;
+	}
+}
+
+void Simulation::spawnEnemy()
+{
+	if (enemyPrototypes.empty())
+		return;
+
+	int rand_num = rand() % enemyPrototypes.size();
+
+	// Uses the copy constructor to copy the prototype in its current state
+	enemies.push_back(*enemyPrototypes[rand_num]);
+	EnemyObject& enemy = enemies.back();
+
+	enemy.type = enemyPrototypes[rand_num];
+
+	const auto& spawn = g_ConfigParser.get_SpawnBehaviour();
+	float spawn_circle = XM_2PI * static_cast<float>(rand()) / RAND_MAX;
+	float spawn_height = (static_cast<float>(rand()) / RAND_MAX)
+		* (spawn.max_height - spawn.min_height)
+		+ spawn.min_height;
+	float target_cicle = XM_2PI * static_cast<float>(rand()) / RAND_MAX;
+	XMVECTOR target_pos = {
+		spawn.target_radius * std::sin(target_cicle),
+		spawn_height * g_ConfigParser.get_terrain().height,
+		spawn.target_radius * std::cos(target_cicle) };
+
+	enemy.position = {
+		spawn.spawn_radius * std::sin(spawn_circle),
+		spawn_height * g_ConfigParser.get_terrain().height,
+		spawn.spawn_radius * std::cos(spawn_circle) };
+
+	enemy.velocity *= XMVector3Normalize(target_pos - enemy.position);
+
+	enemy.rotation = {
+		0.0f,
+		std::atan2(XMVectorGetX(enemy.velocity), XMVectorGetZ(enemy.velocity)),
+		0.0f };
+}
+
+void Simulation::updateProjectiles(float elapsedTime, const XMVECTOR& gravity)
+{
+	// Remove Projectiles
+	projectiles.remove_if(
+		[] (const Projectile& p)
+		{
+			return XMVectorGetX(XMVector3LengthEst(p.position)) > g_ConfigParser.get_SpawnBehaviour().despawn_radius;
+		});
+	// Update Projectiles
+	for (auto& p : projectiles)
+		p.update(elapsedTime, gravity);
+}
+
+void Simulation::fireWeapons(float elapsedTime, const XMVECTOR& aimDirection)
+{
+	for (auto& w : weapons)
+		if (w->update(elapsedTime) && w->projectile)
+		{
+			projectiles.push_back(*w->projectile); // Copy constructor
+			auto& proj = projectiles.back();
+
+			proj.position = XMVector3Transform(w->spawnpoint, w->getWorldMatrix());
+			proj.velocity *= aimDirection;
+		}
+}
+
+void Simulation::collideProjectiles()
+{
+	// Projectile collision and damage
+	projectiles.remove_if(
+		[this] (const Projectile& p)
+		{
+			for (auto& e : enemies)
+				if (XMVectorGetX(XMVector3LengthSq(e.position - p.position)) < (p.size + e.size) * (p.size + e.size))
+				{
+					e.health -= p.damage;
+					return true;
+				}
+			return false;
+		});
+}
+
+void Simulation::updateExplosions(float elapsedTime, const XMVECTOR& gravity)
+{
+	// Remove explosions
+	explosions.remove_if(
+		[] (const Explosion& e)
+		{
+			return e.time >= e.duration;
+		});
+	// Update explosions
+	for (auto& e : explosions)
+		e.update(elapsedTime, gravity);
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "GameObject.h"
+#include "Particle.h"
+
+
+// The enemies, weapons, projectiles and explosions and their update every frame. It does no
+// rendering and uses neither D3D11 nor DXUT, so GameBench can run it headless. The settings
+// come from g_ConfigParser.
+class Simulation
+{
+public:
+	typedef std::map<std::string, std::shared_ptr<Mesh>> MeshMap;
+
+	// The phases of update(), in the order they run
+	enum Phase
+	{
+		PHASE_ENEMIES,     // updateEnemies
+		PHASE_PROJECTILES, // updateProjectiles
+		PHASE_WEAPONS,     // fireWeapons
+		PHASE_COLLISIONS,  // collideProjectiles
+		PHASE_EXPLOSIONS,  // updateExplosions
+		PHASE_COUNT
+	};
+	static const char* getPhaseName(Phase phase);
+
+	// Called right before (begin is true) and right after every phase of update(), e.g. to time them
+	typedef std::function<void(Phase phase, bool begin)> PhaseHook;
+
+	std::vector<std::shared_ptr<EnemyObject>> enemyPrototypes;
+	std::map<std::string, std::shared_ptr<Projectile>> projectilePrototypes;
+	std::unique_ptr<Explosion> explosionPrototype;
+	std::vector<std::shared_ptr<WeaponObject>> weapons;
+
+	std::list<EnemyObject> enemies;
+	std::list<Projectile> projectiles;
+	std::list<Explosion> explosions;
+	float timeSinceLastEnemy = 5.0f;
+
+	// Creates the prototypes of the config file, the sprite names are appended in the order of
+	// their sprite indices. Without meshes (nullptr) the objects are created without them.
+	void createPrototypes(const MeshMap* meshes, std::vector<std::wstring>& spriteNames);
+	// The weapons are attached to the parent object of the config file, if it is one of parents
+	void createWeapons(const MeshMap* meshes, const std::vector<std::shared_ptr<MeshObject>>& parents);
+
+	// Releases all objects and prototypes
+	void clear();
+
+	// One frame, runs the phases below in this order
+	void update(float time, float elapsedTime, const DirectX::XMVECTOR& aimDirection, const DirectX::XMVECTOR& gravity,
+		const PhaseHook& hook = nullptr);
+
+	// Removes destroyed (replacing them by explosions) and escaped enemies, moves the rest and spawns new ones
+	void updateEnemies(float time, float elapsedTime);
+	// Copies a random enemy prototype to the spawn circle, heading for the target circle
+	void spawnEnemy();
+	// Removes escaped projectiles and moves the rest
+	void updateProjectiles(float elapsedTime, const DirectX::XMVECTOR& gravity);
+	// Spawns a projectile for every active weapon which is ready to fire again
+	void fireWeapons(float elapsedTime, const DirectX::XMVECTOR& aimDirection);
+	// Applies the damage of projectiles hitting an enemy and removes them
+	void collideProjectiles();
+	// Removes finished explosions and moves the particles of the rest
+	void updateExplosions(float elapsedTime, const DirectX::XMVECTOR& gravity);
+};
@@ -3,9 +3,12 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <limits>
+#include <map>
 
 #include "SDKmisc.h"
 #include "DirectXTex.h"
+#include "EffectPool.h"
 #include <DDSTextureLoader.h>
 
 // Convenience macros for safe effect variable retrieval
@@ -17,9 +20,10 @@
 #define SAFE_GET_SAMPLER(effect, name, var)   {assert(effect!=NULL); var = effect->GetVariableByName( name )->AsSampler();			assert(var->IsValid());}
 #define SAFE_GET_RESOURCE(effect, name, var)  {assert(effect!=NULL); var = effect->GetVariableByName( name )->AsShaderResource();	assert(var->IsValid());}
 
-SpriteRenderer::SpriteRenderer(const std::vector<std::wstring>& textureFilenames)
+SpriteRenderer::SpriteRenderer(const std::wstring& atlasFilename, const std::vector<std::wstring>& spriteNames)
 {
-	m_textureFilenames = textureFilenames;
+	m_atlasFilename = atlasFilename;
+	m_spriteNames = spriteNames;
 }
 
 SpriteRenderer::~SpriteRenderer()
@@ -35,15 +39,7 @@ HRESULT SpriteRenderer::reloadShader(ID3D11Device* pDevice)
 
 	// Find and load the rendering effect
 	V_RETURN(DXUTFindDXSDKMediaFileCch(path, MAX_PATH, L"shader\\SpriteRenderer.fxo"));
-	std::ifstream is(path, std::ios_base::binary);
-	is.seekg(0, std::ios_base::end);
-	std::streampos pos = is.tellg();
-	is.seekg(0, std::ios_base::beg);
-	std::vector<char> effectBuffer((unsigned int)pos);
-	is.read(&effectBuffer[0], pos);
-	is.close();
-	
-	V_RETURN(D3DX11CreateEffectFromMemory((const void*)&effectBuffer[0], effectBuffer.size(), 0, pDevice, &m_pEffect));
+	V_RETURN(g_effectPool.create(pDevice, path, 0, &m_pEffect));
 	
 	assert(m_pEffect->IsValid());
 
@@ -53,7 +49,12 @@ HRESULT SpriteRenderer::reloadShader(ID3D11Device* pDevice)
 	SAFE_GET_MATRIX(m_pEffect, "g_ViewProjection", m_viewProjectionEV);
 	SAFE_GET_VECTOR(m_pEffect, "g_CameraRight", m_cameraRightEV);
 	SAFE_GET_VECTOR(m_pEffect, "g_CameraUp", m_cameraUpEV);
-	SAFE_GET_RESOURCE(m_pEffect, "g_Sprites", m_spriteTexturesEV);
+	SAFE_GET_RESOURCE(m_pEffect, "g_Sprites", m_spriteAtlasEV);
+	SAFE_GET_RESOURCE(m_pEffect, "g_SpriteFrames", m_spriteFramesEV);
+	SAFE_GET_VECTOR(m_pEffect, "g_Flipbooks", m_flipbooksEV);
+	SAFE_GET_SCALAR(m_pEffect, "g_Time", m_timeEV);
+
+	V_RETURN(m_pEffect->Optimize());
 	
 	return hr;
 }
@@ -82,10 +83,9 @@ HRESULT SpriteRenderer::create(ID3D11Device* pDevice)
 	{
 		{ "POSITION",  0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
 		{ "RADIUS",    0, DXGI_FORMAT_R32_FLOAT,       0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		{ "TEX_INDEX", 0, DXGI_FORMAT_R32_SINT,        0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		{ "TIME",      0, DXGI_FORMAT_R32_FLOAT,       0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		{ "ALPHA",     0, DXGI_FORMAT_R32_FLOAT,       0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		{ "DISTANCE",  0, DXGI_FORMAT_R32_FLOAT,       0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "START",     0, DXGI_FORMAT_R32_FLOAT,       0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "FLIPBOOK",  0, DXGI_FORMAT_R16_UINT,        0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "ALPHA",     0, DXGI_FORMAT_R16_UNORM,       0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
 	};
 	UINT numElements = sizeof(layout) / sizeof(layout[0]);
 
@@ -95,14 +95,95 @@ HRESULT SpriteRenderer::create(ID3D11Device* pDevice)
 	V_RETURN(pDevice->CreateInputLayout(layout, numElements, pd.pIAInputSignature,
 		pd.IAInputSignatureSize, &m_pInputLayout));
 
-	// Load textures
-	for (const auto& path : m_textureFilenames)
+	// Load the frame table, it has the same name as the atlas
+	std::wstring tableFilename = m_atlasFilename.substr(0, m_atlasFilename.find_last_of(L'.')) + L".txt";
+	std::vector<DirectX::XMFLOAT4> frames;
+	V_RETURN(loadFrameTable(tableFilename, frames));
+
+	D3D11_BUFFER_DESC fbd;
+	fbd.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	fbd.ByteWidth = static_cast<UINT>(sizeof(DirectX::XMFLOAT4) * frames.size());
+	fbd.CPUAccessFlags = 0;
+	fbd.MiscFlags = 0;
+	fbd.StructureByteStride = 0;
+	fbd.Usage = D3D11_USAGE_IMMUTABLE;
+
+	D3D11_SUBRESOURCE_DATA fid = { frames.data(), 0, 0 };
+	V_RETURN(pDevice->CreateBuffer(&fbd, &fid, &m_pFrameBuffer));
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC fsrvd;
+	fsrvd.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+	fsrvd.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+	fsrvd.Buffer.FirstElement = 0;
+	fsrvd.Buffer.NumElements = static_cast<UINT>(frames.size());
+	V_RETURN(pDevice->CreateShaderResourceView(m_pFrameBuffer, &fsrvd, &m_frameSRV));
+
+	// Load the atlas with the frames of all sprites
+	hr = DirectX::CreateDDSTextureFromFile(pDevice, m_atlasFilename.c_str(), nullptr, &m_atlasSRV);
+	if (FAILED(hr))
 	{
-		m_spriteSRV.push_back(nullptr);
-		V(DirectX::CreateDDSTextureFromFile(pDevice, path.c_str(), nullptr, &m_spriteSRV.back()));
+		std::wcerr << "ERROR: File \"" << m_atlasFilename << "\" could not be loaded." << std::endl;
+		return hr;
+	}
 
-		if (hr != S_OK)
-			std::wcerr << "ERROR: File \"" << path << "\" could not be loaded." << std::endl;
+	return S_OK;
+}
+
+HRESULT SpriteRenderer::loadFrameTable(const std::wstring& tableFilename, std::vector<DirectX::XMFLOAT4>& frames)
+{
+	std::wifstream table(tableFilename);
+	if (!table)
+	{
+		std::wcerr << "ERROR: File \"" << tableFilename << "\" could not be loaded." << std::endl;
+		return E_FAIL;
+	}
+
+	// Frames are stored in texels of the array slices and uploaded as fractions of a slice
+	float sliceSize = 1;
+	std::map<std::wstring, DirectX::XMFLOAT4> sprites;
+	std::wstring key;
+	while (table >> key)
+	{
+		if (key == L"slices")
+		{
+			size_t slices, size;
+			table >> slices >> size;
+			sliceSize = static_cast<float>(size);
+		}
+		else if (key == L"sprite")
+		{
+			std::wstring name;
+			float first, count, fps;
+			table >> name >> first >> count >> fps;
+			sprites[name] = DirectX::XMFLOAT4(first, count, fps, 0);
+		}
+		else if (key == L"frame")
+		{
+			float slice, x, y, size;
+			table >> slice >> x >> y >> size;
+			frames.push_back(DirectX::XMFLOAT4(x / sliceSize, y / sliceSize, size / sliceSize, slice));
+		}
+
+		// Comments and the rest of the line
+		table.ignore(std::numeric_limits<std::streamsize>::max(), L'\n');
+	}
+
+	if (m_spriteNames.size() > kMaxSprites)
+	{
+		std::wcerr << "ERROR: Only " << kMaxSprites << " sprites can be used at once." << std::endl;
+		return E_FAIL;
+	}
+
+	m_flipbooks.clear();
+	for (const auto& name : m_spriteNames)
+	{
+		auto sprite = sprites.find(name);
+		if (sprite == sprites.end() || sprite->second.y <= 0 || sprite->second.x + sprite->second.y > static_cast<float>(frames.size()))
+		{
+			std::wcerr << "ERROR: Sprite \"" << name << "\" is not in \"" << tableFilename << "\"." << std::endl;
+			return E_FAIL;
+		}
+		m_flipbooks.push_back(sprite->second);
 	}
 
 	return S_OK;
@@ -110,9 +191,10 @@ HRESULT SpriteRenderer::create(ID3D11Device* pDevice)
 
 void SpriteRenderer::destroy()
 {
-	for (auto& tex : m_spriteSRV)
-		SAFE_RELEASE(tex);
-	m_spriteSRV.clear();
+	SAFE_RELEASE(m_atlasSRV);
+	SAFE_RELEASE(m_frameSRV);
+	SAFE_RELEASE(m_pFrameBuffer);
+	m_flipbooks.clear();
 
 	SAFE_RELEASE(m_pVertexBuffer);
 	SAFE_RELEASE(m_pInputLayout);
@@ -122,6 +204,7 @@ void SpriteRenderer::renderSprites(
 	ID3D11DeviceContext* context, 
 	const std::vector<SpriteVertex>& sprites,
 	const CFirstPersonCamera& camera, 
+	float time,
 	int count, 
 	int offset)
 {
@@ -153,7 +236,10 @@ void SpriteRenderer::renderSprites(
 	m_viewProjectionEV->SetMatrix((float*)&(camera.GetViewMatrix() * camera.GetProjMatrix()));
 	m_cameraRightEV->SetFloatVector((float*)&camera.GetWorldRight());
 	m_cameraUpEV->SetFloatVector((float*)&camera.GetWorldUp());
-	m_spriteTexturesEV->SetResourceArray(m_spriteSRV.data(), 0, static_cast<int>(m_spriteSRV.size()));
+	m_spriteAtlasEV->SetResource(m_atlasSRV);
+	m_spriteFramesEV->SetResource(m_frameSRV);
+	m_flipbooksEV->SetFloatVectorArray(reinterpret_cast<const float*>(m_flipbooks.data()), 0, static_cast<uint32_t>(m_flipbooks.size()));
+	m_timeEV->SetFloat(time);
 
 	m_pass->Apply(0, context);
 
@@ -8,23 +8,18 @@
 
 #include <d3dx11effect.h>
 
+#include "SpriteVertex.h"
 
-struct SpriteVertex
-{
-	DirectX::XMFLOAT3 position = {0,0,0};     // world-space position (sprite center)
-	float radius = 1;                   // world-space radius (= half side length of the sprite quad)
-	int textureIndex = 0;               // which texture to use (out of SpriteRenderer::m_spriteSRV)
-	float time = 0;
-	float alpha = 1;
-	float camera_distance = 0;
-};
 
 class SpriteRenderer
 {
 public:
-	// Constructor: Create a SpriteRenderer with the given list of textures.
-	// The textures are *not* be created immediately, but only when create is called!
-	SpriteRenderer(const std::vector<std::wstring>& textureFilenames);
+	// Maximum number of sprites which can be used at once (size of g_Flipbooks in the effect).
+	static const size_t kMaxSprites = 64;
+
+	// Constructor: Create a SpriteRenderer for the given sprites of an atlas packed by "texassemble sprites".
+	// The atlas is *not* loaded immediately, but only when create is called!
+	SpriteRenderer(const std::wstring& atlasFilename, const std::vector<std::wstring>& spriteNames);
 	// Destructor does nothing. Destroy and ReleaseShader must be called first!
 	~SpriteRenderer();
 
@@ -40,10 +35,15 @@ public:
 	void destroy();
 
 	// Render the given sprites. They must already be sorted into back-to-front order.
-	void renderSprites(ID3D11DeviceContext* context, const std::vector<SpriteVertex>& sprites, const CFirstPersonCamera& camera, int count, int offset);
+	// The flipbook frames are picked on the GPU from time and the start time of each sprite.
+	void renderSprites(ID3D11DeviceContext* context, const std::vector<SpriteVertex>& sprites, const CFirstPersonCamera& camera, float time, int count, int offset);
 
 private:
-	std::vector<std::wstring> m_textureFilenames;
+	// Read the frame table next to the atlas and resolve the sprite names
+	HRESULT loadFrameTable(const std::wstring& tableFilename, std::vector<DirectX::XMFLOAT4>& frames);
+
+	std::wstring m_atlasFilename;
+	std::vector<std::wstring> m_spriteNames;
 
 	// Rendering effect (shaders and related GPU state). Created/released in Reload/ReleaseShader.
 	ID3DX11Effect* m_pEffect = nullptr;
@@ -52,11 +52,18 @@ private:
 	ID3DX11EffectMatrixVariable* m_viewProjectionEV = nullptr; // WorldViewProjection matrix effect variable
 	ID3DX11EffectVectorVariable* m_cameraRightEV = nullptr;
 	ID3DX11EffectVectorVariable* m_cameraUpEV = nullptr;
-	ID3DX11EffectShaderResourceVariable* m_spriteTexturesEV = nullptr;
+	ID3DX11EffectShaderResourceVariable* m_spriteAtlasEV = nullptr;
+	ID3DX11EffectShaderResourceVariable* m_spriteFramesEV = nullptr;
+	ID3DX11EffectVectorVariable* m_flipbooksEV = nullptr;
+	ID3DX11EffectScalarVariable* m_timeEV = nullptr;
+
+	// First frame, frame count and frames per second of every sprite, in the order of m_spriteNames
+	std::vector<DirectX::XMFLOAT4> m_flipbooks;
 
-	// Sprite textures and corresponding shader resource views.
-	//std::vector<ID3D11Texture2D*>          m_spriteTex;       // You may not need this if you use CreateDDSTExtureFromFile!
-	std::vector<ID3D11ShaderResourceView*> m_spriteSRV;
+	// The texture array with all sprite frames, and the frame table (u, v, size, slice per frame)
+	ID3D11ShaderResourceView* m_atlasSRV = nullptr;
+	ID3D11Buffer* m_pFrameBuffer = nullptr;
+	ID3D11ShaderResourceView* m_frameSRV = nullptr;
 
 	// Maximum number of allowed sprites, i.e. size of the vertex buffer.
 	size_t m_spriteCountMax = 2048;
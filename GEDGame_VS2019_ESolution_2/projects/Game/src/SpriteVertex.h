@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstdint>
+
+#include <DirectXMath.h>
+
+
+struct SpriteVertex
+{
+	DirectX::XMFLOAT3 position = {0,0,0};     // world-space position (sprite center)
+	float radius = 1;                   // world-space radius (= half side length of the sprite quad)
+	float startTime = 0;                // time at which the flipbook started playing (same clock as renderSprites)
+	uint16_t flipbook = 0;              // which sprite to use (index into the sprite names given to SpriteRenderer)
+	uint16_t alpha = 0xffff;            // opacity as 16 bit unorm
+};
@@ -1,6 +1,7 @@
 #include "T3d.h"
 
 #include <sstream>
+#include <cstring>
 #include "DirectXTex.h"
 
 using namespace std;
@@ -12,6 +13,19 @@ struct T3dHeader {
 	int32_t indicesSize;   // index buffer data size 
 }; // Sizes are always in bytes
 
+// Optional data after the index buffer
+struct T3dChunkHeader {
+	char id[4];
+	uint32_t size;         // payload size in bytes
+};
+
+// Follows the header in version 2 files
+struct T3dQuantizationHeader {
+	float positionMin[3];
+	float positionScale[3];
+	int32_t indexSize;     // 2 or 4 bytes per index
+};
+
 HRESULT T3d::readFromFile(const std::string& filename, std::vector<T3dVertex>& vertexBufferData, 
                                         std::vector<uint32_t>& indexBufferData)
 {
@@ -114,8 +128,118 @@ HRESULT T3d::readFromFile(const std::wstring& filename, std::vector<T3dVertex>&
 }
 
 
+HRESULT T3d::readGeometryFromFile(const std::wstring& filename, T3dGeometry& geometry)
+{
+    // Open the file
+    FILE* file;
+	/*errno_t error =*/ _wfopen_s(&file, filename.c_str(), L"rb");
+	if (file == nullptr) {
+        MessageBoxW (NULL, (std::wstring(L"Could not open ") + filename).c_str(), L"File error", MB_ICONERROR | MB_OK);
+		return E_FAIL;
+	}
+
+    // Read the header
+	T3dHeader header;
+	{
+		auto r = fread (&header, sizeof (T3dHeader), 1, file);
+		if (r != 1) {
+			MessageBoxW (NULL, L"Could not read the header.",
+				L"Invalid t3d file", MB_ICONERROR | MB_OK);
+			fclose(file);
+			return E_FAIL;
+		}
+	}
+
+    // Check the magic number
+	if (header.magicNumber != 0x003D) {
+		MessageBoxW (NULL, L"The magic number is incorrect.",
+			L"Invalid t3d file header", MB_ICONERROR | MB_OK);
+		fclose(file);
+		return E_FAIL;
+	}
+
+    // Check the version
+	if (header.version != 1 && header.version != 2) {
+		MessageBoxW (NULL, L"The header version is incorrect.",
+			L"Invalid t3d file header", MB_ICONERROR | MB_OK);
+		fclose(file);
+		return E_FAIL;
+	}
+
+	geometry.version = header.version;
+	geometry.vertexStride = sizeof(T3dVertex);
+	geometry.indexFormat = DXGI_FORMAT_R32_UINT;
+	UINT indexSize = sizeof(uint32_t);
+
+	if (header.version == 2) {
+		T3dQuantizationHeader quantization;
+		auto r = fread (&quantization, sizeof (T3dQuantizationHeader), 1, file);
+		if (r != 1 || (quantization.indexSize != 2 && quantization.indexSize != 4)) {
+			MessageBoxW (NULL, L"The quantization header is incorrect.",
+				L"Invalid t3d file header", MB_ICONERROR | MB_OK);
+			fclose(file);
+			return E_FAIL;
+		}
+
+		geometry.positionMin = DirectX::XMFLOAT4(quantization.positionMin[0], quantization.positionMin[1], quantization.positionMin[2], 0);
+		geometry.positionScale = DirectX::XMFLOAT4(quantization.positionScale[0], quantization.positionScale[1], quantization.positionScale[2], 0);
+		geometry.vertexStride = sizeof(T3dQuantizedVertex);
+		if (quantization.indexSize == 2) {
+			geometry.indexFormat = DXGI_FORMAT_R16_UINT;
+			indexSize = sizeof(uint16_t);
+		}
+	}
+
+	//Read vertex buffer
+	geometry.vertexBufferData.resize(header.verticesSize / geometry.vertexStride * geometry.vertexStride);
+	fread(geometry.vertexBufferData.data(), 1, geometry.vertexBufferData.size(), file);
+
+	//Read index buffer
+	geometry.indexCount = header.indicesSize / indexSize;
+	geometry.indexBufferData.resize(geometry.indexCount * indexSize);
+	fread(geometry.indexBufferData.data(), 1, geometry.indexBufferData.size(), file);
+
+	//Read chunks, unknown ones are skipped
+	geometry.clusters.clear();
+	geometry.lods.clear();
+	T3dChunkHeader chunk;
+	while (fread(&chunk, sizeof(T3dChunkHeader), 1, file) == 1) {
+		if (memcmp(chunk.id, "CLST", 4) == 0) {
+			geometry.clusters.resize(chunk.size / sizeof(MeshTools::Cluster));
+			fread(geometry.clusters.data(), sizeof(MeshTools::Cluster), geometry.clusters.size(), file);
+		}
+		else if (memcmp(chunk.id, "LODS", 4) == 0) {
+			geometry.lods.resize(chunk.size / sizeof(MeshTools::LodLevel));
+			fread(geometry.lods.data(), sizeof(MeshTools::LodLevel), geometry.lods.size(), file);
+		}
+		else
+			fseek(file, chunk.size, SEEK_CUR);
+	}
+
+	fclose(file);
+
+	//Version 1 files have no bounds in the header
+	if (header.version == 1 && !geometry.vertexBufferData.empty()) {
+		const T3dVertex* vertices = reinterpret_cast<const T3dVertex*>(geometry.vertexBufferData.data());
+		size_t vertexCount = geometry.vertexBufferData.size() / sizeof(T3dVertex);
+
+		DirectX::XMVECTOR minimum = DirectX::XMLoadFloat3(&vertices[0].position);
+		DirectX::XMVECTOR maximum = minimum;
+		for (size_t i = 1; i < vertexCount; i++) {
+			DirectX::XMVECTOR p = DirectX::XMLoadFloat3(&vertices[i].position);
+			minimum = DirectX::XMVectorMin(minimum, p);
+			maximum = DirectX::XMVectorMax(maximum, p);
+		}
+		DirectX::XMStoreFloat4(&geometry.positionMin, DirectX::XMVectorSetW(minimum, 0));
+		DirectX::XMStoreFloat4(&geometry.positionScale, DirectX::XMVectorSetW(DirectX::XMVectorSubtract(maximum, minimum), 0));
+	}
+
+	return S_OK;
+}
+
+
 HRESULT T3d::createT3dInputLayout(ID3D11Device* pd3dDevice, 
-	ID3DX11EffectPass* pass, ID3D11InputLayout** t3dInputLayout)
+	ID3DX11EffectPass* pass, ID3D11InputLayout** t3dInputLayout, bool quantized)
 {
 	HRESULT hr;
 
@@ -129,10 +253,20 @@ HRESULT T3d::createT3dInputLayout(ID3D11Device* pd3dDevice,
 	};
 	UINT numElements = sizeof( layout ) / sizeof( layout[0] );
 
+	// Layout of T3dQuantizedVertex, decoded in the vertex shader
+	const D3D11_INPUT_ELEMENT_DESC quantizedLayout[] =
+	{
+		{ "POSITION",    0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD",    0, DXGI_FORMAT_R16G16_FLOAT,       0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "NORMAL",      0, DXGI_FORMAT_R16G16B16A16_SNORM, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	};
+	UINT numQuantizedElements = sizeof( quantizedLayout ) / sizeof( quantizedLayout[0] );
+
 	// Create the input layout
 	D3DX11_PASS_DESC pd;
 	V_RETURN(pass->GetDesc(&pd));
-	V_RETURN( pd3dDevice->CreateInputLayout( layout, numElements, pd.pIAInputSignature,
+	V_RETURN( pd3dDevice->CreateInputLayout( quantized ? quantizedLayout : layout,
+			  quantized ? numQuantizedElements : numElements, pd.pIAInputSignature,
 			  pd.IAInputSignatureSize, t3dInputLayout ) );
 
 	return S_OK;
@@ -6,6 +6,8 @@
 #include <d3dx11effect.h>
 #include <string>
 
+#include "Clusters.h"
+
 
 //C++ struct for t3d vertex buffer
 struct T3dVertex {
@@ -25,6 +27,42 @@ struct T3dVertex {
 //	  float3 Tan : TANGENT;  //Tangent in object space
 //};
 
+//C++ struct for the quantized vertex buffer of version 2 t3d files (written by MeshTools -quantize)
+struct T3dQuantizedVertex {
+	uint16_t position[4];     // R16G16B16A16_UNORM relative to the mesh bounds, w is unused
+	uint16_t texCoord[2];     // R16G16_FLOAT
+	int16_t normalTangent[4]; // R16G16B16A16_SNORM, octahedral normal (xy) and tangent (zw)
+};
+
+// Corresponding struct in game.fx, decoded by decodeQuantized()
+//
+//struct T3dQuantizedVertexVSIn
+//{
+//    float4 Pos    : POSITION; //Position relative to the mesh bounds
+//    float2 Tex    : TEXCOORD; //Texture coordinate
+//    float4 NorTan : NORMAL;   //Octahedral normal and tangent in object space
+//};
+
+// Vertex and index buffer data of a t3d file of any version, ready for upload
+struct T3dGeometry {
+	int16_t version = 1;
+	std::vector<uint8_t> vertexBufferData;
+	UINT vertexStride = sizeof(T3dVertex);
+	std::vector<uint8_t> indexBufferData;
+	DXGI_FORMAT indexFormat = DXGI_FORMAT_R32_UINT;
+	UINT indexCount = 0;
+
+	// Bounding box, also the dequantization of version 2 positions: positionMin + unorm * positionScale
+	DirectX::XMFLOAT4 positionMin = { 0, 0, 0, 0 };
+	DirectX::XMFLOAT4 positionScale = { 1, 1, 1, 0 };
+
+	// Culling clusters from the optional CLST chunk (written by MeshTools -clusters)
+	std::vector<MeshTools::Cluster> clusters;
+
+	// Levels of detail from the optional LODS chunk (written by MeshTools -lods)
+	std::vector<MeshTools::LodLevel> lods;
+};
+
 class T3d
 {
 public:
@@ -34,6 +72,10 @@ public:
 	static HRESULT readFromFile(const std::wstring& filename, std::vector<T3dVertex>& vertexBufferData, 
                                                       std::vector<uint32_t>& indexBufferData);
 
+	// Reads version 1 and version 2 (quantized) t3d files and their optional chunks
+	static HRESULT readGeometryFromFile(const std::wstring& filename, T3dGeometry& geometry);
+
+	// Creates the layout for T3dVertex, or for T3dQuantizedVertex if quantized is true
 	static HRESULT createT3dInputLayout(ID3D11Device* pd3dDevice, 
-		ID3DX11EffectPass* pass, ID3D11InputLayout** t3dInputLayout);
+		ID3DX11EffectPass* pass, ID3D11InputLayout** t3dInputLayout, bool quantized = false);
 };
\ No newline at end of file
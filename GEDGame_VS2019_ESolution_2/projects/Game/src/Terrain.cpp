@@ -2,7 +2,6 @@
 
 #include "GameEffect.h"
 #include "ConfigParser.h"
-#include <DDSTextureLoader.h>
 #include "DirectXTex.h"
 #include <SimpleImage.h>
 #include "debug.h"
@@ -29,19 +28,19 @@ HRESULT Terrain::create(ID3D11Device* device)
 	terrain_vertex_width = heightmap.getWidth();
 	uint64_t terrain_vertex_height = heightmap.getHeight();
 	// Create the height buffer data
-	raw_height_field.resize(terrain_vertex_width * terrain_vertex_height);
+	height_field.resize(terrain_vertex_width, terrain_vertex_height);
 	for (uint64_t y = 0; y < terrain_vertex_height; y++)
 		for (uint64_t x = 0; x < terrain_vertex_width; x++)
-			raw_height_field[IDX(x, y, terrain_vertex_width)] = heightmap.getPixel(x, y);
+			height_field.at(x, y) = heightmap.getPixel(x, y);
 
 	D3D11_SUBRESOURCE_DATA hid;
-	hid.pSysMem = static_cast<void*>(raw_height_field.data());
+	hid.pSysMem = static_cast<const void*>(height_field.getSamples().data());
 	hid.SysMemPitch = sizeof(float); // Stride
 	hid.SysMemSlicePitch = 0;
 
 	D3D11_BUFFER_DESC hbd;
 	hbd.BindFlags = D3D11_BIND_SHADER_RESOURCE;
-	hbd.ByteWidth = sizeof(float) * raw_height_field.size(); //The size in bytes of the triangle array
+	hbd.ByteWidth = sizeof(float) * height_field.getSamples().size(); //The size in bytes of the triangle array
 	hbd.CPUAccessFlags = 0;
 	hbd.MiscFlags = 0;
 	hbd.Usage = D3D11_USAGE_DEFAULT;
@@ -51,7 +50,7 @@ HRESULT Terrain::create(ID3D11Device* device)
 	// Create the SRV for the height field
 	D3D11_SHADER_RESOURCE_VIEW_DESC hsrvd;
 	hsrvd.Buffer.FirstElement = 0;
-	hsrvd.Buffer.NumElements = raw_height_field.size();
+	hsrvd.Buffer.NumElements = height_field.getSamples().size();
 	hsrvd.Format = DXGI_FORMAT_R32_FLOAT;
 	hsrvd.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
 	
@@ -92,10 +91,10 @@ HRESULT Terrain::create(ID3D11Device* device)
 
 	// Load the color texture (color map)
 	std::wstring color_path(g_ConfigParser.get_terrain().colorMap.begin(), g_ConfigParser.get_terrain().colorMap.end());
-	DirectX::CreateDDSTextureFromFile(device, color_path.c_str(), nullptr, &diffuseTextureSRV);
+	V(g_textureStreamer.load(color_path, &diffuseTexture));
 	// Load the normal map
 	std::wstring normal_path(g_ConfigParser.get_terrain().normalMap.begin(), g_ConfigParser.get_terrain().normalMap.end());
-	DirectX::CreateDDSTextureFromFile(device, normal_path.c_str(), nullptr, &normalTextureSRV);
+	V(g_textureStreamer.load(normal_path, &normalTexture));
 
 	return hr;
 }
@@ -107,15 +106,14 @@ void Terrain::destroy()
 
 	SAFE_RELEASE(heightfield);
 	SAFE_RELEASE(heightfieldSRV);
-	SAFE_RELEASE(diffuseTexture);
-	SAFE_RELEASE(diffuseTextureSRV);
-	SAFE_RELEASE(normalTexture);
-	SAFE_RELEASE(normalTextureSRV);
+	diffuseTexture = TextureStreamer::kNoTexture;
+	normalTexture = TextureStreamer::kNoTexture;
 }
 
 
 void Terrain::render(
 	ID3D11DeviceContext* context, 
+	const GameEffect& effect,
 	const DirectX::XMMATRIX& viewProj,
 	const DirectX::XMMATRIX& lightViewProj)
 {
@@ -124,10 +122,13 @@ void Terrain::render(
 	bindBuffers(context);
 
 	// Bind the textures
-	V(g_gameEffect.heightEV->SetResource(heightfieldSRV));
-	V(g_gameEffect.diffuseEV->SetResource(diffuseTextureSRV));
-	V(g_gameEffect.normalEV->SetResource(normalTextureSRV));
-	V(g_gameEffect.resolutionEV->SetInt(static_cast<int>(terrain_vertex_width)));
+	V(effect.heightEV->SetResource(heightfieldSRV));
+	// The camera is always close to the terrain, it needs full detail
+	g_textureStreamer.requestMip(diffuseTexture, 0);
+	g_textureStreamer.requestMip(normalTexture, 0);
+	V(effect.diffuseEV->SetResource(g_textureStreamer.getSRV(diffuseTexture)));
+	V(effect.normalEV->SetResource(g_textureStreamer.getSRV(normalTexture)));
+	V(effect.resolutionEV->SetInt(static_cast<int>(terrain_vertex_width)));
 
 	DirectX::XMMATRIX const world = DirectX::XMMatrixScaling(
 		g_ConfigParser.get_terrain().width,
@@ -135,13 +136,13 @@ void Terrain::render(
 		g_ConfigParser.get_terrain().height);
 	DirectX::XMMATRIX const worldViewProj = world * viewProj;
 	DirectX::XMMATRIX const lightWorldViewProj = world * lightViewProj;
-	V(g_gameEffect.worldEV->SetMatrix((float*)&world));
-	V(g_gameEffect.worldViewProjectionEV->SetMatrix((float*)&worldViewProj));
-	V(g_gameEffect.worldNormalsEV->SetMatrix((float*)&XMMatrixTranspose(XMMatrixInverse(nullptr, world))));
-	V(g_gameEffect.lightWorldViewProjEV->SetMatrix((float*)&lightWorldViewProj));
+	V(effect.worldEV->SetMatrix((float*)&world));
+	V(effect.worldViewProjectionEV->SetMatrix((float*)&worldViewProj));
+	V(effect.worldNormalsEV->SetMatrix((float*)&XMMatrixTranspose(XMMatrixInverse(nullptr, world))));
+	V(effect.lightWorldViewProjEV->SetMatrix((float*)&lightWorldViewProj));
 
 	// Apply the rendering pass in order to submit the necessary render state changes to the device
-	V(g_gameEffect.terrainPass->Apply(0, context));
+	V(effect.terrainPass->Apply(0, context));
 
 	// Draw
 	context->DrawIndexed(raw_index_buffer.size() * 3, 0, 0);
@@ -149,24 +150,25 @@ void Terrain::render(
 
 void Terrain::renderDepthOnly(
 	ID3D11DeviceContext* context, 
+	const GameEffect& effect,
 	const DirectX::XMMATRIX& viewProj)
 {
 	HRESULT hr;
 
 	bindBuffers(context);
 
-	V(g_gameEffect.heightEV->SetResource(heightfieldSRV));
-	V(g_gameEffect.resolutionEV->SetInt(static_cast<int>(terrain_vertex_width)));
+	V(effect.heightEV->SetResource(heightfieldSRV));
+	V(effect.resolutionEV->SetInt(static_cast<int>(terrain_vertex_width)));
 
 	DirectX::XMMATRIX const world = DirectX::XMMatrixScaling(
 		g_ConfigParser.get_terrain().width,
 		g_ConfigParser.get_terrain().depth,
 		g_ConfigParser.get_terrain().height);
 	DirectX::XMMATRIX const worldViewProj = world * viewProj;
-	V(g_gameEffect.worldViewProjectionEV->SetMatrix((float*)&worldViewProj));
+	V(effect.worldViewProjectionEV->SetMatrix((float*)&worldViewProj));
 
 	// Apply the rendering pass in order to submit the necessary render state changes to the device
-	V(g_gameEffect.terrainShadowPass->Apply(0, context));
+	V(effect.terrainShadowPass->Apply(0, context));
 
 	// Draw
 	context->DrawIndexed(raw_index_buffer.size() * 3, 0, 0);
@@ -188,15 +190,5 @@ void Terrain::bindBuffers(ID3D11DeviceContext* context)
 
 float Terrain::get_height_at(float x, float z) const
 {
-	assert(raw_height_field.size() > 0);
-
-	uint64_t u = std::min(
-		static_cast<uint64_t>((x / g_ConfigParser.get_terrain().width + 0.5) * terrain_vertex_width), 
-		terrain_vertex_width - 1);
-	uint64_t v = std::min(
-		static_cast<uint64_t>((z / g_ConfigParser.get_terrain().depth + 0.5) * terrain_vertex_width), 
-		terrain_vertex_width - 1);
-
-	// Without interpolation
-  	return raw_height_field.at(IDX(u, v, terrain_vertex_width)) * g_ConfigParser.get_terrain().height;
+	return height_field.getHeightAt(x, z, g_ConfigParser.get_terrain());
 }
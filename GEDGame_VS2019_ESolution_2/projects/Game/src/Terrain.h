@@ -3,6 +3,11 @@
 #include "d3dx11effect.h"
 #include <memory>
 
+#include "TextureStreamer.h"
+#include "HeightField.h"
+
+struct GameEffect;
+
 class Terrain
 {
 public:
@@ -22,11 +27,13 @@ public:
 
 	void render(
 		ID3D11DeviceContext* context, 
+		const GameEffect& effect,
 		const DirectX::XMMATRIX& viewProj, 
 		const DirectX::XMMATRIX& lightViewProj);
 
 	void renderDepthOnly(
 		ID3D11DeviceContext* context,
+		const GameEffect& effect,
 		const DirectX::XMMATRIX& viewProj);
 
 	float get_height_at(float x, float z) const;
@@ -36,12 +43,10 @@ private:
 	ID3D11Buffer*                           indexBuffer = nullptr;	// The terrain's triangulation
 	ID3D11Buffer*							heightfield = nullptr;
 	ID3D11ShaderResourceView*				heightfieldSRV = nullptr;
-	ID3D11Texture2D*                        diffuseTexture = nullptr; // The terrain's material color for diffuse lighting
-	ID3D11ShaderResourceView*               diffuseTextureSRV = nullptr; // Describes the structure of the diffuse texture to the shader stages
-	ID3D11Texture2D*						normalTexture = nullptr;
-	ID3D11ShaderResourceView*				normalTextureSRV = nullptr;
+	size_t                                  diffuseTexture = TextureStreamer::kNoTexture; // The terrain's material color for diffuse lighting (streamed)
+	size_t                                  normalTexture = TextureStreamer::kNoTexture;
 
-	std::vector<float>						raw_height_field;
+	HeightField								height_field; // also kept on the CPU for get_height_at
 	std::vector<Triangle>					raw_index_buffer;
 	uint64_t								terrain_vertex_width = 0;
 
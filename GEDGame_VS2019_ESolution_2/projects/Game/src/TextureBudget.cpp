@@ -0,0 +1,151 @@
+#include "TextureBudget.h"
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+
+namespace
+{
+	// A requested mip must be this far above the resident one before the resident one is given up
+	const float kHysteresis = 0.5f;
+
+	struct Candidate
+	{
+		bool requested;
+		float deficit;   // mips missing to the wanted level
+		size_t texture;
+
+		bool operator<(const Candidate& other) const
+		{
+			if (requested != other.requested)
+				return !requested;
+			return deficit < other.deficit;
+		}
+	};
+}
+
+TextureBudget::TextureBudget(uint64_t budgetBytes)
+	: budget(budgetBytes)
+{
+}
+
+size_t TextureBudget::addTexture(const std::vector<uint64_t>& mipBytes, uint32_t minimumMip)
+{
+	Texture texture;
+	texture.mipBytes = mipBytes;
+	texture.minimumMip = std::min(minimumMip, static_cast<uint32_t>(mipBytes.empty() ? 0 : mipBytes.size() - 1));
+	texture.residentMip = texture.minimumMip;
+	texture.targetMip = texture.minimumMip;
+	textures.push_back(texture);
+	return textures.size() - 1;
+}
+
+void TextureBudget::requestMip(size_t texture, float mip)
+{
+	Texture& t = textures[texture];
+	mip = std::max(mip, 0.0f);
+	if (t.requestAge == 0)
+		t.requestedMip = std::min(t.requestedMip, mip);
+	else
+		t.requestedMip = mip;
+	t.requestAge = 0;
+}
+
+void TextureBudget::requestScreenSize(size_t texture, uint32_t width, uint32_t height, float screenPixels)
+{
+	float texels = static_cast<float>(std::max(width, height));
+	if (screenPixels >= texels)
+		requestMip(texture, 0.0f);
+	else if (screenPixels <= 1.0f)
+		requestMip(texture, static_cast<float>(getMipCount(texture)));
+	else
+		requestMip(texture, std::log2(texels / screenPixels));
+}
+
+void TextureBudget::setResidentMip(size_t texture, uint32_t mip)
+{
+	textures[texture].residentMip = mip;
+}
+
+uint32_t TextureBudget::getWantedMip(const Texture& texture) const
+{
+	if (texture.requestAge >= kRequestFrames)
+		return texture.residentMip;
+
+	uint32_t wanted = static_cast<uint32_t>(std::min(std::floor(texture.requestedMip), static_cast<float>(texture.minimumMip)));
+	if (texture.residentMip < wanted && texture.requestedMip < texture.residentMip + 1 + kHysteresis)
+		wanted = texture.residentMip;
+	return wanted;
+}
+
+void TextureBudget::update()
+{
+	// The low mips are always resident
+	uint64_t total = 0;
+	for (auto& texture : textures)
+	{
+		texture.targetMip = texture.minimumMip;
+		total += getBytes(&texture - textures.data(), texture.minimumMip);
+	}
+
+	// Add one mip at a time to the texture which is missing the most detail
+	std::priority_queue<Candidate> queue;
+	auto push = [&](size_t i)
+	{
+		const Texture& texture = textures[i];
+		uint32_t wanted = getWantedMip(texture);
+		if (texture.targetMip > wanted)
+		{
+			bool requested = texture.requestAge < kRequestFrames;
+			float deficit = texture.targetMip - (requested ? texture.requestedMip : wanted);
+			queue.push({ requested, deficit, i });
+		}
+	};
+	for (size_t i = 0; i < textures.size(); i++)
+		push(i);
+
+	while (!queue.empty())
+	{
+		Candidate candidate = queue.top();
+		queue.pop();
+
+		// Skip textures which do not fit anymore, smaller ones still might
+		Texture& texture = textures[candidate.texture];
+		uint64_t cost = texture.mipBytes[texture.targetMip - 1];
+		if (total + cost > budget)
+			continue;
+
+		total += cost;
+		texture.targetMip--;
+		push(candidate.texture);
+	}
+
+	for (auto& texture : textures)
+		if (texture.requestAge < kRequestFrames)
+			texture.requestAge++;
+}
+
+uint64_t TextureBudget::getBytes(size_t texture, uint32_t firstMip) const
+{
+	const auto& mipBytes = textures[texture].mipBytes;
+	uint64_t bytes = 0;
+	for (size_t mip = firstMip; mip < mipBytes.size(); mip++)
+		bytes += mipBytes[mip];
+	return bytes;
+}
+
+uint64_t TextureBudget::getTargetBytes() const
+{
+	uint64_t bytes = 0;
+	for (size_t i = 0; i < textures.size(); i++)
+		bytes += getBytes(i, textures[i].targetMip);
+	return bytes;
+}
+
+uint64_t TextureBudget::getResidentBytes() const
+{
+	uint64_t bytes = 0;
+	for (size_t i = 0; i < textures.size(); i++)
+		bytes += getBytes(i, textures[i].residentMip);
+	return bytes;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+// Decides which mip levels of the streamed textures should be resident. It only works on
+// mip sizes and requests, so it can be used (and tested) without a D3D11 device.
+//
+// Mips are counted from 0 (most detailed). A texture with target mip m has the mips m..count-1
+// resident. The mips from minimumMip on are always resident, more detailed ones are added
+// one at a time in priority order while they fit into the budget:
+//  1. textures requested in the last frames, blurriest (relative to their request) first
+//  2. textures not requested lately keep their resident mips if there is budget left
+class TextureBudget
+{
+public:
+	// Requests stay valid for this many updates, so textures which are briefly out of view keep their mips
+	static const uint32_t kRequestFrames = 60;
+
+	explicit TextureBudget(uint64_t budgetBytes = 0);
+
+	void setBudget(uint64_t budgetBytes) { budget = budgetBytes; }
+	uint64_t getBudget() const { return budget; }
+
+	// Registers a texture with the byte size of every mip level (most detailed first).
+	// Returns its index for the other functions.
+	size_t addTexture(const std::vector<uint64_t>& mipBytes, uint32_t minimumMip);
+	void clear() { textures.clear(); }
+	size_t getTextureCount() const { return textures.size(); }
+
+	// Requests the given (fractional) mip level for this frame, the most detailed request of a frame wins
+	void requestMip(size_t texture, float mip);
+
+	// Requests the mip level at which the texture is shown with one texel per pixel, if the whole
+	// texture (width x height texels) covers screenPixels pixels along its longer side
+	void requestScreenSize(size_t texture, uint32_t width, uint32_t height, float screenPixels);
+
+	// Reports which mips are resident now (after a load or an eviction finished)
+	void setResidentMip(size_t texture, uint32_t mip);
+
+	// Computes the target mips for the current requests and ages the requests by one frame
+	void update();
+
+	uint32_t getTargetMip(size_t texture) const { return textures[texture].targetMip; }
+	uint32_t getResidentMip(size_t texture) const { return textures[texture].residentMip; }
+	uint32_t getMipCount(size_t texture) const { return static_cast<uint32_t>(textures[texture].mipBytes.size()); }
+
+	// Bytes of all mips from firstMip to the least detailed one
+	uint64_t getBytes(size_t texture, uint32_t firstMip) const;
+
+	uint64_t getTargetBytes() const;
+	uint64_t getResidentBytes() const;
+
+private:
+	struct Texture
+	{
+		std::vector<uint64_t> mipBytes;
+		uint32_t minimumMip = 0;
+		uint32_t residentMip = 0;
+		uint32_t targetMip = 0;
+		float requestedMip = 0;
+		uint32_t requestAge = kRequestFrames; // updates since the last request
+	};
+
+	// The mip the texture should reach if the budget allows it
+	uint32_t getWantedMip(const Texture& texture) const;
+
+	std::vector<Texture> textures;
+	uint64_t budget;
+};
@@ -0,0 +1,294 @@
+#include "TextureStreamer.h"
+
+#include <DDSTextureLoader.h>
+
+#include <algorithm>
+
+#include "Profiler.h"
+
+TextureStreamer::TextureStreamer()
+	: device(nullptr), residentSize(0), pendingCount(0), stopping(false)
+{
+}
+
+TextureStreamer::~TextureStreamer()
+{
+	destroy();
+}
+
+HRESULT TextureStreamer::create(ID3D11Device* device, uint64_t budgetBytes, uint32_t residentSize, size_t threadCount)
+{
+	destroy();
+
+	// D3D11 devices are free threaded, so the loader threads create the textures themselves
+	this->device = device;
+	this->residentSize = std::max(residentSize, 1u);
+	budget.setBudget(budgetBytes);
+
+	stopping = false;
+	for (size_t i = 0; i < std::max(threadCount, size_t(1)); i++)
+		threads.emplace_back(&TextureStreamer::loaderThread, this);
+
+	return S_OK;
+}
+
+void TextureStreamer::destroy()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+		jobs.clear();
+	}
+	jobAvailable.notify_all();
+	for (auto& thread : threads)
+		thread.join();
+	threads.clear();
+
+	for (auto& result : results)
+	{
+		SAFE_RELEASE(result.resource);
+		SAFE_RELEASE(result.srv);
+	}
+	results.clear();
+
+	for (auto& texture : textures)
+	{
+		SAFE_RELEASE(texture->resource);
+		SAFE_RELEASE(texture->srv);
+	}
+	textures.clear();
+	textureIndices.clear();
+	budget.clear();
+	pendingCount = 0;
+	device = nullptr;
+}
+
+uint64_t TextureStreamer::computeBytes(const DirectX::TexMetadata& metadata)
+{
+	uint64_t bytes = 0;
+	for (size_t mip = 0; mip < metadata.mipLevels; mip++)
+	{
+		size_t rowPitch, slicePitch;
+		if (SUCCEEDED(DirectX::ComputePitch(metadata.format, std::max(metadata.width >> mip, size_t(1)),
+			std::max(metadata.height >> mip, size_t(1)), rowPitch, slicePitch)))
+			bytes += uint64_t(slicePitch) * std::max(metadata.depth >> mip, size_t(1));
+	}
+	return bytes * metadata.arraySize;
+}
+
+bool TextureStreamer::readLayout(const std::wstring& filename, Texture& texture)
+{
+	HRESULT hr = DirectX::GetMetadataFromDDSFile(filename.c_str(), DirectX::DDS_FLAGS_NONE, texture.metadata);
+	if (FAILED(hr))
+		return false;
+
+	const DirectX::TexMetadata& metadata = texture.metadata;
+	if (metadata.dimension != DirectX::TEX_DIMENSION_TEXTURE2D || metadata.arraySize != 1 || metadata.IsCubemap())
+		return false;
+
+	// Block compressed mips must stay multiples of 4, which is only guaranteed for powers of two
+	bool compressed = DirectX::IsCompressed(metadata.format);
+	if (compressed && ((metadata.width & (metadata.width - 1)) != 0 || (metadata.height & (metadata.height - 1)) != 0))
+		return false;
+
+	// Formats which DirectXTex converts while loading (24 bit RGB, palettes, ...) can not be mapped
+	if (FAILED(texture.file.Open(filename.c_str(), DirectX::DDS_FLAGS_NONE)))
+		return false;
+
+	texture.mipBytes.clear();
+	for (size_t mip = 0; mip < metadata.mipLevels; mip++)
+	{
+		DirectX::Image image;
+		if (FAILED(texture.file.GetImage(mip, 0, 0, image)))
+			return false;
+		texture.mipBytes.push_back(image.slicePitch);
+	}
+
+	return true;
+}
+
+HRESULT TextureStreamer::load(const std::wstring& filename, size_t* texture)
+{
+	*texture = kNoTexture;
+	if (filename == L"" || filename == L"-")
+		return S_OK;
+
+	auto existing = textureIndices.find(filename);
+	if (existing != textureIndices.end())
+	{
+		*texture = existing->second;
+		return S_OK;
+	}
+
+	HRESULT hr;
+	auto created = std::make_unique<Texture>();
+	created->filename = filename;
+	created->streamed = readLayout(filename, *created);
+
+	uint32_t firstMip = 0;
+	if (created->streamed)
+	{
+		// The low mips up to residentSize texels are always resident
+		const DirectX::TexMetadata& metadata = created->metadata;
+		while (firstMip + 1 < metadata.mipLevels && std::max(metadata.width >> firstMip, metadata.height >> firstMip) > residentSize)
+			firstMip++;
+		V_RETURN(loadMips(*created, firstMip, &created->resource, &created->srv));
+	}
+	else
+	{
+		// Counted in the budget as a single level which is always resident
+		V_RETURN(DirectX::CreateDDSTextureFromFile(device, filename.c_str(), &created->resource, &created->srv));
+		created->mipBytes.assign(1, computeBytes(created->metadata));
+	}
+
+	size_t index = budget.addTexture(created->mipBytes, firstMip);
+	textureIndices[filename] = index;
+	textures.push_back(std::move(created));
+
+	*texture = index;
+	return S_OK;
+}
+
+HRESULT TextureStreamer::loadMips(const Texture& texture, uint32_t firstMip, ID3D11Resource** resource, ID3D11ShaderResourceView** srv) const
+{
+	HRESULT hr;
+	const DirectX::TexMetadata& metadata = texture.metadata;
+	UINT mipLevels = static_cast<UINT>(metadata.mipLevels - firstMip);
+
+	// The mips point straight into the mapped file, only the pages of these mips are read
+	std::vector<D3D11_SUBRESOURCE_DATA> initialData(mipLevels);
+	for (UINT i = 0; i < mipLevels; i++)
+	{
+		DirectX::Image image;
+		V_RETURN(texture.file.GetImage(firstMip + i, 0, 0, image));
+
+		initialData[i].pSysMem = image.pixels;
+		initialData[i].SysMemPitch = static_cast<UINT>(image.rowPitch);
+		initialData[i].SysMemSlicePitch = static_cast<UINT>(image.slicePitch);
+	}
+
+	D3D11_TEXTURE2D_DESC desc;
+	desc.Width = static_cast<UINT>(std::max(metadata.width >> firstMip, size_t(1)));
+	desc.Height = static_cast<UINT>(std::max(metadata.height >> firstMip, size_t(1)));
+	desc.MipLevels = mipLevels;
+	desc.ArraySize = 1;
+	desc.Format = metadata.format;
+	desc.SampleDesc.Count = 1;
+	desc.SampleDesc.Quality = 0;
+	desc.Usage = D3D11_USAGE_IMMUTABLE;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	desc.CPUAccessFlags = 0;
+	desc.MiscFlags = 0;
+
+	ID3D11Texture2D* created = nullptr;
+	V_RETURN(device->CreateTexture2D(&desc, initialData.data(), &created));
+	hr = device->CreateShaderResourceView(created, nullptr, srv);
+	if (FAILED(hr))
+	{
+		SAFE_RELEASE(created);
+		return hr;
+	}
+
+	*resource = created;
+	return S_OK;
+}
+
+void TextureStreamer::loaderThread()
+{
+	g_profiler.setThreadName("Texture loader");
+
+	for (;;)
+	{
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			jobAvailable.wait(lock, [this] { return stopping || !jobs.empty(); });
+			if (stopping)
+				return;
+			job = jobs.front();
+			jobs.pop_front();
+		}
+
+		Result result = { job.texture, job.firstMip, S_OK, nullptr, nullptr };
+		{
+			PROFILE_SCOPE("Load mips");
+			result.hr = loadMips(*job.source, job.firstMip, &result.resource, &result.srv);
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+		results.push_back(result);
+	}
+}
+
+ID3D11ShaderResourceView* TextureStreamer::getSRV(size_t texture) const
+{
+	return texture == kNoTexture ? nullptr : textures[texture]->srv;
+}
+
+void TextureStreamer::requestScreenSize(size_t texture, float screenPixels)
+{
+	if (texture == kNoTexture)
+		return;
+	const DirectX::TexMetadata& metadata = textures[texture]->metadata;
+	budget.requestScreenSize(texture, static_cast<uint32_t>(metadata.width), static_cast<uint32_t>(metadata.height), screenPixels);
+}
+
+void TextureStreamer::requestMip(size_t texture, float mip)
+{
+	if (texture != kNoTexture)
+		budget.requestMip(texture, mip);
+}
+
+void TextureStreamer::update()
+{
+	// Swap in the finished loads. The old resources are released here, after the
+	// immediate context is done with them for this frame.
+	std::vector<Result> finished;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		finished.swap(results);
+	}
+	for (auto& result : finished)
+	{
+		Texture& texture = *textures[result.texture];
+		texture.pending = false;
+		pendingCount--;
+
+		// Keep what is resident and do not retry every frame
+		if (FAILED(result.hr))
+		{
+			texture.streamed = false;
+			continue;
+		}
+
+		std::swap(texture.resource, result.resource);
+		std::swap(texture.srv, result.srv);
+		SAFE_RELEASE(result.resource);
+		SAFE_RELEASE(result.srv);
+		budget.setResidentMip(result.texture, result.firstMip);
+	}
+
+	budget.update();
+
+	// Start loads (or evictions, which reload fewer mips) for every texture off its target
+	std::vector<Job> started;
+	for (size_t i = 0; i < textures.size(); i++)
+	{
+		Texture& texture = *textures[i];
+		if (!texture.streamed || texture.pending || budget.getTargetMip(i) == budget.getResidentMip(i))
+			continue;
+
+		texture.pending = true;
+		pendingCount++;
+		started.push_back({ i, &texture, budget.getTargetMip(i) });
+	}
+
+	if (!started.empty())
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			jobs.insert(jobs.end(), started.begin(), started.end());
+		}
+		jobAvailable.notify_all();
+	}
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <DXUT.h>
+#include "DirectXTex.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "TextureBudget.h"
+
+
+// Loads DDS textures with only their low mips (up to residentSize texels) and streams the
+// more detailed mips in on background threads as the renderer requests them, within the
+// memory budget. Textures are referred to by handles, their SRV changes whenever mips are
+// loaded or evicted, so it has to be fetched with getSRV() for every draw.
+class TextureStreamer
+{
+public:
+	static const size_t kNoTexture = SIZE_MAX;
+
+	TextureStreamer();
+	~TextureStreamer();
+	TextureStreamer(const TextureStreamer&) = delete;
+	void operator=(const TextureStreamer&) = delete;
+
+	// Starts the loader threads. Textures can only be loaded after create.
+	HRESULT create(ID3D11Device* device, uint64_t budgetBytes, uint32_t residentSize, size_t threadCount = 2);
+
+	// Waits for the loader threads and releases all textures
+	void destroy();
+
+	// Loads the low mips of a DDS file. Files which can not be streamed (cube maps, arrays and
+	// legacy formats which are converted while loading) are loaded completely.
+	// Loading the same file again returns the same handle. "" and "-" give kNoTexture.
+	HRESULT load(const std::wstring& filename, size_t* texture);
+
+	// Returns nullptr for kNoTexture
+	ID3D11ShaderResourceView* getSRV(size_t texture) const;
+
+	// Requests the detail needed for the texture to cover screenPixels pixels along its longer side
+	void requestScreenSize(size_t texture, float screenPixels);
+	void requestMip(size_t texture, float mip);
+
+	// Swaps in finished loads, updates the budget with this frame's requests and starts new loads.
+	// Call once per frame after rendering.
+	void update();
+
+	uint64_t getResidentBytes() const { return budget.getResidentBytes(); }
+	uint64_t getBudget() const { return budget.getBudget(); }
+	size_t getPendingCount() const { return pendingCount; }
+
+private:
+	struct Texture
+	{
+		std::wstring filename;
+		DirectX::TexMetadata metadata = {};
+		bool streamed = false;
+		DirectX::MappedDDS file; // mapped for as long as the texture is streamed
+		std::vector<uint64_t> mipBytes;
+
+		ID3D11Resource* resource = nullptr;
+		ID3D11ShaderResourceView* srv = nullptr;
+		bool pending = false;
+	};
+
+	struct Job
+	{
+		size_t texture;
+		const Texture* source;
+		uint32_t firstMip;
+	};
+
+	struct Result
+	{
+		size_t texture;
+		uint32_t firstMip;
+		HRESULT hr;
+		ID3D11Resource* resource;
+		ID3D11ShaderResourceView* srv;
+	};
+
+	// Memory of a completely loaded texture
+	static uint64_t computeBytes(const DirectX::TexMetadata& metadata);
+
+	// Reads the mip layout of the file, returns false if it can not be streamed
+	static bool readLayout(const std::wstring& filename, Texture& texture);
+
+	// Creates a texture from the mips firstMip..mipLevels-1 of the mapped file. Runs on the loader threads.
+	HRESULT loadMips(const Texture& texture, uint32_t firstMip, ID3D11Resource** resource, ID3D11ShaderResourceView** srv) const;
+
+	void loaderThread();
+
+	ID3D11Device* device;
+	uint32_t residentSize;
+	TextureBudget budget;
+
+	// Texture objects never move, so loader threads can keep pointers to them
+	std::vector<std::unique_ptr<Texture>> textures;
+	std::map<std::wstring, size_t> textureIndices;
+	size_t pendingCount;
+
+	std::vector<std::thread> threads;
+	std::mutex mutex;
+	std::condition_variable jobAvailable;
+	std::deque<Job> jobs;
+	std::vector<Result> results;
+	bool stopping;
+};
+
+extern TextureStreamer g_textureStreamer;
@@ -0,0 +1,476 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <DirectXMath.h>
+
+#include "ConfigParser.h"
+#include "GameObject.h"
+#include "HeightField.h"
+#include "Particle.h"
+#include "Simulation.h"
+
+using namespace DirectX;
+
+// Headless benchmark of the game simulation, runs scripted scenarios without rendering and
+// writes the timings of the simulation phases, the allocations and the entity counts as JSON.
+//
+// Usage: GameBench [-c <game.cfg>] [-o <output.json>] [-s <scenario>] [-n <frames>] [-seed <seed>]
+//   -c     config file, the meshes and textures are not loaded (default game.cfg)
+//   -o     JSON output file (default gamebench.json)
+//   -s     spawn, gatling, explosions or all (default all)
+//   -n     simulated frames per scenario at 60 Hz (default 3600)
+//   -seed  seed of rand(), which drives the spawning and the explosion particles (default 1)
+
+ConfigParser g_ConfigParser;
+
+//--------------------------------------------------------------------------------------
+// Allocation counting
+//--------------------------------------------------------------------------------------
+// The replaced global operator new counts every allocation of the process. The array,
+// sized and nothrow variants of the standard library all end up here.
+static uint64_t g_allocationCount = 0;
+static uint64_t g_allocatedBytes = 0;
+
+void* operator new(size_t size)
+{
+	g_allocationCount++;
+	g_allocatedBytes += size;
+	if (void* p = std::malloc(size ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+	std::free(p);
+}
+
+//--------------------------------------------------------------------------------------
+// Scenarios
+//--------------------------------------------------------------------------------------
+struct Scenario
+{
+	const char* name;
+	int spawnsPerFrame;  // enemies spawned each frame in addition to the config's spawn interval
+	bool fireWeapons;    // all weapons of the config fire as fast as they can
+	bool destroyEnemies; // every enemy explodes in the frame after it was spawned
+};
+
+static const Scenario g_scenarios[] = {
+	{ "spawn",      4, false, false },
+	{ "gatling",    1, true,  false },
+	{ "explosions", 8, false, true  },
+};
+
+// The scenario script, the phases of Simulation::update and the terrain lookups
+enum Phase
+{
+	PHASE_SCRIPT,     // spawning and destroying enemies for the scenario
+	PHASE_SIMULATION, // + Simulation::Phase
+	PHASE_TERRAIN = PHASE_SIMULATION + Simulation::PHASE_COUNT, // terrain height below every enemy
+	PHASE_COUNT
+};
+
+const char* get_phase_name(int phase)
+{
+	if (phase == PHASE_SCRIPT)
+		return "script";
+	if (phase == PHASE_TERRAIN)
+		return "terrain";
+	return Simulation::getPhaseName(static_cast<Simulation::Phase>(phase - PHASE_SIMULATION));
+}
+
+struct PhaseStatistics
+{
+	double totalMilliseconds = 0;
+	double maxMicroseconds = 0;
+	uint64_t allocations = 0;
+	uint64_t allocatedBytes = 0;
+};
+
+struct EntityStatistics
+{
+	size_t current = 0;
+	size_t max = 0;
+	double mean = 0;
+
+	void add(size_t count)
+	{
+		current = count;
+		max = std::max(max, count);
+		mean += static_cast<double>(count);
+	}
+};
+
+struct ScenarioResult
+{
+	const Scenario* scenario = nullptr;
+	double totalMilliseconds = 0;
+	double maxFrameMicroseconds = 0;
+	PhaseStatistics phases[PHASE_COUNT];
+	EntityStatistics enemies, projectiles, explosions, particles;
+	uint64_t fired = 0;
+	uint64_t exploded = 0;
+	float terrainChecksum = 0; // keeps the height lookups from being optimized away
+};
+
+struct Arguments
+{
+	std::string config = "game.cfg";
+	std::string output = "gamebench.json";
+	std::string scenario = "all";
+	uint64_t frames = 3600;
+	unsigned int seed = 1;
+};
+
+// Measures the time and the allocations of one phase, from begin() to end()
+class PhaseTimer
+{
+public:
+	void begin()
+	{
+		allocations = g_allocationCount;
+		allocatedBytes = g_allocatedBytes;
+		start = std::chrono::high_resolution_clock::now();
+	}
+
+	void end(PhaseStatistics& stats)
+	{
+		auto end = std::chrono::high_resolution_clock::now();
+		double us = std::chrono::duration<double, std::micro>(end - start).count();
+		stats.totalMilliseconds += us / 1000.0;
+		stats.maxMicroseconds = std::max(stats.maxMicroseconds, us);
+		stats.allocations += g_allocationCount - allocations;
+		stats.allocatedBytes += g_allocatedBytes - allocatedBytes;
+	}
+
+private:
+	uint64_t allocations = 0;
+	uint64_t allocatedBytes = 0;
+	std::chrono::high_resolution_clock::time_point start;
+};
+
+bool interpret_arguments(int argc, char* argv[], Arguments& args);
+void create_height_field(HeightField& heightField);
+void create_objects(const HeightField& heightField, std::vector<std::shared_ptr<GameObject>>& parents, std::vector<std::shared_ptr<MeshObject>>& objects);
+ScenarioResult run_scenario(const Scenario& scenario, const Arguments& args, const HeightField& heightField);
+void write_json(std::ostream& out, const Arguments& args, const std::vector<ScenarioResult>& results);
+
+int main(int argc, char* argv[])
+{
+	Arguments args;
+	if (!interpret_arguments(argc, argv, args))
+		return EXIT_FAILURE;
+
+	if (!g_ConfigParser.load(args.config))
+	{
+		std::cout << "ERROR: Could not load config file " << args.config << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	HeightField heightField;
+	create_height_field(heightField);
+
+	std::vector<ScenarioResult> results;
+	for (auto& scenario : g_scenarios)
+		if (args.scenario == "all" || args.scenario == scenario.name)
+		{
+			results.push_back(run_scenario(scenario, args, heightField));
+
+			const auto& r = results.back();
+			std::cout << scenario.name << ": " << args.frames << " frames in "
+				<< std::fixed << std::setprecision(2) << r.totalMilliseconds << " ms, "
+				<< r.enemies.max << " enemies, " << r.projectiles.max << " projectiles, "
+				<< r.explosions.max << " explosions at most" << std::endl;
+		}
+
+	if (results.empty())
+	{
+		std::cout << "ERROR: Unknown scenario " << args.scenario << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::ofstream file(args.output);
+	if (!file.is_open())
+	{
+		std::cout << "ERROR: Could not open " << args.output << " for writing" << std::endl;
+		return EXIT_FAILURE;
+	}
+	write_json(file, args, results);
+	if (!file.good())
+	{
+		std::cout << "ERROR: Could not write " << args.output << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::cout << "Results written to " << args.output << std::endl;
+	return EXIT_SUCCESS;
+}
+
+bool interpret_arguments(int argc, char* argv[], Arguments& args)
+{
+	// Start with 1 since the first argument is the current path
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp("-c", argv[i]) == 0)
+		{
+			i++;
+			if (i < argc)
+				args.config = argv[i];
+			else
+				std::cout << "ERROR: Config path missing." << std::endl;
+		}
+		else if (std::strcmp("-o", argv[i]) == 0)
+		{
+			i++;
+			if (i < argc)
+				args.output = argv[i];
+			else
+				std::cout << "ERROR: Output path missing." << std::endl;
+		}
+		else if (std::strcmp("-s", argv[i]) == 0)
+		{
+			i++;
+			if (i < argc)
+				args.scenario = argv[i];
+			else
+				std::cout << "ERROR: Scenario name missing." << std::endl;
+		}
+		else if (std::strcmp("-n", argv[i]) == 0)
+		{
+			i++;
+			if (i < argc)
+				args.frames = std::strtoull(argv[i], nullptr, 10);
+			else
+				std::cout << "ERROR: Frame count missing." << std::endl;
+		}
+		else if (std::strcmp("-seed", argv[i]) == 0)
+		{
+			i++;
+			if (i < argc)
+				args.seed = std::strtoul(argv[i], nullptr, 10);
+			else
+				std::cout << "ERROR: Seed missing." << std::endl;
+		}
+		else
+		{
+			std::cout << "WARNING: Unknown parameter (will be ignored): " << argv[i] << std::endl;
+		}
+	}
+
+	if (args.frames == 0)
+	{
+		std::cout << "ERROR: Please provide a frame count greater than 0 using -n" << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+// Rolling hills instead of the config's height map, loading it would need the texture libraries
+void create_height_field(HeightField& heightField)
+{
+	const uint64_t resolution = 1024;
+
+	heightField.resize(resolution, resolution);
+	for (uint64_t y = 0; y < resolution; y++)
+		for (uint64_t x = 0; x < resolution; x++)
+		{
+			float u = static_cast<float>(x) / resolution * XM_2PI;
+			float v = static_cast<float>(y) / resolution * XM_2PI;
+			heightField.at(x, y) = 0.5f + 0.25f * std::sin(3.0f * u) * std::cos(2.0f * v) + 0.1f * std::sin(7.0f * (u + v));
+		}
+}
+
+// The objects of the config without meshes, like CreateGameObjects in the game. Only the
+// weapons and their parents are needed, but the hierarchy is kept to get the same world matrices.
+// The objects only hold weak pointers to their parents, so these have to be kept alive by the caller.
+void create_objects(const HeightField& heightField, std::vector<std::shared_ptr<GameObject>>& parents, std::vector<std::shared_ptr<MeshObject>>& objects)
+{
+	const auto& terrain = g_ConfigParser.get_terrain();
+
+	auto camera = std::make_shared<ParentObject>();
+	camera->name = "Camera";
+	camera->worldMatrix = XMMatrixTranslation(0.0f, heightField.getHeightAt(0.0f, 0.0f, terrain) + 20.0f, 0.0f);
+	auto terrainObject = std::make_shared<ParentObject>();
+	terrainObject->name = "Terrain";
+
+	for (auto& o : g_ConfigParser.get_Objects())
+	{
+		auto new_gameObject = std::make_shared<MeshObject>();
+
+		new_gameObject->name = o.identifier;
+
+		new_gameObject->position = { o.pos_x, o.pos_y, o.pos_z };
+		new_gameObject->rotation = { XMConvertToRadians(o.rot_x), XMConvertToRadians(o.rot_y), XMConvertToRadians(o.rot_z) };
+		new_gameObject->scale = { o.scale, o.scale, o.scale };
+
+		if (o.parentIdentifier == "camera")
+			new_gameObject->parent = camera;
+		else if (o.parentIdentifier == "terrain")
+		{
+			new_gameObject->parent = terrainObject;
+			new_gameObject->position += { 0, heightField.getHeightAt(o.pos_x, o.pos_z, terrain), 0 };
+		}
+		else
+			for (auto& n : objects)
+				if (n->name == o.parentIdentifier)
+					new_gameObject->parent = n;
+
+		objects.push_back(new_gameObject);
+	}
+
+	parents = { camera, terrainObject };
+}
+
+ScenarioResult run_scenario(const Scenario& scenario, const Arguments& args, const HeightField& heightField)
+{
+	const float elapsedTime = 1.0f / 60.0f;
+	const XMVECTOR gravity = { 0.0f, -9.81f, 0.0f };
+	const XMVECTOR aimDirection = { 1.0f, 0.0f, 0.0f }; // the initial view direction of the game
+	const auto& terrain = g_ConfigParser.get_terrain();
+
+	srand(args.seed);
+
+	std::vector<std::shared_ptr<GameObject>> parents;
+	std::vector<std::shared_ptr<MeshObject>> objects;
+	create_objects(heightField, parents, objects);
+
+	std::vector<std::wstring> spriteNames;
+	Simulation simulation;
+	simulation.createPrototypes(nullptr, spriteNames);
+	simulation.createWeapons(nullptr, objects);
+	for (auto& w : simulation.weapons)
+		w->active = scenario.fireWeapons;
+
+	ScenarioResult result;
+	result.scenario = &scenario;
+
+	// Times the phases of Simulation::update and counts the explosions and projectiles they add
+	PhaseTimer timer;
+	size_t explosions = 0, projectiles = 0;
+	Simulation::PhaseHook hook = [&](Simulation::Phase phase, bool begin)
+	{
+		if (begin)
+		{
+			explosions = simulation.explosions.size();
+			projectiles = simulation.projectiles.size();
+			timer.begin();
+			return;
+		}
+
+		timer.end(result.phases[PHASE_SIMULATION + phase]);
+		if (phase == Simulation::PHASE_ENEMIES)
+			result.exploded += simulation.explosions.size() - explosions;
+		else if (phase == Simulation::PHASE_WEAPONS)
+			result.fired += simulation.projectiles.size() - projectiles;
+	};
+
+	auto start = std::chrono::high_resolution_clock::now();
+	for (uint64_t frame = 0; frame < args.frames; frame++)
+	{
+		auto frame_start = std::chrono::high_resolution_clock::now();
+		float time = frame * elapsedTime;
+
+		timer.begin();
+		if (scenario.destroyEnemies)
+			for (auto& e : simulation.enemies)
+				e.health = 0;
+		for (int i = 0; i < scenario.spawnsPerFrame; i++)
+			simulation.spawnEnemy();
+		timer.end(result.phases[PHASE_SCRIPT]);
+
+		simulation.update(time, elapsedTime, aimDirection, gravity, hook);
+
+		timer.begin();
+		for (auto& e : simulation.enemies)
+			result.terrainChecksum += heightField.getHeightAt(XMVectorGetX(e.position), XMVectorGetZ(e.position), terrain);
+		timer.end(result.phases[PHASE_TERRAIN]);
+
+		auto frame_end = std::chrono::high_resolution_clock::now();
+		result.maxFrameMicroseconds = std::max(result.maxFrameMicroseconds,
+			std::chrono::duration<double, std::micro>(frame_end - frame_start).count());
+
+		size_t particles = 0;
+		for (auto& e : simulation.explosions)
+			particles += e.explosionParticles.size();
+		result.enemies.add(simulation.enemies.size());
+		result.projectiles.add(simulation.projectiles.size());
+		result.explosions.add(simulation.explosions.size());
+		result.particles.add(particles);
+	}
+	auto end = std::chrono::high_resolution_clock::now();
+	result.totalMilliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+
+	for (auto* stats : { &result.enemies, &result.projectiles, &result.explosions, &result.particles })
+		stats->mean /= static_cast<double>(args.frames);
+
+	simulation.clear();
+	return result;
+}
+
+void write_json(std::ostream& out, const Arguments& args, const std::vector<ScenarioResult>& results)
+{
+	auto write_entities = [&out] (const char* name, const EntityStatistics& stats, bool last)
+	{
+		out << "        \"" << name << "\": { \"final\": " << stats.current << ", \"max\": " << stats.max
+			<< ", \"mean\": " << stats.mean << " }" << (last ? "\n" : ",\n");
+	};
+
+	// The paths are written as given, the config and output paths must not need JSON escaping
+	out << std::fixed << std::setprecision(3);
+	out << "{\n";
+	out << "  \"config\": \"" << args.config << "\",\n";
+	out << "  \"frames\": " << args.frames << ",\n";
+	out << "  \"seed\": " << args.seed << ",\n";
+	out << "  \"scenarios\": [\n";
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const auto& r = results[i];
+		out << "    {\n";
+		out << "      \"name\": \"" << r.scenario->name << "\",\n";
+		out << "      \"total_ms\": " << r.totalMilliseconds << ",\n";
+		out << "      \"mean_frame_us\": " << r.totalMilliseconds * 1000.0 / args.frames << ",\n";
+		out << "      \"max_frame_us\": " << r.maxFrameMicroseconds << ",\n";
+		out << "      \"phases\": {\n";
+		for (int p = 0; p < PHASE_COUNT; p++)
+		{
+			const auto& stats = r.phases[p];
+			out << "        \"" << get_phase_name(p) << "\": { \"total_ms\": " << stats.totalMilliseconds
+				<< ", \"mean_us\": " << stats.totalMilliseconds * 1000.0 / args.frames
+				<< ", \"max_us\": " << stats.maxMicroseconds
+				<< ", \"allocations\": " << stats.allocations
+				<< ", \"allocated_bytes\": " << stats.allocatedBytes << " }"
+				<< (p + 1 < PHASE_COUNT ? ",\n" : "\n");
+		}
+		out << "      },\n";
+		out << "      \"entities\": {\n";
+		write_entities("enemies", r.enemies, false);
+		write_entities("projectiles", r.projectiles, false);
+		write_entities("explosions", r.explosions, false);
+		write_entities("particles", r.particles, true);
+		out << "      },\n";
+		out << "      \"fired\": " << r.fired << ",\n";
+		out << "      \"exploded\": " << r.exploded << ",\n";
+		out << "      \"terrain_checksum\": " << r.terrainChecksum << "\n";
+		out << "    }" << (i + 1 < results.size() ? ",\n" : "\n");
+	}
+	out << "  ]\n";
+	out << "}\n";
+}
@@ -0,0 +1,260 @@
+#include "Clusters.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace MeshTools
+{
+
+namespace
+{
+	// Cones wider than this (dot product between axis and a normal) can not cull anything useful
+	const float kMinConeDot = 0.1f;
+
+	float dot(const float* a, const float* b)
+	{
+		return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+	}
+
+	void normalize(float* v)
+	{
+		float length = std::sqrt(dot(v, v));
+		if (length > 0.0f)
+		{
+			v[0] /= length;
+			v[1] /= length;
+			v[2] /= length;
+		}
+	}
+
+	void computeBounds(Cluster& cluster, const std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices)
+	{
+		const uint32_t* tri = &indices[cluster.indexOffset];
+		const size_t indexCount = cluster.triangleCount * 3;
+
+		// Bounding sphere around the center of the bounding box
+		float min[3], max[3];
+		for (int k = 0; k < 3; k++)
+			min[k] = max[k] = vertices[tri[0]].position[k];
+		for (size_t i = 1; i < indexCount; i++)
+			for (int k = 0; k < 3; k++)
+			{
+				min[k] = std::min(min[k], vertices[tri[i]].position[k]);
+				max[k] = std::max(max[k], vertices[tri[i]].position[k]);
+			}
+
+		for (int k = 0; k < 3; k++)
+			cluster.center[k] = (min[k] + max[k]) * 0.5f;
+
+		float radiusSquared = 0.0f;
+		for (size_t i = 0; i < indexCount; i++)
+		{
+			const float* p = vertices[tri[i]].position;
+			float d[3] = { p[0] - cluster.center[0], p[1] - cluster.center[1], p[2] - cluster.center[2] };
+			radiusSquared = std::max(radiusSquared, dot(d, d));
+		}
+		cluster.radius = std::sqrt(radiusSquared);
+
+		// Normal cone: average of the triangle normals and the widest deviation from it
+		std::vector<float> normals(cluster.triangleCount * 3);
+		float axis[3] = { 0, 0, 0 };
+		for (size_t t = 0; t < cluster.triangleCount; t++)
+		{
+			const float* p0 = vertices[tri[t * 3]].position;
+			const float* p1 = vertices[tri[t * 3 + 1]].position;
+			const float* p2 = vertices[tri[t * 3 + 2]].position;
+
+			float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+			float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+			float* n = &normals[t * 3];
+			n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+			n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+			n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+			normalize(n);
+
+			for (int k = 0; k < 3; k++)
+				axis[k] += n[k];
+		}
+		normalize(axis);
+
+		float minDot = 1.0f;
+		for (size_t t = 0; t < cluster.triangleCount; t++)
+		{
+			const float* n = &normals[t * 3];
+			// Degenerate triangles have a zero normal and are never visible
+			if (dot(n, n) > 0.0f)
+				minDot = std::min(minDot, dot(n, axis));
+		}
+
+		std::memcpy(cluster.coneAxis, axis, sizeof(axis));
+		if (minDot <= kMinConeDot || dot(axis, axis) == 0.0f)
+		{
+			std::memcpy(cluster.coneApex, cluster.center, sizeof(cluster.center));
+			cluster.coneCutoff = 1.0f;
+			return;
+		}
+
+		// Move the apex back along the axis until it lies behind all triangle planes
+		float maxT = 0.0f;
+		for (size_t t = 0; t < cluster.triangleCount; t++)
+		{
+			const float* n = &normals[t * 3];
+			if (dot(n, n) == 0.0f)
+				continue;
+
+			const float* p0 = vertices[tri[t * 3]].position;
+			float d[3] = { cluster.center[0] - p0[0], cluster.center[1] - p0[1], cluster.center[2] - p0[2] };
+			maxT = std::max(maxT, dot(d, n) / dot(axis, n));
+		}
+
+		for (int k = 0; k < 3; k++)
+			cluster.coneApex[k] = cluster.center[k] - axis[k] * maxT;
+		cluster.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+	}
+}
+
+std::vector<Cluster> buildClusters(const std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices)
+{
+	std::vector<Cluster> clusters;
+	const size_t triangleCount = indices.size() / 3;
+
+	// Marks the vertices of the current cluster with its number + 1
+	std::vector<uint32_t> vertexCluster(vertices.size(), 0);
+
+	Cluster current = {};
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		const uint32_t* tri = &indices[t * 3];
+		uint32_t stamp = static_cast<uint32_t>(clusters.size() + 1);
+
+		size_t newVertices = 0;
+		for (size_t k = 0; k < 3; k++)
+			if (vertexCluster[tri[k]] != stamp && (k == 0 || tri[k] != tri[0]) && (k < 2 || tri[k] != tri[1]))
+				newVertices++;
+
+		// Start a new cluster if the triangle does not fit anymore
+		if (current.triangleCount == kMaxClusterTriangles || current.vertexCount + newVertices > kMaxClusterVertices)
+		{
+			computeBounds(current, indices, vertices);
+			clusters.push_back(current);
+
+			current = {};
+			current.indexOffset = static_cast<uint32_t>(t * 3);
+			stamp++;
+		}
+
+		for (size_t k = 0; k < 3; k++)
+			if (vertexCluster[tri[k]] != stamp)
+			{
+				vertexCluster[tri[k]] = stamp;
+				current.vertexCount++;
+			}
+		current.triangleCount++;
+	}
+
+	if (current.triangleCount > 0)
+	{
+		computeBounds(current, indices, vertices);
+		clusters.push_back(current);
+	}
+
+	return clusters;
+}
+
+Frustum extractFrustum(const float m[16])
+{
+	// Clip space: -w <= x <= w, -w <= y <= w, 0 <= z <= w. With row vectors, the plane
+	// coefficients are combinations of the matrix columns.
+	auto column = [m](int c, float* out)
+	{
+		for (int r = 0; r < 4; r++)
+			out[r] = m[r * 4 + c];
+	};
+
+	float c0[4], c1[4], c2[4], c3[4];
+	column(0, c0);
+	column(1, c1);
+	column(2, c2);
+	column(3, c3);
+
+	Frustum frustum;
+	for (int k = 0; k < 4; k++)
+	{
+		frustum.planes[0][k] = c3[k] + c0[k];
+		frustum.planes[1][k] = c3[k] - c0[k];
+		frustum.planes[2][k] = c3[k] + c1[k];
+		frustum.planes[3][k] = c3[k] - c1[k];
+		frustum.planes[4][k] = c2[k];
+		frustum.planes[5][k] = c3[k] - c2[k];
+	}
+
+	for (auto& plane : frustum.planes)
+	{
+		float length = std::sqrt(dot(plane, plane));
+		if (length > 0.0f)
+			for (int k = 0; k < 4; k++)
+				plane[k] /= length;
+	}
+
+	return frustum;
+}
+
+bool isClusterOutside(const Cluster& cluster, const Frustum& frustum)
+{
+	for (const auto& plane : frustum.planes)
+		if (dot(plane, cluster.center) + plane[3] < -cluster.radius)
+			return true;
+	return false;
+}
+
+bool isClusterBackfacing(const Cluster& cluster, const float cameraPosition[3])
+{
+	if (cluster.coneCutoff >= 1.0f)
+		return false;
+
+	float d[3] = { cluster.coneApex[0] - cameraPosition[0], cluster.coneApex[1] - cameraPosition[1], cluster.coneApex[2] - cameraPosition[2] };
+	float length = std::sqrt(dot(d, d));
+	return dot(d, cluster.coneAxis) >= cluster.coneCutoff * length;
+}
+
+size_t cullClusters(const std::vector<Cluster>& clusters, const Frustum& frustum, const float* cameraPosition,
+	std::vector<uint32_t>& visibleClusters)
+{
+	visibleClusters.clear();
+	for (size_t i = 0; i < clusters.size(); i++)
+	{
+		if (isClusterOutside(clusters[i], frustum))
+			continue;
+		if (cameraPosition != nullptr && isClusterBackfacing(clusters[i], cameraPosition))
+			continue;
+		visibleClusters.push_back(static_cast<uint32_t>(i));
+	}
+	return visibleClusters.size();
+}
+
+size_t compactIndices(const std::vector<Cluster>& clusters, const std::vector<uint32_t>& visibleClusters,
+	const void* indices, size_t indexSize, void* output)
+{
+	const uint8_t* source = static_cast<const uint8_t*>(indices);
+	uint8_t* destination = static_cast<uint8_t*>(output);
+	size_t written = 0;
+
+	for (size_t i = 0; i < visibleClusters.size();)
+	{
+		// Extend the range while the next visible cluster directly follows
+		const Cluster& first = clusters[visibleClusters[i]];
+		size_t count = first.triangleCount * 3;
+		size_t j = i + 1;
+		while (j < visibleClusters.size() && visibleClusters[j] == visibleClusters[j - 1] + 1)
+			count += clusters[visibleClusters[j++]].triangleCount * 3;
+
+		std::memcpy(destination + written * indexSize, source + first.indexOffset * indexSize, count * indexSize);
+		written += count;
+		i = j;
+	}
+
+	return written;
+}
+
+}
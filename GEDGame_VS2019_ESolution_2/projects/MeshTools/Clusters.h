@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "T3dFile.h"
+
+namespace MeshTools
+{
+
+// Limits of a cluster, chosen like common meshlet sizes
+const size_t kMaxClusterVertices = 64;
+const size_t kMaxClusterTriangles = 124;
+
+// Six planes (left, right, bottom, top, near, far) with normalized normals pointing inside
+struct Frustum
+{
+	float planes[6][4];
+};
+
+// Splits the triangles in index order into clusters of at most kMaxClusterVertices vertices
+// and kMaxClusterTriangles triangles. Run it on the final (cache optimized) index order.
+std::vector<Cluster> buildClusters(const std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices);
+
+// Extracts the frustum planes of a row-major view projection matrix (row vectors, as in DirectXMath).
+// For a world view projection matrix the planes are in object space.
+Frustum extractFrustum(const float viewProjection[16]);
+
+bool isClusterOutside(const Cluster& cluster, const Frustum& frustum);
+
+// True if all triangles of the cluster face away from the camera position
+bool isClusterBackfacing(const Cluster& cluster, const float cameraPosition[3]);
+
+// Collects the indices of the visible clusters. Back-facing clusters are only removed if
+// cameraPosition is not null. Returns the number of visible clusters.
+size_t cullClusters(const std::vector<Cluster>& clusters, const Frustum& frustum, const float* cameraPosition,
+	std::vector<uint32_t>& visibleClusters);
+
+// Copies the indices of the visible clusters (sorted ascending) into output, merging adjacent ranges.
+// indexSize is 2 or 4 bytes. Returns the number of indices written.
+size_t compactIndices(const std::vector<Cluster>& clusters, const std::vector<uint32_t>& visibleClusters,
+	const void* indices, size_t indexSize, void* output);
+
+}
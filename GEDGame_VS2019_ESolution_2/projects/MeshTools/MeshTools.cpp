@@ -0,0 +1,350 @@
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+
+#include "Clusters.h"
+#include "Quantization.h"
+#include "Simplify.h"
+#include "T3dFile.h"
+#include "VertexCache.h"
+
+// Offline optimizer for t3d meshes, runs after obj2t3d in the ResourceGenerator.
+//
+// Usage: MeshTools -i <input.t3d> -o <output.t3d> [-cache <size>] [-clusters] [-lods <count>] [-quantize] [-y]
+//   -cache     size of the simulated post-transform cache for the statistics (default 16)
+//   -clusters  store culling clusters in the output and benchmark the culling from random views
+//   -lods      append up to count simplified levels of detail with 1/2, 1/4, ... of the triangles
+//   -quantize  write a version 2 t3d file with quantized vertices. The vertices are decoded
+//              again and the tool fails if the round trip error exceeds the format precision.
+//   -y         overwrite an existing output file
+
+struct Arguments
+{
+	std::string input;
+	std::string output;
+	size_t cacheSize = 16;
+	bool clusters = false;
+	size_t lods = 0;
+	bool quantize = false;
+	bool overwrite = false;
+};
+
+bool interpret_arguments(int argc, char* argv[], Arguments& args);
+void print_statistics(const char* label, const MeshTools::CacheStatistics& stats);
+bool write_quantized(const Arguments& args, const MeshTools::T3dMesh& mesh);
+void benchmark_culling(const MeshTools::T3dMesh& mesh);
+void print_lods(const MeshTools::T3dMesh& mesh);
+
+int main(int argc, char* argv[])
+{
+	Arguments args;
+	if (!interpret_arguments(argc, argv, args))
+		return EXIT_FAILURE;
+
+	MeshTools::T3dMesh mesh;
+	if (!MeshTools::readT3d(args.input, mesh))
+		return EXIT_FAILURE;
+
+	// Levels of detail from an earlier run are generated again from level 0
+	if (!mesh.lods.empty())
+	{
+		mesh.indices.erase(mesh.indices.begin(), mesh.indices.begin() + mesh.lods[0].indexOffset);
+		mesh.indices.resize(mesh.lods[0].indexCount);
+		mesh.lods.clear();
+	}
+
+	auto start_time = std::chrono::high_resolution_clock::now();
+
+	auto before = MeshTools::analyzeVertexCache(mesh.indices, mesh.vertices.size(), args.cacheSize);
+
+	MeshTools::optimizeVertexCache(mesh.indices, mesh.vertices.size());
+	MeshTools::optimizeOverdraw(mesh.indices, mesh.vertices, args.cacheSize);
+	size_t vertex_count = mesh.vertices.size();
+	MeshTools::optimizeVertexFetch(mesh.vertices, mesh.indices);
+
+	auto after = MeshTools::analyzeVertexCache(mesh.indices, mesh.vertices.size(), args.cacheSize);
+
+	auto end_time = std::chrono::high_resolution_clock::now();
+
+	std::cout << args.input << ": " << mesh.indices.size() / 3 << " triangles, "
+		<< mesh.vertices.size() << " vertices";
+	if (vertex_count != mesh.vertices.size())
+		std::cout << " (" << vertex_count - mesh.vertices.size() << " unused removed)";
+	std::cout << std::endl;
+	print_statistics("before", before);
+	print_statistics("after ", after);
+	std::cout << "  optimized in " << std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count() << " milliseconds" << std::endl;
+
+	if (args.clusters)
+	{
+		mesh.clusters = MeshTools::buildClusters(mesh.indices, mesh.vertices);
+		benchmark_culling(mesh);
+	}
+	else
+		mesh.clusters.clear();
+
+	if (args.lods > 0)
+	{
+		auto lod_start_time = std::chrono::high_resolution_clock::now();
+		MeshTools::generateLods(mesh, args.lods);
+		auto lod_end_time = std::chrono::high_resolution_clock::now();
+
+		print_lods(mesh);
+		std::cout << "  simplified in " << std::chrono::duration_cast<std::chrono::milliseconds>(lod_end_time - lod_start_time).count() << " milliseconds" << std::endl;
+	}
+
+	if (args.quantize)
+	{
+		if (!write_quantized(args, mesh))
+			return EXIT_FAILURE;
+	}
+	else if (!MeshTools::writeT3d(args.output, mesh))
+		return EXIT_FAILURE;
+
+	return EXIT_SUCCESS;
+}
+
+bool interpret_arguments(int argc, char* argv[], Arguments& args)
+{
+	// Start with 1 since the first argument is the current path
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp("-i", argv[i]) == 0)
+		{
+			i++;
+			if (i < argc)
+				args.input = argv[i];
+			else
+				std::cout << "ERROR: Input path missing." << std::endl;
+		}
+		else if (std::strcmp("-o", argv[i]) == 0)
+		{
+			i++;
+			if (i < argc)
+				args.output = argv[i];
+			else
+				std::cout << "ERROR: Output path missing." << std::endl;
+		}
+		else if (std::strcmp("-cache", argv[i]) == 0)
+		{
+			i++;
+			if (i < argc)
+				args.cacheSize = std::strtoul(argv[i], nullptr, 10);
+			else
+				std::cout << "ERROR: Cache size parameter missing." << std::endl;
+		}
+		else if (std::strcmp("-clusters", argv[i]) == 0)
+		{
+			args.clusters = true;
+		}
+		else if (std::strcmp("-lods", argv[i]) == 0)
+		{
+			i++;
+			if (i < argc)
+				args.lods = std::strtoul(argv[i], nullptr, 10);
+			else
+				std::cout << "ERROR: Level of detail count missing." << std::endl;
+		}
+		else if (std::strcmp("-quantize", argv[i]) == 0)
+		{
+			args.quantize = true;
+		}
+		else if (std::strcmp("-y", argv[i]) == 0)
+		{
+			args.overwrite = true;
+		}
+		else
+		{
+			std::cout << "WARNING: Unknown parameter (will be ignored): " << argv[i] << std::endl;
+		}
+	}
+
+	if (args.input.empty())
+	{
+		std::cout << "ERROR: Please provide an input t3d file using -i" << std::endl;
+		return false;
+	}
+	if (args.output.empty())
+	{
+		std::cout << "ERROR: Please provide an output t3d file using -o" << std::endl;
+		return false;
+	}
+	if (args.cacheSize < 3)
+	{
+		std::cout << "ERROR: Cache size must be at least 3" << std::endl;
+		return false;
+	}
+	if (!args.overwrite && args.output != args.input && std::ifstream(args.output).good())
+	{
+		std::cout << "ERROR: " << args.output << " already exists, use -y to overwrite" << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+void print_statistics(const char* label, const MeshTools::CacheStatistics& stats)
+{
+	std::cout << "  " << label << ": ACMR " << std::fixed << std::setprecision(3) << stats.acmr
+		<< ", ATVR " << stats.atvr << std::defaultfloat << std::endl;
+}
+
+bool write_quantized(const Arguments& args, const MeshTools::T3dMesh& mesh)
+{
+	std::vector<MeshTools::QuantizedVertex> quantized;
+	auto params = MeshTools::quantizeVertices(mesh.vertices, quantized);
+
+	// Round trip through the decoder, which mirrors the shader
+	std::vector<MeshTools::Vertex> decoded;
+	MeshTools::dequantizeVertices(quantized, params, decoded);
+	auto error = MeshTools::measureQuantizationError(mesh.vertices, decoded);
+
+	std::cout << "  quantized: " << mesh.vertices.size() * sizeof(MeshTools::Vertex) << " -> "
+		<< quantized.size() * sizeof(MeshTools::QuantizedVertex) << " vertex bytes, "
+		<< (MeshTools::fitsShortIndices(mesh.vertices.size()) ? 16 : 32) << "-bit indices" << std::endl;
+	std::cout << "  error    : position max " << error.maxPosition << " rms " << error.rmsPosition
+		<< ", uv max " << error.maxTexCoord
+		<< ", normal max " << error.maxNormalAngle << " deg"
+		<< ", tangent max " << error.maxTangentAngle << " deg" << std::endl;
+
+	if (!MeshTools::isQuantizationErrorAcceptable(error, params))
+	{
+		std::cout << "ERROR: Quantization error of " << args.input << " exceeds the format precision" << std::endl;
+		return false;
+	}
+
+	return MeshTools::writeT3dQuantized(args.output, quantized, params, mesh);
+}
+
+// Culls the clusters from random views around the mesh, like the game does for every pass
+void benchmark_culling(const MeshTools::T3dMesh& mesh)
+{
+	const int view_count = 1000;
+	const float fov = 1.0f; // radians
+	const float pi = 3.14159265f;
+
+	size_t vertex_sum = 0;
+	for (const auto& cluster : mesh.clusters)
+		vertex_sum += cluster.vertexCount;
+	std::cout << "  clusters : " << mesh.clusters.size();
+	if (!mesh.clusters.empty())
+		std::cout << ", " << std::fixed << std::setprecision(1) << static_cast<float>(mesh.indices.size() / 3) / mesh.clusters.size()
+			<< " triangles and " << static_cast<float>(vertex_sum) / mesh.clusters.size() << " vertices on average" << std::defaultfloat;
+	std::cout << std::endl;
+	if (mesh.clusters.empty())
+		return;
+
+	// Bounding sphere of the whole mesh
+	float center[3] = { 0, 0, 0 }, radius = 0;
+	for (const auto& cluster : mesh.clusters)
+		for (int k = 0; k < 3; k++)
+			center[k] += cluster.center[k] / mesh.clusters.size();
+	for (const auto& cluster : mesh.clusters)
+	{
+		float d[3] = { cluster.center[0] - center[0], cluster.center[1] - center[1], cluster.center[2] - center[2] };
+		radius = std::max(radius, std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]) + cluster.radius);
+	}
+
+	std::mt19937 random(42);
+	std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+
+	std::vector<uint32_t> visible;
+	std::vector<uint32_t> compacted(mesh.indices.size());
+	size_t visible_clusters = 0, visible_indices = 0;
+	std::chrono::high_resolution_clock::duration cull_time(0);
+
+	for (int v = 0; v < view_count; v++)
+	{
+		// Camera on a sphere around the mesh, looking at a point inside the mesh
+		float eye[3], target[3];
+		float z = uniform(random), phi = uniform(random) * pi, r = std::sqrt(1.0f - z * z);
+		float distance = radius * (1.2f + uniform(random) * 0.8f + 0.8f);
+		eye[0] = center[0] + r * std::cos(phi) * distance;
+		eye[1] = center[1] + r * std::sin(phi) * distance;
+		eye[2] = center[2] + z * distance;
+		for (int k = 0; k < 3; k++)
+			target[k] = center[k] + uniform(random) * radius * 0.5f;
+
+		// Left-handed look-at and perspective matrices with row vectors, as in DirectXMath
+		float zaxis[3] = { target[0] - eye[0], target[1] - eye[1], target[2] - eye[2] };
+		float length = std::sqrt(zaxis[0] * zaxis[0] + zaxis[1] * zaxis[1] + zaxis[2] * zaxis[2]);
+		for (int k = 0; k < 3; k++)
+			zaxis[k] /= length;
+		float up[3] = { 0, 1, 0 };
+		if (std::abs(zaxis[1]) > 0.99f)
+		{
+			up[0] = 1;
+			up[1] = 0;
+		}
+		float xaxis[3] = { up[1] * zaxis[2] - up[2] * zaxis[1], up[2] * zaxis[0] - up[0] * zaxis[2], up[0] * zaxis[1] - up[1] * zaxis[0] };
+		length = std::sqrt(xaxis[0] * xaxis[0] + xaxis[1] * xaxis[1] + xaxis[2] * xaxis[2]);
+		for (int k = 0; k < 3; k++)
+			xaxis[k] /= length;
+		float yaxis[3] = { zaxis[1] * xaxis[2] - zaxis[2] * xaxis[1], zaxis[2] * xaxis[0] - zaxis[0] * xaxis[2], zaxis[0] * xaxis[1] - zaxis[1] * xaxis[0] };
+
+		float near_plane = distance * 0.1f, far_plane = distance + radius;
+		float h = 1.0f / std::tan(fov * 0.5f), q = far_plane / (far_plane - near_plane);
+		float view_proj[16];
+		const float* axes[3] = { xaxis, yaxis, zaxis };
+		for (int row = 0; row < 4; row++)
+		{
+			// Row of the view matrix times the projection matrix
+			float view_row[3];
+			for (int c = 0; c < 3; c++)
+				view_row[c] = row < 3 ? axes[c][row] : -(axes[c][0] * eye[0] + axes[c][1] * eye[1] + axes[c][2] * eye[2]);
+			float w = row < 3 ? 0.0f : 1.0f;
+			view_proj[row * 4 + 0] = view_row[0] * h;
+			view_proj[row * 4 + 1] = view_row[1] * h;
+			view_proj[row * 4 + 2] = view_row[2] * q - w * q * near_plane;
+			view_proj[row * 4 + 3] = view_row[2];
+		}
+
+		auto start_time = std::chrono::high_resolution_clock::now();
+		auto frustum = MeshTools::extractFrustum(view_proj);
+		visible_clusters += MeshTools::cullClusters(mesh.clusters, frustum, eye, visible);
+		visible_indices += MeshTools::compactIndices(mesh.clusters, visible, mesh.indices.data(), sizeof(uint32_t), compacted.data());
+		cull_time += std::chrono::high_resolution_clock::now() - start_time;
+	}
+
+	std::cout << "  culling  : " << std::fixed << std::setprecision(1)
+		<< 100.0f * visible_clusters / (view_count * mesh.clusters.size()) << "% clusters and "
+		<< 100.0f * visible_indices / (static_cast<float>(view_count) * mesh.indices.size()) << "% triangles visible, "
+		<< std::setprecision(2) << std::chrono::duration<double, std::micro>(cull_time).count() / view_count
+		<< " microseconds per view" << std::defaultfloat << std::endl;
+}
+
+void print_lods(const MeshTools::T3dMesh& mesh)
+{
+	// Errors relative to the size of the mesh are comparable between meshes
+	float min[3], max[3];
+	for (int k = 0; k < 3; k++)
+	{
+		min[k] = mesh.vertices.empty() ? 0.0f : mesh.vertices[0].position[k];
+		max[k] = min[k];
+	}
+	for (const auto& v : mesh.vertices)
+		for (int k = 0; k < 3; k++)
+		{
+			min[k] = std::min(min[k], v.position[k]);
+			max[k] = std::max(max[k], v.position[k]);
+		}
+	float d[3] = { max[0] - min[0], max[1] - min[1], max[2] - min[2] };
+	float radius = 0.5f * std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+
+	for (size_t level = 0; level < mesh.lods.size(); level++)
+	{
+		const auto& lod = mesh.lods[level];
+		std::cout << "  lod " << level << "    : " << lod.indexCount / 3 << " triangles ("
+			<< std::fixed << std::setprecision(1) << 100.0f * lod.indexCount / mesh.lods[0].indexCount << "%), error "
+			<< std::setprecision(5) << lod.error;
+		if (radius > 0.0f)
+			std::cout << " (" << std::setprecision(3) << 100.0f * lod.error / radius << "% of the radius)";
+		std::cout << std::defaultfloat << std::endl;
+	}
+}
@@ -0,0 +1,275 @@
+#include "Quantization.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace MeshTools
+{
+
+namespace
+{
+	const float kRadToDeg = 57.2957795f;
+
+	// Octahedral snorm16 keeps directions within ~0.05 degrees
+	const float kMaxDirectionError = 0.1f;
+
+	// A quarter texel of a 256 texture. Half floats stay below it for texture coordinates up to 4,
+	// larger (tiled) ones lose precision and values above 65504 overflow to infinity.
+	const float kMaxTexCoordError = 1.0f / 1024.0f;
+
+	float signNotZero(float value)
+	{
+		return value >= 0.0f ? 1.0f : -1.0f;
+	}
+
+	int16_t toSnorm16(float value)
+	{
+		return static_cast<int16_t>(std::lround(std::min(std::max(value, -1.0f), 1.0f) * 32767.0f));
+	}
+
+	float fromSnorm16(int16_t value)
+	{
+		// Same conversion as D3D: -32768 and -32767 both map to -1
+		return std::max(value / 32767.0f, -1.0f);
+	}
+
+	float length(const float v[3])
+	{
+		return std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+	}
+
+	// Angle between two directions in degrees, 0 if one of them is degenerate
+	float angleBetween(const float a[3], const float b[3])
+	{
+		float la = length(a), lb = length(b);
+		if (la <= 0.0f || lb <= 0.0f)
+			return 0.0f;
+
+		float cosine = (a[0] * b[0] + a[1] * b[1] + a[2] * b[2]) / (la * lb);
+		return std::acos(std::min(std::max(cosine, -1.0f), 1.0f)) * kRadToDeg;
+	}
+}
+
+uint16_t floatToHalf(float value)
+{
+	uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+
+	uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+	uint32_t absBits = bits & 0x7FFFFFFF;
+
+	// Infinity and NaN
+	if (absBits >= 0x7F800000)
+		return sign | 0x7C00 | (absBits > 0x7F800000 ? 0x0200 : 0);
+
+	// Rounds to infinity (>= 65520)
+	if (absBits >= 0x477FF000)
+		return sign | 0x7C00;
+
+	// Denormalized half (< 2^-14)
+	if (absBits < 0x38800000)
+	{
+		// Rounds to zero (< 2^-25)
+		if (absBits < 0x33000000)
+			return sign;
+
+		uint32_t exponent = absBits >> 23;
+		uint32_t mantissa = (absBits & 0x007FFFFF) | 0x00800000;
+		uint32_t shift = 126 - exponent;
+
+		uint32_t halfMantissa = mantissa >> shift;
+		uint32_t remainder = mantissa & ((1u << shift) - 1);
+		uint32_t halfway = 1u << (shift - 1);
+		if (remainder > halfway || (remainder == halfway && (halfMantissa & 1)))
+			halfMantissa++;
+
+		return sign | static_cast<uint16_t>(halfMantissa);
+	}
+
+	// Normalized half: rebias the exponent and round the mantissa to nearest even
+	uint32_t rounded = absBits + 0x0FFF + ((absBits >> 13) & 1);
+	return sign | static_cast<uint16_t>((rounded - 0x38000000) >> 13);
+}
+
+float halfToFloat(uint16_t value)
+{
+	uint32_t sign = static_cast<uint32_t>(value & 0x8000) << 16;
+	uint32_t exponent = (value >> 10) & 0x1F;
+	uint32_t mantissa = value & 0x03FF;
+
+	uint32_t bits;
+	if (exponent == 0)
+	{
+		float result = std::ldexp(static_cast<float>(mantissa), -24);
+		return sign ? -result : result;
+	}
+	else if (exponent == 31)
+		bits = sign | 0x7F800000 | (mantissa << 13);
+	else
+		bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+
+	float result;
+	std::memcpy(&result, &bits, sizeof(result));
+	return result;
+}
+
+void octEncode(const float direction[3], int16_t encoded[2])
+{
+	float l1 = std::abs(direction[0]) + std::abs(direction[1]) + std::abs(direction[2]);
+	if (l1 <= 0.0f)
+	{
+		encoded[0] = encoded[1] = 0;
+		return;
+	}
+
+	float x = direction[0] / l1;
+	float y = direction[1] / l1;
+
+	// Fold the lower hemisphere over the diagonals
+	if (direction[2] < 0.0f)
+	{
+		float folded_x = (1.0f - std::abs(y)) * signNotZero(x);
+		float folded_y = (1.0f - std::abs(x)) * signNotZero(y);
+		x = folded_x;
+		y = folded_y;
+	}
+
+	encoded[0] = toSnorm16(x);
+	encoded[1] = toSnorm16(y);
+}
+
+void octDecode(const int16_t encoded[2], float direction[3])
+{
+	// Same code as octDecode() in game.fx
+	float x = fromSnorm16(encoded[0]);
+	float y = fromSnorm16(encoded[1]);
+	float z = 1.0f - std::abs(x) - std::abs(y);
+
+	if (z < 0.0f)
+	{
+		float unfolded_x = (1.0f - std::abs(y)) * signNotZero(x);
+		float unfolded_y = (1.0f - std::abs(x)) * signNotZero(y);
+		x = unfolded_x;
+		y = unfolded_y;
+	}
+
+	float l = std::sqrt(x * x + y * y + z * z);
+	direction[0] = x / l;
+	direction[1] = y / l;
+	direction[2] = z / l;
+}
+
+QuantizationParams quantizeVertices(const std::vector<Vertex>& vertices, std::vector<QuantizedVertex>& quantized)
+{
+	QuantizationParams params;
+	quantized.resize(vertices.size());
+	if (vertices.empty())
+		return params;
+
+	// Mesh bounds
+	float max[3];
+	for (int k = 0; k < 3; k++)
+		params.positionMin[k] = max[k] = vertices[0].position[k];
+	for (const auto& v : vertices)
+		for (int k = 0; k < 3; k++)
+		{
+			params.positionMin[k] = std::min(params.positionMin[k], v.position[k]);
+			max[k] = std::max(max[k], v.position[k]);
+		}
+	for (int k = 0; k < 3; k++)
+		params.positionScale[k] = max[k] - params.positionMin[k];
+
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		const Vertex& v = vertices[i];
+		QuantizedVertex& q = quantized[i];
+
+		for (int k = 0; k < 3; k++)
+		{
+			float normalized = params.positionScale[k] > 0.0f
+				? (v.position[k] - params.positionMin[k]) / params.positionScale[k]
+				: 0.0f;
+			q.position[k] = static_cast<uint16_t>(std::lround(std::min(std::max(normalized, 0.0f), 1.0f) * 65535.0f));
+		}
+		q.position[3] = 0;
+
+		q.texCoord[0] = floatToHalf(v.texCoord[0]);
+		q.texCoord[1] = floatToHalf(v.texCoord[1]);
+
+		octEncode(v.normal, &q.normalTangent[0]);
+		octEncode(v.tangent, &q.normalTangent[2]);
+	}
+
+	return params;
+}
+
+void dequantizeVertices(const std::vector<QuantizedVertex>& quantized, const QuantizationParams& params, std::vector<Vertex>& vertices)
+{
+	vertices.resize(quantized.size());
+
+	for (size_t i = 0; i < quantized.size(); i++)
+	{
+		const QuantizedVertex& q = quantized[i];
+		Vertex& v = vertices[i];
+
+		for (int k = 0; k < 3; k++)
+			v.position[k] = params.positionMin[k] + q.position[k] / 65535.0f * params.positionScale[k];
+
+		v.texCoord[0] = halfToFloat(q.texCoord[0]);
+		v.texCoord[1] = halfToFloat(q.texCoord[1]);
+
+		octDecode(&q.normalTangent[0], v.normal);
+		octDecode(&q.normalTangent[2], v.tangent);
+	}
+}
+
+QuantizationError measureQuantizationError(const std::vector<Vertex>& original, const std::vector<Vertex>& decoded)
+{
+	QuantizationError error;
+	size_t count = std::min(original.size(), decoded.size());
+	if (count == 0)
+		return error;
+
+	double squaredSum = 0.0;
+	for (size_t i = 0; i < count; i++)
+	{
+		const Vertex& a = original[i];
+		const Vertex& b = decoded[i];
+
+		float d[3] = { a.position[0] - b.position[0], a.position[1] - b.position[1], a.position[2] - b.position[2] };
+		float distance = length(d);
+		error.maxPosition = std::max(error.maxPosition, distance);
+		squaredSum += distance * distance;
+
+		for (int k = 0; k < 2; k++)
+		{
+			// std::max would drop a NaN difference, which has to fail the check
+			float difference = std::abs(a.texCoord[k] - b.texCoord[k]);
+			if (std::isnan(difference) || difference > error.maxTexCoord)
+				error.maxTexCoord = difference;
+		}
+
+		error.maxNormalAngle = std::max(error.maxNormalAngle, angleBetween(a.normal, b.normal));
+		error.maxTangentAngle = std::max(error.maxTangentAngle, angleBetween(a.tangent, b.tangent));
+	}
+	error.rmsPosition = static_cast<float>(std::sqrt(squaredSum / count));
+
+	return error;
+}
+
+bool isQuantizationErrorAcceptable(const QuantizationError& error, const QuantizationParams& params)
+{
+	// Half a quantization step per axis, with some slack for float rounding
+	float step = length(params.positionScale) / 65535.0f;
+	if (error.maxPosition > step * 0.5f + 1e-5f)
+		return false;
+
+	// Written as <= so that NaN fails as well
+	if (!(error.maxTexCoord <= kMaxTexCoordError))
+		return false;
+
+	return error.maxNormalAngle <= kMaxDirectionError && error.maxTangentAngle <= kMaxDirectionError;
+}
+
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "T3dFile.h"
+
+namespace MeshTools
+{
+
+// Compressed vertex of a version 2 t3d file (20 instead of 44 bytes).
+// Must match T3dQuantizedVertex in Game/src/T3d.h and the input layout created there.
+struct QuantizedVertex
+{
+	uint16_t position[4];     // R16G16B16A16_UNORM relative to the mesh bounds, w is unused
+	uint16_t texCoord[2];     // R16G16_FLOAT
+	int16_t normalTangent[4]; // R16G16B16A16_SNORM, octahedral normal (xy) and tangent (zw)
+};
+static_assert(sizeof(QuantizedVertex) == 20, "QuantizedVertex must match the t3d version 2 layout");
+
+// Dequantization: position = positionMin + unorm * positionScale
+struct QuantizationParams
+{
+	float positionMin[3] = { 0, 0, 0 };
+	float positionScale[3] = { 1, 1, 1 };
+};
+
+// Largest round trip errors between the original and the decoded vertices
+struct QuantizationError
+{
+	float maxPosition = 0;     // in object space units
+	float rmsPosition = 0;
+	float maxTexCoord = 0;
+	float maxNormalAngle = 0;  // in degrees
+	float maxTangentAngle = 0; // in degrees
+};
+
+uint16_t floatToHalf(float value);
+float halfToFloat(uint16_t value);
+
+// Octahedral mapping of a (not necessarily normalized) direction to two snorm16 values
+void octEncode(const float direction[3], int16_t encoded[2]);
+void octDecode(const int16_t encoded[2], float direction[3]);
+
+QuantizationParams quantizeVertices(const std::vector<Vertex>& vertices, std::vector<QuantizedVertex>& quantized);
+void dequantizeVertices(const std::vector<QuantizedVertex>& quantized, const QuantizationParams& params, std::vector<Vertex>& vertices);
+
+QuantizationError measureQuantizationError(const std::vector<Vertex>& original, const std::vector<Vertex>& decoded);
+
+// Checks the errors against the precision of the formats. The position bound depends on the mesh bounds,
+// texture coordinates must stay within a quarter texel of a 256 texture.
+bool isQuantizationErrorAcceptable(const QuantizationError& error, const QuantizationParams& params);
+
+}
@@ -0,0 +1,483 @@
+#include "Simplify.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "VertexCache.h"
+
+namespace MeshTools
+{
+
+namespace
+{
+	const uint32_t kNone = std::numeric_limits<uint32_t>::max();
+
+	// Borders are weighted more than surfaces so that silhouettes stay in place
+	const double kBorderWeight = 10.0;
+
+	// Cosine of the largest normal rotation of a triangle during a collapse
+	const double kMinNormalDot = 0.25;
+
+	enum VertexKind
+	{
+		kManifold, // Single wedge, surrounded by triangles
+		kBorder,   // Single wedge on an open edge
+		kSeam,     // Two wedges (texture seam), closed if only positions are considered
+		kLocked,   // Corners and complex topology
+	};
+
+	// Symmetric 4x4 matrix, evaluates to the weighted sum of squared distances to planes
+	struct Quadric
+	{
+		double a00 = 0, a11 = 0, a22 = 0, a01 = 0, a02 = 0, a12 = 0;
+		double b0 = 0, b1 = 0, b2 = 0;
+		double c = 0;
+		double weight = 0;
+
+		void addPlane(const double n[3], double d, double w)
+		{
+			a00 += n[0] * n[0] * w;
+			a11 += n[1] * n[1] * w;
+			a22 += n[2] * n[2] * w;
+			a01 += n[0] * n[1] * w;
+			a02 += n[0] * n[2] * w;
+			a12 += n[1] * n[2] * w;
+			b0 += n[0] * d * w;
+			b1 += n[1] * d * w;
+			b2 += n[2] * d * w;
+			c += d * d * w;
+			weight += w;
+		}
+
+		void add(const Quadric& q)
+		{
+			a00 += q.a00; a11 += q.a11; a22 += q.a22;
+			a01 += q.a01; a02 += q.a02; a12 += q.a12;
+			b0 += q.b0; b1 += q.b1; b2 += q.b2;
+			c += q.c;
+			weight += q.weight;
+		}
+
+		// Mean squared distance of p to the planes
+		double evaluate(const float* p) const
+		{
+			double x = p[0], y = p[1], z = p[2];
+			double r = a00 * x * x + a11 * y * y + a22 * z * z
+				+ 2 * (a01 * x * y + a02 * x * z + a12 * y * z)
+				+ 2 * (b0 * x + b1 * y + b2 * z) + c;
+			return weight > 0 ? std::abs(r) / weight : 0.0;
+		}
+	};
+
+	struct Collapse
+	{
+		uint32_t source;
+		uint32_t target;
+		double error;
+	};
+
+	uint64_t edgeKey(uint32_t a, uint32_t b)
+	{
+		return (static_cast<uint64_t>(a) << 32) | b;
+	}
+
+	void triangleNormal(const float* p0, const float* p1, const float* p2, double n[3])
+	{
+		double e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+		double e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+		n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+		n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+		n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+	}
+
+	// Vertices with the same position form a group, represented by its first vertex
+	std::vector<uint32_t> buildPositionGroups(const std::vector<Vertex>& vertices)
+	{
+		struct PositionHash
+		{
+			size_t operator()(const Vertex* v) const
+			{
+				uint32_t h[3];
+				std::memcpy(h, v->position, sizeof(h));
+				return (h[0] * 73856093u) ^ (h[1] * 19349663u) ^ (h[2] * 83492791u);
+			}
+		};
+		struct PositionEqual
+		{
+			bool operator()(const Vertex* a, const Vertex* b) const
+			{
+				return std::memcmp(a->position, b->position, sizeof(a->position)) == 0;
+			}
+		};
+
+		std::unordered_map<const Vertex*, uint32_t, PositionHash, PositionEqual> first;
+		first.reserve(vertices.size());
+
+		std::vector<uint32_t> group(vertices.size());
+		for (size_t v = 0; v < vertices.size(); v++)
+			group[v] = first.emplace(&vertices[v], static_cast<uint32_t>(v)).first->second;
+		return group;
+	}
+
+	// Open edges and vertex kinds of the current triangles
+	struct Topology
+	{
+		std::vector<uint32_t> openOut, openIn;           // Neighbor along an open edge, if exactly one
+		std::vector<uint8_t> openOutCount, openInCount;
+		std::vector<uint32_t> sibling;                   // Other wedge of seam vertices
+		std::vector<uint8_t> kind;
+
+		void build(const std::vector<uint32_t>& indices, const std::vector<uint32_t>& group)
+		{
+			const size_t vertexCount = group.size();
+			openOut.assign(vertexCount, kNone);
+			openIn.assign(vertexCount, kNone);
+			openOutCount.assign(vertexCount, 0);
+			openInCount.assign(vertexCount, 0);
+			sibling.assign(vertexCount, kNone);
+			kind.assign(vertexCount, kManifold);
+
+			std::unordered_set<uint64_t> edges;
+			edges.reserve(indices.size());
+			for (size_t i = 0; i < indices.size(); i += 3)
+				for (size_t k = 0; k < 3; k++)
+					edges.insert(edgeKey(indices[i + k], indices[i + (k + 1) % 3]));
+
+			for (size_t i = 0; i < indices.size(); i += 3)
+				for (size_t k = 0; k < 3; k++)
+				{
+					uint32_t a = indices[i + k], b = indices[i + (k + 1) % 3];
+					if (edges.count(edgeKey(b, a)))
+						continue;
+
+					openOut[a] = b;
+					openIn[b] = a;
+					openOutCount[a] = static_cast<uint8_t>(std::min(openOutCount[a] + 1, 255));
+					openInCount[b] = static_cast<uint8_t>(std::min(openInCount[b] + 1, 255));
+				}
+
+			// Referenced wedges per position group
+			std::vector<uint32_t> wedgeCount(vertexCount, 0), firstWedge(vertexCount, kNone), secondWedge(vertexCount, kNone);
+			std::vector<bool> referenced(vertexCount, false);
+			for (uint32_t v : indices)
+				referenced[v] = true;
+			for (uint32_t v = 0; v < vertexCount; v++)
+			{
+				if (!referenced[v])
+					continue;
+				uint32_t g = group[v];
+				if (wedgeCount[g] == 0)
+					firstWedge[g] = v;
+				else if (wedgeCount[g] == 1)
+					secondWedge[g] = v;
+				wedgeCount[g]++;
+			}
+
+			for (uint32_t v = 0; v < vertexCount; v++)
+			{
+				if (!referenced[v])
+					continue;
+
+				uint32_t g = group[v];
+				bool singleOpen = openOutCount[v] == 1 && openInCount[v] == 1;
+				if (wedgeCount[g] == 1)
+				{
+					if (openOutCount[v] == 0 && openInCount[v] == 0)
+						kind[v] = kManifold;
+					else
+						kind[v] = singleOpen ? kBorder : kLocked;
+				}
+				else if (wedgeCount[g] == 2)
+				{
+					uint32_t w = firstWedge[g] == v ? secondWedge[g] : firstWedge[g];
+					bool paired = singleOpen && openOutCount[w] == 1 && openInCount[w] == 1
+						&& group[openOut[v]] == group[openIn[w]] && group[openIn[v]] == group[openOut[w]];
+					kind[v] = paired ? kSeam : kLocked;
+					sibling[v] = w;
+				}
+				else
+					kind[v] = kLocked;
+			}
+		}
+	};
+
+	// True if the collapse of source onto target keeps the topology of borders and seams
+	bool canCollapse(const Topology& topology, uint32_t source, uint32_t target)
+	{
+		uint8_t sourceKind = topology.kind[source];
+		uint8_t targetKind = topology.kind[target];
+
+		if (sourceKind == kManifold)
+			return true;
+		if (sourceKind == kBorder || sourceKind == kSeam)
+			return targetKind == sourceKind
+				&& (topology.openOut[source] == target || topology.openIn[source] == target);
+		return false;
+	}
+
+	// Other wedge of the target for the sibling of a seam source
+	uint32_t siblingTarget(const Topology& topology, uint32_t source, uint32_t target)
+	{
+		uint32_t sourceSibling = topology.sibling[source];
+		return topology.openOut[source] == target ? topology.openIn[sourceSibling] : topology.openOut[sourceSibling];
+	}
+
+	// True if one of the triangles around source turns around when source moves to target
+	bool hasTriangleFlips(const std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices,
+		const std::vector<uint32_t>& adjacencyOffset, const std::vector<uint32_t>& adjacency,
+		const std::vector<uint32_t>& group, uint32_t source, uint32_t target)
+	{
+		const float* targetPosition = vertices[target].position;
+
+		for (uint32_t i = adjacencyOffset[source]; i < adjacencyOffset[source + 1]; i++)
+		{
+			const uint32_t* tri = &indices[adjacency[i] * 3];
+
+			// Triangles with both vertices vanish
+			if (group[tri[0]] == group[target] || group[tri[1]] == group[target] || group[tri[2]] == group[target])
+				continue;
+
+			const float* before[3];
+			const float* after[3];
+			for (size_t k = 0; k < 3; k++)
+			{
+				before[k] = vertices[tri[k]].position;
+				after[k] = tri[k] == source ? targetPosition : before[k];
+			}
+
+			double n0[3], n1[3];
+			triangleNormal(before[0], before[1], before[2], n0);
+			triangleNormal(after[0], after[1], after[2], n1);
+			// Also reject triangles which turn by more than ~75 degrees, they often fold over later
+			double dot = n0[0] * n1[0] + n0[1] * n1[1] + n0[2] * n1[2];
+			double lengths = std::sqrt((n0[0] * n0[0] + n0[1] * n0[1] + n0[2] * n0[2]) * (n1[0] * n1[0] + n1[1] * n1[1] + n1[2] * n1[2]));
+			if (dot <= kMinNormalDot * lengths)
+				return true;
+		}
+		return false;
+	}
+}
+
+std::vector<uint32_t> simplifyMesh(const std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices,
+	size_t targetIndexCount, float maxError, float* error)
+{
+	const size_t vertexCount = vertices.size();
+	const std::vector<uint32_t> group = buildPositionGroups(vertices);
+
+	// Drop degenerate triangles up front
+	std::vector<uint32_t> result;
+	result.reserve(indices.size());
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		uint32_t a = indices[i], b = indices[i + 1], c = indices[i + 2];
+		if (group[a] != group[b] && group[b] != group[c] && group[a] != group[c])
+			result.insert(result.end(), { a, b, c });
+	}
+
+	Topology topology;
+	topology.build(result, group);
+
+	// Plane quadrics of the triangles, weighted by area
+	std::vector<Quadric> quadrics(vertexCount);
+	for (size_t i = 0; i < result.size(); i += 3)
+	{
+		const float* p0 = vertices[result[i]].position;
+		const float* p1 = vertices[result[i + 1]].position;
+		const float* p2 = vertices[result[i + 2]].position;
+
+		double n[3];
+		triangleNormal(p0, p1, p2, n);
+		double length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+		if (length <= 0.0)
+			continue;
+		for (int k = 0; k < 3; k++)
+			n[k] /= length;
+		double d = -(n[0] * p0[0] + n[1] * p0[1] + n[2] * p0[2]);
+
+		for (size_t k = 0; k < 3; k++)
+		{
+			quadrics[group[result[i + k]]].addPlane(n, d, length * 0.5);
+
+			// Planes perpendicular to open edges keep borders and seams in place
+			uint32_t a = result[i + k], b = result[i + (k + 1) % 3];
+			if (topology.openOut[a] != b)
+				continue;
+
+			const float* pa = vertices[a].position;
+			const float* pb = vertices[b].position;
+			double e[3] = { pb[0] - pa[0], pb[1] - pa[1], pb[2] - pa[2] };
+			double edgeLengthSquared = e[0] * e[0] + e[1] * e[1] + e[2] * e[2];
+			double en[3] = { e[1] * n[2] - e[2] * n[1], e[2] * n[0] - e[0] * n[2], e[0] * n[1] - e[1] * n[0] };
+			double enLength = std::sqrt(en[0] * en[0] + en[1] * en[1] + en[2] * en[2]);
+			if (enLength <= 0.0)
+				continue;
+			for (int c = 0; c < 3; c++)
+				en[c] /= enLength;
+			double ed = -(en[0] * pa[0] + en[1] * pa[1] + en[2] * pa[2]);
+
+			quadrics[group[a]].addPlane(en, ed, edgeLengthSquared * kBorderWeight);
+			quadrics[group[b]].addPlane(en, ed, edgeLengthSquared * kBorderWeight);
+		}
+	}
+
+	const double maxErrorSquared = static_cast<double>(maxError) * maxError;
+	double resultErrorSquared = 0.0;
+
+	std::vector<uint32_t> adjacencyOffset(vertexCount + 1), adjacency;
+	std::vector<Collapse> collapses;
+	std::vector<uint32_t> remap(vertexCount);
+	std::vector<bool> locked(vertexCount);
+
+	while (result.size() > targetIndexCount)
+	{
+		// Vertex -> triangle adjacency in compressed rows
+		std::fill(adjacencyOffset.begin(), adjacencyOffset.end(), 0);
+		for (uint32_t index : result)
+			adjacencyOffset[index + 1]++;
+		for (size_t v = 0; v < vertexCount; v++)
+			adjacencyOffset[v + 1] += adjacencyOffset[v];
+		adjacency.resize(result.size());
+		{
+			std::vector<uint32_t> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+			for (size_t i = 0; i < result.size(); i++)
+				adjacency[fill[result[i]]++] = static_cast<uint32_t>(i / 3);
+		}
+
+		// Cheapest direction of every edge
+		collapses.clear();
+		for (size_t i = 0; i < result.size(); i += 3)
+			for (size_t k = 0; k < 3; k++)
+			{
+				uint32_t a = result[i + k], b = result[i + (k + 1) % 3];
+				Collapse best = { kNone, kNone, std::numeric_limits<double>::max() };
+				for (int direction = 0; direction < 2; direction++)
+				{
+					uint32_t source = direction == 0 ? a : b;
+					uint32_t target = direction == 0 ? b : a;
+					if (!canCollapse(topology, source, target))
+						continue;
+
+					Quadric q = quadrics[group[source]];
+					q.add(quadrics[group[target]]);
+					double cost = q.evaluate(vertices[target].position);
+					if (cost < best.error)
+						best = { source, target, cost };
+				}
+				if (best.source != kNone)
+					collapses.push_back(best);
+			}
+
+		std::sort(collapses.begin(), collapses.end(),
+			[](const Collapse& a, const Collapse& b)
+			{
+				return a.error < b.error;
+			});
+
+		// Each collapse removes up to two triangles
+		size_t triangleGoal = (result.size() - targetIndexCount) / 3;
+		size_t removedTriangles = 0;
+
+		for (size_t v = 0; v < vertexCount; v++)
+			remap[v] = static_cast<uint32_t>(v);
+		std::fill(locked.begin(), locked.end(), false);
+
+		for (const Collapse& c : collapses)
+		{
+			if (c.error > maxErrorSquared || removedTriangles >= triangleGoal)
+				break;
+			if (locked[group[c.source]] || locked[group[c.target]])
+				continue;
+
+			uint32_t sources[2] = { c.source, kNone };
+			uint32_t targets[2] = { c.target, kNone };
+			if (topology.kind[c.source] == kSeam)
+			{
+				sources[1] = topology.sibling[c.source];
+				targets[1] = siblingTarget(topology, c.source, c.target);
+				if (targets[1] == kNone || group[targets[1]] != group[c.target])
+					continue;
+			}
+
+			bool flips = false;
+			for (int s = 0; s < 2 && sources[s] != kNone; s++)
+				flips = flips || hasTriangleFlips(result, vertices, adjacencyOffset, adjacency, group, sources[s], targets[s]);
+			if (flips)
+				continue;
+
+			// Lock everything around the source, its triangles change in this pass
+			for (int s = 0; s < 2 && sources[s] != kNone; s++)
+			{
+				remap[sources[s]] = targets[s];
+				for (uint32_t i = adjacencyOffset[sources[s]]; i < adjacencyOffset[sources[s] + 1]; i++)
+				{
+					const uint32_t* tri = &result[adjacency[i] * 3];
+					bool vanishes = false;
+					for (size_t k = 0; k < 3; k++)
+					{
+						locked[group[tri[k]]] = true;
+						vanishes = vanishes || group[tri[k]] == group[c.target];
+					}
+					if (vanishes)
+						removedTriangles++;
+				}
+			}
+
+			quadrics[group[c.target]].add(quadrics[group[c.source]]);
+			resultErrorSquared = std::max(resultErrorSquared, c.error);
+		}
+
+		if (removedTriangles == 0)
+			break;
+
+		// Apply the collapses and drop the vanished triangles
+		size_t write = 0;
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			uint32_t a = remap[result[i]], b = remap[result[i + 1]], c = remap[result[i + 2]];
+			if (group[a] == group[b] || group[b] == group[c] || group[a] == group[c])
+				continue;
+			result[write++] = a;
+			result[write++] = b;
+			result[write++] = c;
+		}
+		result.resize(write);
+
+		topology.build(result, group);
+	}
+
+	if (error)
+		*error = static_cast<float>(std::sqrt(resultErrorSquared));
+	return result;
+}
+
+void generateLods(T3dMesh& mesh, size_t levelCount)
+{
+	const uint32_t baseIndexCount = static_cast<uint32_t>(mesh.lods.empty() ? mesh.indices.size() : mesh.lods[0].indexCount);
+	mesh.indices.resize(baseIndexCount);
+	const std::vector<uint32_t> base = mesh.indices;
+
+	mesh.lods.clear();
+	mesh.lods.push_back({ 0, baseIndexCount, 0.0f });
+
+	for (size_t level = 1; level <= levelCount; level++)
+	{
+		size_t target = (base.size() / 3 >> level) * 3;
+		float error = 0.0f;
+		std::vector<uint32_t> lod = simplifyMesh(base, mesh.vertices, target, std::numeric_limits<float>::max(), &error);
+
+		// No further simplification possible
+		if (lod.empty() || lod.size() >= mesh.lods.back().indexCount)
+			break;
+
+		optimizeVertexCache(lod, mesh.vertices.size());
+
+		mesh.lods.push_back({ static_cast<uint32_t>(mesh.indices.size()), static_cast<uint32_t>(lod.size()), error });
+		mesh.indices.insert(mesh.indices.end(), lod.begin(), lod.end());
+	}
+}
+
+}
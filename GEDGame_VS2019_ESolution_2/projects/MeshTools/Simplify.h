@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "T3dFile.h"
+
+namespace MeshTools
+{
+
+// Simplifies the mesh with quadric error metric edge collapses (Garland and Heckbert, "Surface
+// Simplification Using Quadric Error Metrics") until targetIndexCount is reached or no collapse
+// below maxError is left. Vertices are collapsed onto their neighbors and never moved, so the
+// result uses the same vertex buffer. Borders and texture seams only collapse along themselves.
+// error receives the largest collapse error as a distance in object space.
+std::vector<uint32_t> simplifyMesh(const std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices,
+	size_t targetIndexCount, float maxError, float* error = nullptr);
+
+// Appends up to levelCount simplified levels with 1/2, 1/4, ... of the triangles to mesh.indices
+// and describes all levels, including the original as level 0, in mesh.lods.
+// Generation stops early if a level can not be simplified any further.
+void generateLods(T3dMesh& mesh, size_t levelCount);
+
+}
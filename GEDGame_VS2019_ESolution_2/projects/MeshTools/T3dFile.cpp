@@ -0,0 +1,239 @@
+#include "T3dFile.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "Quantization.h"
+
+namespace MeshTools
+{
+
+namespace
+{
+	struct T3dHeader
+	{
+		int16_t magicNumber; // Must be 0x003D
+		int16_t version;     // 1 or 2
+		int32_t verticesSize;  // vertex buffer data size
+		int32_t indicesSize;   // index buffer data size
+	}; // Sizes are always in bytes
+
+	// Follows the header in version 2 files
+	struct T3dQuantizationHeader
+	{
+		float positionMin[3];
+		float positionScale[3];
+		int32_t indexSize;     // 2 or 4 bytes per index
+	};
+
+	// Optional data after the index buffer, any number of chunks may follow each other
+	struct T3dChunkHeader
+	{
+		char id[4];
+		uint32_t size;         // payload size in bytes
+	};
+
+	const int16_t kMagicNumber = 0x003D;
+	const char kClusterChunk[4] = { 'C', 'L', 'S', 'T' };
+	const char kLodChunk[4] = { 'L', 'O', 'D', 'S' };
+
+	void readChunks(std::istream& file, T3dMesh& mesh)
+	{
+		T3dChunkHeader chunk;
+		while (file.read(reinterpret_cast<char*>(&chunk), sizeof(chunk)))
+		{
+			if (std::memcmp(chunk.id, kClusterChunk, sizeof(chunk.id)) == 0)
+			{
+				mesh.clusters.resize(chunk.size / sizeof(Cluster));
+				file.read(reinterpret_cast<char*>(mesh.clusters.data()), chunk.size);
+			}
+			else if (std::memcmp(chunk.id, kLodChunk, sizeof(chunk.id)) == 0)
+			{
+				mesh.lods.resize(chunk.size / sizeof(LodLevel));
+				file.read(reinterpret_cast<char*>(mesh.lods.data()), chunk.size);
+			}
+			else
+				file.seekg(chunk.size, std::ios_base::cur);
+		}
+		// Reaching the end of the file is expected
+		file.clear();
+	}
+
+	void writeChunks(std::ostream& file, const T3dMesh& mesh)
+	{
+		if (!mesh.clusters.empty())
+		{
+			T3dChunkHeader chunk;
+			std::memcpy(chunk.id, kClusterChunk, sizeof(chunk.id));
+			chunk.size = static_cast<uint32_t>(mesh.clusters.size() * sizeof(Cluster));
+			file.write(reinterpret_cast<const char*>(&chunk), sizeof(chunk));
+			file.write(reinterpret_cast<const char*>(mesh.clusters.data()), chunk.size);
+		}
+
+		if (!mesh.lods.empty())
+		{
+			T3dChunkHeader chunk;
+			std::memcpy(chunk.id, kLodChunk, sizeof(chunk.id));
+			chunk.size = static_cast<uint32_t>(mesh.lods.size() * sizeof(LodLevel));
+			file.write(reinterpret_cast<const char*>(&chunk), sizeof(chunk));
+			file.write(reinterpret_cast<const char*>(mesh.lods.data()), chunk.size);
+		}
+	}
+}
+
+bool fitsShortIndices(size_t vertexCount)
+{
+	return vertexCount <= 0x10000;
+}
+
+bool readT3d(const std::string& filename, T3dMesh& mesh)
+{
+	std::ifstream file(filename, std::ios_base::binary);
+	if (!file.is_open())
+	{
+		std::cerr << "ERROR: Could not open " << filename << std::endl;
+		return false;
+	}
+
+	T3dHeader header;
+	if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+	{
+		std::cerr << "ERROR: Could not read the header of " << filename << std::endl;
+		return false;
+	}
+	if (header.magicNumber != kMagicNumber)
+	{
+		std::cerr << "ERROR: The magic number of " << filename << " is incorrect" << std::endl;
+		return false;
+	}
+	if (header.version != 1 && header.version != 2)
+	{
+		std::cerr << "ERROR: The header version of " << filename << " is incorrect" << std::endl;
+		return false;
+	}
+
+	if (header.version == 1)
+	{
+		mesh.vertices.resize(header.verticesSize / sizeof(Vertex));
+		mesh.indices.resize(header.indicesSize / sizeof(uint32_t));
+		file.read(reinterpret_cast<char*>(mesh.vertices.data()), mesh.vertices.size() * sizeof(Vertex));
+		file.read(reinterpret_cast<char*>(mesh.indices.data()), mesh.indices.size() * sizeof(uint32_t));
+	}
+	else
+	{
+		T3dQuantizationHeader quantization = {};
+		file.read(reinterpret_cast<char*>(&quantization), sizeof(quantization));
+		if (file && quantization.indexSize != 2 && quantization.indexSize != 4)
+		{
+			std::cerr << "ERROR: The index size of " << filename << " is incorrect" << std::endl;
+			return false;
+		}
+
+		QuantizationParams params;
+		for (int k = 0; k < 3; k++)
+		{
+			params.positionMin[k] = quantization.positionMin[k];
+			params.positionScale[k] = quantization.positionScale[k];
+		}
+
+		std::vector<QuantizedVertex> quantized(header.verticesSize / sizeof(QuantizedVertex));
+		file.read(reinterpret_cast<char*>(quantized.data()), quantized.size() * sizeof(QuantizedVertex));
+		dequantizeVertices(quantized, params, mesh.vertices);
+
+		mesh.indices.resize(file ? header.indicesSize / quantization.indexSize : 0);
+		if (quantization.indexSize == 2)
+		{
+			std::vector<uint16_t> shortIndices(mesh.indices.size());
+			file.read(reinterpret_cast<char*>(shortIndices.data()), shortIndices.size() * sizeof(uint16_t));
+			mesh.indices.assign(shortIndices.begin(), shortIndices.end());
+		}
+		else
+			file.read(reinterpret_cast<char*>(mesh.indices.data()), mesh.indices.size() * sizeof(uint32_t));
+	}
+
+	if (!file)
+	{
+		std::cerr << "ERROR: " << filename << " is truncated" << std::endl;
+		return false;
+	}
+
+	// The optimizers index per-vertex arrays with the indices
+	for (uint32_t index : mesh.indices)
+		if (index >= mesh.vertices.size())
+		{
+			std::cerr << "ERROR: " << filename << " has an index outside of its " << mesh.vertices.size() << " vertices" << std::endl;
+			return false;
+		}
+
+	mesh.clusters.clear();
+	mesh.lods.clear();
+	readChunks(file, mesh);
+
+	return true;
+}
+
+bool writeT3d(const std::string& filename, const T3dMesh& mesh)
+{
+	std::ofstream file(filename, std::ios_base::binary | std::ios_base::trunc);
+	if (!file.is_open())
+	{
+		std::cerr << "ERROR: Could not open " << filename << " for writing" << std::endl;
+		return false;
+	}
+
+	T3dHeader header;
+	header.magicNumber = kMagicNumber;
+	header.version = 1;
+	header.verticesSize = static_cast<int32_t>(mesh.vertices.size() * sizeof(Vertex));
+	header.indicesSize = static_cast<int32_t>(mesh.indices.size() * sizeof(uint32_t));
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(mesh.vertices.data()), header.verticesSize);
+	file.write(reinterpret_cast<const char*>(mesh.indices.data()), header.indicesSize);
+	writeChunks(file, mesh);
+
+	return static_cast<bool>(file);
+}
+
+bool writeT3dQuantized(const std::string& filename, const std::vector<QuantizedVertex>& vertices,
+	const QuantizationParams& params, const T3dMesh& mesh)
+{
+	std::ofstream file(filename, std::ios_base::binary | std::ios_base::trunc);
+	if (!file.is_open())
+	{
+		std::cerr << "ERROR: Could not open " << filename << " for writing" << std::endl;
+		return false;
+	}
+
+	T3dQuantizationHeader quantization;
+	for (int k = 0; k < 3; k++)
+	{
+		quantization.positionMin[k] = params.positionMin[k];
+		quantization.positionScale[k] = params.positionScale[k];
+	}
+	quantization.indexSize = fitsShortIndices(vertices.size()) ? 2 : 4;
+
+	T3dHeader header;
+	header.magicNumber = kMagicNumber;
+	header.version = 2;
+	header.verticesSize = static_cast<int32_t>(vertices.size() * sizeof(QuantizedVertex));
+	header.indicesSize = static_cast<int32_t>(mesh.indices.size() * quantization.indexSize);
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(&quantization), sizeof(quantization));
+	file.write(reinterpret_cast<const char*>(vertices.data()), header.verticesSize);
+
+	if (quantization.indexSize == 2)
+	{
+		std::vector<uint16_t> shortIndices(mesh.indices.begin(), mesh.indices.end());
+		file.write(reinterpret_cast<const char*>(shortIndices.data()), header.indicesSize);
+	}
+	else
+		file.write(reinterpret_cast<const char*>(mesh.indices.data()), header.indicesSize);
+	writeChunks(file, mesh);
+
+	return static_cast<bool>(file);
+}
+
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace MeshTools
+{
+
+// Plain C++ mirror of the game's T3dVertex (see Game/src/T3d.h).
+// The tools must not depend on DirectXMath, so the layout is spelled out with floats.
+struct Vertex
+{
+	float position[3];
+	float texCoord[2];
+	float normal[3];
+	float tangent[3];
+};
+static_assert(sizeof(Vertex) == 44, "Vertex must match the T3d vertex layout");
+
+// Contiguous range of triangles in the index buffer with bounds for culling.
+// Stored in the CLST chunk of t3d files and used by the game, so the layout is fixed.
+struct Cluster
+{
+	float center[3];      // Bounding sphere
+	float radius;
+	float coneApex[3];    // Normal cone, see isClusterBackfacing()
+	float coneCutoff;     // 1 if the cone can not be used for culling
+	float coneAxis[3];
+	uint32_t indexOffset; // First index of the cluster
+	uint32_t triangleCount;
+	uint32_t vertexCount;
+};
+static_assert(sizeof(Cluster) == 56, "Cluster must match the t3d CLST chunk layout");
+
+// Level of detail as a range of the index buffer, all levels share the vertices.
+// Stored in the LODS chunk of t3d files, level 0 is the original mesh.
+struct LodLevel
+{
+	uint32_t indexOffset;
+	uint32_t indexCount;
+	float error;          // Largest simplification error in object space units
+};
+static_assert(sizeof(LodLevel) == 12, "LodLevel must match the t3d LODS chunk layout");
+
+struct QuantizedVertex;
+struct QuantizationParams;
+
+// Geometry of a single t3d file (indexed triangle list)
+struct T3dMesh
+{
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;  // Indices of all levels of detail
+	std::vector<Cluster> clusters; // Optional, see Clusters.h. Only level 0 is clustered.
+	std::vector<LodLevel> lods;    // Optional, see Simplify.h
+};
+
+// Reads a version 1 or 2 t3d file, quantized vertices are decoded to floats.
+// Optional chunks after the index data are read if known and skipped otherwise.
+// Returns false and prints an error on failure.
+bool readT3d(const std::string& filename, T3dMesh& mesh);
+
+// Writes a version 1 t3d file. Returns false and prints an error on failure.
+bool writeT3d(const std::string& filename, const T3dMesh& mesh);
+
+// True if 16-bit indices can address all vertices
+bool fitsShortIndices(size_t vertexCount);
+
+// Writes a version 2 t3d file (see Quantization.h) with the indices and chunks of mesh. The indices
+// are stored with 16 bits if the vertex count allows it. Returns false and prints an error on failure.
+bool writeT3dQuantized(const std::string& filename, const std::vector<QuantizedVertex>& vertices,
+	const QuantizationParams& params, const T3dMesh& mesh);
+
+}
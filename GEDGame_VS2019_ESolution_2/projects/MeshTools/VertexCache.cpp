@@ -0,0 +1,327 @@
+#include "VertexCache.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace MeshTools
+{
+
+namespace
+{
+	// Tuning constants from Forsyth's paper
+	const int kScoreCacheSize = 32;
+	const float kCacheDecayPower = 1.5f;
+	const float kLastTriangleScore = 0.75f;
+	const float kValenceBoostScale = 2.0f;
+	const float kValenceBoostPower = 0.5f;
+
+	const uint32_t kUnused = std::numeric_limits<uint32_t>::max();
+
+	float vertexScore(int cachePosition, uint32_t remainingTriangles)
+	{
+		// No triangle needs this vertex anymore
+		if (remainingTriangles == 0)
+			return -1.0f;
+
+		float score = 0.0f;
+		if (cachePosition >= 0)
+		{
+			// The vertices of the last triangle get a fixed score so that strips are not preferred over fans
+			if (cachePosition < 3)
+				score = kLastTriangleScore;
+			else
+				score = std::pow(1.0f - static_cast<float>(cachePosition - 3) / (kScoreCacheSize - 3), kCacheDecayPower);
+		}
+
+		// Prefer vertices with few remaining triangles to get rid of lone triangles early
+		score += kValenceBoostScale * std::pow(static_cast<float>(remainingTriangles), -kValenceBoostPower);
+		return score;
+	}
+
+	struct Vec3
+	{
+		float x = 0, y = 0, z = 0;
+	};
+
+	Vec3 sub(const float* a, const float* b) { return { a[0] - b[0], a[1] - b[1], a[2] - b[2] }; }
+	Vec3 cross(const Vec3& a, const Vec3& b) { return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; }
+}
+
+CacheStatistics analyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, size_t cacheSize)
+{
+	CacheStatistics stats;
+	if (indices.empty())
+		return stats;
+
+	// FIFO cache: a vertex is cached if it was inserted less than cacheSize insertions ago
+	std::vector<uint64_t> insertedAt(vertexCount, 0);
+	std::vector<bool> used(vertexCount, false);
+	uint64_t time = cacheSize + 1;
+	size_t usedCount = 0;
+
+	for (uint32_t index : indices)
+	{
+		if (time - insertedAt[index] > cacheSize)
+		{
+			insertedAt[index] = time++;
+			stats.transformedVertices++;
+		}
+		if (!used[index])
+		{
+			used[index] = true;
+			usedCount++;
+		}
+	}
+
+	stats.acmr = static_cast<float>(stats.transformedVertices) / (indices.size() / 3);
+	stats.atvr = static_cast<float>(stats.transformedVertices) / usedCount;
+	return stats;
+}
+
+void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount)
+{
+	const size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+		return;
+
+	// Vertex -> triangle adjacency in compressed rows
+	std::vector<uint32_t> adjacencyOffset(vertexCount + 1, 0);
+	for (uint32_t index : indices)
+		adjacencyOffset[index + 1]++;
+	for (size_t v = 0; v < vertexCount; v++)
+		adjacencyOffset[v + 1] += adjacencyOffset[v];
+
+	std::vector<uint32_t> adjacency(indices.size());
+	std::vector<uint32_t> remaining(vertexCount, 0); // Triangles not emitted yet, stored first in each row
+	for (size_t t = 0; t < triangleCount; t++)
+		for (size_t k = 0; k < 3; k++)
+		{
+			uint32_t v = indices[t * 3 + k];
+			adjacency[adjacencyOffset[v] + remaining[v]++] = static_cast<uint32_t>(t);
+		}
+
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> score(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+		score[v] = vertexScore(-1, remaining[v]);
+
+	std::vector<float> triangleScore(triangleCount);
+	std::vector<bool> emitted(triangleCount, false);
+	for (size_t t = 0; t < triangleCount; t++)
+		triangleScore[t] = score[indices[t * 3]] + score[indices[t * 3 + 1]] + score[indices[t * 3 + 2]];
+
+	std::vector<uint32_t> output;
+	output.reserve(indices.size());
+
+	std::vector<uint32_t> cache, nextCache;
+	cache.reserve(kScoreCacheSize + 3);
+	nextCache.reserve(kScoreCacheSize + 3);
+
+	size_t scanCursor = 0;
+	int64_t best = -1;
+
+	while (output.size() < triangleCount * 3)
+	{
+		// Nothing useful in the cache: continue with the next triangle in input order
+		if (best < 0)
+		{
+			while (emitted[scanCursor])
+				scanCursor++;
+			best = static_cast<int64_t>(scanCursor);
+		}
+
+		const uint32_t* tri = &indices[best * 3];
+		emitted[best] = true;
+
+		nextCache.clear();
+		for (size_t k = 0; k < 3; k++)
+		{
+			uint32_t v = tri[k];
+			output.push_back(v);
+			nextCache.push_back(v);
+
+			// Remove the triangle from the active part of the adjacency row
+			uint32_t* row = &adjacency[adjacencyOffset[v]];
+			uint32_t* last = row + remaining[v] - 1;
+			*std::find(row, last + 1, static_cast<uint32_t>(best)) = *last;
+			remaining[v]--;
+		}
+
+		// Move the triangle's vertices to the front of the LRU cache
+		for (uint32_t v : cache)
+			if (v != tri[0] && v != tri[1] && v != tri[2])
+				nextCache.push_back(v);
+
+		for (size_t i = 0; i < nextCache.size(); i++)
+		{
+			uint32_t v = nextCache[i];
+			cachePosition[v] = i < kScoreCacheSize ? static_cast<int>(i) : -1;
+		}
+
+		// Update the scores of all vertices that were touched and their triangles
+		for (uint32_t v : nextCache)
+		{
+			float newScore = vertexScore(cachePosition[v], remaining[v]);
+			float delta = newScore - score[v];
+			score[v] = newScore;
+
+			for (uint32_t i = 0; i < remaining[v]; i++)
+				triangleScore[adjacency[adjacencyOffset[v] + i]] += delta;
+		}
+
+		// Only compare once all deltas are applied, a triangle of several touched vertices would
+		// otherwise compete with a partially updated score
+		best = -1;
+		float bestScore = -1.0f;
+		for (uint32_t v : nextCache)
+			for (uint32_t i = 0; i < remaining[v]; i++)
+			{
+				uint32_t t = adjacency[adjacencyOffset[v] + i];
+				if (triangleScore[t] > bestScore)
+				{
+					bestScore = triangleScore[t];
+					best = t;
+				}
+			}
+
+		if (nextCache.size() > kScoreCacheSize)
+			nextCache.resize(kScoreCacheSize);
+		std::swap(cache, nextCache);
+	}
+
+	indices.swap(output);
+}
+
+void optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices, size_t cacheSize)
+{
+	const size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+		return;
+
+	// Split into clusters wherever a triangle misses the cache with all three vertices
+	std::vector<size_t> clusterStart;
+	std::vector<uint64_t> insertedAt(vertices.size(), 0);
+	uint64_t time = cacheSize + 1;
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		int misses = 0;
+		for (size_t k = 0; k < 3; k++)
+		{
+			uint32_t v = indices[t * 3 + k];
+			if (time - insertedAt[v] > cacheSize)
+			{
+				insertedAt[v] = time++;
+				misses++;
+			}
+		}
+		if (t == 0 || misses == 3)
+			clusterStart.push_back(t);
+	}
+	clusterStart.push_back(triangleCount);
+
+	const size_t clusterCount = clusterStart.size() - 1;
+	if (clusterCount <= 1)
+		return;
+
+	// Area weighted centroid and normal per cluster
+	std::vector<Vec3> clusterCentroid(clusterCount), clusterNormal(clusterCount);
+	std::vector<float> clusterArea(clusterCount, 0.0f);
+	Vec3 meshCentroid;
+	float meshArea = 0.0f;
+
+	for (size_t c = 0; c < clusterCount; c++)
+	{
+		Vec3& centroid = clusterCentroid[c];
+		Vec3& normal = clusterNormal[c];
+
+		for (size_t t = clusterStart[c]; t < clusterStart[c + 1]; t++)
+		{
+			const float* p0 = vertices[indices[t * 3]].position;
+			const float* p1 = vertices[indices[t * 3 + 1]].position;
+			const float* p2 = vertices[indices[t * 3 + 2]].position;
+
+			Vec3 n = cross(sub(p1, p0), sub(p2, p0));
+			float area = std::sqrt(n.x * n.x + n.y * n.y + n.z * n.z);
+
+			centroid.x += (p0[0] + p1[0] + p2[0]) / 3.0f * area;
+			centroid.y += (p0[1] + p1[1] + p2[1]) / 3.0f * area;
+			centroid.z += (p0[2] + p1[2] + p2[2]) / 3.0f * area;
+			normal.x += n.x;
+			normal.y += n.y;
+			normal.z += n.z;
+			clusterArea[c] += area;
+		}
+
+		meshCentroid.x += centroid.x;
+		meshCentroid.y += centroid.y;
+		meshCentroid.z += centroid.z;
+		meshArea += clusterArea[c];
+
+		if (clusterArea[c] > 0.0f)
+		{
+			centroid.x /= clusterArea[c];
+			centroid.y /= clusterArea[c];
+			centroid.z /= clusterArea[c];
+		}
+	}
+
+	if (meshArea > 0.0f)
+	{
+		meshCentroid.x /= meshArea;
+		meshCentroid.y /= meshArea;
+		meshCentroid.z /= meshArea;
+	}
+
+	// Clusters facing away from the mesh center are likely to occlude the others, so they go first
+	std::vector<float> sortKey(clusterCount);
+	for (size_t c = 0; c < clusterCount; c++)
+	{
+		const Vec3& n = clusterNormal[c];
+		float length = std::sqrt(n.x * n.x + n.y * n.y + n.z * n.z);
+		if (length <= 0.0f)
+			continue;
+
+		sortKey[c] = ((clusterCentroid[c].x - meshCentroid.x) * n.x
+			+ (clusterCentroid[c].y - meshCentroid.y) * n.y
+			+ (clusterCentroid[c].z - meshCentroid.z) * n.z) / length;
+	}
+
+	std::vector<size_t> order(clusterCount);
+	for (size_t c = 0; c < clusterCount; c++)
+		order[c] = c;
+	std::stable_sort(order.begin(), order.end(),
+		[&sortKey](size_t a, size_t b)
+		{
+			return sortKey[a] > sortKey[b];
+		});
+
+	std::vector<uint32_t> output;
+	output.reserve(indices.size());
+	for (size_t c : order)
+		output.insert(output.end(), indices.begin() + clusterStart[c] * 3, indices.begin() + clusterStart[c + 1] * 3);
+
+	indices.swap(output);
+}
+
+size_t optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	std::vector<uint32_t> remap(vertices.size(), kUnused);
+	std::vector<Vertex> output;
+	output.reserve(vertices.size());
+
+	for (uint32_t& index : indices)
+	{
+		if (remap[index] == kUnused)
+		{
+			remap[index] = static_cast<uint32_t>(output.size());
+			output.push_back(vertices[index]);
+		}
+		index = remap[index];
+	}
+
+	vertices.swap(output);
+	return vertices.size();
+}
+
+}
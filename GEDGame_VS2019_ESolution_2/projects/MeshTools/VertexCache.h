@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "T3dFile.h"
+
+namespace MeshTools
+{
+
+// Post-transform cache statistics of an index buffer, simulated with a FIFO cache
+struct CacheStatistics
+{
+	float acmr = 0; // average cache miss ratio: transformed vertices per triangle (0.5 is optimal, 3 is worst)
+	float atvr = 0; // average transformed vertex ratio: transformed vertices per used vertex (1 is optimal)
+	uint64_t transformedVertices = 0;
+};
+
+CacheStatistics analyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, size_t cacheSize = 16);
+
+// Reorders the triangles for post-transform cache efficiency
+// (Tom Forsyth, "Linear-Speed Vertex Cache Optimisation").
+void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount);
+
+// Reorders cache-coherent clusters of triangles from the outside to the inside to reduce overdraw.
+// Clusters are split where the simulated cache is cold, so the cache efficiency is kept.
+// Must run after optimizeVertexCache.
+void optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices, size_t cacheSize = 16);
+
+// Reorders the vertices in the order of their first use and drops unreferenced vertices.
+// Returns the new vertex count.
+size_t optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+}
@@ -9,19 +9,21 @@
 #include <chrono>
 #include <SimpleImage.h>
 #include <TextureGenerator.h>
+#include <DirectXTex.h>
 
 // Main Functions
 bool interpret_arguments(int argc, _TCHAR* argv[], int64_t& resolution, _TCHAR*& heightmap_path, _TCHAR*& color_path, _TCHAR*& normalmap_path);
 // Generators
 std::vector<float> generate_heightfield(int64_t resolution);
-std::vector<GEDUtils::Vec3f> generate_normals(std::vector<float>& height, int64_t resolution);
-std::vector<GEDUtils::Vec3f> generate_colors(std::vector<float>& height, std::vector<GEDUtils::Vec3f>& normal, int64_t resolution);
+DirectX::ScratchImage generate_normals(std::vector<float>& height, int64_t resolution);
+std::vector<GEDUtils::Vec3f> generate_colors(std::vector<float>& height, const DirectX::ScratchImage& normal, int64_t resolution);
 std::vector<float> resize_heightfield(std::vector<float>& height, int64_t resolution);
 // Other
 void smooth_heightfield(std::vector<float>& height, int64_t resolution, int64_t iterations, int64_t kernel_size);
 void make_pretty(std::vector<float>& height, int64_t resolution);
 bool save_image(std::vector<float>& data, int64_t resolution, _TCHAR* path);
 bool save_image(std::vector<GEDUtils::Vec3f>& data, int64_t resolution, _TCHAR* path);
+bool save_image(const DirectX::ScratchImage& normal, _TCHAR* path);
 // Helpers
 int64_t idx(int64_t x, int64_t y, int64_t size);
 float smoothstep(float x);
@@ -29,6 +31,7 @@ float clamp(float x, float min = 0.0f, float max = 1.0f);
 float map_range(float x, float from_low, float from_high, float to_low = 0.0f, float to_high = 1.0f);
 GEDUtils::Vec3f blend(GEDUtils::Vec3f& a, GEDUtils::Vec3f& b, float alpha);
 GEDUtils::Vec3f texture(GEDUtils::SimpleImage& tex, UINT u, UINT v);
+GEDUtils::Vec3f normal_at(const DirectX::ScratchImage& normal, int64_t x, int64_t y);
 
 int _tmain(int argc, _TCHAR* argv[])
 {
@@ -56,11 +59,11 @@ int _tmain(int argc, _TCHAR* argv[])
 
 	std::cout << "Saving Images" << std::endl;
 	auto height_small = resize_heightfield(height, resolution);
-	if (!save_image(height_small, resolution / 4, heightmap_path))
+	if (height_small.empty() || !save_image(height_small, resolution / 4, heightmap_path))
 		std::wcout << "ERROR: Heightmap could not be saved to: " << heightmap_path << std::endl;
 	if (!save_image(color, resolution, color_path))
 		std::wcout << "ERROR: Colormap could not be saved to: " << color_path << std::endl;
-	if (!save_image(normal, resolution, normalmap_path))
+	if (normal.GetImageCount() == 0 || !save_image(normal, normalmap_path))
 		std::wcout << "ERROR: Normalmap could not be saved to: " << normalmap_path << std::endl;
 
 	auto end_time = std::chrono::high_resolution_clock::now();
@@ -276,47 +279,36 @@ std::vector<float> generate_heightfield(int64_t resolution)
 	return heightfield;
 }
 
-std::vector<GEDUtils::Vec3f> generate_normals(std::vector<float>& height, int64_t resolution)
+DirectX::ScratchImage generate_normals(std::vector<float>& height, int64_t resolution)
 {
-	std::vector<GEDUtils::Vec3f> normal(resolution * resolution);
-
-	for (int64_t y = 0; y < resolution; y++)
-		for (int64_t x = 0; x < resolution; x++)
-		{
-			float n_x, n_y, n_z;
-
-			// Compute X
-			if (x == 0)
-				n_x = height[idx(x + 1, y, resolution)] - height[idx(x, y, resolution)];
-			else if (x == resolution - 1)
-				n_x = height[idx(x, y, resolution)] - height[idx(x - 1, y, resolution)];
-			else
-				n_x = (height[idx(x + 1, y, resolution)] - height[idx(x - 1, y, resolution)]) / 2;
-
-			// Compute Y
-			if (y == 0)
-				n_y = height[idx(x, y + 1, resolution)] - height[idx(x, y, resolution)];
-			else if (y == resolution - 1)
-				n_y = height[idx(x, y, resolution)] - height[idx(x, y - 1, resolution)];
-			else
-				n_y = (height[idx(x, y + 1, resolution)] - height[idx(x, y - 1, resolution)]) / 2;
-
-			// Set Z
-			n_z = 1.0f / resolution;
-
-			// Normalize
-			float length = sqrt(n_x * n_x + n_y * n_y + n_z * n_z);
-			n_x /= -length;
-			n_y /= -length;
-			n_z /= length;
-
-			normal[idx(x, y, resolution)] = GEDUtils::Vec3f(n_x * 0.5f + 0.5f, n_y * 0.5f + 0.5f, n_z * 0.5f + 0.5f);
-		}
+	// The normal map of DirectXTex is normalize(-dx, -dy, 1/resolution) on heights in [0, 1] when the
+	// amplitude is the resolution, with the differences averaged over the neighboring rows and columns.
+	// Only x and y are kept, as the terrain shader rebuilds the up component from them.
+	DirectX::Image image = {};
+	image.width = static_cast<size_t>(resolution);
+	image.height = static_cast<size_t>(resolution);
+	image.format = DXGI_FORMAT_R32_FLOAT;
+	image.rowPitch = image.width * sizeof(float);
+	image.slicePitch = image.rowPitch * image.height;
+	image.pixels = reinterpret_cast<uint8_t*>(height.data());
+
+	DirectX::TexMetadata metadata = {};
+	metadata.width = image.width;
+	metadata.height = image.height;
+	metadata.depth = metadata.arraySize = metadata.mipLevels = 1;
+	metadata.format = image.format;
+	metadata.dimension = DirectX::TEX_DIMENSION_TEXTURE2D;
+
+	// The terrain does not tile, so the borders are mirrored
+	DirectX::ScratchImage normal;
+	if (FAILED(DirectX::ComputeNormalMap(&image, 1, metadata, DirectX::CNMAP_CHANNEL_RED | DirectX::CNMAP_MIRROR,
+		static_cast<float>(resolution), DXGI_FORMAT_R16G16_UNORM, DirectX::ParallelOptions(), normal)))
+		std::cout << "ERROR: Normalmap could not be computed." << std::endl;
 
 	return normal;
 }
 
-std::vector<GEDUtils::Vec3f> generate_colors(std::vector<float>& height, std::vector<GEDUtils::Vec3f>& normal, int64_t resolution)
+std::vector<GEDUtils::Vec3f> generate_colors(std::vector<float>& height, const DirectX::ScratchImage& normal, int64_t resolution)
 {
 	GEDUtils::SimpleImage tex_low_flat(L"../../../../external/textures/mud02.jpg");
 	GEDUtils::SimpleImage tex_low_steep(L"../../../../external/textures/rock3.jpg");
@@ -333,7 +325,7 @@ std::vector<GEDUtils::Vec3f> generate_colors(std::vector<float>& height, std::ve
 			UINT v = static_cast<UINT>(y);
 
 			// Compute alpha
-			float alpha_slope = smoothstep(clamp(map_range(1.0f - normal[idx(x, y, resolution)].z, 0.1f, 0.2f)));
+			float alpha_slope = smoothstep(clamp(map_range(1.0f - normal_at(normal, x, y).z, 0.1f, 0.2f)));
 			float alpha_height = smoothstep(clamp(map_range(height[idx(x, y, resolution)], 0.3f, 0.32f)));
 
 			// Sample textures
@@ -476,23 +468,51 @@ bool save_image(std::vector<GEDUtils::Vec3f>& data, int64_t resolution, _TCHAR*
 	return image.save(path);
 }
 
-std::vector<float> resize_heightfield(std::vector<float>& height, int64_t resolution)
+bool save_image(const DirectX::ScratchImage& normal, _TCHAR* path)
 {
-	std::vector<float> output(resolution * resolution / 16);
+	const DirectX::Image* image = normal.GetImage(0, 0, 0);
+	GEDUtils::SimpleImage output(static_cast<UINT>(image->width), static_cast<UINT>(image->height));
 
-	for (int64_t y = 0; y < resolution / 4; y++)
-		for (int64_t x = 0; x < resolution / 4; x++)
+	for (int64_t y = 0; y < static_cast<int64_t>(image->height); y++)
+		for (int64_t x = 0; x < static_cast<int64_t>(image->width); x++)
 		{
-			float sum = 0;
+			GEDUtils::Vec3f n = normal_at(normal, x, y);
+			output.setPixel(static_cast<UINT>(x), static_cast<UINT>(y), n.x, n.y, n.z);
+		}
 
-			for (int64_t y_loc = y * 4; y_loc < (y * 4) + 4; y_loc++)
-				for (int64_t x_loc = x * 4; x_loc < (x * 4) + 4; x_loc++)
-					sum += height[idx(x_loc, y_loc, resolution)];
+	return output.save(path);
+}
 
-			output[idx(x, y, resolution / 4)] = sum / 16;
-		}
+std::vector<float> resize_heightfield(std::vector<float>& height, int64_t resolution)
+{
+	// A 4x4 box filter, done by the threaded resampler of DirectXTex straight on the heightfield
+	DirectX::Image image = {};
+	image.width = static_cast<size_t>(resolution);
+	image.height = static_cast<size_t>(resolution);
+	image.format = DXGI_FORMAT_R32_FLOAT;
+	image.rowPitch = image.width * sizeof(float);
+	image.slicePitch = image.rowPitch * image.height;
+	image.pixels = reinterpret_cast<uint8_t*>(height.data());
+
+	DirectX::TexMetadata metadata = {};
+	metadata.width = image.width;
+	metadata.height = image.height;
+	metadata.depth = metadata.arraySize = metadata.mipLevels = 1;
+	metadata.format = image.format;
+	metadata.dimension = DirectX::TEX_DIMENSION_TEXTURE2D;
+
+	DirectX::ScratchImage resized;
+	if (FAILED(DirectX::Resize(&image, 1, metadata, image.width / 4, image.height / 4, DirectX::TEX_FILTER_BOX,
+		DirectX::ParallelOptions(), resized)))
+	{
+		std::cout << "ERROR: Heightfield could not be resized." << std::endl;
+		return std::vector<float>();
+	}
 
-	return output;
+	// The rows of the result are packed, so they can be copied as a whole
+	const DirectX::Image* quarter = resized.GetImage(0, 0, 0);
+	const float* pixels = reinterpret_cast<const float*>(quarter->pixels);
+	return std::vector<float>(pixels, pixels + quarter->width * quarter->height);
 }
 
 // Grants access to a flattened array
@@ -535,4 +555,17 @@ inline GEDUtils::Vec3f texture(GEDUtils::SimpleImage& tex, UINT u, UINT v)
 	GEDUtils::Vec3f result;
 	tex.getPixel(u % tex.getWidth(), v % tex.getHeight(), result.x, result.y, result.z);
 	return result;
-}
\ No newline at end of file
+}
+
+// Reads a two channel normal and rebuilds z, all encoded as 0.5 * n + 0.5
+GEDUtils::Vec3f normal_at(const DirectX::ScratchImage& normal, int64_t x, int64_t y)
+{
+	const DirectX::Image* image = normal.GetImage(0, 0, 0);
+	const uint16_t* texel = reinterpret_cast<const uint16_t*>(image->pixels + y * image->rowPitch) + x * 2;
+
+	float n_x = texel[0] / 65535.0f * 2.0f - 1.0f;
+	float n_y = texel[1] / 65535.0f * 2.0f - 1.0f;
+	float n_z = sqrt(std::max(1.0f - n_x * n_x - n_y * n_y, 0.0f));
+
+	return GEDUtils::Vec3f(n_x * 0.5f + 0.5f, n_y * 0.5f + 0.5f, n_z * 0.5f + 0.5f);
+}
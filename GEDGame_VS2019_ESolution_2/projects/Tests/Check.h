@@ -0,0 +1,45 @@
+#pragma once
+
+#include <atomic>
+#include <cmath>
+#include <iostream>
+
+// Minimal checks for the CPU tests. A failed check is reported with its location and the test
+// keeps running, checkResult() then returns the exit code for ctest. Checks may run on any thread.
+
+inline std::atomic<int>& checkFailures()
+{
+	static std::atomic<int> failures(0);
+	return failures;
+}
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) \
+		{ \
+			std::cerr << __FILE__ << "(" << __LINE__ << "): CHECK(" #condition ") failed" << std::endl; \
+			checkFailures()++; \
+		} \
+	} while (0)
+
+#define CHECK_NEAR(value, expected, tolerance) \
+	do { \
+		double checkValue = (value), checkExpected = (expected); \
+		if (!(std::abs(checkValue - checkExpected) <= (tolerance))) \
+		{ \
+			std::cerr << __FILE__ << "(" << __LINE__ << "): CHECK_NEAR(" #value ", " #expected ") failed, " \
+				<< checkValue << " != " << checkExpected << std::endl; \
+			checkFailures()++; \
+		} \
+	} while (0)
+
+inline int checkResult(const char* test)
+{
+	if (checkFailures() == 0)
+	{
+		std::cout << test << ": all checks passed" << std::endl;
+		return 0;
+	}
+	std::cout << test << ": " << checkFailures() << " checks failed" << std::endl;
+	return 1;
+}
@@ -0,0 +1,172 @@
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Check.h"
+#include "CommandScheduler.h"
+#include "Profiler.h"
+
+// The threading of CommandRecorder with a fake context which records what is recorded where and
+// what is submitted in which order: task order, frames with fewer tasks than threads and failures.
+
+Profiler g_profiler;
+
+namespace
+{
+	class RecordingContext : public CommandScheduler::Context
+	{
+	public:
+		struct Submit
+		{
+			size_t index;
+			bool execute;
+		};
+
+		explicit RecordingContext(size_t taskCount)
+			: recordCounts(taskCount), failing(taskCount, false), recording(false)
+		{
+			for (auto& count : recordCounts)
+				count = 0;
+		}
+
+		bool record(size_t index) override
+		{
+			CHECK(recording);
+			recordCounts[index]++;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				recordThreads.push_back(std::this_thread::get_id());
+			}
+
+			// Give the other workers a chance to overlap
+			if (index % 2 == 0)
+				std::this_thread::sleep_for(std::chrono::microseconds(50));
+			return !failing[index];
+		}
+
+		void submit(size_t index, bool execute) override
+		{
+			// All tasks are recorded before the first one is submitted
+			for (size_t i = 0; i < frameTaskCount; i++)
+				CHECK(recordCounts[i] == 1);
+			submits.push_back({ index, execute });
+		}
+
+		// Runs one frame and checks what the scheduler did
+		bool run(CommandScheduler& scheduler, size_t taskCount)
+		{
+			for (auto& count : recordCounts)
+				count = 0;
+			recordThreads.clear();
+			submits.clear();
+			frameTaskCount = taskCount;
+
+			recording = true;
+			bool succeeded = scheduler.run(taskCount);
+			recording = false;
+
+			// Every task of the frame recorded once, the other contexts stay unused
+			for (size_t i = 0; i < recordCounts.size(); i++)
+				CHECK(recordCounts[i] == (i < taskCount ? 1 : 0));
+
+			// Submitted in order, all executed or none
+			CHECK(submits.size() == taskCount);
+			for (size_t i = 0; i < submits.size(); i++)
+			{
+				CHECK(submits[i].index == i);
+				CHECK(submits[i].execute == succeeded);
+			}
+			return succeeded;
+		}
+
+		std::vector<std::atomic<int>> recordCounts;
+		std::vector<char> failing;
+		std::vector<std::thread::id> recordThreads;
+		std::vector<Submit> submits;
+		size_t frameTaskCount = 0;
+		std::atomic<bool> recording;
+		std::mutex mutex;
+	};
+}
+
+void testOrder()
+{
+	RecordingContext context(4);
+	CommandScheduler scheduler;
+	scheduler.start(&context, 4);
+	CHECK(scheduler.getMaxTaskCount() == 4);
+
+	CHECK(context.run(scheduler, 4));
+
+	// Four different threads, the last task on the calling one
+	CHECK(context.recordThreads.size() == 4);
+	for (size_t i = 0; i < context.recordThreads.size(); i++)
+		for (size_t j = i + 1; j < context.recordThreads.size(); j++)
+			CHECK(context.recordThreads[i] != context.recordThreads[j]);
+
+	context.run(scheduler, 4);
+	int callingThread = 0;
+	for (auto id : context.recordThreads)
+		callingThread += id == std::this_thread::get_id();
+	CHECK(callingThread == 1);
+}
+
+void testSkippedTasks()
+{
+	// Frames with fewer tasks than threads, the idle workers must not touch the frame. Many short
+	// frames in a row, so idle workers also wake up while the next frame is already running.
+	RecordingContext context(4);
+	CommandScheduler scheduler;
+	scheduler.start(&context, 4);
+	for (int frame = 0; frame < 2000; frame++)
+		CHECK(context.run(scheduler, 1 + frame % 4));
+
+	// A single task runs on the calling thread only
+	context.run(scheduler, 1);
+	CHECK(context.recordThreads.size() == 1 && context.recordThreads[0] == std::this_thread::get_id());
+}
+
+void testFailure()
+{
+	RecordingContext context(3);
+	CommandScheduler scheduler;
+	scheduler.start(&context, 3);
+
+	// A failing worker task or the failing calling thread task: nothing is executed
+	context.failing[0] = true;
+	CHECK(!context.run(scheduler, 3));
+	context.failing[0] = false;
+	context.failing[2] = true;
+	CHECK(!context.run(scheduler, 3));
+
+	// A failing task which is not part of the frame does not matter, and the next frame works again
+	CHECK(context.run(scheduler, 2));
+	context.failing[2] = false;
+	CHECK(context.run(scheduler, 3));
+}
+
+void testRestart()
+{
+	RecordingContext context(2);
+	CommandScheduler scheduler;
+	scheduler.stop();
+	CHECK(scheduler.getMaxTaskCount() == 0);
+
+	scheduler.start(&context, 2);
+	CHECK(context.run(scheduler, 2));
+	scheduler.start(&context, 1);
+	CHECK(context.run(scheduler, 1));
+	scheduler.stop();
+	CHECK(scheduler.getMaxTaskCount() == 0);
+}
+
+int main()
+{
+	testOrder();
+	testSkippedTasks();
+	testFailure();
+	testRestart();
+	return checkResult("CommandSchedulerTest");
+}
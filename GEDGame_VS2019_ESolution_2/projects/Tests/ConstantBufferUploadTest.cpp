@@ -0,0 +1,204 @@
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "Check.h"
+#include "RecordingTarget.h"
+
+// The constant buffer uploads of Apply() without a device: the dirty range of the backing store,
+// its rounding to registers, when a box is used, Map/DISCARD of dynamic buffers and that the
+// buffer always ends up with the contents of the backing store. EffectUploadTest checks the same
+// through a real effect and context on Windows.
+
+using namespace D3DX11Effects;
+
+namespace
+{
+	const uint32_t kRegisterSize = 16;
+
+	// A constant buffer as the effect keeps it
+	struct Buffer
+	{
+		explicit Buffer(uint32_t size)
+			: store(size, 0), target(size), isDynamic(false)
+		{
+			// Created with its initial contents, marked whole
+			dirty.Mark(0, size);
+		}
+
+		void set(uint32_t offset, const void* data, uint32_t size)
+		{
+			memcpy(store.data() + offset, data, size);
+			dirty.Mark(offset, size);
+		}
+
+		SConstantBufferUpload upload(bool allowBox)
+		{
+			target.clear();
+			return UploadConstantBuffer(target, store.data(), uint32_t(store.size()), dirty, isDynamic, allowBox);
+		}
+
+		// A single upload of [begin, end)
+		void expect(const SConstantBufferUpload& upload, bool map, bool boxed, uint32_t begin, uint32_t end)
+		{
+			CHECK(upload.Uploaded && upload.Boxed == boxed && upload.Bytes == end - begin);
+			CHECK(target.uploads.size() == 1);
+			if (target.uploads.size() == 1)
+			{
+				const RecordingUploadTarget::Upload& recorded = target.uploads[0];
+				CHECK(recorded.map == map && recorded.boxed == boxed);
+				CHECK(recorded.begin == begin && recorded.end == end);
+			}
+			CHECK(!dirty.IsDirty);
+			CHECK(target.contents == store);
+		}
+
+		std::vector<uint8_t> store;
+		SDirtyRange dirty;
+		RecordingUploadTarget target;
+		bool isDynamic;
+	};
+}
+
+void testDirtyRange()
+{
+	SDirtyRange dirty;
+	CHECK(!dirty.IsDirty);
+
+	dirty.Mark(40, 8);
+	CHECK(dirty.IsDirty && dirty.Start == 40 && dirty.End == 48);
+
+	// The union of the writes, including the bytes between them
+	dirty.Mark(100, 4);
+	dirty.Mark(20, 4);
+	CHECK(dirty.Start == 20 && dirty.End == 104);
+	dirty.Mark(60, 4);
+	CHECK(dirty.Start == 20 && dirty.End == 104);
+
+	// A new range after the upload cleared it
+	dirty.IsDirty = false;
+	dirty.Mark(64, 16);
+	CHECK(dirty.Start == 64 && dirty.End == 80);
+}
+
+void testUpdateSubresource()
+{
+	Buffer buffer(256);
+
+	// The whole buffer after creation, then nothing until it changes
+	buffer.expect(buffer.upload(true), false, false, 0, 256);
+	CHECK(!buffer.upload(true).Uploaded && buffer.target.uploads.empty());
+
+	// A scalar: its register
+	float scalar = 2.5f;
+	buffer.set(36, &scalar, 4);
+	buffer.expect(buffer.upload(true), false, true, 32, 48);
+
+	// Without boxes (cbuffers without driver support, deferred contexts) the whole buffer
+	buffer.set(36, &scalar, 4);
+	buffer.expect(buffer.upload(false), false, false, 0, 256);
+
+	// A matrix across registers, not aligned
+	float matrix[16];
+	for (int i = 0; i < 16; i++)
+		matrix[i] = float(i);
+	buffer.set(72, matrix, sizeof(matrix));
+	buffer.expect(buffer.upload(true), false, true, 64, 144);
+
+	// Two variables: the registers covering both
+	float color[4] = { 0.25f, 0.5f, 0.75f, 1.0f };
+	buffer.set(16, color, sizeof(color));
+	buffer.set(200, &scalar, 4);
+	buffer.expect(buffer.upload(true), false, true, 16, 208);
+
+	// Up to the end, and all of it without a box
+	buffer.set(240, color, sizeof(color));
+	buffer.expect(buffer.upload(true), false, true, 240, 256);
+	buffer.set(0, color, sizeof(color));
+	buffer.set(252, &scalar, 4);
+	buffer.expect(buffer.upload(true), false, false, 0, 256);
+
+	// The last register of a buffer that is not a multiple of registers is clipped to its size
+	Buffer tbuffer(72);
+	tbuffer.upload(true);
+	tbuffer.set(66, &scalar, 4);
+	tbuffer.expect(tbuffer.upload(true), false, true, 64, 72);
+}
+
+void testDynamic()
+{
+	Buffer buffer(128);
+	buffer.isDynamic = true;
+
+	// Always mapped and rewritten whole, boxes or not
+	buffer.expect(buffer.upload(true), true, false, 0, 128);
+	CHECK(buffer.target.maps == 1 && buffer.target.unmaps == 1);
+	CHECK(!buffer.upload(true).Uploaded && buffer.target.maps == 0);
+
+	float scalar = 3.0f;
+	buffer.set(36, &scalar, 4);
+	buffer.expect(buffer.upload(true), true, false, 0, 128);
+	CHECK(buffer.target.maps == 1 && buffer.target.unmaps == 1);
+
+	// A failed map sends nothing and keeps the range for the next Apply
+	scalar = 4.0f;
+	buffer.set(100, &scalar, 4);
+	buffer.target.failMap = true;
+	SConstantBufferUpload failed = buffer.upload(true);
+	CHECK(!failed.Uploaded && failed.Bytes == 0);
+	CHECK(buffer.target.uploads.empty() && buffer.target.unmaps == 0);
+	CHECK(buffer.dirty.IsDirty && buffer.dirty.Start == 100 && buffer.dirty.End == 104);
+
+	buffer.target.failMap = false;
+	buffer.expect(buffer.upload(true), true, false, 0, 128);
+}
+
+// Random writes between uploads: the buffer always matches the backing store, and the boxes are
+// the registers of the writes
+void testRandomWrites()
+{
+	std::mt19937 random(5);
+	for (bool allowBox : { true, false })
+	{
+		Buffer buffer(1024);
+		buffer.upload(allowBox);
+
+		for (int round = 0; round < 2000; round++)
+		{
+			uint32_t begin = 1024, end = 0;
+			const int writes = int(random() % 4);
+			for (int i = 0; i < writes; i++)
+			{
+				uint8_t bytes[64];
+				const uint32_t size = 1 + random() % sizeof(bytes);
+				const uint32_t offset = random() % (1024 - size + 1);
+				for (uint32_t j = 0; j < size; j++)
+					bytes[j] = uint8_t(random());
+				buffer.set(offset, bytes, size);
+				begin = std::min(begin, offset);
+				end = std::max(end, offset + size);
+			}
+
+			SConstantBufferUpload upload = buffer.upload(allowBox);
+			if (writes == 0)
+			{
+				CHECK(!upload.Uploaded && buffer.target.uploads.empty());
+				continue;
+			}
+
+			begin &= ~(kRegisterSize - 1);
+			end = (end + kRegisterSize - 1) & ~(kRegisterSize - 1);
+			const bool boxed = allowBox && (begin > 0 || end < 1024);
+			buffer.expect(upload, false, boxed, boxed ? begin : 0, boxed ? end : 1024);
+		}
+	}
+}
+
+int main()
+{
+	testDirtyRange();
+	testUpdateSubresource();
+	testDynamic();
+	testRandomWrites();
+	return checkResult("ConstantBufferUploadTest");
+}
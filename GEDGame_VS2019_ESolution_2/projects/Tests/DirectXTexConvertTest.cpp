@@ -0,0 +1,142 @@
+// DirectX::_GetDirectConversions and the scanline functions of the float path
+#include "DirectXTexP.h"
+
+#include <cstring>
+#include <vector>
+
+#include "Check.h"
+
+// Every direct format-pair conversion of Convert against the float path it replaces
+// (_LoadScanline, _ConvertScanline and _StoreScanline): every 8-bit value in every channel, every
+// 16-bit code and every half, for each sRGB combination _GetDirectConversion sends to the kernel.
+
+using namespace DirectX;
+
+namespace
+{
+	// Pixels with every value of the format in every channel. 8-bit formats get all (x, y) pairs in
+	// R and G, 16-bit formats every code and 32-bit floats every half value, its neighbours and a
+	// value between it and the next half.
+	std::vector<uint8_t> createSource(DXGI_FORMAT format, size_t& count)
+	{
+		const size_t bpp = BitsPerPixel(format) / 8;
+		const bool fp32 = (format == DXGI_FORMAT_R32_FLOAT || format == DXGI_FORMAT_R32G32B32A32_FLOAT);
+		count = fp32 ? 0x40000 : 0x10000;
+
+		std::vector<uint8_t> pixels(count * bpp);
+		for (size_t i = 0; i < count; ++i)
+		{
+			uint8_t* pixel = pixels.data() + i * bpp;
+			if (bpp == 4 && !fp32)
+			{
+				const uint8_t x = uint8_t(i), y = uint8_t(i >> 8);
+				const uint8_t rgba[4] = { x, y, uint8_t(x ^ y), uint8_t(x + y) };
+				memcpy(pixel, rgba, 4);
+			}
+			else if (!fp32)
+			{
+				for (size_t j = 0; j < bpp / 2; ++j)
+				{
+					const uint16_t code = uint16_t(i + j * 0x4000);
+					memcpy(pixel + j * 2, &code, 2);
+				}
+			}
+			else
+			{
+				for (size_t j = 0; j < bpp / 4; ++j)
+				{
+					const size_t k = (i + j * 0x10000) % count;
+					const int32_t offsets[4] = { 0, 1, -1, 0x1000 };
+
+					float f = PackedVector::XMConvertHalfToFloat(PackedVector::HALF(k & 0xFFFF));
+					uint32_t bits;
+					memcpy(&bits, &f, sizeof(bits));
+					bits += uint32_t(offsets[k >> 16]);
+					memcpy(pixel + j * 4, &bits, 4);
+				}
+			}
+		}
+		return pixels;
+	}
+
+	// Convert without a direct conversion and without dithering
+	std::vector<uint8_t> convertFloat(const std::vector<uint8_t>& source, size_t count, DXGI_FORMAT sformat, DXGI_FORMAT tformat, DWORD filter)
+	{
+		std::vector<XMVECTOR> scanline(count);
+		std::vector<uint8_t> dest(count * BitsPerPixel(tformat) / 8);
+		CHECK(_LoadScanline(scanline.data(), count, source.data(), source.size(), sformat));
+		_ConvertScanline(scanline.data(), count, tformat, sformat, filter);
+		CHECK(_StoreScanline(dest.data(), dest.size(), tformat, scanline.data(), count));
+		return dest;
+	}
+
+	size_t countMismatches(const uint8_t* a, const uint8_t* b, size_t count, size_t bpp)
+	{
+		size_t mismatches = 0;
+		for (size_t i = 0; i < count; ++i)
+			mismatches += memcmp(a + i * bpp, b + i * bpp, bpp) != 0;
+		return mismatches;
+	}
+}
+
+void testDirectConversion(const DirectConvert& conversion)
+{
+	size_t count;
+	const std::vector<uint8_t> source = createSource(conversion.source, count);
+	const size_t bpp = BitsPerPixel(conversion.dest) / 8;
+
+	// The kernel on the whole scanline, and on a few pixels at an odd offset for the tail of the
+	// vectorized loops
+	std::vector<uint8_t> direct(count * bpp);
+	conversion.func(direct.data(), source.data(), count);
+
+	const size_t tailOffset = 5, tailCount = 7;
+	std::vector<uint8_t> tail(tailCount * bpp);
+	conversion.func(tail.data(), source.data() + tailOffset * BitsPerPixel(conversion.source) / 8, tailCount);
+
+	// The table lists the layouts, the same kernel also runs for their sRGB variants when the
+	// curve is on both sides or on neither
+	const DXGI_FORMAT sformats[2] = { conversion.source, MakeSRGB(conversion.source) };
+	const DXGI_FORMAT tformats[2] = { conversion.dest, MakeSRGB(conversion.dest) };
+	const DWORD filters[4] = { TEX_FILTER_DEFAULT, TEX_FILTER_SRGB_IN, TEX_FILTER_SRGB_OUT, TEX_FILTER_SRGB };
+
+	size_t checked = 0;
+	for (size_t s = 0; s < 2; ++s)
+		for (size_t t = 0; t < 2; ++t)
+			for (DWORD filter : filters)
+			{
+				if ((s == 1 && sformats[1] == sformats[0]) || (t == 1 && tformats[1] == tformats[0]))
+					continue;
+
+				const bool srgbIn = (filter & TEX_FILTER_SRGB_IN) || IsSRGB(sformats[s]);
+				const bool srgbOut = (filter & TEX_FILTER_SRGB_OUT) || IsSRGB(tformats[t]);
+				DirectConvertFunc func = _GetDirectConversion(filter, sformats[s], tformats[t]);
+				CHECK(func == (srgbIn == srgbOut ? conversion.func : nullptr));
+				CHECK(!_GetDirectConversion(filter | TEX_FILTER_FORCE_FLOAT, sformats[s], tformats[t]));
+				if (!func)
+					continue;
+
+				const std::vector<uint8_t> expected = convertFloat(source, count, sformats[s], tformats[t], filter);
+				const size_t mismatches = countMismatches(direct.data(), expected.data(), count, bpp)
+					+ countMismatches(tail.data(), expected.data() + tailOffset * bpp, tailCount, bpp);
+				if (mismatches > 0)
+				{
+					std::cerr << "DXGI_FORMAT " << sformats[s] << " to " << tformats[t] << " with filter " << std::hex << filter
+						<< std::dec << ": " << mismatches << " pixels differ from the float path" << std::endl;
+				}
+				CHECK(mismatches == 0);
+				++checked;
+			}
+
+	CHECK(checked > 0);
+}
+
+int main()
+{
+	size_t count = 0;
+	const DirectConvert* conversions = _GetDirectConversions(count);
+	CHECK(count > 0);
+	for (size_t i = 0; i < count; ++i)
+		testDirectConversion(conversions[i]);
+	return checkResult("DirectXTexConvertTest");
+}
@@ -0,0 +1,212 @@
+#include "DirectXTex.h"
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "Check.h"
+
+// The threaded resampler of Resize (the ParallelOptions overload): a constant image stays constant
+// with every filter, the 4:1 box filter gives the 4x4 average TerrainGenerator used to compute
+// itself, and the result does not depend on the number of threads.
+
+using namespace DirectX;
+
+namespace
+{
+	const DWORD kFilters[] = { TEX_FILTER_DEFAULT, TEX_FILTER_POINT, TEX_FILTER_LINEAR, TEX_FILTER_CUBIC, TEX_FILTER_BOX, TEX_FILTER_TRIANGLE };
+
+	// One format for each row path of the resampler, and one for the generic scanline path
+	const DXGI_FORMAT kFormats[] = { DXGI_FORMAT_R32_FLOAT, DXGI_FORMAT_R8G8B8A8_UNORM, DXGI_FORMAT_R32G32B32A32_FLOAT, DXGI_FORMAT_R16G16B16A16_UNORM };
+
+	const struct
+	{
+		size_t width;
+		size_t height;
+	} kSizes[] = { { 16, 11 }, { 33, 22 }, { 134, 90 }, { 31, 97 } };
+
+	bool isFloat(DXGI_FORMAT format)
+	{
+		return format == DXGI_FORMAT_R32_FLOAT || format == DXGI_FORMAT_R32G32B32A32_FLOAT;
+	}
+
+	HRESULT resize(const ScratchImage& source, size_t width, size_t height, DWORD filter, size_t threadCount, ScratchImage& result)
+	{
+		ParallelOptions options;
+		options.threadCount = threadCount;
+		return Resize(source.GetImages(), source.GetImageCount(), source.GetMetadata(), width, height, filter, options, result);
+	}
+
+	// Every pixel of the 67x45 image is the given pixel
+	void createConstant(DXGI_FORMAT format, const void* pixel, ScratchImage& image)
+	{
+		CHECK(SUCCEEDED(image.Initialize2D(format, 67, 45, 1, 1)));
+		const size_t bpp = BitsPerPixel(format) / 8;
+		for (size_t i = 0; i < image.GetPixelsSize(); i += bpp)
+			memcpy(image.GetPixels() + i, pixel, bpp);
+	}
+
+	// Random pixels in the two items of a 300x200 array
+	void createNoise(DXGI_FORMAT format, ScratchImage& image)
+	{
+		CHECK(SUCCEEDED(image.Initialize2D(format, 300, 200, 2, 1)));
+		std::mt19937 random(7);
+		if (isFloat(format))
+		{
+			std::uniform_real_distribution<float> value(-1.0f, 1.0f);
+			float* pixels = reinterpret_cast<float*>(image.GetPixels());
+			for (size_t i = 0; i < image.GetPixelsSize() / sizeof(float); ++i)
+				pixels[i] = value(random);
+		}
+		else
+		{
+			for (size_t i = 0; i < image.GetPixelsSize(); ++i)
+				image.GetPixels()[i] = uint8_t(random());
+		}
+	}
+}
+
+void testConstant()
+{
+	const float constantFloat[4] = { 0.3f, -2.5f, 1000.0f, 1.0f };
+	const uint8_t constantRGBA8[4] = { 200, 100, 50, 255 };
+	const uint16_t constantRGBA16[4] = { 0x1234, 0x8000, 0xFFFF, 0 };
+
+	for (DXGI_FORMAT format : kFormats)
+	{
+		const void* pixel = isFloat(format) ? static_cast<const void*>(constantFloat)
+			: (format == DXGI_FORMAT_R8G8B8A8_UNORM) ? static_cast<const void*>(constantRGBA8) : static_cast<const void*>(constantRGBA16);
+		const size_t bpp = BitsPerPixel(format) / 8;
+
+		ScratchImage image;
+		createConstant(format, pixel, image);
+
+		for (DWORD filter : kFilters)
+			for (const auto& size : kSizes)
+			{
+				ScratchImage result;
+				CHECK(SUCCEEDED(resize(image, size.width, size.height, filter, 0, result)));
+				if (!result.GetPixels())
+					continue;
+
+				// The weights of a pixel sum to 1, which is exact after rounding to the integer formats
+				size_t mismatches = 0;
+				for (size_t i = 0; i < result.GetPixelsSize(); i += bpp)
+				{
+					if (isFloat(format))
+					{
+						const float* values = reinterpret_cast<const float*>(result.GetPixels() + i);
+						for (size_t j = 0; j < bpp / sizeof(float); ++j)
+							mismatches += std::abs(values[j] - constantFloat[j]) > std::abs(constantFloat[j]) * 1e-6f;
+					}
+					else
+					{
+						mismatches += memcmp(result.GetPixels() + i, pixel, bpp) != 0;
+					}
+				}
+
+				if (mismatches > 0)
+				{
+					std::cerr << "DXGI_FORMAT " << format << ", filter " << std::hex << filter << std::dec << ", " << size.width << "x"
+						<< size.height << ": " << mismatches << " values are not the constant" << std::endl;
+				}
+				CHECK(mismatches == 0);
+			}
+	}
+}
+
+void testBox4To1()
+{
+	const size_t resolution = 256;
+
+	// Multiples of 1/256 up to 256, their sums of 16 and the quarter weights are exact in float, so
+	// the order of the additions does not matter
+	std::vector<float> height(resolution * resolution);
+	std::mt19937 random(11);
+	for (float& h : height)
+		h = float(random() % 65536) / 256.0f;
+
+	// The loop TerrainGenerator's resize_heightfield had before it used Resize
+	std::vector<float> expected(resolution * resolution / 16);
+	for (size_t y = 0; y < resolution / 4; y++)
+		for (size_t x = 0; x < resolution / 4; x++)
+		{
+			float sum = 0;
+			for (size_t yLoc = y * 4; yLoc < y * 4 + 4; yLoc++)
+				for (size_t xLoc = x * 4; xLoc < x * 4 + 4; xLoc++)
+					sum += height[yLoc * resolution + xLoc];
+			expected[y * (resolution / 4) + x] = sum / 16;
+		}
+
+	// The image TerrainGenerator resizes now
+	Image image = {};
+	image.width = resolution;
+	image.height = resolution;
+	image.format = DXGI_FORMAT_R32_FLOAT;
+	image.rowPitch = image.width * sizeof(float);
+	image.slicePitch = image.rowPitch * image.height;
+	image.pixels = reinterpret_cast<uint8_t*>(height.data());
+
+	TexMetadata metadata = {};
+	metadata.width = image.width;
+	metadata.height = image.height;
+	metadata.depth = metadata.arraySize = metadata.mipLevels = 1;
+	metadata.format = image.format;
+	metadata.dimension = TEX_DIMENSION_TEXTURE2D;
+
+	ScratchImage resized;
+	CHECK(SUCCEEDED(Resize(&image, 1, metadata, resolution / 4, resolution / 4, TEX_FILTER_BOX, ParallelOptions(), resized)));
+	const Image* quarter = resized.GetImage(0, 0, 0);
+	CHECK(quarter && quarter->width == resolution / 4 && quarter->height == resolution / 4);
+	if (!quarter)
+		return;
+
+	CHECK(quarter->rowPitch == quarter->width * sizeof(float));
+	CHECK(memcmp(quarter->pixels, expected.data(), expected.size() * sizeof(float)) == 0);
+}
+
+void testThreadCount()
+{
+	for (DXGI_FORMAT format : kFormats)
+	{
+		ScratchImage image;
+		createNoise(format, image);
+
+		const struct
+		{
+			size_t width;
+			size_t height;
+		} sizes[] = { { 75, 50 }, { 133, 77 }, { 517, 301 } };
+
+		for (DWORD filter : kFilters)
+			for (const auto& size : sizes)
+			{
+				ScratchImage single;
+				CHECK(SUCCEEDED(resize(image, size.width, size.height, filter, 1, single)));
+
+				for (size_t threadCount : { size_t(0), size_t(3) })
+				{
+					ScratchImage threaded;
+					CHECK(SUCCEEDED(resize(image, size.width, size.height, filter, threadCount, threaded)));
+					CHECK(threaded.GetPixelsSize() == single.GetPixelsSize());
+					if (threaded.GetPixelsSize() != single.GetPixelsSize())
+						continue;
+
+					if (memcmp(threaded.GetPixels(), single.GetPixels(), single.GetPixelsSize()) != 0)
+					{
+						std::cerr << "DXGI_FORMAT " << format << ", filter " << std::hex << filter << std::dec << ", " << size.width << "x"
+							<< size.height << ": " << threadCount << " threads differ from 1 thread" << std::endl;
+						CHECK(false);
+					}
+				}
+			}
+	}
+}
+
+int main()
+{
+	testConstant();
+	testBox4To1();
+	testThreadCount();
+	return checkResult("DirectXTexResizeTest");
+}
@@ -0,0 +1,135 @@
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "Check.h"
+#include "EffectLoadPlan.h"
+
+// The header checks CEffectLoader::LoadEffect makes before it reads a compiled effect, on the
+// checked-in .fxo of the TerrainViewer tool and on broken copies of it: the sections must lie
+// within the blob, whatever the header claims. Also times reading and planning the blob, the part
+// of a load that does not need Direct3D.
+
+using namespace D3DX11Effects;
+
+namespace
+{
+	std::vector<char> readFile(const std::string& path)
+	{
+		std::ifstream file(path, std::ios::binary);
+		CHECK(file.good());
+		return std::vector<char>((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	}
+
+	const char* plan(const std::vector<char>& blob, SEffectLoadPlan& result)
+	{
+		return PlanEffectLoad(blob.data(), uint32_t(blob.size()), &result);
+	}
+
+	// A copy of the blob with a header field changed
+	std::vector<char> withField(const std::vector<char>& blob, size_t offset, uint32_t value)
+	{
+		std::vector<char> copy = blob;
+		memcpy(copy.data() + offset, &value, sizeof(value));
+		return copy;
+	}
+}
+
+void testCompiledEffect(const std::vector<char>& blob)
+{
+	SEffectLoadPlan result;
+	CHECK(plan(blob, result) == nullptr);
+	CHECK(result.Version == D3DX11_FXL_VERSION(5, 0));
+
+	// The sections cover the blob
+	CHECK(result.oUnstructured == sizeof(SBinaryHeader5));
+	CHECK(result.oStructured == result.oUnstructured + result.cbUnstructured);
+	CHECK(result.oStructured + result.cbStructured == blob.size());
+	CHECK(result.cbBulkHeap == blob.size() && result.cbPooledHeap == 2 * result.cbUnstructured);
+
+	// The TerrainViewer effect has a technique and shaders
+	CHECK(result.Header.cTechniques > 0 && result.Header.cTotalShaders > 0);
+
+	// The structured data starts with the constant buffers, named by a string in the unstructured
+	// block, which the loader only finds at the right offset
+	CHECK(result.Header.Effect.cCBs > 0 && result.cbStructured >= sizeof(SBinaryConstantBuffer));
+	if (result.Header.Effect.cCBs > 0 && result.cbStructured >= sizeof(SBinaryConstantBuffer))
+	{
+		SBinaryConstantBuffer cb;
+		memcpy(&cb, blob.data() + result.oStructured, sizeof(cb));
+		CHECK(cb.oName < result.cbUnstructured);
+		if (cb.oName < result.cbUnstructured)
+		{
+			const char* name = blob.data() + result.oUnstructured + cb.oName;
+			const size_t length = strnlen(name, result.cbUnstructured - cb.oName);
+			CHECK(length > 0 && length < result.cbUnstructured - cb.oName);
+		}
+		CHECK(cb.Size > 0 && cb.Size % 16 == 0);
+	}
+}
+
+void testBrokenHeaders(const std::vector<char>& blob)
+{
+	SEffectLoadPlan result;
+	if (plan(blob, result) != nullptr)
+		return;
+	const uint32_t oStructured = result.oStructured;
+
+	// Truncated before the structured data
+	CHECK(PlanEffectLoad(nullptr, 0, &result) != nullptr);
+	size_t accepted = 0;
+	for (uint32_t size = 0; size < oStructured; size++)
+		accepted += PlanEffectLoad(blob.data(), size, &result) == nullptr;
+	CHECK(accepted == 0);
+	CHECK(PlanEffectLoad(blob.data(), oStructured, &result) == nullptr && result.cbStructured == 0);
+
+	// An unknown version, while the fx_4 tags are accepted
+	CHECK(plan(withField(blob, offsetof(SBinaryHeader, Tag), 0xFEFF2002), result) != nullptr);
+	CHECK(plan(withField(blob, offsetof(SBinaryHeader, Tag), g_EffectVersions[0].m_Tag), result) == nullptr);
+	CHECK(result.Version == D3DX11_FXL_VERSION(4, 0));
+
+	// Effect pools
+	CHECK(plan(withField(blob, offsetof(SBinaryHeader, Pool.cCBs), 1), result) != nullptr);
+	CHECK(plan(withField(blob, offsetof(SBinaryHeader, Pool.cNumericVariables), 1), result) != nullptr);
+	CHECK(plan(withField(blob, offsetof(SBinaryHeader, Pool.cObjectVariables), 1), result) != nullptr);
+
+	CHECK(plan(withField(blob, offsetof(SBinaryHeader, cInlineShaders), result.Header.cTotalShaders + 1), result) != nullptr);
+
+	// An unstructured block past the end, also when the offset of the structured data would wrap
+	// around to within the blob
+	const size_t cbUnstructured = offsetof(SBinaryHeader, cbUnstructured);
+	CHECK(plan(withField(blob, cbUnstructured, uint32_t(blob.size())), result) != nullptr);
+	CHECK(plan(withField(blob, cbUnstructured, uint32_t(0) - uint32_t(sizeof(SBinaryHeader5)) + 16), result) != nullptr);
+	CHECK(plan(withField(blob, cbUnstructured, UINT32_MAX), result) != nullptr);
+}
+
+void benchmarkLoad(const std::string& path)
+{
+	const int runs = 1000;
+	size_t bytes = 0;
+	const auto start = std::chrono::steady_clock::now();
+	for (int run = 0; run < runs; run++)
+	{
+		const std::vector<char> blob = readFile(path);
+		SEffectLoadPlan result;
+		CHECK(plan(blob, result) == nullptr);
+		bytes += result.cbBulkHeap + result.cbPooledHeap;
+	}
+	const double time = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / runs;
+	std::cout << path << ": read and planned in " << time << " us, " << bytes / runs / 1024 << " KB reserved in 2 load-time heaps"
+		<< std::endl;
+}
+
+int main()
+{
+	const std::string path = std::string(FXO_DIR) + "terrainViewer.fxo";
+	const std::vector<char> blob = readFile(path);
+	testCompiledEffect(blob);
+	testBrokenHeaders(blob);
+	benchmarkLoad(path);
+	return checkResult("EffectLoadPlanTest");
+}
@@ -0,0 +1,182 @@
+// CEffect, to parse effects without a device
+#include "pchfx.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "Check.h"
+
+// Loading a compiled effect without a device: the CPU time and heap allocations of parsing the
+// .fxo checked in with the TerrainViewer tool, which must be the same for every load and all freed
+// again, and the memory kept by the parsed effect before and after its reflection is stripped.
+// EffectLoadPlanTest checks the header on its own on every platform.
+
+using namespace D3DX11Effects;
+
+namespace
+{
+	// The minimum size of an Effects11 data block (CDataBlock). With the heaps reserved up front, a
+	// chain of spill-over blocks shows up as more blocks of this size.
+	const size_t kDataBlockSize = 8192;
+
+	const int kParseRuns = 50;
+
+	std::atomic<size_t> g_allocationCount(0);
+	std::atomic<size_t> g_allocatedBytes(0);
+	std::atomic<size_t> g_liveBytes(0);
+	std::atomic<size_t> g_dataBlockCount(0);
+
+	// Every allocation keeps its size in front of it
+	const size_t kHeaderSize = 16;
+
+	void* allocate(size_t size)
+	{
+		void* memory = std::malloc(size + kHeaderSize);
+		if (!memory)
+			return nullptr;
+		*static_cast<size_t*>(memory) = size;
+		g_allocationCount++;
+		g_allocatedBytes += size;
+		g_liveBytes += size;
+		g_dataBlockCount += size == kDataBlockSize;
+		return static_cast<char*>(memory) + kHeaderSize;
+	}
+
+	void deallocate(void* pointer)
+	{
+		if (!pointer)
+			return;
+		void* memory = static_cast<char*>(pointer) - kHeaderSize;
+		g_liveBytes -= *static_cast<size_t*>(memory);
+		std::free(memory);
+	}
+
+	struct Allocations
+	{
+		size_t count;
+		size_t bytes;
+		size_t dataBlocks;
+
+		static Allocations now()
+		{
+			return { g_allocationCount, g_allocatedBytes, g_dataBlockCount };
+		}
+
+		Allocations operator-(const Allocations& other) const
+		{
+			return { count - other.count, bytes - other.bytes, dataBlocks - other.dataBlocks };
+		}
+	};
+}
+
+void* operator new(size_t size)
+{
+	if (void* pointer = allocate(size))
+		return pointer;
+	throw std::bad_alloc();
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	return allocate(size);
+}
+
+void operator delete(void* pointer) noexcept
+{
+	deallocate(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept
+{
+	deallocate(pointer);
+}
+
+namespace
+{
+	std::vector<char> readFile(const std::string& path)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file)
+			std::cerr << "Cannot open " << path << std::endl;
+		return std::vector<char>((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	}
+
+	// Heap bytes held by a parsed effect, and after Optimize(), which D3DX11_EFFECT_STRIP_REFLECTION
+	// calls once the effect is bound to the device
+	void getEffectBytes(const std::vector<char>& compiled, size_t& bytes, size_t& strippedBytes)
+	{
+		size_t before = g_liveBytes;
+		CEffect* effect = new CEffect();
+		CHECK(SUCCEEDED(effect->LoadEffect(compiled.data(), static_cast<uint32_t>(compiled.size()))));
+		bytes = g_liveBytes - before;
+		CHECK(SUCCEEDED(effect->Optimize()));
+		strippedBytes = g_liveBytes - before;
+		effect->Release();
+		CHECK(g_liveBytes == before);
+	}
+}
+
+void testLoad(const char* filename)
+{
+	const std::vector<char> compiled = readFile(std::string(FXO_DIR) + filename);
+	CHECK(!compiled.empty());
+	if (compiled.empty())
+		return;
+
+	// Parsing only, as D3DX11CreateEffectFromMemory does before binding to the device. The first
+	// parse is not measured, it also allocates what is initialized on first use.
+	auto parse = [&]()
+	{
+		CEffect* effect = new CEffect();
+		CHECK(SUCCEEDED(effect->LoadEffect(compiled.data(), static_cast<uint32_t>(compiled.size()))));
+		effect->Release();
+	};
+	parse();
+
+	std::vector<double> times;
+	times.reserve(kParseRuns);
+	Allocations first = {};
+	for (int run = 0; run < kParseRuns; run++)
+	{
+		size_t live = g_liveBytes;
+		Allocations before = Allocations::now();
+		auto start = std::chrono::high_resolution_clock::now();
+
+		parse();
+		times.push_back(std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count());
+		Allocations allocations = Allocations::now() - before;
+
+		// The same every time and nothing left behind
+		if (run == 0)
+			first = allocations;
+		CHECK(allocations.count == first.count && allocations.bytes == first.bytes);
+		CHECK(g_liveBytes == live);
+	}
+
+	// One block each at most for the bulk heap and the type and string pool, which only happens
+	// when their reservation is below the minimum block size
+	CHECK(first.dataBlocks <= 2);
+
+	size_t bytes = 0, strippedBytes = 0;
+	getEffectBytes(compiled, bytes, strippedBytes);
+	CHECK(strippedBytes < bytes);
+
+	std::sort(times.begin(), times.end());
+	std::cout << filename << ": " << compiled.size() / 1024 << " KB compiled, parsed in " << times[times.size() / 2]
+		<< " ms (min " << times.front() << " ms) with " << first.count << " allocations of " << first.bytes / 1024
+		<< " KB (" << first.dataBlocks << " blocks of 8 KB), " << bytes / 1024 << " KB kept, "
+		<< strippedBytes / 1024 << " KB after Optimize()" << std::endl;
+}
+
+int main()
+{
+	testLoad("terrainViewer.fxo");
+	return checkResult("EffectLoadTest");
+}
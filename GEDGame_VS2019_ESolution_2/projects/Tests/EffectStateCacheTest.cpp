@@ -0,0 +1,345 @@
+#include <cstring>
+#include <map>
+#include <vector>
+
+#include "Check.h"
+#include "EffectTest.h"
+#include "RecordingContext.h"
+
+// D3DX11_EFFECT_FILTER_REDUNDANT_STATE: the same sequence of passes is applied with the filter on
+// and off, and after every step the state bound on the context must be the same. The sequence
+// covers what invalidates the cache: UAV binds, other code changing the state followed by
+// InvalidateStateCache() and switching to another context.
+
+namespace
+{
+	const UINT kResourceSlots = 8;
+	const UINT kConstantBufferSlots = 4;
+	const UINT kSamplerSlots = 2;
+
+	struct Resources
+	{
+		ID3D11ShaderResourceView* textures[2] = {};
+		ID3D11ShaderResourceView* bufferView = nullptr;
+		ID3D11UnorderedAccessView* bufferAccess = nullptr;
+
+		~Resources()
+		{
+			release(textures[0]);
+			release(textures[1]);
+			release(bufferView);
+			release(bufferAccess);
+		}
+	};
+
+	// The bound state, objects numbered in the order they were first seen so that two runs with
+	// different effects compare equal
+	struct State
+	{
+		std::vector<int> objects;
+		float blendFactor[4];
+		UINT sampleMask;
+		UINT stencilRef;
+
+		bool operator==(const State& other) const
+		{
+			return objects == other.objects && memcmp(blendFactor, other.blendFactor, sizeof(blendFactor)) == 0 &&
+				sampleMask == other.sampleMask && stencilRef == other.stencilRef;
+		}
+	};
+
+	class StateReader
+	{
+	public:
+		State read(ID3D11DeviceContext* context)
+		{
+			State state;
+
+			ID3D11VertexShader* vertexShader;
+			ID3D11GeometryShader* geometryShader;
+			ID3D11PixelShader* pixelShader;
+			UINT classInstances = 0;
+			context->VSGetShader(&vertexShader, nullptr, &classInstances);
+			context->GSGetShader(&geometryShader, nullptr, &classInstances);
+			context->PSGetShader(&pixelShader, nullptr, &classInstances);
+			add(state, vertexShader);
+			add(state, geometryShader);
+			add(state, pixelShader);
+
+			ID3D11ShaderResourceView* resources[kResourceSlots];
+			context->VSGetShaderResources(0, kResourceSlots, resources);
+			add(state, resources, kResourceSlots);
+			context->PSGetShaderResources(0, kResourceSlots, resources);
+			add(state, resources, kResourceSlots);
+
+			ID3D11Buffer* buffers[kConstantBufferSlots];
+			context->VSGetConstantBuffers(0, kConstantBufferSlots, buffers);
+			add(state, buffers, kConstantBufferSlots);
+			context->PSGetConstantBuffers(0, kConstantBufferSlots, buffers);
+			add(state, buffers, kConstantBufferSlots);
+
+			ID3D11SamplerState* samplers[kSamplerSlots];
+			context->PSGetSamplers(0, kSamplerSlots, samplers);
+			add(state, samplers, kSamplerSlots);
+
+			ID3D11BlendState* blendState;
+			ID3D11DepthStencilState* depthStencilState;
+			ID3D11RasterizerState* rasterizerState;
+			context->OMGetBlendState(&blendState, state.blendFactor, &state.sampleMask);
+			context->OMGetDepthStencilState(&depthStencilState, &state.stencilRef);
+			context->RSGetState(&rasterizerState);
+			add(state, blendState);
+			add(state, depthStencilState);
+			add(state, rasterizerState);
+
+			ID3D11UnorderedAccessView* access;
+			context->OMGetRenderTargetsAndUnorderedAccessViews(0, nullptr, nullptr, 1, 1, &access);
+			add(state, access);
+			return state;
+		}
+
+	private:
+		// Releases the reference the getter returned
+		void add(State& state, IUnknown* object)
+		{
+			if (!object)
+			{
+				state.objects.push_back(0);
+				return;
+			}
+			auto name = names.emplace(object, static_cast<int>(names.size()) + 1).first;
+			state.objects.push_back(name->second);
+			object->Release();
+		}
+
+		template <class T>
+		void add(State& state, T** objects, UINT count)
+		{
+			for (UINT i = 0; i < count; i++)
+				add(state, objects[i]);
+		}
+
+		std::map<IUnknown*, int> names;
+	};
+
+	bool isBound(ID3D11DeviceContext* context, ID3D11ShaderResourceView* view)
+	{
+		ID3D11ShaderResourceView* resources[kResourceSlots];
+		context->PSGetShaderResources(0, kResourceSlots, resources);
+		bool bound = false;
+		for (auto& resource : resources)
+		{
+			bound |= resource == view;
+			release(resource);
+		}
+		return bound;
+	}
+
+	HRESULT createResources(ID3D11Device* device, Resources& resources)
+	{
+		HRESULT hr;
+		for (auto& texture : resources.textures)
+		{
+			D3D11_TEXTURE2D_DESC desc = {};
+			desc.Width = 4;
+			desc.Height = 4;
+			desc.MipLevels = 1;
+			desc.ArraySize = 1;
+			desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+			desc.SampleDesc.Count = 1;
+			desc.Usage = D3D11_USAGE_DEFAULT;
+			desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+			ID3D11Texture2D* resource;
+			if (FAILED(hr = device->CreateTexture2D(&desc, nullptr, &resource)))
+				return hr;
+			hr = device->CreateShaderResourceView(resource, nullptr, &texture);
+			resource->Release();
+			if (FAILED(hr))
+				return hr;
+		}
+
+		// Read by BufferRead and written by BufferWrite
+		D3D11_BUFFER_DESC desc = {};
+		desc.ByteWidth = 16 * 16;
+		desc.Usage = D3D11_USAGE_DEFAULT;
+		desc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS;
+		ID3D11Buffer* buffer;
+		if (FAILED(hr = device->CreateBuffer(&desc, nullptr, &buffer)))
+			return hr;
+
+		D3D11_SHADER_RESOURCE_VIEW_DESC viewDesc = {};
+		viewDesc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+		viewDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+		viewDesc.Buffer.NumElements = 16;
+		D3D11_UNORDERED_ACCESS_VIEW_DESC accessDesc = {};
+		accessDesc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+		accessDesc.ViewDimension = D3D11_UAV_DIMENSION_BUFFER;
+		accessDesc.Buffer.NumElements = 16;
+		hr = device->CreateShaderResourceView(buffer, &viewDesc, &resources.bufferView);
+		if (SUCCEEDED(hr))
+			hr = device->CreateUnorderedAccessView(buffer, &accessDesc, &resources.bufferAccess);
+		buffer->Release();
+		return hr;
+	}
+
+	struct Run
+	{
+		std::vector<State> states;
+		D3DX11_EFFECT_STATS stats;
+		int recordedStateCalls;
+	};
+
+	Run replay(ID3D11Device* device, ID3D11DeviceContext* context, const Resources& resources, UINT fxFlags)
+	{
+		Run run = {};
+		context->ClearState();
+
+		ID3DX11Effect* effect = nullptr;
+		CHECK(SUCCEEDED(createTestEffect(device, fxFlags, &effect)));
+		if (!effect)
+			return run;
+
+		ID3D11DeviceContext* deferredContext = nullptr;
+		CHECK(SUCCEEDED(device->CreateDeferredContext(0, &deferredContext)));
+
+		RecordingContext recorder(context);
+		RecordingContext deferredRecorder(deferredContext);
+		StateReader reader;
+		ID3DX11EffectTechnique* technique = effect->GetTechniqueByName("Render");
+		auto apply = [&](const char* pass, ID3D11DeviceContext* target)
+		{
+			CHECK(SUCCEEDED(technique->GetPassByName(pass)->Apply(0, target)));
+		};
+		auto capture = [&]()
+		{
+			run.states.push_back(reader.read(context));
+		};
+
+		ID3DX11EffectShaderResourceVariable* texture0 = effect->GetVariableByName("g_Texture0")->AsShaderResource();
+		texture0->SetResource(resources.textures[0]);
+		effect->GetVariableByName("g_Texture1")->AsShaderResource()->SetResource(resources.textures[1]);
+		effect->GetVariableByName("g_Buffer")->AsShaderResource()->SetResource(resources.bufferView);
+		effect->GetVariableByName("g_Output")->AsUnorderedAccessView()->SetUnorderedAccessView(resources.bufferAccess);
+		effect->ResetStats();
+
+		// The same pass twice, then another one and the same one with a different texture
+		apply("Colored", &recorder);
+		capture();
+		apply("Colored", &recorder);
+		capture();
+		apply("Textured", &recorder);
+		capture();
+		texture0->SetResource(resources.textures[1]);
+		apply("Textured", &recorder);
+		capture();
+
+		// Binding the UAV unbinds the aliasing shader resource view. Once the UAV is unbound again
+		// (without the effect knowing) the view must be bound again.
+		apply("BufferRead", &recorder);
+		capture();
+		CHECK(isBound(context, resources.bufferView));
+		apply("BufferWrite", &recorder);
+		capture();
+		CHECK(!isBound(context, resources.bufferView));
+		ID3D11UnorderedAccessView* noAccess = nullptr;
+		context->OMSetRenderTargetsAndUnorderedAccessViews(D3D11_KEEP_RENDER_TARGETS_AND_DEPTH_STENCIL, nullptr, nullptr, 1, 1, &noAccess, nullptr);
+		apply("BufferRead", &recorder);
+		capture();
+		CHECK(isBound(context, resources.bufferView));
+
+		// Other code changing the state, as Game.cpp does around its own draws
+		context->PSSetShader(nullptr, nullptr, 0);
+		ID3D11ShaderResourceView* noResources[kResourceSlots] = {};
+		context->PSSetShaderResources(0, kResourceSlots, noResources);
+		effect->InvalidateStateCache();
+		apply("BufferRead", &recorder);
+		capture();
+
+		// Another context in between: what the cache knows about the first one is gone
+		apply("BufferRead", &deferredRecorder);
+		context->ClearState();
+		apply("BufferRead", &recorder);
+		capture();
+		CHECK(isBound(context, resources.bufferView));
+
+		CHECK(SUCCEEDED(effect->GetStats(&run.stats)));
+		run.recordedStateCalls = recorder.getStateCallCount() + deferredRecorder.getStateCallCount();
+
+		ID3D11CommandList* commandList = nullptr;
+		deferredContext->FinishCommandList(FALSE, &commandList);
+		release(commandList);
+		release(deferredContext);
+		release(effect);
+		context->ClearState();
+		return run;
+	}
+}
+
+void testReplay(ID3D11Device* device, ID3D11DeviceContext* context)
+{
+	Resources resources;
+	CHECK(SUCCEEDED(createResources(device, resources)));
+
+	Run filtered = replay(device, context, resources, D3DX11_EFFECT_FILTER_REDUNDANT_STATE);
+	Run unfiltered = replay(device, context, resources, 0);
+
+	CHECK(filtered.states.size() == unfiltered.states.size());
+	for (size_t i = 0; i < filtered.states.size() && i < unfiltered.states.size(); i++)
+	{
+		if (!(filtered.states[i] == unfiltered.states[i]))
+			std::cerr << "Bound state differs after step " << i << std::endl;
+		CHECK(filtered.states[i] == unfiltered.states[i]);
+	}
+
+	// Every call the unfiltered run made was either made or skipped by the filtered run, and the
+	// stats count what actually reached the context
+	CHECK(filtered.stats.StateCallsFiltered > 0);
+	CHECK(unfiltered.stats.StateCallsFiltered == 0);
+	CHECK(filtered.stats.StateCallsIssued + filtered.stats.StateCallsFiltered == unfiltered.stats.StateCallsIssued);
+	CHECK(filtered.recordedStateCalls == static_cast<int>(filtered.stats.StateCallsIssued));
+	CHECK(unfiltered.recordedStateCalls == static_cast<int>(unfiltered.stats.StateCallsIssued));
+}
+
+void testRepeatedApply(ID3D11Device* device, ID3D11DeviceContext* context)
+{
+	ID3DX11Effect* effect = nullptr;
+	CHECK(SUCCEEDED(createTestEffect(device, D3DX11_EFFECT_FILTER_REDUNDANT_STATE, &effect)));
+	if (!effect)
+		return;
+
+	// Applying an unchanged pass again sets nothing the filter covers
+	RecordingContext recorder(context);
+	ID3DX11EffectPass* pass = effect->GetTechniqueByName("Render")->GetPassByName("Colored");
+	CHECK(SUCCEEDED(pass->Apply(0, &recorder)));
+	CHECK(recorder.getStateCallCount() > 0);
+	recorder.clear();
+	CHECK(SUCCEEDED(pass->Apply(0, &recorder)));
+	CHECK(recorder.getStateCallCount() == 0);
+
+	// Until the cache is invalidated
+	effect->InvalidateStateCache();
+	CHECK(SUCCEEDED(pass->Apply(0, &recorder)));
+	CHECK(recorder.getCount("VSSetShader") == 1);
+	CHECK(recorder.getCount("PSSetShader") == 1);
+	CHECK(recorder.getCount("OMSetBlendState") == 1);
+	CHECK(recorder.getCount("OMSetDepthStencilState") == 1);
+	CHECK(recorder.getCount("RSSetState") == 1);
+
+	release(effect);
+	context->ClearState();
+}
+
+int main()
+{
+	ID3D11Device* device = nullptr;
+	ID3D11DeviceContext* context = nullptr;
+	CHECK(SUCCEEDED(createDevice(&device, &context)));
+	if (device)
+	{
+		testReplay(device, context);
+		testRepeatedApply(device, context);
+	}
+	release(context);
+	release(device);
+	return checkResult("EffectStateCacheTest");
+}
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <d3d11.h>
+#include <d3dcompiler.h>
+
+#include <iostream>
+
+#include "d3dx11effect.h"
+
+// The WARP device and the effect shared by the Effects11 tests. Windows only, they need the
+// Direct3D runtime but no GPU.
+
+// One cbuffer and one tbuffer with the variable kinds the uploads track, and passes which differ
+// in shaders, shader resources, render states and a pixel shader UAV
+static const char kTestEffect[] = R"(
+cbuffer cbObject
+{
+	matrix g_World;
+	float4 g_Color;
+	float g_Scalar;
+	float4 g_Array[8];
+};
+
+tbuffer tbInstances
+{
+	float4 g_Instances[16];
+	float4 g_Tint;
+};
+
+Texture2D g_Texture0;
+Texture2D g_Texture1;
+Buffer<float4> g_Buffer;
+RWBuffer<float4> g_Output : register(u1);
+
+SamplerState g_Point
+{
+	Filter = MIN_MAG_MIP_POINT;
+};
+
+BlendState NoBlending
+{
+	BlendEnable[0] = FALSE;
+};
+
+BlendState Additive
+{
+	BlendEnable[0] = TRUE;
+	SrcBlend = ONE;
+	DestBlend = ONE;
+};
+
+DepthStencilState DepthTest
+{
+	DepthEnable = TRUE;
+};
+
+DepthStencilState NoDepth
+{
+	DepthEnable = FALSE;
+};
+
+RasterizerState CullBack
+{
+	CullMode = BACK;
+};
+
+RasterizerState CullNone
+{
+	CullMode = NONE;
+};
+
+float4 VS(uint id : SV_VertexID) : SV_Position
+{
+	return mul(float4(g_Instances[id % 16].xyz, 1), g_World) * g_Scalar + g_Tint;
+}
+
+float4 PSColor(float4 position : SV_Position) : SV_Target0
+{
+	return g_Color + g_Array[uint(position.x) % 8];
+}
+
+float4 PSTexture(float4 position : SV_Position) : SV_Target0
+{
+	float2 uv = position.xy / 64;
+	return g_Texture0.Sample(g_Point, uv) * g_Texture1.Sample(g_Point, uv);
+}
+
+float4 PSBuffer(float4 position : SV_Position) : SV_Target0
+{
+	return g_Buffer[uint(position.x) % 16];
+}
+
+float4 PSWrite(float4 position : SV_Position) : SV_Target0
+{
+	g_Output[uint(position.x) % 16] = g_Color;
+	return g_Color;
+}
+
+VertexShader g_VS = CompileShader(vs_5_0, VS());
+
+technique11 Render
+{
+	pass Colored
+	{
+		SetVertexShader(g_VS);
+		SetGeometryShader(NULL);
+		SetPixelShader(CompileShader(ps_5_0, PSColor()));
+		SetBlendState(NoBlending, float4(0, 0, 0, 0), 0xFFFFFFFF);
+		SetDepthStencilState(DepthTest, 0);
+		SetRasterizerState(CullBack);
+	}
+
+	pass Textured
+	{
+		SetVertexShader(g_VS);
+		SetGeometryShader(NULL);
+		SetPixelShader(CompileShader(ps_5_0, PSTexture()));
+		SetBlendState(Additive, float4(0, 0, 0, 0), 0xFFFFFFFF);
+		SetDepthStencilState(NoDepth, 0);
+		SetRasterizerState(CullBack);
+	}
+
+	pass BufferRead
+	{
+		SetVertexShader(g_VS);
+		SetGeometryShader(NULL);
+		SetPixelShader(CompileShader(ps_5_0, PSBuffer()));
+		SetBlendState(Additive, float4(0.5, 0.5, 0.5, 0.5), 0xFFFFFFFF);
+		SetDepthStencilState(NoDepth, 1);
+		SetRasterizerState(CullNone);
+	}
+
+	pass BufferWrite
+	{
+		SetVertexShader(g_VS);
+		SetGeometryShader(NULL);
+		SetPixelShader(CompileShader(ps_5_0, PSWrite()));
+		SetBlendState(NoBlending, float4(0, 0, 0, 0), 0xFFFFFFFF);
+		SetDepthStencilState(NoDepth, 1);
+		SetRasterizerState(CullNone);
+	}
+}
+)";
+
+template <class T>
+void release(T*& object)
+{
+	if (object)
+	{
+		object->Release();
+		object = nullptr;
+	}
+}
+
+inline HRESULT createDevice(ID3D11Device** ppDevice, ID3D11DeviceContext** ppContext)
+{
+	D3D_FEATURE_LEVEL level = D3D_FEATURE_LEVEL_11_0;
+	return D3D11CreateDevice(nullptr, D3D_DRIVER_TYPE_WARP, nullptr, 0, &level, 1, D3D11_SDK_VERSION, ppDevice, nullptr, ppContext);
+}
+
+// kTestEffect with the given D3DX11_EFFECT_* flags, compile errors go to the test output
+inline HRESULT createTestEffect(ID3D11Device* device, UINT fxFlags, ID3DX11Effect** ppEffect)
+{
+	ID3DBlob* errors = nullptr;
+	HRESULT hr = D3DX11CompileEffectFromMemory(kTestEffect, sizeof(kTestEffect) - 1, "TestEffect.fx", nullptr, nullptr,
+		0, fxFlags, device, ppEffect, &errors);
+	if (errors)
+	{
+		std::cerr << static_cast<const char*>(errors->GetBufferPointer()) << std::endl;
+		errors->Release();
+	}
+	return hr;
+}
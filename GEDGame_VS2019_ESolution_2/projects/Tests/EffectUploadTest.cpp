@@ -0,0 +1,312 @@
+#include <algorithm>
+#include <cstring>
+
+#include "Check.h"
+#include "EffectTest.h"
+#include "RecordingContext.h"
+
+// The constant buffer and tbuffer uploads of Apply(): which byte range is uploaded after scalar,
+// matrix, array and raw writes, when the boxed UpdateSubresource is used and that the uploaded
+// bytes are the values set. With D3DX11_EFFECT_DYNAMIC_CONSTANT_BUFFERS every upload is a
+// Map/DISCARD of the whole buffer.
+
+namespace
+{
+	const UINT kRegisterSize = 16;
+
+	struct Buffers
+	{
+		ID3D11Resource* object = nullptr;     // cbObject
+		ID3D11Resource* instances = nullptr;  // tbInstances
+		UINT objectSize = 0;
+		UINT instancesSize = 0;
+
+		~Buffers()
+		{
+			release(object);
+			release(instances);
+		}
+	};
+
+	UINT getSize(ID3D11Resource* resource)
+	{
+		D3D11_BUFFER_DESC desc;
+		static_cast<ID3D11Buffer*>(resource)->GetDesc(&desc);
+		return desc.ByteWidth;
+	}
+
+	HRESULT getBuffers(ID3DX11Effect* effect, Buffers& buffers)
+	{
+		ID3D11Buffer* buffer = nullptr;
+		HRESULT hr = effect->GetConstantBufferByName("cbObject")->GetConstantBuffer(&buffer);
+		if (FAILED(hr))
+			return hr;
+		buffers.object = buffer;
+		buffers.objectSize = getSize(buffer);
+
+		ID3D11ShaderResourceView* view = nullptr;
+		hr = effect->GetConstantBufferByName("tbInstances")->GetTextureBuffer(&view);
+		if (FAILED(hr))
+			return hr;
+		view->GetResource(&buffers.instances);
+		view->Release();
+		buffers.instancesSize = getSize(buffers.instances);
+		return hr;
+	}
+
+	UINT getOffset(ID3DX11Effect* effect, const char* name)
+	{
+		D3DX11_EFFECT_VARIABLE_DESC desc = {};
+		effect->GetVariableByName(name)->GetDesc(&desc);
+		return desc.BufferOffset;
+	}
+
+	// The upload of a buffer by the last Apply, there must be exactly one
+	const RecordingContext::Upload* findUpload(const RecordingContext& recorder, ID3D11Resource* resource)
+	{
+		const RecordingContext::Upload* found = nullptr;
+		int count = 0;
+		for (auto& upload : recorder.uploads)
+		{
+			if (upload.resource == resource)
+			{
+				found = &upload;
+				count++;
+			}
+		}
+		CHECK(count == 1);
+		return found;
+	}
+
+	// The values written at offset are part of the upload
+	void checkData(const RecordingContext::Upload* upload, UINT offset, const void* data, UINT size)
+	{
+		if (!upload)
+			return;
+		CHECK(offset >= upload->begin && offset + size <= upload->end);
+		if (offset >= upload->begin && offset + size <= upload->end)
+			CHECK(memcmp(upload->data.data() + (offset - upload->begin), data, size) == 0);
+	}
+
+	// The stats count what the context received
+	void checkStats(const RecordingContext& recorder, const D3DX11_EFFECT_STATS& stats)
+	{
+		uint32_t partialUpdates = 0;
+		uint64_t bytes = 0;
+		for (auto& upload : recorder.uploads)
+		{
+			partialUpdates += upload.boxed;
+			bytes += upload.end - upload.begin;
+		}
+		CHECK(stats.ConstantBufferUpdates == recorder.uploads.size());
+		CHECK(stats.ConstantBufferPartialUpdates == partialUpdates);
+		CHECK(stats.ConstantBufferBytes == bytes);
+	}
+
+	class Uploads
+	{
+	public:
+		Uploads(ID3DX11Effect* effect, ID3D11DeviceContext* context, bool partialCBUpdates)
+			: recorder(context), effect(effect), partialCBUpdates(partialCBUpdates)
+		{
+			pass = effect->GetTechniqueByName("Render")->GetPassByName("Colored");
+		}
+
+		// Applies the pass and returns how many buffers it uploaded
+		size_t apply()
+		{
+			recorder.clear();
+			effect->ResetStats();
+			CHECK(SUCCEEDED(pass->Apply(0, &recorder)));
+
+			D3DX11_EFFECT_STATS stats = {};
+			CHECK(SUCCEEDED(effect->GetStats(&stats)));
+			checkStats(recorder, stats);
+			return recorder.uploads.size();
+		}
+
+		// The upload of [begin, end) of a buffer by UpdateSubresource, rounded to registers. Boxed
+		// unless that is the whole buffer, for cbuffers only if the driver supports it.
+		const RecordingContext::Upload* expect(ID3D11Resource* resource, UINT size, bool tbuffer, UINT begin, UINT end)
+		{
+			begin &= ~(kRegisterSize - 1);
+			end = std::min((end + kRegisterSize - 1) & ~(kRegisterSize - 1), size);
+			bool boxed = (begin > 0 || end < size) && (tbuffer || partialCBUpdates);
+
+			const RecordingContext::Upload* upload = findUpload(recorder, resource);
+			if (upload)
+			{
+				CHECK(!upload->map);
+				CHECK(upload->boxed == boxed);
+				CHECK(upload->begin == (boxed ? begin : 0));
+				CHECK(upload->end == (boxed ? end : size));
+			}
+			return upload;
+		}
+
+		RecordingContext recorder;
+
+	private:
+		ID3DX11Effect* effect;
+		ID3DX11EffectPass* pass;
+		bool partialCBUpdates;
+	};
+}
+
+void testUpdateSubresource(ID3D11Device* device, ID3D11DeviceContext* context)
+{
+	ID3DX11Effect* effect = nullptr;
+	CHECK(SUCCEEDED(createTestEffect(device, 0, &effect)));
+	if (!effect)
+		return;
+	Buffers buffers;
+	CHECK(SUCCEEDED(getBuffers(effect, buffers)));
+
+	D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+	device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options));
+	Uploads uploads(effect, context, options.ConstantBufferPartialUpdate != FALSE);
+
+	UINT worldOffset = getOffset(effect, "g_World");
+	UINT colorOffset = getOffset(effect, "g_Color");
+	UINT scalarOffset = getOffset(effect, "g_Scalar");
+	UINT arrayOffset = getOffset(effect, "g_Array");
+	UINT tintOffset = getOffset(effect, "g_Tint");
+	CHECK(arrayOffset % kRegisterSize == 0 && arrayOffset + 8 * kRegisterSize == buffers.objectSize);
+
+	// Both buffers are uploaded whole by the first Apply, then not again until they change
+	CHECK(uploads.apply() == 2);
+	uploads.expect(buffers.object, buffers.objectSize, false, 0, buffers.objectSize);
+	uploads.expect(buffers.instances, buffers.instancesSize, true, 0, buffers.instancesSize);
+	CHECK(uploads.apply() == 0);
+
+	// A scalar: its register
+	float scalar = 2.5f;
+	effect->GetVariableByName("g_Scalar")->AsScalar()->SetFloat(scalar);
+	CHECK(uploads.apply() == 1);
+	checkData(uploads.expect(buffers.object, buffers.objectSize, false, scalarOffset, scalarOffset + 4), scalarOffset, &scalar, 4);
+
+	// A matrix, stored transposed since HLSL matrices are column major
+	float world[16], transposed[16];
+	for (int i = 0; i < 16; i++)
+		world[i] = static_cast<float>(i + 1);
+	for (int row = 0; row < 4; row++)
+		for (int column = 0; column < 4; column++)
+			transposed[column * 4 + row] = world[row * 4 + column];
+	effect->GetVariableByName("g_World")->AsMatrix()->SetMatrix(world);
+	CHECK(uploads.apply() == 1);
+	checkData(uploads.expect(buffers.object, buffers.objectSize, false, worldOffset, worldOffset + 64), worldOffset, transposed, 64);
+
+	// Part of an array: the whole array is marked, up to the end of the buffer
+	float elements[3 * 4];
+	for (int i = 0; i < 3 * 4; i++)
+		elements[i] = -static_cast<float>(i);
+	effect->GetVariableByName("g_Array")->AsVector()->SetFloatVectorArray(elements, 2, 3);
+	CHECK(uploads.apply() == 1);
+	checkData(uploads.expect(buffers.object, buffers.objectSize, false, arrayOffset, buffers.objectSize),
+		arrayOffset + 2 * kRegisterSize, elements, sizeof(elements));
+
+	// Two variables: the range covering both
+	float color[4] = { 0.25f, 0.5f, 0.75f, 1.0f };
+	scalar = 4.0f;
+	effect->GetVariableByName("g_Color")->AsVector()->SetFloatVector(color);
+	effect->GetVariableByName("g_Scalar")->AsScalar()->SetFloat(scalar);
+	CHECK(uploads.apply() == 1);
+	auto upload = uploads.expect(buffers.object, buffers.objectSize, false, colorOffset, scalarOffset + 4);
+	checkData(upload, colorOffset, color, sizeof(color));
+	checkData(upload, scalarOffset, &scalar, 4);
+
+	// A raw write to the buffer marks only the bytes written, within the matrix
+	float raw[2] = { 7.0f, 8.0f };
+	effect->GetConstantBufferByName("cbObject")->SetRawValue(raw, 20, sizeof(raw));
+	CHECK(uploads.apply() == 1);
+	checkData(uploads.expect(buffers.object, buffers.objectSize, false, 20, 20 + sizeof(raw)), 20, raw, sizeof(raw));
+
+	// The tbuffer always gets a box, unless all of it changed
+	float tint[4] = { 1.0f, 0.0f, 0.5f, 1.0f };
+	effect->GetVariableByName("g_Tint")->AsVector()->SetFloatVector(tint);
+	CHECK(uploads.apply() == 1);
+	checkData(uploads.expect(buffers.instances, buffers.instancesSize, true, tintOffset, tintOffset + 16), tintOffset, tint, sizeof(tint));
+
+	float instances[16 * 4] = {};
+	effect->GetVariableByName("g_Instances")->AsVector()->SetFloatVectorArray(instances, 0, 16);
+	effect->GetVariableByName("g_Tint")->AsVector()->SetFloatVector(tint);
+	CHECK(uploads.apply() == 1);
+	uploads.expect(buffers.instances, buffers.instancesSize, true, 0, buffers.instancesSize);
+
+	// Deferred contexts always upload whole buffers
+	ID3D11DeviceContext* deferredContext = nullptr;
+	CHECK(SUCCEEDED(device->CreateDeferredContext(0, &deferredContext)));
+	if (deferredContext)
+	{
+		Uploads deferredUploads(effect, deferredContext, options.ConstantBufferPartialUpdate != FALSE);
+		scalar = 8.0f;
+		effect->GetVariableByName("g_Scalar")->AsScalar()->SetFloat(scalar);
+		CHECK(deferredUploads.apply() == 1);
+		auto deferredUpload = findUpload(deferredUploads.recorder, buffers.object);
+		if (deferredUpload)
+		{
+			CHECK(!deferredUpload->boxed);
+			CHECK(deferredUpload->begin == 0 && deferredUpload->end == buffers.objectSize);
+			checkData(deferredUpload, scalarOffset, &scalar, 4);
+		}
+
+		ID3D11CommandList* commandList = nullptr;
+		deferredContext->FinishCommandList(FALSE, &commandList);
+		release(commandList);
+		release(deferredContext);
+	}
+
+	release(effect);
+	context->ClearState();
+}
+
+void testDynamic(ID3D11Device* device, ID3D11DeviceContext* context)
+{
+	ID3DX11Effect* effect = nullptr;
+	CHECK(SUCCEEDED(createTestEffect(device, D3DX11_EFFECT_DYNAMIC_CONSTANT_BUFFERS, &effect)));
+	if (!effect)
+		return;
+	Buffers buffers;
+	CHECK(SUCCEEDED(getBuffers(effect, buffers)));
+
+	D3D11_BUFFER_DESC desc;
+	static_cast<ID3D11Buffer*>(buffers.object)->GetDesc(&desc);
+	CHECK(desc.Usage == D3D11_USAGE_DYNAMIC && (desc.CPUAccessFlags & D3D11_CPU_ACCESS_WRITE));
+
+	Uploads uploads(effect, context, false);
+	CHECK(uploads.apply() == 2);
+	CHECK(uploads.recorder.getCount("UpdateSubresource") == 0);
+	CHECK(uploads.apply() == 0);
+
+	// A single scalar still discards and rewrites the whole buffer
+	float scalar = 3.0f;
+	UINT scalarOffset = getOffset(effect, "g_Scalar");
+	effect->GetVariableByName("g_Scalar")->AsScalar()->SetFloat(scalar);
+	CHECK(uploads.apply() == 1);
+	auto upload = findUpload(uploads.recorder, buffers.object);
+	if (upload)
+	{
+		CHECK(upload->map && !upload->boxed);
+		CHECK(upload->begin == 0 && upload->end == buffers.objectSize);
+		checkData(upload, scalarOffset, &scalar, 4);
+	}
+	CHECK(uploads.recorder.getCount("Map") == 1 && uploads.recorder.getCount("Unmap") == 1);
+
+	release(effect);
+	context->ClearState();
+}
+
+int main()
+{
+	ID3D11Device* device = nullptr;
+	ID3D11DeviceContext* context = nullptr;
+	CHECK(SUCCEEDED(createDevice(&device, &context)));
+	if (device)
+	{
+		testUpdateSubresource(device, context);
+		testDynamic(device, context);
+	}
+	release(context);
+	release(device);
+	return checkResult("EffectUploadTest");
+}
@@ -0,0 +1,408 @@
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Check.h"
+#include "Profiler.h"
+
+// The CPU profiler without a device: nested scopes, several threads, the per thread ring buffer
+// overflow, the history limit, and that the Chrome trace is valid JSON with the expected events.
+
+namespace
+{
+	// Just enough JSON for the trace: parse() fails on anything that is not strict JSON
+	struct Json
+	{
+		enum Type { NUL, BOOLEAN, NUMBER, STRING, ARRAY, OBJECT } type = NUL;
+		double number = 0;
+		std::string string;
+		std::vector<Json> array;
+		std::map<std::string, Json> object;
+
+		const Json& operator[](const std::string& key) const
+		{
+			static const Json missing;
+			auto member = object.find(key);
+			return member == object.end() ? missing : member->second;
+		}
+	};
+
+	class JsonParser
+	{
+	public:
+		explicit JsonParser(const std::string& text) : text(text), position(0) {}
+
+		bool parse(Json& value)
+		{
+			return parseValue(value) && (skipSpace(), position == text.size());
+		}
+
+	private:
+		void skipSpace()
+		{
+			while (position < text.size() && std::strchr(" \t\r\n", text[position]))
+				position++;
+		}
+
+		bool consume(char c)
+		{
+			skipSpace();
+			if (position < text.size() && text[position] == c)
+			{
+				position++;
+				return true;
+			}
+			return false;
+		}
+
+		bool consumeWord(const char* word)
+		{
+			size_t length = std::strlen(word);
+			if (text.compare(position, length, word) != 0)
+				return false;
+			position += length;
+			return true;
+		}
+
+		bool parseString(std::string& string)
+		{
+			if (!consume('"'))
+				return false;
+			for (; position < text.size(); position++)
+			{
+				char c = text[position];
+				if (c == '"')
+				{
+					position++;
+					return true;
+				}
+				if (static_cast<unsigned char>(c) < 0x20)
+					return false;
+				if (c == '\\')
+				{
+					if (++position == text.size())
+						return false;
+					switch (text[position])
+					{
+					case '"': case '\\': case '/': string += text[position]; break;
+					case 'b': string += '\b'; break;
+					case 'f': string += '\f'; break;
+					case 'n': string += '\n'; break;
+					case 'r': string += '\r'; break;
+					case 't': string += '\t'; break;
+					case 'u':
+						if (position + 4 >= text.size())
+							return false;
+						for (int i = 1; i <= 4; i++)
+							if (!std::isxdigit(static_cast<unsigned char>(text[position + i])))
+								return false;
+						string += '?';
+						position += 4;
+						break;
+					default:
+						return false;
+					}
+				}
+				else
+					string += c;
+			}
+			return false;
+		}
+
+		bool parseNumber(double& number)
+		{
+			// -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+			size_t begin = position;
+			auto digits = [&] {
+				size_t first = position;
+				while (position < text.size() && std::isdigit(static_cast<unsigned char>(text[position])))
+					position++;
+				return position > first;
+			};
+			if (position < text.size() && text[position] == '-')
+				position++;
+			if (position < text.size() && text[position] == '0')
+				position++;
+			else if (!digits())
+				return false;
+			if (position < text.size() && text[position] == '.' && (++position, !digits()))
+				return false;
+			if (position < text.size() && (text[position] == 'e' || text[position] == 'E'))
+			{
+				position++;
+				if (position < text.size() && (text[position] == '+' || text[position] == '-'))
+					position++;
+				if (!digits())
+					return false;
+			}
+			number = std::strtod(text.substr(begin, position - begin).c_str(), nullptr);
+			return true;
+		}
+
+		bool parseValue(Json& value)
+		{
+			skipSpace();
+			if (position == text.size())
+				return false;
+
+			char c = text[position];
+			if (c == '{')
+			{
+				position++;
+				value.type = Json::OBJECT;
+				if (consume('}'))
+					return true;
+				do
+				{
+					std::string key;
+					skipSpace();
+					if (!parseString(key) || !consume(':') || !parseValue(value.object[key]))
+						return false;
+				} while (consume(','));
+				return consume('}');
+			}
+			if (c == '[')
+			{
+				position++;
+				value.type = Json::ARRAY;
+				if (consume(']'))
+					return true;
+				do
+				{
+					value.array.emplace_back();
+					if (!parseValue(value.array.back()))
+						return false;
+				} while (consume(','));
+				return consume(']');
+			}
+			if (c == '"')
+			{
+				value.type = Json::STRING;
+				return parseString(value.string);
+			}
+			if (consumeWord("true") || consumeWord("false"))
+			{
+				value.type = Json::BOOLEAN;
+				return true;
+			}
+			if (consumeWord("null"))
+				return true;
+			value.type = Json::NUMBER;
+			return parseNumber(value.number);
+		}
+
+		const std::string& text;
+		size_t position;
+	};
+
+	// Writes the trace and parses it, the complete ("X") events go to events
+	bool parseTrace(const Profiler& profiler, Json& trace, std::vector<const Json*>& events)
+	{
+		std::ostringstream stream;
+		profiler.writeChromeTrace(stream);
+		std::string text = stream.str();
+		trace = Json();
+		if (!JsonParser(text).parse(trace) || trace["traceEvents"].type != Json::ARRAY)
+			return false;
+
+		events.clear();
+		for (const Json& event : trace["traceEvents"].array)
+			if (event["ph"].string == "X")
+				events.push_back(&event);
+		return true;
+	}
+
+	void nestedScopes(Profiler& profiler, int levels)
+	{
+		ProfileScope scope(levels % 2 ? "Odd" : "Even", profiler);
+		if (levels > 1)
+			nestedScopes(profiler, levels - 1);
+	}
+}
+
+void testJsonParser()
+{
+	// The parser has to reject what a trace viewer would reject, or the trace checks mean nothing
+	Json value;
+	std::string good = "{\"a\":[1,-2.5e3,0.125,\"x\\\"\\\\\\u00e9\",true,null,{}],\"b\":{\"c\":[]}}";
+	CHECK(JsonParser(good).parse(value));
+	CHECK(value["a"].array.size() == 7 && value["a"].array[1].number == -2500.0);
+	for (const char* bad : { "{\"a\":1,}", "[1 2]", "{\"a\" 1}", "\"tab\there\"", "01", "1.", "nan", "{\"a\":1}x", "[" })
+	{
+		std::string text = bad;
+		CHECK(!JsonParser(text).parse(value));
+	}
+}
+
+void testNestedScopes()
+{
+	Profiler profiler;
+	{
+		ProfileScope frame("Frame", profiler);
+		{
+			ProfileScope update("Update", profiler);
+			nestedScopes(profiler, 3);
+		}
+		ProfileScope render("Render", profiler);
+	}
+	profiler.collect();
+	CHECK(profiler.getDroppedCount() == 0);
+	CHECK(profiler.getLastMilliseconds("Frame") > 0);
+	CHECK(profiler.getLastMilliseconds("Frame", true) == 0);
+	CHECK(profiler.getLastMilliseconds("Missing") == 0);
+
+	Json trace;
+	std::vector<const Json*> events;
+	CHECK(parseTrace(profiler, trace, events));
+	CHECK(events.size() == 6);
+
+	// Scopes are added when they end, so the innermost comes first
+	std::map<std::string, const Json*> byName;
+	for (const Json* event : events)
+		byName[(*event)["name"].string + std::to_string(int((*event)["args"]["depth"].number))] = event;
+	CHECK(byName.size() == 6);
+	CHECK(byName.count("Frame0") && byName.count("Update1") && byName.count("Odd2") &&
+		byName.count("Even3") && byName.count("Odd4") && byName.count("Render1"));
+	CHECK((*events[0])["name"].string == "Odd" && (*events[0])["args"]["depth"].number == 4);
+
+	// Every scope lies within its parent
+	auto within = [](const Json* inner, const Json* outer) {
+		double innerBegin = (*inner)["ts"].number, outerBegin = (*outer)["ts"].number;
+		return innerBegin >= outerBegin &&
+			innerBegin + (*inner)["dur"].number <= outerBegin + (*outer)["dur"].number + 1e-3;
+	};
+	if (byName.size() == 6)
+	{
+		CHECK(within(byName["Update1"], byName["Frame0"]));
+		CHECK(within(byName["Render1"], byName["Frame0"]));
+		CHECK(within(byName["Odd2"], byName["Update1"]));
+		CHECK(within(byName["Even3"], byName["Odd2"]));
+		CHECK(within(byName["Odd4"], byName["Even3"]));
+		CHECK((*byName["Render1"])["ts"].number >= (*byName["Update1"])["ts"].number + (*byName["Update1"])["dur"].number);
+	}
+
+	// Names which need escaping and GPU events
+	profiler.addEvent({ "Quote \" back\\slash\ttab", 0, 1000, Profiler::kGpuThread, 0 });
+	profiler.collect();
+	CHECK(parseTrace(profiler, trace, events));
+	CHECK(events.size() == 7 && (*events.back())["name"].string == "Quote \" back\\slash tab");
+	CHECK_NEAR(profiler.getLastMilliseconds("Quote \" back\\slash\ttab", true), 0.001, 1e-9);
+}
+
+void testThreads()
+{
+	const int kThreads = 4;
+	const int kScopes = 500;
+	Profiler profiler;
+	{
+		ProfileScope main("Main", profiler);
+	}
+
+	std::vector<std::thread> threads;
+	for (int t = 0; t < kThreads; t++)
+		threads.emplace_back([&profiler, t] {
+			profiler.setThreadName("Worker " + std::to_string(t));
+			for (int i = 0; i < kScopes; i++)
+				nestedScopes(profiler, 2);
+		});
+	// Collecting while the workers record
+	for (int i = 0; i < 20; i++)
+	{
+		profiler.collect();
+		std::this_thread::yield();
+	}
+	for (auto& thread : threads)
+		thread.join();
+	profiler.collect();
+	CHECK(profiler.getDroppedCount() == 0);
+
+	Json trace;
+	std::vector<const Json*> events;
+	CHECK(parseTrace(profiler, trace, events));
+	CHECK(events.size() == 1 + kThreads * kScopes * 2);
+
+	// One track per thread with its name, plus the GPU track
+	std::map<int, std::string> names;
+	for (const Json& event : trace["traceEvents"].array)
+		if (event["ph"].string == "M" && event["name"].string == "thread_name")
+			names[int(event["tid"].number)] = event["args"]["name"].string;
+	CHECK(names.size() == kThreads + 2);
+
+	std::map<std::string, int> counts;
+	for (const Json* event : events)
+	{
+		const std::string& thread = names[int((*event)["tid"].number)];
+		counts[thread + " " + (*event)["name"].string + std::to_string(int((*event)["args"]["depth"].number))]++;
+	}
+	CHECK(counts["Thread 0 Main0"] == 1);
+	for (int t = 0; t < kThreads; t++)
+	{
+		std::string worker = "Worker " + std::to_string(t);
+		CHECK(counts[worker + " Even0"] == kScopes);
+		CHECK(counts[worker + " Odd1"] == kScopes);
+	}
+}
+
+void testOverflow()
+{
+	Profiler profiler;
+	const size_t kExtra = 10;
+	for (size_t i = 0; i < Profiler::kThreadEvents + kExtra; i++)
+		profiler.addEvent({ "Event", int64_t(i), 1, 0, 0 });
+	CHECK(profiler.getDroppedCount() == kExtra);
+
+	// The first events are kept, the ring has room again after a collect
+	profiler.collect();
+	Json trace;
+	std::vector<const Json*> events;
+	CHECK(parseTrace(profiler, trace, events));
+	CHECK(events.size() == Profiler::kThreadEvents);
+	CHECK_NEAR((*events.back())["ts"].number, (Profiler::kThreadEvents - 1) * 1e-3, 1e-9);
+
+	for (size_t i = 0; i < Profiler::kThreadEvents; i++)
+		profiler.addEvent({ "Event", 0, 1, 0, 0 });
+	CHECK(profiler.getDroppedCount() == kExtra);
+	profiler.addEvent({ "Event", 0, 1, 0, 0 });
+	CHECK(profiler.getDroppedCount() == kExtra + 1);
+}
+
+void testHistory()
+{
+	// More events than the history holds, collected in pieces that fit into the ring
+	Profiler profiler;
+	const size_t kTotal = Profiler::kHistoryEvents + 3000;
+	for (size_t i = 0; i < kTotal; i++)
+	{
+		profiler.addEvent({ "Event", int64_t(i) * 1000, 1000, 0, 0 });
+		if ((i + 1) % (Profiler::kThreadEvents / 2) == 0)
+			profiler.collect();
+	}
+	profiler.collect();
+	CHECK(profiler.getDroppedCount() == 0);
+
+	// Only the most recent events are left, in order
+	Json trace;
+	std::vector<const Json*> events;
+	CHECK(parseTrace(profiler, trace, events));
+	CHECK(events.size() == Profiler::kHistoryEvents);
+	bool ordered = true;
+	for (size_t i = 0; i < events.size(); i++)
+		ordered = ordered && (*events[i])["ts"].number == double(kTotal - Profiler::kHistoryEvents + i);
+	CHECK(ordered);
+}
+
+int main()
+{
+	testJsonParser();
+	testNestedScopes();
+	testThreads();
+	testOverflow();
+	testHistory();
+	return checkResult("ProfilerTest");
+}
@@ -0,0 +1,173 @@
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "Check.h"
+#include "Quantization.h"
+
+// Round trips of the t3d version 2 encoders: half floats, octahedral snorm16 directions and
+// unorm16 positions relative to the mesh bounds, and the error check MeshTools -quantize uses.
+
+using namespace MeshTools;
+
+namespace
+{
+	const float kRadToDeg = 57.2957795f;
+
+	float angleDegrees(const float a[3], const float b[3])
+	{
+		float la = std::sqrt(a[0] * a[0] + a[1] * a[1] + a[2] * a[2]);
+		float lb = std::sqrt(b[0] * b[0] + b[1] * b[1] + b[2] * b[2]);
+		float cosine = (a[0] * b[0] + a[1] * b[1] + a[2] * b[2]) / (la * lb);
+		return std::acos(std::fmin(std::fmax(cosine, -1.0f), 1.0f)) * kRadToDeg;
+	}
+
+	float octRoundTripAngle(float x, float y, float z)
+	{
+		float direction[3] = { x, y, z };
+		int16_t encoded[2];
+		float decoded[3];
+		octEncode(direction, encoded);
+		octDecode(encoded, decoded);
+		return angleDegrees(direction, decoded);
+	}
+
+	Vertex makeVertex(float x, float y, float z, float u, float v)
+	{
+		Vertex vertex = { { x, y, z }, { u, v }, { 0, 0, 1 }, { 1, 0, 0 } };
+		return vertex;
+	}
+
+	QuantizationError roundTrip(const std::vector<Vertex>& vertices, QuantizationParams& params, std::vector<Vertex>& decoded)
+	{
+		std::vector<QuantizedVertex> quantized;
+		params = quantizeVertices(vertices, quantized);
+		dequantizeVertices(quantized, params, decoded);
+		return measureQuantizationError(vertices, decoded);
+	}
+}
+
+void testHalf()
+{
+	// Exactly representable values
+	for (float value : { 0.0f, 1.0f, -2.0f, 0.5f, 0.25f, 1024.0f, 65504.0f, -65504.0f })
+		CHECK(halfToFloat(floatToHalf(value)) == value);
+	CHECK(floatToHalf(1.0f) == 0x3C00);
+	CHECK(floatToHalf(-0.0f) == 0x8000);
+
+	// Rounding to nearest keeps the relative error within half a mantissa step (2^-11)
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> range(-1000.0f, 1000.0f);
+	for (int i = 0; i < 10000; i++)
+	{
+		float value = range(random);
+		CHECK(std::abs(halfToFloat(floatToHalf(value)) - value) <= std::abs(value) * (1.0f / 2048.0f));
+	}
+
+	// Denormals down to 2^-24, below 2^-25 the value rounds to zero
+	CHECK(halfToFloat(floatToHalf(std::ldexp(1.0f, -24))) == std::ldexp(1.0f, -24));
+	CHECK(halfToFloat(floatToHalf(std::ldexp(3.0f, -20))) == std::ldexp(3.0f, -20));
+	CHECK(floatToHalf(std::ldexp(1.0f, -26)) == 0);
+
+	// Overflow, infinity and NaN
+	CHECK(std::isinf(halfToFloat(floatToHalf(65520.0f))));
+	CHECK(halfToFloat(floatToHalf(65519.0f)) == 65504.0f);
+	CHECK(std::isinf(halfToFloat(floatToHalf(-std::numeric_limits<float>::infinity()))));
+	CHECK(std::isnan(halfToFloat(floatToHalf(std::numeric_limits<float>::quiet_NaN()))));
+}
+
+void testOct()
+{
+	// Poles and the fold edges of the octahedron
+	const float edges[][3] = {
+		{ 0, 0, 1 }, { 0, 0, -1 }, { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 },
+		{ 1, 1, 0 }, { -1, 1, 0 }, { 1, -1, -1 }, { -1, -1, -1 }, { 1e-6f, 0, -1 }, { 0, -1e-6f, -1 },
+	};
+	for (const auto& e : edges)
+		CHECK(octRoundTripAngle(e[0], e[1], e[2]) < 0.1f);
+
+	// +-Z must come back exactly, they are the centre and the folded corners
+	float down[3] = { 0, 0, -1 }, decoded[3];
+	int16_t encoded[2];
+	octEncode(down, encoded);
+	octDecode(encoded, decoded);
+	CHECK(decoded[2] == -1.0f);
+
+	// Random directions, not normalized
+	std::mt19937 random(2);
+	std::normal_distribution<float> normal;
+	float maxAngle = 0;
+	for (int i = 0; i < 100000; i++)
+		maxAngle = std::fmax(maxAngle, octRoundTripAngle(normal(random), normal(random), normal(random) * 3.0f));
+	CHECK(maxAngle < 0.05f);
+
+	// A zero direction encodes to the centre instead of dividing by zero
+	float zero[3] = { 0, 0, 0 };
+	octEncode(zero, encoded);
+	CHECK(encoded[0] == 0 && encoded[1] == 0);
+}
+
+void testPositions()
+{
+	// Random mesh: the error stays within half a unorm16 step of the bounds
+	std::mt19937 random(3);
+	std::uniform_real_distribution<float> range(-50.0f, 150.0f);
+	std::uniform_real_distribution<float> uv(0.0f, 1.0f);
+	std::vector<Vertex> vertices;
+	for (int i = 0; i < 1000; i++)
+		vertices.push_back(makeVertex(range(random), range(random) * 0.1f, range(random), uv(random), uv(random)));
+
+	QuantizationParams params;
+	std::vector<Vertex> decoded;
+	QuantizationError error = roundTrip(vertices, params, decoded);
+	CHECK(isQuantizationErrorAcceptable(error, params));
+	CHECK(error.rmsPosition <= error.maxPosition);
+	CHECK(error.maxTexCoord <= 1.0f / 2048.0f);
+
+	// Flat bounds (all z equal) and a single vertex: the degenerate axes decode exactly
+	std::vector<Vertex> flat = { makeVertex(0, 0, 5, 0, 0), makeVertex(10, 2, 5, 1, 0), makeVertex(3, -4, 5, 0, 1) };
+	error = roundTrip(flat, params, decoded);
+	CHECK(params.positionScale[2] == 0.0f);
+	for (const auto& v : decoded)
+		CHECK(v.position[2] == 5.0f);
+	CHECK(isQuantizationErrorAcceptable(error, params));
+
+	std::vector<Vertex> single = { makeVertex(1, 2, 3, 0.5f, 0.5f) };
+	error = roundTrip(single, params, decoded);
+	CHECK(error.maxPosition == 0.0f);
+	CHECK(isQuantizationErrorAcceptable(error, params));
+}
+
+void testTexCoordError()
+{
+	QuantizationParams params;
+	std::vector<Vertex> decoded;
+
+	// Tiled texture coordinates up to 4 are fine
+	std::vector<Vertex> tiled = { makeVertex(0, 0, 0, 3.999f, -3.7f), makeVertex(1, 1, 1, 0.1f, 2.3f) };
+	CHECK(isQuantizationErrorAcceptable(roundTrip(tiled, params, decoded), params));
+
+	// Large tiled coordinates lose too much precision
+	std::vector<Vertex> large = { makeVertex(0, 0, 0, 100.3f, 0), makeVertex(1, 1, 1, 0, 0) };
+	QuantizationError error = roundTrip(large, params, decoded);
+	CHECK(error.maxTexCoord > 1.0f / 1024.0f);
+	CHECK(!isQuantizationErrorAcceptable(error, params));
+
+	// Overflow to infinity and NaN
+	std::vector<Vertex> overflow = { makeVertex(0, 0, 0, 70000.0f, 0), makeVertex(1, 1, 1, 0, 0) };
+	CHECK(!isQuantizationErrorAcceptable(roundTrip(overflow, params, decoded), params));
+
+	std::vector<Vertex> nan = { makeVertex(0, 0, 0, std::numeric_limits<float>::quiet_NaN(), 0), makeVertex(1, 1, 1, 0, 0) };
+	CHECK(!isQuantizationErrorAcceptable(roundTrip(nan, params, decoded), params));
+}
+
+int main()
+{
+	testHalf();
+	testOct();
+	testPositions();
+	testTexCoordError();
+	return checkResult("QuantizationTest");
+}
@@ -0,0 +1,428 @@
+#pragma once
+
+#include <d3d11.h>
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// An ID3D11DeviceContext which forwards every call to a real context and records what the effect
+// tests look at: the number of calls per method and every buffer upload with its range and data.
+// The bound state itself is read back from the real context (getInner()).
+//
+// The effect does not hold a reference to the context, so the recorder can live on the stack.
+class RecordingContext : public ID3D11DeviceContext
+{
+public:
+	struct Upload
+	{
+		ID3D11Resource* resource;
+		bool map;                  // Map/WRITE_DISCARD instead of UpdateSubresource
+		bool boxed;                // UpdateSubresource with a box
+		UINT begin;                // byte range, the whole buffer unless boxed
+		UINT end;
+		std::vector<uint8_t> data; // the bytes written to [begin, end)
+	};
+
+	explicit RecordingContext(ID3D11DeviceContext* context)
+		: inner(context), references(1), mappedResource(nullptr), mappedData(nullptr)
+	{
+	}
+
+	ID3D11DeviceContext* getInner() const { return inner; }
+
+	int getCount(const std::string& method) const
+	{
+		auto call = calls.find(method);
+		return call == calls.end() ? 0 : call->second;
+	}
+
+	// The calls the effect state cache may skip: shaders, shader resources and render states
+	int getStateCallCount() const
+	{
+		int count = getCount("OMSetBlendState") + getCount("OMSetDepthStencilState") + getCount("RSSetState");
+		for (const char* stage : { "VS", "HS", "DS", "GS", "PS", "CS" })
+			count += getCount(std::string(stage) + "SetShader") + getCount(std::string(stage) + "SetShaderResources");
+		return count;
+	}
+
+	void clear()
+	{
+		calls.clear();
+		uploads.clear();
+	}
+
+	std::map<std::string, int> calls;
+	std::vector<Upload> uploads;
+
+	// IUnknown, the recorder itself for the context interfaces, the real context for anything else
+	HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppvObject) override
+	{
+		if (ppvObject && (riid == __uuidof(IUnknown) || riid == __uuidof(ID3D11DeviceChild) || riid == __uuidof(ID3D11DeviceContext)))
+		{
+			AddRef();
+			*ppvObject = static_cast<ID3D11DeviceContext*>(this);
+			return S_OK;
+		}
+		return inner->QueryInterface(riid, ppvObject);
+	}
+	ULONG STDMETHODCALLTYPE AddRef() override { return ++references; }
+	ULONG STDMETHODCALLTYPE Release() override { return --references; }
+
+	// ID3D11DeviceChild
+	void STDMETHODCALLTYPE GetDevice(ID3D11Device** ppDevice) override { inner->GetDevice(ppDevice); }
+	HRESULT STDMETHODCALLTYPE GetPrivateData(REFGUID guid, UINT* pDataSize, void* pData) override { return inner->GetPrivateData(guid, pDataSize, pData); }
+	HRESULT STDMETHODCALLTYPE SetPrivateData(REFGUID guid, UINT DataSize, const void* pData) override { return inner->SetPrivateData(guid, DataSize, pData); }
+	HRESULT STDMETHODCALLTYPE SetPrivateDataInterface(REFGUID guid, const IUnknown* pData) override { return inner->SetPrivateDataInterface(guid, pData); }
+
+	// The methods every shader stage has
+#define RECORDING_CONTEXT_STAGE(Stage, Shader) \
+	void STDMETHODCALLTYPE Stage##SetShaderResources(UINT StartSlot, UINT NumViews, ID3D11ShaderResourceView* const* ppShaderResourceViews) override \
+	{ \
+		record(#Stage "SetShaderResources"); \
+		inner->Stage##SetShaderResources(StartSlot, NumViews, ppShaderResourceViews); \
+	} \
+	void STDMETHODCALLTYPE Stage##SetShader(Shader* pShader, ID3D11ClassInstance* const* ppClassInstances, UINT NumClassInstances) override \
+	{ \
+		record(#Stage "SetShader"); \
+		inner->Stage##SetShader(pShader, ppClassInstances, NumClassInstances); \
+	} \
+	void STDMETHODCALLTYPE Stage##SetSamplers(UINT StartSlot, UINT NumSamplers, ID3D11SamplerState* const* ppSamplers) override \
+	{ \
+		record(#Stage "SetSamplers"); \
+		inner->Stage##SetSamplers(StartSlot, NumSamplers, ppSamplers); \
+	} \
+	void STDMETHODCALLTYPE Stage##SetConstantBuffers(UINT StartSlot, UINT NumBuffers, ID3D11Buffer* const* ppConstantBuffers) override \
+	{ \
+		record(#Stage "SetConstantBuffers"); \
+		inner->Stage##SetConstantBuffers(StartSlot, NumBuffers, ppConstantBuffers); \
+	} \
+	void STDMETHODCALLTYPE Stage##GetShaderResources(UINT StartSlot, UINT NumViews, ID3D11ShaderResourceView** ppShaderResourceViews) override \
+	{ \
+		inner->Stage##GetShaderResources(StartSlot, NumViews, ppShaderResourceViews); \
+	} \
+	void STDMETHODCALLTYPE Stage##GetShader(Shader** ppShader, ID3D11ClassInstance** ppClassInstances, UINT* pNumClassInstances) override \
+	{ \
+		inner->Stage##GetShader(ppShader, ppClassInstances, pNumClassInstances); \
+	} \
+	void STDMETHODCALLTYPE Stage##GetSamplers(UINT StartSlot, UINT NumSamplers, ID3D11SamplerState** ppSamplers) override \
+	{ \
+		inner->Stage##GetSamplers(StartSlot, NumSamplers, ppSamplers); \
+	} \
+	void STDMETHODCALLTYPE Stage##GetConstantBuffers(UINT StartSlot, UINT NumBuffers, ID3D11Buffer** ppConstantBuffers) override \
+	{ \
+		inner->Stage##GetConstantBuffers(StartSlot, NumBuffers, ppConstantBuffers); \
+	}
+
+	RECORDING_CONTEXT_STAGE(VS, ID3D11VertexShader)
+	RECORDING_CONTEXT_STAGE(HS, ID3D11HullShader)
+	RECORDING_CONTEXT_STAGE(DS, ID3D11DomainShader)
+	RECORDING_CONTEXT_STAGE(GS, ID3D11GeometryShader)
+	RECORDING_CONTEXT_STAGE(PS, ID3D11PixelShader)
+	RECORDING_CONTEXT_STAGE(CS, ID3D11ComputeShader)
+#undef RECORDING_CONTEXT_STAGE
+
+	// Uploads
+	HRESULT STDMETHODCALLTYPE Map(ID3D11Resource* pResource, UINT Subresource, D3D11_MAP MapType, UINT MapFlags, D3D11_MAPPED_SUBRESOURCE* pMappedResource) override
+	{
+		record("Map");
+		HRESULT hr = inner->Map(pResource, Subresource, MapType, MapFlags, pMappedResource);
+		if (SUCCEEDED(hr) && MapType == D3D11_MAP_WRITE_DISCARD && getBufferSize(pResource) > 0)
+		{
+			mappedResource = pResource;
+			mappedData = pMappedResource->pData;
+		}
+		return hr;
+	}
+	void STDMETHODCALLTYPE Unmap(ID3D11Resource* pResource, UINT Subresource) override
+	{
+		record("Unmap");
+		if (pResource == mappedResource)
+		{
+			UINT size = getBufferSize(pResource);
+			const uint8_t* data = static_cast<const uint8_t*>(mappedData);
+			uploads.push_back({ pResource, true, false, 0, size, std::vector<uint8_t>(data, data + size) });
+			mappedResource = nullptr;
+			mappedData = nullptr;
+		}
+		inner->Unmap(pResource, Subresource);
+	}
+	void STDMETHODCALLTYPE UpdateSubresource(ID3D11Resource* pDstResource, UINT DstSubresource, const D3D11_BOX* pDstBox, const void* pSrcData, UINT SrcRowPitch, UINT SrcDepthPitch) override
+	{
+		record("UpdateSubresource");
+		if (UINT size = getBufferSize(pDstResource))
+		{
+			UINT begin = pDstBox ? pDstBox->left : 0;
+			UINT end = pDstBox ? pDstBox->right : size;
+			const uint8_t* data = static_cast<const uint8_t*>(pSrcData);
+			uploads.push_back({ pDstResource, false, pDstBox != nullptr, begin, end, std::vector<uint8_t>(data, data + (end - begin)) });
+		}
+		inner->UpdateSubresource(pDstResource, DstSubresource, pDstBox, pSrcData, SrcRowPitch, SrcDepthPitch);
+	}
+
+	// Everything else is only counted
+	void STDMETHODCALLTYPE DrawIndexed(UINT IndexCount, UINT StartIndexLocation, INT BaseVertexLocation) override
+	{
+		record("DrawIndexed");
+		inner->DrawIndexed(IndexCount, StartIndexLocation, BaseVertexLocation);
+	}
+	void STDMETHODCALLTYPE Draw(UINT VertexCount, UINT StartVertexLocation) override
+	{
+		record("Draw");
+		inner->Draw(VertexCount, StartVertexLocation);
+	}
+	void STDMETHODCALLTYPE IASetInputLayout(ID3D11InputLayout* pInputLayout) override
+	{
+		record("IASetInputLayout");
+		inner->IASetInputLayout(pInputLayout);
+	}
+	void STDMETHODCALLTYPE IASetVertexBuffers(UINT StartSlot, UINT NumBuffers, ID3D11Buffer* const* ppVertexBuffers, const UINT* pStrides, const UINT* pOffsets) override
+	{
+		record("IASetVertexBuffers");
+		inner->IASetVertexBuffers(StartSlot, NumBuffers, ppVertexBuffers, pStrides, pOffsets);
+	}
+	void STDMETHODCALLTYPE IASetIndexBuffer(ID3D11Buffer* pIndexBuffer, DXGI_FORMAT Format, UINT Offset) override
+	{
+		record("IASetIndexBuffer");
+		inner->IASetIndexBuffer(pIndexBuffer, Format, Offset);
+	}
+	void STDMETHODCALLTYPE DrawIndexedInstanced(UINT IndexCountPerInstance, UINT InstanceCount, UINT StartIndexLocation, INT BaseVertexLocation, UINT StartInstanceLocation) override
+	{
+		record("DrawIndexedInstanced");
+		inner->DrawIndexedInstanced(IndexCountPerInstance, InstanceCount, StartIndexLocation, BaseVertexLocation, StartInstanceLocation);
+	}
+	void STDMETHODCALLTYPE DrawInstanced(UINT VertexCountPerInstance, UINT InstanceCount, UINT StartVertexLocation, UINT StartInstanceLocation) override
+	{
+		record("DrawInstanced");
+		inner->DrawInstanced(VertexCountPerInstance, InstanceCount, StartVertexLocation, StartInstanceLocation);
+	}
+	void STDMETHODCALLTYPE IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY Topology) override
+	{
+		record("IASetPrimitiveTopology");
+		inner->IASetPrimitiveTopology(Topology);
+	}
+	void STDMETHODCALLTYPE Begin(ID3D11Asynchronous* pAsync) override
+	{
+		record("Begin");
+		inner->Begin(pAsync);
+	}
+	void STDMETHODCALLTYPE End(ID3D11Asynchronous* pAsync) override
+	{
+		record("End");
+		inner->End(pAsync);
+	}
+	HRESULT STDMETHODCALLTYPE GetData(ID3D11Asynchronous* pAsync, void* pData, UINT DataSize, UINT GetDataFlags) override
+	{
+		return inner->GetData(pAsync, pData, DataSize, GetDataFlags);
+	}
+	void STDMETHODCALLTYPE SetPredication(ID3D11Predicate* pPredicate, BOOL PredicateValue) override
+	{
+		record("SetPredication");
+		inner->SetPredication(pPredicate, PredicateValue);
+	}
+	void STDMETHODCALLTYPE OMSetRenderTargets(UINT NumViews, ID3D11RenderTargetView* const* ppRenderTargetViews, ID3D11DepthStencilView* pDepthStencilView) override
+	{
+		record("OMSetRenderTargets");
+		inner->OMSetRenderTargets(NumViews, ppRenderTargetViews, pDepthStencilView);
+	}
+	void STDMETHODCALLTYPE OMSetRenderTargetsAndUnorderedAccessViews(UINT NumRTVs, ID3D11RenderTargetView* const* ppRenderTargetViews, ID3D11DepthStencilView* pDepthStencilView,
+		UINT UAVStartSlot, UINT NumUAVs, ID3D11UnorderedAccessView* const* ppUnorderedAccessViews, const UINT* pUAVInitialCounts) override
+	{
+		record("OMSetRenderTargetsAndUnorderedAccessViews");
+		inner->OMSetRenderTargetsAndUnorderedAccessViews(NumRTVs, ppRenderTargetViews, pDepthStencilView, UAVStartSlot, NumUAVs, ppUnorderedAccessViews, pUAVInitialCounts);
+	}
+	void STDMETHODCALLTYPE OMSetBlendState(ID3D11BlendState* pBlendState, const FLOAT BlendFactor[4], UINT SampleMask) override
+	{
+		record("OMSetBlendState");
+		inner->OMSetBlendState(pBlendState, BlendFactor, SampleMask);
+	}
+	void STDMETHODCALLTYPE OMSetDepthStencilState(ID3D11DepthStencilState* pDepthStencilState, UINT StencilRef) override
+	{
+		record("OMSetDepthStencilState");
+		inner->OMSetDepthStencilState(pDepthStencilState, StencilRef);
+	}
+	void STDMETHODCALLTYPE SOSetTargets(UINT NumBuffers, ID3D11Buffer* const* ppSOTargets, const UINT* pOffsets) override
+	{
+		record("SOSetTargets");
+		inner->SOSetTargets(NumBuffers, ppSOTargets, pOffsets);
+	}
+	void STDMETHODCALLTYPE DrawAuto() override
+	{
+		record("DrawAuto");
+		inner->DrawAuto();
+	}
+	void STDMETHODCALLTYPE DrawIndexedInstancedIndirect(ID3D11Buffer* pBufferForArgs, UINT AlignedByteOffsetForArgs) override
+	{
+		record("DrawIndexedInstancedIndirect");
+		inner->DrawIndexedInstancedIndirect(pBufferForArgs, AlignedByteOffsetForArgs);
+	}
+	void STDMETHODCALLTYPE DrawInstancedIndirect(ID3D11Buffer* pBufferForArgs, UINT AlignedByteOffsetForArgs) override
+	{
+		record("DrawInstancedIndirect");
+		inner->DrawInstancedIndirect(pBufferForArgs, AlignedByteOffsetForArgs);
+	}
+	void STDMETHODCALLTYPE Dispatch(UINT ThreadGroupCountX, UINT ThreadGroupCountY, UINT ThreadGroupCountZ) override
+	{
+		record("Dispatch");
+		inner->Dispatch(ThreadGroupCountX, ThreadGroupCountY, ThreadGroupCountZ);
+	}
+	void STDMETHODCALLTYPE DispatchIndirect(ID3D11Buffer* pBufferForArgs, UINT AlignedByteOffsetForArgs) override
+	{
+		record("DispatchIndirect");
+		inner->DispatchIndirect(pBufferForArgs, AlignedByteOffsetForArgs);
+	}
+	void STDMETHODCALLTYPE RSSetState(ID3D11RasterizerState* pRasterizerState) override
+	{
+		record("RSSetState");
+		inner->RSSetState(pRasterizerState);
+	}
+	void STDMETHODCALLTYPE RSSetViewports(UINT NumViewports, const D3D11_VIEWPORT* pViewports) override
+	{
+		record("RSSetViewports");
+		inner->RSSetViewports(NumViewports, pViewports);
+	}
+	void STDMETHODCALLTYPE RSSetScissorRects(UINT NumRects, const D3D11_RECT* pRects) override
+	{
+		record("RSSetScissorRects");
+		inner->RSSetScissorRects(NumRects, pRects);
+	}
+	void STDMETHODCALLTYPE CopySubresourceRegion(ID3D11Resource* pDstResource, UINT DstSubresource, UINT DstX, UINT DstY, UINT DstZ,
+		ID3D11Resource* pSrcResource, UINT SrcSubresource, const D3D11_BOX* pSrcBox) override
+	{
+		record("CopySubresourceRegion");
+		inner->CopySubresourceRegion(pDstResource, DstSubresource, DstX, DstY, DstZ, pSrcResource, SrcSubresource, pSrcBox);
+	}
+	void STDMETHODCALLTYPE CopyResource(ID3D11Resource* pDstResource, ID3D11Resource* pSrcResource) override
+	{
+		record("CopyResource");
+		inner->CopyResource(pDstResource, pSrcResource);
+	}
+	void STDMETHODCALLTYPE CopyStructureCount(ID3D11Buffer* pDstBuffer, UINT DstAlignedByteOffset, ID3D11UnorderedAccessView* pSrcView) override
+	{
+		record("CopyStructureCount");
+		inner->CopyStructureCount(pDstBuffer, DstAlignedByteOffset, pSrcView);
+	}
+	void STDMETHODCALLTYPE ClearRenderTargetView(ID3D11RenderTargetView* pRenderTargetView, const FLOAT ColorRGBA[4]) override
+	{
+		record("ClearRenderTargetView");
+		inner->ClearRenderTargetView(pRenderTargetView, ColorRGBA);
+	}
+	void STDMETHODCALLTYPE ClearUnorderedAccessViewUint(ID3D11UnorderedAccessView* pUnorderedAccessView, const UINT Values[4]) override
+	{
+		record("ClearUnorderedAccessViewUint");
+		inner->ClearUnorderedAccessViewUint(pUnorderedAccessView, Values);
+	}
+	void STDMETHODCALLTYPE ClearUnorderedAccessViewFloat(ID3D11UnorderedAccessView* pUnorderedAccessView, const FLOAT Values[4]) override
+	{
+		record("ClearUnorderedAccessViewFloat");
+		inner->ClearUnorderedAccessViewFloat(pUnorderedAccessView, Values);
+	}
+	void STDMETHODCALLTYPE ClearDepthStencilView(ID3D11DepthStencilView* pDepthStencilView, UINT ClearFlags, FLOAT Depth, UINT8 Stencil) override
+	{
+		record("ClearDepthStencilView");
+		inner->ClearDepthStencilView(pDepthStencilView, ClearFlags, Depth, Stencil);
+	}
+	void STDMETHODCALLTYPE GenerateMips(ID3D11ShaderResourceView* pShaderResourceView) override
+	{
+		record("GenerateMips");
+		inner->GenerateMips(pShaderResourceView);
+	}
+	void STDMETHODCALLTYPE SetResourceMinLOD(ID3D11Resource* pResource, FLOAT MinLOD) override
+	{
+		record("SetResourceMinLOD");
+		inner->SetResourceMinLOD(pResource, MinLOD);
+	}
+	FLOAT STDMETHODCALLTYPE GetResourceMinLOD(ID3D11Resource* pResource) override
+	{
+		return inner->GetResourceMinLOD(pResource);
+	}
+	void STDMETHODCALLTYPE ResolveSubresource(ID3D11Resource* pDstResource, UINT DstSubresource, ID3D11Resource* pSrcResource, UINT SrcSubresource, DXGI_FORMAT Format) override
+	{
+		record("ResolveSubresource");
+		inner->ResolveSubresource(pDstResource, DstSubresource, pSrcResource, SrcSubresource, Format);
+	}
+	void STDMETHODCALLTYPE ExecuteCommandList(ID3D11CommandList* pCommandList, BOOL RestoreContextState) override
+	{
+		record("ExecuteCommandList");
+		inner->ExecuteCommandList(pCommandList, RestoreContextState);
+	}
+	void STDMETHODCALLTYPE CSSetUnorderedAccessViews(UINT StartSlot, UINT NumUAVs, ID3D11UnorderedAccessView* const* ppUnorderedAccessViews, const UINT* pUAVInitialCounts) override
+	{
+		record("CSSetUnorderedAccessViews");
+		inner->CSSetUnorderedAccessViews(StartSlot, NumUAVs, ppUnorderedAccessViews, pUAVInitialCounts);
+	}
+
+	// Getters are forwarded without recording
+	void STDMETHODCALLTYPE IAGetInputLayout(ID3D11InputLayout** ppInputLayout) override { inner->IAGetInputLayout(ppInputLayout); }
+	void STDMETHODCALLTYPE IAGetVertexBuffers(UINT StartSlot, UINT NumBuffers, ID3D11Buffer** ppVertexBuffers, UINT* pStrides, UINT* pOffsets) override
+	{
+		inner->IAGetVertexBuffers(StartSlot, NumBuffers, ppVertexBuffers, pStrides, pOffsets);
+	}
+	void STDMETHODCALLTYPE IAGetIndexBuffer(ID3D11Buffer** pIndexBuffer, DXGI_FORMAT* Format, UINT* Offset) override { inner->IAGetIndexBuffer(pIndexBuffer, Format, Offset); }
+	void STDMETHODCALLTYPE IAGetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY* pTopology) override { inner->IAGetPrimitiveTopology(pTopology); }
+	void STDMETHODCALLTYPE GetPredication(ID3D11Predicate** ppPredicate, BOOL* pPredicateValue) override { inner->GetPredication(ppPredicate, pPredicateValue); }
+	void STDMETHODCALLTYPE OMGetRenderTargets(UINT NumViews, ID3D11RenderTargetView** ppRenderTargetViews, ID3D11DepthStencilView** ppDepthStencilView) override
+	{
+		inner->OMGetRenderTargets(NumViews, ppRenderTargetViews, ppDepthStencilView);
+	}
+	void STDMETHODCALLTYPE OMGetRenderTargetsAndUnorderedAccessViews(UINT NumRTVs, ID3D11RenderTargetView** ppRenderTargetViews, ID3D11DepthStencilView** ppDepthStencilView,
+		UINT UAVStartSlot, UINT NumUAVs, ID3D11UnorderedAccessView** ppUnorderedAccessViews) override
+	{
+		inner->OMGetRenderTargetsAndUnorderedAccessViews(NumRTVs, ppRenderTargetViews, ppDepthStencilView, UAVStartSlot, NumUAVs, ppUnorderedAccessViews);
+	}
+	void STDMETHODCALLTYPE OMGetBlendState(ID3D11BlendState** ppBlendState, FLOAT BlendFactor[4], UINT* pSampleMask) override
+	{
+		inner->OMGetBlendState(ppBlendState, BlendFactor, pSampleMask);
+	}
+	void STDMETHODCALLTYPE OMGetDepthStencilState(ID3D11DepthStencilState** ppDepthStencilState, UINT* pStencilRef) override
+	{
+		inner->OMGetDepthStencilState(ppDepthStencilState, pStencilRef);
+	}
+	void STDMETHODCALLTYPE SOGetTargets(UINT NumBuffers, ID3D11Buffer** ppSOTargets) override { inner->SOGetTargets(NumBuffers, ppSOTargets); }
+	void STDMETHODCALLTYPE RSGetState(ID3D11RasterizerState** ppRasterizerState) override { inner->RSGetState(ppRasterizerState); }
+	void STDMETHODCALLTYPE RSGetViewports(UINT* pNumViewports, D3D11_VIEWPORT* pViewports) override { inner->RSGetViewports(pNumViewports, pViewports); }
+	void STDMETHODCALLTYPE RSGetScissorRects(UINT* pNumRects, D3D11_RECT* pRects) override { inner->RSGetScissorRects(pNumRects, pRects); }
+	void STDMETHODCALLTYPE CSGetUnorderedAccessViews(UINT StartSlot, UINT NumUAVs, ID3D11UnorderedAccessView** ppUnorderedAccessViews) override
+	{
+		inner->CSGetUnorderedAccessViews(StartSlot, NumUAVs, ppUnorderedAccessViews);
+	}
+
+	void STDMETHODCALLTYPE ClearState() override
+	{
+		record("ClearState");
+		inner->ClearState();
+	}
+	void STDMETHODCALLTYPE Flush() override
+	{
+		record("Flush");
+		inner->Flush();
+	}
+	D3D11_DEVICE_CONTEXT_TYPE STDMETHODCALLTYPE GetType() override { return inner->GetType(); }
+	UINT STDMETHODCALLTYPE GetContextFlags() override { return inner->GetContextFlags(); }
+	HRESULT STDMETHODCALLTYPE FinishCommandList(BOOL RestoreDeferredContextState, ID3D11CommandList** ppCommandList) override
+	{
+		record("FinishCommandList");
+		return inner->FinishCommandList(RestoreDeferredContextState, ppCommandList);
+	}
+
+private:
+	void record(const char* method) { calls[method]++; }
+
+	// ByteWidth of a buffer, 0 for textures
+	static UINT getBufferSize(ID3D11Resource* resource)
+	{
+		D3D11_RESOURCE_DIMENSION dimension;
+		resource->GetType(&dimension);
+		if (dimension != D3D11_RESOURCE_DIMENSION_BUFFER)
+			return 0;
+		D3D11_BUFFER_DESC desc;
+		static_cast<ID3D11Buffer*>(resource)->GetDesc(&desc);
+		return desc.ByteWidth;
+	}
+
+	ID3D11DeviceContext* inner;
+	ULONG references;
+	ID3D11Resource* mappedResource;
+	void* mappedData;
+};
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "EffectStateCache.h"
+#include "EffectUpload.h"
+
+// Stand-ins for the effect's ID3D11DeviceContext that build without Direct3D. They receive what the
+// effect would send to the context and record it, RecordingContext.h does the same around a real
+// context on Windows.
+
+// A buffer on the "GPU": every upload is applied to a copy of its contents and recorded
+class RecordingUploadTarget : public D3DX11Effects::IConstantBufferTarget
+{
+public:
+	struct Upload
+	{
+		bool map;                  // Map/WRITE_DISCARD instead of UpdateSubresource
+		bool boxed;                // UpdateSubresource with a box
+		uint32_t begin;            // byte range, the whole buffer unless boxed
+		uint32_t end;
+	};
+
+	explicit RecordingUploadTarget(uint32_t size)
+		: contents(size, 0), failMap(false), maps(0), unmaps(0), mapped(false)
+	{
+	}
+
+	void clear()
+	{
+		uploads.clear();
+		maps = unmaps = 0;
+	}
+
+	void* MapDiscard() override
+	{
+		maps++;
+		if (failMap || mapped)
+			return nullptr;
+
+		// Discarding hands out memory with undefined contents
+		mapped = true;
+		std::fill(contents.begin(), contents.end(), uint8_t(0xCD));
+		return contents.data();
+	}
+
+	void Unmap() override
+	{
+		unmaps++;
+		if (mapped)
+			uploads.push_back({ true, false, 0, uint32_t(contents.size()) });
+		mapped = false;
+	}
+
+	void Update(const void* pData, uint32_t start, uint32_t end, bool boxed) override
+	{
+		const uint8_t* data = static_cast<const uint8_t*>(pData);
+		if (start <= end && end <= contents.size())
+			std::copy(data, data + (end - start), contents.begin() + start);
+		uploads.push_back({ false, boxed, start, end });
+	}
+
+	std::vector<uint8_t> contents;
+	std::vector<Upload> uploads;
+	bool failMap;                  // MapDiscard fails while set
+	int maps;
+	int unmaps;
+
+private:
+	bool mapped;
+};
+
+// A context for the state calls of ApplyPassBlock: the calls are counted and applied to the bound
+// state, which the tests compare with what the passes set
+class RecordingStateContext
+{
+public:
+	static const uint32_t kStageCount = D3DX11Effects::SStateCache::StageCount;
+	static const uint32_t kSlotCount = D3DX11Effects::SStateCache::c_ResourceSlotCount;
+
+	RecordingStateContext()
+	{
+		reset();
+	}
+
+	// A new context, nothing bound
+	void reset()
+	{
+		blendState = depthStencilState = rasterizerState = nullptr;
+		std::fill(blendFactor, blendFactor + 4, 1.0f);
+		sampleMask = 0xffffffff;
+		stencilRef = 0;
+		std::fill(shaders, shaders + kStageCount, nullptr);
+		unbindShaderResources();
+		calls = 0;
+	}
+
+	void OMSetBlendState(const void* state, const float factor[4], uint32_t mask)
+	{
+		blendState = state;
+		std::copy(factor, factor + 4, blendFactor);
+		sampleMask = mask;
+		calls++;
+	}
+
+	void OMSetDepthStencilState(const void* state, uint32_t ref)
+	{
+		depthStencilState = state;
+		stencilRef = ref;
+		calls++;
+	}
+
+	void RSSetState(const void* state)
+	{
+		rasterizerState = state;
+		calls++;
+	}
+
+	void SetShader(uint32_t stage, const void* shader)
+	{
+		shaders[stage] = shader;
+		calls++;
+	}
+
+	void SetShaderResources(uint32_t stage, uint32_t startSlot, uint32_t count, const void* const* views)
+	{
+		std::copy(views, views + count, shaderResources[stage] + startSlot);
+		calls++;
+	}
+
+	// Binding outputs, the runtime unbinds the shader resources that alias them. Any of them may,
+	// so the recorder unbinds all.
+	void OMSetRenderTargets()
+	{
+		unbindShaderResources();
+		calls++;
+	}
+
+	const void* blendState;
+	float blendFactor[4];
+	uint32_t sampleMask;
+	const void* depthStencilState;
+	uint32_t stencilRef;
+	const void* rasterizerState;
+	const void* shaders[kStageCount];
+	const void* shaderResources[kStageCount][kSlotCount];
+	uint64_t calls;
+
+private:
+	void unbindShaderResources()
+	{
+		for (auto& stage : shaderResources)
+			std::fill(stage, stage + kSlotCount, nullptr);
+	}
+};
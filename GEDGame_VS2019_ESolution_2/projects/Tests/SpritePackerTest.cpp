@@ -0,0 +1,167 @@
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Check.h"
+#include "SpritePacker.h"
+
+// The placement of sprite frames by "texassemble sprites": frames in bounds, aligned to their size
+// and not overlapping, one cell size per slice, the slice limit, the mip count and the frame table
+// the game's SpriteRenderer reads.
+
+using namespace SpritePacker;
+
+namespace
+{
+	bool overlap(const FramePlacement& a, const FramePlacement& b)
+	{
+		return a.slice == b.slice
+			&& a.x < b.x + b.size && b.x < a.x + a.size
+			&& a.y < b.y + b.size && b.y < a.y + a.size;
+	}
+
+	// Frame sizes of several sprites, interleaved as they would come from the inputs
+	std::vector<size_t> mixedSizes()
+	{
+		std::vector<size_t> sizes;
+		for (size_t i = 0; i < 40; i++)
+		{
+			sizes.push_back(16);
+			if (i % 4 == 0)
+				sizes.push_back(64);
+			if (i % 8 == 0)
+				sizes.push_back(128);
+			if (i % 13 == 0)
+				sizes.push_back(256);
+		}
+		return sizes;
+	}
+}
+
+void testPlacement()
+{
+	const std::vector<size_t> sizes = mixedSizes();
+	Layout layout;
+	CHECK(PackFrames(sizes, 2048, layout));
+	CHECK(layout.frames.size() == sizes.size());
+	CHECK(layout.sliceSize == 256);
+
+	// 4 frames of 256, 5 of 128 (4 per slice), 10 of 64 (16 per slice) and 40 of 16 (256 per slice)
+	CHECK(layout.slices == 4 + 2 + 1 + 1);
+
+	// Down to 4x4 for the 16x16 cells
+	CHECK(layout.mipLevels == 3);
+
+	std::vector<size_t> sliceCellSize(layout.slices, 0);
+	for (size_t i = 0; i < sizes.size(); i++)
+	{
+		const FramePlacement& frame = layout.frames[i];
+		CHECK(frame.size == sizes[i]);
+		CHECK(frame.slice < layout.slices);
+		CHECK(frame.x + frame.size <= layout.sliceSize && frame.y + frame.size <= layout.sliceSize);
+		CHECK(frame.x % frame.size == 0 && frame.y % frame.size == 0);
+
+		// One cell size per slice
+		if (frame.slice < layout.slices)
+		{
+			if (!sliceCellSize[frame.slice])
+				sliceCellSize[frame.slice] = frame.size;
+			CHECK(sliceCellSize[frame.slice] == frame.size);
+		}
+
+		for (size_t j = 0; j < i; j++)
+			CHECK(!overlap(frame, layout.frames[j]));
+	}
+	CHECK(std::count(sliceCellSize.begin(), sliceCellSize.end(), size_t(0)) == 0);
+
+	// Frames of one size fill the cells in their order, row by row
+	for (size_t i = 0; i < sizes.size(); i++)
+		for (size_t j = i + 1; j < sizes.size(); j++)
+			if (sizes[i] == sizes[j])
+			{
+				const FramePlacement& a = layout.frames[i];
+				const FramePlacement& b = layout.frames[j];
+				CHECK(a.slice < b.slice || (a.slice == b.slice && (a.y < b.y || (a.y == b.y && a.x < b.x))));
+			}
+}
+
+void testLimits()
+{
+	Layout layout;
+
+	// Square powers of 2 only
+	CHECK(!PackFrames({ 64, 48 }, 2048, layout));
+	CHECK(!PackFrames({ 0 }, 2048, layout));
+	CHECK(!IsValidFrameSize(0) && !IsValidFrameSize(3) && IsValidFrameSize(1) && IsValidFrameSize(4096));
+
+	// Frames of the largest size take a slice each
+	CHECK(PackFrames(std::vector<size_t>(2048, 64), 2048, layout));
+	CHECK(layout.slices == 2048);
+	CHECK(!PackFrames(std::vector<size_t>(2049, 64), 2048, layout));
+	CHECK(layout.slices == 2049);
+
+	// Smaller frames share a slice, the 257th cell of 16x16 in 256x256 starts the next one
+	std::vector<size_t> sizes(257, 16);
+	sizes.push_back(256);
+	CHECK(PackFrames(sizes, 2048, layout));
+	CHECK(layout.slices == 3);
+	CHECK(layout.frames[255].slice == layout.frames[0].slice);
+	CHECK(layout.frames[256].slice != layout.frames[0].slice);
+	CHECK(layout.frames[256].x == 0 && layout.frames[256].y == 0);
+
+	// No mips below 4x4 cells, and none at all for 4x4 frames
+	CHECK(PackFrames({ 4, 4 }, 2048, layout));
+	CHECK(layout.mipLevels == 1);
+	CHECK(PackFrames({ 8 }, 2048, layout));
+	CHECK(layout.mipLevels == 2);
+}
+
+void testTable()
+{
+	Layout layout;
+	CHECK(PackFrames({ 32, 32, 16, 16, 16 }, 2048, layout));
+
+	std::vector<Sequence> sequences = { { L"explosion", 0, 2 }, { L"spark", 2, 3 } };
+	std::wostringstream out;
+	WriteTable(out, sequences, layout, 24.0f);
+
+	// Comment lines, then the keys SpriteRenderer reads
+	std::wistringstream table(out.str());
+	std::wstring line;
+	size_t comments = 0;
+	while (table.peek() == L'#' && std::getline(table, line))
+		comments++;
+	CHECK(comments == 3);
+
+	std::wstring key;
+	size_t slices = 0, sliceSize = 0;
+	table >> key >> slices >> sliceSize;
+	CHECK(key == L"slices" && slices == layout.slices && sliceSize == 32);
+
+	for (const Sequence& sequence : sequences)
+	{
+		std::wstring name;
+		size_t first = 0, count = 0;
+		float fps = 0;
+		table >> key >> name >> first >> count >> fps;
+		CHECK(key == L"sprite" && name == sequence.name && first == sequence.firstFrame && count == sequence.frameCount && fps == 24.0f);
+	}
+
+	for (const FramePlacement& frame : layout.frames)
+	{
+		size_t slice = 0, x = 0, y = 0, size = 0;
+		table >> key >> slice >> x >> y >> size;
+		CHECK(key == L"frame" && slice == frame.slice && x == frame.x && y == frame.y && size == frame.size);
+	}
+
+	CHECK(!(table >> key));
+}
+
+int main()
+{
+	testPlacement();
+	testLimits();
+	testTable();
+	return checkResult("SpritePackerTest");
+}
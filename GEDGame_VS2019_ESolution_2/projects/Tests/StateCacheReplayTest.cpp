@@ -0,0 +1,318 @@
+#include <chrono>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "Check.h"
+#include "RecordingTarget.h"
+
+// Replays the passes of a few game-like frames through the effect state cache into a recording
+// context, with D3DX11_EFFECT_FILTER_REDUNDANT_STATE and without: after every pass the context
+// has the state the pass sets either way, the calls add up, and the filter skips most of them
+// when draws are sorted by material. Also reports the time of both replays, which only covers the
+// cache and the recorder; the calls saved would each cost a runtime call on a real context.
+
+using namespace D3DX11Effects;
+
+namespace
+{
+	const uint32_t kStageCount = SStateCache::StageCount;
+
+	struct ShaderBinding
+	{
+		uint32_t stage;
+		const void* shader;
+		bool classInstances;
+		uint32_t startSlot;
+		std::vector<const void*> views;
+	};
+
+	// The state a pass sets, in the order ApplyPassBlock sets it
+	struct Pass
+	{
+		const void* blendState;
+		float blendFactor[4];
+		uint32_t sampleMask;
+		const void* depthStencilState;
+		uint32_t stencilRef;
+		const void* rasterizerState;
+		bool bindsOutputs;
+		std::vector<ShaderBinding> shaders;
+	};
+
+	struct Counts
+	{
+		uint64_t issued = 0;
+		uint64_t filtered = 0;
+	};
+
+	// Distinct addresses standing in for state objects, shaders and views
+	const void* object(size_t index)
+	{
+		static char objects[4096];
+		return objects + index;
+	}
+
+	// Whether ApplyPassBlock makes a call the cache has seen as changed or not
+	bool issue(bool changed, bool filtering, Counts& counts)
+	{
+		if (!changed && filtering)
+		{
+			counts.filtered++;
+			return false;
+		}
+		counts.issued++;
+		return true;
+	}
+
+	void apply(const Pass& pass, SStateCache& cache, bool filtering, RecordingStateContext& context, Counts& counts)
+	{
+		if (issue(cache.SetBlendState(pass.blendState, pass.blendFactor, pass.sampleMask), filtering, counts))
+			context.OMSetBlendState(pass.blendState, pass.blendFactor, pass.sampleMask);
+		if (issue(cache.SetDepthStencilState(pass.depthStencilState, pass.stencilRef), filtering, counts))
+			context.OMSetDepthStencilState(pass.depthStencilState, pass.stencilRef);
+		if (issue(cache.SetRasterizerState(pass.rasterizerState), filtering, counts))
+			context.RSSetState(pass.rasterizerState);
+
+		// Never filtered
+		if (pass.bindsOutputs)
+		{
+			context.OMSetRenderTargets();
+			cache.InvalidateShaderResources();
+		}
+
+		for (const ShaderBinding& binding : pass.shaders)
+		{
+			const uint32_t count = uint32_t(binding.views.size());
+			if (count && issue(cache.SetShaderResources(binding.stage, binding.startSlot, count, binding.views.data()), filtering, counts))
+				context.SetShaderResources(binding.stage, binding.startSlot, count, binding.views.data());
+			if (issue(cache.SetShader(binding.stage, binding.shader, binding.classInstances), filtering, counts))
+				context.SetShader(binding.stage, binding.shader);
+		}
+	}
+
+	// The number of calls a pass makes without the filter
+	uint64_t getCallCount(const Pass& pass)
+	{
+		uint64_t calls = 3;
+		for (const ShaderBinding& binding : pass.shaders)
+			calls += binding.views.empty() ? 1 : 2;
+		return calls;
+	}
+
+	// The context has everything the pass sets
+	bool isBound(const Pass& pass, const RecordingStateContext& context)
+	{
+		bool bound = context.blendState == pass.blendState && memcmp(context.blendFactor, pass.blendFactor, sizeof(pass.blendFactor)) == 0
+			&& context.sampleMask == pass.sampleMask && context.depthStencilState == pass.depthStencilState
+			&& context.stencilRef == pass.stencilRef && context.rasterizerState == pass.rasterizerState;
+		for (const ShaderBinding& binding : pass.shaders)
+		{
+			bound = bound && context.shaders[binding.stage] == binding.shader;
+			for (size_t i = 0; i < binding.views.size(); i++)
+				bound = bound && context.shaderResources[binding.stage][binding.startSlot + i] == binding.views[i];
+		}
+		return bound;
+	}
+
+	Pass createPass(size_t states, bool bindsOutputs)
+	{
+		Pass pass = {};
+		pass.blendState = object(states);
+		for (float& factor : pass.blendFactor)
+			factor = 1.0f;
+		pass.sampleMask = 0xffffffff;
+		pass.depthStencilState = object(states + 1);
+		pass.rasterizerState = object(states + 2);
+		pass.bindsOutputs = bindsOutputs;
+		return pass;
+	}
+
+	// Frames like the game's: the terrain into the shadow map and the scene, meshes sorted by
+	// material with their instance data in a VS buffer, GS sprites blended on top, then a post
+	// process pass
+	std::vector<Pass> createFrames(size_t frameCount)
+	{
+		std::mt19937 random(3);
+		size_t next = 0;
+		auto allocate = [&next](size_t count) { next += count; return next - count; };
+
+		const size_t terrainStates = allocate(3), meshStates = allocate(3), spriteStates = allocate(3), postStates = allocate(3);
+		const size_t terrainVS = allocate(1), terrainPS = allocate(1), heightMap = allocate(1), terrainTextures = allocate(4);
+		const size_t meshVS = allocate(2), meshPS = allocate(2), spriteVS = allocate(1), spriteGS = allocate(1), spritePS = allocate(1);
+		const size_t postVS = allocate(1), postPS = allocate(1), sceneTarget = allocate(1), spriteAtlas = allocate(1);
+		const size_t materialCount = 12, materialTextures = allocate(materialCount * 3), instanceBuffers = allocate(64);
+
+		std::vector<Pass> frames;
+		for (size_t frame = 0; frame < frameCount; frame++)
+		{
+			// Terrain, into the shadow map and then the scene target
+			for (bool shadow : { true, false })
+			{
+				Pass pass = createPass(terrainStates, true);
+				pass.stencilRef = shadow ? 1 : 0;
+				pass.shaders.push_back({ SStateCache::StageVS, object(terrainVS), false, 0, { object(heightMap) } });
+				if (!shadow)
+					pass.shaders.push_back({ SStateCache::StagePS, object(terrainPS), false, 0,
+						{ object(heightMap), object(terrainTextures), object(terrainTextures + 1), object(terrainTextures + 2), object(terrainTextures + 3) } });
+				frames.push_back(pass);
+			}
+
+			// Meshes in runs of one material, a run of skinned meshes uses the second shader pair
+			size_t draws = 0;
+			for (size_t material = 0; material < materialCount; material++)
+			{
+				const size_t skinned = material >= materialCount - 2;
+				const size_t runLength = 20 + random() % 180;
+				for (size_t i = 0; i < runLength; i++, draws++)
+				{
+					Pass pass = createPass(meshStates, false);
+					pass.shaders.push_back({ SStateCache::StageVS, object(meshVS + skinned), false, 0, { object(instanceBuffers + draws % 64) } });
+					pass.shaders.push_back({ SStateCache::StagePS, object(meshPS + skinned), false, 0,
+						{ object(materialTextures + material * 3), object(materialTextures + material * 3 + 1), object(materialTextures + material * 3 + 2) } });
+					frames.push_back(pass);
+				}
+			}
+
+			// Sprites, the blend factor fades them
+			for (size_t i = 0; i < 40; i++)
+			{
+				Pass pass = createPass(spriteStates, false);
+				const float fade = (i % 8 == 7) ? 0.5f : 1.0f;
+				for (float& factor : pass.blendFactor)
+					factor = fade;
+				pass.shaders.push_back({ SStateCache::StageVS, object(spriteVS), false, 0, {} });
+				pass.shaders.push_back({ SStateCache::StageGS, object(spriteGS), false, 0, {} });
+				pass.shaders.push_back({ SStateCache::StagePS, object(spritePS), false, 0, { object(spriteAtlas) } });
+				frames.push_back(pass);
+			}
+
+			// Post processing, the pixel shader uses class instances
+			Pass post = createPass(postStates, true);
+			post.shaders.push_back({ SStateCache::StageVS, object(postVS), false, 0, {} });
+			post.shaders.push_back({ SStateCache::StageGS, nullptr, false, 0, {} });
+			post.shaders.push_back({ SStateCache::StagePS, object(postPS), true, 0, { object(sceneTarget) } });
+			frames.push_back(post);
+		}
+		return frames;
+	}
+
+	// Replays the passes on a new context, checking the bound state after each
+	Counts replay(const std::vector<Pass>& passes, bool filtering, RecordingStateContext& context)
+	{
+		SStateCache cache;
+		cache.Invalidate();
+		context.reset();
+
+		Counts counts;
+		size_t unbound = 0;
+		for (const Pass& pass : passes)
+		{
+			apply(pass, cache, filtering, context, counts);
+			unbound += !isBound(pass, context);
+		}
+		CHECK(unbound == 0);
+		return counts;
+	}
+
+	double timeReplay(const std::vector<Pass>& passes, bool filtering, RecordingStateContext& context, int repeats)
+	{
+		SStateCache cache;
+		Counts counts;
+		const auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < repeats; i++)
+		{
+			cache.Invalidate();
+			context.reset();
+			for (const Pass& pass : passes)
+				apply(pass, cache, filtering, context, counts);
+		}
+		const auto end = std::chrono::steady_clock::now();
+		CHECK(counts.issued + counts.filtered > 0);
+		return std::chrono::duration<double, std::milli>(end - start).count() / repeats;
+	}
+}
+
+void testReplay()
+{
+	const std::vector<Pass> passes = createFrames(3);
+	uint64_t calls = 0;
+	for (const Pass& pass : passes)
+		calls += getCallCount(pass);
+
+	RecordingStateContext context;
+	const Counts unfiltered = replay(passes, false, context);
+	const uint64_t unfilteredContextCalls = context.calls;
+	CHECK(unfiltered.issued == calls && unfiltered.filtered == 0);
+
+	const Counts filtered = replay(passes, true, context);
+	const uint64_t filteredContextCalls = context.calls;
+	CHECK(filtered.issued + filtered.filtered == calls);
+
+	// Only the issued calls reach the context, besides the output bindings
+	CHECK(unfilteredContextCalls - unfiltered.issued == filteredContextCalls - filtered.issued);
+
+	// Sorted draws only change their instance buffer
+	CHECK(filtered.issued * 4 < calls);
+
+	const int repeats = 50;
+	const double unfilteredTime = timeReplay(passes, false, context, repeats);
+	const double filteredTime = timeReplay(passes, true, context, repeats);
+	std::cout << passes.size() << " passes, " << calls << " state calls: " << filtered.issued << " issued and "
+		<< filtered.filtered << " filtered by the cache" << std::endl;
+	std::cout << "replay without the cache " << unfilteredTime << " ms, with the cache " << filteredTime << " ms" << std::endl;
+}
+
+void testInvalidate()
+{
+	const std::vector<Pass> passes = createFrames(1);
+	const Pass& pass = passes[5];
+
+	RecordingStateContext context;
+	SStateCache cache;
+	cache.Invalidate();
+
+	Counts counts;
+	apply(pass, cache, true, context, counts);
+	CHECK(counts.issued == getCallCount(pass) && counts.filtered == 0);
+
+	// Everything is known now
+	counts = Counts();
+	apply(pass, cache, true, context, counts);
+	CHECK(counts.issued == 0 && counts.filtered == getCallCount(pass));
+
+	// State changed behind the effect's back (InvalidateStateCache) and a new context (Apply)
+	// both set everything again
+	context.OMSetBlendState(nullptr, pass.blendFactor, 0);
+	context.SetShader(SStateCache::StageVS, nullptr);
+	cache.Invalidate();
+	counts = Counts();
+	apply(pass, cache, true, context, counts);
+	CHECK(counts.issued == getCallCount(pass));
+	CHECK(isBound(pass, context));
+
+	// Output bindings unbind the views, which are set again
+	Pass bindsOutputs = pass;
+	bindsOutputs.bindsOutputs = true;
+	counts = Counts();
+	apply(bindsOutputs, cache, true, context, counts);
+	CHECK(counts.issued == 2);
+	CHECK(isBound(pass, context));
+
+	// Shaders with class instances are always set
+	Pass classInstances = pass;
+	classInstances.shaders.back().classInstances = true;
+	for (int i = 0; i < 2; i++)
+	{
+		counts = Counts();
+		apply(classInstances, cache, true, context, counts);
+		CHECK(counts.issued == 1);
+	}
+}
+
+int main()
+{
+	testReplay();
+	testInvalidate();
+	return checkResult("StateCacheReplayTest");
+}
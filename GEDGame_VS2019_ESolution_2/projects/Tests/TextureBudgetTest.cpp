@@ -0,0 +1,189 @@
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "Check.h"
+#include "TextureBudget.h"
+
+// The residency decisions of the texture streamer without a device: the budget, the priority of
+// requested textures, the hysteresis against flickering between mips and the request expiry.
+
+namespace
+{
+	// Mip sizes of a square RGBA8 texture, most detailed first
+	std::vector<uint64_t> makeMips(uint32_t size)
+	{
+		std::vector<uint64_t> mips;
+		for (; size > 0; size /= 2)
+			mips.push_back(uint64_t(size) * size * 4);
+		return mips;
+	}
+
+	const uint32_t kMinimumMip = 4; // 64 x 64 of a 1024 texture
+	const uint64_t kUnlimited = UINT64_MAX / 2;
+}
+
+void testMinimumMips()
+{
+	// The minimum mips are resident even if they exceed the budget
+	TextureBudget budget(0);
+	size_t a = budget.addTexture(makeMips(1024), kMinimumMip);
+	size_t b = budget.addTexture(makeMips(1024), kMinimumMip);
+	budget.requestMip(a, 0.0f);
+	budget.requestMip(b, 0.0f);
+	budget.update();
+	CHECK(budget.getTargetMip(a) == kMinimumMip);
+	CHECK(budget.getTargetMip(b) == kMinimumMip);
+	CHECK(budget.getTargetBytes() == budget.getBytes(a, kMinimumMip) + budget.getBytes(b, kMinimumMip));
+
+	// A minimum beyond the mip chain is clamped to the least detailed mip
+	size_t small = budget.addTexture(makeMips(4), 10);
+	CHECK(budget.getTargetMip(small) == 2);
+}
+
+void testBudget()
+{
+	// Several textures competing for a budget, the targets never exceed it
+	TextureBudget budget;
+	std::vector<size_t> textures;
+	for (int i = 0; i < 8; i++)
+		textures.push_back(budget.addTexture(makeMips(1024 >> (i % 3)), kMinimumMip));
+
+	for (uint64_t bytes : { uint64_t(0), uint64_t(1) << 20, uint64_t(3) << 20, uint64_t(8) << 20, kUnlimited })
+	{
+		budget.setBudget(bytes);
+		for (size_t i = 0; i < textures.size(); i++)
+			budget.requestMip(textures[i], static_cast<float>(i % 4));
+		budget.update();
+
+		uint64_t minimum = 0;
+		for (size_t t : textures)
+			minimum += budget.getBytes(t, kMinimumMip);
+		CHECK(budget.getTargetBytes() <= std::max(bytes, minimum));
+	}
+
+	// With enough budget every texture reaches its request
+	for (size_t i = 0; i < textures.size(); i++)
+		CHECK(budget.getTargetMip(textures[i]) == i % 4);
+}
+
+void testPriority()
+{
+	// Only one more mip fits: it goes to the texture which is missing more detail
+	TextureBudget budget;
+	size_t sharp = budget.addTexture(makeMips(1024), kMinimumMip);
+	size_t blurry = budget.addTexture(makeMips(1024), kMinimumMip);
+	budget.setBudget(budget.getBytes(sharp, kMinimumMip) + budget.getBytes(blurry, kMinimumMip - 1));
+	budget.requestMip(sharp, 2.0f);
+	budget.requestMip(blurry, 0.0f);
+	budget.update();
+	CHECK(budget.getTargetMip(blurry) == kMinimumMip - 1);
+	CHECK(budget.getTargetMip(sharp) == kMinimumMip);
+
+	// Requested textures come before textures which only keep their resident mips
+	TextureBudget shared;
+	size_t requested = shared.addTexture(makeMips(1024), kMinimumMip);
+	size_t resident = shared.addTexture(makeMips(1024), kMinimumMip);
+	shared.setResidentMip(resident, 0);
+	shared.setBudget(shared.getBytes(requested, 0) + shared.getBytes(resident, kMinimumMip));
+	shared.requestMip(requested, 0.0f);
+	shared.update();
+	CHECK(shared.getTargetMip(requested) == 0);
+	CHECK(shared.getTargetMip(resident) == kMinimumMip);
+
+	// With budget left the unrequested texture keeps its resident mips
+	shared.setBudget(kUnlimited);
+	shared.requestMip(requested, 0.0f);
+	shared.update();
+	CHECK(shared.getTargetMip(resident) == 0);
+}
+
+void testHysteresis()
+{
+	TextureBudget budget(kUnlimited);
+	size_t t = budget.addTexture(makeMips(1024), kMinimumMip);
+	budget.setResidentMip(t, 2);
+
+	// Slightly blurrier requests keep the resident mip, clearly blurrier ones give it up
+	budget.requestMip(t, 3.3f);
+	budget.update();
+	CHECK(budget.getTargetMip(t) == 2);
+
+	budget.requestMip(t, 3.6f);
+	budget.update();
+	CHECK(budget.getTargetMip(t) == 3);
+
+	// Sharper requests are followed right away
+	budget.requestMip(t, 1.2f);
+	budget.update();
+	CHECK(budget.getTargetMip(t) == 1);
+}
+
+void testRequests()
+{
+	TextureBudget budget(kUnlimited);
+	size_t t = budget.addTexture(makeMips(1024), kMinimumMip);
+
+	// The most detailed request of a frame wins
+	budget.requestMip(t, 3.0f);
+	budget.requestMip(t, 1.0f);
+	budget.requestMip(t, 2.0f);
+	budget.update();
+	CHECK(budget.getTargetMip(t) == 1);
+	budget.setResidentMip(t, 1);
+
+	// Without requests the resident mips are kept while the budget allows it ...
+	for (uint32_t i = 0; i < TextureBudget::kRequestFrames + 5; i++)
+		budget.update();
+	CHECK(budget.getTargetMip(t) == 1);
+
+	// ... and evicted first when it does not
+	size_t other = budget.addTexture(makeMips(1024), kMinimumMip);
+	budget.setBudget(budget.getBytes(t, kMinimumMip) + budget.getBytes(other, 0));
+	budget.requestMip(other, 0.0f);
+	budget.update();
+	CHECK(budget.getTargetMip(other) == 0);
+	CHECK(budget.getTargetMip(t) == kMinimumMip);
+
+	// A request from the last frames is still honoured
+	budget.setBudget(kUnlimited);
+	budget.requestMip(t, 0.0f);
+	budget.update();
+	for (uint32_t i = 0; i + 1 < TextureBudget::kRequestFrames; i++)
+	{
+		budget.requestMip(other, 0.0f);
+		budget.update();
+	}
+	CHECK(budget.getTargetMip(t) == 0);
+}
+
+void testScreenSize()
+{
+	TextureBudget budget(kUnlimited);
+	size_t t = budget.addTexture(makeMips(1024), 10);
+
+	budget.requestScreenSize(t, 1024, 512, 256.0f);
+	budget.update();
+	CHECK(budget.getTargetMip(t) == 2);
+
+	budget.requestScreenSize(t, 1024, 1024, 4096.0f);
+	budget.update();
+	CHECK(budget.getTargetMip(t) == 0);
+
+	// Sub-pixel textures only need the minimum
+	budget.setResidentMip(t, 0);
+	budget.requestScreenSize(t, 1024, 1024, 0.5f);
+	budget.update();
+	CHECK(budget.getTargetMip(t) == 10);
+}
+
+int main()
+{
+	testMinimumMips();
+	testBudget();
+	testPriority();
+	testHysteresis();
+	testRequests();
+	testScreenSize();
+	return checkResult("TextureBudgetTest");
+}
@@ -0,0 +1,96 @@
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "Check.h"
+#include "T3dFile.h"
+#include "VertexCache.h"
+
+// The vertex cache optimizer on a shuffled grid: the same triangles come out, in an order with
+// close to optimal cache misses. readT3d rejects indices the optimizers could not use.
+
+using namespace MeshTools;
+
+namespace
+{
+	const uint32_t kGridSize = 64;
+
+	// Triangles of a kGridSize x kGridSize quad grid in random order
+	std::vector<uint32_t> makeShuffledGrid()
+	{
+		std::vector<std::array<uint32_t, 3>> triangles;
+		for (uint32_t y = 0; y < kGridSize; y++)
+			for (uint32_t x = 0; x < kGridSize; x++)
+			{
+				uint32_t v = y * (kGridSize + 1) + x;
+				triangles.push_back({ v, v + 1, v + kGridSize + 1 });
+				triangles.push_back({ v + 1, v + kGridSize + 2, v + kGridSize + 1 });
+			}
+		std::shuffle(triangles.begin(), triangles.end(), std::mt19937(42));
+
+		std::vector<uint32_t> indices;
+		for (auto& triangle : triangles)
+			indices.insert(indices.end(), triangle.begin(), triangle.end());
+		return indices;
+	}
+
+	std::vector<std::array<uint32_t, 3>> sortedTriangles(const std::vector<uint32_t>& indices)
+	{
+		std::vector<std::array<uint32_t, 3>> triangles;
+		for (size_t i = 0; i < indices.size(); i += 3)
+			triangles.push_back({ indices[i], indices[i + 1], indices[i + 2] });
+		std::sort(triangles.begin(), triangles.end());
+		return triangles;
+	}
+}
+
+void testOptimizeVertexCache()
+{
+	const size_t vertexCount = (kGridSize + 1) * (kGridSize + 1);
+	std::vector<uint32_t> indices = makeShuffledGrid();
+	std::vector<uint32_t> optimized = indices;
+	optimizeVertexCache(optimized, vertexCount);
+
+	// Triangles are reordered but kept with their winding
+	CHECK(optimized.size() == indices.size());
+	CHECK(sortedTriangles(optimized) == sortedTriangles(indices));
+
+	// A grid can get close to 0.5 misses per triangle, a shuffled one is near 3
+	CacheStatistics before = analyzeVertexCache(indices, vertexCount);
+	CacheStatistics after = analyzeVertexCache(optimized, vertexCount);
+	CHECK(before.acmr > 2.0f);
+	CHECK(after.acmr < 0.8f);
+
+	// Deterministic
+	std::vector<uint32_t> again = indices;
+	optimizeVertexCache(again, vertexCount);
+	CHECK(again == optimized);
+}
+
+void testReadRejectsBadIndices()
+{
+	const char* filename = "VertexCacheTest.t3d";
+
+	T3dMesh mesh;
+	mesh.vertices.resize(3);
+	mesh.indices = { 0, 1, 2 };
+	CHECK(writeT3d(filename, mesh));
+	T3dMesh read;
+	CHECK(readT3d(filename, read));
+	CHECK(read.indices == mesh.indices);
+
+	mesh.indices = { 0, 1, 3 };
+	CHECK(writeT3d(filename, mesh));
+	CHECK(!readT3d(filename, read));
+
+	std::remove(filename);
+}
+
+int main()
+{
+	testOptimizeVertexCache();
+	testReadRejectsBadIndices();
+	return checkResult("VertexCacheTest");
+}